@@ -14,6 +14,72 @@
 #include "proxy.h"
 #include "nccl_cvars.h"
 
+/*
+=== BEGIN_NCCL_CVAR_INFO_BLOCK ===
+
+ - name        : NCCL_BOOTSTRAP_ALLGATHER_ALGO
+   type        : enum
+   default     : adaptive
+   choices     : adaptive, ring, bruck
+   description : |-
+     Algorithm used by the bootstrap AllGather during communicator
+     initialization and split.
+     adaptive - Use bruck for communicators of at least
+                NCCL_BOOTSTRAP_BRUCK_MIN_RANKS ranks when each rank
+                contributes at most NCCL_BOOTSTRAP_BRUCK_MAX_SIZE bytes,
+                ring otherwise
+     ring     - nranks-1 sequential steps over the bootstrap ring
+     bruck    - ceil(log2(nranks)) steps over persistent connections to
+                the ranks at power-of-two distances
+
+ - name        : NCCL_BOOTSTRAP_BRUCK_MIN_RANKS
+   type        : int
+   default     : 16
+   description : |-
+     Smallest communicator size for which the bruck bootstrap AllGather is
+     selected automatically.
+
+ - name        : NCCL_BOOTSTRAP_BRUCK_MAX_SIZE
+   type        : int64_t
+   default     : 1048576
+   description : |-
+     Largest per-rank contribution in bytes for which the bruck bootstrap
+     AllGather is selected automatically. Larger AllGathers are bandwidth
+     bound; both algorithms move the same amount of data and the ring does
+     not need to open additional connections.
+
+=== END_NCCL_CVAR_INFO_BLOCK ===
+*/
+
+// Tags reserved for bootstrap internal connections. User tags are non-negative,
+// -2 is used by bootstrapSplit to exchange listen handles through the parent.
+#define BOOTSTRAP_TAG_RING (-3)
+#define BOOTSTRAP_TAG_COLL (-4)
+#define BOOTSTRAP_TAG_P2P (-5)
+
+// Ranks at power-of-two distances (rank+1, rank+2, rank+4, ...) are the peers
+// of the bruck AllGather and of the dissemination barrier.
+#define BOOTSTRAP_MAX_POW2_PEERS 32
+
+static int bootstrapNumPow2Peers(int nranks) {
+  int n = 1;
+  while (n < BOOTSTRAP_MAX_POW2_PEERS && (1L << n) < nranks) n++;
+  return n;
+}
+
+static bool bootstrapAllGatherUseBruck(int nranks, int size) {
+  // Every exchange has to fit in a single int-sized socket operation
+  if ((size_t)nranks*size > INT_MAX) return false;
+  switch (NCCL_BOOTSTRAP_ALLGATHER_ALGO) {
+    case NCCL_BOOTSTRAP_ALLGATHER_ALGO::ring:
+      return false;
+    case NCCL_BOOTSTRAP_ALLGATHER_ALGO::bruck:
+      return true;
+    default:
+      return nranks >= NCCL_BOOTSTRAP_BRUCK_MIN_RANKS && size <= NCCL_BOOTSTRAP_BRUCK_MAX_SIZE;
+  }
+}
+
 struct bootstrapRootArgs {
   struct ncclSocket* listenSock;
   uint64_t magic;
@@ -104,6 +170,8 @@ static void *bootstrapRoot(void* rargs) {
   union ncclSocketAddress *rankAddresses = NULL;
   union ncclSocketAddress *rankAddressesRoot = NULL; // for initial rank <-> root information exchange
   union ncclSocketAddress *zero = NULL;
+  union ncclSocketAddress peerAddresses[BOOTSTRAP_MAX_POW2_PEERS];
+  int nPeers;
   NCCLCHECKGOTO(ncclCalloc(&zero, 1), res, out);
   setFilesLimit();
 
@@ -141,13 +209,18 @@ static void *bootstrapRoot(void* rargs) {
   } while (c < nranks);
   TRACE(NCCL_INIT, "COLLECTED ALL %d HANDLES", nranks);
 
-  // Send the connect handle for the next rank in the AllGather ring
+  // Send the connect handles of the ranks at power-of-two distances. The first
+  // one is the next rank in the AllGather ring; the others let the first
+  // AllGather use the bruck algorithm before all handles are known.
+  nPeers = bootstrapNumPow2Peers(nranks);
   for (int r=0; r<nranks; ++r) {
-    int next = (r+1) % nranks;
     struct ncclSocket sock;
+    for (int k=0; k<nPeers; ++k) {
+      memcpy(peerAddresses+k, rankAddresses+(r+(1L<<k))%nranks, sizeof(union ncclSocketAddress));
+    }
     NCCLCHECKGOTO(ncclSocketInit(&sock, rankAddressesRoot+r, magic, ncclSocketTypeBootstrap), res, out);
     NCCLCHECKGOTO(ncclSocketConnect(&sock), res, out);
-    NCCLCHECKGOTO(bootstrapNetSend(&sock, rankAddresses+next, sizeof(union ncclSocketAddress)), res, out);
+    NCCLCHECKGOTO(bootstrapNetSend(&sock, peerAddresses, nPeers*sizeof(union ncclSocketAddress)), res, out);
     NCCLCHECKGOTO(ncclSocketClose(&sock), res, out);
   }
   TRACE(NCCL_INIT, "SENT OUT ALL %d HANDLES", nranks);
@@ -203,33 +276,118 @@ ncclResult_t bootstrapGetUniqueId(struct ncclBootstrapHandle* handle) {
   return ncclSuccess;
 }
 
+// Unexpected connection, or message buffered from a persistent p2p connection
 struct unexConn {
   int peer;
   int tag;
   struct ncclSocket sock;
+  char* data;
+  int size;
   struct unexConn* next;
 };
 
+/* Unexpected connections or messages hashed by (peer, tag). Each bucket is kept
+ * in arrival order, so entries with the same key are dequeued first in first out.
+ */
+struct unexBucket {
+  struct unexConn* head;
+  struct unexConn* tail;
+};
+
+struct unexTable {
+  struct unexBucket* buckets;
+  int nBuckets; // power of two, 0 until the first unexpected connection
+  int count;
+};
+
+#define UNEX_TABLE_INIT_BUCKETS 64
+
 struct bootstrapState {
   struct ncclSocket listenSock;
   struct ncclSocket ringRecvSocket;
   struct ncclSocket ringSendSocket;
+  // Persistent connections of the bruck AllGather, indexed by peer rank and
+  // established on first use
+  struct ncclSocket** collSendSockets;
+  struct ncclSocket** collRecvSockets;
+  // Persistent connections of bootstrapSend/Recv, indexed by peer rank and
+  // established on first use. Every message is framed with its tag, so one
+  // connection per direction carries the traffic of all tags.
+  struct ncclSocket** p2pSendSockets;
+  struct ncclSocket** p2pRecvSockets;
+  // One per peer, so a connect or a send to a slow peer doesn't block the
+  // sends to the others. Receives from a peer are serialized the same way, as
+  // they read the same stream.
+  pthread_mutex_t* p2pSendLocks;
+  pthread_mutex_t* p2pRecvLocks;
   union ncclSocketAddress* peerCommAddresses;
   union ncclSocketAddress* peerProxyAddresses;
-  struct unexConn* unexpectedConnections;
+  // Shared by all peers. The connections lock is held while accepting on the
+  // listen socket.
+  struct unexTable unexpectedConnections;
+  pthread_mutex_t unexpectedConnectionsLock;
+  struct unexTable unexpectedMessages;
+  pthread_mutex_t unexpectedMessagesLock;
   int cudaDev;
   int rank;
   int nranks;
   uint64_t magic;
   volatile uint32_t *abortFlag;
+  // Connection and traffic counters, reported when the state is closed
+  int nConnects;
+  int nAccepts;
+  uint64_t sendMsgs;
+  uint64_t sendBytes;
+  uint64_t recvMsgs;
+  uint64_t recvBytes;
 };
 
+struct bootstrapMsgHdr {
+  int tag;
+  int size;
+};
+
+static ncclResult_t bootstrapAcceptFrom(struct bootstrapState* state, int peer, int tag, struct ncclSocket* sock);
+
+// The ring is tagged because with the bruck AllGather other ranks may already
+// connect to us while our previous rank in the ring has not done so yet.
+static ncclResult_t bootstrapRingConnect(struct bootstrapState* state, union ncclSocketAddress* nextAddr) {
+  int tag = BOOTSTRAP_TAG_RING;
+  NCCLCHECK(ncclSocketInit(&state->ringSendSocket, nextAddr, state->magic, ncclSocketTypeBootstrap, state->abortFlag));
+  NCCLCHECK(ncclSocketConnect(&state->ringSendSocket));
+  NCCLCHECK(bootstrapNetSend(&state->ringSendSocket, &state->rank, sizeof(int)));
+  NCCLCHECK(bootstrapNetSend(&state->ringSendSocket, &tag, sizeof(int)));
+  // Accept the connect request from the previous rank in the AllGather ring
+  NCCLCHECK(bootstrapAcceptFrom(state, (state->rank-1+state->nranks)%state->nranks, BOOTSTRAP_TAG_RING, &state->ringRecvSocket));
+  return ncclSuccess;
+}
+
+static ncclResult_t bootstrapLocksInit(struct bootstrapState* state) {
+  // Send locks then receive locks, in one allocation
+  NCCLCHECK(ncclCalloc(&state->p2pSendLocks, 2*state->nranks));
+  state->p2pRecvLocks = state->p2pSendLocks+state->nranks;
+  for (int r=0; r<2*state->nranks; r++) pthread_mutex_init(state->p2pSendLocks+r, NULL);
+  pthread_mutex_init(&state->unexpectedConnectionsLock, NULL);
+  pthread_mutex_init(&state->unexpectedMessagesLock, NULL);
+  return ncclSuccess;
+}
+
+static void bootstrapLocksFree(struct bootstrapState* state) {
+  if (state->p2pSendLocks == NULL) return;
+  for (int r=0; r<2*state->nranks; r++) pthread_mutex_destroy(state->p2pSendLocks+r);
+  pthread_mutex_destroy(&state->unexpectedConnectionsLock);
+  pthread_mutex_destroy(&state->unexpectedMessagesLock);
+  free(state->p2pSendLocks);
+  state->p2pSendLocks = state->p2pRecvLocks = NULL;
+}
+
 ncclResult_t bootstrapInit(struct ncclBootstrapHandle* handle, struct ncclComm* comm) {
   int rank = comm->rank;
   int nranks = comm->nRanks;
   struct bootstrapState* state;
   struct ncclSocket* proxySocket;
-  ncclSocketAddress nextAddr;
+  union ncclSocketAddress peerAddrs[BOOTSTRAP_MAX_POW2_PEERS];
+  int nPeers = bootstrapNumPow2Peers(nranks);
   struct ncclSocket sock, listenSockRoot;
   struct extInfo info = { 0 };
 
@@ -270,21 +428,27 @@ ncclResult_t bootstrapInit(struct ncclBootstrapHandle* handle, struct ncclComm*
   NCCLCHECK(bootstrapNetSend(&sock, &info, sizeof(info)));
   NCCLCHECK(ncclSocketClose(&sock));
 
-  // get info on my "next" rank in the bootstrap ring from root
+  // get info on my "next" rank in the bootstrap ring and the other power-of-two
+  // peers from root
   NCCLCHECK(ncclSocketInit(&sock));
   NCCLCHECK(ncclSocketAccept(&sock, &listenSockRoot));
-  NCCLCHECK(bootstrapNetRecv(&sock, &nextAddr, sizeof(union ncclSocketAddress)));
+  NCCLCHECK(bootstrapNetRecv(&sock, peerAddrs, nPeers*sizeof(union ncclSocketAddress)));
   NCCLCHECK(ncclSocketClose(&sock));
   NCCLCHECK(ncclSocketClose(&listenSockRoot));
 
-  NCCLCHECK(ncclSocketInit(&state->ringSendSocket, &nextAddr, comm->magic, ncclSocketTypeBootstrap, comm->abortFlag));
-  NCCLCHECK(ncclSocketConnect(&state->ringSendSocket));
-  // Accept the connect request from the previous rank in the AllGather ring
-  NCCLCHECK(ncclSocketInit(&state->ringRecvSocket));
-  NCCLCHECK(ncclSocketAccept(&state->ringRecvSocket, &state->listenSock));
+  NCCLCHECK(ncclCalloc(&state->collSendSockets, nranks));
+  NCCLCHECK(ncclCalloc(&state->collRecvSockets, nranks));
+  NCCLCHECK(ncclCalloc(&state->p2pSendSockets, nranks));
+  NCCLCHECK(ncclCalloc(&state->p2pRecvSockets, nranks));
+  NCCLCHECK(bootstrapLocksInit(state));
+  NCCLCHECK(ncclCalloc(&state->peerCommAddresses, nranks));
+  for (int k=0; k<nPeers; k++) {
+    memcpy(state->peerCommAddresses+(rank+(1L<<k))%nranks, peerAddrs+k, sizeof(union ncclSocketAddress));
+  }
+
+  NCCLCHECK(bootstrapRingConnect(state, peerAddrs));
 
   // AllGather all listen handlers
-  NCCLCHECK(ncclCalloc(&state->peerCommAddresses, nranks));
   NCCLCHECK(ncclSocketGetAddr(&state->listenSock, state->peerCommAddresses+rank));
   NCCLCHECK(bootstrapAllGather(state, state->peerCommAddresses, sizeof(union ncclSocketAddress)));
 
@@ -308,7 +472,7 @@ ncclResult_t bootstrapSplit(struct ncclBootstrapHandle* handle, struct ncclComm*
   ncclResult_t ret = ncclSuccess;
   int rank = comm->rank;
   int nranks = comm->nRanks;
-  int prev, next;
+  int prev, next, nPeers;
   ncclSocketAddress listenAddr, tmpAddr;
   struct ncclSocket* proxySocket;
   struct bootstrapState* state;
@@ -325,23 +489,33 @@ ncclResult_t bootstrapSplit(struct ncclBootstrapHandle* handle, struct ncclComm*
 
   // Setup my sockets for the allgather ring and other p2p connections
   NCCLCHECKGOTO(ncclSocketInit(&state->listenSock, &bootstrapNetIfAddr, comm->magic, ncclSocketTypeBootstrap, comm->abortFlag, 0), ret, fail);
-  NCCLCHECKGOTO(ncclSocketInit(&state->ringRecvSocket, NULL, comm->magic, ncclSocketTypeBootstrap, comm->abortFlag, 0), ret, fail);
 
   // Create socket for other ranks to contact me
   NCCLCHECKGOTO(ncclSocketListen(&state->listenSock), ret, fail);
 
-  // Get addr from next rank
+  NCCLCHECKGOTO(ncclCalloc(&state->collSendSockets, nranks), ret, fail);
+  NCCLCHECKGOTO(ncclCalloc(&state->collRecvSockets, nranks), ret, fail);
+  NCCLCHECKGOTO(ncclCalloc(&state->p2pSendSockets, nranks), ret, fail);
+  NCCLCHECKGOTO(ncclCalloc(&state->p2pRecvSockets, nranks), ret, fail);
+  NCCLCHECKGOTO(bootstrapLocksInit(state), ret, fail);
+  NCCLCHECKGOTO(ncclCalloc(&state->peerCommAddresses, nranks), ret, fail);
+
+  // Get addr from next rank, and from the other power-of-two peers if the
+  // first AllGather is going to need them
   NCCLCHECKGOTO(ncclSocketGetAddr(&state->listenSock, &listenAddr), ret, fail);
-  NCCLCHECKGOTO(bootstrapSend(parent->bootstrap, prev, -2, &listenAddr, sizeof(union ncclSocketAddress)), ret, fail);
-  NCCLCHECKGOTO(bootstrapRecv(parent->bootstrap, next, -2, &tmpAddr, sizeof(union ncclSocketAddress)), ret, fail);
+  nPeers = bootstrapAllGatherUseBruck(nranks, sizeof(union ncclSocketAddress)) ? bootstrapNumPow2Peers(nranks) : 1;
+  for (int k=0; k<nPeers; k++) {
+    int dist = 1 << k;
+    NCCLCHECKGOTO(bootstrapSend(parent->bootstrap, parentRanks[(rank-dist+nranks)%nranks], -2, &listenAddr, sizeof(union ncclSocketAddress)), ret, fail);
+  }
+  for (int k=0; k<nPeers; k++) {
+    int peer = (rank + (1L << k)) % nranks;
+    NCCLCHECKGOTO(bootstrapRecv(parent->bootstrap, parentRanks[peer], -2, state->peerCommAddresses+peer, sizeof(union ncclSocketAddress)), ret, fail);
+  }
 
-  NCCLCHECKGOTO(ncclSocketInit(&state->ringSendSocket, &tmpAddr, comm->magic, ncclSocketTypeBootstrap, comm->abortFlag, 0), ret, fail);
-  NCCLCHECKGOTO(ncclSocketConnect(&state->ringSendSocket), ret, fail);
-  // Accept the connect request from the previous rank in the AllGather ring
-  NCCLCHECKGOTO(ncclSocketAccept(&state->ringRecvSocket, &state->listenSock), ret, fail);
+  NCCLCHECKGOTO(bootstrapRingConnect(state, state->peerCommAddresses+(rank+1)%nranks), ret, fail);
 
   // AllGather all listen handlers
-  NCCLCHECKGOTO(ncclCalloc(&state->peerCommAddresses, nranks), ret, fail);
   memcpy(state->peerCommAddresses+rank, &listenAddr, sizeof(union ncclSocketAddress));
   NCCLCHECKGOTO(bootstrapAllGather(state, state->peerCommAddresses, sizeof(union ncclSocketAddress)), ret, fail);
 
@@ -372,14 +546,113 @@ fail:
   goto exit;
 }
 
-ncclResult_t bootstrapAllGather(void* commState, void* allData, int size) {
-  struct bootstrapState* state = (struct bootstrapState*)commState;
-  char* data = (char*)allData;
+// Return the persistent connection to peer from sockets, connecting and
+// sending the (rank, tag) header on first use
+static ncclResult_t bootstrapPeerSendSocket(struct bootstrapState* state, struct ncclSocket** sockets, int tag, int peer, struct ncclSocket** sock) {
+  ncclResult_t ret = ncclSuccess;
+  struct ncclSocket* s = sockets[peer];
+
+  if (s == NULL) {
+    NCCLCHECK(ncclCalloc(&s, 1));
+    NCCLCHECKGOTO(ncclSocketInit(s, state->peerCommAddresses+peer, state->magic, ncclSocketTypeBootstrap, state->abortFlag), ret, fail);
+    NCCLCHECKGOTO(ncclSocketConnect(s), ret, fail);
+    NCCLCHECKGOTO(bootstrapNetSend(s, &state->rank, sizeof(int)), ret, fail);
+    NCCLCHECKGOTO(bootstrapNetSend(s, &tag, sizeof(int)), ret, fail);
+    sockets[peer] = s;
+    __atomic_fetch_add(&state->nConnects, 1, __ATOMIC_RELAXED);
+  }
+  *sock = s;
+
+exit:
+  return ret;
+fail:
+  (void)ncclSocketClose(s);
+  free(s);
+  goto exit;
+}
+
+// Return the persistent connection from peer from sockets, accepting it on
+// first use
+static ncclResult_t bootstrapPeerRecvSocket(struct bootstrapState* state, struct ncclSocket** sockets, int tag, int peer, struct ncclSocket** sock) {
+  ncclResult_t ret = ncclSuccess;
+  struct ncclSocket* s = sockets[peer];
+
+  if (s == NULL) {
+    NCCLCHECK(ncclCalloc(&s, 1));
+    NCCLCHECKGOTO(bootstrapAcceptFrom(state, peer, tag, s), ret, fail);
+    sockets[peer] = s;
+    __atomic_fetch_add(&state->nAccepts, 1, __ATOMIC_RELAXED);
+  }
+  *sock = s;
+
+exit:
+  return ret;
+fail:
+  free(s);
+  goto exit;
+}
+
+static ncclResult_t bootstrapPeerSocketsFree(struct ncclSocket*** sockets, int nranks) {
+  if (*sockets == NULL) return ncclSuccess;
+  for (int i=0; i<nranks; i++) {
+    if ((*sockets)[i]) {
+      NCCLCHECK(ncclSocketClose((*sockets)[i]));
+      free((*sockets)[i]);
+    }
+  }
+  free(*sockets);
+  *sockets = NULL;
+  return ncclSuccess;
+}
+
+static ncclResult_t bootstrapPeerClose(struct bootstrapState* state) {
+  NCCLCHECK(bootstrapPeerSocketsFree(&state->collSendSockets, state->nranks));
+  NCCLCHECK(bootstrapPeerSocketsFree(&state->collRecvSockets, state->nranks));
+  NCCLCHECK(bootstrapPeerSocketsFree(&state->p2pSendSockets, state->nranks));
+  NCCLCHECK(bootstrapPeerSocketsFree(&state->p2pRecvSockets, state->nranks));
+  return ncclSuccess;
+}
+
+struct bootstrapSegment {
+  char* ptr;
+  int size;
+};
+
+// Split the cyclic range of count blocks starting at block start into at most
+// two contiguous segments
+static int bootstrapCyclicSegments(char* data, int size, int nranks, int start, int count, struct bootstrapSegment* segs) {
+  int n = std::min(count, nranks-start);
+  segs[0].ptr = data+(size_t)start*size;
+  segs[0].size = n*size;
+  if (n == count) return 1;
+  segs[1].ptr = data;
+  segs[1].size = (count-n)*size;
+  return 2;
+}
+
+// Both sides of a persistent connection know the exchanged sizes, so payloads
+// are sent without a size header. Sends and receives are progressed together
+// so that large exchanges cannot deadlock on full socket buffers.
+static ncclResult_t bootstrapCollExchange(struct ncclSocket* sendSock, struct bootstrapSegment* sendSegs, int nSend,
+    struct ncclSocket* recvSock, struct bootstrapSegment* recvSegs, int nRecv) {
+  int s = 0, r = 0, sOffset = 0, rOffset = 0;
+  while (s < nSend || r < nRecv) {
+    if (s < nSend) {
+      NCCLCHECK(ncclSocketProgress(NCCL_SOCKET_SEND, sendSock, sendSegs[s].ptr, sendSegs[s].size, &sOffset));
+      if (sOffset == sendSegs[s].size) { s++; sOffset = 0; }
+    }
+    if (r < nRecv) {
+      NCCLCHECK(ncclSocketProgress(NCCL_SOCKET_RECV, recvSock, recvSegs[r].ptr, recvSegs[r].size, &rOffset));
+      if (rOffset == recvSegs[r].size) { r++; rOffset = 0; }
+    }
+  }
+  return ncclSuccess;
+}
+
+static ncclResult_t bootstrapAllGatherRing(struct bootstrapState* state, char* data, int size) {
   int rank = state->rank;
   int nranks = state->nranks;
 
-  TRACE(NCCL_INIT, "rank %d nranks %d size %d", rank, nranks, size);
-
   /* Simple ring based AllGather
    * At each step i receive data from (rank-i-1) from left
    * and send previous step's data from (rank-i) to right
@@ -393,27 +666,71 @@ ncclResult_t bootstrapAllGather(void* commState, void* allData, int size) {
     // Recv slice from the left
     NCCLCHECK(bootstrapNetRecv(&state->ringRecvSocket, data+rslice*size, size));
   }
+  return ncclSuccess;
+}
 
-  TRACE(NCCL_INIT, "rank %d nranks %d size %d - DONE", rank, nranks, size);
+static ncclResult_t bootstrapAllGatherBruck(struct bootstrapState* state, char* data, int size) {
+  int rank = state->rank;
+  int nranks = state->nranks;
+
+  /* Bruck AllGather, ceil(log2(nranks)) steps
+   * Before the step at distance d a rank holds the d blocks ending at its own
+   * one, (rank-d, rank]. It sends up to d of them to rank+d and receives the
+   * blocks ending at rank-d from rank-d, so the blocks held always form a
+   * contiguous cyclic range and can be exchanged in place.
+   */
+  for (int dist=1; dist<nranks; dist<<=1) {
+    int count = std::min(dist, nranks-dist);
+    int dst = (rank + dist) % nranks;
+    int src = (rank - dist + nranks) % nranks;
+    struct ncclSocket *sendSock, *recvSock;
+    struct bootstrapSegment sendSegs[2], recvSegs[2];
+    int nSend, nRecv;
+
+    NCCLCHECK(bootstrapPeerSendSocket(state, state->collSendSockets, BOOTSTRAP_TAG_COLL, dst, &sendSock));
+    NCCLCHECK(bootstrapPeerRecvSocket(state, state->collRecvSockets, BOOTSTRAP_TAG_COLL, src, &recvSock));
+    nSend = bootstrapCyclicSegments(data, size, nranks, (rank - count + 1 + nranks) % nranks, count, sendSegs);
+    nRecv = bootstrapCyclicSegments(data, size, nranks, (src - count + 1 + nranks) % nranks, count, recvSegs);
+    NCCLCHECK(bootstrapCollExchange(sendSock, sendSegs, nSend, recvSock, recvSegs, nRecv));
+  }
+  return ncclSuccess;
+}
+
+ncclResult_t bootstrapAllGather(void* commState, void* allData, int size) {
+  struct bootstrapState* state = (struct bootstrapState*)commState;
+  char* data = (char*)allData;
+  int nranks = state->nranks;
+  bool bruck = bootstrapAllGatherUseBruck(nranks, size);
+
+  TRACE(NCCL_INIT, "rank %d nranks %d size %d algo %s", state->rank, nranks, size, bruck ? "bruck" : "ring");
+
+  if (bruck) {
+    NCCLCHECK(bootstrapAllGatherBruck(state, data, size));
+  } else {
+    NCCLCHECK(bootstrapAllGatherRing(state, data, size));
+  }
+
+  TRACE(NCCL_INIT, "rank %d nranks %d size %d - DONE", state->rank, nranks, size);
   return ncclSuccess;
 }
 
 ncclResult_t bootstrapSend(void* commState, int peer, int tag, void* data, int size) {
   ncclResult_t ret = ncclSuccess;
   struct bootstrapState* state = (struct bootstrapState*)commState;
-  struct ncclSocket sock;
+  struct bootstrapMsgHdr hdr = { tag, size };
+  struct ncclSocket* sock;
 
-  NCCLCHECKGOTO(ncclSocketInit(&sock, state->peerCommAddresses+peer, state->magic, ncclSocketTypeBootstrap), ret, fail);
-  NCCLCHECKGOTO(ncclSocketConnect(&sock), ret, fail);
-  NCCLCHECKGOTO(bootstrapNetSend(&sock, &state->rank, sizeof(int)), ret, fail);
-  NCCLCHECKGOTO(bootstrapNetSend(&sock, &tag, sizeof(int)), ret, fail);
-  NCCLCHECKGOTO(bootstrapNetSend(&sock, data, size), ret, fail);
+  // Header and payload of a message must not interleave with other senders to the same peer
+  pthread_mutex_lock(state->p2pSendLocks+peer);
+  NCCLCHECKGOTO(bootstrapPeerSendSocket(state, state->p2pSendSockets, BOOTSTRAP_TAG_P2P, peer, &sock), ret, exit);
+  NCCLCHECKGOTO(ncclSocketSend(sock, &hdr, sizeof(hdr)), ret, exit);
+  NCCLCHECKGOTO(ncclSocketSend(sock, data, size), ret, exit);
+  __atomic_fetch_add(&state->sendMsgs, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&state->sendBytes, size, __ATOMIC_RELAXED);
 
 exit:
-  NCCLCHECK(ncclSocketClose(&sock));
+  pthread_mutex_unlock(state->p2pSendLocks+peer);
   return ret;
-fail:
-  goto exit;
 }
 
 ncclResult_t bootstrapBarrier(void* commState, int *ranks, int rank, int nranks, int tag) {
@@ -424,6 +741,10 @@ ncclResult_t bootstrapBarrier(void* commState, int *ranks, int rank, int nranks,
    *
    * Based on the dissemination algorithm by Debra Hensgen, Raphael Finkel, and Udi Manbet,
    * "Two Algorithms for Barrier Synchronization," International Journal of Parallel Programming, 17(1):1-17, 1988"
+   *
+   * Tokens go over the persistent p2p connections, tagged so that they can't
+   * be mixed with the other messages of the peers, e.g. an allgather run by
+   * another thread.
    */
   int data[1];
   for (int mask=1; mask<nranks; mask<<=1) {
@@ -471,109 +792,264 @@ ncclResult_t bootstrapIntraNodeBroadcast(void* commState, int *ranks, int rank,
   return ncclSuccess;
 }
 
-ncclResult_t unexpectedEnqueue(struct bootstrapState* state, int peer, int tag, struct ncclSocket* sock) {
-  // New unex
-  struct unexConn* unex;
-  NCCLCHECK(ncclCalloc(&unex, 1));
-  unex->peer = peer;
-  unex->tag = tag;
-  memcpy(&unex->sock, sock, sizeof(struct ncclSocket));
+static inline uint32_t unexpectedHash(int peer, int tag) {
+  uint64_t h = ((uint64_t)(uint32_t)peer << 32) | (uint32_t)tag;
+  // 64-bit finalizer of MurmurHash3
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (uint32_t)h;
+}
 
-  // Enqueue
-  struct unexConn* list = state->unexpectedConnections;
-  if (list == NULL) {
-    state->unexpectedConnections = unex;
-    return ncclSuccess;
+static void unexpectedAppend(struct unexTable* table, struct unexConn* unex) {
+  struct unexBucket* bucket = table->buckets + (unexpectedHash(unex->peer, unex->tag) & (table->nBuckets-1));
+  unex->next = NULL;
+  if (bucket->tail == NULL) {
+    bucket->head = unex;
+  } else {
+    bucket->tail->next = unex;
+  }
+  bucket->tail = unex;
+}
+
+// Double the number of buckets once the load factor exceeds 1. Buckets are
+// rehashed in order, which keeps connections of the same key in arrival order.
+static ncclResult_t unexpectedGrow(struct unexTable* table) {
+  struct unexTable newTable = { NULL, table->nBuckets ? table->nBuckets*2 : UNEX_TABLE_INIT_BUCKETS, table->count };
+  NCCLCHECK(ncclCalloc(&newTable.buckets, newTable.nBuckets));
+  for (int b=0; b<table->nBuckets; b++) {
+    struct unexConn* elem = table->buckets[b].head;
+    while (elem) {
+      struct unexConn* next = elem->next;
+      unexpectedAppend(&newTable, elem);
+      elem = next;
+    }
   }
-  while (list->next) list = list->next;
-  list->next = unex;
+  free(table->buckets);
+  *table = newTable;
   return ncclSuccess;
 }
 
-ncclResult_t unexpectedDequeue(struct bootstrapState* state, int peer, int tag, struct ncclSocket* sock, int* found) {
-  struct unexConn* elem = state->unexpectedConnections;
+static ncclResult_t unexpectedPush(struct unexTable* table, struct unexConn* unex) {
+  if (table->count >= table->nBuckets) NCCLCHECK(unexpectedGrow(table));
+  unexpectedAppend(table, unex);
+  table->count++;
+  return ncclSuccess;
+}
+
+// Remove and return the oldest entry of (peer, tag), or NULL
+static struct unexConn* unexpectedPop(struct unexTable* table, int peer, int tag) {
+  if (table->count == 0) return NULL;
+
+  struct unexBucket* bucket = table->buckets + (unexpectedHash(peer, tag) & (table->nBuckets-1));
+  struct unexConn* elem = bucket->head;
   struct unexConn* prev = NULL;
-  *found = 0;
   while (elem) {
     if (elem->peer == peer && elem->tag == tag) {
       if (prev == NULL) {
-        state->unexpectedConnections = elem->next;
+        bucket->head = elem->next;
       } else {
         prev->next = elem->next;
       }
-      memcpy(sock, &elem->sock, sizeof(struct ncclSocket));
-      free(elem);
-      *found = 1;
-      return ncclSuccess;
+      if (bucket->tail == elem) bucket->tail = prev;
+      table->count--;
+      return elem;
     }
     prev = elem;
     elem = elem->next;
   }
+  return NULL;
+}
+
+ncclResult_t unexpectedEnqueue(struct bootstrapState* state, int peer, int tag, struct ncclSocket* sock) {
+  // New unex
+  struct unexConn* unex;
+  NCCLCHECK(ncclCalloc(&unex, 1));
+  unex->peer = peer;
+  unex->tag = tag;
+  memcpy(&unex->sock, sock, sizeof(struct ncclSocket));
+
+  // Enqueue
+  NCCLCHECK(unexpectedPush(&state->unexpectedConnections, unex));
   return ncclSuccess;
 }
 
-static void unexpectedFree(struct bootstrapState* state) {
-  struct unexConn* elem = state->unexpectedConnections;
-  struct unexConn* prev = NULL;
+ncclResult_t unexpectedDequeue(struct bootstrapState* state, int peer, int tag, struct ncclSocket* sock, int* found) {
+  struct unexConn* elem = unexpectedPop(&state->unexpectedConnections, peer, tag);
+  *found = 0;
+  if (elem) {
+    memcpy(sock, &elem->sock, sizeof(struct ncclSocket));
+    free(elem);
+    *found = 1;
+  }
+  return ncclSuccess;
+}
 
-  while (elem) {
-    prev = elem;
-    elem = elem->next;
-    free(prev);
+// Takes ownership of data, also on failure
+static ncclResult_t unexpectedMsgEnqueue(struct bootstrapState* state, int peer, int tag, char* data, int size) {
+  ncclResult_t ret = ncclSuccess;
+  struct unexConn* unex;
+  NCCLCHECKGOTO(ncclCalloc(&unex, 1), ret, fail);
+  unex->peer = peer;
+  unex->tag = tag;
+  unex->data = data;
+  unex->size = size;
+  pthread_mutex_lock(&state->unexpectedMessagesLock);
+  ret = unexpectedPush(&state->unexpectedMessages, unex);
+  pthread_mutex_unlock(&state->unexpectedMessagesLock);
+  if (ret != ncclSuccess) {
+    free(unex);
+    goto fail;
+  }
+  return ncclSuccess;
+fail:
+  free(data);
+  return ret;
+}
+
+// A truncated message is discarded, like when it is read from the socket, so
+// that the next receive from the peer is not affected
+static ncclResult_t unexpectedMsgDequeue(struct bootstrapState* state, int peer, int tag, void* data, int size, int* found) {
+  ncclResult_t ret = ncclSuccess;
+  pthread_mutex_lock(&state->unexpectedMessagesLock);
+  struct unexConn* elem = unexpectedPop(&state->unexpectedMessages, peer, tag);
+  pthread_mutex_unlock(&state->unexpectedMessagesLock);
+  *found = 0;
+  if (elem == NULL) return ncclSuccess;
+
+  if (elem->size > size) {
+    WARN("Message truncated : received %d bytes instead of %d", elem->size, size);
+    ret = ncclInternalError;
+  } else {
+    memcpy(data, elem->data, elem->size);
+    *found = 1;
   }
+  free(elem->data);
+  free(elem);
+  return ret;
+}
+
+static void unexpectedFree(struct unexTable* table, bool closeSockets) {
+  for (int b=0; b<table->nBuckets; b++) {
+    struct unexConn* elem = table->buckets[b].head;
+    while (elem) {
+      struct unexConn* next = elem->next;
+      if (closeSockets) (void)ncclSocketClose(&elem->sock);
+      free(elem->data);
+      free(elem);
+      elem = next;
+    }
+  }
+  free(table->buckets);
+  memset(table, 0, sizeof(struct unexTable));
   return;
 }
 
-// We can't know who we'll receive from, so we need to receive everything at once
-ncclResult_t bootstrapRecv(void* commState, int peer, int tag, void* data, int size) {
+// Return the connection from peer with the given tag, once its (peer, tag)
+// header has been consumed. Connections are accepted by one thread at a time,
+// so that one of them can't take the connection another one is waiting for.
+static ncclResult_t bootstrapAcceptFrom(struct bootstrapState* state, int peer, int tag, struct ncclSocket* sock) {
   ncclResult_t ret = ncclSuccess;
-  struct bootstrapState* state = (struct bootstrapState*)commState;
-  struct ncclSocket sock;
   int newPeer, newTag;
+  int found;
 
+  pthread_mutex_lock(&state->unexpectedConnectionsLock);
   // Search unexpected connections first
-  int found;
-  NCCLCHECK(unexpectedDequeue(state, peer, tag, &sock, &found));
-  if (found) {
-    NCCLCHECKGOTO(bootstrapNetRecv(&sock, ((char*)data), size), ret, fail);
-    goto exit;
-  }
+  NCCLCHECKGOTO(unexpectedDequeue(state, peer, tag, sock, &found), ret, exit);
+  if (found) goto exit;
 
   // Then look for new connections
   while (1) {
-    NCCLCHECKGOTO(ncclSocketInit(&sock), ret, fail);
-    NCCLCHECKGOTO(ncclSocketAccept(&sock, &state->listenSock), ret, fail);
-    NCCLCHECKGOTO(bootstrapNetRecv(&sock, &newPeer, sizeof(int)), ret, fail);
-    NCCLCHECKGOTO(bootstrapNetRecv(&sock, &newTag, sizeof(int)), ret, fail);
-    if (newPeer == peer && newTag == tag) {
-      NCCLCHECKGOTO(bootstrapNetRecv(&sock, ((char*)data), size), ret, fail);
-      goto exit;
-    }
+    NCCLCHECKGOTO(ncclSocketInit(sock), ret, fail);
+    NCCLCHECKGOTO(ncclSocketAccept(sock, &state->listenSock), ret, fail);
+    NCCLCHECKGOTO(bootstrapNetRecv(sock, &newPeer, sizeof(int)), ret, fail);
+    NCCLCHECKGOTO(bootstrapNetRecv(sock, &newTag, sizeof(int)), ret, fail);
+    if (newPeer == peer && newTag == tag) goto exit;
     // Unexpected connection. Save for later.
-    NCCLCHECKGOTO(unexpectedEnqueue(state, newPeer, newTag, &sock), ret, fail);
+    NCCLCHECKGOTO(unexpectedEnqueue(state, newPeer, newTag, sock), ret, fail);
   }
 exit:
-  NCCLCHECK(ncclSocketClose(&sock));
+  pthread_mutex_unlock(&state->unexpectedConnectionsLock);
   return ret;
 fail:
+  (void)ncclSocketClose(sock);
   goto exit;
 }
 
+// Messages from a peer arrive in order on its persistent connection, so
+// messages for other tags read on the way are buffered until received
+ncclResult_t bootstrapRecv(void* commState, int peer, int tag, void* data, int size) {
+  ncclResult_t ret = ncclSuccess;
+  struct bootstrapState* state = (struct bootstrapState*)commState;
+  struct bootstrapMsgHdr hdr;
+  struct ncclSocket* sock;
+  char* buf;
+  int found;
+
+  pthread_mutex_lock(state->p2pRecvLocks+peer);
+  // Search buffered messages first
+  NCCLCHECKGOTO(unexpectedMsgDequeue(state, peer, tag, data, size, &found), ret, exit);
+  if (found) goto exit;
+
+  NCCLCHECKGOTO(bootstrapPeerRecvSocket(state, state->p2pRecvSockets, BOOTSTRAP_TAG_P2P, peer, &sock), ret, exit);
+  while (1) {
+    NCCLCHECKGOTO(ncclSocketRecv(sock, &hdr, sizeof(hdr)), ret, exit);
+    __atomic_fetch_add(&state->recvMsgs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&state->recvBytes, hdr.size, __ATOMIC_RELAXED);
+    if (hdr.tag == tag && hdr.size <= size) {
+      NCCLCHECKGOTO(ncclSocketRecv(sock, data, hdr.size), ret, exit);
+      goto exit;
+    }
+
+    // Read the payload even if it is not kept, so that the stream stays in
+    // sync with the message boundaries
+    buf = NULL;
+    if (hdr.size > 0) NCCLCHECKGOTO(ncclCalloc(&buf, hdr.size), ret, exit);
+    if (ncclSocketRecv(sock, buf, hdr.size) != ncclSuccess) {
+      free(buf);
+      ret = ncclRemoteError;
+      goto exit;
+    }
+    if (hdr.tag == tag) {
+      WARN("Message truncated : received %d bytes instead of %d", hdr.size, size);
+      free(buf);
+      ret = ncclInternalError;
+      goto exit;
+    }
+    // Unexpected message. Save for later.
+    NCCLCHECKGOTO(unexpectedMsgEnqueue(state, peer, hdr.tag, buf, hdr.size), ret, exit);
+  }
+
+exit:
+  pthread_mutex_unlock(state->p2pRecvLocks+peer);
+  return ret;
+}
+
 ncclResult_t bootstrapClose(void* commState) {
   struct bootstrapState* state = (struct bootstrapState*)commState;
-  if (state->unexpectedConnections != NULL) {
-    unexpectedFree(state);
+  int nUnexpected = state->unexpectedConnections.count;
+  int nUnexpectedMsgs = state->unexpectedMessages.count;
+  unexpectedFree(&state->unexpectedConnections, true);
+  unexpectedFree(&state->unexpectedMessages, false);
+  if (nUnexpected > 0 || nUnexpectedMsgs > 0) {
     if (*state->abortFlag == 0) {
-      WARN("Unexpected connections are not empty");
+      WARN("Unexpected connections are not empty (%d connections, %d messages)", nUnexpected, nUnexpectedMsgs);
       return ncclInternalError;
     }
   }
 
+  INFO(NCCL_INIT, "Bootstrap : rank %d nranks %d opened %d and accepted %d persistent connections, sent %lu messages (%lu bytes), received %lu messages (%lu bytes)",
+      state->rank, state->nranks, state->nConnects, state->nAccepts, state->sendMsgs, state->sendBytes, state->recvMsgs, state->recvBytes);
+
   NCCLCHECK(ncclSocketClose(&state->listenSock));
   NCCLCHECK(ncclSocketClose(&state->ringSendSocket));
   NCCLCHECK(ncclSocketClose(&state->ringRecvSocket));
+  NCCLCHECK(bootstrapPeerClose(state));
 
   free(state->peerCommAddresses);
+  bootstrapLocksFree(state);
   free(state);
 
   return ncclSuccess;
@@ -585,8 +1061,12 @@ ncclResult_t bootstrapAbort(void* commState) {
   NCCLCHECK(ncclSocketClose(&state->listenSock));
   NCCLCHECK(ncclSocketClose(&state->ringSendSocket));
   NCCLCHECK(ncclSocketClose(&state->ringRecvSocket));
+  NCCLCHECK(bootstrapPeerClose(state));
+  unexpectedFree(&state->unexpectedConnections, true);
+  unexpectedFree(&state->unexpectedMessages, false);
   free(state->peerCommAddresses);
   free(state->peerProxyAddresses);
+  bootstrapLocksFree(state);
   free(state);
   return ncclSuccess;
 }
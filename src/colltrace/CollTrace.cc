@@ -1,7 +1,10 @@
 // (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
 
 #include "CollTrace.h"
+#include "CollTraceFile.h"
 #include "FbInternal.h"
+#include "ProxyTrace.h"
+#include "TraceTimeline.h"
 #include "bootstrap.h"
 #include "comm.h"
 #include "nccl.h"
@@ -33,6 +36,11 @@
      file    - dump traced events to file at communicator destory. Also see
             NCCL_COLLTRACE_DIR.
      online_tuning - enable online tuning
+     timeline - write the timeline of the collectives, and of their proxy
+            steps with NCCL_PROXYTRACE=timeline, to NCCL_COLLTRACE_DIR at
+            communicator destroy in the Chrome trace event format. Can be
+            opened in Perfetto, and merged across ranks by
+            colltrace/tools/TimelineMerge.
      (Other FB internal featuers are not listed)
 
  - name        : NCCL_COLLTRACE_DIR
@@ -42,6 +50,74 @@
      Directory for CollTrace to dump.
      Can be either local or FB internal remote URL.
 
+ - name        : NCCL_COLLTRACE_RECORD_MAX
+   type        : int64_t
+   default     : 20000
+   description : |-
+     Max number of completed collectives kept by CollTrace per communicator.
+     Older ones are dropped and only counted. Set to a negative value for no
+     limit.
+
+ - name        : NCCL_COLLTRACE_RECORD_MAX_BYTES
+   type        : int64_t
+   default     : 16777216
+   description : |-
+     Max memory in bytes used by the completed collectives kept by CollTrace
+     per communicator, in addition to NCCL_COLLTRACE_RECORD_MAX. Set to a
+     negative value for no limit.
+
+ - name        : NCCL_COLLTRACE_FILE_FORMAT
+   type        : enum
+   default     : json
+   choices     : json, binary
+   description : |-
+     Format of the file dumped by the CollTrace "file" feature.
+     json   - write the kept collectives as a json file at communicator
+              destroy
+     binary - append every completed collective to a binary file mapped in
+              memory while running, decoded by colltrace/tools/CollTraceDecode.
+              Only local NCCL_COLLTRACE_DIR are supported.
+
+ - name        : NCCL_COLLTRACE_BINARY_RECORDS
+   type        : int64_t
+   default     : 1048576
+   description : |-
+     Number of collectives kept in the binary CollTrace file of each
+     communicator. Older ones are overwritten. Each one takes 80 bytes.
+
+ - name        : NCCL_COLLTRACE_SAMPLING
+   type        : enum
+   default     : none
+   choices     : none, fixed, adaptive
+   description : |-
+     Trace only a sample of the collectives with cuda events, to bound the
+     CollTrace overhead under high collective rates. The other collectives
+     are only counted by type and size bucket on the host (CT_counters in
+     ncclCommDump), and are missing from the past collectives, latency
+     metrics and "file" feature.
+     none     - trace every collective
+     fixed    - trace the collectives whose opCount is a multiple of
+                NCCL_COLLTRACE_SAMPLE_INTERVAL, the same ones on all ranks
+     adaptive - trace at most NCCL_COLLTRACE_SAMPLE_RATE collectives per
+                second of each type and size bucket, so that rare
+                collectives are always traced. Ranks may trace different
+                collectives. Falls back to fixed with online_tuning, which
+                needs all ranks to trace the same collectives.
+
+ - name        : NCCL_COLLTRACE_SAMPLE_INTERVAL
+   type        : int64_t
+   default     : 100
+   description : |-
+     Trace one collective out of NCCL_COLLTRACE_SAMPLE_INTERVAL with
+     NCCL_COLLTRACE_SAMPLING=fixed.
+
+ - name        : NCCL_COLLTRACE_SAMPLE_RATE
+   type        : int64_t
+   default     : 100
+   description : |-
+     Max number of collectives traced per second for each collective type and
+     size bucket with NCCL_COLLTRACE_SAMPLING=adaptive.
+
 === END_NCCL_CVAR_INFO_BLOCK ===
 */
 
@@ -60,7 +136,61 @@ static std::unordered_map<ncclPattern_t, std::string> ncclPatternStr = {
     {ncclPatternSend, "Send"},
     {ncclPatternRecv, "Recv"}};
 
-CollTrace::CollTrace(ncclComm* comm) : comm_(comm) {
+std::string collTracePatternStr(ncclPattern_t pattern) {
+  auto it = ncclPatternStr.find(pattern);
+  return it != ncclPatternStr.end() ? it->second : "N/A";
+}
+
+CollTraceRecord::CollTraceRecord(const CollTraceColl& c)
+    : opCount(c.opCount),
+      iteration(c.iteration),
+      stream(c.stream),
+      opName(c.info.opName),
+      sendbuff(c.info.sendbuff),
+      recvbuff(c.info.recvbuff),
+      count(c.info.count),
+      latency(c.latency),
+      startTs(c.startTs),
+      root(c.info.root),
+      op(c.info.op),
+      channelId(c.info.channelId),
+      nChannels(c.info.nChannels),
+      nThreads(c.info.nThreads),
+      coll(c.info.coll),
+      datatype(c.info.datatype),
+      algorithm(c.info.algorithm),
+      protocol(c.info.protocol),
+      pattern(c.info.pattern) {}
+
+CollTraceColl CollTraceRecord::toColl(ncclComm* comm) const {
+  CollTraceColl c{};
+  c.opCount = opCount;
+  c.iteration = iteration;
+  c.stream = stream;
+  c.latency = latency;
+  c.startTs = startTs;
+  c.info.comm = comm;
+  c.info.stream = stream;
+  c.info.opName = opName;
+  c.info.sendbuff = sendbuff;
+  c.info.recvbuff = recvbuff;
+  c.info.count = count;
+  c.info.root = root;
+  c.info.op = static_cast<ncclRedOp_t>(op);
+  c.info.channelId = channelId;
+  c.info.nChannels = nChannels;
+  c.info.nThreads = nThreads;
+  c.info.coll = static_cast<ncclFunc_t>(coll);
+  c.info.datatype = static_cast<ncclDataType_t>(datatype);
+  c.info.algorithm = algorithm;
+  c.info.protocol = protocol;
+  c.info.pattern = static_cast<ncclPattern_t>(pattern);
+  return c;
+}
+
+CollTrace::CollTrace(ncclComm* comm)
+    : pastColls_(NCCL_COLLTRACE_RECORD_MAX, NCCL_COLLTRACE_RECORD_MAX_BYTES),
+      comm_(comm) {
   std::vector<std::string> enabledFeatures;
   if (!NCCL_COLLTRACE.empty()) {
     for (auto& f : NCCL_COLLTRACE) {
@@ -79,6 +209,54 @@ CollTrace::CollTrace(ncclComm* comm) : comm_(comm) {
       } else if (f == "trace") {
         features |= CollTrace::Features::TRACE;
         enabledFeatures.push_back(f);
+      } else if (f == "timeline") {
+        features |= CollTrace::Features::TIMELINE;
+        enabledFeatures.push_back(f);
+      }
+    }
+  }
+
+  sampleCounters_ = std::unique_ptr<SampleCounter[]>(
+      new SampleCounter[ncclNumFuncs * kNumSizeBuckets]);
+  if (NCCL_COLLTRACE_SAMPLING == NCCL_COLLTRACE_SAMPLING::adaptive) {
+    if (features & CollTrace::Features::ONLINE_TUNING) {
+      // Online tuning all-gathers the latency of every traced collective
+      WARN(
+          "COLLTRACE: adaptive sampling is not supported with online_tuning, fall back to fixed sampling");
+    } else if (NCCL_COLLTRACE_SAMPLE_RATE > 0) {
+      adaptiveSampling_ = true;
+      samplePeriod_ =
+          std::chrono::nanoseconds(1000000000L / NCCL_COLLTRACE_SAMPLE_RATE);
+      enabledFeatures.push_back(
+          "sampling_adaptive_" + std::to_string(NCCL_COLLTRACE_SAMPLE_RATE));
+    }
+  }
+  if (NCCL_COLLTRACE_SAMPLING != NCCL_COLLTRACE_SAMPLING::none &&
+      !adaptiveSampling_) {
+    enabledFeatures.push_back(
+        "sampling_fixed_" + std::to_string(NCCL_COLLTRACE_SAMPLE_INTERVAL));
+  }
+
+  if (features & CollTrace::Features::FILE &&
+      NCCL_COLLTRACE_FILE_FORMAT == NCCL_COLLTRACE_FILE_FORMAT::binary &&
+      !NCCL_COLLTRACE_DIR.empty()) {
+    const std::string fileName = NCCL_COLLTRACE_DIR + "/comm" +
+        hashToHexStr(comm->commHash) + "_rank" + std::to_string(comm->rank) +
+        ".nccltrace";
+    if (ncclIsFbPath(fileName)) {
+      WARN(
+          "COLLTRACE: binary format is not supported for %s, fall back to json",
+          fileName.c_str());
+    } else if (NCCL_COLLTRACE_BINARY_RECORDS > 0) {
+      // Fall back to json if the file cannot be created. One more slot for
+      // the record being written, which readers skip.
+      traceFile_ = CollTraceFile::create(
+          fileName,
+          comm->commHash,
+          comm->rank,
+          NCCL_COLLTRACE_BINARY_RECORDS + 1);
+      if (traceFile_) {
+        enabledFeatures.push_back("binary");
       }
     }
   }
@@ -110,6 +288,10 @@ CollTrace::~CollTrace() {
     if (profilingWorkerThread_.joinable()) {
       profilingWorkerThread_.join();
     }
+    if (NcclMetrics::enabled()) {
+      NcclMetrics::getInstance().removeMetrics(
+          "nccl_coll_", {{"comm", hashToHexStr(comm_->commHash)}});
+    }
 
     INFO(
         NCCL_INIT,
@@ -140,12 +322,21 @@ bool CollTrace::dumpResultsToFile() {
     // running
     std::lock_guard<std::mutex> lock(workerMutex_);
 
-    std::vector<std::string> serializedResults(pastColls_.size());
-
-    for (int i = 0; i < pastColls_.size(); i++) {
-      auto& result = pastColls_[i];
-      serializedResults[i] = result->serialize(true);
+    if (traceFile_) {
+      INFO(
+          NCCL_ALL,
+          "COLLTRACE: rank %d syncing binary profiler data to : %s",
+          comm_->rank,
+          traceFile_->path().c_str());
+      traceFile_->sync();
+      return true;
     }
+
+    std::vector<std::string> serializedResults;
+    serializedResults.reserve(pastColls_.size());
+    pastColls_.forEach([&](const CollTraceRecord& record) {
+      serializedResults.push_back(record.toColl(comm_).serialize(true));
+    });
     std::string contents = serializeVec(serializedResults);
 
     const std::string fileName = NCCL_COLLTRACE_DIR + "/comm" +
@@ -170,7 +361,7 @@ bool CollTrace::dumpResultsToFile() {
   return false;
 }
 
-CollTrace::Dump CollTrace::dump() {
+CollTrace::Dump CollTrace::dump(uint64_t pastCollsSince) {
   std::lock_guard<std::mutex> lock(workerMutex_);
   CollTrace::Dump dump{};
 
@@ -182,13 +373,111 @@ CollTrace::Dump CollTrace::dump() {
 
   dump.pendingColls = eventQueue_.dumpQueue();
 
-  for (auto& result : pastColls_) {
-    // copy contents
-    dump.pastColls.emplace_back(*result);
+  pastColls_.forEachSince(pastCollsSince, [&](const CollTraceRecord& record) {
+    dump.pastColls.emplace_back(record.toColl(comm_));
+  });
+  dump.pastCollsStats = pastColls_.stats();
+
+  // Counters are updated by the launching thread without workerMutex_
+  for (int coll = 0; coll < ncclNumFuncs; coll++) {
+    for (int bucket = 0; bucket < kNumSizeBuckets; bucket++) {
+      auto& counter = sampleCounters_[coll * kNumSizeBuckets + bucket];
+      uint64_t nColls = counter.nColls.load(std::memory_order_relaxed);
+      if (nColls == 0) {
+        continue;
+      }
+      CollTraceCounter c;
+      c.coll = static_cast<ncclFunc_t>(coll);
+      c.sizeBucket = bucket ? 1UL << (bucket - 1) : 0;
+      c.nColls = nColls;
+      c.nSampled = counter.nSampled.load(std::memory_order_relaxed);
+      c.nBytes = counter.nBytes.load(std::memory_order_relaxed);
+      dump.counters.push_back(c);
+    }
   }
   return dump;
 }
 
+bool CollTrace::dumpTimelineToFile() {
+  if (!(features & CollTrace::Features::TIMELINE) ||
+      NCCL_COLLTRACE_DIR.empty()) {
+    return false;
+  }
+
+  TraceTimeline timeline(comm_->commHash, comm_->rank, comm_->nRanks);
+  {
+    std::lock_guard<std::mutex> lock(workerMutex_);
+    pastColls_.forEach([&](const CollTraceRecord& record) {
+      if (record.startTs == 0 || record.latency < 0) {
+        return;
+      }
+      TimelineCollSpan span;
+      span.opCount = record.opCount;
+      span.opName = record.opName ? record.opName : "N/A";
+      span.startTs = record.startTs;
+      span.durationNs = static_cast<int64_t>(record.latency * 1e6);
+      span.nBytes = record.count *
+          ncclTypeSize(static_cast<ncclDataType_t>(record.datatype));
+      span.algorithm =
+          record.algorithm >= 0 ? ncclAlgoStr[record.algorithm] : "N/A";
+      span.protocol =
+          record.protocol >= 0 ? ncclProtoStr[record.protocol] : "N/A";
+      span.nChannels = record.nChannels;
+      timeline.addColl(span);
+    });
+  }
+  if (comm_->proxyState != nullptr && comm_->proxyState->trace) {
+    for (auto& event : comm_->proxyState->trace->timeline(comm_->commHash)) {
+      timeline.addStep(event);
+    }
+  }
+  std::string contents = timeline.toJson();
+
+  const std::string fileName = NCCL_COLLTRACE_DIR + "/comm" +
+      hashToHexStr(comm_->commHash) + "_rank" + std::to_string(comm_->rank) +
+      ".trace.json";
+  INFO(
+      NCCL_ALL,
+      "COLLTRACE: rank %d writing timeline to : %s",
+      comm_->rank,
+      fileName.c_str());
+
+  if (ncclIsFbPath(fileName)) {
+    ncclFbUpload(contents, fileName);
+  } else {
+    std::ofstream f(fileName);
+    f << contents;
+    f.close();
+  }
+  return true;
+}
+
+void CollTrace::updateClockRef() {
+  // The event completes between the two host times
+  auto before = std::chrono::high_resolution_clock::now();
+  CUDACHECKIGNORE(cudaEventRecord(refEvent_.get(), refStream_));
+  CUDACHECKIGNORE(cudaEventSynchronize(refEvent_.get()));
+  auto after = std::chrono::high_resolution_clock::now();
+  refTs_ = before + (after - before) / 2;
+}
+
+int64_t CollTrace::eventTs(cudaEvent_t event) {
+  // cudaEventElapsedTime returns float milliseconds, keep the reference
+  // recent enough for microsecond precision
+  if (std::chrono::high_resolution_clock::now() - refTs_ >
+      std::chrono::seconds(10)) {
+    updateClockRef();
+  }
+  float ms = 0;
+  if (cudaEventElapsedTime(&ms, refEvent_.get(), event) != cudaSuccess) {
+    return 0;
+  }
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             refTs_.time_since_epoch())
+             .count() +
+      static_cast<int64_t>(ms * 1e6);
+}
+
 void* CollTrace::collTraceThreadFn(CollTrace* ct) {
   return ct->collTraceThreadFnImpl();
 }
@@ -196,6 +485,13 @@ void* CollTrace::collTraceThreadFn(CollTrace* ct) {
 void* CollTrace::collTraceThreadFnImpl() {
   CUDACHECKTHROW(cudaSetDevice(comm_->cudaDev));
 
+  if (features & CollTrace::Features::TIMELINE) {
+    CUDACHECKTHROW(
+        cudaStreamCreateWithFlags(&refStream_, cudaStreamNonBlocking));
+    refEvent_ = cudaEventPool_.takeOne();
+    updateClockRef();
+  }
+
   INFO(
       NCCL_INIT,
       "COLLTRACE: comm %p commHash %lx rank %d - worker thread STARTED",
@@ -246,22 +542,31 @@ void* CollTrace::collTraceThreadFnImpl() {
     {
       // Bracket to ensure result not getting accessed after it is moved.
       // Also for release lock_guard.
-      auto result = std::unique_ptr<CollTraceColl>(new CollTraceColl());
-      *result = curEvent_->coll;
-      result->latency = (res == cudaSuccess) ? latency : -1;
+      CollTraceColl result = curEvent_->coll;
+      result.latency = (res == cudaSuccess) ? latency : -1;
+      if (features & CollTrace::Features::TIMELINE && res == cudaSuccess) {
+        result.startTs = eventTs(curEvent_->start.get());
+      }
 
       if (features & CollTrace::Features::VERBOSE) {
-        INFO(NCCL_COLL, "COLLTRACE: %s", result->toString().c_str());
+        INFO(NCCL_COLL, "COLLTRACE: %s", result.toString().c_str());
       }
 
       // FIXME: cannot record protocol for sendrecvs since a grouped sendrecv
       // may contain multiple protocols
       if (features & CollTrace::Features::FB_IO_DURING_RUN) {
-        logCollSample(*result);
+        logCollSample(result);
+      }
+
+      if (NcclMetrics::enabled()) {
+        publishMetrics(result);
       }
 
       std::lock_guard<std::mutex> lock(workerMutex_);
-      pastColls_.push_back(std::move(result));
+      pastColls_.push(CollTraceRecord(result));
+      if (traceFile_) {
+        traceFile_->append(result);
+      }
     }
 
     // Free the event objects
@@ -302,6 +607,10 @@ void* CollTrace::collTraceThreadFnImpl() {
   }
 
   dumpResultsToFile();
+  dumpTimelineToFile();
+  if (refStream_ != nullptr) {
+    CUDACHECKIGNORE(cudaStreamDestroy(refStream_));
+  }
 
   INFO(
       NCCL_INIT,
@@ -312,6 +621,49 @@ void* CollTrace::collTraceThreadFnImpl() {
   return nullptr;
 }
 
+// Index of the power-of-two size bucket of nBytes, 0 for empty collectives
+// and log2(ncclMetricsSizeBucket(nBytes)) + 1 otherwise
+static inline int sizeBucketIndex(uint64_t nBytes) {
+  if (nBytes <= 1) {
+    return nBytes;
+  }
+  return 65 - __builtin_clzl(nBytes - 1);
+}
+
+// Increment an atomic counter only written by one thread, avoiding the cost
+// of an atomic read-modify-write
+static inline void addSingleWriter(std::atomic<uint64_t>& counter, uint64_t n) {
+  counter.store(
+      counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+bool CollTrace::sample(uint64_t opCount, ncclFunc_t coll, uint64_t nBytes) {
+  if (coll < 0 || coll >= ncclNumFuncs) {
+    return true;
+  }
+  auto& counter =
+      sampleCounters_[coll * kNumSizeBuckets + sizeBucketIndex(nBytes)];
+  addSingleWriter(counter.nColls, 1);
+  addSingleWriter(counter.nBytes, nBytes);
+
+  bool sampled = true;
+  if (adaptiveSampling_) {
+    auto now = std::chrono::steady_clock::now();
+    sampled = now >= counter.nextSample;
+    if (sampled) {
+      counter.nextSample = now + samplePeriod_;
+    }
+  } else if (
+      NCCL_COLLTRACE_SAMPLING != NCCL_COLLTRACE_SAMPLING::none &&
+      NCCL_COLLTRACE_SAMPLE_INTERVAL > 1) {
+    sampled = opCount % NCCL_COLLTRACE_SAMPLE_INTERVAL == 0;
+  }
+  if (sampled) {
+    addSingleWriter(counter.nSampled, 1);
+  }
+  return sampled;
+}
+
 std::unique_ptr<CollTraceEvent> CollTrace::createEvent() {
   std::unique_ptr<CollTraceEvent> eventInfo(new CollTraceEvent);
   eventInfo->start = cudaEventPool_.takeOne();
@@ -361,6 +713,41 @@ bool CollTrace::logCollSample(CollTraceColl& coll) {
   return true;
 }
 
+void CollTrace::publishMetrics(const CollTraceColl& coll) {
+  if (coll.latency < 0) {
+    return;
+  }
+  uint64_t nBytes = coll.info.count * ncclTypeSize(coll.info.datatype);
+  uint64_t sizeBucket = ncclMetricsSizeBucket(nBytes);
+  uint64_t key = (static_cast<uint64_t>(coll.info.coll) << 24) |
+      (static_cast<uint64_t>(coll.info.algorithm & 0xff) << 16) |
+      (static_cast<uint64_t>(coll.info.protocol & 0xff) << 8) |
+      (sizeBucket ? 64 - __builtin_clzl(sizeBucket) : 0);
+
+  auto it = collMetrics_.find(key);
+  if (it == collMetrics_.end()) {
+    NcclMetricLabels labels = {
+        {"comm", hashToHexStr(comm_->commHash)},
+        {"rank", std::to_string(comm_->rank)},
+        {"coll", coll.info.opName ? coll.info.opName : "N/A"},
+        {"algo",
+         coll.info.algorithm >= 0 ? ncclAlgoStr[coll.info.algorithm] : "N/A"},
+        {"proto",
+         coll.info.protocol >= 0 ? ncclProtoStr[coll.info.protocol] : "N/A"},
+        {"bytes", std::to_string(sizeBucket)}};
+    auto& metrics = NcclMetrics::getInstance();
+    it = collMetrics_
+             .emplace(
+                 key,
+                 CollMetrics{
+                     metrics.histogram("nccl_coll_latency_ns", labels),
+                     metrics.counter("nccl_coll_bytes_total", labels)})
+             .first;
+  }
+  it->second.latencyNs->record(static_cast<uint64_t>(coll.latency * 1e6));
+  it->second.bytes->add(nBytes);
+}
+
 static std::vector<std::string> collKeys = {
     "opCount",
     "opName",
@@ -385,8 +772,7 @@ std::unordered_map<std::string, std::string> CollTraceColl::retrieveMap(
       info.algorithm >= 0 ? ncclAlgoStr[info.algorithm] : "N/A";
   std::string protoStr =
       info.protocol >= 0 ? ncclProtoStr[info.protocol] : "N/A";
-  std::string patternStr =
-      ncclPatternStr.count(info.pattern) ? ncclPatternStr[info.pattern] : "N/A";
+  std::string patternStr = collTracePatternStr(info.pattern);
   std::string datatypeStr = getDatatypeStr(info.datatype);
   std::string redOpStr = getRedOpStr(info.op);
 
@@ -410,6 +796,24 @@ std::unordered_map<std::string, std::string> CollTraceColl::retrieveMap(
   return infoMap;
 }
 
+std::string CollTraceCounter::serialize(bool quoted) {
+  std::vector<std::string> keys = {
+      "opName", "sizeBucket", "nColls", "nSampled", "nBytes"};
+  std::unordered_map<std::string, std::string> map;
+  // ncclFuncStr does not name p2p, use the names of
+  // COLLTRACE_RECORD_END_EVENT
+  std::string opName = coll < NCCL_NUM_FUNCTIONS ? ncclFuncStr[coll]
+      : coll == ncclFuncSendRecv                 ? "SendRecv"
+      : coll == ncclFuncSend                     ? "Send"
+                                                 : "Recv";
+  map["opName"] = quoted ? toQuotedString(opName) : opName;
+  map["sizeBucket"] = std::to_string(sizeBucket);
+  map["nColls"] = std::to_string(nColls);
+  map["nSampled"] = std::to_string(nSampled);
+  map["nBytes"] = std::to_string(nBytes);
+  return serializeMap(keys, map, quoted);
+}
+
 std::string CollTraceColl::serialize(bool quoted) {
   std::unordered_map<std::string, std::string> infoMap = retrieveMap(quoted);
   return serializeMap(collKeys, infoMap, quoted);
@@ -4,6 +4,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <deque>
 #include <functional>
@@ -12,7 +13,11 @@
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include "CollTraceFile.h"
+#include "TraceTimeline.h"
 #include "FbInternal.h"
+#include "NcclMetrics.h"
+#include "TraceUtils.h"
 #include "checks.h"
 #include "debug.h"
 #include "info.h"
@@ -36,6 +41,9 @@ struct CollTraceColl {
   int64_t iteration;
   cudaStream_t stream;
   float latency {-1};
+  // Start of the kernel in high_resolution_clock nanoseconds since epoch with
+  // the timeline feature, 0 if unknown
+  int64_t startTs{0};
 
   // serialize the entry to a json format string
   std::string serialize(bool quoted = false);
@@ -47,6 +55,57 @@ struct CollTraceColl {
   std::unordered_map<std::string, std::string> retrieveMap(bool quoted);
 };
 
+struct ncclComm;
+
+// Name of a pattern as reported by CollTraceColl::serialize, "N/A" if unknown
+std::string collTracePatternStr(ncclPattern_t pattern);
+
+// Compact record of a completed collective kept in the CollTrace history,
+// holding only the fields of CollTraceColl that are reported
+struct CollTraceRecord {
+  uint64_t opCount{0};
+  int64_t iteration{0};
+  cudaStream_t stream{nullptr};
+  const char* opName{nullptr};
+  const void* sendbuff{nullptr};
+  void* recvbuff{nullptr};
+  size_t count{0};
+  float latency{-1};
+  int64_t startTs{0};
+  int root{0};
+  int op{0};
+  int16_t channelId{0};
+  int16_t nChannels{0};
+  int16_t nThreads{0};
+  uint8_t coll{0};
+  uint8_t datatype{0};
+  int8_t algorithm{-1};
+  int8_t protocol{-1};
+  int8_t pattern{0};
+
+  CollTraceRecord() = default;
+  explicit CollTraceRecord(const CollTraceColl& coll);
+
+  // expand the record back to a CollTraceColl of the given communicator
+  CollTraceColl toColl(ncclComm* comm) const;
+};
+
+// Host-side counters of the collectives of a type and power-of-two size
+// bucket, kept for every collective whether or not it is sampled by
+// NCCL_COLLTRACE_SAMPLING
+struct CollTraceCounter {
+  ncclFunc_t coll{ncclFuncAllReduce};
+  // upper bound of the size in bytes, see ncclMetricsSizeBucket
+  uint64_t sizeBucket{0};
+  uint64_t nColls{0};
+  // collectives traced with cuda events
+  uint64_t nSampled{0};
+  uint64_t nBytes{0};
+
+  // serialize the counter to a json format string
+  std::string serialize(bool quoted = false);
+};
+
 // Event data structure
 struct CollTraceEvent {
   enum class EventType {
@@ -66,8 +125,6 @@ struct CollTraceEvent {
   CollTraceEvent() = default;
 };
 
-struct ncclComm;
-
 // Class for colltrace
 class CollTrace {
  public:
@@ -86,6 +143,13 @@ class CollTrace {
     std::deque<CollTraceColl> pastColls;
     std::deque<CollTraceColl> pendingColls;
     std::unique_ptr<CollTraceColl> currentColl;
+    // pastColls only holds the most recent collectives, see
+    // NCCL_COLLTRACE_RECORD_MAX. Past collectives are numbered from 0 in
+    // completion order: pastCollsStats.nRecords is the number of the next one
+    // and pastCollsStats.nDropped the number of the oldest one kept.
+    TraceHistoryStats pastCollsStats;
+    // Counters of all collectives launched, including the ones not sampled
+    std::deque<CollTraceCounter> counters;
   };
 
  private:
@@ -174,8 +238,12 @@ class CollTrace {
   // while we are trying to dump results in collDump.
   std::shared_ptr<CollTraceEvent> curEvent_;
   std::atomic<CurrentCollState> curCollState_{CurrentCollState::PENDING};
-  std::deque<std::unique_ptr<CollTraceColl>> pastColls_;
-  // Lock changes from worker thread to curEvent_, eventQueue_ and pastColls_
+  TraceHistory<CollTraceRecord> pastColls_;
+  // Binary trace of all completed collectives, if
+  // NCCL_COLLTRACE_FILE_FORMAT=binary
+  std::unique_ptr<CollTraceFile> traceFile_;
+  // Lock changes from worker thread to curEvent_, eventQueue_, pastColls_ and
+  // traceFile_
   std::mutex workerMutex_;
 
   // For testing purpose
@@ -186,7 +254,42 @@ class CollTrace {
   struct ncclComm* comm_{nullptr};
   std::thread profilingWorkerThread_;
 
+  // Metrics of completed collectives published to NcclMetrics if
+  // NCCL_METRICS_EXPORT is set, keyed by collective, algorithm, protocol and
+  // size bucket. Only used by the worker thread.
+  struct CollMetrics {
+    std::shared_ptr<NcclMetricHistogram> latencyNs;
+    std::shared_ptr<NcclMetricCounter> bytes;
+  };
+  std::unordered_map<uint64_t, CollMetrics> collMetrics_;
+
+  // Counters of the launched collectives by type and size bucket index, see
+  // sample(). Only written by the thread launching the collectives of the
+  // communicator, and read by dump() from any thread.
+  static constexpr int kNumSizeBuckets = 65;
+  struct SampleCounter {
+    std::atomic<uint64_t> nColls{0};
+    std::atomic<uint64_t> nSampled{0};
+    std::atomic<uint64_t> nBytes{0};
+    // adaptive sampling: launch time from which to sample the next collective
+    std::chrono::steady_clock::time_point nextSample{};
+  };
+  std::unique_ptr<SampleCounter[]> sampleCounters_;
+  // adaptive sampling: min time between two sampled collectives of a counter
+  std::chrono::nanoseconds samplePeriod_{0};
+  bool adaptiveSampling_{false};
+
+  // Timeline feature: reference event completed at host time refTs_, to
+  // convert the time of cuda events to host time
+  CudaEventPtr refEvent_;
+  cudaStream_t refStream_{nullptr};
+  std::chrono::high_resolution_clock::time_point refTs_{};
+
+  void updateClockRef();
+  int64_t eventTs(cudaEvent_t event);
+
   bool logCollSample(CollTraceColl& coll);
+  void publishMetrics(const CollTraceColl& coll);
 
  public:
   enum Features {
@@ -195,10 +298,14 @@ class CollTrace {
     FB_IO_DURING_RUN = 4,
     ONLINE_TUNING = 8,
     TRACE = 16,
+    TIMELINE = 32,
   };
   int features{0}; // bitwise OR of Features
 
-  CollTrace::Dump dump();
+  // Dump the trace. Only past collectives numbered pastCollsSince or later
+  // are copied, so that polling with the previous pastCollsStats.nRecords
+  // costs O(new collectives).
+  CollTrace::Dump dump(uint64_t pastCollsSince = 0);
 
   // Internal function called in collTraceThreadFn for worker thread to access
   // private members
@@ -206,6 +313,11 @@ class CollTrace {
   // Wrapper function called by worker thread
   static void* collTraceThreadFn(CollTrace* collTrace);
 
+  // Count a collective about to be launched and decide whether to trace it
+  // with cuda events, according to NCCL_COLLTRACE_SAMPLING. Called by the
+  // thread launching the collective, must stay cheap.
+  bool sample(uint64_t opCount, ncclFunc_t coll, uint64_t nBytes);
+
   // Create a CollTraceEvent object and assign cuda events from pool
   std::unique_ptr<CollTraceEvent> createEvent();
 
@@ -214,8 +326,14 @@ class CollTrace {
   void waitForWorkerFinishQueue();
 
   // Dump results to file. File path is specified by NCCL_COLLTRACE_DIR
+  // With the binary format, only flush the binary trace.
   // Return true if dumping is successful, otherwise false.
   bool dumpResultsToFile();
+
+  // Write the timeline of the kept collectives and of their proxy steps to
+  // NCCL_COLLTRACE_DIR, see TraceTimeline.h.
+  // Return true if dumping is successful, otherwise false.
+  bool dumpTimelineToFile();
 };
 
 ncclResult_t collTraceInit(ncclComm* comm);
@@ -240,14 +358,35 @@ ncclResult_t collTraceDestroy(ncclComm* comm);
     }                                                                         \
   } while (0)
 
+// Type and size in bytes of the collective of a kernel plan, as reported by
+// COLLTRACE_RECORD_END_EVENT
+template <typename Plan>
+static inline void collTracePlanColl(
+    const Plan* plan,
+    ncclFunc_t& coll,
+    uint64_t& nBytes) {
+  if (plan->aggInfo.count > 0) {
+    coll = plan->aggInfo.coll;
+    nBytes = plan->aggInfo.count * ncclTypeSize(plan->aggInfo.datatype);
+  } else {
+    coll = plan->nSendBytes && plan->nRecvBytes
+        ? ncclFuncSendRecv
+        : (plan->nSendBytes ? ncclFuncSend : ncclFuncRecv);
+    nBytes = plan->nSendBytes + plan->nRecvBytes;
+  }
+}
+
 #define COLLTRACE_ACQUIRE_EVENT(comm, plan)                                           \
   std::unique_ptr<CollTraceEvent> event = nullptr;                                    \
   do {                                                                                \
     if (comm->collTrace) {                                                            \
+      ncclFunc_t sampleColl;                                                          \
+      uint64_t sampleBytes;                                                           \
+      collTracePlanColl(plan, sampleColl, sampleBytes);                               \
       if (plan->aggInfo.count > 0 && (plan->nSendBytes || plan->nRecvBytes)) {        \
         WARN(                                                                         \
             "COLLTRACE: do not support grouped collective and p2p. Skip this plan."); \
-      } else {                                                                        \
+      } else if (comm->collTrace->sample(comm->opCount, sampleColl, sampleBytes)) {   \
         event = comm->collTrace->createEvent();                                       \
         if (!event) {                                                                 \
           return ncclInternalError; /*Event init failed*/                             \
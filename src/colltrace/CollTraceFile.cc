@@ -0,0 +1,165 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include "CollTraceFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include "CollTrace.h"
+#include "debug.h"
+#include "devcomm.h"
+#include "utils.h"
+
+std::unique_ptr<CollTraceFile> CollTraceFile::create(
+    const std::string& path,
+    uint64_t commHash,
+    int rank,
+    uint64_t capacity) {
+  auto file = std::unique_ptr<CollTraceFile>(new CollTraceFile());
+  file->path_ = path;
+  // Records start at a page boundary
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  size_t headerSize =
+      (sizeof(CollTraceFileHeader) + pageSize - 1) / pageSize * pageSize;
+  file->mapSize_ = headerSize + capacity * sizeof(CollTraceFileRecord);
+
+  file->fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (file->fd_ < 0) {
+    WARN("COLLTRACE: failed to create %s: %s", path.c_str(), strerror(errno));
+    return nullptr;
+  }
+  // The file is sparse, so blocks are only allocated for records written
+  if (ftruncate(file->fd_, file->mapSize_) != 0) {
+    WARN(
+        "COLLTRACE: failed to resize %s to %zu bytes: %s",
+        path.c_str(),
+        file->mapSize_,
+        strerror(errno));
+    return nullptr;
+  }
+  file->map_ = mmap(
+      nullptr, file->mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd_, 0);
+  if (file->map_ == MAP_FAILED) {
+    file->map_ = nullptr;
+    WARN("COLLTRACE: failed to map %s: %s", path.c_str(), strerror(errno));
+    return nullptr;
+  }
+
+  file->header_ = static_cast<CollTraceFileHeader*>(file->map_);
+  file->records_ = reinterpret_cast<CollTraceFileRecord*>(
+      static_cast<char*>(file->map_) + headerSize);
+  auto header = file->header_;
+  memcpy(header->magic, COLLTRACE_FILE_MAGIC, sizeof(header->magic));
+  header->version = COLLTRACE_FILE_VERSION;
+  header->headerSize = headerSize;
+  header->recordSize = sizeof(CollTraceFileRecord);
+  header->commHash = commHash;
+  header->rank = rank;
+  header->capacity = capacity;
+  header->nRecords = 0;
+  header->nStrings = 0;
+  memset(file->nameIds_, 0xff, sizeof(file->nameIds_));
+  return file;
+}
+
+CollTraceFile::~CollTraceFile() {
+  if (map_ != nullptr) {
+    sync();
+    munmap(map_, mapSize_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void CollTraceFile::sync() {
+  if (msync(map_, mapSize_, MS_SYNC) != 0) {
+    WARN("COLLTRACE: failed to sync %s: %s", path_.c_str(), strerror(errno));
+  }
+}
+
+uint16_t CollTraceFile::internString(const std::string& str) {
+  auto it = stringIds_.find(str);
+  if (it != stringIds_.end()) {
+    return it->second;
+  }
+  uint16_t id = COLLTRACE_FILE_NO_STRING;
+  if (header_->nStrings < COLLTRACE_FILE_MAX_STRINGS) {
+    id = header_->nStrings;
+    // Truncated names are still NUL terminated unless they fill the slot
+    strncpy(header_->strings[id], str.c_str(), COLLTRACE_FILE_STRING_LEN);
+    // Publish the string before any record refers to it
+    __atomic_store_n(&header_->nStrings, id + 1, __ATOMIC_RELEASE);
+  }
+  stringIds_[str] = id;
+  return id;
+}
+
+static const std::string unknownName = "N/A";
+
+std::string CollTraceFile::enumName(NameKind kind, int value) {
+  switch (kind) {
+    case DATATYPE:
+      return getDatatypeStr(static_cast<ncclDataType_t>(value));
+    case REDOP:
+      return getRedOpStr(static_cast<ncclRedOp_t>(value));
+    case ALGORITHM:
+      return value >= 0 && value < NCCL_NUM_ALGORITHMS ? ncclAlgoStr[value]
+                                                        : unknownName;
+    case PROTOCOL:
+      return value >= 0 && value < NCCL_NUM_PROTOCOLS ? ncclProtoStr[value]
+                                                       : unknownName;
+    case PATTERN:
+      return collTracePatternStr(static_cast<ncclPattern_t>(value));
+    default:
+      return unknownName;
+  }
+}
+
+uint16_t CollTraceFile::nameId(NameKind kind, int value) {
+  if (value < -1 || value > 254) {
+    return internString(enumName(kind, value));
+  }
+  uint16_t& id = nameIds_[kind][value + 1];
+  if (id == COLLTRACE_FILE_NO_STRING) {
+    id = internString(enumName(kind, value));
+  }
+  return id;
+}
+
+uint16_t CollTraceFile::opNameId(const char* opName) {
+  for (auto& it : opNameIds_) {
+    if (it.first == opName) {
+      return it.second;
+    }
+  }
+  uint16_t id = internString(opName ? opName : unknownName);
+  opNameIds_.emplace_back(opName, id);
+  return id;
+}
+
+void CollTraceFile::append(const CollTraceColl& coll) {
+  uint64_t n = header_->nRecords;
+  CollTraceFileRecord& rec = records_[n % header_->capacity];
+  rec.opCount = coll.opCount;
+  rec.iteration = coll.iteration;
+  rec.stream = reinterpret_cast<uint64_t>(coll.stream);
+  rec.sendbuff = reinterpret_cast<uint64_t>(coll.info.sendbuff);
+  rec.recvbuff = reinterpret_cast<uint64_t>(coll.info.recvbuff);
+  rec.count = coll.info.count;
+  rec.latency = coll.latency;
+  rec.root = coll.info.root;
+  rec.opName = opNameId(coll.info.opName);
+  rec.datatype = nameId(DATATYPE, coll.info.datatype);
+  rec.redOp = nameId(REDOP, coll.info.op);
+  rec.algorithm = nameId(ALGORITHM, coll.info.algorithm);
+  rec.protocol = nameId(PROTOCOL, coll.info.protocol);
+  rec.pattern = nameId(PATTERN, coll.info.pattern);
+  rec.channelId = coll.info.channelId;
+  rec.nChannels = coll.info.nChannels;
+  rec.nThreads = coll.info.nThreads;
+  rec.pad = 0;
+  // Count the record once written, so that readers of a file left by a killed
+  // process never see a partial record
+  __atomic_store_n(&header_->nRecords, n + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,228 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+#ifndef COLL_TRACE_FILE_H
+#define COLL_TRACE_FILE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Binary CollTrace file, written with NCCL_COLLTRACE_FILE_FORMAT=binary.
+//
+// The file is a header followed by a ring of fixed-size records. The writer
+// maps the file and appends one record per completed collective, wrapping
+// around once the file is full, so it always holds the most recent records
+// even if the process is killed. Names (opName, datatype, algorithm...) are
+// stored once in the string table of the header and referenced by id, so the
+// file can be decoded without NCCL (see tools/CollTraceDecode.cc).
+
+#define COLLTRACE_FILE_MAGIC "NCCLCTB"
+#define COLLTRACE_FILE_VERSION 1
+#define COLLTRACE_FILE_MAX_STRINGS 128
+#define COLLTRACE_FILE_STRING_LEN 24
+// id of names that could not be stored in the string table
+#define COLLTRACE_FILE_NO_STRING 0xffff
+
+struct CollTraceFileHeader {
+  char magic[8];
+  uint32_t version;
+  // offset of the first record
+  uint32_t headerSize;
+  uint32_t recordSize;
+  uint32_t nStrings;
+  uint64_t commHash;
+  int32_t rank;
+  int32_t pad;
+  // number of records in the ring
+  uint64_t capacity;
+  // number of records ever written; record i is at slot i % capacity. Updated
+  // after the record is written, so once the ring is full the slot of record
+  // nRecords, the oldest one, may be partially overwritten.
+  uint64_t nRecords;
+  char strings[COLLTRACE_FILE_MAX_STRINGS][COLLTRACE_FILE_STRING_LEN];
+};
+
+struct CollTraceFileRecord {
+  uint64_t opCount;
+  int64_t iteration;
+  uint64_t stream;
+  uint64_t sendbuff;
+  uint64_t recvbuff;
+  uint64_t count;
+  // in milliseconds, -1 if unknown
+  float latency;
+  int32_t root;
+  // string ids
+  uint16_t opName;
+  uint16_t datatype;
+  uint16_t redOp;
+  uint16_t algorithm;
+  uint16_t protocol;
+  uint16_t pattern;
+  int16_t channelId;
+  int16_t nChannels;
+  int16_t nThreads;
+  int16_t pad;
+};
+static_assert(sizeof(CollTraceFileRecord) == 80, "Keep records fixed-size");
+
+struct CollTraceColl;
+
+// Writer, owned by CollTrace. Not thread safe.
+class CollTraceFile {
+ public:
+  // Create the file at path with room for capacity records. Return nullptr on
+  // failure.
+  static std::unique_ptr<CollTraceFile> create(
+      const std::string& path,
+      uint64_t commHash,
+      int rank,
+      uint64_t capacity);
+  ~CollTraceFile();
+
+  void append(const CollTraceColl& coll);
+
+  // Flush the mapped file to disk
+  void sync();
+
+  const std::string& path() const {
+    return path_;
+  }
+
+ private:
+  CollTraceFile() = default;
+
+  enum NameKind { DATATYPE, REDOP, ALGORITHM, PROTOCOL, PATTERN, NUM_KINDS };
+  uint16_t internString(const std::string& str);
+  static std::string enumName(NameKind kind, int value);
+  uint16_t nameId(NameKind kind, int value);
+  uint16_t opNameId(const char* opName);
+
+  std::string path_;
+  int fd_{-1};
+  void* map_{nullptr};
+  size_t mapSize_{0};
+  CollTraceFileHeader* header_{nullptr};
+  CollTraceFileRecord* records_{nullptr};
+
+  std::unordered_map<std::string, uint16_t> stringIds_;
+  // ids of enum values in [-1, 254], to skip building names for every record
+  uint16_t nameIds_[NUM_KINDS][256];
+  // ids of opNames, which are string literals
+  std::vector<std::pair<const char*, uint16_t>> opNameIds_;
+};
+
+// Reader of a binary CollTrace file, used by the decoder and tests
+class CollTraceFileReader {
+ public:
+  // Read the file at path. Return false if it is not a valid CollTrace file.
+  bool open(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.read(reinterpret_cast<char*>(&header_), sizeof(header_)) ||
+        strncmp(header_.magic, COLLTRACE_FILE_MAGIC, sizeof(header_.magic)) ||
+        header_.version != COLLTRACE_FILE_VERSION ||
+        header_.recordSize != sizeof(CollTraceFileRecord) ||
+        header_.headerSize < sizeof(header_) || header_.capacity == 0) {
+      return false;
+    }
+
+    // Read the most recent records, oldest first. Skip the slot the writer
+    // may be overwriting once the ring is full.
+    uint64_t n = header_.nRecords < header_.capacity ? header_.nRecords
+                                                     : header_.capacity - 1;
+    records_.resize(n);
+    for (uint64_t i = 0; i < n; i++) {
+      uint64_t slot = (header_.nRecords - n + i) % header_.capacity;
+      f.seekg(header_.headerSize + slot * header_.recordSize);
+      if (!f.read(reinterpret_cast<char*>(&records_[i]), header_.recordSize)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const CollTraceFileHeader& header() const {
+    return header_;
+  }
+
+  const std::vector<CollTraceFileRecord>& records() const {
+    return records_;
+  }
+
+  std::string str(uint16_t id) const {
+    if (id >= header_.nStrings || id >= COLLTRACE_FILE_MAX_STRINGS) {
+      return "N/A";
+    }
+    return std::string(
+        header_.strings[id],
+        strnlen(header_.strings[id], COLLTRACE_FILE_STRING_LEN));
+  }
+
+  // Keys of the decoded records, the same as CollTraceColl::serialize
+  static std::vector<std::string> keys() {
+    return {
+        "opCount",
+        "opName",
+        "sendbuff",
+        "recvbuff",
+        "count",
+        "datatype",
+        "redOp",
+        "root",
+        "algorithm",
+        "protocol",
+        "pattern",
+        "channelId",
+        "nChannels",
+        "nThreads",
+        "latencyUs"};
+  }
+
+  // Values of a record in the order of keys(), with names quoted if asked
+  std::vector<std::string> values(
+      const CollTraceFileRecord& rec,
+      bool quoted) const {
+    auto name = [&](uint16_t id) {
+      return quoted ? "\"" + str(id) + "\"" : str(id);
+    };
+    return {
+        std::to_string(rec.opCount),
+        name(rec.opName),
+        std::to_string(rec.sendbuff),
+        std::to_string(rec.recvbuff),
+        std::to_string(rec.count),
+        name(rec.datatype),
+        name(rec.redOp),
+        std::to_string(rec.root),
+        name(rec.algorithm),
+        name(rec.protocol),
+        name(rec.pattern),
+        std::to_string(rec.channelId),
+        std::to_string(rec.nChannels),
+        std::to_string(rec.nThreads),
+        std::to_string(rec.latency < 0 ? -1 : rec.latency * 1000)};
+  }
+
+  // Decode a record as CollTraceColl::serialize(true) would
+  std::string toJson(const CollTraceFileRecord& rec) const {
+    auto k = keys();
+    auto v = values(rec, true);
+    std::string json = "{";
+    for (size_t i = 0; i < k.size(); i++) {
+      json += (i ? ", \"" : "\"") + k[i] + "\": " + v[i];
+    }
+    return json + "}";
+  }
+
+ private:
+  CollTraceFileHeader header_{};
+  std::vector<CollTraceFileRecord> records_;
+};
+
+#endif
@@ -0,0 +1,447 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include "HangAnalyzer.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <unordered_map>
+
+// Same values as ProxyTraceOp::OpType and ProxyOpStepStatus, which cannot be
+// included without NCCL
+enum { PROXY_OP_SEND = 0, PROXY_OP_RECV = 1 };
+enum { STEP_POSTED = 0, STEP_RECEIVED, STEP_TRANSMITTED, STEP_DONE };
+
+// Waits listed with each culprit
+static constexpr size_t kMaxReportedWaits = 8;
+// Ranks listed in each line of the text report
+static constexpr size_t kMaxListedRanks = 32;
+
+std::string HangAnalyzerWait::toString() const {
+  std::stringstream ss;
+  ss << "rank " << this->rank;
+  if (this->kind == Kind::CTRAN) {
+    ss << " ctran: " << this->nPending << " outstanding requests with "
+       << this->peer;
+    if (this->waitNotify) {
+      ss << ", waiting for notification";
+    }
+    return ss.str();
+  }
+  ss << " channel " << this->channelId << " "
+     << (this->opType == PROXY_OP_SEND ? "SEND to " : "RECV from ")
+     << this->peer << " opCount " << this->opCount << " step " << this->step
+     << "/" << this->nSteps;
+  if (this->kind == Kind::PROXY_LOCAL) {
+    ss << " (waiting for its GPU kernel)";
+  }
+  return ss.str();
+}
+
+static std::string listRanks(const std::vector<int>& ranks) {
+  std::stringstream ss;
+  for (size_t i = 0; i < ranks.size() && i < kMaxListedRanks; i++) {
+    ss << (i ? ", " : "") << ranks[i];
+  }
+  if (ranks.size() > kMaxListedRanks) {
+    ss << ", ... (" << ranks.size() - kMaxListedRanks << " more)";
+  }
+  return ss.str();
+}
+
+static std::string opCountStr(uint64_t opCount) {
+  return opCount == HANG_ANALYZER_NO_OPCOUNT ? "none"
+                                             : std::to_string(opCount);
+}
+
+std::string HangAnalyzerReport::toString(size_t maxCulprits) const {
+  std::stringstream ss;
+  ss << "commHash " << std::hex << this->commHash << std::dec << " nRanks "
+     << this->nRanks << ": ";
+  if (!this->hung) {
+    ss << "no collective or network operation in flight" << std::endl;
+  } else if (this->hungOpCount != HANG_ANALYZER_NO_OPCOUNT) {
+    ss << "oldest collective in flight is opCount " << this->hungOpCount
+       << std::endl;
+  } else {
+    ss << "network operations in flight" << std::endl;
+  }
+  if (!this->missingRanks.empty()) {
+    ss << "  no dump from " << this->missingRanks.size()
+       << " ranks: " << listRanks(this->missingRanks) << std::endl;
+  }
+  if (!this->laggingRanks.empty()) {
+    ss << "  " << this->laggingRanks.size()
+       << " ranks have not issued opCount " << this->hungOpCount << ": "
+       << listRanks(this->laggingRanks) << std::endl;
+  }
+  if (!this->hung) {
+    return ss.str();
+  }
+
+  ss << "  " << this->nWaits << " waits between ranks, "
+     << this->culprits.size() << " likely culprits" << std::endl;
+  for (size_t i = 0; i < this->culprits.size() && i < maxCulprits; i++) {
+    auto& culprit = this->culprits[i];
+    ss << "  rank " << culprit.rank << " (waited for by " << culprit.nWaiters
+       << " ranks):";
+    if (culprit.missing) {
+      ss << " no dump";
+    } else {
+      ss << (culprit.lagging ? " lagging," : "") << " last completed opCount "
+         << opCountStr(culprit.lastCompletedOpCount)
+         << ", in flight opCount " << opCountStr(culprit.inFlightOpCount);
+    }
+    ss << std::endl;
+    for (size_t j = 0; j < culprit.localOps.size() && j < kMaxReportedWaits;
+         j++) {
+      ss << "    blocked: " << culprit.localOps[j].toString() << std::endl;
+    }
+    for (auto& wait : culprit.waitedBy) {
+      ss << "    waited for by: " << wait.toString() << std::endl;
+    }
+  }
+  if (this->culprits.size() > maxCulprits) {
+    ss << "  ... " << this->culprits.size() - maxCulprits
+       << " more culprits" << std::endl;
+  }
+  for (auto& cycle : this->cycles) {
+    ss << "  " << cycle.size()
+       << " ranks waiting for each other: " << listRanks(cycle) << std::endl;
+  }
+  return ss.str();
+}
+
+bool HangAnalyzer::addDump(const std::string& buf) {
+  CommDumpBinaryReader reader;
+  if (!reader.parse(buf) || reader.header().rank < 0) {
+    return false;
+  }
+  auto& header = reader.header();
+  auto& comm = this->comms_[header.commHash];
+  comm.nRanks = std::max({comm.nRanks, header.nRanks, header.rank + 1});
+  comm.ranks.resize(comm.nRanks);
+
+  auto& state = comm.ranks[header.rank];
+  state = RankState();
+  state.present = true;
+  if (header.flags & COMM_DUMP_BINARY_COLLTRACE) {
+    comm.hasCollTrace = true;
+    state.nCompleted = header.ctPastCollsNRecords;
+    if (!reader.ctPastColls.empty()) {
+      state.lastCompletedOpCount = reader.ctPastColls.back().opCount;
+    }
+    for (auto& coll : reader.ctCurrentColl) {
+      state.inFlightOpCount = std::min(state.inFlightOpCount, coll.opCount);
+    }
+    for (auto& coll : reader.ctPendingColls) {
+      state.inFlightOpCount = std::min(state.inFlightOpCount, coll.opCount);
+    }
+  }
+  for (auto& op : reader.ptActiveOps) {
+    if (!op.done) {
+      state.activeOps.push_back(op);
+    }
+  }
+  state.ctranPeers = std::move(reader.ctranPeers);
+  return true;
+}
+
+bool HangAnalyzer::addDumpFile(const std::string& path) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) {
+    return false;
+  }
+  std::string buf(
+      (std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+  return this->addDump(buf);
+}
+
+std::vector<HangAnalyzerReport> HangAnalyzer::analyze() const {
+  std::vector<HangAnalyzerReport> reports;
+  for (auto& it : this->comms_) {
+    reports.push_back(this->analyzeComm(it.first, it.second));
+  }
+  return reports;
+}
+
+static HangAnalyzerWait proxyWait(int rank, const CommDumpProxyOpRecord& op) {
+  HangAnalyzerWait wait;
+  wait.rank = rank;
+  wait.peer = op.remoteRank;
+  wait.opCount = op.opCount;
+  wait.channelId = op.channelId;
+  wait.opType = op.opType;
+  wait.nSteps = op.nSteps;
+  if (op.opType == PROXY_OP_RECV) {
+    if (op.step[STEP_RECEIVED] < op.step[STEP_POSTED]) {
+      // buffers are posted but the data has not arrived
+      wait.kind = HangAnalyzerWait::Kind::PROXY_RECV;
+      wait.step = op.step[STEP_RECEIVED];
+    } else {
+      wait.step = op.step[STEP_DONE];
+    }
+  } else {
+    if (op.step[STEP_DONE] < op.step[STEP_TRANSMITTED]) {
+      // data is sent but the peer has not received it
+      wait.kind = HangAnalyzerWait::Kind::PROXY_SEND;
+      wait.step = op.step[STEP_DONE];
+    } else {
+      wait.step = op.step[STEP_TRANSMITTED];
+    }
+  }
+  return wait;
+}
+
+// Strongly connected components of the graph given by offsets/targets in
+// compressed rows, with an iterative Tarjan's algorithm. Return the component
+// of each node.
+static std::vector<int> stronglyConnectedComponents(
+    const std::vector<size_t>& offsets,
+    const std::vector<int>& targets,
+    int& nComps) {
+  int n = offsets.size() - 1;
+  std::vector<int> index(n, -1), low(n, 0), comp(n, -1);
+  std::vector<bool> onStack(n, false);
+  std::vector<int> stack;
+  // node and position of the next edge to visit
+  std::vector<std::pair<int, size_t>> callStack;
+  int nextIndex = 0;
+  nComps = 0;
+
+  for (int root = 0; root < n; root++) {
+    if (index[root] >= 0) {
+      continue;
+    }
+    callStack.emplace_back(root, offsets[root]);
+    index[root] = low[root] = nextIndex++;
+    stack.push_back(root);
+    onStack[root] = true;
+
+    while (!callStack.empty()) {
+      int u = callStack.back().first;
+      size_t& pos = callStack.back().second;
+      if (pos < offsets[u + 1]) {
+        int v = targets[pos++];
+        if (index[v] < 0) {
+          index[v] = low[v] = nextIndex++;
+          stack.push_back(v);
+          onStack[v] = true;
+          callStack.emplace_back(v, offsets[v]);
+        } else if (onStack[v]) {
+          low[u] = std::min(low[u], index[v]);
+        }
+        continue;
+      }
+
+      if (low[u] == index[u]) {
+        int v;
+        do {
+          v = stack.back();
+          stack.pop_back();
+          onStack[v] = false;
+          comp[v] = nComps;
+        } while (v != u);
+        nComps++;
+      }
+      callStack.pop_back();
+      if (!callStack.empty()) {
+        int parent = callStack.back().first;
+        low[parent] = std::min(low[parent], low[u]);
+      }
+    }
+  }
+  return comp;
+}
+
+HangAnalyzerReport HangAnalyzer::analyzeComm(
+    uint64_t commHash,
+    const CommState& comm) const {
+  HangAnalyzerReport report;
+  report.commHash = commHash;
+  report.nRanks = comm.nRanks;
+  int nRanks = comm.nRanks;
+
+  for (int rank = 0; rank < nRanks; rank++) {
+    auto& state = comm.ranks[rank];
+    if (!state.present) {
+      report.missingRanks.push_back(rank);
+      continue;
+    }
+    report.hungOpCount = std::min(report.hungOpCount, state.inFlightOpCount);
+    if (!state.activeOps.empty() || !state.ctranPeers.empty()) {
+      report.hung = true;
+    }
+  }
+  report.hung |= report.hungOpCount != HANG_ANALYZER_NO_OPCOUNT;
+  if (!report.hung) {
+    return report;
+  }
+
+  // Ranks idle in CollTrace that have not reached the oldest collective in
+  // flight elsewhere
+  int nStuck = 0;
+  std::vector<bool> lagging(nRanks, false);
+  if (comm.hasCollTrace && report.hungOpCount != HANG_ANALYZER_NO_OPCOUNT) {
+    for (int rank = 0; rank < nRanks; rank++) {
+      auto& state = comm.ranks[rank];
+      if (!state.present) {
+        continue;
+      }
+      if (state.inFlightOpCount == report.hungOpCount) {
+        nStuck++;
+      } else if (
+          state.inFlightOpCount == HANG_ANALYZER_NO_OPCOUNT &&
+          (state.lastCompletedOpCount != HANG_ANALYZER_NO_OPCOUNT
+               ? state.lastCompletedOpCount < report.hungOpCount
+               : state.nCompleted == 0)) {
+        lagging[rank] = true;
+        report.laggingRanks.push_back(rank);
+      }
+    }
+  }
+
+  // Wait-for graph in compressed rows: rank -> peers it waits for
+  std::vector<HangAnalyzerWait> waits;
+  std::vector<std::vector<HangAnalyzerWait>> localOps(nRanks);
+  for (int rank = 0; rank < nRanks; rank++) {
+    auto& state = comm.ranks[rank];
+    for (auto& op : state.activeOps) {
+      auto wait = proxyWait(rank, op);
+      if (wait.kind == HangAnalyzerWait::Kind::PROXY_LOCAL ||
+          wait.peer < 0 || wait.peer >= nRanks || wait.peer == rank) {
+        localOps[rank].push_back(wait);
+      } else {
+        waits.push_back(wait);
+      }
+    }
+    for (auto& peer : state.ctranPeers) {
+      if (peer.peer < 0 || peer.peer >= nRanks || peer.peer == rank) {
+        continue;
+      }
+      HangAnalyzerWait wait;
+      wait.kind = HangAnalyzerWait::Kind::CTRAN;
+      wait.rank = rank;
+      wait.peer = peer.peer;
+      wait.nPending = peer.sendCtrl + peer.recvCtrl + peer.put;
+      wait.waitNotify = peer.waitNotify;
+      waits.push_back(wait);
+    }
+  }
+  report.nWaits = waits.size();
+
+  std::vector<size_t> offsets(nRanks + 1, 0), rOffsets(nRanks + 1, 0);
+  for (auto& wait : waits) {
+    offsets[wait.rank + 1]++;
+    rOffsets[wait.peer + 1]++;
+  }
+  for (int rank = 0; rank < nRanks; rank++) {
+    offsets[rank + 1] += offsets[rank];
+    rOffsets[rank + 1] += rOffsets[rank];
+  }
+  std::vector<int> targets(waits.size()), rTargets(waits.size());
+  {
+    std::vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+    std::vector<size_t> rPos(rOffsets.begin(), rOffsets.end() - 1);
+    for (auto& wait : waits) {
+      targets[pos[wait.rank]++] = wait.peer;
+      rTargets[rPos[wait.peer]++] = wait.rank;
+    }
+  }
+
+  // Ranks waited for that wait for nobody else are culprits, as well as
+  // groups of ranks waiting for each other
+  int nComps = 0;
+  auto comp = stronglyConnectedComponents(offsets, targets, nComps);
+  std::vector<bool> compIsSink(nComps, true);
+  std::vector<std::vector<int>> compRanks(nComps);
+  for (int rank = 0; rank < nRanks; rank++) {
+    compRanks[comp[rank]].push_back(rank);
+    for (size_t e = offsets[rank]; e < offsets[rank + 1]; e++) {
+      if (comp[targets[e]] != comp[rank]) {
+        compIsSink[comp[rank]] = false;
+      }
+    }
+  }
+
+  std::vector<bool> isCulprit(nRanks, false);
+  for (int c = 0; c < nComps; c++) {
+    if (!compIsSink[c]) {
+      continue;
+    }
+    if (compRanks[c].size() > 1) {
+      report.cycles.push_back(compRanks[c]);
+      continue;
+    }
+    int rank = compRanks[c][0];
+    if (rOffsets[rank + 1] > rOffsets[rank]) {
+      isCulprit[rank] = true;
+    }
+  }
+  for (int rank = 0; rank < nRanks; rank++) {
+    if (lagging[rank] || !comm.ranks[rank].present) {
+      isCulprit[rank] = true;
+    }
+  }
+
+  // Count the ranks waiting for each culprit by walking the graph backwards
+  std::vector<int> visited(nRanks, -1);
+  std::vector<int> queue;
+  std::unordered_map<int, size_t> culpritIdx;
+  for (int rank = 0; rank < nRanks; rank++) {
+    if (!isCulprit[rank]) {
+      continue;
+    }
+    HangAnalyzerCulprit culprit;
+    culprit.rank = rank;
+    culprit.missing = !comm.ranks[rank].present;
+    culprit.lagging = lagging[rank];
+    culprit.lastCompletedOpCount = comm.ranks[rank].lastCompletedOpCount;
+    culprit.inFlightOpCount = comm.ranks[rank].inFlightOpCount;
+    culprit.localOps = std::move(localOps[rank]);
+    std::sort(
+        culprit.localOps.begin(),
+        culprit.localOps.end(),
+        [](const HangAnalyzerWait& a, const HangAnalyzerWait& b) {
+          return a.opCount != b.opCount ? a.opCount < b.opCount
+                                        : a.step < b.step;
+        });
+
+    queue.assign(1, rank);
+    visited[rank] = rank;
+    for (size_t i = 0; i < queue.size(); i++) {
+      int u = queue[i];
+      for (size_t e = rOffsets[u]; e < rOffsets[u + 1]; e++) {
+        int v = rTargets[e];
+        if (visited[v] != rank) {
+          visited[v] = rank;
+          queue.push_back(v);
+        }
+      }
+    }
+    culprit.nWaiters = queue.size() - 1;
+    // The ranks stuck in the collective a lagging rank has not issued wait
+    // for it, even without network operations in flight
+    if (culprit.lagging) {
+      culprit.nWaiters = std::max(culprit.nWaiters, nStuck);
+    }
+
+    culpritIdx[rank] = report.culprits.size();
+    report.culprits.push_back(std::move(culprit));
+  }
+  for (auto& wait : waits) {
+    auto it = culpritIdx.find(wait.peer);
+    if (it != culpritIdx.end() &&
+        report.culprits[it->second].waitedBy.size() < kMaxReportedWaits) {
+      report.culprits[it->second].waitedBy.push_back(wait);
+    }
+  }
+
+  std::stable_sort(
+      report.culprits.begin(),
+      report.culprits.end(),
+      [](const HangAnalyzerCulprit& a, const HangAnalyzerCulprit& b) {
+        return a.nWaiters > b.nWaiters;
+      });
+  return report;
+}
@@ -0,0 +1,124 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+#ifndef HANG_ANALYZER_H
+#define HANG_ANALYZER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "CommDumpBinary.h"
+
+// Offline analyzer of the binary dumps returned by ncclCommDumpBinary on
+// every rank of hung communicators (see tools/HangAnalyze.cc).
+//
+// For each communicator, it finds the oldest collective still in flight
+// according to CollTrace, the ranks that have not issued it yet, and builds
+// the cross-rank wait-for graph from the network operations of ProxyTrace and
+// the outstanding ctran operations: a rank waits for a peer if it is waiting
+// for data or a completion from it. The ranks waited for that do not wait for
+// anyone (sinks of the graph), or the cycles of ranks waiting for each other,
+// are the likely culprits. Only depends on CommDumpBinary.h, so it can be
+// built without NCCL.
+
+#define HANG_ANALYZER_NO_OPCOUNT UINT64_MAX
+
+// An operation of a rank that is not complete
+struct HangAnalyzerWait {
+  enum class Kind {
+    // network recv waiting for data from peer
+    PROXY_RECV,
+    // network send waiting for peer to receive the data
+    PROXY_SEND,
+    // network op waiting for its own GPU kernel to produce/consume data
+    PROXY_LOCAL,
+    // ctran control msg, put or notification outstanding with peer
+    CTRAN,
+  };
+
+  Kind kind{Kind::PROXY_LOCAL};
+  int rank{-1};
+  int peer{-1};
+  uint64_t opCount{HANG_ANALYZER_NO_OPCOUNT};
+  int channelId{-1};
+  // ProxyTraceOp::OpType of proxy ops
+  int opType{0};
+  // step reached by the op when it stopped progressing
+  int step{0};
+  int nSteps{0};
+  // outstanding ctran control msgs and puts with peer
+  int nPending{0};
+  // ctran is waiting for a notification from peer
+  bool waitNotify{false};
+
+  std::string toString() const;
+};
+
+struct HangAnalyzerCulprit {
+  int rank{-1};
+  // Number of ranks waiting for this one, directly or not
+  int nWaiters{0};
+  // No dump was provided for this rank
+  bool missing{false};
+  // The rank has not issued the oldest in-flight collective
+  bool lagging{false};
+  uint64_t lastCompletedOpCount{HANG_ANALYZER_NO_OPCOUNT};
+  uint64_t inFlightOpCount{HANG_ANALYZER_NO_OPCOUNT};
+  // Incomplete ops of this rank, least progressed first
+  std::vector<HangAnalyzerWait> localOps;
+  // Some of the waits of other ranks for this one
+  std::vector<HangAnalyzerWait> waitedBy;
+};
+
+struct HangAnalyzerReport {
+  uint64_t commHash{0};
+  int nRanks{0};
+  std::vector<int> missingRanks;
+  // Whether some rank has a collective or network operation in flight
+  bool hung{false};
+  // Oldest collective in flight on any rank according to CollTrace
+  uint64_t hungOpCount{HANG_ANALYZER_NO_OPCOUNT};
+  // Ranks that have not issued hungOpCount yet
+  std::vector<int> laggingRanks;
+  // Most likely culprits first
+  std::vector<HangAnalyzerCulprit> culprits;
+  // Groups of ranks waiting for each other and for nobody else
+  std::vector<std::vector<int>> cycles;
+  size_t nWaits{0};
+
+  // Human readable report, listing up to maxCulprits culprits
+  std::string toString(size_t maxCulprits = 10) const;
+};
+
+class HangAnalyzer {
+ public:
+  // Add the dump of a rank. Return false if buf is not a valid dump.
+  bool addDump(const std::string& buf);
+  bool addDumpFile(const std::string& path);
+
+  // One report per communicator, ordered by commHash
+  std::vector<HangAnalyzerReport> analyze() const;
+
+ private:
+  // What the analysis needs from the dump of a rank
+  struct RankState {
+    bool present{false};
+    uint64_t lastCompletedOpCount{HANG_ANALYZER_NO_OPCOUNT};
+    // number of collectives completed according to CollTrace
+    uint64_t nCompleted{0};
+    uint64_t inFlightOpCount{HANG_ANALYZER_NO_OPCOUNT};
+    std::vector<CommDumpProxyOpRecord> activeOps;
+    std::vector<CommDumpCtranPeerRecord> ctranPeers;
+  };
+  struct CommState {
+    int nRanks{0};
+    bool hasCollTrace{false};
+    std::vector<RankState> ranks;
+  };
+
+  HangAnalyzerReport analyzeComm(uint64_t commHash, const CommState& comm)
+      const;
+
+  std::map<uint64_t, CommState> comms_;
+};
+
+#endif
@@ -1,6 +1,7 @@
 // (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
 
 #include "ProxyTrace.h"
+#include <algorithm>
 #include <cstddef>
 #include <map>
 #include <string>
@@ -22,6 +23,47 @@
      all features.
      trace - enable trace only.
      verbose - print every proxy operation step as NCCL INFO log.
+     ring - enable trace, recorded by the proxy thread into a pre-allocated
+     ring buffer without lock and aggregated when the trace is dumped. With
+     verbose, operations are printed at dump time.
+     timeline - enable trace and keep every step status change of the network
+     operations, for the CollTrace timeline feature. Also see
+     NCCL_PROXYTRACE_TIMELINE_RECORD_MAX.
+
+ - name        : NCCL_PROXYTRACE_RING_SIZE
+   type        : int64_t
+   default     : 65536
+   description : |-
+     Number of records in the ring buffer of each proxy thread with
+     NCCL_PROXYTRACE=ring, rounded up to a power of two. Each record takes 64
+     bytes, and a proxy operation writes one record when it starts, one per
+     step status and one when it completes. Records overwritten before the
+     trace is dumped are lost, and the operations they belong to are missing
+     from the dump.
+
+ - name        : NCCL_PROXYTRACE_RECORD_MAX
+   type        : int64_t
+   default     : 20000
+   description : |-
+     Max number of completed collectives kept by ProxyTrace per communicator.
+     Older ones are dropped and only counted. Set to a negative value for no
+     limit.
+
+ - name        : NCCL_PROXYTRACE_RECORD_MAX_BYTES
+   type        : int64_t
+   default     : 4194304
+   description : |-
+     Max memory in bytes used by the completed collectives kept by ProxyTrace
+     per communicator, in addition to NCCL_PROXYTRACE_RECORD_MAX. Set to a
+     negative value for no limit.
+
+ - name        : NCCL_PROXYTRACE_TIMELINE_RECORD_MAX
+   type        : int64_t
+   default     : 1048576
+   description : |-
+     Max number of step status changes kept by ProxyTrace per communicator
+     with NCCL_PROXYTRACE=timeline. Older ones are dropped. Each one takes 32
+     bytes, and a network step of a proxy operation has 3 or 4 of them.
 
 === END_NCCL_CVAR_INFO_BLOCK ===
 */
@@ -65,9 +107,22 @@ ProxyTrace::ProxyTrace() {
     } else if (f == "trace") {
       features_ |= ProxyTrace::Features::TRACE;
       enabledFeatures.push_back(f);
+    } else if (f == "ring") {
+      features_ |=
+          ProxyTrace::Features::TRACE | ProxyTrace::Features::RING;
+      enabledFeatures.push_back(f);
+    } else if (f == "timeline") {
+      features_ |=
+          ProxyTrace::Features::TRACE | ProxyTrace::Features::TIMELINE;
+      enabledFeatures.push_back(f);
     }
   }
 
+  if (features_ & ProxyTrace::Features::RING) {
+    ring_ = std::unique_ptr<ProxyTraceRing>(new ProxyTraceRing(
+        std::max(NCCL_PROXYTRACE_RING_SIZE, static_cast<int64_t>(1))));
+  }
+
   std::string enabledFeaturesStr = vecToStr(enabledFeatures);
   INFO(
       NCCL_INIT,
@@ -96,153 +151,177 @@ inline bool ProxyTrace::checkActiveCollExist(
       activeColls_[commHash].find(opCount) != activeColls_[commHash].end());
 }
 
-inline ncclResult_t ProxyTrace::createActiveEntries(
-    struct ncclProxyArgs* args,
-    ProxyTraceOp::OpType opType) {
-  for (int subIdx = 0; subIdx < args->nsubs; subIdx++) {
-    struct ncclProxySubArgs* sub = &args->subs[subIdx];
-    auto commHash = sub->traceArgs.collInfo.commHash;
-    auto opCount = sub->traceArgs.collInfo.opCount;
-    int proxyOpId = 0;
-
-    // Create a collective entry for a given commHash:opCount at first proxyOp
-    // and aggregate info
-    // - num of belonging proxyOps
-    // - totalSendSize and totalRecvSize
-    // - unique channelIds
-    if (!checkActiveCollExist(commHash, opCount)) {
-      auto coll = std::unique_ptr<ProxyTraceColl>(new ProxyTraceColl());
-      coll->collInfo = sub->traceArgs.collInfo;
-      activeColls_[commHash][opCount] = std::move(coll);
-    }
+static inline void fillRecord(
+    ProxyTraceRecord& rec,
+    struct ncclProxySubArgs* sub,
+    ProxyTraceOp::OpType opType,
+    ProxyTraceRecord::Event event) {
+  rec.commHash = sub->traceArgs.collInfo.commHash;
+  rec.opCount = sub->traceArgs.collInfo.opCount;
+  rec.ts = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+  rec.proxyOpId = sub->traceArgs.proxyOpId;
+  rec.event = event;
+  rec.opType = opType;
+  if (event == ProxyTraceRecord::Event::START) {
+    rec.size = sub->nbytes;
+    rec.step = sub->nsteps;
+    rec.rank = sub->traceArgs.rank;
+    rec.remoteRank = sub->traceArgs.remoteRank;
+    rec.channelId = sub->channelId;
+    rec.nChannels = sub->traceArgs.collInfo.nChannels;
+    rec.coll = sub->traceArgs.collInfo.coll;
+  }
+}
 
-    // Assign proxyOpId to the sub for trace to track all ops belonging to
-    // single commHash:opCount Note that channelId is always 0 in p2p case, thus
-    // cannot use it to distinguish ops.
-    proxyOpId = activeColls_[commHash][opCount]->nProxyOps;
-    sub->traceArgs.proxyOpId = proxyOpId;
-
-    auto entry = std::unique_ptr<ProxyTraceOp>(new ProxyTraceOp());
-    entry->collInfo = sub->traceArgs.collInfo;
-    entry->nSteps = sub->nsteps;
-    entry->channelId = sub->channelId;
-    entry->proxyOpId = proxyOpId;
-    entry->rank = sub->traceArgs.rank;
-    entry->remoteRank = sub->traceArgs.remoteRank;
-    entry->stepSize = sub->nbytes;
-    entry->startTs = std::chrono::high_resolution_clock::now();
-    entry->opType = opType;
+static inline std::chrono::time_point<std::chrono::high_resolution_clock>
+recordTs(const ProxyTraceRecord& rec) {
+  return std::chrono::time_point<std::chrono::high_resolution_clock>(
+      std::chrono::high_resolution_clock::duration(rec.ts));
+}
 
-    if (features_ & ProxyTrace::Features::VERBOSE) {
-      std::string entryStr = entry->serialize(false);
-      INFO(
-          NCCL_COLL,
-          "PROXYTRACE: sub %p created entry %s",
-          sub,
-          entryStr.c_str());
-    }
-    // Append new proxyOp to a given commHash:opCount
-    activeOps_[commHash][opCount][proxyOpId] = std::move(entry);
+// Create the active entry of the op started in rec. The proxyOpId is assigned
+// here if the op does not have one yet.
+inline void ProxyTrace::createActiveEntry(ProxyTraceRecord& rec) {
+  auto commHash = rec.commHash;
+  auto opCount = rec.opCount;
+
+  // Create a collective entry for a given commHash:opCount at first proxyOp
+  // and aggregate info
+  // - num of belonging proxyOps
+  // - totalSendSize and totalRecvSize
+  // - unique channelIds
+  if (!checkActiveCollExist(commHash, opCount)) {
+    auto coll = std::unique_ptr<ProxyTraceColl>(new ProxyTraceColl());
+    coll->collInfo.commHash = commHash;
+    coll->collInfo.opCount = opCount;
+    coll->collInfo.nChannels = rec.nChannels;
+    coll->collInfo.coll = static_cast<ncclFunc_t>(rec.coll);
+    activeColls_[commHash][opCount] = std::move(coll);
+  }
 
-    // Update collective info
-    activeColls_[commHash][opCount]->channelIds.insert(sub->channelId);
-    activeColls_[commHash][opCount]->nProxyOps++;
+  // Assign proxyOpId to the sub for trace to track all ops belonging to
+  // single commHash:opCount Note that channelId is always 0 in p2p case, thus
+  // cannot use it to distinguish ops.
+  if (rec.proxyOpId < 0) {
+    rec.proxyOpId = activeColls_[commHash][opCount]->nProxyOps;
   }
-  return ncclSuccess;
+  int proxyOpId = rec.proxyOpId;
+
+  auto entry = std::unique_ptr<ProxyTraceOp>(new ProxyTraceOp());
+  entry->collInfo = activeColls_[commHash][opCount]->collInfo;
+  entry->collInfo.nChannels = rec.nChannels;
+  entry->collInfo.coll = static_cast<ncclFunc_t>(rec.coll);
+  entry->nSteps = rec.step;
+  entry->channelId = rec.channelId;
+  entry->proxyOpId = proxyOpId;
+  entry->rank = rec.rank;
+  entry->remoteRank = rec.remoteRank;
+  entry->stepSize = rec.size;
+  entry->startTs = recordTs(rec);
+  entry->opType = static_cast<ProxyTraceOp::OpType>(rec.opType);
+
+  if (features_ & ProxyTrace::Features::VERBOSE) {
+    std::string entryStr = entry->serialize(false);
+    INFO(NCCL_COLL, "PROXYTRACE: created entry %s", entryStr.c_str());
+  }
+  // Append new proxyOp to a given commHash:opCount
+  activeOps_[commHash][opCount][proxyOpId] = std::move(entry);
+
+  // Update collective info
+  activeColls_[commHash][opCount]->channelIds.insert(rec.channelId);
+  activeColls_[commHash][opCount]->nProxyOps++;
 }
 
-inline ncclResult_t ProxyTrace::completeTraceEntries(
-    struct ncclProxyArgs* args,
-    ProxyTraceOp::OpType opType) {
-  // For each completed channel, move to completed queue
-  for (int subIdx = 0; subIdx < args->nsubs; subIdx++) {
-    struct ncclProxySubArgs* sub = &args->subs[subIdx];
-    auto proxyOpId = sub->traceArgs.proxyOpId;
-    auto commHash = sub->traceArgs.collInfo.commHash;
-    auto opCount = sub->traceArgs.collInfo.opCount;
+inline ncclResult_t ProxyTrace::completeTraceEntry(
+    const ProxyTraceRecord& rec) {
+  auto proxyOpId = rec.proxyOpId;
+  auto commHash = rec.commHash;
+  auto opCount = rec.opCount;
+  auto opType = static_cast<ProxyTraceOp::OpType>(rec.opType);
 
-    if (!checkActiveOpExist(commHash, opCount, proxyOpId)) {
-      WARN(
-          "PROXYTRACE: failed to complete %s entry of commHash %s opCount %lx proxyOpId %d, because no active entry exists",
-          proxyOpTypetrMap[opType].c_str(),
-          hashToHexStr(commHash).c_str(),
-          opCount,
-          proxyOpId);
-      return ncclInternalError;
-    }
+  if (!checkActiveOpExist(commHash, opCount, proxyOpId)) {
+    WARN(
+        "PROXYTRACE: failed to complete %s entry of commHash %s opCount %lx proxyOpId %d, because no active entry exists",
+        proxyOpTypetrMap[opType].c_str(),
+        hashToHexStr(commHash).c_str(),
+        opCount,
+        proxyOpId);
+    return ncclInternalError;
+  }
 
-    auto& entry = activeOps_[commHash][opCount][proxyOpId];
-    entry->doneTs = std::chrono::high_resolution_clock::now();
-    entry->done = true;
+  auto& entry = activeOps_[commHash][opCount][proxyOpId];
+  entry->doneTs = recordTs(rec);
+  entry->done = true;
 
-    if (features_ & ProxyTrace::Features::VERBOSE) {
-      std::string entryStr = entry->serialize(false);
-      INFO(
-          NCCL_COLL,
-          "PROXYTRACE: sub %p completed entry %s",
-          sub,
-          entryStr.c_str());
-    }
+  if (features_ & ProxyTrace::Features::VERBOSE) {
+    std::string entryStr = entry->serialize(false);
+    INFO(NCCL_COLL, "PROXYTRACE: completed entry %s", entryStr.c_str());
+  }
 
-    auto& coll = activeColls_[commHash][opCount];
+  auto& coll = activeColls_[commHash][opCount];
 
-    // Update total send/recv size once an op is completed
-    if (opType == ProxyTraceOp::OpType::SEND) {
-      coll->totalSendSize += entry->transSize;
-    } else {
-      coll->totalRecvSize += entry->transSize;
+  // Update total send/recv size once an op is completed
+  if (opType == ProxyTraceOp::OpType::SEND) {
+    coll->totalSendSize += entry->transSize;
+  } else {
+    coll->totalRecvSize += entry->transSize;
+  }
+
+  // Temporiarly move to past queue when completing a commHash:opCount
+  pastOps_[commHash][opCount].push_back(std::move(entry));
+  activeOps_[commHash][opCount].erase(proxyOpId);
+
+  // Erase opCount from activeOps_ if all proxyOps have finished
+  if (activeOps_[commHash][opCount].empty()) {
+    activeOps_[commHash].erase(opCount);
+
+    // Finished a full collective, move the activeColl to past queue and
+    // aggregate info
+    // - update coll to sendrecv if see both send and recv transmitted bytes
+    auto& coll = activeColls_[commHash][opCount];
+    if ((coll->collInfo.coll == ncclFuncSend ||
+         coll->collInfo.coll == ncclFuncRecv) &&
+        coll->totalSendSize > 0 && coll->totalRecvSize > 0) {
+      coll->collInfo.coll = ncclFuncSendRecv;
     }
+    // Free temporary storage for given commHash:opCount
+    pastOps_[commHash][opCount].clear();
+    pastOps_[commHash].erase(opCount);
 
-    // Temporiarly move to past queue when completing a commHash:opCount
-    pastOps_[commHash][opCount].push_back(std::move(entry));
-    activeOps_[commHash][opCount].erase(proxyOpId);
-
-    // Erase opCount from activeOps_ if all proxyOps have finished
-    if (activeOps_[commHash][opCount].empty()) {
-      activeOps_[commHash].erase(opCount);
-
-      // Finished a full collective, move the activeColl to past queue and
-      // aggregate info
-      // - update coll to sendrecv if see both send and recv transmitted bytes
-      auto& coll = activeColls_[commHash][opCount];
-      if ((coll->collInfo.coll == ncclFuncSend ||
-           coll->collInfo.coll == ncclFuncRecv) &&
-          coll->totalSendSize > 0 && coll->totalRecvSize > 0) {
-        coll->collInfo.coll = ncclFuncSendRecv;
-      }
-      // Free temporary storage for given commHash:opCount
-      pastOps_[commHash][opCount].clear();
-      pastOps_[commHash].erase(opCount);
-
-      if (features_ & ProxyTrace::Features::VERBOSE) {
-        INFO(
-            NCCL_COLL,
-            "PROXYTRACE: completed collective %s",
-            coll->serialize(false).c_str());
-      }
+    if (features_ & ProxyTrace::Features::VERBOSE) {
+      INFO(
+          NCCL_COLL,
+          "PROXYTRACE: completed collective %s",
+          coll->serialize(false).c_str());
+    }
 
-      pastColls_[commHash].push_back(std::move(coll));
-      activeColls_[commHash].erase(opCount);
+    auto pastColls = pastColls_.find(commHash);
+    if (pastColls == pastColls_.end()) {
+      pastColls = pastColls_
+                      .emplace(
+                          commHash,
+                          TraceHistory<ProxyTraceCollRecord>(
+                              NCCL_PROXYTRACE_RECORD_MAX,
+                              NCCL_PROXYTRACE_RECORD_MAX_BYTES))
+                      .first;
     }
+    pastColls->second.push(ProxyTraceCollRecord(*coll));
+    activeColls_[commHash].erase(opCount);
   }
   return ncclSuccess;
 }
 
 inline ncclResult_t ProxyTrace::updateTraceEntryStep(
-    struct ncclProxyArgs* args,
-    int subIdx,
-    int step,
-    ProxyOpStepStatus status,
-    ProxyTraceOp::OpType opType) {
-  struct ncclProxySubArgs* sub = &args->subs[subIdx];
-  auto proxyOpId = sub->traceArgs.proxyOpId;
-  auto commHash = sub->traceArgs.collInfo.commHash;
-  auto opCount = sub->traceArgs.collInfo.opCount;
+    const ProxyTraceRecord& rec) {
+  auto proxyOpId = rec.proxyOpId;
+  auto commHash = rec.commHash;
+  auto opCount = rec.opCount;
 
   if (!checkActiveOpExist(commHash, opCount, proxyOpId)) {
     WARN(
         "PROXYTRACE: failed to update %s entry of commHash %s opCount %lx proxyOpId %d, because no active entry exists",
-        proxyOpTypetrMap[opType].c_str(),
+        proxyOpTypetrMap[static_cast<ProxyTraceOp::OpType>(rec.opType)]
+            .c_str(),
         hashToHexStr(commHash).c_str(),
         opCount,
         proxyOpId);
@@ -250,18 +329,125 @@ inline ncclResult_t ProxyTrace::updateTraceEntryStep(
   }
 
   auto& entry = activeOps_[commHash][opCount][proxyOpId];
-  entry->stepRecords[status].step = step;
-  entry->stepRecords[status].ts = std::chrono::high_resolution_clock::now();
-  entry->transSize = sub->traceArgs.transSize;
+  entry->stepRecords[rec.status].step = rec.step;
+  entry->stepRecords[rec.status].ts = recordTs(rec);
+  entry->transSize = rec.size;
+
+  if (features_ & ProxyTrace::Features::TIMELINE) {
+    auto timeline = timelines_.find(commHash);
+    if (timeline == timelines_.end()) {
+      timeline = timelines_
+                     .emplace(
+                         commHash,
+                         TraceHistory<TimelineStepEvent>(
+                             NCCL_PROXYTRACE_TIMELINE_RECORD_MAX, -1))
+                     .first;
+    }
+    TimelineStepEvent event;
+    event.ts = rec.ts;
+    event.opCount = opCount;
+    event.proxyOpId = proxyOpId;
+    event.step = rec.step;
+    event.peer = entry->remoteRank;
+    event.channelId = entry->channelId;
+    event.opType = rec.opType;
+    event.status = rec.status;
+    timeline->second.push(event);
+  }
+  return ncclSuccess;
+}
+
+inline ncclResult_t ProxyTrace::createActiveEntries(
+    struct ncclProxyArgs* args,
+    ProxyTraceOp::OpType opType) {
+  for (int subIdx = 0; subIdx < args->nsubs; subIdx++) {
+    struct ncclProxySubArgs* sub = &args->subs[subIdx];
+    ProxyTraceRecord rec;
+    fillRecord(rec, sub, opType, ProxyTraceRecord::Event::START);
+    rec.proxyOpId = -1;
+    createActiveEntry(rec);
+    sub->traceArgs.proxyOpId = rec.proxyOpId;
+  }
+  return ncclSuccess;
+}
+
+inline ncclResult_t ProxyTrace::completeTraceEntries(
+    struct ncclProxyArgs* args,
+    ProxyTraceOp::OpType opType) {
+  // For each completed channel, move to completed queue
+  for (int subIdx = 0; subIdx < args->nsubs; subIdx++) {
+    ProxyTraceRecord rec;
+    fillRecord(rec, &args->subs[subIdx], opType, ProxyTraceRecord::COMPLETE);
+    NCCLCHECK(completeTraceEntry(rec));
+  }
   return ncclSuccess;
 }
 
+inline ncclResult_t ProxyTrace::updateTraceEntryStep(
+    struct ncclProxyArgs* args,
+    int subIdx,
+    int step,
+    ProxyOpStepStatus status,
+    ProxyTraceOp::OpType opType) {
+  struct ncclProxySubArgs* sub = &args->subs[subIdx];
+  ProxyTraceRecord rec;
+  fillRecord(rec, sub, opType, ProxyTraceRecord::Event::STEP);
+  rec.step = step;
+  rec.status = status;
+  rec.size = sub->traceArgs.transSize;
+  return updateTraceEntryStep(rec);
+}
+
+// Ring mode: only write records on the proxy thread. proxyOpId is still
+// assigned here, because ProxyMock matches on it while the op progresses.
+inline void ProxyTrace::recordEntries(
+    struct ncclProxyArgs* args,
+    ProxyTraceOp::OpType opType,
+    ProxyTraceRecord::Event event) {
+  for (int subIdx = 0; subIdx < args->nsubs; subIdx++) {
+    struct ncclProxySubArgs* sub = &args->subs[subIdx];
+    auto commHash = sub->traceArgs.collInfo.commHash;
+    auto opCount = sub->traceArgs.collInfo.opCount;
+    if (event == ProxyTraceRecord::Event::START) {
+      sub->traceArgs.proxyOpId = ring_->startOp(commHash, opCount);
+    } else {
+      ring_->completeOp(commHash, opCount);
+    }
+    fillRecord(*ring_->next(), sub, opType, event);
+    ring_->commit();
+  }
+}
+
+inline void ProxyTrace::recordEntryStep(
+    struct ncclProxyArgs* args,
+    int subIdx,
+    int step,
+    ProxyOpStepStatus status,
+    ProxyTraceOp::OpType opType) {
+  struct ncclProxySubArgs* sub = &args->subs[subIdx];
+  ProxyTraceRecord* rec = ring_->next();
+  fillRecord(*rec, sub, opType, ProxyTraceRecord::Event::STEP);
+  rec->step = step;
+  rec->status = status;
+  rec->size = sub->traceArgs.transSize;
+  ring_->commit();
+}
+
 ncclResult_t ProxyTrace::startSend(struct ncclProxyArgs* args) {
+  if (ring_) {
+    recordEntries(args, ProxyTraceOp::OpType::SEND, ProxyTraceRecord::START);
+    return ncclSuccess;
+  }
   std::lock_guard<std::mutex> lock(mutex_);
   return createActiveEntries(args, ProxyTraceOp::OpType::SEND);
 };
 
 ncclResult_t ProxyTrace::completeSend(struct ncclProxyArgs* args) {
+  if (ring_) {
+    recordEntries(
+        args, ProxyTraceOp::OpType::SEND, ProxyTraceRecord::COMPLETE);
+    return ncclSuccess;
+  }
   std::lock_guard<std::mutex> lock(mutex_);
   return completeTraceEntries(args, ProxyTraceOp::OpType::SEND);
 }
@@ -271,17 +457,30 @@ ncclResult_t ProxyTrace::recordSendProgress(
     int sub,
     int step,
     ProxyOpStepStatus status) {
+  if (ring_) {
+    recordEntryStep(args, sub, step, status, ProxyTraceOp::OpType::SEND);
+    return ncclSuccess;
+  }
   std::lock_guard<std::mutex> lock(mutex_);
   return updateTraceEntryStep(
       args, sub, step, status, ProxyTraceOp::OpType::SEND);
 };
 
 ncclResult_t ProxyTrace::startRecv(struct ncclProxyArgs* args) {
+  if (ring_) {
+    recordEntries(args, ProxyTraceOp::OpType::RECV, ProxyTraceRecord::START);
+    return ncclSuccess;
+  }
   std::lock_guard<std::mutex> lock(mutex_);
   return createActiveEntries(args, ProxyTraceOp::OpType::RECV);
 };
 
 ncclResult_t ProxyTrace::completeRecv(struct ncclProxyArgs* args) {
+  if (ring_) {
+    recordEntries(
+        args, ProxyTraceOp::OpType::RECV, ProxyTraceRecord::COMPLETE);
+    return ncclSuccess;
+  }
   std::lock_guard<std::mutex> lock(mutex_);
   return completeTraceEntries(args, ProxyTraceOp::OpType::RECV);
 }
@@ -291,11 +490,143 @@ ncclResult_t ProxyTrace::recordRecvProgress(
     int sub,
     int step,
     ProxyOpStepStatus status) {
+  if (ring_) {
+    recordEntryStep(args, sub, step, status, ProxyTraceOp::OpType::RECV);
+    return ncclSuccess;
+  }
   std::lock_guard<std::mutex> lock(mutex_);
   return updateTraceEntryStep(
       args, sub, step, status, ProxyTraceOp::OpType::RECV);
 };
 
+ProxyTraceRing::ProxyTraceRing(size_t size) {
+  size_t ringSize = 1;
+  while (ringSize < size) {
+    ringSize <<= 1;
+  }
+  records_ = std::unique_ptr<ProxyTraceRecord[]>(new ProxyTraceRecord[ringSize]);
+  mask_ = ringSize - 1;
+  activeColls_.reserve(64);
+}
+
+int ProxyTraceRing::startOp(uint64_t commHash, uint64_t opCount) {
+  for (auto& coll : activeColls_) {
+    if (coll.commHash == commHash && coll.opCount == opCount) {
+      coll.nActiveOps++;
+      return coll.nProxyOps++;
+    }
+  }
+  activeColls_.push_back({commHash, opCount, 1, 1});
+  return 0;
+}
+
+void ProxyTraceRing::completeOp(uint64_t commHash, uint64_t opCount) {
+  for (auto& coll : activeColls_) {
+    if (coll.commHash == commHash && coll.opCount == opCount) {
+      // Like the map based trace, a collective ends when all its active ops
+      // complete
+      if (--coll.nActiveOps == 0) {
+        coll = activeColls_.back();
+        activeColls_.pop_back();
+      }
+      return;
+    }
+  }
+}
+
+uint64_t ProxyTraceRing::read(
+    uint64_t* pos,
+    std::vector<ProxyTraceRecord>& out) {
+  uint64_t size = mask_ + 1;
+  uint64_t head = head_.load(std::memory_order_acquire);
+  uint64_t start = std::max(*pos, head > size ? head - size : 0);
+  size_t outStart = out.size();
+  for (uint64_t i = start; i < head; i++) {
+    out.push_back(records_[i & mask_]);
+  }
+
+  // The producer may have overwritten the oldest records while they were
+  // copied. It moves the head past a slot's previous record before writing
+  // it, so records older than the head seen now are not reliable.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t newHead = head_.load(std::memory_order_relaxed);
+  uint64_t valid = newHead >= size ? newHead - size + 1 : 0;
+  if (valid > start) {
+    size_t nInvalid = std::min(valid, head) - start;
+    out.erase(out.begin() + outStart, out.begin() + outStart + nInvalid);
+    start += nInvalid;
+  }
+
+  uint64_t dropped = start - *pos;
+  *pos = head;
+  return dropped;
+}
+
+// Aggregate the records written since the previous dump. Called with mutex_
+// held.
+void ProxyTrace::aggregateRing() {
+  ringRecords_.clear();
+  uint64_t dropped = ring_->read(&ringPos_, ringRecords_);
+  if (dropped > 0) {
+    // The entries of ops whose records were lost would stay active forever;
+    // restart from the records left, keeping the past collectives.
+    INFO(
+        NCCL_COLL,
+        "PROXYTRACE: %lu records overwritten in ring of %zu records before dump, active operations may be missing",
+        dropped,
+        ring_->size());
+    droppedRecords_ += dropped;
+    activeOps_.clear();
+    activeColls_.clear();
+    pastOps_.clear();
+  }
+
+  for (auto& rec : ringRecords_) {
+    switch (rec.event) {
+      case ProxyTraceRecord::Event::START:
+        createActiveEntry(rec);
+        break;
+      // Skip ops that started in overwritten records
+      case ProxyTraceRecord::Event::STEP:
+        if (checkActiveOpExist(rec.commHash, rec.opCount, rec.proxyOpId)) {
+          updateTraceEntryStep(rec);
+        }
+        break;
+      case ProxyTraceRecord::Event::COMPLETE:
+        if (checkActiveOpExist(rec.commHash, rec.opCount, rec.proxyOpId)) {
+          completeTraceEntry(rec);
+        }
+        break;
+    }
+  }
+}
+
+ProxyTraceCollRecord::ProxyTraceCollRecord(const ProxyTraceColl& coll)
+    : collInfo(coll.collInfo),
+      nProxyOps(coll.nProxyOps),
+      totalSendSize(coll.totalSendSize),
+      totalRecvSize(coll.totalRecvSize) {
+  for (auto channelId : coll.channelIds) {
+    if (channelId >= 0 && channelId < 64) {
+      channelMask |= 1UL << channelId;
+    }
+  }
+}
+
+ProxyTraceColl ProxyTraceCollRecord::toColl() const {
+  ProxyTraceColl coll;
+  coll.collInfo = collInfo;
+  coll.nProxyOps = nProxyOps;
+  coll.totalSendSize = totalSendSize;
+  coll.totalRecvSize = totalRecvSize;
+  for (int channelId = 0; channelId < 64; channelId++) {
+    if (channelMask & (1UL << channelId)) {
+      coll.channelIds.insert(channelId);
+    }
+  }
+  return coll;
+}
+
 static std::vector<std::string> infoKeys = {
     "commHash",
     "opCount",
@@ -461,30 +792,61 @@ static inline void dumpPastOps(
 static inline void dumpPastColls(
     uint64_t commHash,
     ProxyPastCollMap& pastCollsMap,
-    std::deque<ProxyTraceColl>& deq) {
-  if (pastCollsMap.find(commHash) == pastCollsMap.end()) {
+    uint64_t since,
+    std::deque<ProxyTraceColl>& deq,
+    TraceHistoryStats& stats) {
+  auto it = pastCollsMap.find(commHash);
+  if (it == pastCollsMap.end()) {
     return;
   }
 
-  for (auto& it : pastCollsMap[commHash]) {
-    auto& past = it;
-    // copy past record
-    deq.push_back(*past);
-  }
+  it->second.forEachSince(since, [&](const ProxyTraceCollRecord& past) {
+    // expand past record
+    deq.push_back(past.toColl());
+  });
+  stats = it->second.stats();
 }
 
-ProxyTrace::Dump ProxyTrace::dump(uint64_t commHash) {
+ProxyTrace::Dump ProxyTrace::dump(
+    uint64_t commHash,
+    uint64_t pastCollsSince) {
   std::lock_guard<std::mutex> lock(mutex_);
   ProxyTrace::Dump dump;
 
+  if (ring_) {
+    aggregateRing();
+  }
+
   dumpActiveOps(commHash, activeOps_, dump.activeOps);
   dumpActiveColls(commHash, activeColls_, dump.activeColls);
   dumpPastOps(commHash, pastOps_, dump.pastOps);
-  dumpPastColls(commHash, pastColls_, dump.pastColls);
+  dumpPastColls(
+      commHash,
+      pastColls_,
+      pastCollsSince,
+      dump.pastColls,
+      dump.pastCollsStats);
 
   return dump;
 }
 
+std::vector<TimelineStepEvent> ProxyTrace::timeline(uint64_t commHash) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<TimelineStepEvent> events;
+
+  if (ring_) {
+    aggregateRing();
+  }
+
+  auto it = timelines_.find(commHash);
+  if (it != timelines_.end()) {
+    events.reserve(it->second.size());
+    it->second.forEach(
+        [&](const TimelineStepEvent& event) { events.push_back(event); });
+  }
+  return events;
+}
+
 ncclResult_t proxyTraceInit(
     struct ncclProxyState* state,
     struct ncclComm* comm) {
@@ -2,6 +2,7 @@
 #ifndef PROXY_TRACE_H
 #define PROXY_TRACE_H
 
+#include <atomic>
 #include <cstdint>
 #include <deque>
 #include <list>
@@ -11,6 +12,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
+#include "TraceTimeline.h"
 #include "TraceUtils.h"
 #include "debug.h"
 #include "info.h"
@@ -44,6 +46,22 @@ struct ProxyTraceColl {
   std::string serialize(bool quoted = false);
 };
 
+// Compact record of a completed collective kept in the ProxyTrace history
+struct ProxyTraceCollRecord {
+  ProxyTraceCollInfo collInfo;
+  int nProxyOps{0};
+  // bitmask of channelIds
+  uint64_t channelMask{0};
+  size_t totalSendSize{0};
+  size_t totalRecvSize{0};
+
+  ProxyTraceCollRecord() = default;
+  explicit ProxyTraceCollRecord(const ProxyTraceColl& coll);
+
+  // expand the record back to a ProxyTraceColl
+  ProxyTraceColl toColl() const;
+};
+
 // record progress state per comm per collective per proxyOp
 struct ProxyTraceOp {
   ProxyTraceCollInfo collInfo;
@@ -103,14 +121,101 @@ using ProxyPastOpMap = std::unordered_map<
 
 using ProxyPastCollMap = std::unordered_map<
     uint64_t /* commHash*/,
-    /* list of past collectives in completion order */
-    std::deque<std::unique_ptr<ProxyTraceColl>>>;
+    /* most recent past collectives in completion order */
+    TraceHistory<ProxyTraceCollRecord>>;
+
+using ProxyTimelineMap = std::unordered_map<
+    uint64_t /* commHash*/,
+    /* most recent step status changes in time order */
+    TraceHistory<TimelineStepEvent>>;
+
+// Fixed-size record of a proxy op event, written by the proxy thread into a
+// ProxyTraceRing when the ring feature is enabled. Records are aggregated into
+// ProxyTraceOp and ProxyTraceColl entries only when the trace is dumped.
+struct alignas(64) ProxyTraceRecord {
+  enum Event : uint8_t { START, STEP, COMPLETE };
+
+  uint64_t commHash{0};
+  uint64_t opCount{0};
+  // high_resolution_clock ticks
+  int64_t ts{0};
+  // stepSize at START, transSize at STEP
+  int64_t size{0};
+  int proxyOpId{-1};
+  // nSteps at START, step at STEP
+  int step{0};
+  int rank{-1};
+  int remoteRank{-1};
+  int16_t channelId{-1};
+  int16_t nChannels{0};
+  uint8_t event{START};
+  uint8_t opType{0};
+  uint8_t status{0};
+  uint8_t coll{0};
+};
+
+// Pre-allocated ring of ProxyTraceRecord written without lock by a single
+// producer, the progress thread of the proxy state owning the trace. When the
+// ring is full, the oldest records are overwritten; the reader detects it and
+// skips them.
+class ProxyTraceRing {
+ public:
+  // size is rounded up to a power of two
+  explicit ProxyTraceRing(size_t size);
+
+  // Producer side. The returned slot is published by commit().
+  inline ProxyTraceRecord* next() {
+    return &records_[head_.load(std::memory_order_relaxed) & mask_];
+  }
+  inline void commit() {
+    head_.store(
+        head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    // Order the head update before the writes to the next slot, so that a
+    // reader copying the overwritten record sees the new head (see read()).
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  // Producer side. Assign an id to a new proxy op of commHash:opCount,
+  // counting from 0 in each collective, as done by the map based trace.
+  int startOp(uint64_t commHash, uint64_t opCount);
+  void completeOp(uint64_t commHash, uint64_t opCount);
+
+  // Reader side. Append records from position *pos to the current head to
+  // out, and advance *pos. Return the number of records overwritten before
+  // they could be read.
+  uint64_t read(uint64_t* pos, std::vector<ProxyTraceRecord>& out);
+
+  size_t size() const {
+    return mask_ + 1;
+  }
+
+ private:
+  std::unique_ptr<ProxyTraceRecord[]> records_;
+  uint64_t mask_{0};
+  alignas(64) std::atomic<uint64_t> head_{0};
+
+  // Collectives with active ops, only accessed by the producer. There are few
+  // of them at a time, so a linear search is faster than a map.
+  struct ActiveColl {
+    uint64_t commHash;
+    uint64_t opCount;
+    int nProxyOps;
+    int nActiveOps;
+  };
+  std::vector<ActiveColl> activeColls_;
+};
 
 class ProxyTrace {
  public:
   ProxyTrace();
   ~ProxyTrace(){};
 
+  // Whether the trace is recorded into a single producer ring, which only
+  // supports one progress thread per proxy state
+  bool singleProducer() const {
+    return ring_ != nullptr;
+  }
+
   // Record when starts a send operation on proxy thread (see sendProxyProgress)
   ncclResult_t startSend(struct ncclProxyArgs* args);
 
@@ -154,10 +259,24 @@ class ProxyTrace {
     std::deque<ProxyTraceColl> pastColls;
     // activeColls in start time order
     std::deque<ProxyTraceColl> activeColls;
+    // pastColls only holds the most recent collectives, see
+    // NCCL_PROXYTRACE_RECORD_MAX. Numbered as CollTrace::Dump::pastColls.
+    TraceHistoryStats pastCollsStats;
   };
 
-  // Dump all trace for a given communicator
-  ProxyTrace::Dump dump(uint64_t commHash);
+  // Dump all trace for a given communicator. Only past collectives numbered
+  // pastCollsSince or later are copied.
+  ProxyTrace::Dump dump(uint64_t commHash, uint64_t pastCollsSince = 0);
+
+  // Step status changes of the network operations of a communicator kept
+  // with the timeline feature, see TraceTimeline.h
+  std::vector<TimelineStepEvent> timeline(uint64_t commHash);
+
+  // Number of ring records overwritten before being aggregated by dump()
+  uint64_t droppedRecords() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return droppedRecords_;
+  }
 
  private:
   inline ncclResult_t createActiveEntries(
@@ -172,6 +291,20 @@ class ProxyTrace {
       int step,
       ProxyOpStepStatus status,
       ProxyTraceOp::OpType opType);
+  inline void createActiveEntry(ProxyTraceRecord& rec);
+  inline ncclResult_t completeTraceEntry(const ProxyTraceRecord& rec);
+  inline ncclResult_t updateTraceEntryStep(const ProxyTraceRecord& rec);
+  inline void recordEntries(
+      struct ncclProxyArgs* args,
+      ProxyTraceOp::OpType opType,
+      ProxyTraceRecord::Event event);
+  inline void recordEntryStep(
+      struct ncclProxyArgs* args,
+      int sub,
+      int step,
+      ProxyOpStepStatus status,
+      ProxyTraceOp::OpType opType);
+  void aggregateRing();
   inline bool checkActiveCollExist(uint64_t commHash, uint64_t opCount);
   inline bool
   checkActiveOpExist(uint64_t commHash, uint64_t opCount, int proxyOpId);
@@ -179,11 +312,21 @@ class ProxyTrace {
   enum Features {
     TRACE = 1,
     VERBOSE = 2,
+    RING = 4,
+    TIMELINE = 8,
   };
   int features_{0}; // bitwise OR of Features
 
   std::mutex mutex_;
 
+  // Ring written by the proxy thread when the ring feature is enabled. The
+  // maps below are then only updated by dump(), from the records since the
+  // previous dump.
+  std::unique_ptr<ProxyTraceRing> ring_;
+  uint64_t ringPos_{0};
+  uint64_t droppedRecords_{0};
+  std::vector<ProxyTraceRecord> ringRecords_;
+
   // Current active send/recv operations.
   // Use map to quickly find the record with commHash:opCount:proxyOpId during
   // active progress. Note that each op may not complete in order, e.g.,
@@ -206,6 +349,9 @@ class ProxyTrace {
   // Updated when both send and recv are completed. Allow to search by commHash
   ProxyPastCollMap pastColls_;
 
+  // Step status changes of each communicator with the timeline feature
+  ProxyTimelineMap timelines_;
+
   friend class CollTrace;
 };
 
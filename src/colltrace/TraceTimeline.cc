@@ -0,0 +1,319 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include "TraceTimeline.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+
+namespace {
+
+// Same values as ProxyOpStepStatus and ProxyTraceOp::OpType, which are not
+// included to build the timeline without NCCL
+enum TimelineStepStatus { POSTED, RECEIVED, TRANSMITTED, DONE, NUM_STATUS };
+enum TimelineOpType { SEND, RECV };
+
+// Network step of a proxy op, built from its status changes
+struct StepSlice {
+  uint64_t opCount{0};
+  int proxyOpId{0};
+  int step{0};
+  int peer{-1};
+  int channelId{0};
+  int opType{SEND};
+  // 0 if the status was not seen
+  int64_t ts[NUM_STATUS]{};
+  int64_t start{INT64_MAX};
+  int64_t end{0};
+  int lane{0};
+};
+
+struct StepKey {
+  uint64_t opCount;
+  int proxyOpId;
+  int opType;
+  int step;
+
+  bool operator==(const StepKey& other) const {
+    return opCount == other.opCount && proxyOpId == other.proxyOpId &&
+        opType == other.opType && step == other.step;
+  }
+};
+
+struct StepKeyHash {
+  size_t operator()(const StepKey& key) const {
+    size_t h = std::hash<uint64_t>()(key.opCount);
+    h = h * 31 + std::hash<int>()(key.proxyOpId);
+    h = h * 31 + std::hash<int>()(key.opType);
+    return h * 31 + std::hash<int>()(key.step);
+  }
+};
+
+// Phases of a step, as consecutive statuses. See TraceTimeline.h.
+struct StepPhase {
+  TimelineStepStatus from;
+  TimelineStepStatus to;
+  const char* name;
+};
+const std::vector<StepPhase> kSendPhases = {
+    {POSTED, TRANSMITTED, "gpu"},
+    {TRANSMITTED, DONE, "net"},
+};
+const std::vector<StepPhase> kRecvPhases = {
+    {POSTED, RECEIVED, "net"},
+    {RECEIVED, TRANSMITTED, "flush"},
+    {TRANSMITTED, DONE, "gpu"},
+};
+
+// Minimal escaping of the strings of the timeline, which are names of
+// collectives, algorithms and protocols
+std::string quoted(const std::string& str) {
+  std::string res = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      res += '\\';
+    }
+    res += c;
+  }
+  return res + "\"";
+}
+
+class JsonEvents {
+ public:
+  JsonEvents(int pid, int64_t baseTs) : pid_(pid), baseTs_(baseTs) {}
+
+  void metadata(const char* name, int tid, const std::string& argName) {
+    char buf[128];
+    snprintf(
+        buf,
+        sizeof(buf),
+        "{\"ph\": \"M\", \"name\": \"%s\", \"pid\": %d, \"tid\": %d, \"args\": {",
+        name,
+        pid_,
+        tid);
+    begin(buf);
+    events_ += "\"name\": " + argName + "}}";
+  }
+
+  void sortIndex(int tid) {
+    char buf[128];
+    snprintf(
+        buf,
+        sizeof(buf),
+        "{\"ph\": \"M\", \"name\": \"thread_sort_index\", \"pid\": %d, \"tid\": %d, \"args\": {\"sort_index\": %d}}",
+        pid_,
+        tid,
+        tid);
+    begin(buf);
+  }
+
+  // Complete event; args is a json object without braces, or empty
+  void slice(
+      const std::string& name,
+      const char* cat,
+      int tid,
+      int64_t start,
+      int64_t end,
+      const std::string& args) {
+    char buf[192];
+    snprintf(
+        buf,
+        sizeof(buf),
+        "{\"ph\": \"X\", \"cat\": \"%s\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, \"name\": ",
+        cat,
+        pid_,
+        tid,
+        (start - baseTs_) / 1000.0,
+        (end - start) / 1000.0);
+    begin(buf);
+    events_ += quoted(name);
+    if (!args.empty()) {
+      events_ += ", \"args\": {" + args + "}";
+    }
+    events_ += "}";
+  }
+
+  const std::string& str() const {
+    return events_;
+  }
+
+ private:
+  void begin(const char* str) {
+    if (!events_.empty()) {
+      events_ += ",\n";
+    }
+    events_ += str;
+  }
+
+  int pid_{0};
+  int64_t baseTs_{0};
+  std::string events_;
+};
+
+} // namespace
+
+std::string TraceTimeline::toJson() const {
+  // Build the steps from their status changes
+  std::vector<StepSlice> slices;
+  std::unordered_map<StepKey, size_t, StepKeyHash> sliceIdx;
+  for (auto& event : steps_) {
+    if (event.status >= NUM_STATUS) {
+      continue;
+    }
+    StepKey key{event.opCount, event.proxyOpId, event.opType, event.step};
+    auto it = sliceIdx.find(key);
+    if (it == sliceIdx.end()) {
+      it = sliceIdx.emplace(key, slices.size()).first;
+      slices.emplace_back();
+      auto& slice = slices.back();
+      slice.opCount = event.opCount;
+      slice.proxyOpId = event.proxyOpId;
+      slice.step = event.step;
+      slice.peer = event.peer;
+      slice.channelId = event.channelId;
+      slice.opType = event.opType;
+    }
+    auto& slice = slices[it->second];
+    if (slice.ts[event.status] == 0) {
+      slice.ts[event.status] = event.ts;
+    }
+    slice.start = std::min(slice.start, event.ts);
+    slice.end = std::max(slice.end, event.ts);
+  }
+
+  int64_t baseTs = INT64_MAX;
+  for (auto& coll : colls_) {
+    baseTs = std::min(baseTs, coll.startTs);
+  }
+  for (auto& slice : slices) {
+    baseTs = std::min(baseTs, slice.start);
+  }
+  if (baseTs == INT64_MAX) {
+    baseTs = 0;
+  }
+
+  JsonEvents events(rank_, baseTs);
+  char hashStr[32];
+  snprintf(hashStr, sizeof(hashStr), "%" PRIx64, commHash_);
+  events.metadata(
+      "process_name",
+      0,
+      quoted("rank " + std::to_string(rank_) + " comm " + hashStr));
+  events.metadata("thread_name", 0, quoted("collectives"));
+  events.sortIndex(0);
+  events.metadata("thread_name", 1, quoted("proxy collectives"));
+  events.sortIndex(1);
+
+  std::unordered_map<uint64_t, const TimelineCollSpan*> collsByOpCount;
+  for (auto& coll : colls_) {
+    collsByOpCount[coll.opCount] = &coll;
+    events.slice(
+        coll.opName,
+        "coll",
+        0,
+        coll.startTs,
+        coll.startTs + coll.durationNs,
+        "\"opCount\": " + std::to_string(coll.opCount) +
+            ", \"nBytes\": " + std::to_string(coll.nBytes) +
+            ", \"algorithm\": " + quoted(coll.algorithm) +
+            ", \"protocol\": " + quoted(coll.protocol) +
+            ", \"nChannels\": " + std::to_string(coll.nChannels));
+  }
+
+  // Proxy collectives, from the first to the last status change of their steps
+  std::map<uint64_t, std::pair<int64_t, int64_t>> proxyColls;
+  for (auto& slice : slices) {
+    auto it = proxyColls.emplace(
+        slice.opCount, std::make_pair(slice.start, slice.end));
+    it.first->second.first = std::min(it.first->second.first, slice.start);
+    it.first->second.second = std::max(it.first->second.second, slice.end);
+  }
+  for (auto& it : proxyColls) {
+    auto coll = collsByOpCount.find(it.first);
+    events.slice(
+        coll != collsByOpCount.end() ? coll->second->opName
+                                     : "opCount " + std::to_string(it.first),
+        "proxy_coll",
+        1,
+        it.second.first,
+        it.second.second,
+        "\"opCount\": " + std::to_string(it.first));
+  }
+
+  // Spread the steps of each channel, direction and peer over the fewest
+  // lanes such that the steps of a lane do not overlap
+  std::map<std::tuple<int, int, int>, std::vector<size_t>> groups;
+  for (size_t i = 0; i < slices.size(); i++) {
+    auto& slice = slices[i];
+    groups[std::make_tuple(slice.channelId, slice.opType, slice.peer)]
+        .push_back(i);
+  }
+  int tid = 2;
+  for (auto& group : groups) {
+    auto& idxs = group.second;
+    std::sort(idxs.begin(), idxs.end(), [&](size_t a, size_t b) {
+      return slices[a].start < slices[b].start;
+    });
+    // free lanes by end of their last step
+    std::priority_queue<
+        std::pair<int64_t, int>,
+        std::vector<std::pair<int64_t, int>>,
+        std::greater<std::pair<int64_t, int>>>
+        lanes;
+    int nLanes = 0;
+    for (auto i : idxs) {
+      auto& slice = slices[i];
+      if (!lanes.empty() && lanes.top().first <= slice.start) {
+        slice.lane = lanes.top().second;
+        lanes.pop();
+      } else {
+        slice.lane = nLanes++;
+      }
+      lanes.emplace(slice.end, slice.lane);
+    }
+
+    int channelId, opType, peer;
+    std::tie(channelId, opType, peer) = group.first;
+    for (int lane = 0; lane < nLanes; lane++) {
+      std::string name = "ch" + std::to_string(channelId) +
+          (opType == SEND ? " send to " : " recv from ") +
+          std::to_string(peer) + " #" + std::to_string(lane);
+      events.metadata("thread_name", tid + lane, quoted(name));
+      events.sortIndex(tid + lane);
+    }
+
+    auto& phases = opType == SEND ? kSendPhases : kRecvPhases;
+    for (auto i : idxs) {
+      auto& slice = slices[i];
+      bool done = slice.ts[DONE] != 0;
+      events.slice(
+          "step " + std::to_string(slice.step),
+          "proxy_step",
+          tid + slice.lane,
+          slice.start,
+          slice.end,
+          "\"opCount\": " + std::to_string(slice.opCount) +
+              ", \"proxyOpId\": " + std::to_string(slice.proxyOpId) +
+              (done ? "" : ", \"incomplete\": true"));
+      for (auto& phase : phases) {
+        int64_t from = slice.ts[phase.from];
+        int64_t to = slice.ts[phase.to];
+        if (from != 0 && to >= from) {
+          events.slice(
+              phase.name, "proxy_phase", tid + slice.lane, from, to, "");
+        }
+      }
+    }
+    tid += nLanes;
+  }
+
+  return std::string("{\"displayTimeUnit\": \"ns\", \"otherData\": {") +
+      "\"commHash\": \"" + hashStr + "\", \"rank\": " + std::to_string(rank_) +
+      ", \"nRanks\": " + std::to_string(nRanks_) + ", \"baseTs\": \"" +
+      std::to_string(baseTs) + "\"},\n\"traceEvents\": [\n" + events.str() +
+      "\n]}\n";
+}
@@ -0,0 +1,80 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+#ifndef TRACE_TIMELINE_H
+#define TRACE_TIMELINE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Timeline of a communicator on a rank, written with the CollTrace timeline
+// feature in the Chrome trace event format, which can be opened in Perfetto
+// (ui.perfetto.dev) or chrome://tracing. The timelines of all ranks can be
+// merged into one with tools/TimelineMerge.cc.
+//
+// Each rank is a process with the following threads (tracks):
+// - "collectives": the kernel of each collective traced by CollTrace
+// - "proxy collectives": from the first to the last proxy step of each
+//   collective, according to ProxyTrace
+// - one or more lanes per channel, direction and peer, with a slice per
+//   network step of the proxy from POSTED to DONE, split into its phases:
+//     send: gpu (POSTED to TRANSMITTED, the kernel fills the buffer), then
+//           net (TRANSMITTED to DONE, the network sends it)
+//     recv: net (POSTED to RECEIVED), flush (RECEIVED to TRANSMITTED), then
+//           gpu (TRANSMITTED to DONE, the kernel consumes the buffer)
+//   Steps in flight at the same time are spread over several lanes, so gaps
+//   in a lane are pipeline bubbles.
+// Timestamps are relative to otherData.baseTs, in nanoseconds of the
+// high_resolution_clock since epoch, to keep nanosecond precision.
+
+// Kernel of a collective
+struct TimelineCollSpan {
+  uint64_t opCount{0};
+  std::string opName;
+  // high_resolution_clock nanoseconds since epoch
+  int64_t startTs{0};
+  int64_t durationNs{0};
+  uint64_t nBytes{0};
+  std::string algorithm;
+  std::string protocol;
+  int nChannels{0};
+};
+
+// Status change of a network step of a proxy op, see ProxyOpStepStatus
+struct TimelineStepEvent {
+  // high_resolution_clock nanoseconds since epoch
+  int64_t ts{0};
+  uint64_t opCount{0};
+  int32_t proxyOpId{0};
+  int32_t step{0};
+  int32_t peer{-1};
+  int16_t channelId{0};
+  // ProxyTraceOp::OpType
+  uint8_t opType{0};
+  // ProxyOpStepStatus
+  uint8_t status{0};
+};
+
+class TraceTimeline {
+ public:
+  TraceTimeline(uint64_t commHash, int rank, int nRanks)
+      : commHash_(commHash), rank_(rank), nRanks_(nRanks) {}
+
+  void addColl(const TimelineCollSpan& coll) {
+    colls_.push_back(coll);
+  }
+  void addStep(const TimelineStepEvent& event) {
+    steps_.push_back(event);
+  }
+
+  // Serialize the timeline to a Chrome trace event format json string
+  std::string toJson() const;
+
+ private:
+  uint64_t commHash_{0};
+  int rank_{0};
+  int nRanks_{0};
+  std::vector<TimelineCollSpan> colls_;
+  std::vector<TimelineStepEvent> steps_;
+};
+
+#endif
@@ -2,11 +2,14 @@
 #ifndef TRACE_UTILES_H
 #define TRACE_UTILES_H
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <deque>
 #include <iomanip>
 #include <list>
 #include <sstream>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -184,4 +187,117 @@ static inline std::string mapToString(
   }
   return final_string;
 }
+/**
+ * Statistics of a TraceHistory, reported along with the records it keeps
+ */
+struct TraceHistoryStats {
+  // records ever pushed
+  uint64_t nRecords{0};
+  // records overwritten by more recent ones
+  uint64_t nDropped{0};
+  // max number of records kept
+  uint64_t capacity{0};
+  // memory used by the kept records
+  uint64_t bytes{0};
+
+  // serialize the stats to a json format string
+  std::string serialize(bool quoted = false) {
+    std::vector<std::string> keys = {"nRecords", "nDropped", "capacity", "bytes"};
+    std::unordered_map<std::string, std::string> map;
+    map["nRecords"] = std::to_string(nRecords);
+    map["nDropped"] = std::to_string(nDropped);
+    map["capacity"] = std::to_string(capacity);
+    map["bytes"] = std::to_string(bytes);
+    return serializeMap(keys, map, quoted);
+  }
+};
+
+/**
+ * Fixed-capacity history of trace records. Keeps the most recent records
+ * within both a max number of records and a byte budget, and overwrites the
+ * oldest record when full. Storage grows with the records up to the capacity,
+ * so short jobs don't pay for it. Not thread safe.
+ * Input arguments:
+ *   maxRecords: max number of records; negative for no limit
+ *   maxBytes: max bytes used by the records; negative for no limit
+ */
+template <typename T>
+class TraceHistory {
+ public:
+  TraceHistory(int64_t maxRecords, int64_t maxBytes) {
+    uint64_t capacity = UINT64_MAX;
+    if (maxRecords >= 0) {
+      capacity = maxRecords;
+    }
+    if (maxBytes >= 0) {
+      capacity = std::min(capacity, static_cast<uint64_t>(maxBytes) / sizeof(T));
+    }
+    capacity_ = capacity;
+  }
+
+  void push(T record) {
+    total_++;
+    if (capacity_ == 0) {
+      return;
+    }
+    if (records_.size() < capacity_) {
+      // Grow as usual but never past the capacity
+      if (records_.size() == records_.capacity()) {
+        records_.reserve(std::min<uint64_t>(
+            std::max<size_t>(16, 2 * records_.size()), capacity_));
+      }
+      records_.push_back(std::move(record));
+      return;
+    }
+    records_[oldest_] = std::move(record);
+    oldest_ = (oldest_ + 1) % records_.size();
+  }
+
+  size_t size() const {
+    return records_.size();
+  }
+
+  // Call f on every record, from the oldest to the most recent
+  template <typename F>
+  void forEach(F&& f) const {
+    for (size_t i = 0; i < records_.size(); i++) {
+      f(records_[(oldest_ + i) % records_.size()]);
+    }
+  }
+
+  // Records are numbered in push order from 0. Sequence number of the oldest
+  // record kept, and of the next record to be pushed.
+  uint64_t firstSeq() const {
+    return total_ - records_.size();
+  }
+  uint64_t nextSeq() const {
+    return total_;
+  }
+
+  // Call f on the records kept with a sequence number >= seq, from the oldest
+  // to the most recent, in O(number of such records)
+  template <typename F>
+  void forEachSince(uint64_t seq, F&& f) const {
+    uint64_t first = std::max(seq, firstSeq());
+    for (uint64_t i = first - firstSeq(); i < records_.size(); i++) {
+      f(records_[(oldest_ + i) % records_.size()]);
+    }
+  }
+
+  TraceHistoryStats stats() const {
+    TraceHistoryStats stats;
+    stats.nRecords = total_;
+    stats.nDropped = total_ - records_.size();
+    stats.capacity = capacity_;
+    stats.bytes = records_.capacity() * sizeof(T);
+    return stats;
+  }
+
+ private:
+  std::vector<T> records_;
+  // index of the oldest record once the history is full
+  size_t oldest_{0};
+  uint64_t capacity_{0};
+  uint64_t total_{0};
+};
 #endif
@@ -279,6 +279,138 @@ TEST_F(CollTraceTest, DumpAllFinished) {
   NCCL_COLLTRACE.clear();
 }
 
+TEST_F(CollTraceTest, DumpBoundedHistory) {
+  // overwrite CollTrace features before creating comm
+  NCCL_COLLTRACE.push_back("trace");
+  NCCL_COLLTRACE_RECORD_MAX = 4;
+  ncclComm_t comm =
+      createNcclComm(this->globalRank, this->numRanks, this->localRank);
+  const int count = 1048576;
+  const int nColl = 10;
+
+  uint64_t opCountStart = comm->opCount;
+  prepareAllreduce(count);
+  for (int i = 0; i < nColl; i++) {
+    NCCLCHECK_TEST(
+        ncclAllReduce(sendBuf, recvBuf, count, ncclInt, ncclSum, comm, stream));
+  }
+
+  EXPECT_TRUE(comm->collTrace != nullptr);
+  comm->collTrace->waitForWorkerFinishQueue();
+  auto dump = comm->collTrace->dump();
+
+  // Only the most recent collectives are kept, the others are counted
+  ASSERT_EQ(dump.pastColls.size(), NCCL_COLLTRACE_RECORD_MAX);
+  for (int i = 0; i < NCCL_COLLTRACE_RECORD_MAX; i++) {
+    auto& coll = dump.pastColls[i];
+    EXPECT_EQ(coll.opCount, opCountStart + nColl - NCCL_COLLTRACE_RECORD_MAX + i);
+    EXPECT_EQ(coll.info.coll, ncclFuncAllReduce);
+    EXPECT_EQ(coll.info.comm, comm);
+    EXPECT_EQ(coll.info.count, count);
+    EXPECT_EQ(coll.info.datatype, ncclInt);
+    EXPECT_GE(coll.latency, 0);
+  }
+  EXPECT_EQ(dump.pastCollsStats.nRecords, nColl);
+  EXPECT_EQ(dump.pastCollsStats.nDropped, nColl - NCCL_COLLTRACE_RECORD_MAX);
+  EXPECT_EQ(dump.pastCollsStats.capacity, NCCL_COLLTRACE_RECORD_MAX);
+
+  NCCLCHECK_TEST(ncclCommDestroy(comm));
+
+  NCCL_COLLTRACE.clear();
+  NCCL_COLLTRACE_RECORD_MAX = NCCL_COLLTRACE_RECORD_MAX_DEFAULT;
+}
+
+TEST_F(CollTraceTest, DumpSampledFixed) {
+  // overwrite CollTrace features before creating comm
+  NCCL_COLLTRACE.push_back("trace");
+  NCCL_COLLTRACE_SAMPLING = NCCL_COLLTRACE_SAMPLING::fixed;
+  NCCL_COLLTRACE_SAMPLE_INTERVAL = 4;
+  ncclComm_t comm =
+      createNcclComm(this->globalRank, this->numRanks, this->localRank);
+  const int count = 1048576;
+  const int nColl = 10;
+
+  uint64_t opCountStart = comm->opCount;
+  prepareAllreduce(count);
+  for (int i = 0; i < nColl; i++) {
+    NCCLCHECK_TEST(
+        ncclAllReduce(sendBuf, recvBuf, count, ncclInt, ncclSum, comm, stream));
+  }
+
+  EXPECT_TRUE(comm->collTrace != nullptr);
+  comm->collTrace->waitForWorkerFinishQueue();
+  auto dump = comm->collTrace->dump();
+
+  // Only the collectives with an opCount multiple of the interval are traced
+  int nSampled = 0;
+  for (int i = 0; i < nColl; i++) {
+    nSampled += (opCountStart + i) % NCCL_COLLTRACE_SAMPLE_INTERVAL == 0;
+  }
+  ASSERT_EQ(dump.pastColls.size(), nSampled);
+  for (auto& coll : dump.pastColls) {
+    EXPECT_EQ(coll.opCount % NCCL_COLLTRACE_SAMPLE_INTERVAL, 0);
+    EXPECT_GE(coll.latency, 0);
+  }
+
+  // All collectives are counted
+  ASSERT_EQ(dump.counters.size(), 1);
+  EXPECT_EQ(dump.counters[0].coll, ncclFuncAllReduce);
+  EXPECT_EQ(dump.counters[0].sizeBucket, count * sizeof(int));
+  EXPECT_EQ(dump.counters[0].nColls, nColl);
+  EXPECT_EQ(dump.counters[0].nSampled, nSampled);
+  EXPECT_EQ(dump.counters[0].nBytes, nColl * count * sizeof(int));
+
+  NCCLCHECK_TEST(ncclCommDestroy(comm));
+
+  NCCL_COLLTRACE.clear();
+  NCCL_COLLTRACE_SAMPLING = NCCL_COLLTRACE_SAMPLING_DEFAULT;
+  NCCL_COLLTRACE_SAMPLE_INTERVAL = NCCL_COLLTRACE_SAMPLE_INTERVAL_DEFAULT;
+}
+
+TEST_F(CollTraceTest, DumpSampledAdaptive) {
+  // overwrite CollTrace features before creating comm
+  NCCL_COLLTRACE.push_back("trace");
+  NCCL_COLLTRACE_SAMPLING = NCCL_COLLTRACE_SAMPLING::adaptive;
+  // At most one traced collective of each size per second
+  NCCL_COLLTRACE_SAMPLE_RATE = 1;
+  ncclComm_t comm =
+      createNcclComm(this->globalRank, this->numRanks, this->localRank);
+  const int count = 1048576;
+  const int nColl = 10;
+
+  prepareAllreduce(count);
+  for (int i = 0; i < nColl; i++) {
+    NCCLCHECK_TEST(
+        ncclAllReduce(sendBuf, recvBuf, count, ncclInt, ncclSum, comm, stream));
+  }
+  // A collective of a different size bucket is traced too
+  NCCLCHECK_TEST(
+      ncclAllReduce(sendBuf, recvBuf, 1, ncclInt, ncclSum, comm, stream));
+
+  EXPECT_TRUE(comm->collTrace != nullptr);
+  comm->collTrace->waitForWorkerFinishQueue();
+  auto dump = comm->collTrace->dump();
+
+  // The first collective of each size is traced, unless the loop took more
+  // than a second
+  EXPECT_GE(dump.pastColls.size(), 2);
+  EXPECT_LT(dump.pastColls.size(), nColl + 1);
+  EXPECT_EQ(dump.pastColls.back().info.count, 1);
+  ASSERT_EQ(dump.counters.size(), 2);
+  uint64_t nColls = 0;
+  for (auto& counter : dump.counters) {
+    EXPECT_GE(counter.nSampled, 1);
+    nColls += counter.nColls;
+  }
+  EXPECT_EQ(nColls, nColl + 1);
+
+  NCCLCHECK_TEST(ncclCommDestroy(comm));
+
+  NCCL_COLLTRACE.clear();
+  NCCL_COLLTRACE_SAMPLING = NCCL_COLLTRACE_SAMPLING_DEFAULT;
+  NCCL_COLLTRACE_SAMPLE_RATE = NCCL_COLLTRACE_SAMPLE_RATE_DEFAULT;
+}
+
 TEST_F(CollTraceTest, DumpWithUnfinished) {
   // overwrite CollTrace features before creating comm
   NCCL_COLLTRACE.push_back("trace");
@@ -0,0 +1,138 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// CPU-only microbenchmark of the per-record cost of the CollTrace file
+// formats. nColls collectives built by hand are written to a file in /tmp:
+//  - json: as dumpResultsToFile with NCCL_COLLTRACE_FILE_FORMAT=json, every
+//    record is serialized through CollTraceColl::serialize, then the list is
+//    written at once
+//  - binary: as the CollTrace worker thread with
+//    NCCL_COLLTRACE_FILE_FORMAT=binary, every record is appended to the mapped
+//    file, which is synced at the end
+// The binary file holds capacity records, wrapping around if nColls is larger.
+//
+// Usage: CollTraceFileBench [nColls] [capacity]
+
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "CollTrace.h"
+#include "CollTraceFile.h"
+#include "nccl_cvars.h"
+
+static CollTraceColl makeColl(uint64_t opCount) {
+  static const char* opNames[] = {"AllReduce", "AllGather", "ReduceScatter"};
+  CollTraceColl coll{};
+  coll.opCount = opCount;
+  coll.stream = reinterpret_cast<cudaStream_t>(0x1000);
+  coll.latency = 0.125 * (opCount % 64);
+  coll.info.opName = opNames[opCount % 3];
+  coll.info.coll = static_cast<ncclFunc_t>(opCount % 3);
+  coll.info.sendbuff = reinterpret_cast<void*>(0x7f0000001000 + opCount * 64);
+  coll.info.recvbuff = reinterpret_cast<void*>(0x7f0000002000 + opCount * 64);
+  coll.info.count = 1 << (opCount % 24);
+  coll.info.datatype = opCount % 2 ? ncclBfloat16 : ncclFloat;
+  coll.info.op = ncclSum;
+  coll.info.algorithm = NCCL_ALGO_RING;
+  coll.info.protocol = opCount % 2 ? NCCL_PROTO_LL128 : NCCL_PROTO_SIMPLE;
+  coll.info.pattern = ncclPatternRingTwice;
+  coll.info.nChannels = 16;
+  coll.info.nThreads = 512;
+  return coll;
+}
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static off_t fileSize(const std::string& path) {
+  std::ifstream f(path, std::ios::binary | std::ios::ate);
+  return f ? static_cast<off_t>(f.tellg()) : -1;
+}
+
+int main(int argc, char** argv) {
+  int nColls = argc > 1 ? atoi(argv[1]) : 100000;
+  int capacity = argc > 2 ? atoi(argv[2]) : nColls;
+  if (nColls < 1 || capacity < 1) {
+    fprintf(stderr, "nColls and capacity must be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  setenv("NCCL_DEBUG", "WARN", 0);
+  ncclCvarInit();
+
+  // Collectives as kept in the CollTrace history
+  std::vector<CollTraceRecord> records;
+  records.reserve(nColls);
+  for (int i = 0; i < nColls; i++) {
+    records.emplace_back(makeColl(i));
+  }
+  const std::string prefix =
+      "/tmp/nccl_colltrace_file_bench_" + std::to_string(getpid());
+
+  printf(
+      "%8s %10s %12s %12s %14s %12s\n",
+      "format",
+      "colls",
+      "time(ms)",
+      "ns/record",
+      "file(bytes)",
+      "bytes/record");
+
+  // json
+  std::string jsonPath = prefix + ".json";
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::vector<std::string> serializedResults;
+    serializedResults.reserve(records.size());
+    for (auto& record : records) {
+      serializedResults.push_back(record.toColl(nullptr).serialize(true));
+    }
+    std::string contents = serializeVec(serializedResults);
+    std::ofstream f(jsonPath);
+    f << contents;
+  }
+  double jsonNs = elapsedNs(start);
+  off_t jsonBytes = fileSize(jsonPath);
+  unlink(jsonPath.c_str());
+
+  // binary
+  std::string binaryPath = prefix + ".nccltrace";
+  start = std::chrono::steady_clock::now();
+  {
+    auto file = CollTraceFile::create(binaryPath, 0xbe4c, 0, capacity);
+    if (!file) {
+      return EXIT_FAILURE;
+    }
+    for (auto& record : records) {
+      file->append(record.toColl(nullptr));
+    }
+    file->sync();
+  }
+  double binaryNs = elapsedNs(start);
+  off_t binaryBytes = fileSize(binaryPath);
+  unlink(binaryPath.c_str());
+
+  printf(
+      "%8s %10d %12.2f %12.1f %14ld %12.1f\n",
+      "json",
+      nColls,
+      jsonNs / 1e6,
+      jsonNs / nColls,
+      jsonBytes,
+      static_cast<double>(jsonBytes) / nColls);
+  printf(
+      "%8s %10d %12.2f %12.1f %14ld %12.1f\n",
+      "binary",
+      nColls,
+      binaryNs / 1e6,
+      binaryNs / nColls,
+      binaryBytes,
+      static_cast<double>(binaryBytes) / nColls);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <gtest/gtest.h>
+#include <nccl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+#include "CollTrace.h"
+#include "CollTraceFile.h"
+#include "nccl_cvars.h"
+
+// These tests write collectives built by hand to a binary CollTrace file and
+// decode it back, so no GPU is needed.
+class CollTraceFileUT : public ::testing::Test {
+ public:
+  CollTraceFileUT() = default;
+
+  void SetUp() override {
+    ncclCvarInit();
+    path_ = "/tmp/colltrace_file_ut_" + std::to_string(getpid()) + ".nccltrace";
+  }
+
+  void TearDown() override {
+    unlink(path_.c_str());
+  }
+
+  CollTraceColl makeColl(uint64_t opCount) {
+    CollTraceColl coll{};
+    coll.opCount = opCount;
+    coll.iteration = opCount / 4;
+    coll.stream = reinterpret_cast<cudaStream_t>(0x1000);
+    coll.latency = opCount % 5 ? 0.25 * opCount : -1;
+    coll.info.sendbuff = reinterpret_cast<void*>(0x7f0000001000 + opCount);
+    coll.info.recvbuff = reinterpret_cast<void*>(0x7f0000002000 + opCount);
+    coll.info.count = 1024 * (opCount + 1);
+    coll.info.root = opCount % 3 - 1;
+    coll.info.channelId = opCount % 4;
+    coll.info.nChannels = 8;
+    coll.info.nThreads = 512;
+    switch (opCount % 3) {
+      case 0:
+        coll.info.opName = "AllReduce";
+        coll.info.coll = ncclFuncAllReduce;
+        coll.info.datatype = ncclFloat;
+        coll.info.op = ncclSum;
+        coll.info.algorithm = NCCL_ALGO_RING;
+        coll.info.protocol = NCCL_PROTO_SIMPLE;
+        coll.info.pattern = ncclPatternRingTwice;
+        break;
+      case 1:
+        coll.info.opName = "AllGather";
+        coll.info.coll = ncclFuncAllGather;
+        coll.info.datatype = ncclBfloat16;
+        coll.info.op = ncclMax;
+        coll.info.algorithm = NCCL_ALGO_TREE;
+        coll.info.protocol = NCCL_PROTO_LL128;
+        coll.info.pattern = ncclPatternRing;
+        break;
+      default:
+        // grouped p2p, see COLLTRACE_RECORD_END_EVENT
+        coll.info.opName = "SendRecv";
+        coll.info.coll = ncclFuncSendRecv;
+        coll.info.datatype = ncclInt8;
+        coll.info.op = ncclSum;
+        coll.info.algorithm = -1;
+        coll.info.protocol = -1;
+        coll.info.pattern = ncclPatternSend;
+        break;
+    }
+    return coll;
+  }
+
+ protected:
+  std::string path_;
+  const uint64_t commHash_{0xfaceb00c};
+  const int rank_{3};
+};
+
+TEST_F(CollTraceFileUT, DecodeMatchesJson) {
+  const int nColls = 50;
+  auto file = CollTraceFile::create(path_, commHash_, rank_, 1000);
+  ASSERT_NE(file, nullptr);
+  for (int i = 0; i < nColls; i++) {
+    file->append(makeColl(i));
+  }
+
+  // The file can be decoded while the writer still has it mapped
+  CollTraceFileReader reader;
+  ASSERT_TRUE(reader.open(path_));
+  EXPECT_EQ(reader.header().commHash, commHash_);
+  EXPECT_EQ(reader.header().rank, rank_);
+  EXPECT_EQ(reader.header().nRecords, nColls);
+  ASSERT_EQ(reader.records().size(), nColls);
+  for (int i = 0; i < nColls; i++) {
+    EXPECT_EQ(reader.toJson(reader.records()[i]), makeColl(i).serialize(true));
+  }
+
+  // Names are stored once: 3 opNames, 3 datatypes, 2 redOps, 3 algorithms,
+  // 2 protocols besides "N/A" and 2 patterns besides "Ring"
+  EXPECT_EQ(reader.header().nStrings, 15);
+  EXPECT_EQ(reader.str(reader.records()[2].algorithm), "N/A");
+  EXPECT_EQ(reader.str(COLLTRACE_FILE_NO_STRING), "N/A");
+}
+
+TEST_F(CollTraceFileUT, WrapAround) {
+  const int capacity = 16;
+  const int nColls = 100;
+  auto file = CollTraceFile::create(path_, commHash_, rank_, capacity);
+  ASSERT_NE(file, nullptr);
+  for (int i = 0; i < nColls; i++) {
+    file->append(makeColl(i));
+  }
+  file.reset();
+
+  // Only the most recent collectives are kept, oldest first, without the
+  // slot the next record is written to
+  CollTraceFileReader reader;
+  ASSERT_TRUE(reader.open(path_));
+  EXPECT_EQ(reader.header().nRecords, nColls);
+  ASSERT_EQ(reader.records().size(), capacity - 1);
+  for (int i = 0; i < capacity - 1; i++) {
+    uint64_t opCount = nColls - capacity + 1 + i;
+    EXPECT_EQ(reader.records()[i].opCount, opCount);
+    EXPECT_EQ(
+        reader.toJson(reader.records()[i]), makeColl(opCount).serialize(true));
+  }
+}
+
+TEST_F(CollTraceFileUT, CsvValues) {
+  auto file = CollTraceFile::create(path_, commHash_, rank_, 4);
+  ASSERT_NE(file, nullptr);
+  file->append(makeColl(1));
+  file->sync();
+
+  CollTraceFileReader reader;
+  ASSERT_TRUE(reader.open(path_));
+  ASSERT_EQ(reader.records().size(), 1);
+  auto keys = CollTraceFileReader::keys();
+  auto values = reader.values(reader.records()[0], false);
+  ASSERT_EQ(keys.size(), values.size());
+  EXPECT_EQ(values[1], "AllGather");
+  EXPECT_EQ(values[5], "ncclBfloat16");
+  EXPECT_EQ(values[8], "Tree");
+  EXPECT_EQ(values[9], "LL128");
+  EXPECT_EQ(values[14], std::to_string(0.25f * 1000));
+}
+
+TEST_F(CollTraceFileUT, InvalidFile) {
+  CollTraceFileReader reader;
+  EXPECT_FALSE(reader.open(path_));
+
+  FILE* f = fopen(path_.c_str(), "w");
+  ASSERT_NE(f, nullptr);
+  fprintf(f, "[{\"opCount\": 0}]");
+  fclose(f);
+  EXPECT_FALSE(reader.open(path_));
+
+  EXPECT_EQ(CollTraceFile::create("/nonexistent/dir/trace", 0, 0, 4), nullptr);
+}
@@ -0,0 +1,276 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "CommDumpBinary.h"
+#include "HangAnalyzer.h"
+
+// These tests analyze synthetic dumps of hung communicators built by hand, so
+// no GPU is needed.
+class HangAnalyzerUT : public ::testing::Test {
+ public:
+  HangAnalyzerUT() = default;
+
+  // Dump of a rank in the format of ncclCommDumpBinary
+  struct RankDump {
+    int rank{0};
+    std::vector<CommDumpCollRecord> pastColls;
+    std::vector<CommDumpCollRecord> pendingColls;
+    std::vector<CommDumpCollRecord> currentColl;
+    std::vector<CommDumpProxyOpRecord> activeOps;
+    std::vector<CommDumpCtranPeerRecord> ctranPeers;
+  };
+
+  template <typename T>
+  static void append(std::string& buf, const std::vector<T>& records) {
+    buf.append(
+        reinterpret_cast<const char*>(records.data()),
+        records.size() * sizeof(T));
+  }
+
+  std::string serialize(const RankDump& dump) {
+    CommDumpBinaryHeader header{};
+    memcpy(header.magic, COMM_DUMP_BINARY_MAGIC, sizeof(header.magic));
+    header.version = COMM_DUMP_BINARY_VERSION;
+    header.headerSize = sizeof(header);
+    header.commHash = commHash_;
+    header.rank = dump.rank;
+    header.nRanks = nRanks_;
+    header.flags = COMM_DUMP_BINARY_COLLTRACE | COMM_DUMP_BINARY_PROXYTRACE |
+        COMM_DUMP_BINARY_CTRAN;
+    if (!dump.currentColl.empty()) {
+      header.flags |= COMM_DUMP_BINARY_CURRENT_COLL;
+    }
+    header.ctPastCollsNRecords = dump.pastColls.size();
+    header.nCtPastColls = dump.pastColls.size();
+    header.nCtPendingColls = dump.pendingColls.size();
+    header.nPtActiveOps = dump.activeOps.size();
+    header.nCtranPeers = dump.ctranPeers.size();
+    header.collRecordSize = sizeof(CommDumpCollRecord);
+    header.proxyCollRecordSize = sizeof(CommDumpProxyCollRecord);
+    header.proxyOpRecordSize = sizeof(CommDumpProxyOpRecord);
+    header.ctranPeerRecordSize = sizeof(CommDumpCtranPeerRecord);
+
+    std::string buf(reinterpret_cast<const char*>(&header), sizeof(header));
+    append(buf, dump.pastColls);
+    append(buf, dump.pendingColls);
+    append(buf, dump.currentColl);
+    append(buf, dump.activeOps);
+    append(buf, dump.ctranPeers);
+    return buf;
+  }
+
+  // Rank that completed nColls collectives and is running the next one
+  RankDump runningRank(int rank, uint64_t nColls) {
+    RankDump dump;
+    dump.rank = rank;
+    for (uint64_t i = 0; i < nColls; i++) {
+      dump.pastColls.push_back(coll(i));
+    }
+    dump.currentColl.push_back(coll(nColls));
+    return dump;
+  }
+
+  // Rank that completed nColls collectives and is idle
+  RankDump idleRank(int rank, uint64_t nColls) {
+    auto dump = runningRank(rank, nColls);
+    dump.currentColl.clear();
+    return dump;
+  }
+
+  static CommDumpCollRecord coll(uint64_t opCount) {
+    CommDumpCollRecord rec{};
+    rec.opCount = opCount;
+    return rec;
+  }
+
+  // Network op with the given steps POSTED, RECEIVED, TRANSMITTED, DONE
+  static CommDumpProxyOpRecord proxyOp(
+      int rank,
+      int remoteRank,
+      bool send,
+      uint64_t opCount,
+      int channelId,
+      std::vector<int> steps) {
+    CommDumpProxyOpRecord rec{};
+    rec.opCount = opCount;
+    rec.rank = rank;
+    rec.remoteRank = remoteRank;
+    rec.opType = send ? 0 : 1;
+    rec.channelId = channelId;
+    rec.nSteps = 8;
+    for (int i = 0; i < 4; i++) {
+      rec.step[i] = steps[i];
+    }
+    return rec;
+  }
+
+  // Ring where each rank receives from the previous one. All ranks wait for
+  // data from the previous rank, except stuckRank whose own kernel is stuck
+  // and thus neither consumes data nor produces data for the next rank.
+  void addRing(HangAnalyzer& analyzer, int stuckRank, uint64_t opCount) {
+    for (int rank = 0; rank < nRanks_; rank++) {
+      auto dump = runningRank(rank, opCount);
+      int prev = (rank + nRanks_ - 1) % nRanks_;
+      int next = (rank + 1) % nRanks_;
+      if (rank == stuckRank) {
+        dump.activeOps.push_back(
+            proxyOp(rank, prev, false, opCount, 0, {4, 4, 4, 2}));
+        dump.activeOps.push_back(
+            proxyOp(rank, next, true, opCount, 0, {4, 0, 2, 2}));
+      } else {
+        dump.activeOps.push_back(
+            proxyOp(rank, prev, false, opCount, 0, {4, 2, 2, 2}));
+        dump.activeOps.push_back(
+            proxyOp(rank, next, true, opCount, 0, {4, 0, 2, 2}));
+      }
+      ASSERT_TRUE(analyzer.addDump(serialize(dump)));
+    }
+  }
+
+ protected:
+  uint64_t commHash_{0xabcdef};
+  int nRanks_{8};
+};
+
+TEST_F(HangAnalyzerUT, InvalidDump) {
+  HangAnalyzer analyzer;
+  EXPECT_FALSE(analyzer.addDump(""));
+  EXPECT_FALSE(analyzer.addDump(std::string(sizeof(CommDumpBinaryHeader), 'x')));
+  EXPECT_FALSE(analyzer.addDumpFile("/nonexistent/nccl_dump"));
+  EXPECT_TRUE(analyzer.analyze().empty());
+}
+
+TEST_F(HangAnalyzerUT, NotHung) {
+  HangAnalyzer analyzer;
+  for (int rank = 0; rank < nRanks_; rank++) {
+    ASSERT_TRUE(analyzer.addDump(serialize(idleRank(rank, 5))));
+  }
+  auto reports = analyzer.analyze();
+  ASSERT_EQ(reports.size(), 1);
+  EXPECT_EQ(reports[0].commHash, commHash_);
+  EXPECT_EQ(reports[0].nRanks, nRanks_);
+  EXPECT_FALSE(reports[0].hung);
+  EXPECT_TRUE(reports[0].missingRanks.empty());
+  EXPECT_TRUE(reports[0].culprits.empty());
+}
+
+TEST_F(HangAnalyzerUT, LaggingRank) {
+  // All ranks are in opCount 5 except rank 3, which only completed 4
+  HangAnalyzer analyzer;
+  for (int rank = 0; rank < nRanks_; rank++) {
+    auto dump = rank == 3 ? idleRank(rank, 4) : runningRank(rank, 5);
+    ASSERT_TRUE(analyzer.addDump(serialize(dump)));
+  }
+  auto report = analyzer.analyze().at(0);
+  EXPECT_TRUE(report.hung);
+  EXPECT_EQ(report.hungOpCount, 5);
+  EXPECT_EQ(report.laggingRanks, std::vector<int>{3});
+  ASSERT_EQ(report.culprits.size(), 1);
+  EXPECT_EQ(report.culprits[0].rank, 3);
+  EXPECT_TRUE(report.culprits[0].lagging);
+  EXPECT_EQ(report.culprits[0].lastCompletedOpCount, 3);
+  EXPECT_EQ(report.culprits[0].nWaiters, nRanks_ - 1);
+  EXPECT_NE(
+      report.toString().find("1 ranks have not issued opCount 5: 3"),
+      std::string::npos);
+}
+
+TEST_F(HangAnalyzerUT, RingStuckRank) {
+  HangAnalyzer analyzer;
+  addRing(analyzer, 5, 10);
+  auto report = analyzer.analyze().at(0);
+  EXPECT_TRUE(report.hung);
+  EXPECT_EQ(report.hungOpCount, 10);
+  EXPECT_TRUE(report.laggingRanks.empty());
+  EXPECT_TRUE(report.cycles.empty());
+  ASSERT_EQ(report.culprits.size(), 1);
+
+  // Every other rank waits for rank 5 through the ring
+  auto& culprit = report.culprits[0];
+  EXPECT_EQ(culprit.rank, 5);
+  EXPECT_EQ(culprit.nWaiters, nRanks_ - 1);
+  EXPECT_EQ(culprit.inFlightOpCount, 10);
+  ASSERT_EQ(culprit.localOps.size(), 2);
+  EXPECT_EQ(culprit.localOps[0].kind, HangAnalyzerWait::Kind::PROXY_LOCAL);
+  EXPECT_EQ(culprit.localOps[0].channelId, 0);
+  EXPECT_EQ(culprit.localOps[0].step, 2);
+  ASSERT_EQ(culprit.waitedBy.size(), 1);
+  EXPECT_EQ(culprit.waitedBy[0].rank, 6);
+  EXPECT_EQ(culprit.waitedBy[0].kind, HangAnalyzerWait::Kind::PROXY_RECV);
+  EXPECT_NE(
+      report.toString().find("rank 5 (waited for by 7 ranks)"),
+      std::string::npos);
+}
+
+TEST_F(HangAnalyzerUT, MissingRank) {
+  HangAnalyzer analyzer;
+  for (int rank = 0; rank < nRanks_; rank++) {
+    if (rank == 2) {
+      continue;
+    }
+    auto dump = runningRank(rank, 1);
+    // Rank 1 sent data to rank 2, which never received it
+    if (rank == 1) {
+      dump.activeOps.push_back(proxyOp(rank, 2, true, 1, 3, {4, 0, 4, 1}));
+    }
+    ASSERT_TRUE(analyzer.addDump(serialize(dump)));
+  }
+  auto report = analyzer.analyze().at(0);
+  EXPECT_EQ(report.missingRanks, std::vector<int>{2});
+  ASSERT_EQ(report.culprits.size(), 1);
+  EXPECT_EQ(report.culprits[0].rank, 2);
+  EXPECT_TRUE(report.culprits[0].missing);
+  EXPECT_EQ(report.culprits[0].nWaiters, 1);
+  ASSERT_EQ(report.culprits[0].waitedBy.size(), 1);
+  EXPECT_EQ(
+      report.culprits[0].waitedBy[0].kind, HangAnalyzerWait::Kind::PROXY_SEND);
+  EXPECT_EQ(report.culprits[0].waitedBy[0].channelId, 3);
+  EXPECT_EQ(report.culprits[0].waitedBy[0].step, 1);
+}
+
+TEST_F(HangAnalyzerUT, CtranCycle) {
+  // Ranks 0 and 1 wait for control msgs from each other, others only wait
+  // for their kernels
+  HangAnalyzer analyzer;
+  for (int rank = 0; rank < nRanks_; rank++) {
+    auto dump = runningRank(rank, 7);
+    if (rank < 2) {
+      CommDumpCtranPeerRecord peer{};
+      peer.peer = 1 - rank;
+      peer.recvCtrl = 1;
+      peer.waitNotify = 1;
+      dump.ctranPeers.push_back(peer);
+    }
+    ASSERT_TRUE(analyzer.addDump(serialize(dump)));
+  }
+  auto report = analyzer.analyze().at(0);
+  EXPECT_TRUE(report.hung);
+  EXPECT_TRUE(report.culprits.empty());
+  ASSERT_EQ(report.cycles.size(), 1);
+  EXPECT_EQ(report.cycles[0], (std::vector<int>{0, 1}));
+  EXPECT_NE(
+      report.toString().find("2 ranks waiting for each other: 0, 1"),
+      std::string::npos);
+}
+
+TEST_F(HangAnalyzerUT, LargeRing) {
+  // Dumps of 10k ranks are analyzed in well under a second
+  nRanks_ = 10000;
+  HangAnalyzer analyzer;
+  addRing(analyzer, 1234, 100);
+
+  auto start = std::chrono::steady_clock::now();
+  auto report = analyzer.analyze().at(0);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  ASSERT_EQ(report.culprits.size(), 1);
+  EXPECT_EQ(report.culprits[0].rank, 1234);
+  EXPECT_EQ(report.culprits[0].nWaiters, nRanks_ - 1);
+  EXPECT_EQ(report.nWaits, nRanks_ - 1);
+  EXPECT_LT(
+      std::chrono::duration_cast<std::chrono::seconds>(elapsed).count(), 5);
+}
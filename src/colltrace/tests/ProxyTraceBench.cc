@@ -0,0 +1,142 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// CPU-only microbenchmark of the per-step overhead of ProxyTrace on the proxy
+// thread. A thread replays the trace calls of sendProxyProgress for nColls
+// collectives of nSubs ops with nSteps steps each (start, POSTED, TRANSMITTED
+// and DONE for every step, complete), without any network operation, with:
+//  - off: no trace, only the check of PROXY_TRACE_CALL
+//  - trace: NCCL_PROXYTRACE=trace, maps updated under a mutex
+//  - ring: NCCL_PROXYTRACE=ring, records written to the ring buffer
+// With dumpIntervalUs > 0, another thread dumps the trace at that interval,
+// as ncclCommDump would, and contends with the proxy thread in trace mode.
+//
+// Usage: ProxyTraceBench [nColls] [nSubs] [nSteps] [dumpIntervalUs]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ProxyTrace.h"
+#include "nccl_cvars.h"
+#include "proxy.h"
+
+static const uint64_t commHash = 0xbe4c;
+
+static ncclResult_t replay(
+    struct ncclProxyState* proxyState,
+    struct ncclProxyArgs* args,
+    int nColls,
+    int nSteps) {
+  for (int i = 0; i < nColls; i++) {
+    for (int s = 0; s < args->nsubs; s++) {
+      args->subs[s].traceArgs = ProxyTraceArgs();
+      args->subs[s].traceArgs.collInfo.commHash = commHash;
+      args->subs[s].traceArgs.collInfo.opCount = i;
+      args->subs[s].traceArgs.collInfo.nChannels = args->nsubs;
+      args->subs[s].traceArgs.collInfo.coll = ncclFuncAllReduce;
+    }
+    PROXY_TRACE_CALL(proxyState, proxyState->trace->startSend(args));
+    for (int step = 1; step <= nSteps; step++) {
+      for (int s = 0; s < args->nsubs; s++) {
+        args->subs[s].traceArgs.transSize += args->subs[s].nbytes;
+        PROXY_TRACE_CALL(
+            proxyState,
+            proxyState->trace->recordSendProgress(
+                args, s, step, ProxyOpStepStatus::POSTED));
+        PROXY_TRACE_CALL(
+            proxyState,
+            proxyState->trace->recordSendProgress(
+                args, s, step, ProxyOpStepStatus::TRANSMITTED));
+        PROXY_TRACE_CALL(
+            proxyState,
+            proxyState->trace->recordSendProgress(
+                args, s, step, ProxyOpStepStatus::DONE));
+      }
+    }
+    PROXY_TRACE_CALL(proxyState, proxyState->trace->completeSend(args));
+  }
+  return ncclSuccess;
+}
+
+int main(int argc, char** argv) {
+  int nColls = argc > 1 ? atoi(argv[1]) : 10000;
+  int nSubs = argc > 2 ? atoi(argv[2]) : 8;
+  int nSteps = argc > 3 ? atoi(argv[3]) : 16;
+  int dumpIntervalUs = argc > 4 ? atoi(argv[4]) : 0;
+  if (nSubs < 1 || nSubs > NCCL_PROXY_MAX_SUBS) {
+    fprintf(stderr, "nSubs must be in [1, %d]\n", NCCL_PROXY_MAX_SUBS);
+    return EXIT_FAILURE;
+  }
+
+  setenv("NCCL_DEBUG", "WARN", 0);
+  ncclCvarInit();
+
+  auto args = std::unique_ptr<struct ncclProxyArgs>(new ncclProxyArgs());
+  std::vector<struct ncclProxySubArgs> subs(nSubs);
+  args->subs = subs.data();
+  args->nsubs = nSubs;
+  for (int s = 0; s < nSubs; s++) {
+    args->subs[s].channelId = s;
+    args->subs[s].nsteps = nSteps;
+    args->subs[s].nbytes = 1 << 19;
+  }
+
+  printf(
+      "%8s %8s %8s %8s %10s %12s %12s %10s\n",
+      "mode",
+      "colls",
+      "subs",
+      "steps",
+      "dump(us)",
+      "time(ms)",
+      "ns/step",
+      "dumps");
+  for (std::string mode : {"off", "trace", "ring"}) {
+    NCCL_PROXYTRACE.clear();
+    auto proxyState = std::unique_ptr<struct ncclProxyState>(
+        new ncclProxyState());
+    if (mode != "off") {
+      NCCL_PROXYTRACE.push_back(mode);
+      proxyState->trace = std::unique_ptr<ProxyTrace>(new ProxyTrace());
+    }
+
+    std::atomic<bool> stop{false};
+    int nDumps = 0;
+    std::thread dumper([&]() {
+      while (dumpIntervalUs > 0 && !stop.load() && proxyState->trace) {
+        proxyState->trace->dump(commHash);
+        nDumps++;
+        std::this_thread::sleep_for(std::chrono::microseconds(dumpIntervalUs));
+      }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    ncclResult_t res = replay(proxyState.get(), args.get(), nColls, nSteps);
+    double ns = std::chrono::duration<double, std::nano>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    stop = true;
+    dumper.join();
+    if (res != ncclSuccess) {
+      fprintf(stderr, "Trace failed in %s mode\n", mode.c_str());
+      return EXIT_FAILURE;
+    }
+
+    printf(
+        "%8s %8d %8d %8d %10d %12.2f %12.1f %10d\n",
+        mode.c_str(),
+        nColls,
+        nSubs,
+        nSteps,
+        dumpIntervalUs,
+        ns / 1e6,
+        ns / (static_cast<double>(nColls) * nSubs * nSteps),
+        nDumps);
+  }
+  NCCL_PROXYTRACE.clear();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,396 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <gtest/gtest.h>
+#include <nccl.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "ProxyTrace.h"
+#include "nccl_cvars.h"
+#include "proxy.h"
+
+// These tests drive ProxyTrace with proxy args built by hand, following the
+// calls of sendProxyProgress and recvProxyProgress, so no GPU is needed.
+class ProxyTraceUT : public ::testing::Test {
+ public:
+  ProxyTraceUT() = default;
+
+  void SetUp() override {
+    ncclCvarInit();
+    args_ = newArgs();
+  }
+
+  void TearDown() override {
+    NCCL_PROXYTRACE.clear();
+    NCCL_PROXYTRACE_RING_SIZE = NCCL_PROXYTRACE_RING_SIZE_DEFAULT;
+    NCCL_PROXYTRACE_RECORD_MAX = NCCL_PROXYTRACE_RECORD_MAX_DEFAULT;
+    NCCL_PROXYTRACE_RECORD_MAX_BYTES = NCCL_PROXYTRACE_RECORD_MAX_BYTES_DEFAULT;
+  }
+
+  // Args with room for the maximum number of subs, which the proxy allocates
+  // separately
+  std::unique_ptr<struct ncclProxyArgs> newArgs() {
+    auto args = std::unique_ptr<struct ncclProxyArgs>(new ncclProxyArgs());
+    subs_.emplace_back(NCCL_PROXY_MAX_SUBS);
+    args->subs = subs_.back().data();
+    return args;
+  }
+
+  std::unique_ptr<ProxyTrace> createTrace(const std::string& feature) {
+    NCCL_PROXYTRACE.clear();
+    NCCL_PROXYTRACE.push_back(feature);
+    return std::unique_ptr<ProxyTrace>(new ProxyTrace());
+  }
+
+  // Set up args for nSubs ops of a collective, one per channel
+  void setArgs(
+      struct ncclProxyArgs* args,
+      uint64_t opCount,
+      ncclFunc_t coll,
+      int nSubs,
+      int remoteRank) {
+    args->nsubs = nSubs;
+    for (int s = 0; s < nSubs; s++) {
+      auto sub = &args->subs[s];
+      sub->channelId = s;
+      sub->nsteps = nSteps_;
+      sub->nbytes = stepSize_;
+      sub->traceArgs = ProxyTraceArgs();
+      sub->traceArgs.collInfo.commHash = commHash_;
+      sub->traceArgs.collInfo.opCount = opCount;
+      sub->traceArgs.collInfo.nChannels = nSubs;
+      sub->traceArgs.collInfo.coll = coll;
+      sub->traceArgs.rank = 0;
+      sub->traceArgs.remoteRank = remoteRank;
+    }
+  }
+
+  void setArgs(uint64_t opCount, ncclFunc_t coll, int nSubs, int remoteRank) {
+    setArgs(args_.get(), opCount, coll, nSubs, remoteRank);
+  }
+
+  static ncclResult_t start(
+      ProxyTrace* trace,
+      struct ncclProxyArgs* args,
+      ProxyTraceOp::OpType opType) {
+    return opType == ProxyTraceOp::OpType::SEND ? trace->startSend(args)
+                                                : trace->startRecv(args);
+  }
+
+  // Record all statuses of a step for every op of args
+  ncclResult_t progress(
+      ProxyTrace* trace,
+      struct ncclProxyArgs* args,
+      ProxyTraceOp::OpType opType,
+      int step) {
+    bool send = opType == ProxyTraceOp::OpType::SEND;
+    for (int s = 0; s < args->nsubs; s++) {
+      args->subs[s].traceArgs.transSize += stepSize_;
+      for (auto status :
+           {ProxyOpStepStatus::POSTED,
+            send ? ProxyOpStepStatus::TRANSMITTED
+                 : ProxyOpStepStatus::RECEIVED,
+            ProxyOpStepStatus::DONE}) {
+        NCCLCHECK(
+            send ? trace->recordSendProgress(args, s, step, status)
+                 : trace->recordRecvProgress(args, s, step, status));
+      }
+    }
+    return ncclSuccess;
+  }
+
+  static ncclResult_t complete(
+      ProxyTrace* trace,
+      struct ncclProxyArgs* args,
+      ProxyTraceOp::OpType opType) {
+    return opType == ProxyTraceOp::OpType::SEND ? trace->completeSend(args)
+                                                : trace->completeRecv(args);
+  }
+
+  // Run the ops of args_ up to the given step, and complete them if all steps
+  // are done
+  void runOps(ProxyTrace* trace, ProxyTraceOp::OpType opType, int lastStep) {
+    ASSERT_EQ(start(trace, args_.get(), opType), ncclSuccess);
+    for (int step = 1; step <= lastStep; step++) {
+      ASSERT_EQ(progress(trace, args_.get(), opType, step), ncclSuccess);
+    }
+    if (lastStep == nSteps_) {
+      ASSERT_EQ(complete(trace, args_.get(), opType), ncclSuccess);
+    }
+  }
+
+  // Send and recv ops of nColls collectives progressing together, leaving the
+  // ops of the last one at step 2
+  void runColls(ProxyTrace* trace, int nColls, uint64_t firstOpCount = 0) {
+    const auto send = ProxyTraceOp::OpType::SEND;
+    const auto recv = ProxyTraceOp::OpType::RECV;
+    auto recvArgs = newArgs();
+    for (int i = 0; i < nColls; i++) {
+      int lastStep = i == nColls - 1 ? 2 : nSteps_;
+      setArgs(args_.get(), firstOpCount + i, ncclFuncAllReduce, 4, 1);
+      setArgs(recvArgs.get(), firstOpCount + i, ncclFuncAllReduce, 4, 3);
+      ASSERT_EQ(start(trace, args_.get(), send), ncclSuccess);
+      ASSERT_EQ(start(trace, recvArgs.get(), recv), ncclSuccess);
+      for (int step = 1; step <= lastStep; step++) {
+        ASSERT_EQ(progress(trace, args_.get(), send, step), ncclSuccess);
+        ASSERT_EQ(progress(trace, recvArgs.get(), recv, step), ncclSuccess);
+      }
+      if (lastStep == nSteps_) {
+        ASSERT_EQ(complete(trace, recvArgs.get(), recv), ncclSuccess);
+        ASSERT_EQ(complete(trace, args_.get(), send), ncclSuccess);
+      }
+    }
+  }
+
+  static void expectSameOp(ProxyTraceOp& a, ProxyTraceOp& b) {
+    EXPECT_EQ(a.collInfo.opCount, b.collInfo.opCount);
+    EXPECT_EQ(a.collInfo.coll, b.collInfo.coll);
+    EXPECT_EQ(a.proxyOpId, b.proxyOpId);
+    EXPECT_EQ(a.channelId, b.channelId);
+    EXPECT_EQ(a.rank, b.rank);
+    EXPECT_EQ(a.remoteRank, b.remoteRank);
+    EXPECT_EQ(a.nSteps, b.nSteps);
+    EXPECT_EQ(a.stepSize, b.stepSize);
+    EXPECT_EQ(a.transSize, b.transSize);
+    EXPECT_EQ(a.opType, b.opType);
+    EXPECT_EQ(a.done, b.done);
+    for (int s = 0; s < NUM_STATUS; s++) {
+      EXPECT_EQ(a.stepRecords[s].step, b.stepRecords[s].step);
+    }
+  }
+
+  static void expectSameColl(ProxyTraceColl& a, ProxyTraceColl& b) {
+    EXPECT_EQ(a.collInfo.opCount, b.collInfo.opCount);
+    EXPECT_EQ(a.collInfo.coll, b.collInfo.coll);
+    EXPECT_EQ(a.collInfo.nChannels, b.collInfo.nChannels);
+    EXPECT_EQ(a.nProxyOps, b.nProxyOps);
+    EXPECT_EQ(a.totalSendSize, b.totalSendSize);
+    EXPECT_EQ(a.totalRecvSize, b.totalRecvSize);
+    EXPECT_EQ(a.channelIds, b.channelIds);
+  }
+
+ protected:
+  const uint64_t commHash_{0x9999};
+  const int nSteps_{8};
+  const size_t stepSize_{1 << 19};
+  std::unique_ptr<struct ncclProxyArgs> args_;
+  std::vector<std::vector<struct ncclProxySubArgs>> subs_;
+};
+
+TEST_F(ProxyTraceUT, RingDumpMatchesMapDump) {
+  auto mapTrace = createTrace("trace");
+  auto ringTrace = createTrace("ring");
+  runColls(mapTrace.get(), 5);
+  runColls(ringTrace.get(), 5);
+
+  auto mapDump = mapTrace->dump(commHash_);
+  auto ringDump = ringTrace->dump(commHash_);
+  ASSERT_EQ(mapDump.pastColls.size(), 4);
+  ASSERT_EQ(ringDump.pastColls.size(), mapDump.pastColls.size());
+  for (size_t i = 0; i < mapDump.pastColls.size(); i++) {
+    expectSameColl(ringDump.pastColls[i], mapDump.pastColls[i]);
+  }
+  ASSERT_EQ(ringDump.activeColls.size(), 1);
+  ASSERT_EQ(ringDump.activeColls.size(), mapDump.activeColls.size());
+  expectSameColl(ringDump.activeColls[0], mapDump.activeColls[0]);
+
+  // Active ops are dumped from a map, so compare them by proxyOpId
+  ASSERT_EQ(mapDump.activeOps.size(), 8);
+  ASSERT_EQ(ringDump.activeOps.size(), mapDump.activeOps.size());
+  std::sort(
+      mapDump.activeOps.begin(),
+      mapDump.activeOps.end(),
+      [](auto& a, auto& b) { return a.proxyOpId < b.proxyOpId; });
+  std::sort(
+      ringDump.activeOps.begin(),
+      ringDump.activeOps.end(),
+      [](auto& a, auto& b) { return a.proxyOpId < b.proxyOpId; });
+  for (size_t i = 0; i < mapDump.activeOps.size(); i++) {
+    expectSameOp(ringDump.activeOps[i], mapDump.activeOps[i]);
+    EXPECT_EQ(ringDump.activeOps[i].stepRecords[POSTED].step, 2);
+  }
+  EXPECT_EQ(ringTrace->droppedRecords(), 0);
+}
+
+TEST_F(ProxyTraceUT, RingAssignsProxyOpIds) {
+  auto trace = createTrace("ring");
+  // proxyOpIds count from 0 in each collective, as the proxy mock expects
+  setArgs(0, ncclFuncSend, 2, 1);
+  runOps(trace.get(), ProxyTraceOp::OpType::SEND, 1);
+  EXPECT_EQ(args_->subs[0].traceArgs.proxyOpId, 0);
+  EXPECT_EQ(args_->subs[1].traceArgs.proxyOpId, 1);
+  setArgs(0, ncclFuncRecv, 2, 1);
+  runOps(trace.get(), ProxyTraceOp::OpType::RECV, 1);
+  EXPECT_EQ(args_->subs[0].traceArgs.proxyOpId, 2);
+  EXPECT_EQ(args_->subs[1].traceArgs.proxyOpId, 3);
+  setArgs(1, ncclFuncSend, 2, 1);
+  runOps(trace.get(), ProxyTraceOp::OpType::SEND, 1);
+  EXPECT_EQ(args_->subs[0].traceArgs.proxyOpId, 0);
+  EXPECT_EQ(args_->subs[1].traceArgs.proxyOpId, 1);
+}
+
+TEST_F(ProxyTraceUT, RingSendRecvDetected) {
+  auto trace = createTrace("ring");
+  setArgs(7, ncclFuncSend, 1, 1);
+  runOps(trace.get(), ProxyTraceOp::OpType::SEND, nSteps_);
+  EXPECT_EQ(trace->dump(commHash_).pastColls.size(), 1);
+
+  // Grouped send and recv are traced with the function of the first op
+  setArgs(8, ncclFuncSend, 1, 1);
+  runOps(trace.get(), ProxyTraceOp::OpType::SEND, 1);
+  setArgs(8, ncclFuncRecv, 1, 1);
+  runOps(trace.get(), ProxyTraceOp::OpType::RECV, nSteps_);
+  setArgs(8, ncclFuncSend, 1, 1);
+  args_->subs[0].traceArgs.proxyOpId = 0;
+  args_->subs[0].traceArgs.transSize = stepSize_;
+  for (int step = 2; step <= nSteps_; step++) {
+    args_->subs[0].traceArgs.transSize += stepSize_;
+    ASSERT_EQ(
+        trace->recordSendProgress(args_.get(), 0, step, DONE), ncclSuccess);
+  }
+  ASSERT_EQ(trace->completeSend(args_.get()), ncclSuccess);
+
+  auto dump = trace->dump(commHash_);
+  ASSERT_EQ(dump.pastColls.size(), 2);
+  EXPECT_EQ(dump.pastColls[0].collInfo.coll, ncclFuncSend);
+  EXPECT_EQ(dump.pastColls[1].collInfo.coll, ncclFuncSendRecv);
+  EXPECT_EQ(dump.pastColls[1].totalSendSize, nSteps_ * stepSize_);
+  EXPECT_EQ(dump.activeOps.size(), 0);
+}
+
+TEST_F(ProxyTraceUT, RingOverflow) {
+  NCCL_PROXYTRACE_RING_SIZE = 100;
+  auto trace = createTrace("ring");
+  // Each op writes 2 + 3 * nSteps records, so only the last collective and a
+  // part of the one before are left in the ring
+  runColls(trace.get(), 5);
+  auto dump = trace->dump(commHash_);
+  EXPECT_GT(trace->droppedRecords(), 0);
+  EXPECT_LT(dump.pastColls.size(), 4);
+  ASSERT_EQ(dump.activeColls.size(), 1);
+  EXPECT_EQ(dump.activeColls[0].collInfo.opCount, 4);
+  EXPECT_EQ(dump.activeOps.size(), 8);
+
+  // Nothing is lost when dumping often enough
+  uint64_t dropped = trace->droppedRecords();
+  for (int i = 5; i < 10; i++) {
+    setArgs(i, ncclFuncAllReduce, 1, 1);
+    runOps(trace.get(), ProxyTraceOp::OpType::SEND, nSteps_);
+    dump = trace->dump(commHash_);
+    EXPECT_EQ(dump.pastColls.back().collInfo.opCount, i);
+  }
+  EXPECT_EQ(trace->droppedRecords(), dropped);
+}
+
+TEST_F(ProxyTraceUT, RingDumpWhileRecording) {
+  NCCL_PROXYTRACE_RING_SIZE = 64;
+  auto trace = createTrace("ring");
+  const int nColls = 2000;
+  std::thread proxyThread([&]() {
+    for (int i = 0; i < nColls; i++) {
+      setArgs(i, ncclFuncAllReduce, 2, 1);
+      runOps(trace.get(), ProxyTraceOp::OpType::SEND, nSteps_);
+    }
+  });
+  uint64_t lastOpCount = 0;
+  for (int i = 0; i < 200; i++) {
+    auto dump = trace->dump(commHash_);
+    for (auto& op : dump.activeOps) {
+      EXPECT_EQ(op.collInfo.coll, ncclFuncAllReduce);
+      EXPECT_LE(op.transSize, nSteps_ * stepSize_);
+    }
+    if (!dump.pastColls.empty()) {
+      EXPECT_GE(dump.pastColls.back().collInfo.opCount, lastOpCount);
+      lastOpCount = dump.pastColls.back().collInfo.opCount;
+    }
+  }
+  proxyThread.join();
+
+  auto dump = trace->dump(commHash_);
+  EXPECT_EQ(dump.activeOps.size(), 0);
+  ASSERT_FALSE(dump.pastColls.empty());
+  EXPECT_EQ(dump.pastColls.back().collInfo.opCount, nColls - 1);
+  EXPECT_EQ(dump.pastColls.back().nProxyOps, 2);
+  EXPECT_EQ(dump.pastColls.back().totalSendSize, 2 * nSteps_ * stepSize_);
+}
+
+class ProxyTraceHistoryUT : public ProxyTraceUT,
+                            public ::testing::WithParamInterface<std::string> {
+};
+
+TEST_P(ProxyTraceHistoryUT, BoundedPastColls) {
+  NCCL_PROXYTRACE_RECORD_MAX = 3;
+  auto trace = createTrace(GetParam());
+  runColls(trace.get(), 11);
+
+  // Only the most recent collectives are kept, the others are counted
+  auto dump = trace->dump(commHash_);
+  ASSERT_EQ(dump.pastColls.size(), 3);
+  for (int i = 0; i < 3; i++) {
+    auto& coll = dump.pastColls[i];
+    EXPECT_EQ(coll.collInfo.opCount, 7 + i);
+    EXPECT_EQ(coll.collInfo.coll, ncclFuncAllReduce);
+    EXPECT_EQ(coll.nProxyOps, 8);
+    EXPECT_EQ(coll.channelIds, std::unordered_set<int>({0, 1, 2, 3}));
+    EXPECT_EQ(coll.totalSendSize, 4 * nSteps_ * stepSize_);
+    EXPECT_EQ(coll.totalRecvSize, 4 * nSteps_ * stepSize_);
+  }
+  EXPECT_EQ(dump.pastCollsStats.nRecords, 10);
+  EXPECT_EQ(dump.pastCollsStats.nDropped, 7);
+  EXPECT_EQ(dump.pastCollsStats.capacity, 3);
+  EXPECT_EQ(dump.activeColls.size(), 1);
+
+  // Other communicators have their own history
+  EXPECT_EQ(trace->dump(commHash_ + 1).pastColls.size(), 0);
+}
+
+TEST_P(ProxyTraceHistoryUT, ByteBudget) {
+  NCCL_PROXYTRACE_RECORD_MAX = -1;
+  NCCL_PROXYTRACE_RECORD_MAX_BYTES = 5 * sizeof(ProxyTraceCollRecord);
+  auto trace = createTrace(GetParam());
+  runColls(trace.get(), 21);
+
+  auto dump = trace->dump(commHash_);
+  ASSERT_EQ(dump.pastColls.size(), 5);
+  EXPECT_EQ(dump.pastColls.back().collInfo.opCount, 19);
+  EXPECT_EQ(dump.pastCollsStats.nDropped, 15);
+  EXPECT_LE(dump.pastCollsStats.bytes, NCCL_PROXYTRACE_RECORD_MAX_BYTES);
+}
+
+TEST_P(ProxyTraceHistoryUT, DumpSince) {
+  NCCL_PROXYTRACE_RECORD_MAX = 5;
+  auto trace = createTrace(GetParam());
+  runColls(trace.get(), 4);
+
+  // Polling with the previous nRecords only returns new collectives
+  auto dump = trace->dump(commHash_);
+  ASSERT_EQ(dump.pastColls.size(), 3);
+  uint64_t cursor = dump.pastCollsStats.nRecords;
+  EXPECT_EQ(cursor, 3);
+  EXPECT_EQ(trace->dump(commHash_, cursor).pastColls.size(), 0);
+
+  runColls(trace.get(), 5, 4);
+  dump = trace->dump(commHash_, cursor);
+  ASSERT_EQ(dump.pastColls.size(), 4);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(dump.pastColls[i].collInfo.opCount, 4 + i);
+  }
+  cursor = dump.pastCollsStats.nRecords;
+
+  // Collectives dropped before being polled are skipped
+  runColls(trace.get(), 8, 10);
+  dump = trace->dump(commHash_, cursor);
+  EXPECT_GT(dump.pastCollsStats.nDropped, cursor);
+  ASSERT_EQ(dump.pastColls.size(), 5);
+  EXPECT_EQ(dump.pastColls.front().collInfo.opCount, 12);
+  EXPECT_EQ(dump.pastColls.back().collInfo.opCount, 16);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ProxyTraceHistoryUTInstance,
+    ProxyTraceHistoryUT,
+    ::testing::Values("trace", "ring"));
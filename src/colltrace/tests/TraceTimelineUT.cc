@@ -0,0 +1,176 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TraceTimeline.h"
+#include "json/json.h"
+
+class TraceTimelineUT : public ::testing::Test {
+ public:
+  TraceTimelineUT() = default;
+
+  static Json::Value parse(const std::string& str) {
+    Json::Value root;
+    Json::CharReaderBuilder builder;
+    std::string errs;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    EXPECT_TRUE(
+        reader->parse(str.data(), str.data() + str.size(), &root, &errs))
+        << errs;
+    return root;
+  }
+
+  // Status changes of a step: send POSTED, TRANSMITTED, DONE or recv POSTED,
+  // RECEIVED, TRANSMITTED, DONE at the given times
+  void addStep(
+      TraceTimeline& timeline,
+      uint64_t opCount,
+      int step,
+      bool send,
+      std::vector<int64_t> ts) {
+    std::vector<uint8_t> statuses = send
+        ? std::vector<uint8_t>{0, 2, 3}
+        : std::vector<uint8_t>{0, 1, 2, 3};
+    for (size_t i = 0; i < ts.size(); i++) {
+      TimelineStepEvent event;
+      event.ts = baseTs_ + ts[i];
+      event.opCount = opCount;
+      event.proxyOpId = send ? 0 : 1;
+      event.step = step;
+      event.peer = send ? 1 : 3;
+      event.channelId = 0;
+      event.opType = send ? 0 : 1;
+      event.status = statuses[i];
+      timeline.addStep(event);
+    }
+  }
+
+  // Thread names of the timeline by tid
+  static std::map<int, std::string> threadNames(const Json::Value& root) {
+    std::map<int, std::string> names;
+    for (auto& event : root["traceEvents"]) {
+      if (event["name"].asString() == "thread_name") {
+        names[event["tid"].asInt()] = event["args"]["name"].asString();
+      }
+    }
+    return names;
+  }
+
+ protected:
+  int64_t baseTs_{1700000000000000000L};
+};
+
+TEST_F(TraceTimelineUT, Empty) {
+  TraceTimeline timeline(0xabc, 2, 4);
+  auto root = parse(timeline.toJson());
+  EXPECT_EQ(root["otherData"]["commHash"].asString(), "abc");
+  EXPECT_EQ(root["otherData"]["rank"].asInt(), 2);
+  EXPECT_EQ(root["otherData"]["nRanks"].asInt(), 4);
+  for (auto& event : root["traceEvents"]) {
+    EXPECT_EQ(event["ph"].asString(), "M");
+  }
+}
+
+TEST_F(TraceTimelineUT, CollsAndSteps) {
+  TraceTimeline timeline(0xabc, 0, 4);
+  TimelineCollSpan coll;
+  coll.opCount = 7;
+  coll.opName = "AllReduce";
+  coll.startTs = baseTs_ + 1000;
+  coll.durationNs = 10000;
+  coll.nBytes = 1024;
+  coll.algorithm = "Ring";
+  coll.protocol = "Simple";
+  coll.nChannels = 1;
+  timeline.addColl(coll);
+
+  // Two sends overlapping and a third one after both, and a recv
+  addStep(timeline, 7, 1, true, {0, 2000, 5000});
+  addStep(timeline, 7, 2, true, {1000, 3000, 6000});
+  addStep(timeline, 7, 3, true, {6000, 7000, 9000});
+  addStep(timeline, 7, 1, false, {500, 4000, 4500, 8000});
+
+  auto root = parse(timeline.toJson());
+  EXPECT_EQ(root["otherData"]["baseTs"].asString(), std::to_string(baseTs_));
+
+  // collectives, proxy collectives, 2 send lanes and 1 recv lane
+  auto names = threadNames(root);
+  ASSERT_EQ(names.size(), 5);
+  EXPECT_EQ(names[0], "collectives");
+  EXPECT_EQ(names[1], "proxy collectives");
+  EXPECT_EQ(names[2], "ch0 send to 1 #0");
+  EXPECT_EQ(names[3], "ch0 send to 1 #1");
+  EXPECT_EQ(names[4], "ch0 recv from 3 #0");
+
+  std::map<std::string, std::vector<Json::Value>> slices;
+  for (auto& event : root["traceEvents"]) {
+    if (event["ph"].asString() == "X") {
+      slices[event["cat"].asString()].push_back(event);
+    }
+  }
+
+  ASSERT_EQ(slices["coll"].size(), 1);
+  auto& collSlice = slices["coll"][0];
+  EXPECT_EQ(collSlice["name"].asString(), "AllReduce");
+  EXPECT_DOUBLE_EQ(collSlice["ts"].asDouble(), 1.0);
+  EXPECT_DOUBLE_EQ(collSlice["dur"].asDouble(), 10.0);
+  EXPECT_EQ(collSlice["args"]["opCount"].asUInt64(), 7);
+  EXPECT_EQ(collSlice["args"]["algorithm"].asString(), "Ring");
+
+  ASSERT_EQ(slices["proxy_coll"].size(), 1);
+  EXPECT_EQ(slices["proxy_coll"][0]["name"].asString(), "AllReduce");
+  EXPECT_DOUBLE_EQ(slices["proxy_coll"][0]["ts"].asDouble(), 0.0);
+  EXPECT_DOUBLE_EQ(slices["proxy_coll"][0]["dur"].asDouble(), 9.0);
+
+  // Steps 1 and 2 overlap, step 3 reuses the lane of step 1
+  ASSERT_EQ(slices["proxy_step"].size(), 4);
+  std::map<int, std::vector<Json::Value>> stepsByTid;
+  for (auto& step : slices["proxy_step"]) {
+    stepsByTid[step["tid"].asInt()].push_back(step);
+    EXPECT_FALSE(step["args"].isMember("incomplete"));
+  }
+  ASSERT_EQ(stepsByTid[2].size(), 2);
+  EXPECT_EQ(stepsByTid[2][0]["name"].asString(), "step 1");
+  EXPECT_EQ(stepsByTid[2][1]["name"].asString(), "step 3");
+  ASSERT_EQ(stepsByTid[3].size(), 1);
+  EXPECT_EQ(stepsByTid[3][0]["name"].asString(), "step 2");
+  ASSERT_EQ(stepsByTid[4].size(), 1);
+  EXPECT_DOUBLE_EQ(stepsByTid[4][0]["ts"].asDouble(), 0.5);
+  EXPECT_DOUBLE_EQ(stepsByTid[4][0]["dur"].asDouble(), 7.5);
+
+  // 2 phases per send step and 3 per recv step, within their step
+  ASSERT_EQ(slices["proxy_phase"].size(), 3 * 2 + 3);
+  std::map<std::string, int> phaseNames;
+  for (auto& phase : slices["proxy_phase"]) {
+    phaseNames[phase["name"].asString()]++;
+    if (phase["tid"].asInt() == 4) {
+      EXPECT_GE(phase["ts"].asDouble(), 0.5);
+      EXPECT_LE(phase["ts"].asDouble() + phase["dur"].asDouble(), 8.0);
+    }
+  }
+  EXPECT_EQ(phaseNames["gpu"], 4);
+  EXPECT_EQ(phaseNames["net"], 4);
+  EXPECT_EQ(phaseNames["flush"], 1);
+}
+
+TEST_F(TraceTimelineUT, IncompleteStep) {
+  TraceTimeline timeline(0xabc, 0, 2);
+  // Send never done, only POSTED and TRANSMITTED
+  addStep(timeline, 3, 1, true, {0, 2000});
+
+  auto root = parse(timeline.toJson());
+  int nSteps = 0;
+  for (auto& event : root["traceEvents"]) {
+    if (event["cat"].asString() == "proxy_step") {
+      nSteps++;
+      EXPECT_TRUE(event["args"]["incomplete"].asBool());
+      EXPECT_DOUBLE_EQ(event["dur"].asDouble(), 2.0);
+    }
+  }
+  EXPECT_EQ(nSteps, 1);
+  // Proxy collective named after its opCount without CollTrace
+  EXPECT_NE(timeline.toJson().find("\"opCount 3\""), std::string::npos);
+}
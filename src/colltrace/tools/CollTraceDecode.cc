@@ -0,0 +1,76 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// Decoder of the binary CollTrace files written with
+// NCCL_COLLTRACE_FILE_FORMAT=binary. Prints the collectives of the given files,
+// oldest first, as a json list in the format of the json CollTrace file, or
+// as CSV with the rank and commHash of each file. Only depends on
+// CollTraceFile.h, so it can be built without NCCL:
+//   g++ -std=c++17 -I.. CollTraceDecode.cc -o CollTraceDecode
+//
+// Usage: CollTraceDecode [--csv] file...
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "CollTraceFile.h"
+
+int main(int argc, char** argv) {
+  bool csv = false;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--csv") == 0) {
+      csv = true;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty()) {
+    fprintf(stderr, "Usage: %s [--csv] file...\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (csv) {
+    printf("rank,commHash");
+    for (auto& key : CollTraceFileReader::keys()) {
+      printf(",%s", key.c_str());
+    }
+    printf("\n");
+  } else {
+    printf("[");
+  }
+
+  bool first = true;
+  for (auto& path : paths) {
+    CollTraceFileReader reader;
+    if (!reader.open(path)) {
+      fprintf(stderr, "%s is not a valid CollTrace file\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+    if (reader.header().nRecords > reader.records().size()) {
+      fprintf(
+          stderr,
+          "%s: %lu oldest collectives were overwritten\n",
+          path.c_str(),
+          reader.header().nRecords - reader.records().size());
+    }
+    for (auto& rec : reader.records()) {
+      if (csv) {
+        printf("%d,%lx", reader.header().rank, reader.header().commHash);
+        for (auto& value : reader.values(rec, false)) {
+          printf(",%s", value.c_str());
+        }
+        printf("\n");
+      } else {
+        printf("%s%s", first ? "" : ", ", reader.toJson(rec).c_str());
+        first = false;
+      }
+    }
+  }
+
+  if (!csv) {
+    printf("]\n");
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// Finds why communicators hang from the dumps of all their ranks, as returned
+// by ncclCommDumpBinary and written to one file per rank. Directories are
+// scanned for dump files. Prints, for each communicator, the oldest collective
+// in flight, the ranks that have not issued it, and the ranks that the others
+// are waiting for (see HangAnalyzer.h). Only depends on HangAnalyzer and
+// CommDumpBinary.h, so it can be built without NCCL:
+//   g++ -std=c++17 -O2 -I.. -I../../include HangAnalyze.cc ../HangAnalyzer.cc
+//       -o HangAnalyze
+//
+// Usage: HangAnalyze [--max-culprits N] file|dir...
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "HangAnalyzer.h"
+
+int main(int argc, char** argv) {
+  size_t maxCulprits = 10;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--max-culprits") == 0 && i + 1 < argc) {
+      maxCulprits = strtoul(argv[++i], nullptr, 10);
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty()) {
+    fprintf(stderr, "Usage: %s [--max-culprits N] file|dir...\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  HangAnalyzer analyzer;
+  size_t nDumps = 0;
+  for (auto& path : paths) {
+    std::vector<std::string> files;
+    if (std::filesystem::is_directory(path)) {
+      for (auto& entry : std::filesystem::directory_iterator(path)) {
+        if (entry.is_regular_file()) {
+          files.push_back(entry.path().string());
+        }
+      }
+    } else {
+      files.push_back(path);
+    }
+    for (auto& file : files) {
+      if (analyzer.addDumpFile(file)) {
+        nDumps++;
+      } else {
+        fprintf(stderr, "Skipping %s: not a valid dump\n", file.c_str());
+      }
+    }
+  }
+  if (nDumps == 0) {
+    fprintf(stderr, "No valid dump\n");
+    return EXIT_FAILURE;
+  }
+
+  for (auto& report : analyzer.analyze()) {
+    printf("%s\n", report.toString(maxCulprits).c_str());
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,220 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// Merges the timelines written by the CollTrace timeline feature on each rank
+// (see TraceTimeline.h) into one Chrome trace event format file, with one
+// process per rank, to be opened in Perfetto or chrome://tracing.
+//
+// The clocks of the ranks of a communicator are aligned on its lowest rank: a
+// collective completes at about the same time on all ranks, so the offset of
+// the clock of a rank is the median difference of the end of the kernels of
+// the collectives traced on both ranks (or of their proxy steps without
+// kernels). Different communicators are not aligned with each other. Use
+// --no-align if the clocks are already synchronized, e.g. with PTP.
+// Depends on jsoncpp only:
+//   g++ -std=c++17 -O2 -I/usr/include/jsoncpp TimelineMerge.cc -ljsoncpp
+//       -o TimelineMerge
+//
+// Usage: TimelineMerge [--no-align] -o merged.json file|dir...
+
+#include <json/json.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+struct RankTimeline {
+  std::string path;
+  std::string commHash;
+  int rank{0};
+  // nanoseconds of the timestamps 0 of the file
+  int64_t baseTs{0};
+  Json::Value events;
+  // opCount to end of the kernel, or of the proxy steps, in nanoseconds
+  std::map<uint64_t, int64_t> collEnds;
+  std::map<uint64_t, int64_t> proxyCollEnds;
+  // to add to the timestamps of the rank to align them on the lowest rank
+  int64_t offset{0};
+};
+
+static bool loadTimeline(const std::string& path, RankTimeline& timeline) {
+  std::ifstream f(path);
+  Json::Value root;
+  Json::CharReaderBuilder builder;
+  std::string errs;
+  if (!f || !Json::parseFromStream(builder, f, &root, &errs) ||
+      !root.isObject() || !root["traceEvents"].isArray() ||
+      !root["otherData"]["baseTs"].isString()) {
+    return false;
+  }
+
+  timeline.path = path;
+  timeline.commHash = root["otherData"]["commHash"].asString();
+  timeline.rank = root["otherData"]["rank"].asInt();
+  timeline.baseTs = std::stoll(root["otherData"]["baseTs"].asString());
+  timeline.events = root["traceEvents"];
+  for (auto& event : timeline.events) {
+    if (event["ph"].asString() != "X") {
+      continue;
+    }
+    auto cat = event["cat"].asString();
+    auto ends = cat == "coll" ? &timeline.collEnds
+        : cat == "proxy_coll" ? &timeline.proxyCollEnds
+                              : nullptr;
+    if (ends) {
+      int64_t end = timeline.baseTs +
+          static_cast<int64_t>(
+              (event["ts"].asDouble() + event["dur"].asDouble()) * 1000);
+      (*ends)[event["args"]["opCount"].asUInt64()] = end;
+    }
+  }
+  return true;
+}
+
+// Median of the differences of the ends of the collectives in both maps, or
+// false if there are none
+static bool medianOffset(
+    const std::map<uint64_t, int64_t>& ref,
+    const std::map<uint64_t, int64_t>& ends,
+    int64_t& offset) {
+  std::vector<int64_t> diffs;
+  for (auto& it : ends) {
+    auto refIt = ref.find(it.first);
+    if (refIt != ref.end()) {
+      diffs.push_back(refIt->second - it.second);
+    }
+  }
+  if (diffs.empty()) {
+    return false;
+  }
+  std::nth_element(diffs.begin(), diffs.begin() + diffs.size() / 2, diffs.end());
+  offset = diffs[diffs.size() / 2];
+  return true;
+}
+
+int main(int argc, char** argv) {
+  bool align = true;
+  std::string output;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--no-align") == 0) {
+      align = false;
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty() || output.empty()) {
+    fprintf(
+        stderr, "Usage: %s [--no-align] -o merged.json file|dir...\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::vector<RankTimeline> timelines;
+  for (auto& path : paths) {
+    std::vector<std::string> files;
+    if (std::filesystem::is_directory(path)) {
+      for (auto& entry : std::filesystem::directory_iterator(path)) {
+        auto name = entry.path().filename().string();
+        if (entry.is_regular_file() && name.size() > 11 &&
+            name.compare(name.size() - 11, 11, ".trace.json") == 0) {
+          files.push_back(entry.path().string());
+        }
+      }
+    } else {
+      files.push_back(path);
+    }
+    for (auto& file : files) {
+      timelines.emplace_back();
+      if (!loadTimeline(file, timelines.back())) {
+        fprintf(stderr, "Skipping %s: not a valid timeline\n", file.c_str());
+        timelines.pop_back();
+      }
+    }
+  }
+  if (timelines.empty()) {
+    fprintf(stderr, "No valid timeline\n");
+    return EXIT_FAILURE;
+  }
+  std::sort(timelines.begin(), timelines.end(), [](auto& a, auto& b) {
+    return std::tie(a.commHash, a.rank) < std::tie(b.commHash, b.rank);
+  });
+
+  if (align) {
+    size_t refIdx = 0;
+    for (size_t i = 1; i < timelines.size(); i++) {
+      auto& timeline = timelines[i];
+      if (timeline.commHash != timelines[refIdx].commHash) {
+        refIdx = i;
+        continue;
+      }
+      auto& ref = timelines[refIdx];
+      if (!medianOffset(ref.collEnds, timeline.collEnds, timeline.offset) &&
+          !medianOffset(
+              ref.proxyCollEnds, timeline.proxyCollEnds, timeline.offset)) {
+        fprintf(
+            stderr,
+            "No collective in common between %s and %s, not aligned\n",
+            ref.path.c_str(),
+            timeline.path.c_str());
+      }
+    }
+  }
+
+  // Rebase all timestamps on the earliest aligned one
+  int64_t baseTs = INT64_MAX;
+  for (auto& timeline : timelines) {
+    baseTs = std::min(baseTs, timeline.baseTs + timeline.offset);
+  }
+
+  Json::Value merged;
+  merged["displayTimeUnit"] = "ns";
+  merged["otherData"]["baseTs"] = std::to_string(baseTs);
+  Json::Value& events = merged["traceEvents"];
+  events = Json::Value(Json::arrayValue);
+  for (size_t pid = 0; pid < timelines.size(); pid++) {
+    auto& timeline = timelines[pid];
+    double shiftUs = (timeline.baseTs + timeline.offset - baseTs) / 1000.0;
+    merged["otherData"]["offsetsNs"][timeline.path] =
+        static_cast<Json::Int64>(timeline.offset);
+    for (auto& event : timeline.events) {
+      // Ranks of different communicators may share a rank
+      event["pid"] = static_cast<Json::UInt64>(pid);
+      if (event.isMember("ts")) {
+        event["ts"] = event["ts"].asDouble() + shiftUs;
+      }
+      events.append(event);
+    }
+    Json::Value sortIndex;
+    sortIndex["ph"] = "M";
+    sortIndex["name"] = "process_sort_index";
+    sortIndex["pid"] = static_cast<Json::UInt64>(pid);
+    sortIndex["args"]["sort_index"] = static_cast<Json::UInt64>(pid);
+    events.append(sortIndex);
+  }
+
+  Json::StreamWriterBuilder writer;
+  writer["indentation"] = "";
+  writer["precision"] = 17;
+  std::ofstream f(output);
+  if (!f) {
+    fprintf(stderr, "Failed to open %s\n", output.c_str());
+    return EXIT_FAILURE;
+  }
+  f << Json::writeString(writer, merged) << std::endl;
+  printf("Merged %zu timelines into %s\n", timelines.size(), output.c_str());
+  for (auto& timeline : timelines) {
+    printf(
+        "  comm %s rank %d: offset %.3f us\n",
+        timeline.commHash.c_str(),
+        timeline.rank,
+        timeline.offset / 1000.0);
+  }
+  return EXIT_SUCCESS;
+}
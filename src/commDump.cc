@@ -1,9 +1,13 @@
 // (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
 
+#include <chrono>
+#include <cstring>
 #include <iterator>
 #include <string>
 #include <unordered_map>
 #include "CollTrace.h"
+#include "CommDumpBinary.h"
+#include "Ctran.h"
 #include "ExtUtils.h"
 #include "ProxyTrace.h"
 #include "TraceUtils.h"
@@ -31,14 +35,15 @@ static std::string dumpRings(ncclComm_t comm) {
 
 static void dumpCommInfo(
     ncclComm_t comm,
-    std::unordered_map<std::string, std::string>& map) {
+    std::unordered_map<std::string, std::string>& map,
+    bool dumpMetadata) {
   map["commHash"] = toQuotedString(hashToHexStr(comm->commHash));
   map["rank"] = std::to_string(comm->rank);
   map["localRank"] = std::to_string(comm->localRank);
   map["node"] = std::to_string(comm->node);
 
   // common metadata is dumped only on rank 0
-  if (comm->rank == 0) {
+  if (comm->rank == 0 && dumpMetadata) {
     map["nRanks"] = std::to_string(comm->nRanks);
     map["localRanks"] = std::to_string(comm->localRanks);
     map["nNodes"] = std::to_string(comm->nNodes);
@@ -48,11 +53,14 @@ static void dumpCommInfo(
   }
 }
 
-static void dumpCollTrace(
+// Dump the past collectives numbered since or later. Return the number of
+// the next past collective, or since if the trace is disabled.
+static uint64_t dumpCollTrace(
     ncclComm_t comm,
-    std::unordered_map<std::string, std::string>& map) {
+    std::unordered_map<std::string, std::string>& map,
+    uint64_t since) {
   if (comm->collTrace != nullptr) {
-    auto dump = comm->collTrace->dump();
+    auto dump = comm->collTrace->dump(since);
 
     INFO(
         NCCL_ALL,
@@ -65,7 +73,9 @@ static void dumpCollTrace(
         dump.currentColl == nullptr ? 0 : 1);
 
     map["CT_pastColls"] = serializeObjects(dump.pastColls);
+    map["CT_pastCollsStats"] = dump.pastCollsStats.serialize(true);
     map["CT_pendingColls"] = serializeObjects(dump.pendingColls);
+    map["CT_counters"] = serializeObjects(dump.counters);
 
     if (dump.currentColl != nullptr) {
       map["CT_currentColl"] = dump.currentColl->serialize(true);
@@ -75,16 +85,19 @@ static void dumpCollTrace(
     } else {
       map["CT_currentColl"] = "null";
     }
+    return dump.pastCollsStats.nRecords;
   } else {
     INFO(NCCL_ALL, "CommDump: COLLTRACE is disabled. No trace to dump");
   }
+  return since;
 }
 
-static void dumpProxyTrace(
+static uint64_t dumpProxyTrace(
     ncclComm_t comm,
-    std::unordered_map<std::string, std::string>& map) {
+    std::unordered_map<std::string, std::string>& map,
+    uint64_t since) {
   if (comm->proxyState != nullptr && comm->proxyState->trace) {
-    auto dump = comm->proxyState->trace->dump(comm->commHash);
+    auto dump = comm->proxyState->trace->dump(comm->commHash, since);
 
     INFO(
         NCCL_ALL,
@@ -96,19 +109,229 @@ static void dumpProxyTrace(
         dump.activeOps.size());
 
     map["PT_pastColls"] = serializeObjects(dump.pastColls);
+    map["PT_pastCollsStats"] = dump.pastCollsStats.serialize(true);
     map["PT_activeOps"] = serializeObjects(dump.activeOps);
     map["PT_activeColls"] = serializeObjects(dump.activeColls);
+    return dump.pastCollsStats.nRecords;
   } else {
     INFO(NCCL_ALL, "CommDump: PROXYTRACE is disabled. No trace to dump");
   }
+  return since;
+}
+
+static void dumpCtran(
+    ncclComm_t comm,
+    std::unordered_map<std::string, std::string>& map) {
+  if (!ctranInitialized(comm)) {
+    return;
+  }
+  std::vector<CtranMapperPeerPending> pending;
+  comm->ctran->mapper->getPendingPeers(pending);
+
+  std::vector<std::string> keys = {
+      "peer", "sendCtrl", "recvCtrl", "put", "waitNotify"};
+  std::vector<std::string> pendingVec;
+  pendingVec.reserve(pending.size());
+  for (auto& p : pending) {
+    std::unordered_map<std::string, std::string> peerMap;
+    peerMap["peer"] = std::to_string(p.peer);
+    peerMap["sendCtrl"] = std::to_string(p.sendCtrl);
+    peerMap["recvCtrl"] = std::to_string(p.recvCtrl);
+    peerMap["put"] = std::to_string(p.put);
+    peerMap["waitNotify"] = p.waitNotify ? "true" : "false";
+    pendingVec.emplace_back(serializeMap(keys, peerMap, true));
+  }
+  map["CTRAN_pendingPeers"] = serializeVec(pendingVec);
 }
 
 __attribute__((visibility("default"))) ncclResult_t ncclCommDump(
     ncclComm_t comm,
     std::unordered_map<std::string, std::string>& map) {
-  dumpCommInfo(comm, map);
-  dumpCollTrace(comm, map);
-  dumpProxyTrace(comm, map);
+  dumpCommInfo(comm, map, true);
+  dumpCollTrace(comm, map, 0);
+  dumpProxyTrace(comm, map, 0);
+  dumpCtran(comm, map);
+
+  return ncclSuccess;
+}
+
+__attribute__((visibility("default"))) ncclResult_t ncclCommDumpDelta(
+    ncclComm_t comm,
+    ncclCommDumpCursor* cursor,
+    std::unordered_map<std::string, std::string>& map) {
+  if (cursor == nullptr) {
+    WARN("CommDump: cursor argument is NULL");
+    return ncclInvalidArgument;
+  }
+
+  // Metadata such as rings never changes, dump it only on the first call
+  dumpCommInfo(
+      comm, map, cursor->collTraceSeq == 0 && cursor->proxyTraceSeq == 0);
+  cursor->collTraceSeq = dumpCollTrace(comm, map, cursor->collTraceSeq);
+  cursor->proxyTraceSeq = dumpProxyTrace(comm, map, cursor->proxyTraceSeq);
+  dumpCtran(comm, map);
+
+  return ncclSuccess;
+}
+
+static inline int64_t timePointToNs(
+    std::chrono::time_point<std::chrono::high_resolution_clock> ts) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             ts.time_since_epoch())
+      .count();
+}
+
+template <typename T>
+static inline void appendRecord(std::string& buf, const T& record) {
+  buf.append(reinterpret_cast<const char*>(&record), sizeof(T));
+}
+
+static void appendCollRecord(std::string& buf, const CollTraceColl& coll) {
+  CommDumpCollRecord rec{};
+  rec.opCount = coll.opCount;
+  rec.iteration = coll.iteration;
+  rec.sendbuff = reinterpret_cast<uint64_t>(coll.info.sendbuff);
+  rec.recvbuff = reinterpret_cast<uint64_t>(coll.info.recvbuff);
+  rec.count = coll.info.count;
+  rec.latency = coll.latency;
+  rec.root = coll.info.root;
+  rec.coll = coll.info.coll;
+  rec.datatype = coll.info.datatype;
+  rec.redOp = coll.info.op;
+  rec.algorithm = coll.info.algorithm;
+  rec.protocol = coll.info.protocol;
+  rec.pattern = coll.info.pattern;
+  rec.channelId = coll.info.channelId;
+  rec.nChannels = coll.info.nChannels;
+  rec.nThreads = coll.info.nThreads;
+  appendRecord(buf, rec);
+}
+
+static void appendProxyCollRecord(
+    std::string& buf,
+    const ProxyTraceColl& coll) {
+  CommDumpProxyCollRecord rec{};
+  rec.opCount = coll.collInfo.opCount;
+  rec.channelMask = ProxyTraceCollRecord(coll).channelMask;
+  rec.totalSendSize = coll.totalSendSize;
+  rec.totalRecvSize = coll.totalRecvSize;
+  rec.nChannels = coll.collInfo.nChannels;
+  rec.nProxyOps = coll.nProxyOps;
+  rec.coll = coll.collInfo.coll;
+  appendRecord(buf, rec);
+}
+
+static void appendCtranPeerRecord(
+    std::string& buf,
+    const CtranMapperPeerPending& pending) {
+  CommDumpCtranPeerRecord rec{};
+  rec.peer = pending.peer;
+  rec.sendCtrl = pending.sendCtrl;
+  rec.recvCtrl = pending.recvCtrl;
+  rec.put = pending.put;
+  rec.waitNotify = pending.waitNotify;
+  appendRecord(buf, rec);
+}
+
+static void appendProxyOpRecord(std::string& buf, const ProxyTraceOp& op) {
+  CommDumpProxyOpRecord rec{};
+  rec.opCount = op.collInfo.opCount;
+  rec.stepSize = op.stepSize;
+  rec.transSize = op.transSize;
+  rec.startTs = timePointToNs(op.startTs);
+  rec.doneTs = timePointToNs(op.doneTs);
+  for (int i = 0; i < NUM_STATUS; i++) {
+    rec.step[i] = op.stepRecords[i].step;
+    rec.stepTs[i] = timePointToNs(op.stepRecords[i].ts);
+  }
+  rec.channelId = op.channelId;
+  rec.proxyOpId = op.proxyOpId;
+  rec.nSteps = op.nSteps;
+  rec.rank = op.rank;
+  rec.remoteRank = op.remoteRank;
+  rec.opType = op.opType;
+  rec.done = op.done;
+  appendRecord(buf, rec);
+}
+
+__attribute__((visibility("default"))) ncclResult_t ncclCommDumpBinary(
+    ncclComm_t comm,
+    ncclCommDumpCursor* cursor,
+    std::string& buf) {
+  ncclCommDumpCursor fullDump{};
+  if (cursor == nullptr) {
+    cursor = &fullDump;
+  }
+
+  CommDumpBinaryHeader header{};
+  memcpy(header.magic, COMM_DUMP_BINARY_MAGIC, sizeof(header.magic));
+  header.version = COMM_DUMP_BINARY_VERSION;
+  header.headerSize = sizeof(header);
+  header.commHash = comm->commHash;
+  header.rank = comm->rank;
+  header.collRecordSize = sizeof(CommDumpCollRecord);
+  header.proxyCollRecordSize = sizeof(CommDumpProxyCollRecord);
+  header.proxyOpRecordSize = sizeof(CommDumpProxyOpRecord);
+  header.nRanks = comm->nRanks;
+  header.ctranPeerRecordSize = sizeof(CommDumpCtranPeerRecord);
+
+  std::string body;
+  if (comm->collTrace != nullptr) {
+    auto dump = comm->collTrace->dump(cursor->collTraceSeq);
+    header.flags |= COMM_DUMP_BINARY_COLLTRACE;
+    header.ctPastCollsSince = cursor->collTraceSeq;
+    header.ctPastCollsNRecords = dump.pastCollsStats.nRecords;
+    header.ctPastCollsNDropped = dump.pastCollsStats.nDropped;
+    header.nCtPastColls = dump.pastColls.size();
+    header.nCtPendingColls = dump.pendingColls.size();
+    for (auto& coll : dump.pastColls) {
+      appendCollRecord(body, coll);
+    }
+    for (auto& coll : dump.pendingColls) {
+      appendCollRecord(body, coll);
+    }
+    if (dump.currentColl != nullptr) {
+      header.flags |= COMM_DUMP_BINARY_CURRENT_COLL;
+      appendCollRecord(body, *dump.currentColl);
+    }
+    cursor->collTraceSeq = dump.pastCollsStats.nRecords;
+  }
+
+  if (comm->proxyState != nullptr && comm->proxyState->trace) {
+    auto dump =
+        comm->proxyState->trace->dump(comm->commHash, cursor->proxyTraceSeq);
+    header.flags |= COMM_DUMP_BINARY_PROXYTRACE;
+    header.ptPastCollsSince = cursor->proxyTraceSeq;
+    header.ptPastCollsNRecords = dump.pastCollsStats.nRecords;
+    header.ptPastCollsNDropped = dump.pastCollsStats.nDropped;
+    header.nPtPastColls = dump.pastColls.size();
+    header.nPtActiveColls = dump.activeColls.size();
+    header.nPtActiveOps = dump.activeOps.size();
+    for (auto& coll : dump.pastColls) {
+      appendProxyCollRecord(body, coll);
+    }
+    for (auto& coll : dump.activeColls) {
+      appendProxyCollRecord(body, coll);
+    }
+    for (auto& op : dump.activeOps) {
+      appendProxyOpRecord(body, op);
+    }
+    cursor->proxyTraceSeq = dump.pastCollsStats.nRecords;
+  }
+
+  if (ctranInitialized(comm)) {
+    std::vector<CtranMapperPeerPending> pending;
+    comm->ctran->mapper->getPendingPeers(pending);
+    header.flags |= COMM_DUMP_BINARY_CTRAN;
+    header.nCtranPeers = pending.size();
+    for (auto& p : pending) {
+      appendCtranPeerRecord(body, p);
+    }
+  }
 
+  buf.clear();
+  buf.reserve(sizeof(header) + body.size());
+  appendRecord(buf, header);
+  buf += body;
   return ncclSuccess;
 }
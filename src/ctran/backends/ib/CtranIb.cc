@@ -1,6 +1,7 @@
 // (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
 
 #include <cstdio>
+#include <exception>
 #include <iostream>
 #include <stdexcept>
 #include <string>
@@ -15,6 +16,7 @@
 #include "CtranIbImpl.h"
 #include "CtranIbVc.h"
 #include "ExtChecks.h"
+#include "NcclMetrics.h"
 
 /*
 === BEGIN_NCCL_CVAR_INFO_BLOCK ===
@@ -151,10 +153,29 @@ CtranIbSingleton::CtranIbSingleton(void) {
     this->pds.push_back(pd);
     this->devNames.push_back(devices[i]->name);
   }
+
+  // Export the traffic recorded with NCCL_CTRAN_IB_TRAFFIC_PROFILNG at each
+  // scrape rather than publishing it on every transfer
+  if (NCCL_CTRAN_IB_TRAFFIC_PROFILNG && NcclMetrics::enabled()) {
+    this->metricsCollectorId_ = NcclMetrics::getInstance().addCollector(
+        [this](std::vector<NcclMetricSample>& samples) {
+          for (auto& it : this->getDeviceTrafficSnapshot()) {
+            samples.push_back(
+                {"nccl_ctran_ib_traffic_bytes_total",
+                 {{"device", it.first}},
+                 NcclMetricSample::Type::COUNTER,
+                 it.second});
+          }
+        });
+  }
   return;
 }
 
 CtranIbSingleton::~CtranIbSingleton() {
+  if (this->metricsCollectorId_ >= 0) {
+    NcclMetrics::getInstance().removeCollector(this->metricsCollectorId_);
+  }
+
   {
     std::lock_guard<std::mutex> guard(this->commsMutex_);
     if (this->comms_.size()) {
@@ -253,14 +274,39 @@ void CtranIbSingleton::commDeref(ncclComm* comm) {
 }
 
 CtranIb::CtranIb(ncclComm* comm) {
+  this->pimpl_ = std::unique_ptr<Impl>(new Impl());
+  this->pimpl_->comm = comm;
+  this->pimpl_->allListenSocketAddrs = static_cast<ncclSocketAddress*>(
+      calloc(comm->nRanks, sizeof(ncclSocketAddress)));
+
+  // The exchange of the listen addresses is collective, so a rank failing to
+  // set up IB still takes part in it before throwing, for the other ranks not
+  // to hang. CtranMapper then falls back to another backend on all ranks.
+  std::exception_ptr initError;
+  try {
+    this->init(comm);
+  } catch (...) {
+    initError = std::current_exception();
+  }
+
+  NCCLCHECKTHROW(bootstrapAllGather(
+      comm->bootstrap,
+      this->pimpl_->allListenSocketAddrs,
+      sizeof(ncclSocketAddress)));
+  if (initError) {
+    free(this->pimpl_->allListenSocketAddrs);
+    std::rethrow_exception(initError);
+  }
+
+  this->pimpl_->listenThread = std::thread{CtranIb::Impl::bootstrapAccept, this->pimpl_.get()};
+}
+
+void CtranIb::init(ncclComm* comm) {
   bool foundPort = false;
   char ifName[MAX_IF_NAME_SIZE+1];
   union ncclSocketAddress ifAddr;
   int nIfs;
 
-  this->pimpl_ = std::unique_ptr<Impl>(new Impl());
-  this->pimpl_->comm = comm;
-
   CtranIbSingleton& s = CtranIbSingleton::getInstance();
 
   this->pimpl_->context = s.contexts[comm->cudaDev];
@@ -342,19 +388,9 @@ CtranIb::CtranIb(ncclComm* comm) {
   NCCLCHECKTHROW(ncclSocketInit(&this->pimpl_->listenSocket, &ifAddr));
   NCCLCHECKTHROW(ncclSocketListen(&this->pimpl_->listenSocket));
 
-  this->pimpl_->allListenSocketAddrs = static_cast<ncclSocketAddress*>(
-      malloc(this->pimpl_->comm->nRanks * sizeof(ncclSocketAddress)));
   NCCLCHECKTHROW(ncclSocketGetAddr(
       &this->pimpl_->listenSocket,
       &this->pimpl_->allListenSocketAddrs[this->pimpl_->comm->rank]));
-
-  NCCLCHECKTHROW(bootstrapAllGather(
-      comm->bootstrap,
-      this->pimpl_->allListenSocketAddrs,
-      sizeof(ncclSocketAddress)));
-
-  this->pimpl_->listenThread = std::thread{CtranIb::Impl::bootstrapAccept, this->pimpl_.get()};
-  return;
 }
 
 std::string CtranIb::getIbDevName() {
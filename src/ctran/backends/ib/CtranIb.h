@@ -148,6 +148,10 @@ public:
  int getIbDevPort();
 
 private:
+  // Local setup of the backend, up to listening for connections. Throws on
+  // failure.
+  void init(ncclComm* comm);
+
   class Impl;
   std::unique_ptr<Impl> pimpl_;
   friend class CtranIbRequest;
@@ -73,6 +73,8 @@ class CtranIbSingleton {
     std::unordered_map<std::string, size_t> trafficPerDevice_;
     std::unordered_map<uint32_t, size_t> trafficPerQP_;
     std::mutex trafficRecordMutex_;
+    // Collector of the traffic registered to NcclMetrics, -1 if none
+    int metricsCollectorId_{-1};
 
     std::unordered_set<ncclComm*> comms_;
     std::mutex commsMutex_;
@@ -0,0 +1,364 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "nccl.h"
+#include "checks.h"
+#include "comm.h"
+#include "nccl_cvars.h"
+#include "CtranSocket.h"
+#include "CtranSocketImpl.h"
+#include "CtranSocketVc.h"
+#include "ExtChecks.h"
+
+/*
+=== BEGIN_NCCL_CVAR_INFO_BLOCK ===
+
+ - name        : NCCL_CTRAN_SOCKET_NUM_STREAMS
+   type        : int
+   default     : 2
+   description : |-
+     Number of TCP connections (streams) to open to each peer in the ctran
+     socket backend. Control messages always use the first stream; put
+     payloads are striped across streams (see
+     NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD).
+
+ - name        : NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD
+   type        : uint64_t
+   default     : 1048576
+   description : |-
+     Threshold for stream scaling in the ctran socket backend.  If T is the
+     threshold, then for message sizes < T, a single stream is used.  For
+     [T,2T) message sizes, data is split across two streams, and so on,
+     up to NCCL_CTRAN_SOCKET_NUM_STREAMS.
+
+ - name        : NCCL_CTRAN_SOCKET_CHUNK_SIZE
+   type        : uint64_t
+   default     : 1048576
+   description : |-
+     Size of the pinned host bounce buffer used per stream to stage device
+     memory through the ctran socket backend.
+
+ - name        : NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD
+   type        : int64_t
+   default     : 65536
+   description : |-
+     Minimum size of a host-memory put segment for which the ctran socket
+     backend uses sendmsg(MSG_ZEROCOPY). Set to -1 to disable zero-copy
+     sends.
+
+=== END_NCCL_CVAR_INFO_BLOCK ===
+*/
+
+CtranSocket::CtranSocket(ncclComm* comm) {
+  this->pimpl_ = std::unique_ptr<Impl>(new Impl());
+  this->pimpl_->comm = comm;
+  this->pimpl_->allListenSocketAddrs = static_cast<ncclSocketAddress*>(
+      calloc(comm->nRanks, sizeof(ncclSocketAddress)));
+
+  // As in CtranIb, a rank failing to set up still takes part in the
+  // collective exchange of the listen addresses before throwing
+  std::exception_ptr initError;
+  try {
+    this->init(comm);
+  } catch (...) {
+    initError = std::current_exception();
+  }
+
+  NCCLCHECKTHROW(bootstrapAllGather(
+      comm->bootstrap,
+      this->pimpl_->allListenSocketAddrs,
+      sizeof(ncclSocketAddress)));
+  if (initError) {
+    free(this->pimpl_->allListenSocketAddrs);
+    std::rethrow_exception(initError);
+  }
+
+  this->pimpl_->listenThread =
+      std::thread{CtranSocket::Impl::bootstrapAccept, this->pimpl_.get()};
+}
+
+void CtranSocket::init(ncclComm* comm) {
+  char ifName[MAX_IF_NAME_SIZE + 1];
+  union ncclSocketAddress ifAddr;
+  int nIfs;
+
+  this->pimpl_->numStreams = NCCL_CTRAN_SOCKET_NUM_STREAMS;
+  if (this->pimpl_->numStreams < 1) {
+    this->pimpl_->numStreams = 1;
+  } else if (this->pimpl_->numStreams > CTRAN_SOCKET_HARDCODED_MAX_STREAMS) {
+    WARN(
+        "CTRAN-SOCKET: NCCL_CTRAN_SOCKET_NUM_STREAMS set to more than the hardcoded max value (%d)",
+        CTRAN_SOCKET_HARDCODED_MAX_STREAMS);
+    this->pimpl_->numStreams = CTRAN_SOCKET_HARDCODED_MAX_STREAMS;
+  }
+
+  // Device buffers are staged through host bounce buffers on a dedicated
+  // non-blocking stream, so that staging never serializes with the ctran
+  // kernel waiting on the user stream.
+  CUDACHECKTHROW(cudaStreamCreateWithFlags(
+      &this->pimpl_->stageStream, cudaStreamNonBlocking));
+
+  // Locally initialize all virtual connections before launching the listen
+  // thread
+  for (int r = 0; r < comm->nRanks; r++) {
+    this->pimpl_->vcList.push_back(
+        new CtranSocket::Impl::VirtualConn(this->pimpl_.get(), r));
+  }
+
+  nIfs = ncclFindInterfaces(ifName, &ifAddr, MAX_IF_NAME_SIZE, 1);
+  if (nIfs <= 0) {
+    WARN("CTRAN-SOCKET: No socket interfaces found\n");
+    throw std::runtime_error("CTRAN-SOCKET : No socket interfaces found");
+  } else {
+    INFO(
+        NCCL_INIT,
+        "CTRAN-SOCKET: socket interface set to %s, %d streams per peer, commHash %lx",
+        ifName,
+        this->pimpl_->numStreams,
+        comm->commHash);
+  }
+
+  NCCLCHECKTHROW(ncclSocketInit(&this->pimpl_->listenSocket, &ifAddr));
+  NCCLCHECKTHROW(ncclSocketListen(&this->pimpl_->listenSocket));
+
+  NCCLCHECKTHROW(ncclSocketGetAddr(
+      &this->pimpl_->listenSocket,
+      &this->pimpl_->allListenSocketAddrs[comm->rank]));
+}
+
+CtranSocket::~CtranSocket(void) {
+  NCCLCHECKIGNORE(this->pimpl_->bootstrapTerminate());
+  this->pimpl_->listenThread.join();
+
+  for (auto vc : this->pimpl_->vcList) {
+    delete vc;
+  }
+
+  for (auto op : this->pimpl_->pendingOps) {
+    delete op;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(this->pimpl_->regMutex);
+    for (auto& it : this->pimpl_->regElems) {
+      delete it.second;
+    }
+    this->pimpl_->regElems.clear();
+  }
+
+  free(this->pimpl_->allListenSocketAddrs);
+  NCCLCHECKIGNORE(ncclSocketClose(&this->pimpl_->listenSocket));
+  CUDACHECKIGNORE(cudaStreamDestroy(this->pimpl_->stageStream));
+
+  // Dot not throw exception in destructor to avoid early termination in stack
+  // unwind. See discussion in
+  // https://stackoverflow.com/questions/130117/if-you-shouldnt-throw-exceptions-in-a-destructor-how-do-you-handle-errors-in-i
+}
+
+ncclResult_t
+CtranSocket::regMem(const void* buf, std::size_t len, void** sockRegElem) {
+  ncclResult_t res = ncclSuccess;
+  struct CtranSocketRegElem* regElem = nullptr;
+
+  cudaPointerAttributes attr;
+  CUDACHECKGOTO(cudaPointerGetAttributes(&attr, buf), res, exit);
+
+  regElem = new struct CtranSocketRegElem;
+  regElem->buf = buf;
+  regElem->len = len;
+  regElem->isDevice = (attr.type == cudaMemoryTypeDevice);
+
+  {
+    std::lock_guard<std::mutex> guard(this->pimpl_->regMutex);
+    regElem->regId = this->pimpl_->nextRegId++;
+    this->pimpl_->regElems[regElem->regId] = regElem;
+  }
+  *sockRegElem = reinterpret_cast<void*>(regElem);
+
+exit:
+  return res;
+}
+
+ncclResult_t CtranSocket::deregMem(void* sockRegElem) {
+  struct CtranSocketRegElem* regElem =
+      reinterpret_cast<struct CtranSocketRegElem*>(sockRegElem);
+  if (regElem == nullptr) {
+    return ncclSuccess;
+  }
+
+  std::lock_guard<std::mutex> guard(this->pimpl_->regMutex);
+  this->pimpl_->regElems.erase(regElem->regId);
+  delete regElem;
+  return ncclSuccess;
+}
+
+ncclResult_t CtranSocket::progress(void) {
+  ncclResult_t res = ncclSuccess;
+
+  {
+    const std::lock_guard<std::mutex> lock(this->pimpl_->m);
+    for (auto vc : this->pimpl_->activeVcs) {
+      NCCLCHECKGOTO(vc->progress(), res, exit);
+    }
+  }
+
+  /* we should have pendingOps only if the connection was not
+   * established yet; see CtranIb::progress for the same pattern. */
+  if (!this->pimpl_->pendingOps.empty()) {
+    std::vector<int> peerRanks;
+    std::vector<struct CtranSocketPendingOp*> tmp = this->pimpl_->pendingOps;
+    this->pimpl_->pendingOps.clear();
+
+    for (auto op : tmp) {
+      int rank = (op->type == CtranSocketPendingOp::PendingOpType::ISEND_CTRL)
+          ? op->isendCtrl.peerRank
+          : op->irecvCtrl.peerRank;
+
+      /* if we already encounted this peer, skip all operations to the
+       * same peer; otherwise we might end up sending messages out of
+       * order */
+      if (std::find(peerRanks.begin(), peerRanks.end(), rank) !=
+          peerRanks.end()) {
+        this->pimpl_->pendingOps.push_back(op);
+        continue;
+      }
+
+      auto vc = this->pimpl_->vcList[rank];
+      if (vc->isReady() == false) {
+        this->pimpl_->pendingOps.push_back(op);
+        peerRanks.push_back(rank);
+        continue;
+      }
+
+      if (op->type == CtranSocketPendingOp::PendingOpType::ISEND_CTRL) {
+        NCCLCHECKGOTO(
+            vc->isendCtrl(
+                op->isendCtrl.buf, op->isendCtrl.sockRegElem, op->isendCtrl.req),
+            res,
+            exit);
+      } else {
+        NCCLCHECKGOTO(
+            vc->irecvCtrl(
+                op->irecvCtrl.buf, op->irecvCtrl.key, op->irecvCtrl.req),
+            res,
+            exit);
+      }
+      delete op;
+    }
+  }
+
+exit:
+  return res;
+}
+
+ncclResult_t CtranSocket::isendCtrl(
+    void* buf,
+    void* sockRegElem,
+    int peerRank,
+    CtranSocketRequest** req) {
+  ncclResult_t res = ncclSuccess;
+
+  auto vc = this->pimpl_->vcList[peerRank];
+  if (this->pimpl_->comm->rank < peerRank && vc->isReady() == false) {
+    NCCLCHECKGOTO(this->pimpl_->bootstrapConnect(peerRank), res, exit);
+  }
+
+  *req = new CtranSocketRequest();
+  if (vc->isReady() == true) {
+    NCCLCHECKGOTO(vc->isendCtrl(buf, sockRegElem, *req), res, exit);
+  } else {
+    auto pendingOp = new struct CtranSocketPendingOp;
+    pendingOp->type = CtranSocketPendingOp::PendingOpType::ISEND_CTRL;
+    pendingOp->isendCtrl.buf = buf;
+    pendingOp->isendCtrl.sockRegElem = sockRegElem;
+    pendingOp->isendCtrl.peerRank = peerRank;
+    pendingOp->isendCtrl.req = *req;
+    this->pimpl_->pendingOps.push_back(pendingOp);
+  }
+
+exit:
+  return res;
+}
+
+ncclResult_t CtranSocket::irecvCtrl(
+    void** buf,
+    struct CtranSocketRemoteAccessKey* key,
+    int peerRank,
+    CtranSocketRequest** req) {
+  ncclResult_t res = ncclSuccess;
+
+  auto vc = this->pimpl_->vcList[peerRank];
+  if (this->pimpl_->comm->rank < peerRank && vc->isReady() == false) {
+    NCCLCHECKGOTO(this->pimpl_->bootstrapConnect(peerRank), res, exit);
+  }
+
+  *req = new CtranSocketRequest();
+  if (vc->isReady() == true) {
+    NCCLCHECKGOTO(vc->irecvCtrl(buf, key, *req), res, exit);
+  } else {
+    auto pendingOp = new struct CtranSocketPendingOp;
+    pendingOp->type = CtranSocketPendingOp::PendingOpType::IRECV_CTRL;
+    pendingOp->irecvCtrl.buf = buf;
+    pendingOp->irecvCtrl.key = key;
+    pendingOp->irecvCtrl.peerRank = peerRank;
+    pendingOp->irecvCtrl.req = *req;
+    this->pimpl_->pendingOps.push_back(pendingOp);
+  }
+
+exit:
+  return res;
+}
+
+ncclResult_t CtranSocket::iput(
+    const void* sbuf,
+    void* dbuf,
+    std::size_t len,
+    int peerRank,
+    void* sockRegElem,
+    struct CtranSocketRemoteAccessKey remoteAccessKey,
+    bool notify,
+    CtranSocketRequest** req) {
+  ncclResult_t res = ncclSuccess;
+  CtranSocketRequest* r = nullptr;
+
+  if (req != nullptr) {
+    *req = new CtranSocketRequest();
+    r = *req;
+  }
+
+  NCCLCHECKGOTO(
+      this->pimpl_->vcList[peerRank]->iput(
+          sbuf, dbuf, len, sockRegElem, remoteAccessKey, notify, r),
+      res,
+      exit);
+
+exit:
+  return res;
+}
+
+ncclResult_t CtranSocket::checkNotify(int peerRank, bool* notify) {
+  ncclResult_t res = ncclSuccess;
+
+  NCCLCHECKGOTO(this->progress(), res, exit);
+  *notify = this->pimpl_->vcList[peerRank]->checkNotify();
+
+exit:
+  return res;
+}
+
+ncclResult_t CtranSocket::waitNotify(int peerRank) {
+  ncclResult_t res = ncclSuccess;
+  while (!this->pimpl_->vcList[peerRank]->checkNotify()) {
+    NCCLCHECKGOTO(this->progress(), res, exit);
+  }
+
+exit:
+  return res;
+}
@@ -0,0 +1,157 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#ifndef CTRAN_SOCKET_H_
+#define CTRAN_SOCKET_H_
+
+#include "nccl.h"
+#include <memory>
+
+struct CtranSocketRemoteAccessKey {
+  // Registration id of the remote buffer, assigned by the remote rank in
+  // regMem. The receiver uses it to validate incoming puts and to decide
+  // whether the destination is device or host memory.
+  uint64_t regId;
+};
+
+class CtranSocket;
+
+/**
+ * Class of request to track progress of a isendCtrl, irecvCtrl, or iput
+ * socket operation.
+ */
+class CtranSocketRequest {
+ public:
+  CtranSocketRequest(){};
+  ~CtranSocketRequest(){};
+
+  // Mark the number of expected references associated with the request (e.g.,
+  // multiple references if a data is internally striped across multiple
+  // socket streams). Default set refCount to 1 when creating the request.
+  void setRefCount(int refCount);
+
+  // Mark completion of a reference
+  void complete();
+
+  // Return true if all references have been completed. Otherwise false.
+  bool isComplete();
+
+ private:
+  enum {
+    INCOMPLETE,
+    COMPLETE,
+  } state_{INCOMPLETE};
+  int refCount_{1};
+};
+
+/**
+* CtranSocket class to be used by algorithms and ctranMapper. It implements
+* the same control/put/notify semantics as CtranIb on top of plain TCP
+* sockets, so that ctran algorithms can run on hosts without RDMA NICs.
+*/
+class CtranSocket {
+public:
+ // Creates local socket resources for a given communicator. It launches a
+ // listen thread to accept remote connections. The remote connection will
+ // happen when the remote peer issues the first message to the local rank.
+ // Input arguments:
+ //   - comm: the NCCL communicator
+ CtranSocket(ncclComm* comm);
+ ~CtranSocket();
+
+ // Register memory to be used for socket operations. No pinning happens; the
+ // registration only records the buffer range and its memory type.
+ // Input arguments:
+ //   - buf: the local buffer to be registered
+ //   - len: the length of the local buffer
+ // Output arguments:
+ //   - sockRegElem: the sockRegElem of the local buffer that stores the
+ //                  registration handle.
+ ncclResult_t regMem(const void* buf, std::size_t len, void** sockRegElem);
+
+ // Deregister memory to be used for socket operations.
+ // Input arguments:
+ //   - sockRegElem: the sockRegElem of the local buffer that stores the
+ //                  registration handle.
+ ncclResult_t deregMem(void* sockRegElem);
+
+ // Progress all outstanding sends and receives on established connections.
+ ncclResult_t progress(void);
+
+ // Send control message over the established socket connection.
+ // Input arguments:
+ //   - buf: the local buffer to be remotely accessed by coming
+ //          iput from the remote peer
+ //   - sockRegElem: the sockRegElem of the local buffer
+ //   - rank: the rank of the remote peer in the current communicator
+ // Output arguments:
+ //   - req: the request object to track the progress of the send
+ ncclResult_t
+ isendCtrl(void* buf, void* sockRegElem, int rank, CtranSocketRequest** req);
+
+ // Receive control message over the established socket connection.
+ // Input arguments:
+ //   - buf: the buffer to receive the control message. It is often a buffer
+ //          to hold the virtual address of the remote buffer that will be
+ //          accessed by iput.
+ //   - key: the remoteAccessKey of the remote buffer that will be updated by
+ //          iput.
+ //   - rank: the rank of the remote peer in the current communicator
+ // Output arguments:
+ //   - req: the request object to track the progress of the receive
+ ncclResult_t irecvCtrl(
+     void** buf,
+     struct CtranSocketRemoteAccessKey* key,
+     int rank,
+     CtranSocketRequest** req);
+
+ // Put data from local sbuf to a dbuf in remote rank over the established
+ // socket connection. Large puts are striped across multiple socket streams.
+ // Input arguments:
+ //   - sbuf: local buffer to put data from
+ //   - dbuf: virtual address of the remote buffer to receive data. It is
+ //           exchanged via isendCtrl|irecvCtrl called by the algorithm
+ //           layer.
+ //   - len: length of data
+ //   - rank: the rank of the remote peer in the current communicator
+ //   - sockRegElem: the sockRegElem of the local sbuf
+ //   - remoteAccessKey: the remoteAccessKey of dbuf. It is exchanged via
+ //                      isendCtrl|irecvCtrl called by the algorithm layer.
+ //   - notify: whether to notify the remote peer when the put has finished
+ //             and data has arrived in the remote dbuf.
+ // Output arguments:
+ //   - req: the request object to track the progress of the iput
+ ncclResult_t iput(
+     const void* sbuf,
+     void* dbuf,
+     std::size_t len,
+     int rank,
+     void* sockRegElem,
+     struct CtranSocketRemoteAccessKey remoteAccessKey,
+     bool notify,
+     CtranSocketRequest** req);
+
+ // Check whether the remote rank has finished the outstanding iput
+ // Input arguments:
+ //   - rank: the rank of the remote peer in the current communicator that has
+ //           issued iput to the local rank.
+ // Output arguments:
+ //   - notify: whether the remote peer has finished the outstanding iput.
+ ncclResult_t checkNotify(int rank, bool* notify);
+
+ // Wait until the remote rank has finished the outstanding iput
+ // Input arguments:
+ //   - rank: the rank of the remote peer in the current communicator that has
+ //           issued iput to the local rank.
+ ncclResult_t waitNotify(int rank);
+
+private:
+  // Local setup of the backend, up to listening for connections. Throws on
+  // failure.
+  void init(ncclComm* comm);
+
+  class Impl;
+  std::unique_ptr<Impl> pimpl_;
+  friend class CtranSocketRequest;
+};
+
+#endif
@@ -0,0 +1,140 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <unistd.h>
+#include "nccl.h"
+#include "checks.h"
+#include "comm.h"
+#include "CtranSocket.h"
+#include "CtranSocketImpl.h"
+#include "CtranSocketVc.h"
+#include "ExtChecks.h"
+
+void CtranSocket::Impl::bootstrapAccept(CtranSocket::Impl *pimpl) {
+  while (1) {
+    struct ncclSocket sock;
+    int peerRank;
+    int cmd;
+    int streamIdx;
+    int numStreams;
+
+    NCCLCHECKTHROW(ncclSocketInit(&sock));
+    NCCLCHECKTHROW(ncclSocketAccept(&sock, &pimpl->listenSocket));
+    NCCLCHECKTHROW(ncclSocketRecv(&sock, &cmd, sizeof(int)));
+    NCCLCHECKTHROW(ncclSocketRecv(&sock, &peerRank, sizeof(int)));
+
+    if (cmd == CTRAN_SOCKET_CMD_TERMINATE) {
+      NCCLCHECKTHROW(ncclSocketClose(&sock));
+      break;
+    }
+
+    NCCLCHECKTHROW(ncclSocketRecv(&sock, &streamIdx, sizeof(int)));
+    NCCLCHECKTHROW(ncclSocketRecv(&sock, &numStreams, sizeof(int)));
+
+    /* Both sides must agree on the stream layout, otherwise striped puts
+     * would be reassembled incorrectly. Dropping the socket without an ack
+     * makes the connecting rank fail its bootstrapConnect. */
+    if (numStreams != pimpl->numStreams) {
+      WARN(
+          "CTRAN-SOCKET: rank %d uses %d streams but peer %d uses %d; check NCCL_CTRAN_SOCKET_NUM_STREAMS",
+          pimpl->comm->rank,
+          pimpl->numStreams,
+          peerRank,
+          numStreams);
+      NCCLCHECKTHROW(ncclSocketClose(&sock));
+      continue;
+    }
+
+    auto vc = pimpl->vcList[peerRank];
+
+    {
+      const std::lock_guard<std::mutex> lock(pimpl->m);
+
+      bool ready = false;
+      NCCLCHECKTHROW(vc->addStream(&sock, streamIdx, &ready));
+      if (ready) {
+        pimpl->activeVcs.push_back(vc);
+        INFO(
+            NCCL_INIT,
+            "CTRAN-SOCKET: Established connection: rank %d, peer %d, streams %d",
+            pimpl->comm->rank,
+            peerRank,
+            pimpl->numStreams);
+      }
+
+      /* Ack that the stream is attached; the socket is now owned by the vc */
+      int ack = 0;
+      NCCLCHECKTHROW(ncclSocketSend(&sock, &ack, sizeof(int)));
+    }
+  }
+  return;
+}
+
+ncclResult_t CtranSocket::Impl::bootstrapConnect(int peerRank, int cmd) {
+  ncclResult_t res = ncclSuccess;
+  auto vc = this->vcList[peerRank];
+  bool ready = false;
+
+  this->m.lock();
+
+  if (cmd == CTRAN_SOCKET_CMD_TERMINATE) {
+    struct ncclSocket sock;
+    NCCLCHECKGOTO(ncclSocketInit(&sock, &allListenSocketAddrs[peerRank]), res, exit);
+    NCCLCHECKGOTO(ncclSocketConnect(&sock), res, exit);
+    NCCLCHECKGOTO(ncclSocketSend(&sock, &cmd, sizeof(int)), res, exit);
+    NCCLCHECKGOTO(ncclSocketSend(&sock, &this->comm->rank, sizeof(int)), res, exit);
+    NCCLCHECKGOTO(ncclSocketClose(&sock), res, exit);
+    goto exit;
+  }
+
+  /* open one TCP connection per stream; each is acked by the remote accept
+   * thread once it has been attached to its vc */
+  for (int i = 0; i < this->numStreams; i++) {
+    struct ncclSocket sock;
+    int ack;
+    NCCLCHECKGOTO(ncclSocketInit(&sock, &allListenSocketAddrs[peerRank]), res, exit);
+    NCCLCHECKGOTO(ncclSocketConnect(&sock), res, exit);
+    NCCLCHECKGOTO(ncclSocketSend(&sock, &cmd, sizeof(int)), res, exit);
+    NCCLCHECKGOTO(ncclSocketSend(&sock, &this->comm->rank, sizeof(int)), res, exit);
+    NCCLCHECKGOTO(ncclSocketSend(&sock, &i, sizeof(int)), res, exit);
+    NCCLCHECKGOTO(ncclSocketSend(&sock, &this->numStreams, sizeof(int)), res, exit);
+    NCCLCHECKGOTO(ncclSocketRecv(&sock, &ack, sizeof(int)), res, exit);
+    NCCLCHECKGOTO(vc->addStream(&sock, i, &ready), res, exit);
+  }
+
+  if (ready) {
+    this->activeVcs.push_back(vc);
+    INFO(
+        NCCL_INIT,
+        "CTRAN-SOCKET: Established connection: rank %d, peer %d, streams %d",
+        this->comm->rank,
+        peerRank,
+        this->numStreams);
+  }
+
+exit:
+  this->m.unlock();
+  return res;
+}
+
+ncclResult_t CtranSocket::Impl::bootstrapConnect(int peerRank) {
+  return this->bootstrapConnect(peerRank, CTRAN_SOCKET_CMD_SETUP);
+}
+
+ncclResult_t CtranSocket::Impl::bootstrapTerminate() {
+  return this->bootstrapConnect(this->comm->rank, CTRAN_SOCKET_CMD_TERMINATE);
+}
+
+bool CtranSocket::Impl::lookupRegElem(
+    uint64_t regId,
+    struct CtranSocketRegElem* regElem) {
+  std::lock_guard<std::mutex> guard(this->regMutex);
+  auto it = this->regElems.find(regId);
+  if (it == this->regElems.end()) {
+    return false;
+  }
+  *regElem = *it->second;
+  return true;
+}
@@ -0,0 +1,151 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#ifndef CTRAN_SOCKET_IMPL_H_
+#define CTRAN_SOCKET_IMPL_H_
+
+#include <cuda_runtime.h>
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "CtranSocket.h"
+#include "bootstrap.h"
+#include "socket.h"
+
+#define CTRAN_SOCKET_CMD_SETUP (0)
+#define CTRAN_SOCKET_CMD_TERMINATE (1)
+
+#define CTRAN_SOCKET_HARDCODED_MAX_STREAMS (64)
+
+/**
+ * Local registration record. The socket backend does not pin memory; it only
+ * needs to know the range (for validating incoming puts) and whether the
+ * buffer lives on the device (so that data is staged through a host bounce
+ * buffer).
+ */
+struct CtranSocketRegElem {
+  const void* buf{nullptr};
+  std::size_t len{0};
+  uint64_t regId{0};
+  bool isDevice{false};
+};
+
+/**
+ * Header preceding every message on a socket stream.
+ */
+struct CtranSocketMsgHdr {
+  enum MsgType : uint32_t {
+    CTRL = 0,
+    PUT = 1,
+  } type{CTRL};
+  uint32_t notify{0};
+  // CTRL: address of the buffer exposed by the sender.
+  // PUT: destination address of the payload following this header.
+  uint64_t remoteAddr{0};
+  // PUT: payload bytes following this header on this stream.
+  uint64_t len{0};
+  // PUT: total bytes of the put across all streams.
+  uint64_t totalLen{0};
+  uint64_t regId{0};
+};
+
+/**
+ * Outstanding send on a single socket stream. A put striped across N streams
+ * owns N send ops that share the same request.
+ */
+struct CtranSocketSendOp {
+  struct CtranSocketMsgHdr hdr;
+  int hdrOffset{0};
+  const char* sbuf{nullptr};
+  bool srcIsDevice{false};
+  // payload bytes handed to the kernel
+  uint64_t sent{0};
+  // payload bytes staged in the bounce buffer (device source only)
+  uint64_t staged{0};
+  // payload bytes of the bounce buffer already handed to the kernel
+  uint64_t stagedSent{0};
+  // last zero-copy sequence number used by this op, if any
+  bool zcopy{false};
+  uint32_t zcopyLastId{0};
+  CtranSocketRequest* req{nullptr};
+};
+
+/**
+ * Posted or unexpected receive of a control message.
+ */
+struct CtranSocketCtrlWr {
+  struct {
+    void** buf{nullptr};
+    struct CtranSocketRemoteAccessKey* key{nullptr};
+    CtranSocketRequest* req{nullptr};
+  } recv;
+  struct {
+    uint64_t remoteAddr{0};
+    uint64_t regId{0};
+  } unex;
+};
+
+/**
+ * Structure to describe a pending control operation posted before the
+ * connection to the peer was established.
+ */
+struct CtranSocketPendingOp {
+  enum PendingOpType {
+    UNDEFINED,
+    ISEND_CTRL,
+    IRECV_CTRL,
+  } type{UNDEFINED};
+  struct {
+    void* buf{nullptr};
+    void* sockRegElem{nullptr};
+    int peerRank{-1};
+    CtranSocketRequest* req{nullptr};
+  } isendCtrl;
+  struct {
+    void** buf{nullptr};
+    struct CtranSocketRemoteAccessKey* key{nullptr};
+    int peerRank{-1};
+    CtranSocketRequest* req{nullptr};
+  } irecvCtrl;
+};
+
+class CtranSocket::Impl {
+ public:
+  Impl() = default;
+  ~Impl() = default;
+
+  static void bootstrapAccept(CtranSocket::Impl* pimpl);
+  ncclResult_t bootstrapConnect(int peerRank);
+  ncclResult_t bootstrapTerminate();
+
+  ncclComm* comm{nullptr};
+  int numStreams{1};
+  cudaStream_t stageStream{nullptr};
+
+  struct ncclSocket listenSocket;
+  ncclSocketAddress* allListenSocketAddrs{nullptr};
+  std::thread listenThread;
+
+  /* individual VCs for each peer */
+  class VirtualConn;
+  std::vector<class VirtualConn*> vcList;
+  // VCs that have been established; progress only walks these
+  std::vector<class VirtualConn*> activeVcs;
+  std::mutex m;
+
+  std::vector<struct CtranSocketPendingOp*> pendingOps;
+
+  // Registration lookup for incoming puts. Copies the element out under the
+  // lock since the owner may deregister it concurrently.
+  bool lookupRegElem(uint64_t regId, struct CtranSocketRegElem* regElem);
+  std::unordered_map<uint64_t, struct CtranSocketRegElem*> regElems;
+  uint64_t nextRegId{1};
+  std::mutex regMutex;
+
+ private:
+  ncclResult_t bootstrapConnect(int peerRank, int cmd);
+};
+
+#endif
@@ -0,0 +1,19 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include "CtranSocket.h"
+#include "checks.h"
+
+void CtranSocketRequest::setRefCount(int refCount) {
+  this->refCount_ = refCount;
+}
+
+void CtranSocketRequest::complete() {
+  this->refCount_--;
+  if (this->refCount_ == 0) {
+    this->state_ = CtranSocketRequest::COMPLETE;
+  }
+}
+
+bool CtranSocketRequest::isComplete() {
+  return this->state_ == CtranSocketRequest::COMPLETE;
+}
@@ -0,0 +1,548 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "nccl.h"
+#include "checks.h"
+#include "nccl_cvars.h"
+#include "CtranSocket.h"
+#include "CtranSocketImpl.h"
+#include "CtranSocketVc.h"
+
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && \
+    defined(SO_EE_ORIGIN_ZEROCOPY)
+#define CTRAN_SOCKET_ZCOPY_SUPPORTED 1
+#endif
+
+CtranSocket::Impl::VirtualConn::VirtualConn(
+    CtranSocket::Impl* pimpl,
+    int peerRank)
+    : peerRank(peerRank), pimpl_(pimpl) {
+  this->streams_.resize(pimpl->numStreams);
+}
+
+CtranSocket::Impl::VirtualConn::~VirtualConn() {
+  for (auto& s : this->streams_) {
+    for (auto op : s.sendQ) {
+      delete op;
+    }
+    for (auto op : s.zcopyQ) {
+      delete op;
+    }
+    if (s.connected) {
+      NCCLCHECKIGNORE(ncclSocketClose(&s.sock));
+    }
+    if (s.sendBounce != nullptr) {
+      CUDACHECKIGNORE(cudaFreeHost(s.sendBounce));
+    }
+    if (s.recvBounce != nullptr) {
+      CUDACHECKIGNORE(cudaFreeHost(s.recvBounce));
+    }
+  }
+}
+
+bool CtranSocket::Impl::VirtualConn::isReady() {
+  const std::lock_guard<std::mutex> lock(this->m_);
+  return this->isReady_;
+}
+
+ncclResult_t CtranSocket::Impl::VirtualConn::addStream(
+    struct ncclSocket* sock,
+    int idx,
+    bool* ready) {
+  const std::lock_guard<std::mutex> lock(this->m_);
+
+  if (idx < 0 || idx >= this->streams_.size() ||
+      this->streams_[idx].connected) {
+    WARN(
+        "CTRAN-SOCKET: invalid stream index %d from peer %d",
+        idx,
+        this->peerRank);
+    return ncclInternalError;
+  }
+
+  auto& s = this->streams_[idx];
+  s.sock = *sock;
+  s.connected = true;
+
+#ifdef CTRAN_SOCKET_ZCOPY_SUPPORTED
+  if (NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD >= 0) {
+    int one = 1;
+    if (setsockopt(s.sock.fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) ==
+        0) {
+      s.zcopyEnabled = true;
+    } else {
+      INFO(
+          NCCL_INIT,
+          "CTRAN-SOCKET: SO_ZEROCOPY not available (%s), falling back to copy sends",
+          strerror(errno));
+    }
+  }
+#endif
+
+  this->numConnected_++;
+  if (this->numConnected_ == this->streams_.size()) {
+    this->isReady_ = true;
+  }
+  *ready = this->isReady_;
+  return ncclSuccess;
+}
+
+int CtranSocket::Impl::VirtualConn::numStreamsForLen(std::size_t len) {
+  int n = (len / NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD) +
+      !!(len % NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD);
+  return std::max(1, std::min(n, static_cast<int>(this->streams_.size())));
+}
+
+ncclResult_t CtranSocket::Impl::VirtualConn::isendCtrl(
+    void* buf,
+    void* sockRegElem,
+    CtranSocketRequest* req) {
+  auto regElem = reinterpret_cast<struct CtranSocketRegElem*>(sockRegElem);
+
+  auto op = new struct CtranSocketSendOp;
+  op->hdr.type = CtranSocketMsgHdr::CTRL;
+  op->hdr.remoteAddr = reinterpret_cast<uint64_t>(buf);
+  op->hdr.regId = regElem->regId;
+  op->req = req;
+
+  /* control messages always use the first stream so they stay ordered */
+  this->streams_[0].sendQ.push_back(op);
+  return this->progressSend(this->streams_[0]);
+}
+
+ncclResult_t CtranSocket::Impl::VirtualConn::irecvCtrl(
+    void** buf,
+    struct CtranSocketRemoteAccessKey* key,
+    CtranSocketRequest* req) {
+  if (!this->unexpRecvCtrl_.empty()) {
+    auto wr = this->unexpRecvCtrl_.front();
+    this->unexpRecvCtrl_.pop_front();
+    *buf = reinterpret_cast<void*>(wr.unex.remoteAddr);
+    key->regId = wr.unex.regId;
+    req->complete();
+  } else {
+    struct CtranSocketCtrlWr wr;
+    wr.recv.buf = buf;
+    wr.recv.key = key;
+    wr.recv.req = req;
+    this->postedRecvCtrl_.push_back(wr);
+  }
+  return ncclSuccess;
+}
+
+ncclResult_t CtranSocket::Impl::VirtualConn::iput(
+    const void* sbuf,
+    void* dbuf,
+    std::size_t len,
+    void* sockRegElem,
+    struct CtranSocketRemoteAccessKey remoteAccessKey,
+    bool notify,
+    CtranSocketRequest* req) {
+  ncclResult_t res = ncclSuccess;
+  auto regElem = reinterpret_cast<struct CtranSocketRegElem*>(sockRegElem);
+  int numStreams = this->numStreamsForLen(len);
+  uint64_t offset = 0;
+
+  if (regElem == nullptr) {
+    WARN("CTRAN-SOCKET: iput to peer %d without a registered source buffer",
+        this->peerRank);
+    return ncclInvalidUsage;
+  }
+
+  if (req != nullptr) {
+    req->setRefCount(numStreams);
+  }
+
+  for (int i = 0; i < numStreams; i++) {
+    uint64_t segLen = len / numStreams;
+    if (i == 0) {
+      segLen += len % numStreams;
+    }
+
+    auto op = new struct CtranSocketSendOp;
+    op->hdr.type = CtranSocketMsgHdr::PUT;
+    op->hdr.notify = notify;
+    op->hdr.remoteAddr = reinterpret_cast<uint64_t>(dbuf) + offset;
+    op->hdr.len = segLen;
+    op->hdr.totalLen = len;
+    op->hdr.regId = remoteAccessKey.regId;
+    op->sbuf = reinterpret_cast<const char*>(sbuf) + offset;
+    op->srcIsDevice = regElem->isDevice;
+    op->req = req;
+    this->streams_[i].sendQ.push_back(op);
+
+    offset += segLen;
+  }
+
+  for (int i = 0; i < numStreams; i++) {
+    NCCLCHECKGOTO(this->progressSend(this->streams_[i]), res, exit);
+  }
+
+exit:
+  return res;
+}
+
+ncclResult_t CtranSocket::Impl::VirtualConn::progress() {
+  ncclResult_t res = ncclSuccess;
+
+  for (int i = 0; i < this->streams_.size(); i++) {
+    auto& s = this->streams_[i];
+    NCCLCHECKGOTO(this->progressSend(s), res, exit);
+    NCCLCHECKGOTO(this->progressZcopy(s), res, exit);
+    NCCLCHECKGOTO(this->progressRecv(s, i), res, exit);
+  }
+
+exit:
+  return res;
+}
+
+bool CtranSocket::Impl::VirtualConn::checkNotify() {
+  bool notify = false;
+  if (!this->streams_[0].notifications.empty()) {
+    // Always get message size from first stream
+    uint64_t msgSz = this->streams_[0].notifications.front();
+
+    // Calculate number of streams used in the data transfer
+    int numStreams = this->numStreamsForLen(msgSz);
+
+    // Return true only when received notification from all streams
+    notify = true;
+    for (int i = 0; i < numStreams; i++) {
+      if (this->streams_[i].notifications.empty()) {
+        notify = false;
+        break;
+      }
+    }
+
+    // Cleanup current set of notifications only after all streams' data
+    // transfer has completed
+    if (notify == true) {
+      for (int i = 0; i < numStreams; i++) {
+        this->streams_[i].notifications.pop_front();
+      }
+    }
+  }
+
+  return notify;
+}
+
+ncclResult_t CtranSocket::Impl::VirtualConn::progressSend(struct Stream& s) {
+  while (!s.sendQ.empty()) {
+    auto op = s.sendQ.front();
+
+    if (op->hdrOffset < sizeof(struct CtranSocketMsgHdr)) {
+      NCCLCHECK(ncclSocketProgress(
+          NCCL_SOCKET_SEND,
+          &s.sock,
+          &op->hdr,
+          sizeof(struct CtranSocketMsgHdr),
+          &op->hdrOffset));
+      if (op->hdrOffset < sizeof(struct CtranSocketMsgHdr)) {
+        /* socket buffer is full; retry on next progress */
+        return ncclSuccess;
+      }
+    }
+
+    if (op->hdr.type == CtranSocketMsgHdr::PUT && op->sent < op->hdr.len) {
+      bool blocked = false;
+      NCCLCHECK(this->progressSendPayload(s, op, &blocked));
+      if (blocked) {
+        return ncclSuccess;
+      }
+    }
+
+    s.sendQ.pop_front();
+    if (op->zcopy) {
+      /* user buffer is still referenced by the kernel until the zero-copy
+       * completion is reported on the error queue */
+      s.zcopyQ.push_back(op);
+    } else {
+      NCCLCHECK(this->completeSendOp(op));
+    }
+  }
+  return ncclSuccess;
+}
+
+ncclResult_t CtranSocket::Impl::VirtualConn::progressSendPayload(
+    struct Stream& s,
+    struct CtranSocketSendOp* op,
+    bool* blocked) {
+  const uint64_t chunkSize = NCCL_CTRAN_SOCKET_CHUNK_SIZE;
+
+  while (op->sent < op->hdr.len) {
+    const char* ptr;
+    uint64_t n;
+    int flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+
+    if (op->srcIsDevice) {
+      /* stage the next chunk once the bounce buffer has been drained */
+      if (op->stagedSent == op->staged) {
+        if (s.sendBounce == nullptr) {
+          CUDACHECK(cudaHostAlloc(
+              reinterpret_cast<void**>(&s.sendBounce),
+              chunkSize,
+              cudaHostAllocDefault));
+        }
+        op->staged = std::min(chunkSize, op->hdr.len - op->sent);
+        op->stagedSent = 0;
+        NCCLCHECK(
+            this->stageCopy(s.sendBounce, op->sbuf + op->sent, op->staged));
+      }
+      ptr = s.sendBounce + op->stagedSent;
+      n = op->staged - op->stagedSent;
+    } else {
+      ptr = op->sbuf + op->sent;
+      n = op->hdr.len - op->sent;
+    }
+
+#ifdef CTRAN_SOCKET_ZCOPY_SUPPORTED
+    bool useZcopy = !op->srcIsDevice && s.zcopyEnabled &&
+        op->hdr.len >= static_cast<uint64_t>(NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD);
+    if (useZcopy) {
+      flags |= MSG_ZEROCOPY;
+    }
+#else
+    bool useZcopy = false;
+#endif
+
+    ssize_t bytes = send(s.sock.fd, ptr, n, flags);
+    if (bytes < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ||
+          (useZcopy && errno == ENOBUFS)) {
+        /* ENOBUFS: too many zero-copy sends in flight; wait for completions */
+        *blocked = true;
+        return ncclSuccess;
+      }
+      WARN(
+          "CTRAN-SOCKET: send to peer %d failed: %s",
+          this->peerRank,
+          strerror(errno));
+      return ncclRemoteError;
+    }
+
+    if (useZcopy) {
+      op->zcopy = true;
+      op->zcopyLastId = s.zcopyNextId++;
+    }
+    op->sent += bytes;
+    if (op->srcIsDevice) {
+      op->stagedSent += bytes;
+    }
+  }
+
+  return ncclSuccess;
+}
+
+ncclResult_t CtranSocket::Impl::VirtualConn::progressZcopy(struct Stream& s) {
+#ifdef CTRAN_SOCKET_ZCOPY_SUPPORTED
+  if (!s.zcopyEnabled || s.zcopyQ.empty()) {
+    return ncclSuccess;
+  }
+
+  while (1) {
+    char control[128];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(s.sock.fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        break;
+      }
+      WARN(
+          "CTRAN-SOCKET: failed to read zero-copy completions from peer %d: %s",
+          this->peerRank,
+          strerror(errno));
+      return ncclRemoteError;
+    }
+
+    for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr;
+         cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+            (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+        continue;
+      }
+      auto serr = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+      /* [ee_info, ee_data] is the range of completed sends; TCP reports them
+       * in order, so tracking the upper bound is enough */
+      s.zcopyDoneId = serr->ee_data + 1;
+    }
+  }
+
+  while (!s.zcopyQ.empty()) {
+    auto op = s.zcopyQ.front();
+    if (static_cast<int32_t>(s.zcopyDoneId - op->zcopyLastId) <= 0) {
+      break;
+    }
+    s.zcopyQ.pop_front();
+    NCCLCHECK(this->completeSendOp(op));
+  }
+#endif
+  return ncclSuccess;
+}
+
+ncclResult_t CtranSocket::Impl::VirtualConn::progressRecv(
+    struct Stream& s,
+    int idx) {
+  const uint64_t chunkSize = NCCL_CTRAN_SOCKET_CHUNK_SIZE;
+
+  while (1) {
+    if (!s.inPayload) {
+      NCCLCHECK(ncclSocketProgress(
+          NCCL_SOCKET_RECV,
+          &s.sock,
+          &s.rhdr,
+          sizeof(struct CtranSocketMsgHdr),
+          &s.rhdrOffset));
+      if (s.rhdrOffset < sizeof(struct CtranSocketMsgHdr)) {
+        return ncclSuccess;
+      }
+      s.rhdrOffset = 0;
+
+      if (s.rhdr.type == CtranSocketMsgHdr::CTRL && idx != 0) {
+        WARN(
+            "CTRAN-SOCKET: unexpected control message on stream %d from peer %d",
+            idx,
+            this->peerRank);
+        return ncclInternalError;
+      }
+      NCCLCHECK(this->processRecvHdr(s));
+      if (!s.inPayload) {
+        continue;
+      }
+    }
+
+    while (s.received < s.rhdr.len) {
+      char* ptr;
+      uint64_t n;
+      if (s.dstIsDevice) {
+        if (s.recvBounce == nullptr) {
+          CUDACHECK(cudaHostAlloc(
+              reinterpret_cast<void**>(&s.recvBounce),
+              chunkSize,
+              cudaHostAllocDefault));
+        }
+        ptr = s.recvBounce + s.bounced;
+        n = std::min(chunkSize - s.bounced, s.rhdr.len - s.received);
+      } else {
+        ptr = s.rdst + s.received;
+        n = s.rhdr.len - s.received;
+      }
+
+      ssize_t bytes = recv(s.sock.fd, ptr, n, MSG_DONTWAIT);
+      if (bytes == 0) {
+        WARN(
+            "CTRAN-SOCKET: connection to peer %d closed unexpectedly",
+            this->peerRank);
+        return ncclRemoteError;
+      }
+      if (bytes < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+          return ncclSuccess;
+        }
+        WARN(
+            "CTRAN-SOCKET: recv from peer %d failed: %s",
+            this->peerRank,
+            strerror(errno));
+        return ncclRemoteError;
+      }
+
+      s.received += bytes;
+      if (s.dstIsDevice) {
+        s.bounced += bytes;
+        if (s.bounced == chunkSize || s.received == s.rhdr.len) {
+          NCCLCHECK(this->stageCopy(
+              s.rdst + s.received - s.bounced, s.recvBounce, s.bounced));
+          s.bounced = 0;
+        }
+      }
+    }
+
+    /* the whole segment has landed in the destination buffer */
+    if (s.rhdr.notify) {
+      s.notifications.push_back(s.rhdr.totalLen);
+    }
+    s.inPayload = false;
+  }
+
+  return ncclSuccess;
+}
+
+ncclResult_t CtranSocket::Impl::VirtualConn::processRecvHdr(struct Stream& s) {
+  if (s.rhdr.type == CtranSocketMsgHdr::CTRL) {
+    if (!this->postedRecvCtrl_.empty()) {
+      auto wr = this->postedRecvCtrl_.front();
+      this->postedRecvCtrl_.pop_front();
+      *wr.recv.buf = reinterpret_cast<void*>(s.rhdr.remoteAddr);
+      wr.recv.key->regId = s.rhdr.regId;
+      wr.recv.req->complete();
+    } else {
+      struct CtranSocketCtrlWr wr;
+      wr.unex.remoteAddr = s.rhdr.remoteAddr;
+      wr.unex.regId = s.rhdr.regId;
+      this->unexpRecvCtrl_.push_back(wr);
+    }
+    return ncclSuccess;
+  }
+
+  /* validate the destination against the local registration; unlike RDMA
+   * there is no NIC to enforce access rights for us */
+  struct CtranSocketRegElem regElem;
+  if (!this->pimpl_->lookupRegElem(s.rhdr.regId, &regElem)) {
+    WARN(
+        "CTRAN-SOCKET: put from peer %d targets unknown registration %lu",
+        this->peerRank,
+        s.rhdr.regId);
+    return ncclInternalError;
+  }
+  uint64_t base = reinterpret_cast<uint64_t>(regElem.buf);
+  if (s.rhdr.remoteAddr < base ||
+      s.rhdr.remoteAddr + s.rhdr.len > base + regElem.len) {
+    WARN(
+        "CTRAN-SOCKET: put from peer %d [%lx, %lx) exceeds registered range [%lx, %lx)",
+        this->peerRank,
+        s.rhdr.remoteAddr,
+        s.rhdr.remoteAddr + s.rhdr.len,
+        base,
+        base + regElem.len);
+    return ncclInternalError;
+  }
+
+  s.rdst = reinterpret_cast<char*>(s.rhdr.remoteAddr);
+  s.dstIsDevice = regElem.isDevice;
+  s.received = 0;
+  s.bounced = 0;
+  s.inPayload = true;
+  return ncclSuccess;
+}
+
+ncclResult_t CtranSocket::Impl::VirtualConn::completeSendOp(
+    struct CtranSocketSendOp* op) {
+  if (op->req != nullptr) {
+    op->req->complete();
+  }
+  delete op;
+  return ncclSuccess;
+}
+
+ncclResult_t CtranSocket::Impl::VirtualConn::stageCopy(
+    void* dst,
+    const void* src,
+    std::size_t len) {
+  CUDACHECK(cudaMemcpyAsync(
+      dst, src, len, cudaMemcpyDefault, this->pimpl_->stageStream));
+  CUDACHECK(cudaStreamSynchronize(this->pimpl_->stageStream));
+  return ncclSuccess;
+}
@@ -0,0 +1,92 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#ifndef CTRAN_SOCKET_VC_H_
+#define CTRAN_SOCKET_VC_H_
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "CtranSocketImpl.h"
+
+/**
+ * Virtual connection to manage the socket connection between two peers. A VC
+ * owns numStreams TCP connections; control messages always travel on stream
+ * 0 and put payloads are striped across streams.
+ */
+class CtranSocket::Impl::VirtualConn {
+ public:
+  VirtualConn(CtranSocket::Impl* pimpl, int peerRank);
+  ~VirtualConn();
+
+  // A vc becomes ready once all streams have been connected.
+  bool isReady();
+
+  // Attach an established socket as stream 'idx'. Returns true in 'ready' once
+  // all streams are attached.
+  ncclResult_t addStream(struct ncclSocket* sock, int idx, bool* ready);
+
+  ncclResult_t isendCtrl(void* buf, void* sockRegElem, CtranSocketRequest* req);
+  ncclResult_t irecvCtrl(
+      void** buf,
+      struct CtranSocketRemoteAccessKey* key,
+      CtranSocketRequest* req);
+  ncclResult_t iput(
+      const void* sbuf,
+      void* dbuf,
+      std::size_t len,
+      void* sockRegElem,
+      struct CtranSocketRemoteAccessKey remoteAccessKey,
+      bool notify,
+      CtranSocketRequest* req);
+
+  // Push pending sends and drain available receives on all streams.
+  ncclResult_t progress();
+
+  bool checkNotify();
+
+  // Global rank of remote peer.
+  int peerRank;
+
+ private:
+  struct Stream {
+    struct ncclSocket sock;
+    bool connected{false};
+    bool zcopyEnabled{false};
+    uint32_t zcopyNextId{0};
+    uint32_t zcopyDoneId{0};
+    std::deque<struct CtranSocketSendOp*> sendQ;
+    std::deque<struct CtranSocketSendOp*> zcopyQ;
+
+    struct CtranSocketMsgHdr rhdr;
+    int rhdrOffset{0};
+    bool inPayload{false};
+    char* rdst{nullptr};
+    bool dstIsDevice{false};
+    uint64_t received{0};
+    uint64_t bounced{0};
+
+    char* sendBounce{nullptr};
+    char* recvBounce{nullptr};
+    std::deque<uint64_t> notifications;
+  };
+
+  int numStreamsForLen(std::size_t len);
+  ncclResult_t progressSend(struct Stream& s);
+  ncclResult_t progressSendPayload(struct Stream& s, struct CtranSocketSendOp* op, bool* blocked);
+  ncclResult_t progressZcopy(struct Stream& s);
+  ncclResult_t progressRecv(struct Stream& s, int idx);
+  ncclResult_t processRecvHdr(struct Stream& s);
+  ncclResult_t completeSendOp(struct CtranSocketSendOp* op);
+  ncclResult_t stageCopy(void* dst, const void* src, std::size_t len);
+
+  CtranSocket::Impl* pimpl_{nullptr};
+  std::vector<struct Stream> streams_;
+  int numConnected_{0};
+  bool isReady_{false};
+  std::mutex m_;
+
+  std::deque<struct CtranSocketCtrlWr> postedRecvCtrl_;
+  std::deque<struct CtranSocketCtrlWr> unexpRecvCtrl_;
+};
+
+#endif
@@ -0,0 +1,291 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <gtest/gtest.h>
+#include <nccl.h>
+#include <stdlib.h>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "CtranSocket.h"
+#include "comm.h"
+#include "nccl_cvars.h"
+#include "tests_common.cuh"
+
+class MPIEnvironment : public ::testing::Environment {
+ public:
+  void SetUp() override {
+    initializeMpi(0, NULL);
+    // Turn off NCCL debug logging, allow user to turn on via command line
+    setenv("NCCL_DEBUG", "WARN", 0);
+  }
+  void TearDown() override {
+    finalizeMpi();
+  }
+  ~MPIEnvironment() override {}
+};
+
+class CtranSocketTest : public ::testing::Test {
+ public:
+  CtranSocketTest() = default;
+  void SetUp() override {
+    std::tie(this->localRank, this->globalRank, this->numRanks) = getMpiInfo();
+    this->comm =
+        createNcclComm(this->globalRank, this->numRanks, this->localRank);
+  }
+
+  void TearDown() override {
+    NCCLCHECK_TEST(ncclCommDestroy(this->comm));
+  }
+
+  void printTestDesc(const std::string& testName, const std::string& testDesc) {
+    if (this->globalRank == 0) {
+      std::cout << testName << " numRanks " << this->numRanks << "."
+                << std::endl
+                << testDesc << std::endl;
+    }
+  }
+
+  // Receiver exposes its buffer to the sender, then the sender puts 'len'
+  // bytes from sbuf into it with notify.
+  void putNotify(
+      CtranSocket* ctranSock,
+      void* buf,
+      void* handle,
+      std::size_t len,
+      int sendRank,
+      int recvRank) {
+    void* remoteBuf = nullptr;
+    struct CtranSocketRemoteAccessKey key = {0};
+    CtranSocketRequest *ctrlReq = nullptr, *putReq = nullptr;
+
+    if (this->globalRank == recvRank) {
+      NCCLCHECK_TEST(ctranSock->isendCtrl(buf, handle, sendRank, &ctrlReq));
+    } else if (this->globalRank == sendRank) {
+      NCCLCHECK_TEST(
+          ctranSock->irecvCtrl(&remoteBuf, &key, recvRank, &ctrlReq));
+    }
+
+    do {
+      NCCLCHECK_TEST(ctranSock->progress());
+    } while (!ctrlReq->isComplete());
+
+    if (this->globalRank == sendRank) {
+      NCCLCHECK_TEST(ctranSock->iput(
+          buf, remoteBuf, len, recvRank, handle, key, true, &putReq));
+      do {
+        NCCLCHECK_TEST(ctranSock->progress());
+      } while (!putReq->isComplete());
+      delete putReq;
+    } else {
+      NCCLCHECK_TEST(ctranSock->waitNotify(sendRank));
+    }
+    delete ctrlReq;
+  }
+
+ protected:
+  int localRank{0};
+  int globalRank{0};
+  int numRanks{0};
+  ncclComm_t comm;
+};
+
+TEST_F(CtranSocketTest, NormalInitialize) {
+  this->printTestDesc(
+      "NormalInitialize",
+      "Expect CtranSocket to be initialized without internal error.");
+
+  auto ctranSock =
+      std::unique_ptr<class CtranSocket>(new class CtranSocket(this->comm));
+}
+
+TEST_F(CtranSocketTest, RegMem) {
+  this->printTestDesc(
+      "RegMem",
+      "Expect RegMem and deregMem can be finished without internal error, for any buffer size.");
+
+  auto ctranSock = std::unique_ptr<class CtranSocket>(new class CtranSocket(comm));
+  void* buf = nullptr;
+  void* handle = nullptr;
+
+  // Unlike IB, there is no page size limitation
+  for (size_t len : {512, 4096, 2048576}) {
+    CUDACHECK_TEST(cudaMalloc(&buf, len));
+    NCCLCHECK_TEST(ctranSock->regMem(buf, len, &handle));
+    EXPECT_NE(handle, nullptr);
+    NCCLCHECK_TEST(ctranSock->deregMem(handle));
+    CUDACHECK_TEST(cudaFree(buf));
+  }
+}
+
+TEST_F(CtranSocketTest, CpuMemSendRecvCtrl) {
+  this->printTestDesc(
+      "CpuMemSendRecvCtrl",
+      "Expect rank 0 can isendCtrl its local CPU buffer's address to rank 1 who calls irecvCtrl. "
+      "The received regId and remoteAddr should not be zero.");
+
+  auto ctranSock = std::unique_ptr<class CtranSocket>(new class CtranSocket(comm));
+  char buf[8192];
+  void* remoteBuf = nullptr;
+  void* handle = nullptr;
+  struct CtranSocketRemoteAccessKey key = {0};
+  CtranSocketRequest* req = nullptr;
+
+  NCCLCHECK_TEST(ctranSock->regMem(buf, 8192, &handle));
+  if (this->globalRank == 0) {
+    NCCLCHECK_TEST(ctranSock->isendCtrl(buf, handle, 1, &req));
+  } else if (this->globalRank == 1) {
+    NCCLCHECK_TEST(ctranSock->irecvCtrl(&remoteBuf, &key, 0, &req));
+  }
+
+  if (req != nullptr) {
+    do {
+      NCCLCHECK_TEST(ctranSock->progress());
+    } while (!req->isComplete());
+  }
+
+  if (this->globalRank == 1) {
+    EXPECT_NE(remoteBuf, nullptr);
+    EXPECT_NE(key.regId, 0);
+  }
+
+  NCCLCHECK_TEST(ctranSock->deregMem(handle));
+  delete req;
+}
+
+TEST_F(CtranSocketTest, CpuMemPutNotify) {
+  this->printTestDesc(
+      "CpuMemPutNotify",
+      "Expect rank 0 can put data from its local CPU data to rank 1 who waits on notify. "
+      "The received data should be equal to send data on rank 0.");
+
+#undef BUF_COUNT
+#define BUF_COUNT 8192
+  auto ctranSock = std::unique_ptr<class CtranSocket>(new class CtranSocket(comm));
+  std::vector<int> buf(BUF_COUNT);
+  void* handle = nullptr;
+  const int sendVal = 99, recvVal = -1;
+  const int sendRank = 0, recvRank = 1;
+
+  for (int i = 0; i < BUF_COUNT; i++) {
+    buf[i] = this->globalRank == sendRank ? sendVal : recvVal;
+  }
+
+  NCCLCHECK_TEST(
+      ctranSock->regMem(buf.data(), BUF_COUNT * sizeof(int), &handle));
+  if (this->globalRank == sendRank || this->globalRank == recvRank) {
+    this->putNotify(
+        ctranSock.get(),
+        buf.data(),
+        handle,
+        BUF_COUNT * sizeof(int),
+        sendRank,
+        recvRank);
+  }
+
+  if (this->globalRank == recvRank) {
+    for (int i = 0; i < BUF_COUNT; i++) {
+      EXPECT_EQ(buf[i], sendVal);
+    }
+  }
+
+  NCCLCHECK_TEST(ctranSock->deregMem(handle));
+}
+
+TEST_F(CtranSocketTest, GpuMemPutNotify) {
+  this->printTestDesc(
+      "GpuMemPutNotify",
+      "Expect rank 0 can put data from its local GPU data to rank 1 who waits on notify. "
+      "Data larger than NCCL_CTRAN_SOCKET_CHUNK_SIZE is staged through multiple bounce chunks.");
+
+  setenv("NCCL_CTRAN_SOCKET_CHUNK_SIZE", "65536", 1);
+  ncclCvarInit();
+
+#undef BUF_COUNT
+#define BUF_COUNT (1024 * 1024 + 17)
+  auto ctranSock = std::unique_ptr<class CtranSocket>(new class CtranSocket(comm));
+  int* buf;
+  std::vector<int> hostBuf(BUF_COUNT);
+  void* handle = nullptr;
+  const int sendRank = 0, recvRank = 1;
+
+  CUDACHECK_TEST(cudaMalloc(&buf, BUF_COUNT * sizeof(int)));
+  for (int i = 0; i < BUF_COUNT; i++) {
+    hostBuf[i] = this->globalRank == sendRank ? i : -1;
+  }
+  CUDACHECK_TEST(cudaMemcpy(
+      buf, hostBuf.data(), BUF_COUNT * sizeof(int), cudaMemcpyHostToDevice));
+
+  NCCLCHECK_TEST(ctranSock->regMem(buf, BUF_COUNT * sizeof(int), &handle));
+  if (this->globalRank == sendRank || this->globalRank == recvRank) {
+    this->putNotify(
+        ctranSock.get(),
+        buf,
+        handle,
+        BUF_COUNT * sizeof(int),
+        sendRank,
+        recvRank);
+  }
+
+  if (this->globalRank == recvRank) {
+    CUDACHECK_TEST(cudaMemcpy(
+        hostBuf.data(), buf, BUF_COUNT * sizeof(int), cudaMemcpyDeviceToHost));
+    for (int i = 0; i < BUF_COUNT; i++) {
+      EXPECT_EQ(hostBuf[i], i);
+    }
+  }
+
+  NCCLCHECK_TEST(ctranSock->deregMem(handle));
+  CUDACHECK_TEST(cudaFree(buf));
+  unsetenv("NCCL_CTRAN_SOCKET_CHUNK_SIZE");
+}
+
+TEST_F(CtranSocketTest, StripedPutNotify) {
+  this->printTestDesc(
+      "StripedPutNotify",
+      "Expect a put larger than the stream scaling threshold to be striped across streams, "
+      "with a single notification delivered once all segments have arrived.");
+
+  setenv("NCCL_CTRAN_SOCKET_NUM_STREAMS", "4", 1);
+  setenv("NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD", "4096", 1);
+  ncclCvarInit();
+
+#undef BUF_COUNT
+#define BUF_COUNT (3 * 1024 + 5)
+  auto ctranSock = std::unique_ptr<class CtranSocket>(new class CtranSocket(comm));
+  std::vector<int> buf(BUF_COUNT);
+  void* handle = nullptr;
+  const int sendRank = 0, recvRank = 1;
+
+  for (int i = 0; i < BUF_COUNT; i++) {
+    buf[i] = this->globalRank == sendRank ? i : -1;
+  }
+
+  NCCLCHECK_TEST(
+      ctranSock->regMem(buf.data(), BUF_COUNT * sizeof(int), &handle));
+  if (this->globalRank == sendRank || this->globalRank == recvRank) {
+    this->putNotify(
+        ctranSock.get(),
+        buf.data(),
+        handle,
+        BUF_COUNT * sizeof(int),
+        sendRank,
+        recvRank);
+  }
+
+  if (this->globalRank == recvRank) {
+    for (int i = 0; i < BUF_COUNT; i++) {
+      EXPECT_EQ(buf[i], i);
+    }
+  }
+
+  NCCLCHECK_TEST(ctranSock->deregMem(handle));
+  unsetenv("NCCL_CTRAN_SOCKET_NUM_STREAMS");
+  unsetenv("NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD");
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  ::testing::AddGlobalTestEnvironment(new MPIEnvironment);
+  return RUN_ALL_TESTS();
+}
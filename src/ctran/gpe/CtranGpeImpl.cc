@@ -1,7 +1,12 @@
 // (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
 
 #include "CtranGpeImpl.h"
+#include <linux/futex.h>
 #include <nccl.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
 #include <iostream>
 #include <new>
 #include <stdexcept>
@@ -20,20 +25,176 @@
      Size of kernel p2p elements pre-allocated for each communicator.
      Used to pass variable number of p2p operations to the kernel.
      Each p2p element is allocated from page-locked memory on the host.
+
+ - name        : NCCL_CTRAN_GPE_CMD_QUEUE_SIZE
+   type        : int
+   default     : 1024
+   description : |-
+     Number of pre-allocated command slots in the lock-free queue between
+     the submitting threads and the GPE thread of each communicator. It is
+     rounded up to the next power of two. Submission blocks while all slots
+     are in use.
+
+ - name        : NCCL_CTRAN_GPE_SPIN_USEC
+   type        : int
+   default     : 50
+   description : |-
+     Maximum time in microseconds the idle GPE thread spins waiting for a
+     new command before parking on a futex. The actual spin time adapts
+     between 0 and this value: it grows when commands arrive while spinning
+     and shrinks when the thread ends up parking. Set to 0 to always park.
+
+ - name        : NCCL_CTRAN_GPE_LATENCY_STATS
+   type        : bool
+   default     : false
+   description : |-
+     Record per-command host-side latency of the GPE (enqueue to dequeue,
+     dequeue to kernel start, kernel start to done) and report a summary at
+     NCCL_DEBUG=INFO when the communicator is destroyed.
 === END_NCCL_CVAR_INFO_BLOCK ===
 */
 
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+static inline void futexWait(std::atomic<uint32_t>* addr, uint32_t val) {
+  syscall(
+      SYS_futex,
+      reinterpret_cast<uint32_t*>(addr),
+      FUTEX_WAIT_PRIVATE,
+      val,
+      nullptr,
+      nullptr,
+      0);
+}
+
+static inline void futexWake(std::atomic<uint32_t>* addr) {
+  syscall(
+      SYS_futex,
+      reinterpret_cast<uint32_t*>(addr),
+      FUTEX_WAKE_PRIVATE,
+      1,
+      nullptr,
+      nullptr,
+      0);
+}
+
+static inline uint64_t durationNs(
+    std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+      .count();
+}
+
+static inline void atomicMax(std::atomic<uint64_t>& m, uint64_t val) {
+  uint64_t cur = m.load(std::memory_order_relaxed);
+  while (cur < val &&
+         !m.compare_exchange_weak(cur, val, std::memory_order_relaxed)) {
+  }
+}
+
+CtranGpeCmdQueue::CtranGpeCmdQueue(size_t capacity) {
+  this->capacity_ = 1;
+  while (this->capacity_ < capacity) {
+    this->capacity_ <<= 1;
+  }
+  this->mask_ = this->capacity_ - 1;
+
+  this->slots_ = new Slot[this->capacity_];
+  for (size_t i = 0; i < this->capacity_; i++) {
+    this->slots_[i].seq.store(i, std::memory_order_relaxed);
+  }
+}
+
+CtranGpeCmdQueue::~CtranGpeCmdQueue() {
+  delete[] this->slots_;
+}
+
+CtranGpeCmd* CtranGpeCmdQueue::reserve(uint64_t* ticket) {
+  uint64_t pos = this->enqueuePos_.load(std::memory_order_relaxed);
+  int iter = 0;
+
+  while (1) {
+    Slot* slot = &this->slots_[pos & this->mask_];
+    uint64_t seq = slot->seq.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+
+    if (diff == 0) {
+      // Slot is free for this position; try to claim it
+      if (this->enqueuePos_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) {
+        *ticket = pos;
+        return &slot->cmd;
+      }
+    } else if (diff < 0) {
+      // Queue is full; the consumer has not popped this slot yet. Back off
+      // and retry from the latest position.
+      if (++iter < 1024) {
+        cpuRelax();
+      } else {
+        sched_yield();
+      }
+      pos = this->enqueuePos_.load(std::memory_order_relaxed);
+    } else {
+      // Another producer claimed this position; retry from the latest one
+      pos = this->enqueuePos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void CtranGpeCmdQueue::commit(uint64_t ticket) {
+  this->slots_[ticket & this->mask_].seq.store(
+      ticket + 1, std::memory_order_release);
+}
+
+CtranGpeCmd* CtranGpeCmdQueue::front() {
+  Slot* slot = &this->slots_[this->dequeuePos_ & this->mask_];
+  if (slot->seq.load(std::memory_order_acquire) != this->dequeuePos_ + 1) {
+    return nullptr;
+  }
+  return &slot->cmd;
+}
+
+void CtranGpeCmdQueue::pop() {
+  Slot* slot = &this->slots_[this->dequeuePos_ & this->mask_];
+  // Drop any leftover ops before handing the slot back to producers
+  slot->cmd.coll.opGroup.clear();
+  slot->cmd.coll.func = nullptr;
+  slot->seq.store(
+      this->dequeuePos_ + this->capacity_, std::memory_order_release);
+  this->dequeuePos_++;
+}
+
+bool CtranGpeCmdQueue::empty() {
+  return this->front() == nullptr;
+}
+
+size_t CtranGpeCmdQueue::capacity() {
+  return this->capacity_;
+}
+
 CtranGpe::Impl::Impl() {
   CUDACHECKTHROW(
       cudaHostAlloc(&this->kernelFlag, sizeof(int), cudaHostAllocDefault));
   *(this->kernelFlag) = UNSET;
 
+  this->cmdQueue = std::unique_ptr<CtranGpeCmdQueue>(new CtranGpeCmdQueue(
+      std::max(NCCL_CTRAN_GPE_CMD_QUEUE_SIZE, 1)));
+  this->spinBudget = std::chrono::microseconds(
+      std::max(NCCL_CTRAN_GPE_SPIN_USEC, 0));
+
   this->kernelP2pElemPool = std::unique_ptr<KernelP2pElemPool>(
       new KernelP2pElemPool(NCCL_CTRAN_NUM_KERNEL_P2PELEMS));
   return;
 }
 
 CtranGpe::Impl::~Impl() {
+  this->reportStats();
   CUDACHECKIGNORE(cudaFreeHost(this->kernelFlag));
 
   // Dot not throw exception in destructor to avoid early termination in stack
@@ -55,18 +216,19 @@ ncclResult_t CtranGpe::Impl::submit(
 
   // Enqueue op to gpeThread if any op is appended
   if (!opGroup.empty()) {
-    struct CtranGpeCmd* cmd = new struct CtranGpeCmd;
+    uint64_t ticket;
+    struct CtranGpeCmd* cmd = this->cmdQueue->reserve(&ticket);
     cmd->type = type;
+    if (NCCL_CTRAN_GPE_LATENCY_STATS) {
+      cmd->ts.enqueue = std::chrono::steady_clock::now();
+    }
 
     if (type == CtranGpeCmd::TypeEnum::GRAPH_ENQUEUE) {
       cmd->coll.opGroup = std::move(opGroup);
       cmd->coll.func = func;
     }
 
-    this->m.lock();
-    cmdQueue.push(cmd);
-    this->m.unlock();
-    c.notify_one();
+    this->enqueue(ticket);
   }
 
   // Enqueue the kernel with arguments.  It will not start till all other
@@ -85,39 +247,151 @@ ncclResult_t CtranGpe::Impl::submit(
 }
 
 ncclResult_t CtranGpe::Impl::terminate() {
-  struct CtranGpeCmd* cmd = new struct CtranGpeCmd;
+  uint64_t ticket;
+  struct CtranGpeCmd* cmd = this->cmdQueue->reserve(&ticket);
   cmd->type = CtranGpeCmd::TypeEnum::TERMINATE;
 
-  this->m.lock();
-  cmdQueue.push(cmd);
-  this->m.unlock();
-  c.notify_one();
+  this->enqueue(ticket);
 
   return ncclSuccess;
 }
 
-void CtranGpe::Impl::gpeThreadFn(CtranGpe::Impl* pimpl, int cudaDev) {
-  CUDACHECKTHROW(cudaSetDevice(cudaDev));
+void CtranGpe::Impl::enqueue(uint64_t ticket) {
+  this->cmdQueue->commit(ticket);
+
+  // Pairs with the fence in waitCmd: either the GPE thread sees the new
+  // command before parking, or we see it parked and wake it up.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->parked.load(std::memory_order_relaxed)) {
+    this->parked.store(0, std::memory_order_relaxed);
+    futexWake(&this->parked);
+  }
+}
+
+CtranGpeCmd* CtranGpe::Impl::waitCmd() {
+  const auto maxSpin = std::chrono::microseconds(
+      std::max(NCCL_CTRAN_GPE_SPIN_USEC, 0));
+  const auto minSpin = std::chrono::microseconds(1);
+  CtranGpeCmd* cmd = this->cmdQueue->front();
+  if (cmd) {
+    return cmd;
+  }
 
   while (1) {
-    CtranGpeCmd* cmd;
+    // Spin for the current budget, checking the clock only every few
+    // iterations to keep the loop tight
+    auto start = std::chrono::steady_clock::now();
+    int iter = 0;
+    while (this->spinBudget.count() > 0) {
+      cmd = this->cmdQueue->front();
+      if (cmd) {
+        // Submissions are arriving back to back; allow spinning longer
+        this->spinBudget = std::min(
+            std::chrono::nanoseconds(maxSpin),
+            std::max(this->spinBudget * 2, std::chrono::nanoseconds(minSpin)));
+        return cmd;
+      }
+      cpuRelax();
+      if ((++iter & 63) == 0 &&
+          std::chrono::steady_clock::now() - start >= this->spinBudget) {
+        break;
+      }
+    }
 
-    {
-      std::unique_lock<std::mutex> lk(pimpl->m);
-      pimpl->c.wait(lk, [&] { return !pimpl->cmdQueue.empty(); });
+    // Nothing arrived while spinning; spin less next time and park
+    this->spinBudget /= 2;
+    if (this->spinBudget < minSpin) {
+      this->spinBudget = std::chrono::nanoseconds(0);
+    }
 
-      cmd = pimpl->cmdQueue.front();
-      pimpl->cmdQueue.pop();
+    this->parked.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    cmd = this->cmdQueue->front();
+    if (cmd) {
+      this->parked.store(0, std::memory_order_relaxed);
+      return cmd;
     }
+    this->stats.numParks.fetch_add(1, std::memory_order_relaxed);
+    futexWait(&this->parked, 1);
+    this->parked.store(0, std::memory_order_relaxed);
+
+    cmd = this->cmdQueue->front();
+    if (cmd) {
+      // Woken up by a submission; give spinning another chance
+      if (this->spinBudget.count() == 0 && maxSpin.count() > 0) {
+        this->spinBudget = minSpin;
+      }
+      return cmd;
+    }
+  }
+}
+
+void CtranGpe::Impl::recordStats(CtranGpeCmd* cmd) {
+  uint64_t queueNs = durationNs(cmd->ts.enqueue, cmd->ts.dequeue);
+  uint64_t launchNs = durationNs(cmd->ts.dequeue, cmd->ts.kernelStart);
+  uint64_t execNs = durationNs(cmd->ts.kernelStart, cmd->ts.done);
+
+  this->stats.numCmds.fetch_add(1, std::memory_order_relaxed);
+  this->stats.queueNs.fetch_add(queueNs, std::memory_order_relaxed);
+  this->stats.launchNs.fetch_add(launchNs, std::memory_order_relaxed);
+  this->stats.execNs.fetch_add(execNs, std::memory_order_relaxed);
+  atomicMax(this->stats.maxQueueNs, queueNs);
+  atomicMax(this->stats.maxLaunchNs, launchNs);
+  atomicMax(this->stats.maxExecNs, execNs);
+}
+
+void CtranGpe::Impl::reportStats() {
+  uint64_t numCmds = this->stats.numCmds.load();
+  if (!NCCL_CTRAN_GPE_LATENCY_STATS || numCmds == 0) {
+    return;
+  }
+
+  INFO(
+      NCCL_INIT,
+      "CTRAN-GPE: %lu commands, %lu parks; avg/max latency (us) "
+      "enqueue->dequeue %.2f/%.2f, dequeue->kernel-start %.2f/%.2f, "
+      "kernel-start->done %.2f/%.2f",
+      numCmds,
+      this->stats.numParks.load(),
+      this->stats.queueNs.load() / 1e3 / numCmds,
+      this->stats.maxQueueNs.load() / 1e3,
+      this->stats.launchNs.load() / 1e3 / numCmds,
+      this->stats.maxLaunchNs.load() / 1e3,
+      this->stats.execNs.load() / 1e3 / numCmds,
+      this->stats.maxExecNs.load() / 1e3);
+}
+
+void CtranGpe::Impl::gpeThreadFn(CtranGpe::Impl* pimpl, int cudaDev) {
+  CUDACHECKTHROW(cudaSetDevice(cudaDev));
+
+  while (1) {
+    CtranGpeCmd* cmd = pimpl->waitCmd();
+    bool latencyStats = NCCL_CTRAN_GPE_LATENCY_STATS;
 
     if (cmd->type == CtranGpeCmd::TypeEnum::TERMINATE) {
+      pimpl->cmdQueue->pop();
       return;
     }
 
-    /* wait for the kernel to launch */
+    if (latencyStats) {
+      cmd->ts.dequeue = std::chrono::steady_clock::now();
+    }
+
+    /* wait for the kernel to launch; back off to yielding the core if the
+     * kernel is queued behind other work on its stream */
     volatile int* flag_d = pimpl->kernelFlag;
-    while (*flag_d != KERNEL_STARTED)
-      ;
+    int iter = 0;
+    while (*flag_d != KERNEL_STARTED) {
+      if (++iter < 1024) {
+        cpuRelax();
+      } else {
+        sched_yield();
+      }
+    }
+
+    if (latencyStats) {
+      cmd->ts.kernelStart = std::chrono::steady_clock::now();
+    }
 
     /* run collective */
     NCCLCHECKTHROW(cmd->coll.func(std::move(cmd->coll.opGroup)));
@@ -125,7 +399,12 @@ void CtranGpe::Impl::gpeThreadFn(CtranGpe::Impl* pimpl, int cudaDev) {
     /* stop kernel */
     *flag_d = KERNEL_TERMINATE;
 
-    delete cmd;
+    if (latencyStats) {
+      cmd->ts.done = std::chrono::steady_clock::now();
+      pimpl->recordStats(cmd);
+    }
+
+    pimpl->cmdQueue->pop();
   }
   return;
 }
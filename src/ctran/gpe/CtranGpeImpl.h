@@ -3,10 +3,9 @@
 #ifndef CTRAN_GPE_IMPL_H_
 #define CTRAN_GPE_IMPL_H_
 
-#include <condition_variable>
+#include <atomic>
+#include <chrono>
 #include <list>
-#include <mutex>
-#include <queue>
 #include <stack>
 #include <thread>
 #include "CtranGpe.h"
@@ -25,6 +24,80 @@ class CtranGpeCmd {
     std::vector<std::unique_ptr<struct OpElem>> opGroup;
     opFunc func;
   } coll;
+
+  // Timestamps of each stage of the command; only recorded when
+  // NCCL_CTRAN_GPE_LATENCY_STATS is enabled.
+  struct {
+    std::chrono::steady_clock::time_point enqueue;
+    std::chrono::steady_clock::time_point dequeue;
+    std::chrono::steady_clock::time_point kernelStart;
+    std::chrono::steady_clock::time_point done;
+  } ts;
+};
+
+/**
+ * Bounded lock-free multi-producer/single-consumer ring of GPE commands. All
+ * command objects are pre-allocated at construction and reused, so
+ * submitting a command neither takes a lock nor allocates memory.
+ * Producers reserve a slot, fill the command in place and commit it; the
+ * single consumer (the GPE thread) accesses the front command in place and
+ * pops it once done, which makes the slot available to producers again.
+ */
+class CtranGpeCmdQueue {
+ public:
+  // capacity is rounded up to the next power of two.
+  CtranGpeCmdQueue(size_t capacity);
+  ~CtranGpeCmdQueue();
+
+  // Reserve a free slot and return the command object to fill. Blocks with
+  // backoff while the queue is full. Safe to call from multiple threads.
+  // Output arguments:
+  //   - ticket: ticket to pass to commit once the command is filled
+  CtranGpeCmd* reserve(uint64_t* ticket);
+
+  // Publish a command previously reserved with ticket to the consumer.
+  void commit(uint64_t ticket);
+
+  // Return the front command if one has been committed, otherwise nullptr.
+  // Only called by the consumer.
+  CtranGpeCmd* front();
+
+  // Release the front command slot for reuse. Only called by the consumer.
+  void pop();
+
+  bool empty();
+
+  size_t capacity();
+
+ private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> seq;
+    CtranGpeCmd cmd;
+  };
+
+  Slot* slots_{nullptr};
+  size_t capacity_{0};
+  uint64_t mask_{0};
+  alignas(64) std::atomic<uint64_t> enqueuePos_{0};
+  alignas(64) uint64_t dequeuePos_{0};
+};
+
+/**
+ * Host-side latency counters of GPE commands, accumulated by the GPE thread.
+ */
+struct CtranGpeCmdStats {
+  std::atomic<uint64_t> numCmds{0};
+  // enqueue -> dequeue by the GPE thread
+  std::atomic<uint64_t> queueNs{0};
+  std::atomic<uint64_t> maxQueueNs{0};
+  // dequeue -> kernel started
+  std::atomic<uint64_t> launchNs{0};
+  std::atomic<uint64_t> maxLaunchNs{0};
+  // kernel started -> algorithm done and kernel released
+  std::atomic<uint64_t> execNs{0};
+  std::atomic<uint64_t> maxExecNs{0};
+  // number of times the GPE thread parked while idle
+  std::atomic<uint64_t> numParks{0};
 };
 
 /**
@@ -76,10 +149,20 @@ class CtranGpe::Impl {
 
   static void gpeThreadFn(class CtranGpe::Impl* pimpl, int cudaDev);
 
+  // Enqueue a filled command and wake up the GPE thread if it is parked.
+  void enqueue(uint64_t ticket);
+  // Wait for the next command with adaptive spin-then-park.
+  CtranGpeCmd* waitCmd();
+  void recordStats(CtranGpeCmd* cmd);
+  void reportStats();
+
   std::thread t;
-  std::queue<CtranGpeCmd*> cmdQueue;
-  std::mutex m;
-  std::condition_variable c;
+  std::unique_ptr<CtranGpeCmdQueue> cmdQueue;
+  // 1 when the GPE thread is parked (or about to park) on the futex
+  std::atomic<uint32_t> parked{0};
+  // current spin budget before parking, adapted to the submission pattern
+  std::chrono::nanoseconds spinBudget{0};
+  CtranGpeCmdStats stats;
   int* kernelFlag{nullptr};
   std::unique_ptr<KernelP2pElemPool> kernelP2pElemPool;
 };
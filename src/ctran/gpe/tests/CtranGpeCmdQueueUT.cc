@@ -0,0 +1,108 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "CtranGpeImpl.h"
+
+class CtranGpeCmdQueueTest : public ::testing::Test {
+ public:
+  CtranGpeCmdQueueTest() = default;
+
+  // Fill a command with a single OpElem tagging its producer and sequence
+  static void fillCmd(CtranGpeCmd* cmd, int producer, size_t seq) {
+    cmd->type = CtranGpeCmd::TypeEnum::GRAPH_ENQUEUE;
+    auto op = new struct OpElem(OpElem::opType::SEND, nullptr);
+    op->send.peerRank = producer;
+    op->send.count = seq;
+    cmd->coll.opGroup.push_back(std::unique_ptr<struct OpElem>(op));
+  }
+};
+
+TEST_F(CtranGpeCmdQueueTest, Capacity) {
+  auto q = std::unique_ptr<CtranGpeCmdQueue>(new CtranGpeCmdQueue(1000));
+  EXPECT_EQ(q->capacity(), 1024);
+  EXPECT_TRUE(q->empty());
+  EXPECT_EQ(q->front(), nullptr);
+}
+
+TEST_F(CtranGpeCmdQueueTest, SingleProducerFifo) {
+  constexpr int capacity = 8;
+  auto q = std::unique_ptr<CtranGpeCmdQueue>(new CtranGpeCmdQueue(capacity));
+
+  // Wrap around the ring several times
+  for (int round = 0; round < 4; round++) {
+    for (int i = 0; i < capacity; i++) {
+      uint64_t ticket;
+      auto cmd = q->reserve(&ticket);
+      fillCmd(cmd, 0, round * capacity + i);
+      // Reserved but not committed commands are not visible to the consumer
+      if (i == 0) {
+        EXPECT_TRUE(q->empty());
+      }
+      q->commit(ticket);
+    }
+
+    for (int i = 0; i < capacity; i++) {
+      auto cmd = q->front();
+      ASSERT_NE(cmd, nullptr);
+      ASSERT_EQ(cmd->coll.opGroup.size(), 1);
+      EXPECT_EQ(cmd->coll.opGroup[0]->send.count, round * capacity + i);
+      q->pop();
+    }
+    EXPECT_TRUE(q->empty());
+  }
+}
+
+TEST_F(CtranGpeCmdQueueTest, MultiProducerStress) {
+  constexpr int numProducers = 4;
+  constexpr size_t numCmdsPerProducer = 20000;
+  // Small ring so that producers frequently hit the full queue
+  auto q = std::unique_ptr<CtranGpeCmdQueue>(new CtranGpeCmdQueue(64));
+  std::atomic<int> ready{0};
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < numProducers; p++) {
+    producers.emplace_back([&, p]() {
+      ready++;
+      while (ready.load() < numProducers) {
+      }
+      for (size_t i = 0; i < numCmdsPerProducer; i++) {
+        uint64_t ticket;
+        auto cmd = q->reserve(&ticket);
+        fillCmd(cmd, p, i);
+        q->commit(ticket);
+      }
+    });
+  }
+
+  // Consumer checks every command arrives exactly once and in per-producer
+  // submission order
+  std::vector<size_t> nextSeq(numProducers, 0);
+  size_t total = 0;
+  while (total < numProducers * numCmdsPerProducer) {
+    auto cmd = q->front();
+    if (cmd == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(cmd->coll.opGroup.size(), 1);
+    int p = cmd->coll.opGroup[0]->send.peerRank;
+    ASSERT_GE(p, 0);
+    ASSERT_LT(p, numProducers);
+    ASSERT_EQ(cmd->coll.opGroup[0]->send.count, nextSeq[p]);
+    nextSeq[p]++;
+    total++;
+    q->pop();
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+  EXPECT_TRUE(q->empty());
+  for (int p = 0; p < numProducers; p++) {
+    EXPECT_EQ(nextSeq[p], numCmdsPerProducer);
+  }
+}
@@ -6,6 +6,7 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include "CtranMapperImpl.h"
@@ -23,14 +24,20 @@
  - name        : NCCL_CTRAN_PROFILING
    type        : enum
    default     : none
-   choices     : none, stdout, info, kineto
+   choices     : none, stats, stdout, info, kineto
    description : |-
      Kind of ctran profiling needed.
      none - No profiling
+     stats  - Only keep fixed-size latency statistics of each phase
+              (recvCtrl, putIssue, putComplete) per peer, and report
+              them with the slowest peers to NCCL_DEBUG INFO every
+              NCCL_CTRAN_PROFILING_REPORT_COUNT ops. Meant to stay on
+              in long jobs.
      stdout - Dump profiling data to stdout
      info   - Dump profiling data to NCCL_DEBUG INFO
      kineto - Dump profiling data to a kineto log
         (for kineto profiling, see also NCCL_CTRAN_KINETO_PROFILE_DIR)
+     stdout and info also report the statistics of stats.
 
  - name        : NCCL_CTRAN_KINETO_PROFILE_DIR
    type        : string
@@ -56,10 +63,14 @@
  - name        : NCCL_CTRAN_BACKENDS
    type        : enumlist
    default     : ib
-   choices     : ib
+   choices     : ib, socket
    description : |-
      Backends to enable for ctran
      ib - RoCE/IB backend
+     socket - TCP socket backend (e.g., for hosts without RDMA NICs)
+     All ranks use the same backend for all peers: IB if it is listed and
+     available on all ranks, socket otherwise. Communicator initialization
+     fails if none of the listed backends is available.
 
  - name        : NCCL_CTRAN_REGISTER_REPORT_SNAPSHOT_COUNT
    type        : int
@@ -90,16 +101,30 @@ static std::unordered_map<GlobalRegistDurationType, std::string>
         {LOOKUP_MISS, "lookup-miss"},
 };
 static std::unordered_map<uint64_t, CtranMapper*> allCommHashCtranMapperMap;
-static std::unordered_map<GlobalRegistDurationType, std::vector<double>>
-    allCommRegistDurationsMap;
 static std::mutex allCommMutex;
 
-static double sumDurations(std::vector<double>& durs) {
-  double total = 0;
-  for (auto& dur : durs) {
-    total += dur;
-  }
-  return total;
+/* Number of slowest peers reported with NCCL_CTRAN_PROFILING stats */
+static constexpr int kNumReportedStragglers = 4;
+
+/* Latencies accumulated from all communicators, as fixed-size histograms so
+ * that recording them takes no lock. Shared with NcclMetrics when exported,
+ * kept local otherwise. */
+static NcclMetricHistogram& registDurations(GlobalRegistDurationType key) {
+  static auto durations = []() {
+    std::unordered_map<
+        GlobalRegistDurationType,
+        std::shared_ptr<NcclMetricHistogram>>
+        m;
+    bool exported = NcclMetrics::enabled();
+    for (auto& it : globalRegistDurationTypeNameMap) {
+      m[it.first] = exported
+          ? NcclMetrics::getInstance().histogram(
+                "nccl_ctran_regist_latency_ns", {{"type", it.second}})
+          : std::make_shared<NcclMetricHistogram>();
+    }
+    return m;
+  }();
+  return *durations.at(key);
 }
 
 static void reportGlobalRegSnapshot(void) {
@@ -112,44 +137,34 @@ static void reportGlobalRegSnapshot(void) {
   }
 
   // Timers accumulated from all communicators
-  for (auto& it : allCommRegistDurationsMap) {
-    auto& key = it.first;
-    auto& durs = it.second;
-    size_t numDurs = durs.size();
-    if (numDurs) {
-      double totalLat = sumDurations(durs);
+  for (auto& it : globalRegistDurationTypeNameMap) {
+    auto snap = registDurations(it.first).snapshot();
+    if (snap.count) {
       INFO(
           NCCL_INIT,
-          "CTRAN-MAPPER: [register snapshot] total %s latency across all comms %.2f ms, average %.2f ms across %lu %s",
-          globalRegistDurationTypeNameMap[key].c_str(),
-          totalLat,
-          totalLat / numDurs,
-          numDurs,
-          globalRegistDurationTypeNameMap[key].c_str());
+          "CTRAN-MAPPER: [register snapshot] total %s latency across all comms %.2f ms, average %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms across %lu %s",
+          it.second.c_str(),
+          snap.sum / 1e6,
+          snap.sum / 1e6 / snap.count,
+          snap.quantile(0.5) / 1e6,
+          snap.quantile(0.99) / 1e6,
+          snap.max / 1e6,
+          snap.count,
+          it.second.c_str());
     }
   }
 }
 
 static void recordRegistDuration(
     GlobalRegistDurationType key,
-    double duration) {
-  allCommMutex.lock();
-  allCommRegistDurationsMap[key].push_back(duration);
+    uint64_t durationNs) {
+  auto& durations = registDurations(key);
+  durations.record(durationNs);
 
   // Allow periodical snapshot report during long job running
-  bool shouldReport = false;
   if (key == GlobalRegistDurationType::REG_MEM &&
       NCCL_CTRAN_REGISTER_REPORT_SNAPSHOT_COUNT > 0 &&
-      (allCommRegistDurationsMap[key].size() %
-           NCCL_CTRAN_REGISTER_REPORT_SNAPSHOT_COUNT ==
-       0)) {
-    shouldReport = true;
-  }
-  allCommMutex.unlock();
-
-  // Call report after unlock since we will lock again inside
-  // reportGlobalRegSnapshot
-  if (shouldReport) {
+      (durations.count() % NCCL_CTRAN_REGISTER_REPORT_SNAPSHOT_COUNT == 0)) {
     reportGlobalRegSnapshot();
   }
 }
@@ -165,36 +180,76 @@ CtranMapper::CtranMapper(ncclComm* comm) {
   for (auto b : NCCL_CTRAN_BACKENDS) {
     if (b == NCCL_CTRAN_BACKENDS::ib) {
       this->pimpl_->backends.push_back(CtranMapperBackend::IB);
+    } else if (b == NCCL_CTRAN_BACKENDS::socket) {
+      this->pimpl_->backends.push_back(CtranMapperBackend::SOCKET);
     }
   }
 
-  /* enable available backends
-   * NOTE: currently only support IB backend
-   */
-  this->pimpl_->ctranIb = nullptr;
-  auto it = std::find(
-      this->pimpl_->backends.begin(),
-      this->pimpl_->backends.end(),
-      CtranMapperBackend::IB);
+  /* enable available backends */
+  bool useIb = std::find(
+                   this->pimpl_->backends.begin(),
+                   this->pimpl_->backends.end(),
+                   CtranMapperBackend::IB) != this->pimpl_->backends.end();
+  bool useSock = std::find(
+                     this->pimpl_->backends.begin(),
+                     this->pimpl_->backends.end(),
+                     CtranMapperBackend::SOCKET) !=
+      this->pimpl_->backends.end();
+
   /* initialize Ctran IB backend */
-  if (it != this->pimpl_->backends.end()) {
+  this->pimpl_->ctranIb = nullptr;
+  if (useIb) {
     try {
       this->pimpl_->ctranIb =
           std::unique_ptr<class CtranIb>(new class CtranIb(comm));
-    } catch (const std::bad_alloc& e) {
-      WARN("CTRAN: IB backend not enabled");
+    } catch (const std::exception& e) {
+      WARN("CTRAN: IB backend not enabled: %s", e.what());
     }
-  }
 
-  /* create rankBackendMap, index 'i' indicates the backend used for rank 'i' */
-  for (int i = 0; i < comm->nRanks; i++) {
-    if (this->pimpl_->ctranIb != nullptr) {
-      this->pimpl_->rankBackendMap.push_back(CtranMapperBackend::IB);
-    } else {
-      this->pimpl_->rankBackendMap.push_back(CtranMapperBackend::UNSET);
+    /* IB is only used if it is available on all ranks, otherwise all ranks
+     * would not agree on the backend of their peers */
+    std::vector<int> ibReady(comm->nRanks);
+    ibReady[comm->rank] = this->pimpl_->ctranIb != nullptr;
+    NCCLCHECKTHROW(
+        bootstrapAllGather(comm->bootstrap, ibReady.data(), sizeof(int)));
+    auto notReady = std::find(ibReady.begin(), ibReady.end(), 0);
+    if (notReady != ibReady.end()) {
+      if (this->pimpl_->ctranIb != nullptr) {
+        INFO(
+            NCCL_INIT,
+            "CTRAN: IB backend not enabled, not available on rank %ld",
+            notReady - ibReady.begin());
+      }
+      this->pimpl_->ctranIb.reset();
     }
   }
 
+  /* initialize Ctran socket backend, only if IB is not used so that its
+   * connections and threads are not set up for nothing */
+  this->pimpl_->ctranSock = nullptr;
+  if (useSock && this->pimpl_->ctranIb == nullptr) {
+    this->pimpl_->ctranSock =
+        std::unique_ptr<class CtranSocket>(new class CtranSocket(comm));
+  }
+
+  if (!this->pimpl_->backends.empty() && this->pimpl_->ctranIb == nullptr &&
+      this->pimpl_->ctranSock == nullptr) {
+    WARN(
+        "CTRAN: none of the backends of NCCL_CTRAN_BACKENDS is available on all ranks");
+    throw std::runtime_error("CTRAN: no backend available");
+  }
+
+  /* create rankBackendMap, index 'i' indicates the backend used for rank 'i'.
+   * All ranks use the same backend for all peers. The map is only UNSET when
+   * NCCL_CTRAN_BACKENDS is empty. */
+  CtranMapperBackend backend = CtranMapperBackend::UNSET;
+  if (this->pimpl_->ctranIb != nullptr) {
+    backend = CtranMapperBackend::IB;
+  } else if (this->pimpl_->ctranSock != nullptr) {
+    backend = CtranMapperBackend::SOCKET;
+  }
+  this->pimpl_->rankBackendMap.assign(comm->nRanks, backend);
+
   this->pimpl_->numRegistrations = 0;
   this->pimpl_->numCachedRegistrations = 0;
   this->pimpl_->totalNumDynamicRegistrations = 0;
@@ -208,6 +263,13 @@ CtranMapper::CtranMapper(ncclComm* comm) {
 
   this->rank = comm->rank;
   this->commHash = comm->commHash;
+  this->pimpl_->peerStats = std::unique_ptr<CtranMapperPeerStats>(
+      new CtranMapperPeerStats(comm->nRanks));
+  this->pimpl_->nRanks = comm->nRanks;
+  this->pimpl_->pendingReqs = std::unique_ptr<std::atomic<int>[]>(
+      new std::atomic<int>[comm->nRanks * CtranMapperRequest::NUM_KINDS]());
+  this->pimpl_->waitingNotify = std::unique_ptr<std::atomic<bool>[]>(
+      new std::atomic<bool>[comm->nRanks]());
 
   if (NCCL_CTRAN_REGISTER_REPORT_SNAPSHOT_COUNT >= 0) {
     allCommMutex.lock();
@@ -232,7 +294,108 @@ void CtranMapper::reportRegSnapshot(void) {
       this->pimpl_->totalNumRegLookupMiss);
 }
 
+void CtranMapper::impl::recordTimestamp(
+    const CtranMapperTimestamp& ts,
+    int rank,
+    uint64_t commHash) {
+  if (NCCL_CTRAN_PROFILING != NCCL_CTRAN_PROFILING::none) {
+    this->peerStats->record(ts);
+  }
+  if (!NcclMetrics::enabled()) {
+    return;
+  }
+
+  auto it = this->algoMetrics.find(ts.algo);
+  if (it == this->algoMetrics.end()) {
+    NcclMetricLabels labels = {
+        {"comm", hashToHexStr(commHash)},
+        {"rank", std::to_string(rank)},
+        {"algo", ts.algo}};
+    auto& metrics = NcclMetrics::getInstance();
+    it = this->algoMetrics
+             .emplace(
+                 ts.algo,
+                 AlgoMetrics{
+                     metrics.histogram("nccl_ctran_coll_latency_ns", labels),
+                     metrics.histogram("nccl_ctran_put_latency_ns", labels)})
+             .first;
+  }
+
+  ctranMapperForEachPut(ts, [&](int peer, uint64_t latencyNs) {
+    it->second.putLatencyNs->record(latencyNs);
+  });
+  auto last = ts.start;
+  for (auto& tsp : ts.putComplete) {
+    last = std::max(last, tsp.now);
+  }
+  for (auto& tsp : ts.recvCtrl) {
+    last = std::max(last, tsp.now);
+  }
+  it->second.collLatencyNs->record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(last - ts.start)
+          .count());
+}
+
+bool CtranMapper::getPeerLatencyStats(
+    int peer,
+    CtranMapperPhase phase,
+    CtranMapperLatencyStats& stats) {
+  return this->pimpl_->peerStats->get(peer, phase, stats);
+}
+
+void CtranMapper::getPendingPeers(
+    std::vector<CtranMapperPeerPending>& pending) {
+  pending.clear();
+  for (int peer = 0; peer < this->pimpl_->nRanks; peer++) {
+    auto reqs =
+        &this->pimpl_->pendingReqs[peer * CtranMapperRequest::NUM_KINDS];
+    CtranMapperPeerPending p;
+    p.peer = peer;
+    p.sendCtrl =
+        reqs[CtranMapperRequest::SEND_CTRL].load(std::memory_order_relaxed);
+    p.recvCtrl =
+        reqs[CtranMapperRequest::RECV_CTRL].load(std::memory_order_relaxed);
+    p.put = reqs[CtranMapperRequest::PUT].load(std::memory_order_relaxed);
+    p.waitNotify =
+        this->pimpl_->waitingNotify[peer].load(std::memory_order_relaxed);
+    if (p.sendCtrl || p.recvCtrl || p.put || p.waitNotify) {
+      pending.push_back(p);
+    }
+  }
+}
+
 void CtranMapper::reportProfiling(bool flush) {
+  /* Aggregate the timestamps not recorded yet */
+  for (size_t i = this->pimpl_->numRecordedTimestamps;
+       i < this->timestamps.size();
+       i++) {
+    this->pimpl_->recordTimestamp(
+        *this->timestamps[i], this->rank, this->commHash);
+    this->pimpl_->numStatsOps++;
+  }
+  this->pimpl_->numRecordedTimestamps = this->timestamps.size();
+
+  /* Only the timeline modes need the timestamps themselves, so that memory
+   * does not grow with the number of collectives otherwise */
+  if (NCCL_CTRAN_PROFILING == NCCL_CTRAN_PROFILING::none ||
+      NCCL_CTRAN_PROFILING == NCCL_CTRAN_PROFILING::stats) {
+    this->timestamps.clear();
+    this->pimpl_->numRecordedTimestamps = 0;
+  }
+
+  if (NCCL_CTRAN_PROFILING == NCCL_CTRAN_PROFILING::stats &&
+      this->pimpl_->numStatsOps > 0 &&
+      (this->pimpl_->numStatsOps > NCCL_CTRAN_PROFILING_REPORT_COUNT ||
+       flush)) {
+    INFO(
+        NCCL_INIT,
+        "CTRAN-MAPPER: [profiling stats] rank %d commHash %lx:\n%s",
+        this->rank,
+        this->commHash,
+        this->pimpl_->peerStats->summary(kNumReportedStragglers).c_str());
+    this->pimpl_->numStatsOps = 0;
+  }
+
   /* flush timestamps */
   if (!this->timestamps.empty() &&
       ((this->timestamps.size() > NCCL_CTRAN_PROFILING_REPORT_COUNT ||
@@ -275,6 +438,11 @@ void CtranMapper::reportProfiling(bool flush) {
           ss.clear();
         }
       }
+      ss << "    per-peer latency statistics:" << std::endl
+         << this->pimpl_->peerStats->summary(kNumReportedStragglers);
+      if (NCCL_CTRAN_PROFILING == NCCL_CTRAN_PROFILING::info) {
+        INFO(NCCL_INIT, "%s", ss.str().c_str());
+      }
       if (NCCL_CTRAN_PROFILING == NCCL_CTRAN_PROFILING::stdout) {
         std::cout << ss.str() << std::flush;
       }
@@ -378,11 +546,16 @@ void CtranMapper::reportProfiling(bool flush) {
       }
     }
     this->timestamps.clear();
+    this->pimpl_->numRecordedTimestamps = 0;
   }
 }
 
 CtranMapper::~CtranMapper() {
   this->reportProfiling(true);
+  if (NcclMetrics::enabled()) {
+    NcclMetrics::getInstance().removeMetrics(
+        "nccl_ctran_", {{"comm", hashToHexStr(this->commHash)}});
+  }
 
   /* safely de-register any bufferes applications may miss */
   auto v = this->pimpl_->mapperRegElemList->getAllElems();
@@ -429,11 +602,22 @@ ncclResult_t CtranMapper::impl::regMem(
         exit);
   }
 
+  if (this->ctranSock != nullptr) {
+    assert(mapperRegElem->sockRegElem == nullptr);
+    NCCLCHECKGOTO(
+        this->ctranSock->regMem(
+            mapperRegElem->buf,
+            mapperRegElem->len,
+            &mapperRegElem->sockRegElem),
+        res,
+        exit);
+  }
+
   mapperRegElem->state = CtranMapperRegElemState::REGISTERED;
   if (NCCL_CTRAN_REGISTER_REPORT_SNAPSHOT_COUNT >= 0) {
     this->numRegistrations++;
     this->totalNumRegistrations++;
-    recordRegistDuration(GlobalRegistDurationType::REG_MEM, dur.durationMs());
+    recordRegistDuration(GlobalRegistDurationType::REG_MEM, dur.durationNs());
   }
 
   INFO(
@@ -456,6 +640,11 @@ ncclResult_t CtranMapper::impl::deregMem(
     NCCLCHECKGOTO(this->ctranIb->deregMem(mapperRegElem->ibRegElem), res, exit);
   }
 
+  if (this->ctranSock != nullptr) {
+    NCCLCHECKGOTO(
+        this->ctranSock->deregMem(mapperRegElem->sockRegElem), res, exit);
+  }
+
   INFO(
       NCCL_COLL,
       "CTRAN-MAPPER: deregister buffer %p len %ld, state %d",
@@ -464,7 +653,7 @@ ncclResult_t CtranMapper::impl::deregMem(
       mapperRegElem->state);
   if (NCCL_CTRAN_REGISTER_REPORT_SNAPSHOT_COUNT >= 0) {
     this->numRegistrations--;
-    recordRegistDuration(GlobalRegistDurationType::DEREG_MEM, dur.durationMs());
+    recordRegistDuration(GlobalRegistDurationType::DEREG_MEM, dur.durationNs());
   }
 
   INFO(
@@ -504,6 +693,7 @@ ncclResult_t CtranMapper::regMem(
   mapperRegElem->buf = buf;
   mapperRegElem->len = len;
   mapperRegElem->ibRegElem = nullptr;
+  mapperRegElem->sockRegElem = nullptr;
   mapperRegElem->state = CtranMapperRegElemState::CACHED;
 
   *hdl = this->pimpl_->mapperRegElemList->insert(
@@ -587,11 +777,11 @@ ncclResult_t CtranMapper::searchRegHandle(
   if (NCCL_CTRAN_REGISTER_REPORT_SNAPSHOT_COUNT >= 0) {
     if (lookupHit) {
       recordRegistDuration(
-          GlobalRegistDurationType::LOOKUP_HIT, dur.durationMs());
+          GlobalRegistDurationType::LOOKUP_HIT, dur.durationNs());
       this->pimpl_->totalNumRegLookupHit++;
     } else {
       recordRegistDuration(
-          GlobalRegistDurationType::LOOKUP_MISS, dur.durationMs());
+          GlobalRegistDurationType::LOOKUP_MISS, dur.durationNs());
       this->pimpl_->totalNumRegLookupMiss++;
       if (*dynamicRegist) {
         this->pimpl_->totalNumDynamicRegistrations++;
@@ -654,6 +844,9 @@ ncclResult_t CtranMapper::progress(void) {
   if (this->pimpl_->ctranIb != nullptr) {
     NCCLCHECKGOTO(this->pimpl_->ctranIb->progress(), res, exit);
   }
+  if (this->pimpl_->ctranSock != nullptr) {
+    NCCLCHECKGOTO(this->pimpl_->ctranSock->progress(), res, exit);
+  }
 
 exit:
   return res;
@@ -666,18 +859,32 @@ ncclResult_t CtranMapper::isendCtrl(
     CtranMapperRequest** req) {
   ncclResult_t res = ncclSuccess;
 
-  if (this->pimpl_->ctranIb != nullptr) {
+  if (this->pimpl_->rankBackendMap[rank] == CtranMapperBackend::IB) {
     struct CtranMapperRegElem* mapperRegElem =
         reinterpret_cast<struct CtranMapperRegElem*>(
             this->pimpl_->mapperRegElemList->lookup(hdl));
 
     CtranIbRequest** ibReqPtr = nullptr;
     if (req) {
-      *req = new CtranMapperRequest(this, rank);
+      *req = new CtranMapperRequest(
+          this, rank, CtranMapperRequest::SEND_CTRL);
       ibReqPtr = &((*req)->ibReq);
     }
     res = this->pimpl_->ctranIb->isendCtrl(
         buf, mapperRegElem->ibRegElem, rank, ibReqPtr);
+  } else if (this->pimpl_->rankBackendMap[rank] == CtranMapperBackend::SOCKET) {
+    struct CtranMapperRegElem* mapperRegElem =
+        reinterpret_cast<struct CtranMapperRegElem*>(
+            this->pimpl_->mapperRegElemList->lookup(hdl));
+
+    CtranSocketRequest** sockReqPtr = nullptr;
+    if (req) {
+      *req = new CtranMapperRequest(
+          this, rank, CtranMapperRequest::SEND_CTRL);
+      sockReqPtr = &((*req)->sockReq);
+    }
+    res = this->pimpl_->ctranSock->isendCtrl(
+        buf, mapperRegElem->sockRegElem, rank, sockReqPtr);
   }
 
   return res;
@@ -690,13 +897,23 @@ ncclResult_t CtranMapper::irecvCtrl(
     CtranMapperRequest** req) {
   ncclResult_t res = ncclSuccess;
 
-  if (this->pimpl_->ctranIb != nullptr) {
+  if (this->pimpl_->rankBackendMap[rank] == CtranMapperBackend::IB) {
     CtranIbRequest** ibReqPtr = nullptr;
     if (req) {
-      *req = new CtranMapperRequest(this, rank);
+      *req = new CtranMapperRequest(
+          this, rank, CtranMapperRequest::RECV_CTRL);
       ibReqPtr = &((*req)->ibReq);
     }
     res = this->pimpl_->ctranIb->irecvCtrl(buf, &key->ibKey, rank, ibReqPtr);
+  } else if (this->pimpl_->rankBackendMap[rank] == CtranMapperBackend::SOCKET) {
+    CtranSocketRequest** sockReqPtr = nullptr;
+    if (req) {
+      *req = new CtranMapperRequest(
+          this, rank, CtranMapperRequest::RECV_CTRL);
+      sockReqPtr = &((*req)->sockReq);
+    }
+    res = this->pimpl_->ctranSock->irecvCtrl(
+        buf, &key->sockKey, rank, sockReqPtr);
   }
 
   return res;
@@ -713,13 +930,14 @@ ncclResult_t CtranMapper::iput(
     CtranMapperRequest** req) {
   ncclResult_t res = ncclSuccess;
 
-  if (this->pimpl_->ctranIb != nullptr) {
+  if (this->pimpl_->rankBackendMap[rank] == CtranMapperBackend::IB) {
     struct CtranMapperRegElem* mapperRegElem =
         reinterpret_cast<struct CtranMapperRegElem*>(
             this->pimpl_->mapperRegElemList->lookup(shdl));
     CtranIbRequest** ibReqPtr = nullptr;
     if (req) {
-      *req = new CtranMapperRequest(this, rank);
+      *req = new CtranMapperRequest(
+          this, rank, CtranMapperRequest::PUT);
       ibReqPtr = &((*req)->ibReq);
     }
     this->pimpl_->ctranIb->iput(
@@ -731,6 +949,25 @@ ncclResult_t CtranMapper::iput(
         remoteAccessKey.ibKey,
         notify,
         ibReqPtr);
+  } else if (this->pimpl_->rankBackendMap[rank] == CtranMapperBackend::SOCKET) {
+    struct CtranMapperRegElem* mapperRegElem =
+        reinterpret_cast<struct CtranMapperRegElem*>(
+            this->pimpl_->mapperRegElemList->lookup(shdl));
+    CtranSocketRequest** sockReqPtr = nullptr;
+    if (req) {
+      *req = new CtranMapperRequest(
+          this, rank, CtranMapperRequest::PUT);
+      sockReqPtr = &((*req)->sockReq);
+    }
+    res = this->pimpl_->ctranSock->iput(
+        sbuf,
+        dbuf,
+        len,
+        rank,
+        mapperRegElem->sockRegElem,
+        remoteAccessKey.sockKey,
+        notify,
+        sockReqPtr);
   }
 
   return res;
@@ -739,9 +976,13 @@ ncclResult_t CtranMapper::iput(
 ncclResult_t CtranMapper::checkNotify(int rank, bool* notify) {
   ncclResult_t res = ncclSuccess;
 
-  if (this->pimpl_->ctranIb) {
+  if (this->pimpl_->rankBackendMap[rank] == CtranMapperBackend::IB) {
     res = this->pimpl_->ctranIb->checkNotify(rank, notify);
+  } else if (this->pimpl_->rankBackendMap[rank] == CtranMapperBackend::SOCKET) {
+    res = this->pimpl_->ctranSock->checkNotify(rank, notify);
   }
+  this->pimpl_->waitingNotify[rank].store(
+      res == ncclSuccess && !*notify, std::memory_order_relaxed);
 
   return res;
 }
@@ -11,19 +11,32 @@
 #include <vector>
 #include <cstdint>
 #include "CtranIb.h"
+#include "CtranMapperStats.h"
+#include "CtranSocket.h"
 #include "checks.h"
 #include "nccl.h"
 
 struct CtranMapperRemoteAccessKey {
   struct CtranIbRemoteAccessKey ibKey;
+  struct CtranSocketRemoteAccessKey sockKey;
 };
 
 class CtranMapper;
 class CtranMapperRequest {
  public:
+  /* Kind of request, tracked as pending with the peer until completed */
+  enum Kind {
+    UNTRACKED,
+    SEND_CTRL,
+    RECV_CTRL,
+    PUT,
+    NUM_KINDS,
+  };
+
   CtranMapperRequest(CtranMapper* mapper) : mapper_(mapper){};
   CtranMapperRequest(CtranMapper* mapper, int peer)
       : peer(peer), mapper_(mapper){};
+  CtranMapperRequest(CtranMapper* mapper, int peer, Kind kind);
   ~CtranMapperRequest();
 
   /* test whether a request is completed or not */
@@ -32,16 +45,31 @@ class CtranMapperRequest {
   ncclResult_t wait();
 
   CtranIbRequest* ibReq{nullptr};
+  CtranSocketRequest* sockReq{nullptr};
   int peer{-1};
 
  private:
+  void untrack();
+
   CtranMapper* mapper_{nullptr};
+  Kind kind_{UNTRACKED};
   enum {
     INCOMPLETE,
     COMPLETE,
   } state_{INCOMPLETE};
 };
 
+/* Outstanding ctran operations with a peer, reported in communicator dumps
+ * to find what a hung collective is waiting for */
+struct CtranMapperPeerPending {
+  int peer{-1};
+  int sendCtrl{0};
+  int recvCtrl{0};
+  int put{0};
+  /* the last checkNotify with the peer found no notification */
+  bool waitNotify{false};
+};
+
 struct ncclComm;
 
 class CtranMapperTimestampPoint {
@@ -83,6 +111,12 @@ class CtranMapperTimer {
                end - this->start_)
         .count();
   }
+  uint64_t durationNs() {
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               end - this->start_)
+        .count();
+  }
 
  private:
   std::chrono::time_point<std::chrono::high_resolution_clock> start_;
@@ -245,6 +279,27 @@ class CtranMapper {
   void reportProfiling(bool flush = false);
   void reportRegSnapshot();
 
+  /* Get the latency statistics of a phase with a peer, collected with
+   * NCCL_CTRAN_PROFILING. Thread-safe.
+   * Input arguments:
+   *   - peer: the rank of the peer in the current communicator
+   *   - phase: the phase of the collectives
+   * Output arguments:
+   *   - stats: copy of the statistics
+   * Return false if no op with the peer was recorded in this phase.
+   */
+  bool getPeerLatencyStats(
+      int peer,
+      CtranMapperPhase phase,
+      CtranMapperLatencyStats& stats);
+
+  /* Get the peers with outstanding control messages, puts or notifications.
+   * Thread-safe, meant to be called while the communicator may be hung.
+   * Output arguments:
+   *   - pending: the outstanding operations of each such peer
+   */
+  void getPendingPeers(std::vector<CtranMapperPeerPending>& pending);
+
   /* Read the provided topology info file and bootstrap all-gather the
    * information with other ranks
    */
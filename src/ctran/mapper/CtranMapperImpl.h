@@ -3,9 +3,14 @@
 #ifndef CTRAN_MAPPER_IMPL_H_
 #define CTRAN_MAPPER_IMPL_H_
 
+#include <atomic>
+#include <string>
+#include <unordered_map>
 #include "CtranAvlTree.h"
 #include "CtranIb.h"
 #include "CtranMapper.h"
+#include "CtranSocket.h"
+#include "NcclMetrics.h"
 
 enum CtranMapperRegElemState {
   CACHED,
@@ -16,12 +21,14 @@ struct CtranMapperRegElem {
   const void* buf;
   std::size_t len;
   void* ibRegElem;
+  void* sockRegElem;
   enum CtranMapperRegElemState state;
 };
 
 enum CtranMapperBackend {
   UNSET,
   IB,
+  SOCKET,
 };
 
 class CtranMapper::impl {
@@ -32,11 +39,19 @@ class CtranMapper::impl {
   ncclResult_t regMem(struct CtranMapperRegElem* mapperRegElem);
   ncclResult_t deregMem(struct CtranMapperRegElem* mapperRegElem);
 
+  /* Record the latencies of a collective in peerStats and, with
+   * NCCL_METRICS_EXPORT, publish them to NcclMetrics. */
+  void recordTimestamp(
+      const CtranMapperTimestamp& ts,
+      int rank,
+      uint64_t commHash);
+
   std::unique_ptr<class CtranAvlTree> mapperRegElemList;
 
   std::vector<enum CtranMapperBackend> rankBackendMap;
   std::vector<enum CtranMapperBackend> backends;
   std::unique_ptr<class CtranIb> ctranIb;
+  std::unique_ptr<class CtranSocket> ctranSock;
 
   uint32_t numRegistrations; /* number of currently registered buffers */
   uint32_t numCachedRegistrations; /* number of currently cached but not yet registered buffers in lazy registration; buffer still pre-registered by user. */
@@ -46,6 +61,28 @@ class CtranMapper::impl {
   uint32_t totalNumRegLookupHit; /* total number of lookup calls to search buffer registration and found registered handle */
   uint32_t totalNumRegLookupMiss; /* total number of lookup calls to search buffer registration and could
                                    * not found registered handle (i.e., by either lazy registration or dynamic registration )*/
+
+  /* metrics of each algorithm, used only with NCCL_METRICS_EXPORT */
+  struct AlgoMetrics {
+    std::shared_ptr<NcclMetricHistogram> collLatencyNs;
+    std::shared_ptr<NcclMetricHistogram> putLatencyNs;
+  };
+  std::unordered_map<std::string, AlgoMetrics> algoMetrics;
+  /* number of timestamps already recorded by recordTimestamp */
+  size_t numRecordedTimestamps{0};
+
+  /* per-peer latency statistics, used only with NCCL_CTRAN_PROFILING */
+  std::unique_ptr<CtranMapperPeerStats> peerStats;
+  /* number of ops recorded since the last report of NCCL_CTRAN_PROFILING
+   * stats */
+  size_t numStatsOps{0};
+
+  /* outstanding requests of each CtranMapperRequest::Kind with each peer,
+   * indexed by peer * NUM_KINDS + kind */
+  std::unique_ptr<std::atomic<int>[]> pendingReqs;
+  /* whether the last checkNotify with each peer found no notification */
+  std::unique_ptr<std::atomic<bool>[]> waitingNotify;
+  int nRanks{0};
 };
 
 #endif
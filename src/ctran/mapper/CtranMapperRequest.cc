@@ -1,12 +1,36 @@
 // (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
 
 #include "CtranMapper.h"
+#include "CtranMapperImpl.h"
 #include "debug.h"
 
+CtranMapperRequest::CtranMapperRequest(
+    CtranMapper* mapper,
+    int peer,
+    Kind kind)
+    : peer(peer), mapper_(mapper), kind_(kind) {
+  if (this->kind_ != UNTRACKED) {
+    this->mapper_->pimpl_->pendingReqs[peer * NUM_KINDS + kind].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+}
+
+void CtranMapperRequest::untrack() {
+  if (this->kind_ != UNTRACKED) {
+    this->mapper_->pimpl_->pendingReqs[this->peer * NUM_KINDS + this->kind_]
+        .fetch_sub(1, std::memory_order_relaxed);
+    this->kind_ = UNTRACKED;
+  }
+}
+
 CtranMapperRequest::~CtranMapperRequest() {
+  this->untrack();
   if (this->ibReq != nullptr) {
     delete this->ibReq;
   }
+  if (this->sockReq != nullptr) {
+    delete this->sockReq;
+  }
 }
 
 ncclResult_t CtranMapperRequest::test(bool* isComplete) {
@@ -17,6 +41,8 @@ ncclResult_t CtranMapperRequest::test(bool* isComplete) {
   *isComplete = false;
   if (this->ibReq != nullptr) {
     *isComplete = this->ibReq->isComplete();
+  } else if (this->sockReq != nullptr) {
+    *isComplete = this->sockReq->isComplete();
   } else {
     auto cudaErr = cudaStreamQuery(this->mapper_->internalStream);
     if (cudaErr == cudaSuccess) {
@@ -32,6 +58,7 @@ ncclResult_t CtranMapperRequest::test(bool* isComplete) {
 
   if (*isComplete) {
     this->state_ = CtranMapperRequest::COMPLETE;
+    this->untrack();
   }
 
 exit:
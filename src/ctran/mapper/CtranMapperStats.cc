@@ -0,0 +1,167 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include "CtranMapperStats.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+#include "CtranMapper.h"
+
+const char* ctranMapperPhaseName(CtranMapperPhase phase) {
+  switch (phase) {
+    case RECV_CTRL:
+      return "recvCtrl";
+    case PUT_ISSUE:
+      return "putIssue";
+    case PUT_COMPLETE:
+      return "putComplete";
+    default:
+      return "unknown";
+  }
+}
+
+constexpr uint64_t CtranMapperLatencyStats::kMaxValue;
+
+void CtranMapperLatencyStats::record(uint64_t latencyNs) {
+  this->buckets_[Buckets::index(latencyNs)]++;
+  this->count++;
+  this->sum += latencyNs;
+  this->min = std::min(this->min, latencyNs);
+  this->max = std::max(this->max, latencyNs);
+}
+
+void CtranMapperLatencyStats::merge(const CtranMapperLatencyStats& other) {
+  for (size_t i = 0; i < Buckets::kNumBuckets; i++) {
+    this->buckets_[i] += other.buckets_[i];
+  }
+  this->count += other.count;
+  this->sum += other.sum;
+  this->min = std::min(this->min, other.min);
+  this->max = std::max(this->max, other.max);
+}
+
+uint64_t CtranMapperLatencyStats::quantile(double q) const {
+  return Buckets::quantile(
+      this->buckets_.data(), this->count, q, this->min, this->max);
+}
+
+void ctranMapperForEachPut(
+    const CtranMapperTimestamp& ts,
+    const std::function<void(int peer, uint64_t latencyNs)>& f) {
+  /* puts to a peer complete in the order they are issued */
+  std::unordered_map<int, std::vector<const CtranMapperTimestampPoint*>>
+      issued;
+  for (auto& tsp : ts.putIssued) {
+    issued[tsp.peer].push_back(&tsp);
+  }
+  std::unordered_map<int, size_t> nCompleted;
+  for (auto& tsp : ts.putComplete) {
+    auto& peerIssued = issued[tsp.peer];
+    size_t idx = nCompleted[tsp.peer]++;
+    if (idx < peerIssued.size()) {
+      f(tsp.peer,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            tsp.now - peerIssued[idx]->now)
+            .count());
+    }
+  }
+}
+
+static inline uint64_t sinceStartNs(
+    const CtranMapperTimestamp& ts,
+    const CtranMapperTimestampPoint& tsp) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             tsp.now - ts.start)
+      .count();
+}
+
+CtranMapperPeerStats::CtranMapperPeerStats(int nRanks) : peers_(nRanks) {}
+
+CtranMapperLatencyStats& CtranMapperPeerStats::getLocked(
+    int peer,
+    CtranMapperPhase phase) {
+  auto& peerStats = this->peers_[peer];
+  if (!peerStats) {
+    peerStats = std::unique_ptr<PhaseStats>(new PhaseStats());
+  }
+  return (*peerStats)[phase];
+}
+
+void CtranMapperPeerStats::record(const CtranMapperTimestamp& ts) {
+  const std::lock_guard<std::mutex> lock(this->mutex_);
+  int nRanks = this->peers_.size();
+  for (auto& tsp : ts.recvCtrl) {
+    if (tsp.peer >= 0 && tsp.peer < nRanks) {
+      this->getLocked(tsp.peer, RECV_CTRL).record(sinceStartNs(ts, tsp));
+    }
+  }
+  for (auto& tsp : ts.putIssued) {
+    if (tsp.peer >= 0 && tsp.peer < nRanks) {
+      this->getLocked(tsp.peer, PUT_ISSUE).record(sinceStartNs(ts, tsp));
+    }
+  }
+  ctranMapperForEachPut(ts, [&](int peer, uint64_t latencyNs) {
+    if (peer >= 0 && peer < nRanks) {
+      this->getLocked(peer, PUT_COMPLETE).record(latencyNs);
+    }
+  });
+}
+
+bool CtranMapperPeerStats::get(
+    int peer,
+    CtranMapperPhase phase,
+    CtranMapperLatencyStats& stats) {
+  const std::lock_guard<std::mutex> lock(this->mutex_);
+  if (peer < 0 || peer >= static_cast<int>(this->peers_.size()) ||
+      !this->peers_[peer] || (*this->peers_[peer])[phase].count == 0) {
+    return false;
+  }
+  stats = (*this->peers_[peer])[phase];
+  return true;
+}
+
+static inline double nsToUs(uint64_t ns) {
+  return ns / 1000.0;
+}
+
+std::string CtranMapperPeerStats::summary(int numStragglers) {
+  const std::lock_guard<std::mutex> lock(this->mutex_);
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(1);
+  for (int phase = 0; phase < NUM_PHASES; phase++) {
+    CtranMapperLatencyStats total;
+    std::vector<std::pair<uint64_t, int>> p99s;
+    for (int peer = 0; peer < static_cast<int>(this->peers_.size()); peer++) {
+      if (!this->peers_[peer]) {
+        continue;
+      }
+      auto& stats = (*this->peers_[peer])[phase];
+      if (stats.count > 0) {
+        total.merge(stats);
+        p99s.emplace_back(stats.quantile(0.99), peer);
+      }
+    }
+    if (total.count == 0) {
+      continue;
+    }
+
+    ss << "    " << ctranMapperPhaseName(static_cast<CtranMapperPhase>(phase))
+       << ": count " << total.count << " min " << nsToUs(total.min) << " p50 "
+       << nsToUs(total.quantile(0.5)) << " p99 "
+       << nsToUs(total.quantile(0.99)) << " max " << nsToUs(total.max)
+       << " us, slowest peers (p99 us):";
+    size_t n = std::min<size_t>(numStragglers, p99s.size());
+    std::partial_sort(
+        p99s.begin(),
+        p99s.begin() + n,
+        p99s.end(),
+        [](const std::pair<uint64_t, int>& a,
+           const std::pair<uint64_t, int>& b) { return a.first > b.first; });
+    for (size_t i = 0; i < n; i++) {
+      ss << " " << p99s[i].second << "=" << nsToUs(p99s[i].first);
+    }
+    ss << std::endl;
+  }
+  return ss.str();
+}
@@ -0,0 +1,86 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#ifndef CTRAN_MAPPER_STATS_H_
+#define CTRAN_MAPPER_STATS_H_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "NcclMetrics.h"
+
+class CtranMapperTimestamp;
+
+/* Phases of a ctran collective measured per peer */
+enum CtranMapperPhase {
+  /* from the start of the collective to the control msg from the peer */
+  RECV_CTRL,
+  /* from the start of the collective to the put to the peer being issued */
+  PUT_ISSUE,
+  /* from a put to the peer being issued to its completion */
+  PUT_COMPLETE,
+  NUM_PHASES,
+};
+
+const char* ctranMapperPhaseName(CtranMapperPhase phase);
+
+/* Call f with the latency of each completed put of a collective, matching
+ * the puts issued to and completed with each peer in order */
+void ctranMapperForEachPut(
+    const CtranMapperTimestamp& ts,
+    const std::function<void(int peer, uint64_t latencyNs)>& f);
+
+/* Streaming aggregates and log-linear histogram of latencies in nanoseconds,
+ * with the buckets of NcclMetricHistogram but 4 per power of two, so
+ * percentiles are known within 1/4 of their value at a fixed memory cost of
+ * about 0.5KB. Latencies above kMaxValue are counted in the last bucket (min,
+ * max and sum stay exact). Not thread-safe. */
+class CtranMapperLatencyStats {
+ public:
+  using Buckets = NcclMetricBuckets<2, 36>;
+  static constexpr uint64_t kMaxValue = Buckets::kMaxValue;
+
+  void record(uint64_t latencyNs);
+  void merge(const CtranMapperLatencyStats& other);
+  /* latency of the given quantile in [0, 1], 0 if empty */
+  uint64_t quantile(double q) const;
+
+  uint64_t count{0};
+  uint64_t sum{0};
+  uint64_t min{UINT64_MAX};
+  uint64_t max{0};
+
+ private:
+  std::array<uint32_t, Buckets::kNumBuckets> buckets_{};
+};
+
+/* Latency statistics of each phase for each peer of a communicator. Memory is
+ * allocated the first time a peer is seen and does not grow afterwards, so
+ * they can be collected for the whole lifetime of long jobs. Thread-safe. */
+class CtranMapperPeerStats {
+ public:
+  explicit CtranMapperPeerStats(int nRanks);
+
+  /* Record the latencies of each phase of a collective */
+  void record(const CtranMapperTimestamp& ts);
+
+  /* Return false if nothing was recorded with the peer in this phase */
+  bool get(int peer, CtranMapperPhase phase, CtranMapperLatencyStats& stats);
+
+  /* Summary of each phase across all peers, with the peers of highest p99
+   * latency, one line per phase */
+  std::string summary(int numStragglers);
+
+ private:
+  using PhaseStats = std::array<CtranMapperLatencyStats, NUM_PHASES>;
+
+  CtranMapperLatencyStats& getLocked(int peer, CtranMapperPhase phase);
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<PhaseStats>> peers_;
+};
+
+#endif
@@ -225,6 +225,76 @@ TEST_F(CtranMapperProfilerTest, MapperFlushTimerKineto) {
   NCCLCHECKABORT(ncclCommDestroy(dummyComm));
 }
 
+TEST_F(CtranMapperProfilerTest, LatencyStats) {
+  CtranMapperLatencyStats stats;
+  EXPECT_EQ(stats.quantile(0.5), 0);
+
+  for (uint64_t us = 1; us <= 1000; us++) {
+    stats.record(us * 1000);
+  }
+  EXPECT_EQ(stats.count, 1000);
+  EXPECT_EQ(stats.min, 1000);
+  EXPECT_EQ(stats.max, 1000000);
+  EXPECT_EQ(stats.sum, 1000UL * 1000 * 1001 / 2);
+  // Percentiles are known within 1/4 of their value
+  EXPECT_NEAR(stats.quantile(0.5), 500000, 500000 / 4);
+  EXPECT_NEAR(stats.quantile(0.99), 990000, 990000 / 4);
+  EXPECT_EQ(stats.quantile(1), stats.max);
+
+  // Latencies above the histogram range still update max
+  CtranMapperLatencyStats slow;
+  slow.record(CtranMapperLatencyStats::kMaxValue * 2);
+  stats.merge(slow);
+  EXPECT_EQ(stats.count, 1001);
+  EXPECT_EQ(stats.min, 1000);
+  EXPECT_EQ(stats.max, CtranMapperLatencyStats::kMaxValue * 2);
+  EXPECT_EQ(stats.quantile(1), stats.max);
+}
+
+TEST_F(CtranMapperProfilerTest, MapperPeerStats) {
+  setenv("NCCL_CTRAN_PROFILING", "stats", 1);
+  ncclCvarInit();
+  NCCLCHECKABORT(ncclCommInitAll(&dummyComm, 1, nullptr));
+
+  auto mapper = std::unique_ptr<CtranMapper>(new CtranMapper(dummyComm));
+  EXPECT_THAT(mapper, testing::NotNull());
+
+  constexpr int numOps = 10;
+  for (int i = 0; i < numOps; i++) {
+    auto ts = std::unique_ptr<CtranMapperTimestamp>(
+        new CtranMapperTimestamp("Ring"));
+    ts->recvCtrl.push_back(CtranMapperTimestampPoint(0));
+    ts->putIssued.push_back(CtranMapperTimestampPoint(0));
+    usleep(expectedDurMS * 1000);
+    ts->putComplete.push_back(CtranMapperTimestampPoint(0));
+    mapper->timestamps.push_back(std::move(ts));
+    mapper->reportProfiling();
+    // Only the statistics are kept
+    EXPECT_TRUE(mapper->timestamps.empty());
+  }
+
+  CtranMapperLatencyStats stats;
+  ASSERT_TRUE(mapper->getPeerLatencyStats(0, PUT_COMPLETE, stats));
+  EXPECT_EQ(stats.count, numOps);
+  EXPECT_GE(stats.min, expectedDurMS * 1000 * 1000);
+  EXPECT_TRUE(mapper->getPeerLatencyStats(0, RECV_CTRL, stats));
+  EXPECT_EQ(stats.count, numOps);
+  EXPECT_FALSE(mapper->getPeerLatencyStats(1, PUT_COMPLETE, stats));
+
+  testing::internal::CaptureStdout();
+
+  mapper->reportProfiling(true);
+
+  std::string output = testing::internal::GetCapturedStdout();
+  EXPECT_THAT(output, testing::HasSubstr("profiling stats"));
+  EXPECT_THAT(output, testing::HasSubstr("putComplete: count 10"));
+  EXPECT_THAT(output, testing::HasSubstr("slowest peers"));
+
+  mapper.reset();
+  NCCLCHECKABORT(ncclCommDestroy(dummyComm));
+  unsetenv("NCCL_CTRAN_PROFILING");
+}
+
 TEST_F(CtranMapperProfilerTest, regSnapshot) {
   setenv("NCCL_CTRAN_REGISTER_REPORT_SNAPSHOT_COUNT", "0", 1);
   ncclCvarInit();
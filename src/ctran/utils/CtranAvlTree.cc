@@ -24,15 +24,7 @@ void* CtranAvlTree::insert(const void* addr_, std::size_t len, void* val) {
     this->root_ = new CtranAvlTree::TreeElem(addr, len, val);
     hdl = this->root_;
   } else {
-    // Try to insert into AVL tree for fast search
     this->root_ = this->root_->insert(addr, len, val, &hdl);
-
-    // If fails to be handled by AVL tree, insert into list as fallback
-    if (hdl == nullptr) {
-      auto e = new CtranAvlTree::TreeElem(addr, len, val);
-      this->list_.push_back(e);
-      hdl = e;
-    }
   }
   return hdl;
 }
@@ -44,20 +36,10 @@ ncclResult_t CtranAvlTree::remove(void* hdl) {
     WARN("CTRAN-AVL-TREE: Trying to remove hdl %p while the AVL tree is NULL, likely double freeing", hdl);
     return ncclInvalidUsage;
   }
-  // First try to remove from AVL tree
   bool removed = false;
   this->root_ = this->root_->remove(e, &removed);
   if (removed) {
     delete e;
-  } else {
-    // Not found in AVL tree, thus try to remove from list
-    auto it = std::find(this->list_.begin(), this->list_.end(), e);
-    if (it != this->list_.end()) {
-      this->list_.erase(
-          std::remove(this->list_.begin(), this->list_.end(), e),
-          this->list_.end());
-      delete e;
-    }
   }
   return ncclSuccess;
 }
@@ -65,31 +47,10 @@ ncclResult_t CtranAvlTree::remove(void* hdl) {
 void* CtranAvlTree::search(const void* addr_, std::size_t len) {
   uintptr_t addr = reinterpret_cast<uintptr_t>(const_cast<void*>(addr_));
 
-  // First try to search in AVL tree
-  CtranAvlTree::TreeElem* r = this->root_;
-  while (r) {
-    if (r->addr > addr) {
-      r = r->left;
-      continue;
-    } else if (r->addr + r->len < addr + len) {
-      r = r->right;
-      continue;
-    } else {
-      // Found the matching node
-      break;
-    }
-  }
-
-  // If not found in AVL tree, search in list
-  if (!r) {
-    for (auto e : this->list_) {
-      if (e->addr <= addr && e->addr + e->len >= addr + len) {
-        r = e;
-        break;
-      }
-    }
+  if (this->root_ == nullptr) {
+    return nullptr;
   }
-  return r;
+  return this->root_->search(addr, len);
 }
 
 void* CtranAvlTree::lookup(void* hdl) {
@@ -118,10 +79,6 @@ std::vector<void*> CtranAvlTree::getAllElems() {
     }
   }
 
-  for (auto e : this->list_) {
-    ret.push_back(e->val);
-  }
-
   return ret;
 }
 
@@ -139,17 +96,6 @@ std::string CtranAvlTree::toString() {
     this->root_->treeToString(0, ss);
     ss << std::endl;
   }
-
-  ss << "Internal list:" << std::endl;
-  bool first = true;
-  for (auto e : this->list_) {
-    if (!first) {
-      ss << ",";
-    }
-    ss << this->rangeToString(reinterpret_cast<const void*>(e->addr), e->len);
-    first = false;
-  }
-  ss << std::endl;
   return ss.str();
 }
 
@@ -158,7 +104,6 @@ size_t CtranAvlTree::size() {
   if (this->root_) {
     size += this->root_->size();
   }
-  size += this->list_.size();
   return size;
 }
 
@@ -12,10 +12,11 @@
 /**
  * AVL tree.
  * It supports both non-overlapping address ranges and overlapping address
- * ranges. Since most of the usecase would be non-overlapping ranges, we
- * optimize it using an intenral AVL tree structure (TreeElem* root_) which
- * provides O(logN) insert, search, and remove complexity. For any overlapping
- * ranges, we maintain them using a list (std::vector<TreeElem*> list_).
+ * ranges (e.g., segments handed out by a caching allocator). Elements are
+ * kept in a single balanced tree ordered by start address and augmented with
+ * the maximum end address of each subtree (i.e., an interval tree), which
+ * provides O(logN) insert, search, and remove complexity regardless of how
+ * many ranges overlap.
  */
 class CtranAvlTree {
  public:
@@ -23,15 +24,15 @@ class CtranAvlTree {
   ~CtranAvlTree();
 
   // Insert a new element into the tree and return the corresponding handle.
-  // If the new element range overlaps with any existing element, insertion
-  // fails and nullptr is returned.
+  // The new element range may overlap with existing elements.
   void* insert(const void* addr, std::size_t len, void* val);
 
   // Remove an element from the tree by searching the provided handle.
   ncclResult_t remove(void* hdl);
 
-  // Search for an element in the tree, handle is returned if found; otherwise
-  // return nullptr.
+  // Search for an element whose range fully contains [addr, addr + len),
+  // handle is returned if found; otherwise return nullptr. If multiple
+  // elements contain the range, any one of them may be returned.
   void* search(const void* addr, std::size_t len);
 
   // Lookup the value of the provided handle.
@@ -58,8 +59,7 @@ class CtranAvlTree {
 
  private:
   class TreeElem;
-  class TreeElem* root_;
-  std::vector<TreeElem*> list_;
+  class TreeElem* root_{nullptr};
 };
 
 #endif
@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <algorithm>
 #include <deque>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -18,17 +19,20 @@ CtranAvlTree::TreeElem::~TreeElem(void) {
   }
 }
 
-void CtranAvlTree::TreeElem::updateHeight(void) {
+void CtranAvlTree::TreeElem::update(void) {
   uint32_t lHeight, rHeight;
 
+  this->maxEnd_ = this->addr + this->len;
   if (this->left) {
     lHeight = this->left->height_;
+    this->maxEnd_ = std::max(this->maxEnd_, this->left->maxEnd_);
   } else {
     lHeight = 0;
   }
 
   if (this->right) {
     rHeight = this->right->height_;
+    this->maxEnd_ = std::max(this->maxEnd_, this->right->maxEnd_);
   } else {
     rHeight = 0;
   }
@@ -36,6 +40,15 @@ void CtranAvlTree::TreeElem::updateHeight(void) {
   this->height_ = std::max(lHeight, rHeight) + 1;
 }
 
+bool CtranAvlTree::TreeElem::lessThan(const TreeElem* other) const {
+  // Order by start address; break ties of identical start addresses by the
+  // element itself so that overlapping ranges get a stable position.
+  if (this->addr != other->addr) {
+    return this->addr < other->addr;
+  }
+  return std::less<const TreeElem*>()(this, other);
+}
+
 void CtranAvlTree::TreeElem::treeToString(int indent, std::stringstream& ss) {
   if (indent && this->left == nullptr && this->right == nullptr) {
     return;
@@ -87,10 +100,10 @@ CtranAvlTree::TreeElem* CtranAvlTree::TreeElem::leftRotate(void) {
 
   CtranAvlTree::TreeElem* newroot = this->right;
   this->right = newroot->left;
-  this->updateHeight();
+  this->update();
 
   newroot->left = this;
-  newroot->updateHeight();
+  newroot->update();
 
   return newroot;
 }
@@ -102,10 +115,10 @@ CtranAvlTree::TreeElem* CtranAvlTree::TreeElem::rightRotate(void) {
 
   CtranAvlTree::TreeElem* newroot = this->left;
   this->left = newroot->right;
-  this->updateHeight();
+  this->update();
 
   newroot->right = this;
-  newroot->updateHeight();
+  newroot->update();
 
   return newroot;
 }
@@ -119,7 +132,9 @@ CtranAvlTree::TreeElem* CtranAvlTree::TreeElem::balance(void) {
     uint32_t leftRightHeight =
         this->left->right ? this->left->right->height_ : 0;
 
-    if (leftLeftHeight > leftRightHeight) {
+    // Single rotation also when both grandchildren are equally high, which
+    // can happen after a removal
+    if (leftLeftHeight >= leftRightHeight) {
       return this->rightRotate();
     } else {
       this->left = this->left->leftRotate();
@@ -131,7 +146,7 @@ CtranAvlTree::TreeElem* CtranAvlTree::TreeElem::balance(void) {
     uint32_t rightRightHeight =
         this->right->right ? this->right->right->height_ : 0;
 
-    if (rightRightHeight > rightLeftHeight) {
+    if (rightRightHeight >= rightLeftHeight) {
       return this->leftRotate();
     } else {
       this->right = this->right->rightRotate();
@@ -147,171 +162,124 @@ CtranAvlTree::TreeElem* CtranAvlTree::TreeElem::insert(
     std::size_t len,
     void* val,
     TreeElem** hdl) {
-  CtranAvlTree::TreeElem* newroot = this;
-  *hdl = nullptr;
+  *hdl = new CtranAvlTree::TreeElem(addr, len, val);
+  return this->insert(*hdl);
+}
 
-  // If we have overlapping buffers, return immediately with nullptr handle
-  if ((this->addr >= addr && this->addr < addr + len) ||
-      (this->addr <= addr && this->addr + this->len > addr)) {
-    return newroot;
+CtranAvlTree::TreeElem* CtranAvlTree::TreeElem::insert(
+    CtranAvlTree::TreeElem* e) {
+  if (e->lessThan(this)) {
+    // Insert into left side
+    this->left = this->left ? this->left->insert(e) : e;
+  } else {
+    // Insert into right side
+    this->right = this->right ? this->right->insert(e) : e;
   }
 
-  if (this->addr > addr) {
-    // Insert into left side and rebalance left subtree
-    if (this->left == nullptr) {
-      *hdl = new CtranAvlTree::TreeElem(addr, len, val);
-      this->left = *hdl;
-    } else {
-      this->left = this->left->insert(addr, len, val, hdl);
-    }
-    this->left->updateHeight();
-    this->updateHeight();
-    newroot = this->balance();
-  } else if (this->addr < addr) {
-    // Insert into right side and rebalance right subtree
-    if (this->right == nullptr) {
-      *hdl = new CtranAvlTree::TreeElem(addr, len, val);
-      this->right = *hdl;
-    } else {
-      this->right = this->right->insert(addr, len, val, hdl);
-    }
-    this->right->updateHeight();
-    this->updateHeight();
-    newroot = this->balance();
+  // Update height and max end on the way back up, then rebalance
+  this->update();
+  return this->balance();
+}
+
+CtranAvlTree::TreeElem* CtranAvlTree::TreeElem::removeMin(
+    CtranAvlTree::TreeElem** min) {
+  if (this->left == nullptr) {
+    // This is the smallest node; its right subtree takes over its position
+    CtranAvlTree::TreeElem* newroot = this->right;
+    this->right = nullptr;
+    *min = this;
+    return newroot;
   }
 
-  return newroot;
+  this->left = this->left->removeMin(min);
+  this->update();
+  return this->balance();
 }
 
 CtranAvlTree::TreeElem* CtranAvlTree::TreeElem::removeSelf(void) {
   CtranAvlTree::TreeElem* newroot;
-  std::deque<CtranAvlTree::TreeElem*> updateElems;
 
-  if (this->left == nullptr && this->right == nullptr) {
-    newroot = nullptr;
-  } else if (this->left == nullptr) {
+  if (this->left == nullptr) {
     newroot = this->right;
   } else if (this->right == nullptr) {
     newroot = this->left;
-  } else if (this->left->height_ >= this->right->height_) {
-    // Left subtree is higher, find the largest node from the left as the new
-    // root
-
-    if (!this->left->right) {
-      // - Left subtree doesn't have a right subtree, thus it is the largest
-      this->left->right = this->right;
-      newroot = this->left;
-    } else {
-      // - Find the right-most node which is the largest
-      CtranAvlTree::TreeElem* tmp = this->left->right;
-      CtranAvlTree::TreeElem* prev = this->left;
-      updateElems.push_back(prev);
-      while (tmp->right) {
-        prev = tmp;
-        tmp = tmp->right;
-        updateElems.push_back(prev);
-      }
-      newroot = tmp;
-      prev->right = tmp->removeSelf();
-      newroot->left = this->left;
-      newroot->right = this->right;
-    }
   } else {
-    // Right subtree is higher, find the smallest node from the right subtree as
-    // the new root
-
-    if (!this->right->left) {
-      // - Right subtree doesn't have a left subtree, thus it is the smallest
-      this->right->left = this->left;
-      newroot = this->right;
-    } else {
-      // - Find the left-most node which is the smallest
-      CtranAvlTree::TreeElem* tmp = this->right->left;
-      CtranAvlTree::TreeElem* prev = this->right;
-      updateElems.push_back(prev);
-      while (tmp->left) {
-        prev = tmp;
-        tmp = tmp->left;
-        updateElems.push_back(prev);
-      }
-      newroot = tmp;
-      prev->left = tmp->removeSelf();
-      newroot->left = this->left;
-      newroot->right = this->right;
-    }
+    // Replace this node by the smallest node of the right subtree
+    CtranAvlTree::TreeElem* min = nullptr;
+    CtranAvlTree::TreeElem* right = this->right->removeMin(&min);
+    min->left = this->left;
+    min->right = right;
+    min->update();
+    newroot = min->balance();
   }
 
   // this node can be dislinked now
   this->left = nullptr;
   this->right = nullptr;
 
-  // Update height for the updated path from bottom to top
-  while (!updateElems.empty()) {
-    auto temp = updateElems.back();
-    updateElems.pop_back();
-    temp->updateHeight();
-  }
-
-  // Last update newroot
-  if (newroot) {
-    newroot->updateHeight();
-  }
-
   return newroot;
 }
 
 CtranAvlTree::TreeElem* CtranAvlTree::TreeElem::remove(
     CtranAvlTree::TreeElem* e,
     bool* removed) {
-  std::deque<CtranAvlTree::TreeElem*> updateElems;
-  CtranAvlTree::TreeElem* newroot = this;
-  bool removed_ = false;
+  *removed = false;
 
   if (this == e) {
-    // Remove root
-    newroot = this->removeSelf();
-    removed_ = true;
-  } else {
-    // Depth-first search a node from subtree and remove;
-    // exit if removed, or not found but have traversed to bottom
-    CtranAvlTree::TreeElem* temp = this;
-    while (temp && !removed_) {
-      // Found a matching node, remove it
-      if (temp->left == e) {
-        updateElems.push_back(temp);
-        temp->left = temp->left->removeSelf();
-        removed_ = true;
-      } else if (temp->right == e) {
-        updateElems.push_back(temp);
-        temp->right = temp->right->removeSelf();
-        removed_ = true;
-      }
-      // Not found, search the child subtree
-      else if (temp->addr < e->addr) {
-        updateElems.push_back(temp);
-        temp = temp->right;
-      } else {
-        updateElems.push_back(temp);
-        temp = temp->left;
-      }
+    *removed = true;
+    return this->removeSelf();
+  }
+
+  // Search the subtree that must hold e according to the ordering
+  if (e->lessThan(this)) {
+    if (this->left) {
+      this->left = this->left->remove(e, removed);
     }
+  } else if (this->right) {
+    this->right = this->right->remove(e, removed);
   }
 
-  if (removed_) {
-    // Update height for the updated path from bottom to top
-    while (!updateElems.empty()) {
-      auto temp = updateElems.back();
-      updateElems.pop_back();
-      temp->updateHeight();
+  // Only the path from the removed node to the root needs to be updated and
+  // rebalanced
+  if (*removed) {
+    this->update();
+    return this->balance();
+  }
+  return this;
+}
+
+CtranAvlTree::TreeElem* CtranAvlTree::TreeElem::search(
+    uintptr_t addr,
+    std::size_t len) {
+  const uintptr_t end = addr + len;
+  CtranAvlTree::TreeElem* r = this;
+
+  while (r) {
+    if (r->addr > addr) {
+      // r and its right subtree start after addr, cannot contain the range
+      r = r->left;
+      continue;
     }
+
+    // r and its whole left subtree start at or before addr; any of them
+    // ending at or after end contains the range
+    if (r->addr + r->len >= end) {
+      return r;
+    }
+    if (r->left && r->left->maxEnd_ >= end) {
+      // A match exists in the left subtree; maxEnd guides us directly to it
+      CtranAvlTree::TreeElem* t = r->left;
+      while (t) {
+        if (t->addr + t->len >= end) {
+          return t;
+        }
+        t = (t->left && t->left->maxEnd_ >= end) ? t->left : t->right;
+      }
+    }
+    r = r->right;
   }
 
-  // FIXEME: Tree may be unbalanced after removal, we need rebalance it
-  // But we don't have a good way to do it unless balance all recursively
-  // which can be expensive. Skip it for now to avoid heavy removal
-  // overhead
-  *removed = removed_;
-  return newroot;
+  return nullptr;
 }
 
 size_t CtranAvlTree::TreeElem::size() {
@@ -370,7 +338,7 @@ bool CtranAvlTree::TreeElem::validateHeight() {
   bool correct = true;
   std::deque<CtranAvlTree::TreeElem*> pendingElems;
 
-  // validate height correctness of every node with two children via breadth
+  // validate height and max end correctness of every node via breadth
   // first traversal from top
   pendingElems.push_back(this);
   while (!pendingElems.empty()) {
@@ -378,16 +346,20 @@ bool CtranAvlTree::TreeElem::validateHeight() {
     pendingElems.pop_front();
 
     int lHeight = 0, rHeight = 0;
+    uintptr_t maxEnd = temp->addr + temp->len;
     if (temp->left) {
       pendingElems.push_back(temp->left);
       lHeight = temp->left->height_;
+      maxEnd = std::max(maxEnd, temp->left->maxEnd_);
     }
     if (temp->right) {
       pendingElems.push_back(temp->right);
       rHeight = temp->right->height_;
+      maxEnd = std::max(maxEnd, temp->right->maxEnd_);
     }
 
     correct &= (temp->height_ == std::max(lHeight, rHeight) + 1);
+    correct &= (temp->maxEnd_ == maxEnd);
     if (!correct) {
       break;
     }
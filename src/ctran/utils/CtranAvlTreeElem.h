@@ -9,20 +9,19 @@
 
 /**
  * AVL tree internal implementation.
- * Restriction: It supports only non-overlapping address ranges; otherwise
- * return nullptr handle at insertion.
+ * Elements are ordered by start address (ties broken by element address), so
+ * overlapping ranges can coexist in the tree. Each element additionally keeps
+ * the maximum end address of its subtree, which turns the tree into an
+ * interval tree and lets containment queries skip subtrees that cannot match.
  */
 class CtranAvlTree::TreeElem {
  public:
   TreeElem(uintptr_t addr, std::size_t len, void* val)
-      : addr(addr), len(len), val(val){};
+      : addr(addr), len(len), val(val), maxEnd_(addr + len){};
   ~TreeElem(void);
 
-  // Insert a new element into the tree and rebalance internally.
-  // If the new element range overlaps with any existing element, no insertion
-  // would happen and hdl is set to nullptr. After a successful insertion, it
-  // triggers internal rebalance to keep the tree balanced and then returns
-  // the new root and the handle of the inserted element.
+  // Insert a new element into the tree and rebalance internally. Returns the
+  // new root and the handle of the inserted element.
   TreeElem* insert(uintptr_t addr, std::size_t len, void* val, TreeElem** hdl);
 
   // Remove the element from the tree.
@@ -31,6 +30,10 @@ class CtranAvlTree::TreeElem {
   // balanced and return the new root.
   TreeElem* remove(TreeElem* e, bool* removed);
 
+  // Search an element whose range fully contains [addr, addr + len) in the
+  // subtree under this element. Return nullptr if no such element exists.
+  TreeElem* search(uintptr_t addr, std::size_t len);
+
   // Append all elements in the subtree under this element from the given indent
   // into a string
   void treeToString(int indent, std::stringstream& ss);
@@ -42,7 +45,8 @@ class CtranAvlTree::TreeElem {
   // right sub trees is <= 1)
   bool isBalanced();
 
-  // Validate if all elements in the tree is with the correct height
+  // Validate if all elements in the tree is with the correct height and
+  // subtree max end address
   bool validateHeight();
 
   uintptr_t addr{0};
@@ -52,13 +56,18 @@ class CtranAvlTree::TreeElem {
   TreeElem* right{nullptr};
 
  private:
+  bool lessThan(const TreeElem* other) const;
+  TreeElem* insert(TreeElem* e);
+  TreeElem* removeMin(TreeElem** min);
   TreeElem* leftRotate(void);
   TreeElem* rightRotate(void);
   TreeElem* balance(void);
   TreeElem* removeSelf(void);
-  void updateHeight(void);
+  // Recompute height and subtree max end address from the children
+  void update(void);
 
   uint32_t height_{1};
+  uintptr_t maxEnd_{0};
 };
 
 #endif
@@ -0,0 +1,186 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// Microbenchmark of registration lookup in CtranAvlTree, which sits on the
+// critical path of every ctran collective via CtranMapper::searchRegHandle.
+// It compares the interval tree against the previous layout, where only
+// non-overlapping ranges were kept in the balanced tree and every overlapping
+// range went to a linearly scanned fallback list.
+//
+// Usage: AvlTreeBench [overlapPercent] [numSearches]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+#include "CtranAvlTree.h"
+
+#define MAX_BUF_LEN (1024)
+
+struct Range {
+  uintptr_t addr;
+  size_t len;
+};
+
+// Reference implementation of the previous lookup structure: a search tree
+// for non-overlapping ranges plus a fallback list for overlapping ones.
+class LegacyRegCache {
+ public:
+  void insert(uintptr_t addr, size_t len) {
+    auto it = tree_.upper_bound(addr);
+    bool overlap = false;
+    if (it != tree_.end() && it->first < addr + len) {
+      overlap = true;
+    }
+    if (it != tree_.begin()) {
+      auto prev = std::prev(it);
+      if (prev->first + prev->second > addr) {
+        overlap = true;
+      }
+    }
+    if (overlap) {
+      list_.push_back({addr, len});
+    } else {
+      tree_[addr] = len;
+    }
+  }
+
+  bool search(uintptr_t addr, size_t len) {
+    auto it = tree_.upper_bound(addr);
+    if (it != tree_.begin()) {
+      auto prev = std::prev(it);
+      if (prev->first + prev->second >= addr + len) {
+        return true;
+      }
+    }
+    for (auto& r : list_) {
+      if (r.addr <= addr && r.addr + r.len >= addr + len) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  std::map<uintptr_t, size_t> tree_;
+  std::vector<Range> list_;
+};
+
+static std::vector<Range>
+genRanges(size_t numBufs, int overlapPercent, std::mt19937_64& gen) {
+  std::vector<Range> ranges;
+  ranges.reserve(numBufs);
+
+  // Non-overlapping ranges are laid out in disjoint slots in random order;
+  // overlapping ranges start inside a previously generated range.
+  std::vector<uintptr_t> slots(numBufs);
+  for (size_t i = 0; i < numBufs; i++) {
+    slots[i] = 0x7f0000000000UL + i * 2 * MAX_BUF_LEN;
+  }
+  std::shuffle(slots.begin(), slots.end(), gen);
+
+  for (size_t i = 0; i < numBufs; i++) {
+    Range r;
+    if (i > 0 && static_cast<int>(gen() % 100) < overlapPercent) {
+      const Range& base = ranges[gen() % i];
+      r.addr = base.addr + gen() % (MAX_BUF_LEN / 2);
+    } else {
+      r.addr = slots[i];
+    }
+    r.len = 1 + gen() % MAX_BUF_LEN;
+    ranges.push_back(r);
+  }
+  return ranges;
+}
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char** argv) {
+  int overlapPercent = argc > 1 ? atoi(argv[1]) : 10;
+  size_t numSearches = argc > 2 ? strtoul(argv[2], nullptr, 10) : 10000;
+  std::mt19937_64 gen(0);
+
+  printf(
+      "%10s %8s %16s %16s %16s %16s\n",
+      "numBufs",
+      "overlap%",
+      "insert(ns/op)",
+      "search(ns/op)",
+      "legacyIns(ns/op)",
+      "legacySrch(ns/op)");
+
+  for (size_t numBufs : {10000UL, 100000UL, 1000000UL}) {
+    auto ranges = genRanges(numBufs, overlapPercent, gen);
+
+    // Queries are sub-ranges of random registrations, as issued by
+    // collectives on buffers carved out of registered segments
+    std::vector<Range> queries(numSearches);
+    for (auto& q : queries) {
+      const Range& r = ranges[gen() % numBufs];
+      size_t offset = gen() % r.len;
+      q.addr = r.addr + offset;
+      q.len = 1 + gen() % (r.len - offset);
+    }
+
+    CtranAvlTree tree;
+    std::vector<void*> hdls;
+    hdls.reserve(numBufs);
+    auto start = std::chrono::steady_clock::now();
+    for (auto& r : ranges) {
+      hdls.push_back(tree.insert(reinterpret_cast<void*>(r.addr), r.len, &r));
+    }
+    double insertNs = elapsedNs(start) / numBufs;
+
+    size_t misses = 0;
+    start = std::chrono::steady_clock::now();
+    for (auto& q : queries) {
+      misses += tree.search(reinterpret_cast<void*>(q.addr), q.len) == nullptr;
+    }
+    double searchNs = elapsedNs(start) / numSearches;
+
+    LegacyRegCache legacy;
+    start = std::chrono::steady_clock::now();
+    for (auto& r : ranges) {
+      legacy.insert(r.addr, r.len);
+    }
+    double legacyInsertNs = elapsedNs(start) / numBufs;
+
+    size_t legacyMisses = 0;
+    start = std::chrono::steady_clock::now();
+    for (auto& q : queries) {
+      legacyMisses += !legacy.search(q.addr, q.len);
+    }
+    double legacySearchNs = elapsedNs(start) / numSearches;
+
+    if (misses || legacyMisses) {
+      fprintf(
+          stderr,
+          "Unexpected search misses: tree %lu legacy %lu\n",
+          misses,
+          legacyMisses);
+      return EXIT_FAILURE;
+    }
+
+    printf(
+        "%10lu %8d %16.1f %16.1f %16.1f %16.1f\n",
+        numBufs,
+        overlapPercent,
+        insertNs,
+        searchNs,
+        legacyInsertNs,
+        legacySearchNs);
+
+    for (auto hdl : hdls) {
+      tree.remove(hdl);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
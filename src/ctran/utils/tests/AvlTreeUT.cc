@@ -187,9 +187,7 @@ TEST_F(CtranUtilsAvlTreeTest, MixedRangeInsertRemoveFromHead) {
 
     ASSERT_EQ(tree->size(), --remaining);
     ASSERT_EQ(tree->validateHeight(), true);
-
-    // FIXME: it is known issue that the tree may be imbalanced after removal
-    // ASSERT_EQ(tree->isBalanced(), true);
+    ASSERT_EQ(tree->isBalanced(), true);
   }
 }
 
@@ -226,9 +224,7 @@ TEST_F(CtranUtilsAvlTreeTest, MixedRangeInsertRemoveFromEnd) {
 
     ASSERT_EQ(tree->size(), --remaining);
     ASSERT_EQ(tree->validateHeight(), true);
-
-    // FIXME: it is known issue that the tree may be imbalanced after removal
-    // ASSERT_EQ(tree->isBalanced(), true);
+    ASSERT_EQ(tree->isBalanced(), true);
   }
 }
 
@@ -277,6 +273,89 @@ TEST_F(CtranUtilsAvlTreeTest, SearchNonOverlapRanges) {
   rangeRegistList.clear();
 }
 
+// Test overlapping ranges, e.g., segments handed out by a caching allocator.
+// Search must return an element that contains the queried range whenever one
+// exists.
+TEST_F(CtranUtilsAvlTreeTest, SearchOverlapRanges) {
+  auto tree = std::make_unique<CtranAvlTree>();
+
+  // Generate random ranges
+  const int maxNumBufs = 2000, numOverlaps = 1000;
+  int numOverlapsHint = numOverlaps;
+  this->genBufRanges(maxNumBufs, &numOverlapsHint);
+
+  // Insert all ranges
+  std::vector<RangeRegistration> rangeRegistList;
+  for (int i = 0; i < maxNumBufs; i++) {
+    auto rangeRegist = RangeRegistration(
+        this->bufRanges[i], reinterpret_cast<void*>(static_cast<uintptr_t>(i)));
+
+    rangeRegist.hdl = tree->insert(
+        reinterpret_cast<void*>(rangeRegist.addr),
+        rangeRegist.len,
+        rangeRegist.val);
+    ASSERT_NE(rangeRegist.hdl, nullptr);
+
+    rangeRegistList.push_back(rangeRegist);
+  }
+  ASSERT_EQ(tree->size(), maxNumBufs);
+  ASSERT_EQ(tree->validateHeight(), true);
+  ASSERT_EQ(tree->isBalanced(), true);
+
+  // Search random sub-ranges of registered ranges and compare with a linear
+  // scan over all registrations
+  const int searchIter = 20000;
+  for (int i = 0; i < searchIter; i++) {
+    int idx = rand() % maxNumBufs;
+    uintptr_t addr = reinterpret_cast<uintptr_t>(rangeRegistList[idx].addr);
+    size_t len = rangeRegistList[idx].len;
+    size_t offset = len ? rand() % len : 0;
+    // Extend some queries beyond the registered range to also cover misses
+    size_t qlen = rand() % (len - offset + MAX_BUF_LEN / 4 + 1);
+    uintptr_t qaddr = addr + offset;
+
+    bool expectFound = false;
+    for (auto& r : rangeRegistList) {
+      uintptr_t raddr = reinterpret_cast<uintptr_t>(r.addr);
+      if (raddr <= qaddr && raddr + r.len >= qaddr + qlen) {
+        expectFound = true;
+        break;
+      }
+    }
+
+    void* hdl = tree->search(reinterpret_cast<void*>(qaddr), qlen);
+    if (!expectFound) {
+      ASSERT_EQ(hdl, nullptr);
+      continue;
+    }
+    ASSERT_NE(hdl, nullptr);
+    int foundIdx = static_cast<int>(
+        reinterpret_cast<uintptr_t>(tree->lookup(hdl)));
+    uintptr_t faddr =
+        reinterpret_cast<uintptr_t>(rangeRegistList[foundIdx].addr);
+    ASSERT_EQ(rangeRegistList[foundIdx].hdl, hdl);
+    ASSERT_LE(faddr, qaddr);
+    ASSERT_GE(faddr + rangeRegistList[foundIdx].len, qaddr + qlen);
+  }
+
+  // Remove every other range and check the remaining ones are still found
+  for (int i = 0; i < rangeRegistList.size(); i += 2) {
+    tree->remove(rangeRegistList[i].hdl);
+  }
+  ASSERT_EQ(tree->validateHeight(), true);
+  ASSERT_EQ(tree->isBalanced(), true);
+  for (int i = 1; i < rangeRegistList.size(); i += 2) {
+    void* hdl =
+        tree->search(rangeRegistList[i].addr, rangeRegistList[i].len);
+    ASSERT_NE(hdl, nullptr);
+  }
+
+  for (int i = 1; i < rangeRegistList.size(); i += 2) {
+    tree->remove(rangeRegistList[i].hdl);
+  }
+  ASSERT_EQ(tree->size(), 0);
+}
+
 // Test ToString
 TEST_F(CtranUtilsAvlTreeTest, ToString) {
   auto tree = std::make_unique<CtranAvlTree>();
@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <sys/syscall.h>
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
@@ -189,6 +190,46 @@ void ncclDebugInit() {
   pthread_mutex_unlock(&ncclDebugLock);
 }
 
+/* Format the current time as getTime() does into buffer, which must hold at
+ * least 32 bytes. The date and seconds are only formatted again when the
+ * second changes.
+ */
+static size_t formatTime(char* buffer) {
+  static __thread time_t cachedSec = -1;
+  static __thread char cachedStr[32];
+  static __thread size_t cachedLen = 0;
+  auto now = std::chrono::system_clock::now();
+  time_t sec = std::chrono::system_clock::to_time_t(now);
+  long us = std::chrono::duration_cast<std::chrono::microseconds>(
+                now.time_since_epoch()).count() % 1000000;
+  if (sec != cachedSec) {
+    struct tm tm;
+    localtime_r(&sec, &tm);
+    cachedLen = strftime(cachedStr, sizeof(cachedStr), "%FT%T.", &tm);
+    cachedSec = sec;
+  }
+  memcpy(buffer, cachedStr, cachedLen);
+  for (int i = 5; i >= 0; i--, us /= 10) buffer[cachedLen + i] = '0' + us % 10;
+  return cachedLen + 6;
+}
+
+/* Header of INFO messages after the time, which only changes with the device
+ * of the thread.
+ */
+static size_t formatInfoHeader(char* buffer, size_t size, int cudaDev) {
+  static __thread char cachedStr[1100];
+  static __thread size_t cachedLen = 0;
+  static __thread int cachedDev = INT_MIN;
+  if (cudaDev != cachedDev) {
+    int len = snprintf(cachedStr, sizeof(cachedStr), " %s:%d:%d [%d] NCCL INFO ", hostname, pid, tid, cudaDev);
+    cachedLen = std::min<size_t>(len, sizeof(cachedStr)-1);
+    cachedDev = cudaDev;
+  }
+  size_t len = std::min(cachedLen, size);
+  memcpy(buffer, cachedStr, len);
+  return len;
+}
+
 /* Common logging function used by the INFO, WARN and TRACE macros
  * Also exported to the dynamically loadable Net transport modules so
  * they can share the debugging mechanisms and output files
@@ -223,7 +264,8 @@ void ncclDebugLog(ncclDebugLogLevel level, unsigned long flags, const char *file
     len = snprintf(buffer, sizeof(buffer), "\n%s %s:%d:%d [%d] %s:%d NCCL WARN ",
                    getTime().c_str(), hostname, pid, tid, cudaDev, filefunc, line);
   } else if (level == NCCL_LOG_INFO) {
-    len = snprintf(buffer, sizeof(buffer), "%s %s:%d:%d [%d] NCCL INFO ", getTime().c_str(), hostname, pid, tid, cudaDev);
+    len = formatTime(buffer);
+    len += formatInfoHeader(buffer+len, sizeof(buffer)-len, cudaDev);
   } else if (level == NCCL_LOG_TRACE && flags == NCCL_CALL) {
     len = snprintf(buffer, sizeof(buffer), "%s %s:%d:%d NCCL CALL ", getTime().c_str(), hostname, pid, tid);
   } else if (level == NCCL_LOG_TRACE) {
@@ -238,9 +280,11 @@ void ncclDebugLog(ncclDebugLogLevel level, unsigned long flags, const char *file
     va_start(vargs, fmt);
     len += vsnprintf(buffer+len, sizeof(buffer)-len, fmt, vargs);
     va_end(vargs);
+    // Truncated messages still end with a new line
+    len = std::min(len, sizeof(buffer)-1);
     buffer[len++] = '\n';
 
-    NcclLogger::log(std::string(buffer, len), ncclDebugFile);
+    NcclLogger::log(buffer, len, ncclDebugFile);
 
     // also print to stderr if we're logging into file
     if (ncclDebugFile != stdout && ncclDebugFile != stderr &&
@@ -748,6 +748,7 @@ ncclResult_t ncclTopoTrimSystem(struct ncclTopoSystem* system, struct ncclComm*
 }
 
 void ncclTopoFree(struct ncclTopoSystem* system) {
+  ncclTopoSearchCacheRelease(system);
   for (int t=0; t<NCCL_TOPO_NODE_TYPES; t++) ncclTopoRemovePathType(system, t);
   free(system);
 }
@@ -47,6 +47,34 @@
    description : |-
      Hidden variable. No description provided.
 
+ - name        : NCCL_TOPO_SEARCH_THREADS
+   type        : int64_t
+   default     : 1
+   description : |-
+     Number of threads searching the settings of the topology search
+     in parallel. With more than one thread, the global search budget
+     grows with the number of threads, which can find better graphs on
+     complex topologies in the same time.
+
+ - name        : NCCL_TOPO_SEARCH_CACHE
+   type        : int64_t
+   default     : 1
+   description : |-
+     Reuse the graphs computed by the topology search for communicators
+     created on the same system, e.g. by ncclCommSplit. The cache is
+     keyed by a fingerprint of the nodes, links and paths of the system
+     and of the search parameters of each graph.
+         0: always run the search
+         1: cache the graphs in the process
+
+ - name        : NCCL_TOPO_SEARCH_CACHE_DIR
+   type        : string
+   default     : ""
+   description : |-
+     Directory where the graphs computed by the topology search are
+     saved, one XML graph file per fingerprint, so that they can be
+     reused when the job restarts. Requires NCCL_TOPO_SEARCH_CACHE=1.
+
 === END_NCCL_CVAR_INFO_BLOCK ===
 */
 
@@ -310,6 +338,10 @@ ncclResult_t ncclTopoSearchRec(struct ncclTopoSystem* system, struct ncclTopoGra
 #define NCCL_SEARCH_TIMEOUT_TREE (1<<14)
 #define NCCL_SEARCH_TIMEOUT_SAMECHANNELS (1<<8)
 
+// Set by parallel search threads to stop searching for settings which are no
+// longer needed
+static __thread uint32_t* searchAbort = NULL;
+
 #define FORCED_ORDER_PCI 1
 #define FORCED_ORDER_REPLAY 2
 
@@ -449,6 +481,10 @@ ncclResult_t ncclTopoSelectNets(struct ncclTopoSystem* system, int typeInter, in
 
 ncclResult_t ncclTopoSearchRecGpu(struct ncclTopoSystem* system, struct ncclTopoGraph* graph, struct ncclTopoGraph* saveGraph, struct ncclTopoNode* gpu, int step, int backToNet, int backToFirstRank, int forcedOrder, int *time) {
   if ((*time) <= 0) return ncclSuccess;
+  if (searchAbort && __atomic_load_n(searchAbort, __ATOMIC_RELAXED)) {
+    *time = 0;
+    return ncclSuccess;
+  }
   (*time)--;
 
   int ngpus = system->nodes[GPU].count;
@@ -834,7 +870,337 @@ float sm90SpeedArrayInter[] = { 48.0, 45.0, 42.0, 40.0, 30.0, 24.0, 20.0, 17.5,
 #define NSPEEDSINTRA_SM90 (sizeof(sm90SpeedArrayIntra)/sizeof(float))
 #define NSPEEDSINTER_SM90 (sizeof(sm90SpeedArrayInter)/sizeof(float))
 
-ncclResult_t ncclTopoCompute(ncclTopoSystem* system, struct ncclTopoGraph* graph) {
+static int ncclTopoSearchTimeout(struct ncclTopoGraph* tmpGraph) {
+  return tmpGraph->sameChannels ? NCCL_SEARCH_TIMEOUT_SAMECHANNELS :
+    tmpGraph->pattern == NCCL_TOPO_PATTERN_TREE ? NCCL_SEARCH_TIMEOUT_TREE : NCCL_SEARCH_TIMEOUT;
+}
+
+struct ncclTopoSearchCtx {
+  struct ncclTopoSystem* system;
+  int ngpus;
+  int ccMin;
+  int crossNic;
+  int trySameChannels;
+  float* speedArray;
+  int nspeeds;
+  float maxBw;
+  int64_t globalTimeout;
+};
+
+// Move tmpGraph to the next settings to search after a search which did not
+// find the optimal solution : first try crossnic, then decrease bw. graph is
+// the best solution so far. Returns 0 when there is nothing left to try.
+static int ncclTopoSearchNextSettings(struct ncclTopoSearchCtx* ctx, struct ncclTopoGraph* tmpGraph, struct ncclTopoGraph* graph, int* speedIndex, int time, int64_t* globalTimeout) {
+  struct ncclTopoSystem* system = ctx->system;
+
+  // Try having different channels
+  if (tmpGraph->sameChannels == 1) {
+    tmpGraph->sameChannels = 0;
+    return 1;
+  }
+  tmpGraph->sameChannels = ctx->trySameChannels;
+
+  if (time != -1) *globalTimeout += time;
+  else *globalTimeout = ctx->globalTimeout;
+  if (*globalTimeout < 0 && graph->nChannels) return 0;
+
+  // Try a simpler tree
+  if (ctx->ccMin >= 90 && tmpGraph->pattern == NCCL_TOPO_PATTERN_BALANCED_TREE) {
+    tmpGraph->pattern = NCCL_TOPO_PATTERN_TREE;
+    return 1;
+  }
+  tmpGraph->pattern = graph->pattern;
+
+  int maxTypeIntra = system->nodes[NET].count > 0 ? tmpGraph->typeInter : PATH_SYS;
+  if (tmpGraph->typeIntra < maxTypeIntra && (graph->nChannels == 0 || tmpGraph->typeIntra < graph->typeIntra)) {
+    tmpGraph->typeIntra += 1;
+    return 1;
+  }
+  tmpGraph->typeIntra = ctx->ngpus == 1 ? PATH_LOC : PATH_NVL;
+
+  if (system->nodes[NET].count > 0 && tmpGraph->typeInter < PATH_SYS && (graph->nChannels == 0 || tmpGraph->typeInter < graph->typeInter || tmpGraph->typeInter < PATH_PXN)) {
+    tmpGraph->typeInter += 1;
+    return 1;
+  }
+  tmpGraph->typeInter = PATH_PIX;
+
+  if (ctx->crossNic && tmpGraph->crossNic == 0) {
+    // Try again with crossNic if permitted
+    tmpGraph->crossNic = ctx->crossNic;
+    return 1;
+  }
+  tmpGraph->crossNic = 0;
+
+  // Decrease bw until we find a solution
+  if ((*speedIndex < ctx->nspeeds-1) && (graph->nChannels == 0 || (ctx->speedArray[*speedIndex+1]/graph->bwInter > .49))) {
+    tmpGraph->bwInter = tmpGraph->bwIntra = ctx->speedArray[++(*speedIndex)];
+    return 1;
+  }
+  *speedIndex = 0;
+  while (ctx->speedArray[*speedIndex] > ctx->maxBw && *speedIndex < ctx->nspeeds-1) (*speedIndex)++;
+  tmpGraph->bwIntra = tmpGraph->bwInter = ctx->speedArray[*speedIndex];
+  return 0;
+}
+
+/* Parallel search. Worker threads search the settings of the first pass
+ * speculatively, in the order ncclTopoSearchNextSettings would try them if
+ * no solution was found, each on its own copy of the system. Results are
+ * then consumed in that same order, following the sequence of settings the
+ * best solution so far leads to; settings it skips are aborted. Each search
+ * starts from an empty solution so its result does not depend on timing,
+ * which keeps the final graph identical on all ranks of a node. */
+
+// Node types the search follows paths between, and whose links it consumes
+static int ncclTopoSearchPathType(int type) {
+  return type == GPU || type == NET || type == NVS;
+}
+
+static ncclResult_t ncclTopoSearchFreeSystem(struct ncclTopoSystem* system) {
+  for (int t=0; t<NCCL_TOPO_NODE_TYPES; t++) {
+    if (!ncclTopoSearchPathType(t)) continue;
+    for (int n=0; n<system->nodes[t].count; n++) {
+      for (int p=0; p<NCCL_TOPO_NODE_TYPES; p++) {
+        if (ncclTopoSearchPathType(p)) free(system->nodes[t].nodes[n].paths[p]);
+      }
+    }
+  }
+  free(system);
+  return ncclSuccess;
+}
+
+// Copy the system for a search thread. Links and the paths the search follows
+// are rebased on the copy; other paths are shared with the original system.
+static ncclResult_t ncclTopoSearchDupSystem(struct ncclTopoSystem* system, struct ncclTopoSystem** dupSystem) {
+  struct ncclTopoSystem* dup;
+  NCCLCHECK(ncclCalloc(&dup, 1));
+  memcpy(dup, system, sizeof(struct ncclTopoSystem));
+  dup->searchCacheRef = 0;
+  // Don't let the copy own the paths of the original system, in case we free it on error below
+  for (int t=0; t<NCCL_TOPO_NODE_TYPES; t++) {
+    if (!ncclTopoSearchPathType(t)) continue;
+    for (int n=0; n<dup->nodes[t].count; n++) {
+      for (int p=0; p<NCCL_TOPO_NODE_TYPES; p++) {
+        if (ncclTopoSearchPathType(p)) dup->nodes[t].nodes[n].paths[p] = NULL;
+      }
+    }
+  }
+  ptrdiff_t offset = (char*)dup-(char*)system;
+  for (int t=0; t<NCCL_TOPO_NODE_TYPES; t++) {
+    for (int n=0; n<dup->nodes[t].count; n++) {
+      struct ncclTopoNode* node = dup->nodes[t].nodes+n;
+      for (int l=0; l<node->nlinks; l++) node->links[l].remNode = (struct ncclTopoNode*)((char*)node->links[l].remNode+offset);
+      if (!ncclTopoSearchPathType(t)) continue;
+      for (int p=0; p<NCCL_TOPO_NODE_TYPES; p++) {
+        if (!ncclTopoSearchPathType(p)) continue;
+        struct ncclTopoLinkList* paths = system->nodes[t].nodes[n].paths[p];
+        if (paths == NULL) continue;
+        ncclResult_t ret = ncclCalloc(node->paths+p, dup->nodes[p].count);
+        if (ret != ncclSuccess) {
+          ncclTopoSearchFreeSystem(dup);
+          return ret;
+        }
+        for (int i=0; i<dup->nodes[p].count; i++) {
+          struct ncclTopoLinkList* path = node->paths[p]+i;
+          path->count = paths[i].count;
+          path->bw = paths[i].bw;
+          path->type = paths[i].type;
+          for (int s=0; s<path->count; s++) path->list[s] = (struct ncclTopoLink*)((char*)paths[i].list[s]+offset);
+        }
+      }
+    }
+  }
+  *dupSystem = dup;
+  return ncclSuccess;
+}
+
+#define SEARCH_JOB_FREE 0
+#define SEARCH_JOB_PENDING 1
+#define SEARCH_JOB_RUNNING 2
+#define SEARCH_JOB_DONE 3
+
+struct ncclTopoSearchJob {
+  struct ncclTopoGraph settings;
+  struct ncclTopoGraph result; // Best solution found by this search only
+  int time;
+  int state;
+  uint32_t abort;
+};
+
+struct ncclTopoSearchPool {
+  struct ncclTopoSearchCtx* ctx;
+  struct ncclTopoGraph* empty; // Graph before the search
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  struct ncclTopoSearchJob* jobs;
+  int nJobs;
+  int head; // Oldest job, next to be consumed
+  int count;
+  int stop;
+  ncclResult_t result;
+};
+
+static int ncclTopoSearchSameSettings(struct ncclTopoGraph* a, struct ncclTopoGraph* b) {
+  return a->pattern == b->pattern && a->crossNic == b->crossNic && a->sameChannels == b->sameChannels &&
+    a->typeIntra == b->typeIntra && a->typeInter == b->typeInter &&
+    a->bwIntra == b->bwIntra && a->bwInter == b->bwInter;
+}
+
+static void* ncclTopoSearchWorker(void* args) {
+  struct ncclTopoSearchPool* pool = (struct ncclTopoSearchPool*)args;
+  struct ncclTopoSystem* system = NULL;
+  struct ncclTopoGraph* tmpGraph = NULL;
+  ncclResult_t ret = ncclSuccess;
+  NCCLCHECKGOTO(ncclTopoSearchDupSystem(pool->ctx->system, &system), ret, exit);
+  NCCLCHECKGOTO(ncclCalloc(&tmpGraph, 1), ret, exit);
+
+  pthread_mutex_lock(&pool->mutex);
+  while (1) {
+    struct ncclTopoSearchJob* job = NULL;
+    while (job == NULL && !pool->stop) {
+      for (int i=0; i<pool->count; i++) {
+        struct ncclTopoSearchJob* j = pool->jobs+(pool->head+i)%pool->nJobs;
+        if (j->state == SEARCH_JOB_PENDING) { job = j; break; }
+      }
+      if (job == NULL) pthread_cond_wait(&pool->cond, &pool->mutex);
+    }
+    if (job == NULL) break;
+    job->state = SEARCH_JOB_RUNNING;
+    pthread_mutex_unlock(&pool->mutex);
+
+    memcpy(tmpGraph, &job->settings, sizeof(struct ncclTopoGraph));
+    memcpy(&job->result, pool->empty, sizeof(struct ncclTopoGraph));
+    int time = ncclTopoSearchTimeout(tmpGraph);
+    searchAbort = &job->abort;
+    ret = ncclTopoSearchRec(system, tmpGraph, &job->result, &time);
+    searchAbort = NULL;
+
+    pthread_mutex_lock(&pool->mutex);
+    job->time = time;
+    job->state = SEARCH_JOB_DONE;
+    pthread_cond_broadcast(&pool->cond);
+    if (ret != ncclSuccess) break;
+  }
+  pthread_mutex_unlock(&pool->mutex);
+exit:
+  if (ret != ncclSuccess) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->result = ret;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+  }
+  free(tmpGraph);
+  if (system) ncclTopoSearchFreeSystem(system);
+  return NULL;
+}
+
+// Called with the pool mutex held
+static void ncclTopoSearchDropJob(struct ncclTopoSearchPool* pool) {
+  struct ncclTopoSearchJob* job = pool->jobs+pool->head;
+  __atomic_store_n(&job->abort, 1, __ATOMIC_RELAXED);
+  while (job->state == SEARCH_JOB_RUNNING) pthread_cond_wait(&pool->cond, &pool->mutex);
+  job->state = SEARCH_JOB_FREE;
+  pool->head = (pool->head+1)%pool->nJobs;
+  pool->count--;
+}
+
+static ncclResult_t ncclTopoSearchParallel(struct ncclTopoSearchCtx* ctx, struct ncclTopoGraph* graph, struct ncclTopoGraph* tmpGraph, int* speedIndex, int64_t* globalTimeout) {
+  struct ncclTopoSystem* system = ctx->system;
+  int nThreads = NCCL_TOPO_SEARCH_THREADS;
+  struct ncclTopoSearchPool pool;
+  memset(&pool, 0, sizeof(pool));
+  pool.ctx = ctx;
+  pool.nJobs = 2*nThreads;
+  pthread_mutex_init(&pool.mutex, NULL);
+  pthread_cond_init(&pool.cond, NULL);
+
+  ncclResult_t ret = ncclSuccess;
+  pthread_t* threads = NULL;
+  int nStarted = 0;
+  struct ncclTopoGraph* spec = NULL;
+  int specSpeedIndex = 0;
+  int specDone = 1;
+  int64_t specTimeout = 0;
+  NCCLCHECKGOTO(ncclCalloc(&pool.jobs, pool.nJobs), ret, exit);
+  NCCLCHECKGOTO(ncclCalloc(&pool.empty, 1), ret, exit);
+  NCCLCHECKGOTO(ncclCalloc(&spec, 1), ret, exit);
+  NCCLCHECKGOTO(ncclCalloc(&threads, nThreads), ret, exit);
+  memcpy(pool.empty, graph, sizeof(struct ncclTopoGraph));
+
+  for (; nStarted<nThreads; nStarted++) {
+    if (pthread_create(threads+nStarted, NULL, ncclTopoSearchWorker, &pool) != 0) {
+      WARN("Could not create topology search thread : %s", strerror(errno));
+      ret = ncclSystemError;
+      goto exit;
+    }
+    ncclSetThreadName(threads[nStarted], "NCCL Search%2d", nStarted);
+  }
+
+  pthread_mutex_lock(&pool.mutex);
+  while (1) {
+    // Drop the jobs of settings the best solution so far made us skip
+    while (pool.count && !ncclTopoSearchSameSettings(&pool.jobs[pool.head].settings, tmpGraph)) {
+      ncclTopoSearchDropJob(&pool);
+    }
+    if (pool.count == 0) {
+      // Restart speculating from the current settings
+      memcpy(spec, tmpGraph, sizeof(struct ncclTopoGraph));
+      specSpeedIndex = *speedIndex;
+      specDone = 0;
+    }
+    while (pool.count < pool.nJobs && !specDone) {
+      struct ncclTopoSearchJob* job = pool.jobs+(pool.head+pool.count)%pool.nJobs;
+      memcpy(&job->settings, spec, sizeof(struct ncclTopoGraph));
+      job->settings.nChannels = 0;
+      job->abort = 0;
+      job->state = SEARCH_JOB_PENDING;
+      pool.count++;
+      specDone = !ncclTopoSearchNextSettings(ctx, spec, pool.empty, &specSpeedIndex, 0, &specTimeout);
+    }
+    pthread_cond_broadcast(&pool.cond);
+
+    struct ncclTopoSearchJob* job = pool.jobs+pool.head;
+    while (job->state != SEARCH_JOB_DONE && pool.result == ncclSuccess) pthread_cond_wait(&pool.cond, &pool.mutex);
+    if (pool.result != ncclSuccess) {
+      ret = pool.result;
+      break;
+    }
+    *globalTimeout -= ncclTopoSearchTimeout(tmpGraph);
+    int time = job->time;
+    int copy = 0;
+    NCCLCHECKGOTO(ncclTopoCompareGraphs(system, &job->result, graph, &copy), ret, unlock);
+    if (copy) memcpy(graph, &job->result, sizeof(struct ncclTopoGraph));
+    ncclTopoSearchDropJob(&pool);
+
+    // Optimal solution, stop here
+    if (time == -1 && copy) break;
+    if (graph->nChannels*graph->bwInter >= system->totalBw) break;
+    // The search stopped on a solution which was not better than ours
+    if (time == -1) time = 0;
+    if (!ncclTopoSearchNextSettings(ctx, tmpGraph, graph, speedIndex, time, globalTimeout)) break;
+  }
+unlock:
+  pool.stop = 1;
+  for (int i=0; i<pool.count; i++) __atomic_store_n(&pool.jobs[(pool.head+i)%pool.nJobs].abort, 1, __ATOMIC_RELAXED);
+  pthread_cond_broadcast(&pool.cond);
+  pthread_mutex_unlock(&pool.mutex);
+exit:
+  if (nStarted < nThreads) {
+    pthread_mutex_lock(&pool.mutex);
+    pool.stop = 1;
+    pthread_cond_broadcast(&pool.cond);
+    pthread_mutex_unlock(&pool.mutex);
+  }
+  for (int i=0; i<nStarted; i++) pthread_join(threads[i], NULL);
+  pthread_cond_destroy(&pool.cond);
+  pthread_mutex_destroy(&pool.mutex);
+  free(threads);
+  free(spec);
+  free(pool.empty);
+  free(pool.jobs);
+  return ret;
+}
+
+static ncclResult_t ncclTopoSearchGraph(ncclTopoSystem* system, struct ncclTopoGraph* graph) {
   int ngpus = system->nodes[GPU].count;
   graph->crossNic = NCCL_CROSS_NIC;
   int crossNic = (system->nodes[NET].count > 1) && graph->crossNic &&
@@ -893,11 +1259,21 @@ ncclResult_t ncclTopoCompute(ncclTopoSystem* system, struct ncclTopoGraph* graph
   if (ngpus == 1 || graph->pattern != NCCL_TOPO_PATTERN_RING) totalBw *= ngpus*1.0/(ngpus-1);
   while ((speedArray[speedIndex] > maxBw || speedArray[speedIndex]*graph->minChannels > totalBw) && speedIndex < nspeeds-1) speedIndex++;
   tmpGraph.bwIntra = tmpGraph.bwInter = speedArray[speedIndex];
-  int64_t globalTimeout = NCCL_SEARCH_GLOBAL_TIMEOUT;
+
+  struct ncclTopoSearchCtx ctx = {
+    system, ngpus, ccMin, crossNic, trySameChannels, speedArray, nspeeds, maxBw,
+    (int64_t)(NCCL_SEARCH_GLOBAL_TIMEOUT*std::max(NCCL_TOPO_SEARCH_THREADS, (int64_t)1))
+  };
+  int64_t globalTimeout = ctx.globalTimeout;
+  int time;
+
+  if (NCCL_TOPO_SEARCH_THREADS > 1) {
+    NCCLCHECK(ncclTopoSearchParallel(&ctx, graph, &tmpGraph, &speedIndex, &globalTimeout));
+    goto done;
+  }
 
 search:
-  int time = tmpGraph.sameChannels ? NCCL_SEARCH_TIMEOUT_SAMECHANNELS :
-    tmpGraph.pattern == NCCL_TOPO_PATTERN_TREE ? NCCL_SEARCH_TIMEOUT_TREE : NCCL_SEARCH_TIMEOUT;
+  time = ncclTopoSearchTimeout(&tmpGraph);
   tmpGraph.nChannels = 0;
   globalTimeout -= time;
 
@@ -919,54 +1295,7 @@ search:
 
   if (pass == 1) {
     // First pass, we don't have a solution yet ; try other options
-
-    // Try having different channels
-    if (tmpGraph.sameChannels == 1) {
-      tmpGraph.sameChannels = 0;
-      goto search;
-    }
-    tmpGraph.sameChannels = trySameChannels;
-
-    if (time != -1) globalTimeout += time;
-    else globalTimeout = NCCL_SEARCH_GLOBAL_TIMEOUT;
-    if (globalTimeout < 0 && graph->nChannels) goto done;
-
-    // Try a simpler tree
-    if (ccMin >= 90 && tmpGraph.pattern == NCCL_TOPO_PATTERN_BALANCED_TREE) {
-      tmpGraph.pattern = NCCL_TOPO_PATTERN_TREE;
-      goto search;
-    }
-    tmpGraph.pattern = graph->pattern;
-
-    int maxTypeIntra = system->nodes[NET].count > 0 ? tmpGraph.typeInter : PATH_SYS;
-    if (tmpGraph.typeIntra < maxTypeIntra && (graph->nChannels == 0 || tmpGraph.typeIntra < graph->typeIntra)) {
-      tmpGraph.typeIntra += 1;
-      goto search;
-    }
-    tmpGraph.typeIntra = ngpus == 1 ? PATH_LOC : PATH_NVL;
-
-    if (system->nodes[NET].count > 0 && tmpGraph.typeInter < PATH_SYS && (graph->nChannels == 0 || tmpGraph.typeInter < graph->typeInter || tmpGraph.typeInter < PATH_PXN)) {
-      tmpGraph.typeInter += 1;
-      goto search;
-    }
-    tmpGraph.typeInter = PATH_PIX;
-
-    if (crossNic && tmpGraph.crossNic == 0) {
-      // Try again with crossNic if permitted
-      tmpGraph.crossNic = crossNic;
-      goto search;
-    }
-    tmpGraph.crossNic = 0;
-
-    // Decrease bw until we find a solution
-    if ((speedIndex < nspeeds-1) && (graph->nChannels == 0 || (speedArray[speedIndex+1]/graph->bwInter > .49))) {
-      tmpGraph.bwInter = tmpGraph.bwIntra = speedArray[++speedIndex];
-      goto search;
-    }
-    speedIndex = 0;
-    while (speedArray[speedIndex] > maxBw && speedIndex < nspeeds-1) speedIndex++;
-    tmpGraph.bwIntra = tmpGraph.bwInter = speedArray[speedIndex];
-
+    if (ncclTopoSearchNextSettings(&ctx, &tmpGraph, graph, &speedIndex, time, &globalTimeout)) goto search;
   }
 
 done:
@@ -1016,6 +1345,277 @@ done:
   return ncclSuccess;
 }
 
+/* Search cache. The search only depends on the system and on the search
+ * parameters of the graph, so communicators created on the same system, e.g.
+ * by ncclCommSplit, can reuse the graphs of the first one. Cached graphs
+ * store GPU indices instead of ranks in intra, and are saved to disk as XML
+ * graphs, which use GPU devs, so they remain valid when ranks change. */
+
+#define NCCL_TOPO_SEARCH_CACHE_VERSION 1
+
+struct ncclTopoSearchCacheEntry {
+  uint64_t key;
+  struct ncclTopoGraph graph;
+  struct ncclTopoSearchCacheEntry* next;
+};
+
+// Guards the entries and the number of systems using them. Files are read
+// and written without it.
+static pthread_mutex_t searchCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static struct ncclTopoSearchCacheEntry* searchCache = NULL;
+static int searchCacheRefs = 0;
+
+// FNV-1a
+static void searchCacheHash(uint64_t* hash, const void* data, size_t size) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i=0; i<size; i++) {
+    *hash ^= bytes[i];
+    *hash *= 0x100000001b3ULL;
+  }
+}
+#define HASH(hash, value) searchCacheHash(hash, &(value), sizeof(value))
+
+static uint64_t ncclTopoSearchCacheKey(struct ncclTopoSystem* system, struct ncclTopoGraph* graph) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  int version = NCCL_TOPO_SEARCH_CACHE_VERSION;
+  HASH(&hash, version);
+  for (int t=0; t<NCCL_TOPO_NODE_TYPES; t++) {
+    HASH(&hash, system->nodes[t].count);
+    for (int n=0; n<system->nodes[t].count; n++) {
+      struct ncclTopoNode* node = system->nodes[t].nodes+n;
+      HASH(&hash, node->id);
+      if (t == GPU) {
+        // Ranks only matter through intra, which is stored as GPU indices
+        HASH(&hash, node->gpu.dev);
+        HASH(&hash, node->gpu.cudaCompCap);
+        HASH(&hash, node->gpu.gdrSupport);
+      } else if (t == NET) {
+        HASH(&hash, node->net.asic);
+        HASH(&hash, node->net.port);
+        HASH(&hash, node->net.bw);
+        HASH(&hash, node->net.latency);
+        HASH(&hash, node->net.gdrSupport);
+        HASH(&hash, node->net.collSupport);
+        HASH(&hash, node->net.maxChannels);
+      } else if (t == CPU) {
+        HASH(&hash, node->cpu.arch);
+        HASH(&hash, node->cpu.vendor);
+        HASH(&hash, node->cpu.model);
+      } else if (t == PCI) {
+        HASH(&hash, node->pci.device);
+      }
+      HASH(&hash, node->nlinks);
+      for (int l=0; l<node->nlinks; l++) {
+        struct ncclTopoLink* link = node->links+l;
+        int remType = link->remNode->type;
+        int remIndex = link->remNode-system->nodes[remType].nodes;
+        HASH(&hash, link->type);
+        HASH(&hash, link->bw);
+        HASH(&hash, remType);
+        HASH(&hash, remIndex);
+      }
+      for (int p=0; p<NCCL_TOPO_NODE_TYPES; p++) {
+        if (node->paths[p] == NULL) continue;
+        HASH(&hash, p);
+        for (int r=0; r<system->nodes[p].count; r++) {
+          struct ncclTopoLinkList* path = node->paths[p]+r;
+          HASH(&hash, path->type);
+          HASH(&hash, path->bw);
+          HASH(&hash, path->count);
+        }
+      }
+    }
+  }
+  HASH(&hash, system->maxBw);
+  HASH(&hash, system->totalBw);
+  // ncclTopoCompute overwrites crossNic with NCCL_CROSS_NIC
+  int64_t crossNic = NCCL_CROSS_NIC;
+  HASH(&hash, crossNic);
+  // Parallel searches use a larger budget
+  int64_t searchThreads = std::max(NCCL_TOPO_SEARCH_THREADS, (int64_t)1);
+  HASH(&hash, searchThreads);
+  HASH(&hash, graph->id);
+  HASH(&hash, graph->pattern);
+  HASH(&hash, graph->collNet);
+  HASH(&hash, graph->minChannels);
+  HASH(&hash, graph->maxChannels);
+  return hash;
+}
+#undef HASH
+
+// Convert intra between ranks and GPU indices
+static ncclResult_t ncclTopoSearchCacheConvert(struct ncclTopoSystem* system, struct ncclTopoGraph* graph, int toIndex) {
+  int ngpus = system->nodes[GPU].count;
+  for (int i=0; i<graph->nChannels*ngpus; i++) {
+    if (toIndex) {
+      NCCLCHECK(ncclTopoRankToIndex(system, graph->intra[i], graph->intra+i));
+    } else {
+      graph->intra[i] = system->nodes[GPU].nodes[graph->intra[i]].gpu.rank;
+    }
+  }
+  return ncclSuccess;
+}
+
+static void ncclTopoSearchCachePath(uint64_t key, char* path, size_t size) {
+  snprintf(path, size, "%s/nccl_topo_graph_%016lx.xml", NCCL_TOPO_SEARCH_CACHE_DIR.c_str(), key);
+}
+
+// Called with searchCacheLock held
+static ncclResult_t ncclTopoSearchCacheInsert(struct ncclTopoSystem* system, uint64_t key, struct ncclTopoGraph* graph) {
+  struct ncclTopoSearchCacheEntry* entry;
+  NCCLCHECK(ncclCalloc(&entry, 1));
+  memcpy(&entry->graph, graph, sizeof(struct ncclTopoGraph));
+  if (ncclTopoSearchCacheConvert(system, &entry->graph, 1) != ncclSuccess) {
+    INFO(NCCL_GRAPH, "Search %d : graph has ranks outside of the system, not caching it", graph->id);
+    free(entry);
+    return ncclSuccess;
+  }
+  entry->key = key;
+  entry->next = searchCache;
+  searchCache = entry;
+  return ncclSuccess;
+}
+
+static ncclResult_t ncclTopoSearchCacheLoad(struct ncclTopoSystem* system, uint64_t key, struct ncclTopoGraph* graph, int* found) {
+  char path[PATH_MAX];
+  ncclTopoSearchCachePath(key, path, sizeof(path));
+  if (access(path, R_OK) != 0) return ncclSuccess;
+
+  ncclResult_t ret = ncclSuccess;
+  struct ncclTopoGraph* tmpGraph = NULL;
+  struct ncclXml* xml = NULL;
+  int nChannels = -1;
+  NCCLCHECKGOTO(ncclCalloc(&tmpGraph, 1), ret, exit);
+  NCCLCHECKGOTO(ncclCalloc(&xml, 1), ret, exit);
+  memcpy(tmpGraph, graph, sizeof(struct ncclTopoGraph));
+  tmpGraph->nChannels = 0;
+  if (ncclTopoGetXmlGraphFromFile(path, xml) != ncclSuccess || xml->nodes[0].nSubs != 1 ||
+      ncclTopoGetGraphFromXml(xml->nodes, system, tmpGraph, &nChannels) != ncclSuccess ||
+      tmpGraph->nChannels != nChannels ||
+      xmlGetAttrInt(xml->nodes[0].subs[0], "minchannels", &tmpGraph->minChannels) != ncclSuccess ||
+      xmlGetAttrInt(xml->nodes[0].subs[0], "maxchannels", &tmpGraph->maxChannels) != ncclSuccess) {
+    INFO(NCCL_GRAPH, "Search %d : ignoring invalid cached graph %s", graph->id, path);
+    goto exit;
+  }
+  memcpy(graph, tmpGraph, sizeof(struct ncclTopoGraph));
+  INFO(NCCL_GRAPH, "Search %d : %d channels loaded from cached graph %s", graph->id, nChannels, path);
+  *found = 1;
+exit:
+  free(xml);
+  free(tmpGraph);
+  return ret;
+}
+
+// Write to a temporary file first so that other processes never read a
+// partial graph. The temporary file is unique to the call, as threads of the
+// process can save the same graph concurrently.
+static ncclResult_t ncclTopoSearchCacheSave(struct ncclTopoSystem* system, uint64_t key, struct ncclTopoGraph* graph) {
+  static int nSaves = 0;
+  char path[PATH_MAX];
+  char tmpPath[PATH_MAX];
+  ncclTopoSearchCachePath(key, path, sizeof(path));
+  snprintf(tmpPath, sizeof(tmpPath), "%s.%d.%d.tmp", path, getpid(), __atomic_fetch_add(&nSaves, 1, __ATOMIC_RELAXED));
+
+  struct ncclXml* xml;
+  NCCLCHECK(ncclCalloc(&xml, 1));
+  ncclResult_t ret = ncclSuccess;
+  NCCLCHECKGOTO(ncclTopoGetXmlFromGraphs(1, &graph, system, xml), ret, exit);
+  // The search may change the channel limits, e.g. for NVLS
+  NCCLCHECKGOTO(xmlSetAttrInt(xml->nodes[0].subs[0], "minchannels", graph->minChannels), ret, exit);
+  NCCLCHECKGOTO(xmlSetAttrInt(xml->nodes[0].subs[0], "maxchannels", graph->maxChannels), ret, exit);
+  NCCLCHECKGOTO(ncclTopoDumpXmlToFile(tmpPath, xml), ret, exit);
+  if (rename(tmpPath, path) != 0) {
+    INFO(NCCL_GRAPH, "Search %d : could not save graph to %s : %s", graph->id, path, strerror(errno));
+    unlink(tmpPath);
+  }
+exit:
+  free(xml);
+  return ret;
+}
+
+// Called with searchCacheLock held
+static struct ncclTopoSearchCacheEntry* ncclTopoSearchCacheFind(uint64_t key) {
+  for (struct ncclTopoSearchCacheEntry* entry = searchCache; entry; entry = entry->next) {
+    if (entry->key == key) return entry;
+  }
+  return NULL;
+}
+
+static ncclResult_t ncclTopoSearchCacheGet(struct ncclTopoSystem* system, uint64_t key, struct ncclTopoGraph* graph, int* found) {
+  ncclResult_t ret = ncclSuccess;
+  struct ncclTopoSearchCacheEntry* entry;
+  *found = 0;
+  pthread_mutex_lock(&searchCacheLock);
+  if (!system->searchCacheRef) {
+    system->searchCacheRef = 1;
+    searchCacheRefs++;
+  }
+  entry = ncclTopoSearchCacheFind(key);
+  if (entry) {
+    memcpy(graph, &entry->graph, sizeof(struct ncclTopoGraph));
+    NCCLCHECKGOTO(ncclTopoSearchCacheConvert(system, graph, 0), ret, exit);
+    INFO(NCCL_GRAPH, "Search %d : %d channels reused from search cache", graph->id, graph->nChannels);
+    *found = 1;
+  }
+  pthread_mutex_unlock(&searchCacheLock);
+  if (*found || NCCL_TOPO_SEARCH_CACHE_DIR.empty()) return ncclSuccess;
+
+  NCCLCHECK(ncclTopoSearchCacheLoad(system, key, graph, found));
+  if (*found == 0) return ncclSuccess;
+  pthread_mutex_lock(&searchCacheLock);
+  // Another communicator may have loaded the same graph concurrently
+  if (ncclTopoSearchCacheFind(key) == NULL) {
+    NCCLCHECKGOTO(ncclTopoSearchCacheInsert(system, key, graph), ret, exit);
+  }
+exit:
+  pthread_mutex_unlock(&searchCacheLock);
+  return ret;
+}
+
+static ncclResult_t ncclTopoSearchCachePut(struct ncclTopoSystem* system, uint64_t key, struct ncclTopoGraph* graph) {
+  ncclResult_t ret = ncclSuccess;
+  pthread_mutex_lock(&searchCacheLock);
+  // Another communicator may have cached the same graph concurrently, then it
+  // is already saved or being saved
+  int inserted = ncclTopoSearchCacheFind(key) == NULL;
+  if (inserted) ret = ncclTopoSearchCacheInsert(system, key, graph);
+  pthread_mutex_unlock(&searchCacheLock);
+  NCCLCHECK(ret);
+  if (inserted && !NCCL_TOPO_SEARCH_CACHE_DIR.empty()) {
+    NCCLCHECK(ncclTopoSearchCacheSave(system, key, graph));
+  }
+  return ncclSuccess;
+}
+
+void ncclTopoSearchCacheRelease(struct ncclTopoSystem* system) {
+  if (!system->searchCacheRef) return;
+  pthread_mutex_lock(&searchCacheLock);
+  system->searchCacheRef = 0;
+  if (--searchCacheRefs == 0) {
+    while (searchCache) {
+      struct ncclTopoSearchCacheEntry* entry = searchCache;
+      searchCache = entry->next;
+      free(entry);
+    }
+  }
+  pthread_mutex_unlock(&searchCacheLock);
+}
+
+ncclResult_t ncclTopoCompute(ncclTopoSystem* system, struct ncclTopoGraph* graph) {
+  // Graphs loaded from NCCL_GRAPH_FILE bypass the cache
+  if (NCCL_TOPO_SEARCH_CACHE == 0 || !NCCL_GRAPH_FILE.empty()) {
+    NCCLCHECK(ncclTopoSearchGraph(system, graph));
+    return ncclSuccess;
+  }
+  uint64_t key = ncclTopoSearchCacheKey(system, graph);
+  int found;
+  NCCLCHECK(ncclTopoSearchCacheGet(system, key, graph, &found));
+  if (found) return ncclSuccess;
+  NCCLCHECK(ncclTopoSearchGraph(system, graph));
+  NCCLCHECK(ncclTopoSearchCachePut(system, key, graph));
+  return ncclSuccess;
+}
+
 ncclResult_t ncclTopoPrintGraph(struct ncclTopoSystem* system, struct ncclTopoGraph* graph) {
   INFO(NCCL_GRAPH, "Pattern %d, crossNic %d, nChannels %d, bw %f/%f, type %s/%s, sameChannels %d", graph->pattern, graph->crossNic, graph->nChannels, graph->bwIntra, graph->bwInter, topoPathTypeStr[graph->typeIntra], topoPathTypeStr[graph->typeInter], graph->sameChannels);
   int ngpus = system->nodes[GPU].count;
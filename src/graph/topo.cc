@@ -911,6 +911,28 @@ ncclResult_t ncclTopoGetCpuAffinity(struct ncclTopoSystem* system, int rank, cpu
   return ncclSuccess;
 }
 
+ncclResult_t ncclTopoGetNetCpuAffinity(struct ncclTopoSystem* system, int index, int* netDev, cpu_set_t* affinity) {
+  if (index < 0 || index >= system->nodes[NET].count) {
+    WARN("NIC index %d out of range, %d NICs", index, system->nodes[NET].count);
+    return ncclInternalError;
+  }
+  struct ncclTopoNode* net = system->nodes[NET].nodes+index;
+  *netDev = (int)net->id;
+  CPU_ZERO(affinity);
+  // Find closer CPU
+  int cpuIndex = -1, minHops = 0;
+  for (int c=0; c<system->nodes[CPU].count; c++) {
+    if (net->paths[CPU] == NULL) break;
+    int nHops = net->paths[CPU][c].count;
+    if (cpuIndex == -1 || nHops < minHops) {
+      cpuIndex = c;
+      minHops = nHops;
+    }
+  }
+  if (cpuIndex != -1) memcpy(affinity, &system->nodes[CPU].nodes[cpuIndex].cpu.affinity, sizeof(cpu_set_t));
+  return ncclSuccess;
+}
+
 ncclResult_t ncclTopoGetGpuCount(struct ncclTopoSystem* system, int* count) {
   *count = system->nodes[GPU].count;
   return ncclSuccess;
@@ -6,6 +6,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <ctype.h>
@@ -17,23 +18,83 @@
 /* XML File Parser */
 /*******************/
 
-ncclResult_t xmlGetChar(FILE* file, char* c) {
-  if (fread(c, 1, 1, file) == 0) {
+// The whole file is mapped in memory, or read into a buffer when it cannot be
+// mapped (e.g. a pipe), and tokenized in a single pass.
+struct xmlStream {
+  const char* data;
+  size_t size;
+  size_t pos;
+  int mapped;
+};
+
+// Returns -1 with errno set if the file cannot be opened or read
+static int xmlStreamOpen(const char* path, struct xmlStream* stream) {
+  memset(stream, 0, sizeof(struct xmlStream));
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) return -1;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE|MAP_POPULATE, fd, 0);
+    if (data != MAP_FAILED) {
+      stream->data = (const char*)data;
+      stream->size = st.st_size;
+      stream->mapped = 1;
+      close(fd);
+      return 0;
+    }
+  }
+  char* buf = NULL;
+  size_t cap = 0;
+  while (1) {
+    if (stream->size == cap) {
+      cap = cap ? 2*cap : 65536;
+      char* newBuf = (char*)realloc(buf, cap);
+      if (newBuf == NULL) break;
+      buf = newBuf;
+    }
+    ssize_t n = read(fd, buf+stream->size, cap-stream->size);
+    if (n > 0) {
+      stream->size += n;
+    } else if (n == 0) {
+      stream->data = buf;
+      close(fd);
+      return 0;
+    } else if (errno != EINTR) {
+      break;
+    }
+  }
+  int err = errno;
+  free(buf);
+  close(fd);
+  stream->size = 0;
+  errno = err;
+  return -1;
+}
+
+static void xmlStreamClose(struct xmlStream* stream) {
+  if (stream->mapped) munmap((void*)stream->data, stream->size);
+  else free((void*)stream->data);
+  stream->data = NULL;
+}
+
+static inline ncclResult_t xmlGetChar(struct xmlStream* stream, char* c) {
+  if (stream->pos == stream->size) {
     WARN("XML Parse : Unexpected EOF");
     return ncclInternalError;
   }
+  *c = stream->data[stream->pos++];
   return ncclSuccess;
 }
 
-ncclResult_t xmlGetValue(FILE* file, char* value, char* last) {
+ncclResult_t xmlGetValue(struct xmlStream* stream, char* value, char* last) {
   char c;
-  NCCLCHECK(xmlGetChar(file, &c));
+  NCCLCHECK(xmlGetChar(stream, &c));
   if (c != '"' && c != '\'') {
 #if INT_OK
     int o = 0;
     do {
       value[o++] = c;
-      NCCLCHECK(xmlGetChar(file, &c));
+      NCCLCHECK(xmlGetChar(stream, &c));
     } while (c >= '0' && c <= '9');
     value[o] = '\0';
     *last = c;
@@ -43,90 +104,96 @@ ncclResult_t xmlGetValue(FILE* file, char* value, char* last) {
     return ncclInternalError;
 #endif
   }
-  int o = 0;
-  do {
-    NCCLCHECK(xmlGetChar(file, &c));
-    value[o++] = c;
-  } while (c != '"');
-  value[o-1] = '\0';
-  NCCLCHECK(xmlGetChar(file, last));
+  const char* start = stream->data + stream->pos;
+  const char* end = (const char*)memchr(start, c, stream->size - stream->pos);
+  if (end == NULL) {
+    WARN("XML Parse : Unexpected EOF");
+    return ncclInternalError;
+  }
+  size_t len = end - start;
+  if (len > MAX_STR_LEN) {
+    WARN("Error : value %.*s too long (max %d)", MAX_STR_LEN, start, MAX_STR_LEN);
+    return ncclInternalError;
+  }
+  memcpy(value, start, len);
+  value[len] = '\0';
+  stream->pos += len+1;
+  NCCLCHECK(xmlGetChar(stream, last));
   return ncclSuccess;
 }
 
-ncclResult_t xmlGetToken(FILE* file, char* name, char* value, char* last) {
-  char c;
-  char* ptr = name;
-  int o = 0;
-  do {
-    NCCLCHECK(xmlGetChar(file, &c));
-    if (c == '=') {
-      ptr[o] = '\0';
-      if (value == NULL) {
-        WARN("XML Parse : Unexpected value with name %s", ptr);
-        return ncclInternalError;
-      }
-      return xmlGetValue(file, value, last);
-    }
-    ptr[o] = c;
-    if (o == MAX_STR_LEN-1) {
-      ptr[o] = '\0';
-      WARN("Error : name %s too long (max %d)", ptr, MAX_STR_LEN);
+static inline int xmlIsTokenEnd(char c) {
+  return c == '=' || c == ' ' || c == '>' || c == '/' || c == '\n' || c == '\r';
+}
+
+ncclResult_t xmlGetToken(struct xmlStream* stream, char* name, char* value, char* last) {
+  const char* start = stream->data + stream->pos;
+  const char* end = stream->data + stream->size;
+  const char* ptr = start;
+  while (ptr < end && !xmlIsTokenEnd(*ptr)) ptr++;
+  if (ptr == end) {
+    WARN("XML Parse : Unexpected EOF");
+    return ncclInternalError;
+  }
+  size_t len = ptr - start;
+  if (len >= MAX_STR_LEN) {
+    WARN("Error : name %.*s too long (max %d)", MAX_STR_LEN-1, start, MAX_STR_LEN);
+    return ncclInternalError;
+  }
+  memcpy(name, start, len);
+  name[len] = '\0';
+  stream->pos += len+1;
+  if (*ptr == '=') {
+    if (value == NULL) {
+      WARN("XML Parse : Unexpected value with name %s", name);
       return ncclInternalError;
     }
-    o++;
-  } while (c != ' ' && c != '>' && c != '/' && c != '\n' && c != '\r');
-  ptr[o-1] = '\0';
-  *last = c;
+    return xmlGetValue(stream, value, last);
+  }
+  *last = *ptr;
   return ncclSuccess;
 }
 
-// Shift the 3-chars string by one char and append c at the end
-#define SHIFT_APPEND(s, c) do { s[0]=s[1]; s[1]=s[2]; s[2]=c; } while(0)
-ncclResult_t xmlSkipComment(FILE* file, char* start, char next) {
-  // Start from something neutral with \0 at the end.
-  char end[4] = "...";
-
-  // Inject all trailing chars from previous reads. We don't need
-  // to check for --> here because there cannot be a > in the name.
-  for (int i=0; i<strlen(start); i++) SHIFT_APPEND(end, start[i]);
-  SHIFT_APPEND(end, next);
+ncclResult_t xmlSkipComment(struct xmlStream* stream, char* start, char next) {
+  // The comment may have been closed within the element name we just read.
+  // Other delimiters than '>' cannot be part of "-->".
+  size_t len = strlen(start);
+  if (next == '>' && len >= 2 && start[len-2] == '-' && start[len-1] == '-') return ncclSuccess;
 
-  // Stop when we find "-->"
-  while (strcmp(end, "-->") != 0) {
-    int c;
-    if (fread(&c, 1, 1, file) != 1) {
-      WARN("XML Parse error : unterminated comment");
-      return ncclInternalError;
-    }
-    SHIFT_APPEND(end, c);
+  const char* end = (const char*)memmem(stream->data + stream->pos, stream->size - stream->pos, "-->", 3);
+  if (end == NULL) {
+    WARN("XML Parse error : unterminated comment");
+    return ncclInternalError;
   }
+  stream->pos = end + 3 - stream->data;
   return ncclSuccess;
 }
 
-ncclResult_t xmlGetNode(FILE* file, struct ncclXmlNode* node) {
+ncclResult_t xmlGetNode(struct xmlStream* stream, struct ncclXmlNode* node) {
   node->type = NODE_TYPE_NONE;
   char c = ' ';
   while (c == ' ' || c == '\n' || c == '\r') {
-    if (fread(&c, 1, 1, file) == 0) return ncclSuccess;
+    if (stream->pos == stream->size) return ncclSuccess;
+    c = stream->data[stream->pos++];
   }
   if (c != '<') {
     WARN("XML Parse error : expecting '<', got '%c'", c);
     return ncclInternalError;
   }
   // Read XML element name
-  NCCLCHECK(xmlGetToken(file, node->name, NULL, &c));
+  NCCLCHECK(xmlGetToken(stream, node->name, NULL, &c));
 
   // Check for comments
   if (strncmp(node->name, "!--", 3) == 0) {
-    NCCLCHECK(xmlSkipComment(file, node->name+3, c));
-    return xmlGetNode(file, node);
+    NCCLCHECK(xmlSkipComment(stream, node->name+3, c));
+    return xmlGetNode(stream, node);
   }
 
   // Check for closing tag
   if (node->name[0] == '\0' && c == '/') {
     node->type = NODE_TYPE_CLOSE;
     // Re-read the name, we got '/' in the first call
-    NCCLCHECK(xmlGetToken(file, node->name, NULL, &c));
+    NCCLCHECK(xmlGetToken(stream, node->name, NULL, &c));
     if (c != '>') {
       WARN("XML Parse error : unexpected trailing %c in closing tag %s", c, node->name);
       return ncclInternalError;
@@ -139,7 +206,7 @@ ncclResult_t xmlGetNode(FILE* file, struct ncclXmlNode* node) {
   // Get Attributes
   int a = 0;
   while (c == ' ') {
-    NCCLCHECK(xmlGetToken(file, node->attrs[a].key, node->attrs[a].value, &c));
+    NCCLCHECK(xmlGetToken(stream, node->attrs[a].key, node->attrs[a].value, &c));
     if (a == MAX_ATTR_COUNT) {
       INFO(NCCL_GRAPH, "XML Parse : Ignoring extra attributes (max %d)", MAX_ATTR_COUNT);
       // Actually we need to still consume the extra attributes so we have an extra one.
@@ -149,7 +216,7 @@ ncclResult_t xmlGetNode(FILE* file, struct ncclXmlNode* node) {
   if (c == '/') {
     node->type = NODE_TYPE_SINGLE;
     char str[MAX_STR_LEN];
-    NCCLCHECK(xmlGetToken(file, str, NULL, &c));
+    NCCLCHECK(xmlGetToken(stream, str, NULL, &c));
   }
   if (c != '>') {
     WARN("XML Parse : expected >, got '%c'", c);
@@ -158,14 +225,14 @@ ncclResult_t xmlGetNode(FILE* file, struct ncclXmlNode* node) {
   return ncclSuccess;
 }
 
-typedef ncclResult_t (*xmlHandlerFunc_t)(FILE*, struct ncclXml*, struct ncclXmlNode*);
+typedef ncclResult_t (*xmlHandlerFunc_t)(struct xmlStream*, struct ncclXml*, struct ncclXmlNode*);
 
 struct xmlHandler {
   const char * name;
   xmlHandlerFunc_t func;
 };
 
-ncclResult_t xmlLoadSub(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head, struct xmlHandler handlers[], int nHandlers) {
+ncclResult_t xmlLoadSub(struct xmlStream* stream, struct ncclXml* xml, struct ncclXmlNode* head, struct xmlHandler handlers[], int nHandlers) {
   if (head && head->type == NODE_TYPE_SINGLE) return ncclSuccess;
   while (1) {
     if (xml->maxIndex == MAX_NODES) {
@@ -173,8 +240,12 @@ ncclResult_t xmlLoadSub(FILE* file, struct ncclXml* xml, struct ncclXmlNode* hea
       return ncclInternalError;
     }
     struct ncclXmlNode* node = xml->nodes+xml->maxIndex;
-    memset(node, 0, sizeof(struct ncclXmlNode));
-    NCCLCHECK(xmlGetNode(file, node));
+    // Like xmlAddNode, only reset the header of the node; clearing all of its
+    // attribute storage dominated the parse time
+    node->nAttrs = 0;
+    node->nSubs = 0;
+    node->parent = NULL;
+    NCCLCHECK(xmlGetNode(stream, node));
     if (node->type == NODE_TYPE_NONE) {
       if (head) {
         WARN("XML Parse : unterminated %s", head->name);
@@ -198,14 +269,14 @@ ncclResult_t xmlLoadSub(FILE* file, struct ncclXml* xml, struct ncclXmlNode* hea
         node->parent = head;
         node->nSubs = 0;
         xml->maxIndex++;
-        NCCLCHECK(handlers[h].func(file, xml, node));
+        NCCLCHECK(handlers[h].func(stream, xml, node));
         found = 1;
         break;
       }
     }
     if (!found) {
       if (nHandlers) INFO(NCCL_GRAPH, "Ignoring element %s", node->name);
-      NCCLCHECK(xmlLoadSub(file, xml, node, NULL, 0));
+      NCCLCHECK(xmlLoadSub(stream, xml, node, NULL, 0));
     }
   }
 }
@@ -249,41 +320,41 @@ ncclResult_t ncclTopoDumpXmlToFile(const char* xmlTopoFile, struct ncclXml* xml)
 /* Parser rules for our specific format */
 /****************************************/
 
-ncclResult_t ncclTopoXmlLoadNvlink(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head) {
-  NCCLCHECK(xmlLoadSub(file, xml, head, NULL, 0));
+ncclResult_t ncclTopoXmlLoadNvlink(struct xmlStream* stream, struct ncclXml* xml, struct ncclXmlNode* head) {
+  NCCLCHECK(xmlLoadSub(stream, xml, head, NULL, 0));
   return ncclSuccess;
 }
 
-ncclResult_t ncclTopoXmlLoadGpu(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head) {
+ncclResult_t ncclTopoXmlLoadGpu(struct xmlStream* stream, struct ncclXml* xml, struct ncclXmlNode* head) {
   struct xmlHandler handlers[] = { { "nvlink", ncclTopoXmlLoadNvlink } };
-  NCCLCHECK(xmlLoadSub(file, xml, head, handlers, 1));
+  NCCLCHECK(xmlLoadSub(stream, xml, head, handlers, 1));
   return ncclSuccess;
 }
 
-ncclResult_t ncclTopoXmlLoadNet(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head) {
-  NCCLCHECK(xmlLoadSub(file, xml, head, NULL, 0));
+ncclResult_t ncclTopoXmlLoadNet(struct xmlStream* stream, struct ncclXml* xml, struct ncclXmlNode* head) {
+  NCCLCHECK(xmlLoadSub(stream, xml, head, NULL, 0));
   return ncclSuccess;
 }
 
-ncclResult_t ncclTopoXmlLoadNic(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head) {
+ncclResult_t ncclTopoXmlLoadNic(struct xmlStream* stream, struct ncclXml* xml, struct ncclXmlNode* head) {
   struct xmlHandler handlers[] = { { "net", ncclTopoXmlLoadNet } };
-  NCCLCHECK(xmlLoadSub(file, xml, head, handlers, 1));
+  NCCLCHECK(xmlLoadSub(stream, xml, head, handlers, 1));
   return ncclSuccess;
 }
 
-ncclResult_t ncclTopoXmlLoadPci(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head) {
+ncclResult_t ncclTopoXmlLoadPci(struct xmlStream* stream, struct ncclXml* xml, struct ncclXmlNode* head) {
   struct xmlHandler handlers[] = { { "pci", ncclTopoXmlLoadPci }, { "gpu", ncclTopoXmlLoadGpu }, { "nic", ncclTopoXmlLoadNic} };
-  NCCLCHECK(xmlLoadSub(file, xml, head, handlers, 3));
+  NCCLCHECK(xmlLoadSub(stream, xml, head, handlers, 3));
   return ncclSuccess;
 }
 
-ncclResult_t ncclTopoXmlLoadCpu(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head) {
+ncclResult_t ncclTopoXmlLoadCpu(struct xmlStream* stream, struct ncclXml* xml, struct ncclXmlNode* head) {
   struct xmlHandler handlers[] = { { "pci", ncclTopoXmlLoadPci }, { "nic", ncclTopoXmlLoadNic } };
-  NCCLCHECK(xmlLoadSub(file, xml, head, handlers, 2));
+  NCCLCHECK(xmlLoadSub(stream, xml, head, handlers, 2));
   return ncclSuccess;
 }
 
-ncclResult_t ncclTopoXmlLoadSystem(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head) {
+ncclResult_t ncclTopoXmlLoadSystem(struct xmlStream* stream, struct ncclXml* xml, struct ncclXmlNode* head) {
   int version;
   NCCLCHECK(xmlGetAttrInt(head, "version", &version));
   if (version != NCCL_TOPO_XML_VERSION) {
@@ -296,13 +367,14 @@ ncclResult_t ncclTopoXmlLoadSystem(FILE* file, struct ncclXml* xml, struct ncclX
   else INFO(NCCL_GRAPH, "Loading unnamed topology");
 
   struct xmlHandler handlers[] = { { "cpu", ncclTopoXmlLoadCpu } };
-  NCCLCHECK(xmlLoadSub(file, xml, head, handlers, 1));
+  NCCLCHECK(xmlLoadSub(stream, xml, head, handlers, 1));
   return ncclSuccess;
 }
 
 ncclResult_t ncclTopoGetXmlFromFile(const char* xmlTopoFile, struct ncclXml* xml, int warn) {
-  FILE* file = fopen(xmlTopoFile, "r");
-  if (file == NULL) {
+  ncclResult_t ret = ncclSuccess;
+  struct xmlStream stream;
+  if (xmlStreamOpen(xmlTopoFile, &stream) != 0) {
     if (warn) {
       WARN("Could not open XML topology file %s : %s", xmlTopoFile, strerror(errno));
     }
@@ -311,9 +383,10 @@ ncclResult_t ncclTopoGetXmlFromFile(const char* xmlTopoFile, struct ncclXml* xml
   INFO(NCCL_GRAPH, "Loading topology file %s", xmlTopoFile);
   struct xmlHandler handlers[] = { { "system", ncclTopoXmlLoadSystem } };
   xml->maxIndex = 0;
-  NCCLCHECK(xmlLoadSub(file, xml, NULL, handlers, 1));
-  fclose(file);
-  return ncclSuccess;
+  NCCLCHECKGOTO(xmlLoadSub(&stream, xml, NULL, handlers, 1), ret, exit);
+exit:
+  xmlStreamClose(&stream);
+  return ret;
 }
 
 /**********************/
@@ -798,29 +871,29 @@ ncclResult_t ncclTopoTrimXml(struct ncclXml* xml) {
 /* Parser rules for the user-defined graph search */
 /**************************************************/
 
-ncclResult_t ncclTopoXmlGraphLoadGpu(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head) {
-  NCCLCHECK(xmlLoadSub(file, xml, head, NULL, 0));
+ncclResult_t ncclTopoXmlGraphLoadGpu(struct xmlStream* stream, struct ncclXml* xml, struct ncclXmlNode* head) {
+  NCCLCHECK(xmlLoadSub(stream, xml, head, NULL, 0));
   return ncclSuccess;
 }
 
-ncclResult_t ncclTopoXmlGraphLoadNet(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head) {
-  NCCLCHECK(xmlLoadSub(file, xml, head, NULL, 0));
+ncclResult_t ncclTopoXmlGraphLoadNet(struct xmlStream* stream, struct ncclXml* xml, struct ncclXmlNode* head) {
+  NCCLCHECK(xmlLoadSub(stream, xml, head, NULL, 0));
   return ncclSuccess;
 }
 
-ncclResult_t ncclTopoXmlGraphLoadChannel(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head) {
+ncclResult_t ncclTopoXmlGraphLoadChannel(struct xmlStream* stream, struct ncclXml* xml, struct ncclXmlNode* head) {
   struct xmlHandler handlers[] = { { "net", ncclTopoXmlGraphLoadNet }, { "gpu", ncclTopoXmlGraphLoadGpu } };
-  NCCLCHECK(xmlLoadSub(file, xml, head, handlers, 2));
+  NCCLCHECK(xmlLoadSub(stream, xml, head, handlers, 2));
   return ncclSuccess;
 }
 
-ncclResult_t ncclTopoXmlGraphLoadGraph(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head) {
+ncclResult_t ncclTopoXmlGraphLoadGraph(struct xmlStream* stream, struct ncclXml* xml, struct ncclXmlNode* head) {
   struct xmlHandler handlers[] = { { "channel", ncclTopoXmlGraphLoadChannel } };
-  NCCLCHECK(xmlLoadSub(file, xml, head, handlers, 1));
+  NCCLCHECK(xmlLoadSub(stream, xml, head, handlers, 1));
   return ncclSuccess;
 }
 
-ncclResult_t ncclTopoXmlGraphLoadGraphs(FILE* file, struct ncclXml* xmlGraph, struct ncclXmlNode* head) {
+ncclResult_t ncclTopoXmlGraphLoadGraphs(struct xmlStream* stream, struct ncclXml* xmlGraph, struct ncclXmlNode* head) {
   int version;
   NCCLCHECK(xmlGetAttrInt(head, "version", &version));
   if (version != NCCL_GRAPH_XML_VERSION) {
@@ -833,19 +906,21 @@ ncclResult_t ncclTopoXmlGraphLoadGraphs(FILE* file, struct ncclXml* xmlGraph, st
   else INFO(NCCL_GRAPH, "Loading graphs");
 
   struct xmlHandler handlers[] = { { "graph", ncclTopoXmlGraphLoadGraph } };
-  NCCLCHECK(xmlLoadSub(file, xmlGraph, head, handlers, 1));
+  NCCLCHECK(xmlLoadSub(stream, xmlGraph, head, handlers, 1));
   return ncclSuccess;
 }
 
 ncclResult_t ncclTopoGetXmlGraphFromFile(const char* xmlGraphFile, struct ncclXml* xml) {
-  FILE* file = fopen(xmlGraphFile, "r");
-  if (file == NULL) {
+  ncclResult_t ret = ncclSuccess;
+  struct xmlStream stream;
+  if (xmlStreamOpen(xmlGraphFile, &stream) != 0) {
     WARN("Could not open XML graph file %s : %s", xmlGraphFile, strerror(errno));
     return ncclSystemError;
   }
   struct xmlHandler handlers[] = { { "graphs", ncclTopoXmlGraphLoadGraphs } };
   xml->maxIndex = 0;
-  NCCLCHECK(xmlLoadSub(file, xml, NULL, handlers, 1));
-  fclose(file);
-  return ncclSuccess;
+  NCCLCHECKGOTO(xmlLoadSub(&stream, xml, NULL, handlers, 1), ret, exit);
+exit:
+  xmlStreamClose(&stream);
+  return ret;
 }
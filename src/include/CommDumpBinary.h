@@ -0,0 +1,203 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+#ifndef COMM_DUMP_BINARY_H
+#define COMM_DUMP_BINARY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Binary dump of a communicator returned by ncclCommDumpBinary.
+//
+// A header followed by arrays of fixed-size records, in this order:
+//   CollTrace past, pending and current (0 or 1) collectives
+//   ProxyTrace past and active collectives, and active operations
+//   ctran peers with outstanding operations
+// Enums (coll, datatype, algorithm...) are stored as their NCCL values and
+// timestamps as nanoseconds since the clock epoch. Record sizes are stored in
+// the header, so that a reader can skip fields added by newer versions.
+
+#define COMM_DUMP_BINARY_MAGIC "NCCLCDB"
+#define COMM_DUMP_BINARY_VERSION 1
+
+enum CommDumpBinaryFlags : uint32_t {
+  COMM_DUMP_BINARY_COLLTRACE = 1,
+  COMM_DUMP_BINARY_PROXYTRACE = 2,
+  COMM_DUMP_BINARY_CURRENT_COLL = 4,
+  COMM_DUMP_BINARY_CTRAN = 8,
+};
+
+struct CommDumpBinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t commHash;
+  int32_t rank;
+  // CommDumpBinaryFlags
+  uint32_t flags;
+  // Past collectives are numbered from 0 in completion order. Those in the
+  // dump are numbered from *Since (or *NDropped if more recent, i.e. some were
+  // dropped before being dumped) to *NRecords - 1.
+  uint64_t ctPastCollsSince;
+  uint64_t ctPastCollsNRecords;
+  uint64_t ctPastCollsNDropped;
+  uint64_t ptPastCollsSince;
+  uint64_t ptPastCollsNRecords;
+  uint64_t ptPastCollsNDropped;
+  uint32_t nCtPastColls;
+  uint32_t nCtPendingColls;
+  uint32_t nPtPastColls;
+  uint32_t nPtActiveColls;
+  uint32_t nPtActiveOps;
+  uint32_t collRecordSize;
+  uint32_t proxyCollRecordSize;
+  uint32_t proxyOpRecordSize;
+  int32_t nRanks;
+  uint32_t nCtranPeers;
+  uint32_t ctranPeerRecordSize;
+  uint32_t pad;
+};
+static_assert(sizeof(CommDumpBinaryHeader) == 128, "Keep header fixed-size");
+
+// CollTraceColl
+struct CommDumpCollRecord {
+  uint64_t opCount;
+  int64_t iteration;
+  uint64_t sendbuff;
+  uint64_t recvbuff;
+  uint64_t count;
+  // in milliseconds, -1 if unknown
+  float latency;
+  int32_t root;
+  uint8_t coll;
+  uint8_t datatype;
+  uint8_t redOp;
+  int8_t algorithm;
+  int8_t protocol;
+  int8_t pattern;
+  int16_t channelId;
+  int16_t nChannels;
+  int16_t nThreads;
+  int32_t pad;
+};
+static_assert(sizeof(CommDumpCollRecord) == 64, "Keep records fixed-size");
+
+// ProxyTraceColl
+struct CommDumpProxyCollRecord {
+  uint64_t opCount;
+  // bitmask of channelIds
+  uint64_t channelMask;
+  uint64_t totalSendSize;
+  uint64_t totalRecvSize;
+  int32_t nChannels;
+  int32_t nProxyOps;
+  uint8_t coll;
+  uint8_t pad[7];
+};
+static_assert(sizeof(CommDumpProxyCollRecord) == 48, "Keep records fixed-size");
+
+// ProxyTraceOp
+struct CommDumpProxyOpRecord {
+  uint64_t opCount;
+  uint64_t stepSize;
+  uint64_t transSize;
+  int64_t startTs;
+  int64_t doneTs;
+  // step and timestamp of each ProxyOpStepStatus
+  int64_t stepTs[4];
+  int32_t step[4];
+  int32_t channelId;
+  int32_t proxyOpId;
+  int32_t nSteps;
+  int32_t rank;
+  int32_t remoteRank;
+  // ProxyTraceOp::OpType
+  uint8_t opType;
+  uint8_t done;
+  uint8_t pad[2];
+};
+static_assert(sizeof(CommDumpProxyOpRecord) == 112, "Keep records fixed-size");
+
+// CtranMapperPeerPending
+struct CommDumpCtranPeerRecord {
+  int32_t peer;
+  int32_t sendCtrl;
+  int32_t recvCtrl;
+  int32_t put;
+  uint8_t waitNotify;
+  uint8_t pad[3];
+};
+static_assert(sizeof(CommDumpCtranPeerRecord) == 20, "Keep records fixed-size");
+
+// Reader of a binary dump, for tools and tests
+class CommDumpBinaryReader {
+ public:
+  // Return false if buf is not a valid dump
+  bool parse(const std::string& buf) {
+    if (buf.size() < sizeof(header_)) {
+      return false;
+    }
+    memcpy(&header_, buf.data(), sizeof(header_));
+    if (strncmp(header_.magic, COMM_DUMP_BINARY_MAGIC, sizeof(header_.magic)) ||
+        header_.version != COMM_DUMP_BINARY_VERSION ||
+        header_.headerSize < sizeof(header_) ||
+        header_.headerSize > buf.size()) {
+      return false;
+    }
+    size_t offset = header_.headerSize;
+    uint32_t nCurrent = header_.flags & COMM_DUMP_BINARY_CURRENT_COLL ? 1 : 0;
+    return read(buf, offset, header_.nCtPastColls, header_.collRecordSize,
+                ctPastColls) &&
+        read(buf, offset, header_.nCtPendingColls, header_.collRecordSize,
+             ctPendingColls) &&
+        read(buf, offset, nCurrent, header_.collRecordSize, ctCurrentColl) &&
+        read(buf, offset, header_.nPtPastColls, header_.proxyCollRecordSize,
+             ptPastColls) &&
+        read(buf, offset, header_.nPtActiveColls,
+             header_.proxyCollRecordSize, ptActiveColls) &&
+        read(buf, offset, header_.nPtActiveOps, header_.proxyOpRecordSize,
+             ptActiveOps) &&
+        read(buf, offset, header_.nCtranPeers, header_.ctranPeerRecordSize,
+             ctranPeers);
+  }
+
+  const CommDumpBinaryHeader& header() const {
+    return header_;
+  }
+
+  std::vector<CommDumpCollRecord> ctPastColls;
+  std::vector<CommDumpCollRecord> ctPendingColls;
+  // empty if no collective is in progress
+  std::vector<CommDumpCollRecord> ctCurrentColl;
+  std::vector<CommDumpProxyCollRecord> ptPastColls;
+  std::vector<CommDumpProxyCollRecord> ptActiveColls;
+  std::vector<CommDumpProxyOpRecord> ptActiveOps;
+  std::vector<CommDumpCtranPeerRecord> ctranPeers;
+
+ private:
+  template <typename T>
+  static bool read(
+      const std::string& buf,
+      size_t& offset,
+      uint32_t n,
+      uint32_t recordSize,
+      std::vector<T>& out) {
+    if (n > 0 && (recordSize == 0 ||
+                  (buf.size() - offset) / recordSize < n)) {
+      return false;
+    }
+    out.resize(n);
+    for (uint32_t i = 0; i < n; i++) {
+      // Fields missing in older versions are zero, newer fields are skipped
+      memset(&out[i], 0, sizeof(T));
+      memcpy(&out[i], buf.data() + offset, std::min<size_t>(recordSize, sizeof(T)));
+      offset += recordSize;
+    }
+    return true;
+  }
+
+  CommDumpBinaryHeader header_{};
+};
+
+#endif
@@ -115,6 +115,24 @@
   } \
 } while (0);
 
+// Check pthread calls, which return the error number instead of setting errno
+#define PTHREADCHECK(statement, name) do { \
+  int retval = (statement); \
+  if (retval != 0) { \
+    WARN("Call to " name " failed: %s", strerror(retval)); \
+    return ncclSystemError; \
+  } \
+} while (0)
+
+#define PTHREADCHECKGOTO(statement, name, RES, label) do { \
+  int retval = (statement); \
+  if (retval != 0) { \
+    WARN("Call to " name " failed: %s", strerror(retval)); \
+    RES = ncclSystemError; \
+    goto label; \
+  } \
+} while (0)
+
 // Propagate errors up
 #define NCCLCHECK(call) do { \
   ncclResult_t RES = call; \
@@ -4,20 +4,82 @@
 #define NCCL_LOGGER_H
 
 #include <nccl_cvars.h>
+#include <sys/uio.h>
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <cstdio>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
+#include <vector>
+
+// Buffer of the messages logged by one thread with NCCL_LOGGER_MODE=ring.
+// Single producer (the logging thread) and single consumer (the logger
+// thread), so neither side takes a lock.
+class NcclLogRing {
+ public:
+  // size is rounded up to a power of two
+  NcclLogRing(size_t size, int tid);
+
+  // Copy the message to the ring. If there is not enough space, drop it and
+  // return false. Only called by the owner thread.
+  bool push(const char* msg, size_t len) noexcept;
+
+  // Point iov (2 entries) to the pending bytes and return their number. Only
+  // called by the logger thread, which then calls release() with the number
+  // of bytes written.
+  size_t pending(struct iovec* iov, int* nIov) const;
+  void release(size_t nBytes);
+
+  size_t used() const {
+    return head_.load(std::memory_order_acquire) -
+        tail_.load(std::memory_order_acquire);
+  }
+  size_t size() const {
+    return size_;
+  }
+  uint64_t dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+  int tid() const {
+    return tid_;
+  }
+
+  // Called when the owner thread exits
+  void close() {
+    closed_.store(true, std::memory_order_release);
+  }
+  bool closed() const {
+    return closed_.load(std::memory_order_acquire);
+  }
+
+  // Dropped messages already reported in the log, updated by the logger thread
+  uint64_t reportedDropped{0};
+
+ private:
+  std::unique_ptr<char[]> buf_;
+  size_t size_;
+  int tid_;
+  // bytes ever pushed, written by the owner thread
+  alignas(64) std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> dropped_{0};
+  // bytes ever written to the file, written by the logger thread
+  alignas(64) std::atomic<uint64_t> tail_{0};
+  std::atomic<bool> closed_{false};
+};
 
 class NcclLogger {
  public:
   static void init(FILE* ncclDebugFile);
 
   static void log(const std::string& msg, FILE* ncclDebugFile) noexcept;
+  static void log(const char* msg, size_t len, FILE* ncclDebugFile) noexcept;
+
+  // Number of messages dropped because the ring of their thread was full
+  static uint64_t droppedMessages() noexcept;
 
   NcclLogger(const NcclLogger&) = delete;
   NcclLogger& operator=(const NcclLogger&) = delete;
@@ -26,8 +88,12 @@ class NcclLogger {
  private:
   void stop();
   void logThreadFunc();
+  void ringThreadFunc();
   void writeToFile(const std::string& message);
-  void enqueueLog(const std::string&) noexcept;
+  void enqueueLog(const char* msg, size_t len) noexcept;
+  NcclLogRing* threadRing();
+  // Write the pending messages of the rings to the file
+  void flushRings(std::vector<std::shared_ptr<NcclLogRing>>& rings);
 
   NcclLogger(FILE*);
 
@@ -44,6 +110,14 @@ class NcclLogger {
   std::condition_variable cv_;
   FILE* debugFile;
   std::atomic<bool> stopThread{false};
+
+  // NCCL_LOGGER_MODE=ring. rings_ and removedDropped_ are protected by mutex_,
+  // which is only taken when a thread logs for the first time and by the
+  // logger thread.
+  bool ringMode_{false};
+  std::vector<std::shared_ptr<NcclLogRing>> rings_;
+  // Dropped messages of the rings of exited threads
+  uint64_t removedDropped_{0};
 };
 
 #endif
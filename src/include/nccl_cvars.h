@@ -60,6 +60,20 @@ enum class NCCL_ALLTOALL_ALGO {
 extern enum NCCL_ALLTOALL_ALGO NCCL_ALLTOALL_ALGO;
 extern enum NCCL_ALLTOALL_ALGO NCCL_ALLTOALL_ALGO_DEFAULT;
 
+enum class NCCL_BOOTSTRAP_ALLGATHER_ALGO {
+  adaptive,
+  ring,
+  bruck,
+};
+extern enum NCCL_BOOTSTRAP_ALLGATHER_ALGO NCCL_BOOTSTRAP_ALLGATHER_ALGO;
+extern enum NCCL_BOOTSTRAP_ALLGATHER_ALGO NCCL_BOOTSTRAP_ALLGATHER_ALGO_DEFAULT;
+
+extern int64_t NCCL_BOOTSTRAP_BRUCK_MAX_SIZE;
+extern int64_t NCCL_BOOTSTRAP_BRUCK_MAX_SIZE_DEFAULT;
+
+extern int NCCL_BOOTSTRAP_BRUCK_MIN_RANKS;
+extern int NCCL_BOOTSTRAP_BRUCK_MIN_RANKS_DEFAULT;
+
 extern int64_t NCCL_BUFFSIZE;
 extern int64_t NCCL_BUFFSIZE_DEFAULT;
 
@@ -81,9 +95,39 @@ extern int64_t NCCL_COLLNET_NODE_THRESHOLD_DEFAULT;
 extern std::vector<std::string> NCCL_COLLTRACE;
 extern std::vector<std::string> NCCL_COLLTRACE_DEFAULT;
 
+extern int64_t NCCL_COLLTRACE_BINARY_RECORDS;
+extern int64_t NCCL_COLLTRACE_BINARY_RECORDS_DEFAULT;
+
 extern std::string NCCL_COLLTRACE_DIR;
 extern std::string NCCL_COLLTRACE_DIR_DEFAULT;
 
+enum class NCCL_COLLTRACE_FILE_FORMAT {
+  json,
+  binary,
+};
+extern enum NCCL_COLLTRACE_FILE_FORMAT NCCL_COLLTRACE_FILE_FORMAT;
+extern enum NCCL_COLLTRACE_FILE_FORMAT NCCL_COLLTRACE_FILE_FORMAT_DEFAULT;
+
+extern int64_t NCCL_COLLTRACE_RECORD_MAX;
+extern int64_t NCCL_COLLTRACE_RECORD_MAX_DEFAULT;
+
+extern int64_t NCCL_COLLTRACE_RECORD_MAX_BYTES;
+extern int64_t NCCL_COLLTRACE_RECORD_MAX_BYTES_DEFAULT;
+
+extern int64_t NCCL_COLLTRACE_SAMPLE_INTERVAL;
+extern int64_t NCCL_COLLTRACE_SAMPLE_INTERVAL_DEFAULT;
+
+extern int64_t NCCL_COLLTRACE_SAMPLE_RATE;
+extern int64_t NCCL_COLLTRACE_SAMPLE_RATE_DEFAULT;
+
+enum class NCCL_COLLTRACE_SAMPLING {
+  none,
+  fixed,
+  adaptive,
+};
+extern enum NCCL_COLLTRACE_SAMPLING NCCL_COLLTRACE_SAMPLING;
+extern enum NCCL_COLLTRACE_SAMPLING NCCL_COLLTRACE_SAMPLING_DEFAULT;
+
 extern int64_t NCCL_COMM_BLOCKING;
 extern int64_t NCCL_COMM_BLOCKING_DEFAULT;
 
@@ -122,10 +166,20 @@ extern uint64_t NCCL_CTRAN_ALLTOALL_THRESHOLD_DEFAULT;
 
 enum class NCCL_CTRAN_BACKENDS {
   ib,
+  socket,
 };
 extern std::vector<enum NCCL_CTRAN_BACKENDS> NCCL_CTRAN_BACKENDS;
 extern std::vector<enum NCCL_CTRAN_BACKENDS> NCCL_CTRAN_BACKENDS_DEFAULT;
 
+extern int NCCL_CTRAN_GPE_CMD_QUEUE_SIZE;
+extern int NCCL_CTRAN_GPE_CMD_QUEUE_SIZE_DEFAULT;
+
+extern bool NCCL_CTRAN_GPE_LATENCY_STATS;
+extern bool NCCL_CTRAN_GPE_LATENCY_STATS_DEFAULT;
+
+extern int NCCL_CTRAN_GPE_SPIN_USEC;
+extern int NCCL_CTRAN_GPE_SPIN_USEC_DEFAULT;
+
 extern uint64_t NCCL_CTRAN_IB_CTRL_TC;
 extern uint64_t NCCL_CTRAN_IB_CTRL_TC_DEFAULT;
 
@@ -146,6 +200,7 @@ extern int NCCL_CTRAN_NUM_KERNEL_P2PELEMS_DEFAULT;
 
 enum class NCCL_CTRAN_PROFILING {
   none,
+  stats,
   stdout,
   info,
   kineto,
@@ -176,6 +231,18 @@ extern uint64_t NCCL_CTRAN_RING_STEP_DEFAULT;
 extern uint64_t NCCL_CTRAN_SHARED_DEVBUF_SIZE;
 extern uint64_t NCCL_CTRAN_SHARED_DEVBUF_SIZE_DEFAULT;
 
+extern uint64_t NCCL_CTRAN_SOCKET_CHUNK_SIZE;
+extern uint64_t NCCL_CTRAN_SOCKET_CHUNK_SIZE_DEFAULT;
+
+extern int NCCL_CTRAN_SOCKET_NUM_STREAMS;
+extern int NCCL_CTRAN_SOCKET_NUM_STREAMS_DEFAULT;
+
+extern uint64_t NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD;
+extern uint64_t NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD_DEFAULT;
+
+extern int64_t NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD;
+extern int64_t NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD_DEFAULT;
+
 extern std::string NCCL_CTRAN_TOPO_FILE;
 extern std::string NCCL_CTRAN_TOPO_FILE_DEFAULT;
 
@@ -331,10 +398,14 @@ extern int64_t NCCL_LOCAL_REGISTER_DEFAULT;
 enum class NCCL_LOGGER_MODE {
   sync,
   async,
+  ring,
 };
 extern enum NCCL_LOGGER_MODE NCCL_LOGGER_MODE;
 extern enum NCCL_LOGGER_MODE NCCL_LOGGER_MODE_DEFAULT;
 
+extern int64_t NCCL_LOGGER_RING_SIZE;
+extern int64_t NCCL_LOGGER_RING_SIZE_DEFAULT;
+
 extern int64_t NCCL_MAX_CTAS;
 extern int64_t NCCL_MAX_CTAS_DEFAULT;
 
@@ -354,6 +425,20 @@ enum class NCCL_MEM_SYNC_DOMAIN {
 extern enum NCCL_MEM_SYNC_DOMAIN NCCL_MEM_SYNC_DOMAIN;
 extern enum NCCL_MEM_SYNC_DOMAIN NCCL_MEM_SYNC_DOMAIN_DEFAULT;
 
+enum class NCCL_METRICS_EXPORT {
+  none,
+  file,
+  socket,
+};
+extern enum NCCL_METRICS_EXPORT NCCL_METRICS_EXPORT;
+extern enum NCCL_METRICS_EXPORT NCCL_METRICS_EXPORT_DEFAULT;
+
+extern int64_t NCCL_METRICS_INTERVAL_MS;
+extern int64_t NCCL_METRICS_INTERVAL_MS_DEFAULT;
+
+extern std::string NCCL_METRICS_PATH;
+extern std::string NCCL_METRICS_PATH_DEFAULT;
+
 extern int64_t NCCL_MIN_CTAS;
 extern int64_t NCCL_MIN_CTAS_DEFAULT;
 
@@ -456,18 +541,56 @@ extern std::vector<std::string> NCCL_PROXYMOCK_NET_SEND_FAILURE_DEFAULT;
 extern std::vector<std::string> NCCL_PROXYTRACE;
 extern std::vector<std::string> NCCL_PROXYTRACE_DEFAULT;
 
+extern int64_t NCCL_PROXYTRACE_RECORD_MAX;
+extern int64_t NCCL_PROXYTRACE_RECORD_MAX_DEFAULT;
+
+extern int64_t NCCL_PROXYTRACE_RECORD_MAX_BYTES;
+extern int64_t NCCL_PROXYTRACE_RECORD_MAX_BYTES_DEFAULT;
+
+extern int64_t NCCL_PROXYTRACE_RING_SIZE;
+extern int64_t NCCL_PROXYTRACE_RING_SIZE_DEFAULT;
+
+extern int64_t NCCL_PROXYTRACE_TIMELINE_RECORD_MAX;
+extern int64_t NCCL_PROXYTRACE_TIMELINE_RECORD_MAX_DEFAULT;
+
 extern int64_t NCCL_PROXY_APPEND_BATCH_SIZE;
 extern int64_t NCCL_PROXY_APPEND_BATCH_SIZE_DEFAULT;
 
 extern int64_t NCCL_PROXY_DUMP_SIGNAL;
 extern int64_t NCCL_PROXY_DUMP_SIGNAL_DEFAULT;
 
+enum class NCCL_PROXY_IDLE_POLICY {
+  sleep,
+  spin,
+  hybrid,
+};
+extern enum NCCL_PROXY_IDLE_POLICY NCCL_PROXY_IDLE_POLICY;
+extern enum NCCL_PROXY_IDLE_POLICY NCCL_PROXY_IDLE_POLICY_DEFAULT;
+
+extern int64_t NCCL_PROXY_IDLE_SPIN_MAX_NS;
+extern int64_t NCCL_PROXY_IDLE_SPIN_MAX_NS_DEFAULT;
+
+extern int64_t NCCL_PROXY_IDLE_SPIN_MIN_NS;
+extern int64_t NCCL_PROXY_IDLE_SPIN_MIN_NS_DEFAULT;
+
+extern std::string NCCL_PROXY_OP_RECORD_FILE;
+extern std::string NCCL_PROXY_OP_RECORD_FILE_DEFAULT;
+
 extern std::string NCCL_PROXY_PROFILE;
 extern std::string NCCL_PROXY_PROFILE_DEFAULT;
 
 extern std::string NCCL_PROXY_PROFILE_DIR;
 extern std::string NCCL_PROXY_PROFILE_DIR_DEFAULT;
 
+extern bool NCCL_PROXY_PROGRESS_NUMA_PIN;
+extern bool NCCL_PROXY_PROGRESS_NUMA_PIN_DEFAULT;
+
+extern int64_t NCCL_PROXY_PROGRESS_THREADS;
+extern int64_t NCCL_PROXY_PROGRESS_THREADS_DEFAULT;
+
+extern int64_t NCCL_PROXY_RPC_BATCH_SIZE;
+extern int64_t NCCL_PROXY_RPC_BATCH_SIZE_DEFAULT;
+
 extern int64_t NCCL_PXN_DISABLE;
 extern int64_t NCCL_PXN_DISABLE_DEFAULT;
 
@@ -505,6 +628,9 @@ extern std::string NCCL_SOCKET_IFNAME_DEFAULT;
 extern int64_t NCCL_SOCKET_NTHREADS;
 extern int64_t NCCL_SOCKET_NTHREADS_DEFAULT;
 
+extern int64_t NCCL_SOCKET_ZCOPY_THRESHOLD;
+extern int64_t NCCL_SOCKET_ZCOPY_THRESHOLD_DEFAULT;
+
 extern std::string NCCL_THREAD_THRESHOLDS;
 extern std::string NCCL_THREAD_THRESHOLDS_DEFAULT;
 
@@ -517,6 +643,15 @@ extern int64_t NCCL_TOPO_DUMP_FILE_RANK_DEFAULT;
 extern std::string NCCL_TOPO_FILE;
 extern std::string NCCL_TOPO_FILE_DEFAULT;
 
+extern int64_t NCCL_TOPO_SEARCH_CACHE;
+extern int64_t NCCL_TOPO_SEARCH_CACHE_DEFAULT;
+
+extern std::string NCCL_TOPO_SEARCH_CACHE_DIR;
+extern std::string NCCL_TOPO_SEARCH_CACHE_DIR_DEFAULT;
+
+extern int64_t NCCL_TOPO_SEARCH_THREADS;
+extern int64_t NCCL_TOPO_SEARCH_THREADS_DEFAULT;
+
 extern std::string NCCL_TUNER_PLUGIN;
 extern std::string NCCL_TUNER_PLUGIN_DEFAULT;
 
@@ -12,6 +12,10 @@
 #include "socket.h"
 #include "ipcsocket.h"
 #include <pthread.h>
+#include <stdio.h>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include "shm.h"
 #include "p2p.h"
 #include "ProxyTrace.h"
@@ -52,50 +56,59 @@ struct alignas(64) ncclProxyOp {
 // As we add more fields, we can no longer be smaller than 64 bytes, thus just keep alignment
 // static_assert(sizeof(struct ncclProxyOp) == 64, "Keep ProxyOp aligned with cache lines for effective prefetch");
 
-struct ncclProxySubArgs {
+// Fields are ordered by how often progress functions touch them: the step
+// counters of a sub fit in its first cache line, its requests in the second.
+struct alignas(64) ncclProxySubArgs {
   struct ncclProxyConnection* connection;
-  int channelId;
-  int nsteps;
-  ssize_t nbytes;
-  int peer;
-
-  int groupSize; // Number of consecutive sub operations sharing the same recvComm
   uint64_t base;
   uint64_t posted;
   uint64_t received;
   uint64_t flushed;
   uint64_t transmitted;
   uint64_t done;
+  int nsteps;
+  int groupSize; // Number of consecutive sub operations sharing the same recvComm
+
   uint64_t end;
+  ssize_t nbytes;
+  int channelId;
+  int peer;
   void* requests[NCCL_STEPS];
-  void* profilingEvents[NCCL_STEPS];
 
+  // Cold, only used with profiling and tracing
+  void* profilingEvents[NCCL_STEPS];
   struct ProxyTraceArgs traceArgs;
 };
 
-struct ncclProxyArgs {
-  struct ncclProxySubArgs subs[NCCL_PROXY_MAX_SUBS];
+// Subs of an op are allocated separately in arrays of 1 << subsClass elements,
+// most ops have a single sub. The array grows as subs are appended to the op
+// and is kept when the op is freed.
+#define NCCL_PROXY_SUBS_CLASSES 6
+static_assert((1 << (NCCL_PROXY_SUBS_CLASSES-1)) == NCCL_PROXY_MAX_SUBS, "Largest subs class must fit NCCL_PROXY_MAX_SUBS");
+
+struct alignas(64) ncclProxyArgs {
+  // Hot, used on every progress call
+  struct ncclProxySubArgs* subs;
   proxyProgressFunc_t progress;
+  struct ncclProxyArgs* next;
+  struct ncclProxyArgs* nextPeer;
+  int state;
+  int idle;
   int nsubs;
   int done;
   uint64_t opCount;
   int sliceSteps;
   int chunkSteps;
+
   int chunkSize;
   uint8_t /*ncclDataType_t*/ dtype;
   uint8_t /*ncclDevRedOp_t*/ redOp;
   uint8_t /*ncclPattern_t*/ pattern;
   uint8_t protocol;
-  int state;
+  int subsClass;
+  struct ncclProxyArgs** proxyAppendPtr;
   char* sharedBuff[NCCL_STEPS];
   int sharedSize[NCCL_STEPS];
-
-  int idle;
-
-  // Element linking
-  struct ncclProxyArgs* next;
-  struct ncclProxyArgs* nextPeer;
-  struct ncclProxyArgs** proxyAppendPtr;
 };
 #define NCCL_MAX_NETDEVS 128
 
@@ -104,13 +117,28 @@ struct ncclProxyArgs {
 // Otherwise we'd be unable to post half of them to free new elements.
 #define MAX_OPS_PER_PEER (2*MAXCHANNELS*NCCL_MAX_WORK_ELEMENTS_P2P)
 #define NCCL_MAX_LOCAL_RANKS 64
+
+// Wakeup of an idle progress thread waiting for new ops, see
+// NCCL_PROXY_IDLE_POLICY. Lives in shared memory for the ops pool, so it only
+// relies on a process-shared futex.
+struct ncclProxyWakeup {
+  // Futex word, bumped on every wake
+  volatile uint32_t seq;
+  // Set while the progress thread sleeps on seq, so that posters only make
+  // the wake syscall when needed
+  volatile int sleeping;
+  // clockNano() of the last wake of a sleeping thread
+  volatile uint64_t wakeTs;
+};
+
 struct ncclProxyOpsPool {
   struct ncclProxyOp ops[MAX_OPS_PER_PEER*NCCL_MAX_LOCAL_RANKS];
-  volatile int nextOps;
-  volatile int nextOpsEnd;
+  // Ops posted by the main threads of all local ranks and not taken yet by
+  // the progress thread, or -1. A lock-free stack linked through ops[].next
+  // onto which each post pushes its chain in reverse order, see ncclProxyPost.
+  volatile int postedOps;
   volatile int freeOps[NCCL_MAX_LOCAL_RANKS];
-  pthread_mutex_t mutex;
-  pthread_cond_t cond;
+  struct ncclProxyWakeup wakeup;
 };
 
 struct ncclProxyOps {
@@ -144,7 +172,8 @@ struct ncclSharedNetComms {
   int recvRefCount[MAXCHANNELS];
 };
 
-struct ncclProxyPool;
+struct ncclProxySlab;
+struct ncclProxySubsFree;
 struct ncclProxyProgressState {
   // Used by main threads to send work to progress thread
   struct ncclProxyOpsPool* opsPool;
@@ -156,18 +185,92 @@ struct ncclProxyProgressState {
   struct ncclProxyPeer** localPeers;
   struct ncclSharedNetComms* netComms[NCCL_MAX_NETDEVS];
   struct ncclProxyArgs* active;
+  // Free ops, and free arrays of subs of each class, see allocateArgs
   struct ncclProxyArgs* pool;
-  struct ncclProxyPool* pools;
+  struct ncclProxySubsFree* freeSubs[NCCL_PROXY_SUBS_CLASSES];
+  // Slabs backing all ops and subs, released with the state
+  struct ncclProxySlab* slabs;
   int nextOps;
+  // Ops recorded for tests/ProxyReplayBench, see NCCL_PROXY_OP_RECORD_FILE
+  FILE* opRecordFile;
+
+  // Progress threads of the proxy, see NCCL_PROXY_PROGRESS_THREADS. Shard 0
+  // is the thread owning this state, which reads the ops pool and routes the
+  // ops of the other shards to them.
+  int nShards;
+  struct ncclProxyProgressShard* shards;
+  // Shard progressing the net connections of each net device
+  int netDevShard[NCCL_MAX_NETDEVS];
+};
+
+// Idle wait counters of a progress thread, see NCCL_PROXY_IDLE_POLICY. Only
+// written by the progress thread, read when exporting metrics.
+struct ncclProxyIdleStats {
+  // Idle waits starting with a spin, of which ops arrived while spinning,
+  // and total time spent spinning
+  std::atomic<uint64_t> spins{0};
+  std::atomic<uint64_t> spinHits{0};
+  std::atomic<uint64_t> spinNs{0};
+  // Idle waits sleeping on the futex, and wakes of the thread by posters
+  std::atomic<uint64_t> sleeps{0};
+  std::atomic<uint64_t> wakeups{0};
+  // Time from a wake call to the woken thread running, summed over wakeups
+  std::atomic<uint64_t> wakeLatencyNs{0};
+  std::atomic<uint64_t> maxWakeLatencyNs{0};
+  // Current spin time before sleeping with the hybrid policy
+  std::atomic<uint64_t> spinWindowNs{0};
 };
 
-// Expected proxy response fifo
+struct ncclProxyProgressShard {
+  struct ncclProxyState* proxyState;
+  int id;
+  // CPUs local to the NICs of the shard, empty to keep the inherited affinity
+  cpu_set_t affinity;
+  // Active ops and args pools of the shard, or the proxy progressState for
+  // shard 0. The other shards only use active, pool, pools, thread and stop.
+  struct ncclProxyProgressState* state;
+
+  // Shared with the metrics collector, which may outlive the shard
+  std::shared_ptr<struct ncclProxyIdleStats> idleStats;
+
+  // Ops routed to the shard by shard 0, protected by mutex. nQueued is the
+  // size of queue, also read without the lock by the idle shard.
+  pthread_mutex_t mutex;
+  std::vector<struct ncclProxyOp> queue;
+  volatile int nQueued;
+  struct ncclProxyWakeup wakeup;
+  // Ops routed to the shard by the current ncclProxyGetPostedOps call, only
+  // accessed by shard 0
+  std::vector<struct ncclProxyOp> staged;
+};
+
+// Expected proxy response, a slot of the response table. Slots with a NULL
+// opId are free.
 struct ncclExpectedProxyResponse {
   void*    opId;
   int      respSize;
   bool     done;
   void*    respBuff;
-  struct   ncclExpectedProxyResponse* next;
+};
+
+// Expected responses from the proxy, open-addressed by opId
+struct ncclExpectedProxyResponses {
+  struct ncclExpectedProxyResponse* slots;
+  int size; // Power of 2
+  int count;
+};
+
+// Proxy call queued by ncclProxyConnectDeferred/ncclProxyCallDeferred, its
+// address is the opId of the call
+struct ncclProxyDeferredCall {
+  struct ncclProxyConnector* proxyConn;
+  int type;
+  int transport, send; // ncclProxyMsgInit only
+  int reqSize, respSize;
+  char* reqBuff;
+  void* respBuff;
+  int sent;
+  struct ncclProxyDeferredCall* next;
 };
 
 struct ncclProxyAsyncOp {
@@ -177,6 +280,7 @@ struct ncclProxyAsyncOp {
   char *reqBuff, *respBuff;
   void* opId;
   ncclProxyAsyncOp* next;
+  ncclProxyAsyncOp* prev;
 };
 
 struct ncclProxyLocalPeer {
@@ -184,7 +288,12 @@ struct ncclProxyLocalPeer {
   int tpRank;
   int tpLocalRank;
   ncclProxyAsyncOp* asyncOps;
+  ncclProxyAsyncOp* asyncOpsTail;
   int asyncOpCounter;
+  // Responses of the ops completed in this service loop iteration, sent at
+  // once at the end of the iteration
+  char* respBuff;
+  int respBuffSize, respBuffMax;
 };
 
 struct ncclProxyState {
@@ -218,10 +327,17 @@ struct ncclProxyState {
   // Progress thread
   struct ncclProxyProgressState progressState;
 
-  // Queue of expected responses from the proxy
-  struct ncclExpectedProxyResponse* expectedResponses;
+  // Table of expected responses from the proxy
+  struct ncclExpectedProxyResponses expectedResponses;
+  // Queue of deferred proxy calls, and number and bytes of them sent
+  struct ncclProxyDeferredCall* deferredCalls;
+  struct ncclProxyDeferredCall* deferredCallsTail;
+  int nDeferredSent;
+  size_t nDeferredBytes;
 
   std::unique_ptr<ProxyTrace> trace{nullptr};
+  // NcclMetrics collector of the idle counters of the progress threads, or -1
+  int metricsCollectorId;
 };
 
 enum proxyConnectState {
@@ -241,6 +357,8 @@ struct ncclProxyConnection {
   struct ncclProxyArgs *proxyAppend;
   struct ncclProxyArgs **proxyAppendPtr;
   void* transportResources;
+  // Net device of net transport connections, to route their ops to a progress shard
+  int netDev;
   proxyConnectState state;
   struct ncclCollNetSharedRes* collNet;
 };
@@ -256,7 +374,22 @@ enum proxyMode {
 ncclResult_t ncclProxySaveOp(struct ncclComm* comm, struct ncclProxyOp* proxyOp, bool *justInquire);
 ncclResult_t ncclProxyComputeP2p(struct ncclInfo* info, struct ncclProxyOp* proxyOp);
 ncclResult_t ncclProxyStart(struct ncclComm* comm);
+// Post the chain of ops nextOps..nextOpsEnd, linked through next, to the
+// progress thread. Lock-free, called concurrently by the main threads of the
+// local ranks, possibly from other processes.
+ncclResult_t ncclProxyPost(struct ncclProxyOpsPool* pool, int nextOps, int nextOpsEnd);
+// Take all the ops posted so far, linked in posting order. Returns the first
+// one or -1. Only called by the progress thread.
+int ncclProxyTakePostedOps(struct ncclProxyOpsPool* pool);
+// Append an op to the active ops of a progress state, progress all of them
+// once, and release the memory of the ops once none is active. Only called
+// by progress threads, and by tests/ProxyReplayBench.
+ncclResult_t ncclProxyAppendOp(struct ncclProxyProgressState* state, struct ncclProxyOp* op);
+ncclResult_t ncclProxyProgressOps(struct ncclProxyState* proxyState, struct ncclProxyProgressState* state, int* idle);
+void ncclProxyFreeOps(struct ncclProxyProgressState* state);
 ncclResult_t ncclProxyInit(struct ncclComm* comm, struct ncclSocket* sock, union ncclSocketAddress* peerAddresses);
+// Main function of the proxy service thread, started by ncclProxyCreate() or by tests/ProxyRpcBench
+void* ncclProxyService(void* _args);
 ncclResult_t ncclProxyCreate(struct ncclComm* comm);
 ncclResult_t ncclProxyConnect(struct ncclComm* comm, int transport, int send, int proxyRank, struct ncclProxyConnector* proxyConn);
 enum ncclProxyMsgType {
@@ -280,6 +413,17 @@ ncclResult_t ncclProxyCallAsync(struct ncclComm* comm, struct ncclProxyConnector
 ncclResult_t ncclProxyCallBlocking(struct ncclComm* comm, struct ncclProxyConnector* proxyConn, int type, void* reqBuff, int reqSize, void* respBuff, int respSize);
 ncclResult_t ncclPollProxyResponse(struct ncclComm* comm, struct ncclProxyConnector* proxyConn, void* respBuff, void* opId);
 
+// Pipelined variants of ncclProxyConnect and ncclProxyCallBlocking. Calls are only queued, and
+// sent NCCL_PROXY_RPC_BATCH_SIZE at a time per proxy by ncclProxyDeferredWait(), which returns once
+// all responses are received. Calls on a connector wait for its ncclProxyMsgInit response to be
+// sent. reqBuff is copied, proxyConn and respBuff must remain valid until ncclProxyDeferredWait().
+ncclResult_t ncclProxyConnectDeferred(struct ncclComm* comm, int transport, int send, int proxyRank, struct ncclProxyConnector* proxyConn);
+ncclResult_t ncclProxyCallDeferred(struct ncclComm* comm, struct ncclProxyConnector* proxyConn, int type, void* reqBuff, int reqSize, void* respBuff, int respSize);
+ncclResult_t ncclProxyDeferredWait(struct ncclComm* comm);
+// Drop the deferred calls not completed, e.g. on a setup error before ncclProxyDeferredWait(), so
+// none refers to a proxyConn or respBuff of the caller anymore.
+void ncclProxyDeferredDiscard(struct ncclComm* comm);
+
 ncclResult_t ncclProxyClientConvertFdBlocking(struct ncclComm* comm, struct ncclProxyConnector* proxyConn, int fd, int* convertedFd);
 
 ncclResult_t ncclProxyStop(struct ncclComm* comm);
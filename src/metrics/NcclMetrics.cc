@@ -0,0 +1,282 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include "NcclMetrics.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include "NcclMetricsExporter.h"
+#include "debug.h"
+#include "nccl_cvars.h"
+
+/*
+=== BEGIN_NCCL_CVAR_INFO_BLOCK ===
+
+ - name        : NCCL_METRICS_EXPORT
+   type        : enum
+   default     : none
+   choices     : none, file, socket
+   description : |-
+     Export NCCL metrics (collective latency percentiles from CollTrace,
+     ctran put latency from CtranMapper, IB traffic...) in the Prometheus
+     text format, so that scrapers can poll them while running.
+     none   - No metrics are collected
+     file   - Rewrite the file NCCL_METRICS_PATH every
+              NCCL_METRICS_INTERVAL_MS milliseconds
+     socket - Listen on the Unix socket NCCL_METRICS_PATH and write the
+              metrics to every client connecting to it
+     Collective latency also requires NCCL_COLLTRACE to be set.
+
+ - name        : NCCL_METRICS_PATH
+   type        : string
+   default     : ""
+   description : |-
+     Path of the file or Unix socket of NCCL_METRICS_EXPORT. %p is replaced
+     by the process id. Defaults to /tmp/nccl_metrics.<pid>.prom for file and
+     /tmp/nccl_metrics.<pid>.sock for socket.
+
+ - name        : NCCL_METRICS_INTERVAL_MS
+   type        : int64_t
+   default     : 1000
+   description : |-
+     Interval in milliseconds between two writes of the metrics file with
+     NCCL_METRICS_EXPORT=file.
+
+=== END_NCCL_CVAR_INFO_BLOCK ===
+*/
+
+constexpr uint64_t NcclMetricHistogram::kSubBuckets;
+constexpr uint64_t NcclMetricHistogram::kMaxValue;
+constexpr size_t NcclMetricHistogram::kNumBuckets;
+
+void NcclMetricHistogram::record(uint64_t val) noexcept {
+  buckets_[bucketIndex(val)].fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(val, std::memory_order_relaxed);
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (val > max &&
+         !max_.compare_exchange_weak(max, val, std::memory_order_relaxed)) {
+  }
+  // Last so that an exporter reading count first never sees more values than
+  // buckets
+  count_.fetch_add(1, std::memory_order_release);
+}
+
+NcclMetricHistogramSnapshot NcclMetricHistogram::snapshot() const {
+  NcclMetricHistogramSnapshot snap;
+  snap.count = count_.load(std::memory_order_acquire);
+  snap.sum = sum_.load(std::memory_order_relaxed);
+  snap.max = max_.load(std::memory_order_relaxed);
+  snap.buckets.resize(kNumBuckets);
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    snap.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  return snap;
+}
+
+uint64_t NcclMetricHistogramSnapshot::quantile(double q) const {
+  uint64_t total = 0;
+  for (auto n : buckets) {
+    total += n;
+  }
+  if (buckets.size() != NcclMetricHistogram::kNumBuckets) {
+    return 0;
+  }
+  return NcclMetricHistogram::Buckets::quantile(
+      buckets.data(), total, q, 0, max);
+}
+
+bool NcclMetrics::enabled() noexcept {
+  return NCCL_METRICS_EXPORT != NCCL_METRICS_EXPORT::none;
+}
+
+NcclMetrics& NcclMetrics::getInstance() {
+  static NcclMetrics metrics;
+  return metrics;
+}
+
+NcclMetrics::NcclMetrics() {
+  if (enabled()) {
+    exporter_ = NcclMetricsExporter::create(this);
+  }
+}
+
+NcclMetrics::~NcclMetrics() {
+  // Stop the exporter thread before the metrics are freed
+  exporter_.reset();
+}
+
+static std::string metricKey(
+    const std::string& name,
+    const NcclMetricLabels& labels) {
+  std::string key = name;
+  for (auto& label : labels) {
+    key += '\0' + label.first + '\0' + label.second;
+  }
+  return key;
+}
+
+NcclMetrics::Metric& NcclMetrics::getMetric(
+    const std::string& name,
+    const NcclMetricLabels& labels) {
+  auto& metric = metrics_[metricKey(name, labels)];
+  if (metric.name.empty()) {
+    metric.name = name;
+    metric.labels = labels;
+  }
+  return metric;
+}
+
+std::shared_ptr<NcclMetricCounter> NcclMetrics::counter(
+    const std::string& name,
+    const NcclMetricLabels& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& metric = getMetric(name, labels);
+  if (!metric.counter) {
+    metric.counter = std::make_shared<NcclMetricCounter>();
+  }
+  return metric.counter;
+}
+
+std::shared_ptr<NcclMetricHistogram> NcclMetrics::histogram(
+    const std::string& name,
+    const NcclMetricLabels& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& metric = getMetric(name, labels);
+  if (!metric.histogram) {
+    metric.histogram = std::make_shared<NcclMetricHistogram>();
+  }
+  return metric.histogram;
+}
+
+void NcclMetrics::removeMetrics(
+    const std::string& namePrefix,
+    const NcclMetricLabels& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = metrics_.begin(); it != metrics_.end();) {
+    auto& metric = it->second;
+    bool match = metric.name.compare(0, namePrefix.size(), namePrefix) == 0 &&
+        std::all_of(
+                     labels.begin(),
+                     labels.end(),
+                     [&](const std::pair<std::string, std::string>& label) {
+                       return std::find(
+                                  metric.labels.begin(),
+                                  metric.labels.end(),
+                                  label) != metric.labels.end();
+                     });
+    it = match ? metrics_.erase(it) : std::next(it);
+  }
+}
+
+int NcclMetrics::addCollector(Collector collector) {
+  std::lock_guard<std::mutex> lock(collectorsMutex_);
+  int id = nextCollectorId_++;
+  collectors_[id] = std::move(collector);
+  return id;
+}
+
+void NcclMetrics::removeCollector(int id) {
+  // Collectors run with the lock held, so none is running once we get it
+  std::lock_guard<std::mutex> lock(collectorsMutex_);
+  collectors_.erase(id);
+}
+
+static void writeLabels(
+    std::ostringstream& ss,
+    const NcclMetricLabels& labels,
+    const char* quantile = nullptr) {
+  if (labels.empty() && !quantile) {
+    return;
+  }
+  ss << '{';
+  const char* sep = "";
+  for (auto& label : labels) {
+    ss << sep << label.first << "=\"";
+    for (char c : label.second) {
+      if (c == '"' || c == '\\') {
+        ss << '\\';
+      }
+      ss << (c == '\n' ? ' ' : c);
+    }
+    ss << '"';
+    sep = ",";
+  }
+  if (quantile) {
+    ss << sep << "quantile=\"" << quantile << '"';
+  }
+  ss << '}';
+}
+
+std::string NcclMetrics::exportText() {
+  std::vector<Metric> metrics;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    metrics.reserve(metrics_.size());
+    for (auto& it : metrics_) {
+      metrics.push_back(it.second);
+    }
+  }
+
+  std::vector<NcclMetricSample> samples;
+  {
+    std::lock_guard<std::mutex> lock(collectorsMutex_);
+    for (auto& it : collectors_) {
+      it.second(samples);
+    }
+  }
+  std::stable_sort(
+      samples.begin(),
+      samples.end(),
+      [](const NcclMetricSample& a, const NcclMetricSample& b) {
+        return a.name < b.name;
+      });
+
+  static const std::vector<std::pair<const char*, double>> quantiles = {
+      {"0.5", 0.5}, {"0.9", 0.9}, {"0.99", 0.99}, {"0.999", 0.999}};
+
+  std::ostringstream ss;
+  std::string lastName;
+  for (auto& metric : metrics) {
+    if (metric.counter) {
+      if (metric.name != lastName) {
+        ss << "# TYPE " << metric.name << " counter\n";
+      }
+      ss << metric.name;
+      writeLabels(ss, metric.labels);
+      ss << ' ' << metric.counter->value() << '\n';
+    } else if (metric.histogram) {
+      if (metric.name != lastName) {
+        ss << "# TYPE " << metric.name << " summary\n";
+      }
+      auto snap = metric.histogram->snapshot();
+      for (auto& q : quantiles) {
+        ss << metric.name;
+        writeLabels(ss, metric.labels, q.first);
+        ss << ' ' << snap.quantile(q.second) << '\n';
+      }
+      ss << metric.name;
+      writeLabels(ss, metric.labels, "1");
+      ss << ' ' << snap.max << '\n';
+      ss << metric.name << "_sum";
+      writeLabels(ss, metric.labels);
+      ss << ' ' << snap.sum << '\n';
+      ss << metric.name << "_count";
+      writeLabels(ss, metric.labels);
+      ss << ' ' << snap.count << '\n';
+    }
+    lastName = metric.name;
+  }
+  lastName.clear();
+  for (auto& sample : samples) {
+    if (sample.name != lastName) {
+      ss << "# TYPE " << sample.name << ' '
+         << (sample.type == NcclMetricSample::Type::COUNTER ? "counter"
+                                                             : "gauge")
+         << '\n';
+    }
+    ss << sample.name;
+    writeLabels(ss, sample.labels);
+    ss << ' ' << sample.value << '\n';
+    lastName = sample.name;
+  }
+  return ss.str();
+}
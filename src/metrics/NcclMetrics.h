@@ -0,0 +1,264 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+#ifndef NCCL_METRICS_H
+#define NCCL_METRICS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// In-process metrics registry, exported with NCCL_METRICS_EXPORT.
+//
+// Subsystems (CollTrace, CtranMapper...) get counters and histograms from the
+// registry once and keep the returned pointers, so that publishing a value is
+// a few relaxed atomic operations and never takes a lock. The registry lock
+// is only taken to create or remove metrics and to export them. Values that
+// are already tracked elsewhere (e.g. IB traffic) are pulled at export time
+// by collectors instead.
+//
+// Metrics are exported in the Prometheus text format, either to a file
+// rewritten periodically or to a Unix socket that returns a snapshot to every
+// client connecting to it.
+
+// Labels of a metric, in the order they are exported
+using NcclMetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+class NcclMetricCounter {
+ public:
+  void add(uint64_t val) noexcept {
+    value_.fetch_add(val, std::memory_order_relaxed);
+  }
+  uint64_t value() const noexcept {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+// Log-linear buckets of non-negative integer values, shared by the histograms
+// of the registry and of other subsystems (e.g. CtranMapper peer stats). Each
+// power of two is split in 2^SubBucketBits linear buckets, so a value is known
+// within 1/2^SubBucketBits of itself. Values above kMaxValue fall in the last
+// bucket.
+template <int SubBucketBits, int MaxValueBits>
+struct NcclMetricBuckets {
+  static constexpr uint64_t kSubBuckets = 1UL << SubBucketBits;
+  static constexpr uint64_t kMaxValue = (1UL << MaxValueBits) - 1;
+  static constexpr size_t kNumBuckets =
+      (MaxValueBits - SubBucketBits + 1) * kSubBuckets;
+
+  static size_t index(uint64_t val) noexcept {
+    if (val > kMaxValue) {
+      val = kMaxValue;
+    }
+    if (val < kSubBuckets) {
+      return val;
+    }
+    int exp = 63 - __builtin_clzl(val);
+    int shift = exp - SubBucketBits;
+    return kSubBuckets * (shift + 1) + ((val >> shift) & (kSubBuckets - 1));
+  }
+
+  // Smallest and largest values counted in a bucket
+  static uint64_t low(size_t idx) noexcept {
+    if (idx < kSubBuckets) {
+      return idx;
+    }
+    int shift = idx / kSubBuckets - 1;
+    return (kSubBuckets + idx % kSubBuckets) << shift;
+  }
+  static uint64_t high(size_t idx) noexcept {
+    if (idx < kSubBuckets) {
+      return idx;
+    }
+    int shift = idx / kSubBuckets - 1;
+    return low(idx) + (1UL << shift) - 1;
+  }
+
+  // Value of quantile q in [0, 1] of the total values counted in buckets,
+  // bounded by the smallest and largest recorded values. 0 if total is 0.
+  template <typename Count>
+  static uint64_t quantile(
+      const Count* buckets,
+      uint64_t total,
+      double q,
+      uint64_t min,
+      uint64_t max) {
+    if (total == 0) {
+      return 0;
+    }
+    // Rank of the value, counted from 1
+    q = std::min(std::max(q, 0.0), 1.0);
+    uint64_t rank =
+        std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kNumBuckets; i++) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        // The last bucket also counts the values above kMaxValue
+        return i == kNumBuckets - 1 ? max
+                                    : std::min(std::max(high(i), min), max);
+      }
+    }
+    return max;
+  }
+};
+
+template <int SubBucketBits, int MaxValueBits>
+constexpr uint64_t NcclMetricBuckets<SubBucketBits, MaxValueBits>::kSubBuckets;
+template <int SubBucketBits, int MaxValueBits>
+constexpr uint64_t NcclMetricBuckets<SubBucketBits, MaxValueBits>::kMaxValue;
+template <int SubBucketBits, int MaxValueBits>
+constexpr size_t NcclMetricBuckets<SubBucketBits, MaxValueBits>::kNumBuckets;
+
+// Percentiles and totals of a histogram at some point in time
+struct NcclMetricHistogramSnapshot {
+  uint64_t count{0};
+  uint64_t sum{0};
+  uint64_t max{0};
+  // Value of the given quantile in [0, 1], with the relative precision of the
+  // histogram buckets. 0 if the histogram is empty.
+  uint64_t quantile(double q) const;
+
+  std::vector<uint64_t> buckets;
+};
+
+// HDR-style histogram of non-negative integer values. Each power of two is
+// split in kSubBuckets linear buckets, so a value is known within 1/16 of
+// itself over the whole range at a fixed memory cost. Values above kMaxValue
+// are counted in the last bucket (max and sum stay exact).
+class NcclMetricHistogram {
+ public:
+  using Buckets = NcclMetricBuckets<4, 40>;
+  static constexpr uint64_t kSubBuckets = Buckets::kSubBuckets;
+  static constexpr uint64_t kMaxValue = Buckets::kMaxValue;
+  static constexpr size_t kNumBuckets = Buckets::kNumBuckets;
+
+  static size_t bucketIndex(uint64_t val) noexcept {
+    return Buckets::index(val);
+  }
+  // Smallest and largest values counted in a bucket
+  static uint64_t bucketLow(size_t idx) noexcept {
+    return Buckets::low(idx);
+  }
+  static uint64_t bucketHigh(size_t idx) noexcept {
+    return Buckets::high(idx);
+  }
+
+  // Thread-safe, but meant for a single publisher per histogram
+  void record(uint64_t val) noexcept;
+
+  NcclMetricHistogramSnapshot snapshot() const;
+  // Number of recorded values, cheaper than a snapshot
+  uint64_t count() const noexcept {
+    return count_.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::atomic<uint64_t> buckets_[kNumBuckets]{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};
+
+// Value of a metric pulled by a collector at export time. An aggregate, so
+// collectors can build it with a braced list.
+struct NcclMetricSample {
+  enum class Type { COUNTER, GAUGE };
+
+  std::string name;
+  NcclMetricLabels labels;
+  Type type;
+  uint64_t value;
+};
+
+class NcclMetricsExporter;
+
+class NcclMetrics {
+ public:
+  using Collector = std::function<void(std::vector<NcclMetricSample>&)>;
+
+  // Global registry. Starts the exporter on first use if NCCL_METRICS_EXPORT
+  // is set.
+  static NcclMetrics& getInstance();
+
+  // Whether metrics are exported at all. Publishers should not get metrics
+  // from the registry otherwise.
+  static bool enabled() noexcept;
+
+  // Get the metric with the given name and labels, creating it if needed.
+  // The same name must always be used with the same kind of metric.
+  std::shared_ptr<NcclMetricCounter> counter(
+      const std::string& name,
+      const NcclMetricLabels& labels);
+  std::shared_ptr<NcclMetricHistogram> histogram(
+      const std::string& name,
+      const NcclMetricLabels& labels);
+
+  // Remove the metrics whose name starts with namePrefix and which have all
+  // the given labels, e.g. those of a destroyed communicator. Publishers
+  // holding them can keep using them, they are just no longer exported.
+  void removeMetrics(
+      const std::string& namePrefix,
+      const NcclMetricLabels& labels);
+
+  // Collectors are called by export() without the registry lock held, so they
+  // can get metrics. Return an id to remove the collector. removeCollector()
+  // waits for a running export to be done with the collector, so what it
+  // captures can be freed once it returns; it must not be called from a
+  // collector.
+  int addCollector(Collector collector);
+  void removeCollector(int id);
+
+  // All metrics in the Prometheus text format
+  std::string exportText();
+
+  NcclMetrics(const NcclMetrics&) = delete;
+  NcclMetrics& operator=(const NcclMetrics&) = delete;
+  ~NcclMetrics();
+
+ private:
+  NcclMetrics();
+
+  struct Metric {
+    std::string name;
+    NcclMetricLabels labels;
+    std::shared_ptr<NcclMetricCounter> counter;
+    std::shared_ptr<NcclMetricHistogram> histogram;
+  };
+
+  Metric& getMetric(const std::string& name, const NcclMetricLabels& labels);
+
+  // Keyed by name and labels, so that the metrics of a name are exported
+  // together
+  std::map<std::string, Metric> metrics_;
+  std::mutex mutex_;
+
+  // Held while collectors run. Collectors can take mutex_, so it must not be
+  // taken with mutex_ held.
+  std::map<int, Collector> collectors_;
+  int nextCollectorId_{0};
+  std::mutex collectorsMutex_;
+
+  std::unique_ptr<NcclMetricsExporter> exporter_;
+};
+
+// Upper bound of the power-of-two size bucket of nBytes, used to label
+// metrics by message size
+static inline uint64_t ncclMetricsSizeBucket(uint64_t nBytes) {
+  uint64_t bucket = 1;
+  while (bucket < nBytes && bucket < (1UL << 63)) {
+    bucket <<= 1;
+  }
+  return nBytes ? bucket : 0;
+}
+
+#endif
@@ -0,0 +1,177 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include "NcclMetricsExporter.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "NcclMetrics.h"
+#include "debug.h"
+#include "nccl_cvars.h"
+
+// Delay before the socket thread notices that it is stopped
+static constexpr int kSocketPollTimeoutMs = 100;
+
+std::string NcclMetricsExporter::path(
+    const std::string& pathFormat,
+    bool socket) {
+  std::string pidStr = std::to_string(getpid());
+  if (pathFormat.empty()) {
+    return "/tmp/nccl_metrics." + pidStr + (socket ? ".sock" : ".prom");
+  }
+  std::string path = pathFormat;
+  for (size_t pos = path.find("%p"); pos != std::string::npos;
+       pos = path.find("%p", pos + pidStr.size())) {
+    path.replace(pos, 2, pidStr);
+  }
+  return path;
+}
+
+std::unique_ptr<NcclMetricsExporter> NcclMetricsExporter::create(
+    NcclMetrics* metrics) {
+  if (NCCL_METRICS_EXPORT == NCCL_METRICS_EXPORT::none) {
+    return nullptr;
+  }
+  bool socket = NCCL_METRICS_EXPORT == NCCL_METRICS_EXPORT::socket;
+  std::string path = NcclMetricsExporter::path(NCCL_METRICS_PATH, socket);
+
+  int fd = -1;
+  if (socket) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+      WARN("METRICS: socket path %s is too long", path.c_str());
+      return nullptr;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      WARN("METRICS: failed to create socket: %s", strerror(errno));
+      return nullptr;
+    }
+    // Remove the socket of a previous process with the same path
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) !=
+            0 ||
+        listen(fd, 16) != 0) {
+      WARN(
+          "METRICS: failed to listen on %s: %s", path.c_str(), strerror(errno));
+      close(fd);
+      return nullptr;
+    }
+  }
+
+  INFO(
+      NCCL_INIT,
+      "METRICS: exporting metrics to %s %s",
+      socket ? "socket" : "file",
+      path.c_str());
+  return std::unique_ptr<NcclMetricsExporter>(
+      new NcclMetricsExporter(metrics, path, fd));
+}
+
+NcclMetricsExporter::NcclMetricsExporter(
+    NcclMetrics* metrics,
+    std::string path,
+    int listenFd)
+    : metrics_(metrics), path_(std::move(path)), listenFd_(listenFd) {
+  if (listenFd_ >= 0) {
+    thread_ = std::thread(&NcclMetricsExporter::socketThreadFunc, this);
+  } else {
+    thread_ = std::thread(&NcclMetricsExporter::fileThreadFunc, this);
+  }
+  ncclSetThreadName(thread_.native_handle(), "NCCL Metrics");
+}
+
+NcclMetricsExporter::~NcclMetricsExporter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (listenFd_ >= 0) {
+    close(listenFd_);
+    unlink(path_.c_str());
+  }
+}
+
+void NcclMetricsExporter::writeFile() {
+  std::string tmpPath = path_ + ".tmp";
+  FILE* f = fopen(tmpPath.c_str(), "w");
+  if (f == nullptr) {
+    return;
+  }
+  std::string text = metrics_->exportText();
+  bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+  ok = fclose(f) == 0 && ok;
+  if (ok) {
+    rename(tmpPath.c_str(), path_.c_str());
+  } else {
+    unlink(tmpPath.c_str());
+  }
+}
+
+void NcclMetricsExporter::fileThreadFunc() {
+  auto interval =
+      std::chrono::milliseconds(std::max<int64_t>(NCCL_METRICS_INTERVAL_MS, 1));
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    cv_.wait_for(lock, interval, [this] { return stop_; });
+    lock.unlock();
+    // Also write the final values when stopping
+    writeFile();
+    lock.lock();
+  }
+}
+
+// Write all of buf to fd, giving up if the client does not read it
+static void writeAll(int fd, const std::string& buf) {
+  size_t offset = 0;
+  while (offset < buf.size()) {
+    ssize_t ret =
+        send(fd, buf.data() + offset, buf.size() - offset, MSG_NOSIGNAL);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return;
+    }
+    offset += ret;
+  }
+}
+
+void NcclMetricsExporter::socketThreadFunc() {
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stop_) {
+        break;
+      }
+    }
+    struct pollfd pfd = {listenFd_, POLLIN, 0};
+    int ret = poll(&pfd, 1, kSocketPollTimeoutMs);
+    if (ret <= 0) {
+      continue;
+    }
+    int fd = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+    // Do not let a stuck client block the exporter forever
+    struct timeval timeout = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    writeAll(fd, metrics_->exportText());
+    close(fd);
+  }
+}
@@ -0,0 +1,49 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+#ifndef NCCL_METRICS_EXPORTER_H
+#define NCCL_METRICS_EXPORTER_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class NcclMetrics;
+
+// Background thread exporting the metrics of NcclMetrics as set by
+// NCCL_METRICS_EXPORT, owned by the registry.
+class NcclMetricsExporter {
+ public:
+  // Return nullptr if metrics are not exported or the socket cannot be
+  // created
+  static std::unique_ptr<NcclMetricsExporter> create(NcclMetrics* metrics);
+
+  // Path of the metrics file or socket with the given NCCL_METRICS_PATH
+  static std::string path(const std::string& pathFormat, bool socket);
+
+  ~NcclMetricsExporter();
+
+  NcclMetricsExporter(const NcclMetricsExporter&) = delete;
+  NcclMetricsExporter& operator=(const NcclMetricsExporter&) = delete;
+
+ private:
+  NcclMetricsExporter(NcclMetrics* metrics, std::string path, int listenFd);
+
+  void fileThreadFunc();
+  void socketThreadFunc();
+  // Write the metrics to a temporary file and rename it, so that readers
+  // never see a partial file
+  void writeFile();
+
+  NcclMetrics* metrics_;
+  std::string path_;
+  // Listening Unix socket with NCCL_METRICS_EXPORT=socket, -1 otherwise
+  int listenFd_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_{false};
+  std::thread thread_;
+};
+
+#endif
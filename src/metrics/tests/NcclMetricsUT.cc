@@ -0,0 +1,229 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "NcclMetrics.h"
+#include "NcclMetricsExporter.h"
+#include "nccl_cvars.h"
+
+class NcclMetricsUT : public ::testing::Test {
+ public:
+  NcclMetricsUT() = default;
+
+  void SetUp() override {
+    ncclCvarInit();
+  }
+
+  void TearDown() override {
+    NcclMetrics::getInstance().removeMetrics("ut_", {});
+  }
+
+  // Read everything the exporter socket at path returns
+  std::string scrape(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    EXPECT_GE(fd, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    EXPECT_EQ(
+        connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)),
+        0);
+    std::string text;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+      text.append(buf, n);
+    }
+    close(fd);
+    return text;
+  }
+};
+
+TEST_F(NcclMetricsUT, HistogramBuckets) {
+  // Small values are exact
+  for (uint64_t v = 0; v < NcclMetricHistogram::kSubBuckets * 2; v++) {
+    size_t idx = NcclMetricHistogram::bucketIndex(v);
+    EXPECT_EQ(NcclMetricHistogram::bucketLow(idx), v);
+    EXPECT_EQ(NcclMetricHistogram::bucketHigh(idx), v);
+  }
+
+  // Larger values fall in a bucket within 1/16 of them
+  for (uint64_t v = 32; v < NcclMetricHistogram::kMaxValue; v = v * 3 + 7) {
+    size_t idx = NcclMetricHistogram::bucketIndex(v);
+    ASSERT_LT(idx, NcclMetricHistogram::kNumBuckets);
+    EXPECT_LE(NcclMetricHistogram::bucketLow(idx), v);
+    EXPECT_GE(NcclMetricHistogram::bucketHigh(idx), v);
+    EXPECT_LE(
+        NcclMetricHistogram::bucketHigh(idx) -
+            NcclMetricHistogram::bucketLow(idx),
+        v / NcclMetricHistogram::kSubBuckets);
+    EXPECT_EQ(NcclMetricHistogram::bucketLow(idx + 1),
+              NcclMetricHistogram::bucketHigh(idx) + 1);
+  }
+
+  EXPECT_EQ(
+      NcclMetricHistogram::bucketIndex(NcclMetricHistogram::kMaxValue),
+      NcclMetricHistogram::kNumBuckets - 1);
+  EXPECT_EQ(
+      NcclMetricHistogram::bucketIndex(UINT64_MAX),
+      NcclMetricHistogram::kNumBuckets - 1);
+}
+
+TEST_F(NcclMetricsUT, HistogramQuantiles) {
+  NcclMetricHistogram hist;
+  EXPECT_EQ(hist.snapshot().quantile(0.5), 0);
+
+  for (uint64_t v = 1; v <= 10000; v++) {
+    hist.record(v * 1000);
+  }
+  auto snap = hist.snapshot();
+  EXPECT_EQ(snap.count, 10000);
+  EXPECT_EQ(snap.sum, 1000UL * 10000 * 10001 / 2);
+  EXPECT_EQ(snap.max, 10000000);
+  EXPECT_NEAR(snap.quantile(0.5), 5000000, 5000000 / 16);
+  EXPECT_NEAR(snap.quantile(0.99), 9900000, 9900000 / 16);
+  EXPECT_EQ(snap.quantile(1), snap.max);
+}
+
+TEST_F(NcclMetricsUT, HistogramConcurrentRecord) {
+  NcclMetricHistogram hist;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&hist, t]() {
+      for (int i = 0; i < 10000; i++) {
+        hist.record(t * 10000 + i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto snap = hist.snapshot();
+  EXPECT_EQ(snap.count, 40000);
+  EXPECT_EQ(snap.max, 39999);
+  uint64_t total = 0;
+  for (auto n : snap.buckets) {
+    total += n;
+  }
+  EXPECT_EQ(total, 40000);
+}
+
+TEST_F(NcclMetricsUT, RegistryExport) {
+  auto& metrics = NcclMetrics::getInstance();
+  NcclMetricLabels labels = {{"comm", "abc"}, {"coll", "AllReduce"}};
+  auto counter = metrics.counter("ut_bytes_total", labels);
+  // Same metric for the same name and labels
+  EXPECT_EQ(counter, metrics.counter("ut_bytes_total", labels));
+  counter->add(100);
+  counter->add(28);
+
+  // Values below 16 fall in exact buckets
+  auto hist = metrics.histogram("ut_latency_ns", labels);
+  for (uint64_t v = 1; v <= 20; v++) {
+    hist->record(v);
+  }
+
+  int id = metrics.addCollector([](std::vector<NcclMetricSample>& samples) {
+    samples.push_back(
+        {"ut_traffic_bytes_total",
+         {{"device", "mlx5_0"}},
+         NcclMetricSample::Type::COUNTER,
+         42});
+  });
+
+  std::string text = metrics.exportText();
+  EXPECT_NE(text.find("# TYPE ut_bytes_total counter\n"), std::string::npos);
+  EXPECT_NE(
+      text.find("ut_bytes_total{comm=\"abc\",coll=\"AllReduce\"} 128\n"),
+      std::string::npos);
+  EXPECT_NE(text.find("# TYPE ut_latency_ns summary\n"), std::string::npos);
+  EXPECT_NE(
+      text.find(
+          "ut_latency_ns{comm=\"abc\",coll=\"AllReduce\",quantile=\"0.5\"} 10\n"),
+      std::string::npos);
+  EXPECT_NE(
+      text.find(
+          "ut_latency_ns{comm=\"abc\",coll=\"AllReduce\",quantile=\"1\"} 20\n"),
+      std::string::npos);
+  EXPECT_NE(
+      text.find("ut_latency_ns_count{comm=\"abc\",coll=\"AllReduce\"} 20\n"),
+      std::string::npos);
+  EXPECT_NE(
+      text.find("ut_traffic_bytes_total{device=\"mlx5_0\"} 42\n"),
+      std::string::npos);
+
+  // Removed metrics are no longer exported but can still be used
+  metrics.removeMetrics("ut_", {{"comm", "abc"}});
+  metrics.removeCollector(id);
+  counter->add(1);
+  text = metrics.exportText();
+  EXPECT_EQ(text.find("ut_"), std::string::npos);
+}
+
+TEST_F(NcclMetricsUT, RemoveMetricsByLabel) {
+  auto& metrics = NcclMetrics::getInstance();
+  metrics.counter("ut_colls_total", {{"comm", "1"}})->add(1);
+  metrics.counter("ut_colls_total", {{"comm", "2"}})->add(2);
+  metrics.removeMetrics("ut_", {{"comm", "1"}});
+
+  std::string text = metrics.exportText();
+  EXPECT_EQ(text.find("ut_colls_total{comm=\"1\"}"), std::string::npos);
+  EXPECT_NE(text.find("ut_colls_total{comm=\"2\"} 2\n"), std::string::npos);
+}
+
+TEST_F(NcclMetricsUT, RemoveCollectorWaitsForExport) {
+  auto& metrics = NcclMetrics::getInstance();
+  std::atomic<bool> running{false};
+  std::atomic<bool> removed{false};
+  std::atomic<bool> calledAfterRemove{false};
+  int id = metrics.addCollector([&](std::vector<NcclMetricSample>& samples) {
+    running = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    calledAfterRemove = calledAfterRemove || removed;
+    samples.push_back(
+        {"ut_slow_total", {}, NcclMetricSample::Type::COUNTER, 1});
+  });
+
+  std::thread exporter([&]() { metrics.exportText(); });
+  while (!running) {
+    std::this_thread::yield();
+  }
+  // The collector is still running, removeCollector must wait for it
+  metrics.removeCollector(id);
+  removed = true;
+  exporter.join();
+  EXPECT_FALSE(calledAfterRemove);
+  EXPECT_EQ(metrics.exportText().find("ut_slow_total"), std::string::npos);
+}
+
+TEST_F(NcclMetricsUT, SocketExporter) {
+  std::string path =
+      "/tmp/nccl_metrics_ut_" + std::to_string(getpid()) + "_%p.sock";
+  NCCL_METRICS_EXPORT = NCCL_METRICS_EXPORT::socket;
+  NCCL_METRICS_PATH = path;
+  path = NcclMetricsExporter::path(path, true);
+  EXPECT_EQ(path.find("%p"), std::string::npos);
+
+  auto& metrics = NcclMetrics::getInstance();
+  auto exporter = NcclMetricsExporter::create(&metrics);
+  ASSERT_NE(exporter, nullptr);
+
+  auto counter = metrics.counter("ut_scraped_total", {});
+  counter->add(7);
+  EXPECT_NE(scrape(path).find("ut_scraped_total 7\n"), std::string::npos);
+  counter->add(1);
+  EXPECT_NE(scrape(path).find("ut_scraped_total 8\n"), std::string::npos);
+
+  // The socket is removed with the exporter
+  exporter.reset();
+  EXPECT_NE(access(path.c_str(), F_OK), 0);
+}
@@ -3,6 +3,13 @@
 #include "logger.h"
 #include "nccl_cvars.h"
 
+#include <limits.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
 #include <stdexcept>
 
 /*
@@ -11,36 +18,127 @@
  - name        : NCCL_LOGGER_MODE
    type        : enum
    default     : sync
-   choices     : sync, async
+   choices     : sync, async, ring
    description : |-
      The way to log NCCL messages to stdout or specified by NCCL_DEBUG_FILE.
      sync     - Log NCCL messages synchronously
      async    - Log NCCL messages asynchronously via a background thread
         (for NCCL messages logging file, see also NCCL_DEBUG_FILE)
+     ring     - Log NCCL messages asynchronously without lock. Each thread
+        copies its messages to its own buffer of NCCL_LOGGER_RING_SIZE
+        bytes, written to the file in batches by a background thread.
+        Messages are dropped when the buffer is full and the number of
+        dropped messages is logged.
+
+ - name        : NCCL_LOGGER_RING_SIZE
+   type        : int64_t
+   default     : 262144
+   description : |-
+     Size in bytes of the buffer of each logging thread with
+     NCCL_LOGGER_MODE=ring, rounded up to a power of two (at least 4096).
 
 === END_NCCL_CVAR_INFO_BLOCK ===
 */
 
 
+// Maximum delay before a message logged with NCCL_LOGGER_MODE=ring is written
+static constexpr std::chrono::milliseconds kRingFlushInterval{1};
+static constexpr size_t kMinRingSize = 4096;
+
+NcclLogRing::NcclLogRing(size_t size, int tid) : size_(kMinRingSize), tid_(tid) {
+  while (size_ < size) {
+    size_ <<= 1;
+  }
+  buf_ = std::unique_ptr<char[]>(new char[size_]);
+}
+
+bool NcclLogRing::push(const char* msg, size_t len) noexcept {
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  uint64_t tail = tail_.load(std::memory_order_acquire);
+  if (len > size_ - (head - tail)) {
+    dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    return false;
+  }
+  size_t pos = head & (size_ - 1);
+  size_t first = std::min(len, size_ - pos);
+  memcpy(buf_.get() + pos, msg, first);
+  memcpy(buf_.get(), msg + first, len - first);
+  head_.store(head + len, std::memory_order_release);
+  return true;
+}
+
+size_t NcclLogRing::pending(struct iovec* iov, int* nIov) const {
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  size_t len = head_.load(std::memory_order_acquire) - tail;
+  size_t pos = tail & (size_ - 1);
+  size_t first = std::min(len, size_ - pos);
+  *nIov = 0;
+  if (first > 0) {
+    iov[(*nIov)++] = {buf_.get() + pos, first};
+  }
+  if (len > first) {
+    iov[(*nIov)++] = {buf_.get(), len - first};
+  }
+  return len;
+}
+
+void NcclLogRing::release(size_t nBytes) {
+  tail_.store(
+      tail_.load(std::memory_order_relaxed) + nBytes, std::memory_order_release);
+}
+
+// Ring of the calling thread, closed when the thread exits so that the logger
+// thread can free it once written
+namespace {
+struct ThreadRing {
+  std::shared_ptr<NcclLogRing> ring;
+  ~ThreadRing() {
+    if (ring) {
+      ring->close();
+    }
+  }
+};
+} // namespace
+
 // Initialize static memeber for NcclLogger
 std::atomic_flag NcclLogger::singletonInitialized_ = ATOMIC_FLAG_INIT;
 std::unique_ptr<NcclLogger> NcclLogger::singleton_{};
 
 void NcclLogger::log(const std::string& msg, FILE* ncclDebugFile) noexcept {
+  log(msg.c_str(), msg.size(), ncclDebugFile);
+}
+
+void NcclLogger::log(
+    const char* msg,
+    size_t len,
+    FILE* ncclDebugFile) noexcept {
   // There are three cases where singleton_ is nullptr:
-  // 1. NCCL_LOGGER_MODE is not async.
-  // 2. NCCL_LOGGER_MODE is async but singleton_ haven't initialized.
+  // 1. NCCL_LOGGER_MODE is sync.
+  // 2. NCCL_LOGGER_MODE is async or ring but singleton_ haven't initialized.
   // 3. We are exiting the program and singleton_ has already been destroyed.
   // In all three cases, we should not init singleton and write to the file directly.
   if (singleton_ != nullptr) {
-    singleton_->enqueueLog(msg);
+    singleton_->enqueueLog(msg, len);
   } else {
-    fwrite(msg.c_str(), 1, msg.size(), ncclDebugFile);
+    fwrite(msg, 1, len, ncclDebugFile);
+  }
+}
+
+uint64_t NcclLogger::droppedMessages() noexcept {
+  if (singleton_ == nullptr) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(singleton_->mutex_);
+  uint64_t dropped = singleton_->removedDropped_;
+  for (auto& ring : singleton_->rings_) {
+    dropped += ring->dropped();
   }
+  return dropped;
 }
 
 void NcclLogger::init(FILE* ncclDebugFile) {
-  if (NCCL_LOGGER_MODE == NCCL_LOGGER_MODE::async &&
+  if (NCCL_LOGGER_MODE != NCCL_LOGGER_MODE::sync &&
         !singletonInitialized_.test_and_set()) {
     singleton_ = std::unique_ptr<NcclLogger>(new NcclLogger(ncclDebugFile));
   }
@@ -52,10 +150,17 @@ NcclLogger::NcclLogger(FILE* ncclDebugFile)
     throw std::runtime_error("Failed to open debug file");
   }
   debugFile = ncclDebugFile;
+  ringMode_ = NCCL_LOGGER_MODE == NCCL_LOGGER_MODE::ring;
 
-  writeToFile(
-      "NCCL Logger: instantiate the Asynchronous NCCL message logging.\n");
-  loggerThread_ = std::thread(&NcclLogger::logThreadFunc, this);
+  if (ringMode_) {
+    writeToFile(
+        "NCCL Logger: instantiate the lock-free Asynchronous NCCL message logging.\n");
+    loggerThread_ = std::thread(&NcclLogger::ringThreadFunc, this);
+  } else {
+    writeToFile(
+        "NCCL Logger: instantiate the Asynchronous NCCL message logging.\n");
+    loggerThread_ = std::thread(&NcclLogger::logThreadFunc, this);
+  }
 }
 
 void NcclLogger::stop() {
@@ -81,11 +186,34 @@ NcclLogger::~NcclLogger() {
   }
 }
 
-void NcclLogger::enqueueLog(const std::string& msg) noexcept{
+NcclLogRing* NcclLogger::threadRing() {
+  static thread_local ThreadRing threadRing;
+  if (!threadRing.ring) {
+    auto ring = std::make_shared<NcclLogRing>(
+        std::max<int64_t>(NCCL_LOGGER_RING_SIZE, 0), syscall(SYS_gettid));
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      rings_.push_back(ring);
+    }
+    threadRing.ring = std::move(ring);
+  }
+  return threadRing.ring.get();
+}
+
+void NcclLogger::enqueueLog(const char* msg, size_t len) noexcept {
   try {
+    if (ringMode_) {
+      NcclLogRing* ring = threadRing();
+      // The logger thread wakes up on its own every kRingFlushInterval. Only
+      // wake it up early if the ring is filling up.
+      if (ring->push(msg, len) && ring->used() > ring->size() / 2) {
+        cv_.notify_one();
+      }
+      return;
+    }
     {
       std::lock_guard<std::mutex> lock(mutex_);
-      mergedMsgQueue_->push(msg);
+      mergedMsgQueue_->emplace(msg, len);
     }
     cv_.notify_one();
   } catch (const std::exception& e) {
@@ -120,3 +248,109 @@ void NcclLogger::logThreadFunc() {
     fprintf(debugFile, "Exception in NCCL logger thread: %s\n", e.what());
   }
 }
+
+// Write all iovecs to fd, retrying on partial writes. Give up on errors, so
+// that the rings are released and logging threads never block.
+static void writeAll(int fd, struct iovec* iov, int nIov) {
+  while (nIov > 0) {
+    ssize_t ret = writev(fd, iov, std::min(nIov, IOV_MAX));
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    size_t written = ret;
+    while (nIov > 0 && written >= iov->iov_len) {
+      written -= iov->iov_len;
+      iov++;
+      nIov--;
+    }
+    if (nIov > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+      iov->iov_len -= written;
+    }
+  }
+}
+
+void NcclLogger::flushRings(std::vector<std::shared_ptr<NcclLogRing>>& rings) {
+  std::vector<struct iovec> iov(rings.size() * 3);
+  std::vector<size_t> lens(rings.size());
+  // Reserved so that iov can point to the strings
+  std::vector<std::string> dropMsgs;
+  dropMsgs.reserve(rings.size());
+  int nIov = 0;
+  for (size_t i = 0; i < rings.size(); i++) {
+    auto& ring = rings[i];
+    int n = 0;
+    lens[i] = ring->pending(&iov[nIov], &n);
+    nIov += n;
+
+    uint64_t dropped = ring->dropped();
+    if (dropped != ring->reportedDropped) {
+      char buffer[128];
+      int len = snprintf(
+          buffer,
+          sizeof(buffer),
+          "NCCL Logger: dropped %lu messages of thread %d, see NCCL_LOGGER_RING_SIZE\n",
+          dropped - ring->reportedDropped,
+          ring->tid());
+      ring->reportedDropped = dropped;
+      dropMsgs.emplace_back(buffer, len);
+      iov[nIov++] = {&dropMsgs.back()[0], dropMsgs.back().size()};
+    }
+  }
+  if (nIov == 0) {
+    return;
+  }
+
+  // Keep the order with messages written through debugFile
+  fflush(debugFile);
+  writeAll(fileno(debugFile), iov.data(), nIov);
+  for (size_t i = 0; i < rings.size(); i++) {
+    rings[i]->release(lens[i]);
+  }
+}
+
+void NcclLogger::ringThreadFunc() {
+  try {
+    std::vector<std::shared_ptr<NcclLogRing>> rings;
+    while (true) {
+      // Messages logged before stop() are written by the last flush
+      bool stopping = stopThread;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings = rings_;
+      }
+
+      flushRings(rings);
+
+      {
+        // Free the rings of exited threads once written
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::remove_if(
+            rings_.begin(),
+            rings_.end(),
+            [&](const std::shared_ptr<NcclLogRing>& ring) {
+              if (ring->closed() && ring->used() == 0) {
+                removedDropped_ += ring->dropped();
+                return true;
+              }
+              return false;
+            });
+        rings_.erase(it, rings_.end());
+      }
+      rings.clear();
+
+      if (stopping) {
+        break;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!stopThread) {
+        cv_.wait_for(lock, kRingFlushInterval);
+      }
+    }
+  } catch (const std::exception& e) {
+    fprintf(debugFile, "Exception in NCCL logger thread: %s\n", e.what());
+  }
+}
@@ -219,6 +219,12 @@ enum NCCL_ALLTOALLV_ALGO NCCL_ALLTOALLV_ALGO;
 enum NCCL_ALLTOALLV_ALGO NCCL_ALLTOALLV_ALGO_DEFAULT;
 enum NCCL_ALLTOALL_ALGO NCCL_ALLTOALL_ALGO;
 enum NCCL_ALLTOALL_ALGO NCCL_ALLTOALL_ALGO_DEFAULT;
+enum NCCL_BOOTSTRAP_ALLGATHER_ALGO NCCL_BOOTSTRAP_ALLGATHER_ALGO;
+enum NCCL_BOOTSTRAP_ALLGATHER_ALGO NCCL_BOOTSTRAP_ALLGATHER_ALGO_DEFAULT;
+int64_t NCCL_BOOTSTRAP_BRUCK_MAX_SIZE;
+int64_t NCCL_BOOTSTRAP_BRUCK_MAX_SIZE_DEFAULT;
+int NCCL_BOOTSTRAP_BRUCK_MIN_RANKS;
+int NCCL_BOOTSTRAP_BRUCK_MIN_RANKS_DEFAULT;
 int64_t NCCL_BUFFSIZE;
 int64_t NCCL_BUFFSIZE_DEFAULT;
 int64_t NCCL_CGA_CLUSTER_SIZE;
@@ -233,8 +239,22 @@ int64_t NCCL_COLLNET_NODE_THRESHOLD;
 int64_t NCCL_COLLNET_NODE_THRESHOLD_DEFAULT;
 std::vector<std::string> NCCL_COLLTRACE;
 std::vector<std::string> NCCL_COLLTRACE_DEFAULT;
+int64_t NCCL_COLLTRACE_BINARY_RECORDS;
+int64_t NCCL_COLLTRACE_BINARY_RECORDS_DEFAULT;
 std::string NCCL_COLLTRACE_DIR;
 std::string NCCL_COLLTRACE_DIR_DEFAULT;
+enum NCCL_COLLTRACE_FILE_FORMAT NCCL_COLLTRACE_FILE_FORMAT;
+enum NCCL_COLLTRACE_FILE_FORMAT NCCL_COLLTRACE_FILE_FORMAT_DEFAULT;
+int64_t NCCL_COLLTRACE_RECORD_MAX;
+int64_t NCCL_COLLTRACE_RECORD_MAX_DEFAULT;
+int64_t NCCL_COLLTRACE_RECORD_MAX_BYTES;
+int64_t NCCL_COLLTRACE_RECORD_MAX_BYTES_DEFAULT;
+int64_t NCCL_COLLTRACE_SAMPLE_INTERVAL;
+int64_t NCCL_COLLTRACE_SAMPLE_INTERVAL_DEFAULT;
+int64_t NCCL_COLLTRACE_SAMPLE_RATE;
+int64_t NCCL_COLLTRACE_SAMPLE_RATE_DEFAULT;
+enum NCCL_COLLTRACE_SAMPLING NCCL_COLLTRACE_SAMPLING;
+enum NCCL_COLLTRACE_SAMPLING NCCL_COLLTRACE_SAMPLING_DEFAULT;
 int64_t NCCL_COMM_BLOCKING;
 int64_t NCCL_COMM_BLOCKING_DEFAULT;
 std::string NCCL_COMM_ID;
@@ -261,6 +281,12 @@ uint64_t NCCL_CTRAN_ALLTOALL_THRESHOLD;
 uint64_t NCCL_CTRAN_ALLTOALL_THRESHOLD_DEFAULT;
 std::vector<enum NCCL_CTRAN_BACKENDS> NCCL_CTRAN_BACKENDS;
 std::vector<enum NCCL_CTRAN_BACKENDS> NCCL_CTRAN_BACKENDS_DEFAULT;
+int NCCL_CTRAN_GPE_CMD_QUEUE_SIZE;
+int NCCL_CTRAN_GPE_CMD_QUEUE_SIZE_DEFAULT;
+bool NCCL_CTRAN_GPE_LATENCY_STATS;
+bool NCCL_CTRAN_GPE_LATENCY_STATS_DEFAULT;
+int NCCL_CTRAN_GPE_SPIN_USEC;
+int NCCL_CTRAN_GPE_SPIN_USEC_DEFAULT;
 uint64_t NCCL_CTRAN_IB_CTRL_TC;
 uint64_t NCCL_CTRAN_IB_CTRL_TC_DEFAULT;
 int NCCL_CTRAN_IB_MAX_QPS;
@@ -287,6 +313,14 @@ uint64_t NCCL_CTRAN_RING_STEP;
 uint64_t NCCL_CTRAN_RING_STEP_DEFAULT;
 uint64_t NCCL_CTRAN_SHARED_DEVBUF_SIZE;
 uint64_t NCCL_CTRAN_SHARED_DEVBUF_SIZE_DEFAULT;
+uint64_t NCCL_CTRAN_SOCKET_CHUNK_SIZE;
+uint64_t NCCL_CTRAN_SOCKET_CHUNK_SIZE_DEFAULT;
+int NCCL_CTRAN_SOCKET_NUM_STREAMS;
+int NCCL_CTRAN_SOCKET_NUM_STREAMS_DEFAULT;
+uint64_t NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD;
+uint64_t NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD_DEFAULT;
+int64_t NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD;
+int64_t NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD_DEFAULT;
 std::string NCCL_CTRAN_TOPO_FILE;
 std::string NCCL_CTRAN_TOPO_FILE_DEFAULT;
 std::vector<std::string> NCCL_CTRAN_TOPO_FILE_KEYS;
@@ -391,6 +425,8 @@ int64_t NCCL_LOCAL_REGISTER;
 int64_t NCCL_LOCAL_REGISTER_DEFAULT;
 enum NCCL_LOGGER_MODE NCCL_LOGGER_MODE;
 enum NCCL_LOGGER_MODE NCCL_LOGGER_MODE_DEFAULT;
+int64_t NCCL_LOGGER_RING_SIZE;
+int64_t NCCL_LOGGER_RING_SIZE_DEFAULT;
 int64_t NCCL_MAX_CTAS;
 int64_t NCCL_MAX_CTAS_DEFAULT;
 int NCCL_MAX_NCHANNELS;
@@ -401,6 +437,12 @@ int NCCL_MAX_P2P_NCHANNELS;
 int NCCL_MAX_P2P_NCHANNELS_DEFAULT;
 enum NCCL_MEM_SYNC_DOMAIN NCCL_MEM_SYNC_DOMAIN;
 enum NCCL_MEM_SYNC_DOMAIN NCCL_MEM_SYNC_DOMAIN_DEFAULT;
+enum NCCL_METRICS_EXPORT NCCL_METRICS_EXPORT;
+enum NCCL_METRICS_EXPORT NCCL_METRICS_EXPORT_DEFAULT;
+int64_t NCCL_METRICS_INTERVAL_MS;
+int64_t NCCL_METRICS_INTERVAL_MS_DEFAULT;
+std::string NCCL_METRICS_PATH;
+std::string NCCL_METRICS_PATH_DEFAULT;
 int64_t NCCL_MIN_CTAS;
 int64_t NCCL_MIN_CTAS_DEFAULT;
 int NCCL_MIN_NCHANNELS;
@@ -469,14 +511,36 @@ std::vector<std::string> NCCL_PROXYMOCK_NET_SEND_FAILURE;
 std::vector<std::string> NCCL_PROXYMOCK_NET_SEND_FAILURE_DEFAULT;
 std::vector<std::string> NCCL_PROXYTRACE;
 std::vector<std::string> NCCL_PROXYTRACE_DEFAULT;
+int64_t NCCL_PROXYTRACE_RECORD_MAX;
+int64_t NCCL_PROXYTRACE_RECORD_MAX_DEFAULT;
+int64_t NCCL_PROXYTRACE_RECORD_MAX_BYTES;
+int64_t NCCL_PROXYTRACE_RECORD_MAX_BYTES_DEFAULT;
+int64_t NCCL_PROXYTRACE_RING_SIZE;
+int64_t NCCL_PROXYTRACE_RING_SIZE_DEFAULT;
+int64_t NCCL_PROXYTRACE_TIMELINE_RECORD_MAX;
+int64_t NCCL_PROXYTRACE_TIMELINE_RECORD_MAX_DEFAULT;
 int64_t NCCL_PROXY_APPEND_BATCH_SIZE;
 int64_t NCCL_PROXY_APPEND_BATCH_SIZE_DEFAULT;
 int64_t NCCL_PROXY_DUMP_SIGNAL;
 int64_t NCCL_PROXY_DUMP_SIGNAL_DEFAULT;
+enum NCCL_PROXY_IDLE_POLICY NCCL_PROXY_IDLE_POLICY;
+enum NCCL_PROXY_IDLE_POLICY NCCL_PROXY_IDLE_POLICY_DEFAULT;
+int64_t NCCL_PROXY_IDLE_SPIN_MAX_NS;
+int64_t NCCL_PROXY_IDLE_SPIN_MAX_NS_DEFAULT;
+int64_t NCCL_PROXY_IDLE_SPIN_MIN_NS;
+int64_t NCCL_PROXY_IDLE_SPIN_MIN_NS_DEFAULT;
+std::string NCCL_PROXY_OP_RECORD_FILE;
+std::string NCCL_PROXY_OP_RECORD_FILE_DEFAULT;
 std::string NCCL_PROXY_PROFILE;
 std::string NCCL_PROXY_PROFILE_DEFAULT;
 std::string NCCL_PROXY_PROFILE_DIR;
 std::string NCCL_PROXY_PROFILE_DIR_DEFAULT;
+bool NCCL_PROXY_PROGRESS_NUMA_PIN;
+bool NCCL_PROXY_PROGRESS_NUMA_PIN_DEFAULT;
+int64_t NCCL_PROXY_PROGRESS_THREADS;
+int64_t NCCL_PROXY_PROGRESS_THREADS_DEFAULT;
+int64_t NCCL_PROXY_RPC_BATCH_SIZE;
+int64_t NCCL_PROXY_RPC_BATCH_SIZE_DEFAULT;
 int64_t NCCL_PXN_DISABLE;
 int64_t NCCL_PXN_DISABLE_DEFAULT;
 enum NCCL_SENDRECV_ALGO NCCL_SENDRECV_ALGO;
@@ -499,6 +563,8 @@ std::string NCCL_SOCKET_IFNAME;
 std::string NCCL_SOCKET_IFNAME_DEFAULT;
 int64_t NCCL_SOCKET_NTHREADS;
 int64_t NCCL_SOCKET_NTHREADS_DEFAULT;
+int64_t NCCL_SOCKET_ZCOPY_THRESHOLD;
+int64_t NCCL_SOCKET_ZCOPY_THRESHOLD_DEFAULT;
 std::string NCCL_THREAD_THRESHOLDS;
 std::string NCCL_THREAD_THRESHOLDS_DEFAULT;
 std::string NCCL_TOPO_DUMP_FILE;
@@ -507,6 +573,12 @@ int64_t NCCL_TOPO_DUMP_FILE_RANK;
 int64_t NCCL_TOPO_DUMP_FILE_RANK_DEFAULT;
 std::string NCCL_TOPO_FILE;
 std::string NCCL_TOPO_FILE_DEFAULT;
+int64_t NCCL_TOPO_SEARCH_CACHE;
+int64_t NCCL_TOPO_SEARCH_CACHE_DEFAULT;
+std::string NCCL_TOPO_SEARCH_CACHE_DIR;
+std::string NCCL_TOPO_SEARCH_CACHE_DIR_DEFAULT;
+int64_t NCCL_TOPO_SEARCH_THREADS;
+int64_t NCCL_TOPO_SEARCH_THREADS_DEFAULT;
 std::string NCCL_TUNER_PLUGIN;
 std::string NCCL_TUNER_PLUGIN_DEFAULT;
 int64_t NCCL_WORK_FIFO_DEPTH;
@@ -524,6 +596,9 @@ void initEnvSet(std::unordered_set<std::string>& env) {
   env.insert("NCCL_ALLREDUCE_SPARSE_BLOCK_THREAD_BLOCK_SIZE");
   env.insert("NCCL_ALLTOALLV_ALGO");
   env.insert("NCCL_ALLTOALL_ALGO");
+  env.insert("NCCL_BOOTSTRAP_ALLGATHER_ALGO");
+  env.insert("NCCL_BOOTSTRAP_BRUCK_MAX_SIZE");
+  env.insert("NCCL_BOOTSTRAP_BRUCK_MIN_RANKS");
   env.insert("NCCL_BUFFSIZE");
   env.insert("NCCL_CGA_CLUSTER_SIZE");
   env.insert("NCCL_CHECK_POINTERS");
@@ -531,7 +606,14 @@ void initEnvSet(std::unordered_set<std::string>& env) {
   env.insert("NCCL_COLLNET_ENABLE");
   env.insert("NCCL_COLLNET_NODE_THRESHOLD");
   env.insert("NCCL_COLLTRACE");
+  env.insert("NCCL_COLLTRACE_BINARY_RECORDS");
   env.insert("NCCL_COLLTRACE_DIR");
+  env.insert("NCCL_COLLTRACE_FILE_FORMAT");
+  env.insert("NCCL_COLLTRACE_RECORD_MAX");
+  env.insert("NCCL_COLLTRACE_RECORD_MAX_BYTES");
+  env.insert("NCCL_COLLTRACE_SAMPLE_INTERVAL");
+  env.insert("NCCL_COLLTRACE_SAMPLE_RATE");
+  env.insert("NCCL_COLLTRACE_SAMPLING");
   env.insert("NCCL_COMM_BLOCKING");
   env.insert("NCCL_COMM_ID");
   env.insert("NCCL_COMM_SPLIT_SHARE_RESOURCES");
@@ -545,6 +627,9 @@ void initEnvSet(std::unordered_set<std::string>& env) {
   env.insert("NCCL_CTRAN_ALLTOALL_THREAD_BLOCK_SIZE");
   env.insert("NCCL_CTRAN_ALLTOALL_THRESHOLD");
   env.insert("NCCL_CTRAN_BACKENDS");
+  env.insert("NCCL_CTRAN_GPE_CMD_QUEUE_SIZE");
+  env.insert("NCCL_CTRAN_GPE_LATENCY_STATS");
+  env.insert("NCCL_CTRAN_GPE_SPIN_USEC");
   env.insert("NCCL_CTRAN_IB_CTRL_TC");
   env.insert("NCCL_CTRAN_IB_MAX_QPS");
   env.insert("NCCL_CTRAN_IB_QP_SCALING_THRESHOLD");
@@ -558,6 +643,10 @@ void initEnvSet(std::unordered_set<std::string>& env) {
   env.insert("NCCL_CTRAN_RING_MAX_OUTSTANDING");
   env.insert("NCCL_CTRAN_RING_STEP");
   env.insert("NCCL_CTRAN_SHARED_DEVBUF_SIZE");
+  env.insert("NCCL_CTRAN_SOCKET_CHUNK_SIZE");
+  env.insert("NCCL_CTRAN_SOCKET_NUM_STREAMS");
+  env.insert("NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD");
+  env.insert("NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD");
   env.insert("NCCL_CTRAN_TOPO_FILE");
   env.insert("NCCL_CTRAN_TOPO_FILE_KEYS");
   env.insert("NCCL_CUDA_PATH");
@@ -609,11 +698,15 @@ void initEnvSet(std::unordered_set<std::string>& env) {
   env.insert("NCCL_LL_BUFFSIZE");
   env.insert("NCCL_LOCAL_REGISTER");
   env.insert("NCCL_LOGGER_MODE");
+  env.insert("NCCL_LOGGER_RING_SIZE");
   env.insert("NCCL_MAX_CTAS");
   env.insert("NCCL_MAX_NCHANNELS");
   env.insert("NCCL_MAX_NRINGS");
   env.insert("NCCL_MAX_P2P_NCHANNELS");
   env.insert("NCCL_MEM_SYNC_DOMAIN");
+  env.insert("NCCL_METRICS_EXPORT");
+  env.insert("NCCL_METRICS_INTERVAL_MS");
+  env.insert("NCCL_METRICS_PATH");
   env.insert("NCCL_MIN_CTAS");
   env.insert("NCCL_MIN_NCHANNELS");
   env.insert("NCCL_MIN_NRINGS");
@@ -648,10 +741,21 @@ void initEnvSet(std::unordered_set<std::string>& env) {
   env.insert("NCCL_PROTO");
   env.insert("NCCL_PROXYMOCK_NET_SEND_FAILURE");
   env.insert("NCCL_PROXYTRACE");
+  env.insert("NCCL_PROXYTRACE_RECORD_MAX");
+  env.insert("NCCL_PROXYTRACE_RECORD_MAX_BYTES");
+  env.insert("NCCL_PROXYTRACE_RING_SIZE");
+  env.insert("NCCL_PROXYTRACE_TIMELINE_RECORD_MAX");
   env.insert("NCCL_PROXY_APPEND_BATCH_SIZE");
   env.insert("NCCL_PROXY_DUMP_SIGNAL");
+  env.insert("NCCL_PROXY_IDLE_POLICY");
+  env.insert("NCCL_PROXY_IDLE_SPIN_MAX_NS");
+  env.insert("NCCL_PROXY_IDLE_SPIN_MIN_NS");
+  env.insert("NCCL_PROXY_OP_RECORD_FILE");
   env.insert("NCCL_PROXY_PROFILE");
   env.insert("NCCL_PROXY_PROFILE_DIR");
+  env.insert("NCCL_PROXY_PROGRESS_NUMA_PIN");
+  env.insert("NCCL_PROXY_PROGRESS_THREADS");
+  env.insert("NCCL_PROXY_RPC_BATCH_SIZE");
   env.insert("NCCL_PXN_DISABLE");
   env.insert("NCCL_SENDRECV_ALGO");
   env.insert("NCCL_SET_STACK_SIZE");
@@ -663,10 +767,14 @@ void initEnvSet(std::unordered_set<std::string>& env) {
   env.insert("NCCL_SOCKET_FAMILY");
   env.insert("NCCL_SOCKET_IFNAME");
   env.insert("NCCL_SOCKET_NTHREADS");
+  env.insert("NCCL_SOCKET_ZCOPY_THRESHOLD");
   env.insert("NCCL_THREAD_THRESHOLDS");
   env.insert("NCCL_TOPO_DUMP_FILE");
   env.insert("NCCL_TOPO_DUMP_FILE_RANK");
   env.insert("NCCL_TOPO_FILE");
+  env.insert("NCCL_TOPO_SEARCH_CACHE");
+  env.insert("NCCL_TOPO_SEARCH_CACHE_DIR");
+  env.insert("NCCL_TOPO_SEARCH_THREADS");
   env.insert("NCCL_TUNER_PLUGIN");
   env.insert("NCCL_WORK_FIFO_DEPTH");
 }
@@ -753,6 +861,28 @@ void readCvarEnv() {
   }
   NCCL_ALLTOALL_ALGO_DEFAULT = NCCL_ALLTOALL_ALGO::orig;
 
+  if (getenv("NCCL_BOOTSTRAP_ALLGATHER_ALGO") == nullptr) {
+    NCCL_BOOTSTRAP_ALLGATHER_ALGO = NCCL_BOOTSTRAP_ALLGATHER_ALGO::adaptive;
+  } else {
+    std::string str(getenv("NCCL_BOOTSTRAP_ALLGATHER_ALGO"));
+    if (str == std::string("adaptive")) {
+      NCCL_BOOTSTRAP_ALLGATHER_ALGO = NCCL_BOOTSTRAP_ALLGATHER_ALGO::adaptive;
+    } else if (str == std::string("ring")) {
+      NCCL_BOOTSTRAP_ALLGATHER_ALGO = NCCL_BOOTSTRAP_ALLGATHER_ALGO::ring;
+    } else if (str == std::string("bruck")) {
+      NCCL_BOOTSTRAP_ALLGATHER_ALGO = NCCL_BOOTSTRAP_ALLGATHER_ALGO::bruck;
+    } else {
+      CVAR_WARN_UNKNOWN_VALUE("NCCL_BOOTSTRAP_ALLGATHER_ALGO", str.c_str());
+    }
+  }
+  NCCL_BOOTSTRAP_ALLGATHER_ALGO_DEFAULT = NCCL_BOOTSTRAP_ALLGATHER_ALGO::adaptive;
+
+  NCCL_BOOTSTRAP_BRUCK_MAX_SIZE = env2num<int64_t>("NCCL_BOOTSTRAP_BRUCK_MAX_SIZE", "1048576");
+  NCCL_BOOTSTRAP_BRUCK_MAX_SIZE_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "1048576");
+
+  NCCL_BOOTSTRAP_BRUCK_MIN_RANKS = env2num<int>("NCCL_BOOTSTRAP_BRUCK_MIN_RANKS", "16");
+  NCCL_BOOTSTRAP_BRUCK_MIN_RANKS_DEFAULT = env2num<int>("NCCL_ENV_DO_NOT_SET", "16");
+
   NCCL_BUFFSIZE = env2num<int64_t>("NCCL_BUFFSIZE", "-2");
   NCCL_BUFFSIZE_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "-2");
 
@@ -776,9 +906,54 @@ void readCvarEnv() {
   NCCL_COLLTRACE_DEFAULT.clear();
   NCCL_COLLTRACE_DEFAULT = env2strlist("NCCL_ENV_DO_NOT_SET", "");
 
+  NCCL_COLLTRACE_BINARY_RECORDS = env2num<int64_t>("NCCL_COLLTRACE_BINARY_RECORDS", "1048576");
+  NCCL_COLLTRACE_BINARY_RECORDS_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "1048576");
+
   NCCL_COLLTRACE_DIR = env2str("NCCL_COLLTRACE_DIR", "");
   NCCL_COLLTRACE_DIR_DEFAULT = env2str("NCCL_ENV_DO_NOT_SET", "");
 
+  if (getenv("NCCL_COLLTRACE_FILE_FORMAT") == nullptr) {
+    NCCL_COLLTRACE_FILE_FORMAT = NCCL_COLLTRACE_FILE_FORMAT::json;
+  } else {
+    std::string str(getenv("NCCL_COLLTRACE_FILE_FORMAT"));
+    if (str == std::string("json")) {
+      NCCL_COLLTRACE_FILE_FORMAT = NCCL_COLLTRACE_FILE_FORMAT::json;
+    } else if (str == std::string("binary")) {
+      NCCL_COLLTRACE_FILE_FORMAT = NCCL_COLLTRACE_FILE_FORMAT::binary;
+    } else {
+      CVAR_WARN_UNKNOWN_VALUE("NCCL_COLLTRACE_FILE_FORMAT", str.c_str());
+    }
+  }
+  NCCL_COLLTRACE_FILE_FORMAT_DEFAULT = NCCL_COLLTRACE_FILE_FORMAT::json;
+
+  NCCL_COLLTRACE_RECORD_MAX = env2num<int64_t>("NCCL_COLLTRACE_RECORD_MAX", "20000");
+  NCCL_COLLTRACE_RECORD_MAX_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "20000");
+
+  NCCL_COLLTRACE_RECORD_MAX_BYTES = env2num<int64_t>("NCCL_COLLTRACE_RECORD_MAX_BYTES", "16777216");
+  NCCL_COLLTRACE_RECORD_MAX_BYTES_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "16777216");
+
+  NCCL_COLLTRACE_SAMPLE_INTERVAL = env2num<int64_t>("NCCL_COLLTRACE_SAMPLE_INTERVAL", "100");
+  NCCL_COLLTRACE_SAMPLE_INTERVAL_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "100");
+
+  NCCL_COLLTRACE_SAMPLE_RATE = env2num<int64_t>("NCCL_COLLTRACE_SAMPLE_RATE", "100");
+  NCCL_COLLTRACE_SAMPLE_RATE_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "100");
+
+  if (getenv("NCCL_COLLTRACE_SAMPLING") == nullptr) {
+    NCCL_COLLTRACE_SAMPLING = NCCL_COLLTRACE_SAMPLING::none;
+  } else {
+    std::string str(getenv("NCCL_COLLTRACE_SAMPLING"));
+    if (str == std::string("none")) {
+      NCCL_COLLTRACE_SAMPLING = NCCL_COLLTRACE_SAMPLING::none;
+    } else if (str == std::string("fixed")) {
+      NCCL_COLLTRACE_SAMPLING = NCCL_COLLTRACE_SAMPLING::fixed;
+    } else if (str == std::string("adaptive")) {
+      NCCL_COLLTRACE_SAMPLING = NCCL_COLLTRACE_SAMPLING::adaptive;
+    } else {
+      CVAR_WARN_UNKNOWN_VALUE("NCCL_COLLTRACE_SAMPLING", str.c_str());
+    }
+  }
+  NCCL_COLLTRACE_SAMPLING_DEFAULT = NCCL_COLLTRACE_SAMPLING::none;
+
   NCCL_COMM_BLOCKING = env2num<int64_t>("NCCL_COMM_BLOCKING", "-1");
   NCCL_COMM_BLOCKING_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "-1");
 
@@ -821,6 +996,8 @@ void readCvarEnv() {
     for (auto token : tokens) {
       if (token == std::string("ib")) {
         NCCL_CTRAN_BACKENDS.emplace_back(NCCL_CTRAN_BACKENDS::ib);
+      } else if (token == std::string("socket")) {
+        NCCL_CTRAN_BACKENDS.emplace_back(NCCL_CTRAN_BACKENDS::socket);
       } else {
         CVAR_WARN_UNKNOWN_VALUE("NCCL_CTRAN_BACKENDS", token.c_str());
       }
@@ -829,6 +1006,15 @@ void readCvarEnv() {
   NCCL_CTRAN_BACKENDS_DEFAULT.clear();
   NCCL_CTRAN_BACKENDS_DEFAULT.emplace_back(NCCL_CTRAN_BACKENDS::ib);
 
+  NCCL_CTRAN_GPE_CMD_QUEUE_SIZE = env2num<int>("NCCL_CTRAN_GPE_CMD_QUEUE_SIZE", "1024");
+  NCCL_CTRAN_GPE_CMD_QUEUE_SIZE_DEFAULT = env2num<int>("NCCL_ENV_DO_NOT_SET", "1024");
+
+  NCCL_CTRAN_GPE_LATENCY_STATS = env2bool("NCCL_CTRAN_GPE_LATENCY_STATS", "False");
+  NCCL_CTRAN_GPE_LATENCY_STATS_DEFAULT = env2bool("NCCL_ENV_DO_NOT_SET", "False");
+
+  NCCL_CTRAN_GPE_SPIN_USEC = env2num<int>("NCCL_CTRAN_GPE_SPIN_USEC", "50");
+  NCCL_CTRAN_GPE_SPIN_USEC_DEFAULT = env2num<int>("NCCL_ENV_DO_NOT_SET", "50");
+
   NCCL_CTRAN_IB_CTRL_TC = env2num<uint64_t>("NCCL_CTRAN_IB_CTRL_TC", "192");
   NCCL_CTRAN_IB_CTRL_TC_DEFAULT = env2num<uint64_t>("NCCL_ENV_DO_NOT_SET", "192");
 
@@ -853,6 +1039,8 @@ void readCvarEnv() {
     std::string str(getenv("NCCL_CTRAN_PROFILING"));
     if (str == std::string("none")) {
       NCCL_CTRAN_PROFILING = NCCL_CTRAN_PROFILING::none;
+    } else if (str == std::string("stats")) {
+      NCCL_CTRAN_PROFILING = NCCL_CTRAN_PROFILING::stats;
     } else if (str == std::string("stdout")) {
       NCCL_CTRAN_PROFILING = NCCL_CTRAN_PROFILING::stdout;
     } else if (str == std::string("info")) {
@@ -896,6 +1084,18 @@ void readCvarEnv() {
   NCCL_CTRAN_SHARED_DEVBUF_SIZE = env2num<uint64_t>("NCCL_CTRAN_SHARED_DEVBUF_SIZE", "8388608");
   NCCL_CTRAN_SHARED_DEVBUF_SIZE_DEFAULT = env2num<uint64_t>("NCCL_ENV_DO_NOT_SET", "8388608");
 
+  NCCL_CTRAN_SOCKET_CHUNK_SIZE = env2num<uint64_t>("NCCL_CTRAN_SOCKET_CHUNK_SIZE", "1048576");
+  NCCL_CTRAN_SOCKET_CHUNK_SIZE_DEFAULT = env2num<uint64_t>("NCCL_ENV_DO_NOT_SET", "1048576");
+
+  NCCL_CTRAN_SOCKET_NUM_STREAMS = env2num<int>("NCCL_CTRAN_SOCKET_NUM_STREAMS", "2");
+  NCCL_CTRAN_SOCKET_NUM_STREAMS_DEFAULT = env2num<int>("NCCL_ENV_DO_NOT_SET", "2");
+
+  NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD = env2num<uint64_t>("NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD", "1048576");
+  NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD_DEFAULT = env2num<uint64_t>("NCCL_ENV_DO_NOT_SET", "1048576");
+
+  NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD = env2num<int64_t>("NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD", "65536");
+  NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "65536");
+
   NCCL_CTRAN_TOPO_FILE = env2str("NCCL_CTRAN_TOPO_FILE", "");
   NCCL_CTRAN_TOPO_FILE_DEFAULT = env2str("NCCL_ENV_DO_NOT_SET", "");
 
@@ -1059,12 +1259,17 @@ void readCvarEnv() {
       NCCL_LOGGER_MODE = NCCL_LOGGER_MODE::sync;
     } else if (str == std::string("async")) {
       NCCL_LOGGER_MODE = NCCL_LOGGER_MODE::async;
+    } else if (str == std::string("ring")) {
+      NCCL_LOGGER_MODE = NCCL_LOGGER_MODE::ring;
     } else {
       CVAR_WARN_UNKNOWN_VALUE("NCCL_LOGGER_MODE", str.c_str());
     }
   }
   NCCL_LOGGER_MODE_DEFAULT = NCCL_LOGGER_MODE::sync;
 
+  NCCL_LOGGER_RING_SIZE = env2num<int64_t>("NCCL_LOGGER_RING_SIZE", "262144");
+  NCCL_LOGGER_RING_SIZE_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "262144");
+
   NCCL_MAX_CTAS = env2num<int64_t>("NCCL_MAX_CTAS", "-1");
   NCCL_MAX_CTAS_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "-1");
 
@@ -1091,6 +1296,28 @@ void readCvarEnv() {
   }
   NCCL_MEM_SYNC_DOMAIN_DEFAULT = NCCL_MEM_SYNC_DOMAIN::remote;
 
+  if (getenv("NCCL_METRICS_EXPORT") == nullptr) {
+    NCCL_METRICS_EXPORT = NCCL_METRICS_EXPORT::none;
+  } else {
+    std::string str(getenv("NCCL_METRICS_EXPORT"));
+    if (str == std::string("none")) {
+      NCCL_METRICS_EXPORT = NCCL_METRICS_EXPORT::none;
+    } else if (str == std::string("file")) {
+      NCCL_METRICS_EXPORT = NCCL_METRICS_EXPORT::file;
+    } else if (str == std::string("socket")) {
+      NCCL_METRICS_EXPORT = NCCL_METRICS_EXPORT::socket;
+    } else {
+      CVAR_WARN_UNKNOWN_VALUE("NCCL_METRICS_EXPORT", str.c_str());
+    }
+  }
+  NCCL_METRICS_EXPORT_DEFAULT = NCCL_METRICS_EXPORT::none;
+
+  NCCL_METRICS_INTERVAL_MS = env2num<int64_t>("NCCL_METRICS_INTERVAL_MS", "1000");
+  NCCL_METRICS_INTERVAL_MS_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "1000");
+
+  NCCL_METRICS_PATH = env2str("NCCL_METRICS_PATH", "");
+  NCCL_METRICS_PATH_DEFAULT = env2str("NCCL_ENV_DO_NOT_SET", "");
+
   NCCL_MIN_CTAS = env2num<int64_t>("NCCL_MIN_CTAS", "-1");
   NCCL_MIN_CTAS_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "-1");
 
@@ -1197,18 +1424,64 @@ void readCvarEnv() {
   NCCL_PROXYTRACE_DEFAULT.clear();
   NCCL_PROXYTRACE_DEFAULT = env2strlist("NCCL_ENV_DO_NOT_SET", "");
 
+  NCCL_PROXYTRACE_RECORD_MAX = env2num<int64_t>("NCCL_PROXYTRACE_RECORD_MAX", "20000");
+  NCCL_PROXYTRACE_RECORD_MAX_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "20000");
+
+  NCCL_PROXYTRACE_RECORD_MAX_BYTES = env2num<int64_t>("NCCL_PROXYTRACE_RECORD_MAX_BYTES", "4194304");
+  NCCL_PROXYTRACE_RECORD_MAX_BYTES_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "4194304");
+
+  NCCL_PROXYTRACE_RING_SIZE = env2num<int64_t>("NCCL_PROXYTRACE_RING_SIZE", "65536");
+  NCCL_PROXYTRACE_RING_SIZE_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "65536");
+
+  NCCL_PROXYTRACE_TIMELINE_RECORD_MAX = env2num<int64_t>("NCCL_PROXYTRACE_TIMELINE_RECORD_MAX", "1048576");
+  NCCL_PROXYTRACE_TIMELINE_RECORD_MAX_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "1048576");
+
   NCCL_PROXY_APPEND_BATCH_SIZE = env2num<int64_t>("NCCL_PROXY_APPEND_BATCH_SIZE", "16");
   NCCL_PROXY_APPEND_BATCH_SIZE_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "16");
 
   NCCL_PROXY_DUMP_SIGNAL = env2num<int64_t>("NCCL_PROXY_DUMP_SIGNAL", "-1");
   NCCL_PROXY_DUMP_SIGNAL_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "-1");
 
+  if (getenv("NCCL_PROXY_IDLE_POLICY") == nullptr) {
+    NCCL_PROXY_IDLE_POLICY = NCCL_PROXY_IDLE_POLICY::hybrid;
+  } else {
+    std::string str(getenv("NCCL_PROXY_IDLE_POLICY"));
+    if (str == std::string("sleep")) {
+      NCCL_PROXY_IDLE_POLICY = NCCL_PROXY_IDLE_POLICY::sleep;
+    } else if (str == std::string("spin")) {
+      NCCL_PROXY_IDLE_POLICY = NCCL_PROXY_IDLE_POLICY::spin;
+    } else if (str == std::string("hybrid")) {
+      NCCL_PROXY_IDLE_POLICY = NCCL_PROXY_IDLE_POLICY::hybrid;
+    } else {
+      CVAR_WARN_UNKNOWN_VALUE("NCCL_PROXY_IDLE_POLICY", str.c_str());
+    }
+  }
+  NCCL_PROXY_IDLE_POLICY_DEFAULT = NCCL_PROXY_IDLE_POLICY::hybrid;
+
+  NCCL_PROXY_IDLE_SPIN_MAX_NS = env2num<int64_t>("NCCL_PROXY_IDLE_SPIN_MAX_NS", "50000");
+  NCCL_PROXY_IDLE_SPIN_MAX_NS_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "50000");
+
+  NCCL_PROXY_IDLE_SPIN_MIN_NS = env2num<int64_t>("NCCL_PROXY_IDLE_SPIN_MIN_NS", "1000");
+  NCCL_PROXY_IDLE_SPIN_MIN_NS_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "1000");
+
+  NCCL_PROXY_OP_RECORD_FILE = env2str("NCCL_PROXY_OP_RECORD_FILE", "");
+  NCCL_PROXY_OP_RECORD_FILE_DEFAULT = env2str("NCCL_ENV_DO_NOT_SET", "");
+
   NCCL_PROXY_PROFILE = env2str("NCCL_PROXY_PROFILE", "");
   NCCL_PROXY_PROFILE_DEFAULT = env2str("NCCL_ENV_DO_NOT_SET", "");
 
   NCCL_PROXY_PROFILE_DIR = env2str("NCCL_PROXY_PROFILE_DIR", "/tmp");
   NCCL_PROXY_PROFILE_DIR_DEFAULT = env2str("NCCL_ENV_DO_NOT_SET", "/tmp");
 
+  NCCL_PROXY_PROGRESS_NUMA_PIN = env2bool("NCCL_PROXY_PROGRESS_NUMA_PIN", "True");
+  NCCL_PROXY_PROGRESS_NUMA_PIN_DEFAULT = env2bool("NCCL_ENV_DO_NOT_SET", "True");
+
+  NCCL_PROXY_PROGRESS_THREADS = env2num<int64_t>("NCCL_PROXY_PROGRESS_THREADS", "1");
+  NCCL_PROXY_PROGRESS_THREADS_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "1");
+
+  NCCL_PROXY_RPC_BATCH_SIZE = env2num<int64_t>("NCCL_PROXY_RPC_BATCH_SIZE", "128");
+  NCCL_PROXY_RPC_BATCH_SIZE_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "128");
+
   NCCL_PXN_DISABLE = env2num<int64_t>("NCCL_PXN_DISABLE", "0");
   NCCL_PXN_DISABLE_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "0");
 
@@ -1253,6 +1526,9 @@ void readCvarEnv() {
   NCCL_SOCKET_NTHREADS = env2num<int64_t>("NCCL_SOCKET_NTHREADS", "-2");
   NCCL_SOCKET_NTHREADS_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "-2");
 
+  NCCL_SOCKET_ZCOPY_THRESHOLD = env2num<int64_t>("NCCL_SOCKET_ZCOPY_THRESHOLD", "-1");
+  NCCL_SOCKET_ZCOPY_THRESHOLD_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "-1");
+
   NCCL_THREAD_THRESHOLDS = env2str("NCCL_THREAD_THRESHOLDS", "");
   NCCL_THREAD_THRESHOLDS_DEFAULT = env2str("NCCL_ENV_DO_NOT_SET", "");
 
@@ -1265,6 +1541,15 @@ void readCvarEnv() {
   NCCL_TOPO_FILE = env2str("NCCL_TOPO_FILE", "/var/run/nvidia-topologyd/virtualTopology.xml");
   NCCL_TOPO_FILE_DEFAULT = env2str("NCCL_ENV_DO_NOT_SET", "/var/run/nvidia-topologyd/virtualTopology.xml");
 
+  NCCL_TOPO_SEARCH_CACHE = env2num<int64_t>("NCCL_TOPO_SEARCH_CACHE", "1");
+  NCCL_TOPO_SEARCH_CACHE_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "1");
+
+  NCCL_TOPO_SEARCH_CACHE_DIR = env2str("NCCL_TOPO_SEARCH_CACHE_DIR", "");
+  NCCL_TOPO_SEARCH_CACHE_DIR_DEFAULT = env2str("NCCL_ENV_DO_NOT_SET", "");
+
+  NCCL_TOPO_SEARCH_THREADS = env2num<int64_t>("NCCL_TOPO_SEARCH_THREADS", "1");
+  NCCL_TOPO_SEARCH_THREADS_DEFAULT = env2num<int64_t>("NCCL_ENV_DO_NOT_SET", "1");
+
   NCCL_TUNER_PLUGIN = env2str("NCCL_TUNER_PLUGIN", "");
   NCCL_TUNER_PLUGIN_DEFAULT = env2str("NCCL_ENV_DO_NOT_SET", "");
 
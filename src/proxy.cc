@@ -10,6 +10,7 @@
 #include "socket.h"
 #include "shm.h"
 #include "profiler.h"
+#include "cpuset.h"
 
 /*
 === BEGIN_NCCL_CVAR_INFO_BLOCK ===
@@ -45,6 +46,71 @@
    description : |-
      Hidden variable. No description provided.
 
+ - name        : NCCL_PROXY_PROGRESS_THREADS
+   type        : int64_t
+   default     : 1
+   description : |-
+     Number of progress threads of each proxy, capped by the number of NICs.
+     The ops of net connections are spread over the threads by NIC, or by
+     channel for connections sharing buffers (see NCCL_NET_SHARED_BUFFERS).
+     The first thread reads the ops posted to the proxy, routes them, and
+     progresses all other ops. Not supported with NCCL_PROXYTRACE=ring, which
+     falls back to one thread.
+
+ - name        : NCCL_PROXY_PROGRESS_NUMA_PIN
+   type        : bool
+   default     : true
+   description : |-
+     With more than one progress thread, pin each of them to the CPUs of the
+     NUMA node closest to its NICs. Otherwise progress threads inherit the CPU
+     affinity of the GPU.
+
+ - name        : NCCL_PROXY_IDLE_POLICY
+   type        : enum
+   default     : hybrid
+   choices     : sleep, spin, hybrid
+   description : |-
+     How a progress thread waits for new ops when it has nothing to progress.
+     sleep - Sleep on a futex until ops are posted.
+     spin - Busy poll, burning a CPU core per progress thread for the lowest
+     latency.
+     hybrid - Spin for a while, then sleep. The spin time adapts between
+     NCCL_PROXY_IDLE_SPIN_MIN_NS and NCCL_PROXY_IDLE_SPIN_MAX_NS: it doubles
+     when ops arrive while spinning and halves when the thread had to sleep.
+
+ - name        : NCCL_PROXY_IDLE_SPIN_MIN_NS
+   type        : int64_t
+   default     : 1000
+   description : |-
+     Minimum spin time in nanoseconds of an idle progress thread before it
+     sleeps, with NCCL_PROXY_IDLE_POLICY=hybrid.
+
+ - name        : NCCL_PROXY_IDLE_SPIN_MAX_NS
+   type        : int64_t
+   default     : 50000
+   description : |-
+     Maximum spin time in nanoseconds of an idle progress thread before it
+     sleeps, with NCCL_PROXY_IDLE_POLICY=hybrid.
+
+ - name        : NCCL_PROXY_OP_RECORD_FILE
+   type        : string
+   default     : ""
+   description : |-
+     Record the ops appended by each progress thread to
+     <NCCL_PROXY_OP_RECORD_FILE>.<pid>.<cudaDev>, one line per op, to be
+     replayed by tests/ProxyReplayBench. Empty to disable.
+
+ - name        : NCCL_PROXY_RPC_BATCH_SIZE
+   type        : int64_t
+   default     : 128
+   description : |-
+     Maximum number of proxy calls of connection setup in flight from a rank
+     to the proxies, packed in one send per proxy, and number of calls the
+     proxy service receives from a rank before sending their responses at
+     once. Calls in flight are also limited to 64KB of requests and responses,
+     so that they fit in the socket buffers. 1 makes connection setup wait for
+     each call in turn.
+
 === END_NCCL_CVAR_INFO_BLOCK ===
 */
 
@@ -62,7 +128,9 @@
 #include "timer.h"
 
 #include <sys/syscall.h>
+#include <linux/futex.h>
 #include <assert.h>
+#include <algorithm>
 
 enum { proxyRecv=0, proxySend=1 };
 
@@ -81,175 +149,207 @@ static bool NeedProxy(int type, int pattern, int root, struct ncclRing* ring, in
 }
 
 #define PROXYARGS_ALLOCATE_SIZE NCCL_MAX_OPS
-struct ncclProxyPool {
-  struct ncclProxyPool *next;
-  struct ncclProxyArgs elems[PROXYARGS_ALLOCATE_SIZE];
+#define PROXYSUBS_ALLOCATE_SIZE 256
+// Memory block of ops and subs, its elements follow the header. Slabs are
+// only released with the progress state.
+struct alignas(64) ncclProxySlab {
+  struct ncclProxySlab *next;
+  int nArgs; // Number of ops in the slab, 0 for a slab of subs
+};
+// Free array of subs, overlaid on its first sub
+struct ncclProxySubsFree {
+  struct ncclProxySubsFree *next;
 };
 
-static void expectedProxyResponseFree(struct ncclProxyState* state) {
-  struct ncclExpectedProxyResponse* elem = state->expectedResponses;
-  struct ncclExpectedProxyResponse* prev = NULL;
+static inline uint32_t expectedProxyResponseHash(void* opId, int size) {
+  // opIds are heap addresses, drop the alignment bits
+  uint64_t h = ((uint64_t)opId >> 4) * 0x9E3779B97F4A7C15ULL;
+  return (uint32_t)(h >> 32) & (size-1);
+}
 
-  while (elem) {
-    prev = elem;
-    elem = elem->next;
-    free(prev->respBuff);
-    free(prev);
+static struct ncclExpectedProxyResponse* expectedProxyResponseFind(struct ncclProxyState* state, void* opId) {
+  struct ncclExpectedProxyResponses* table = &state->expectedResponses;
+  if (table->count == 0) return NULL;
+  for (uint32_t i = expectedProxyResponseHash(opId, table->size); table->slots[i].opId; i = (i+1) & (table->size-1)) {
+    if (table->slots[i].opId == opId) return table->slots+i;
   }
+  return NULL;
 }
 
-static ncclResult_t expectedProxyResponseStore(struct ncclProxyState* state, void* opId, void* respBuff, int respSize) {
-  struct ncclExpectedProxyResponse* elem = state->expectedResponses;
-  while (elem) {
-    if (elem->opId == opId) {
-      if (respSize != elem->respSize) {
-        WARN("Mismatched response size for opId=%p", opId);
-        return ncclInternalError;
-      }
-
-      if (elem->done) {
-        WARN("Storing response for already completed opId=%p", opId);
-        return ncclInternalError;
-      }
-
-      memcpy(elem->respBuff, respBuff, respSize);
-      free(respBuff);
-      elem->done = true;
-      return ncclSuccess;
+// Free the slot of a response, shifting back the following slots of its probe sequence
+static void expectedProxyResponseErase(struct ncclProxyState* state, struct ncclExpectedProxyResponse* elem) {
+  struct ncclExpectedProxyResponses* table = &state->expectedResponses;
+  uint32_t mask = table->size-1;
+  uint32_t hole = elem - table->slots;
+  free(elem->respBuff);
+  for (uint32_t i = (hole+1) & mask; table->slots[i].opId; i = (i+1) & mask) {
+    uint32_t home = expectedProxyResponseHash(table->slots[i].opId, table->size);
+    // Move the slot to the hole if the hole is on its probe sequence, from home to i
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      table->slots[hole] = table->slots[i];
+      hole = i;
     }
-    elem = elem->next;
   }
+  memset(table->slots+hole, 0, sizeof(struct ncclExpectedProxyResponse));
+  table->count--;
+}
 
-  WARN("Proxy response for opId=%p doesn't match any expected response", opId);
-  return ncclInternalError;
+static void expectedProxyResponseFree(struct ncclProxyState* state) {
+  struct ncclExpectedProxyResponses* table = &state->expectedResponses;
+  for (int i = 0; i < table->size; i++) {
+    if (table->slots[i].opId) free(table->slots[i].respBuff);
+  }
+  free(table->slots);
+  memset(table, 0, sizeof(*table));
+}
+
+// Mark the response of an expected opId as received. The response was received in the buffer of
+// its table slot.
+static ncclResult_t expectedProxyResponseStore(struct ncclProxyState* state, void* opId, int respSize) {
+  struct ncclExpectedProxyResponse* elem = expectedProxyResponseFind(state, opId);
+  if (elem == NULL) {
+    WARN("Proxy response for opId=%p doesn't match any expected response", opId);
+    return ncclInternalError;
+  }
+  if (respSize != elem->respSize) {
+    WARN("Mismatched response size for opId=%p", opId);
+    return ncclInternalError;
+  }
+  if (elem->done) {
+    WARN("Storing response for already completed opId=%p", opId);
+    return ncclInternalError;
+  }
+  elem->done = true;
+  return ncclSuccess;
 }
 
 static ncclResult_t expectedProxyResponseEnqueue(struct ncclProxyState* state, void* opId, int respSize) {
-  struct ncclExpectedProxyResponse* ex;
-  NCCLCHECK(ncclCalloc(&ex, 1));
+  struct ncclExpectedProxyResponses* table = &state->expectedResponses;
+  // Keep the load factor under 1/2
+  if (2*(table->count+1) > table->size) {
+    struct ncclExpectedProxyResponses old = *table;
+    table->size = old.size ? 2*old.size : 64;
+    table->count = 0;
+    NCCLCHECK(ncclCalloc(&table->slots, table->size));
+    for (int i = 0; i < old.size; i++) {
+      if (old.slots[i].opId == NULL) continue;
+      uint32_t j = expectedProxyResponseHash(old.slots[i].opId, table->size);
+      while (table->slots[j].opId) j = (j+1) & (table->size-1);
+      table->slots[j] = old.slots[i];
+      table->count++;
+    }
+    free(old.slots);
+  }
+  uint32_t i = expectedProxyResponseHash(opId, table->size);
+  while (table->slots[i].opId) {
+    if (table->slots[i].opId == opId) {
+      WARN("Proxy call opId=%p is already pending", opId);
+      return ncclInternalError;
+    }
+    i = (i+1) & (table->size-1);
+  }
+  struct ncclExpectedProxyResponse* ex = table->slots+i;
   ex->opId = opId;
 
   // Pre-alloc response buffer
   ex->respBuff = malloc(respSize);
   ex->respSize = respSize;
   ex->done     = false;
-
-  // Enqueue
-  struct ncclExpectedProxyResponse* list = state->expectedResponses;
-  if (list == NULL) {
-    state->expectedResponses = ex;
-    return ncclSuccess;
-  }
-  while (list->next) list = list->next;
-  list->next = ex;
+  table->count++;
   return ncclSuccess;
 }
 
 static ncclResult_t expectedProxyResponseDequeue(struct ncclProxyState* state, void* opId, void* respBuff, int* found) {
-  struct ncclExpectedProxyResponse* elem = state->expectedResponses;
-  struct ncclExpectedProxyResponse* prev = NULL;
+  struct ncclExpectedProxyResponse* elem = expectedProxyResponseFind(state, opId);
   *found = 0;
-  while (elem) {
-    if ((elem->opId == opId) && elem->done) {
-      if (prev == NULL) {
-        state->expectedResponses = elem->next;
-      } else {
-        prev->next = elem->next;
-      }
-      memcpy(respBuff, elem->respBuff, elem->respSize);
-      free(elem->respBuff);
-      free(elem);
-      *found = 1;
-      return ncclSuccess;
-    }
-    prev = elem;
-    elem = elem->next;
+  if (elem && elem->done) {
+    if (elem->respSize) memcpy(respBuff, elem->respBuff, elem->respSize);
+    expectedProxyResponseErase(state, elem);
+    *found = 1;
   }
   return ncclSuccess;
 }
 
 static ncclResult_t expectedProxyResponseRemove(struct ncclProxyState* state, void* opId) {
-  struct ncclExpectedProxyResponse* elem = state->expectedResponses;
-  struct ncclExpectedProxyResponse* prev = NULL;
-  while (elem) {
-    if (elem->opId == opId) {
-      if (prev == NULL) {
-        state->expectedResponses = elem->next;
-      } else {
-        prev->next = elem->next;
-      }
-      free(elem->respBuff);
-      free(elem);
-      return ncclSuccess;
-    }
-    prev = elem;
-    elem = elem->next;
+  struct ncclExpectedProxyResponse* elem = expectedProxyResponseFind(state, opId);
+  if (elem == NULL) {
+    WARN("Couldn't find opId=%p", opId);
+    return ncclInternalError;
   }
-  WARN("Couldn't find opId=%p", opId);
-  return ncclInternalError;
+  expectedProxyResponseErase(state, elem);
+  return ncclSuccess;
 }
 
 static ncclResult_t asyncProxyOpEnqueue(struct ncclProxyLocalPeer* peer, ncclProxyAsyncOp* op) {
-  ncclProxyAsyncOp* list = peer->asyncOps;
-  if (list == NULL) {
+  op->next = NULL;
+  op->prev = peer->asyncOpsTail;
+  if (peer->asyncOpsTail) {
+    peer->asyncOpsTail->next = op;
+  } else {
     peer->asyncOps = op;
-    return ncclSuccess;
   }
-  while (list->next) list = list->next;
-  list->next = op;
+  peer->asyncOpsTail = op;
   return ncclSuccess;
 }
 
 static ncclResult_t asyncProxyOpDequeue(struct ncclProxyLocalPeer* peer, ncclProxyAsyncOp* op) {
-  struct ncclProxyAsyncOp* elem = peer->asyncOps;
-  struct ncclProxyAsyncOp* prev = NULL;
-  while (elem) {
-    if (elem->opId == op->opId) {
-      if (prev == NULL) {
-        peer->asyncOps = elem->next;
-      } else {
-        prev->next = elem->next;
-      }
-
-      if (elem->reqBuff) {
-        free(elem->reqBuff);
-      }
-      if (elem->respBuff) {
-        free(elem->respBuff);
-      }
-      free(elem);
-
-      return ncclSuccess;
-    }
-    prev = elem;
-    elem = elem->next;
+  if (op == NULL) {
+    WARN("Attempting to dequeue null operation");
+    return ncclInternalError;
   }
-  if (op) {
-    WARN("Attempting to dequeue nonexistent async opId=%p", op->opId);
+  if (op->prev) {
+    op->prev->next = op->next;
   } else {
-    WARN("Attempting to dequeue null operation");
+    peer->asyncOps = op->next;
   }
-  return ncclInternalError;
+  if (op->next) {
+    op->next->prev = op->prev;
+  } else {
+    peer->asyncOpsTail = op->prev;
+  }
+
+  if (op->reqBuff) {
+    free(op->reqBuff);
+  }
+  if (op->respBuff) {
+    free(op->respBuff);
+  }
+  free(op);
+  return ncclSuccess;
+}
+
+// Allocate a slab of size bytes of elements, cache line aligned.
+static ncclResult_t proxySlabAlloc(struct ncclProxyProgressState* state, size_t size, int nArgs, void** elems) {
+  struct ncclProxySlab* slab;
+  if (posix_memalign((void**)&slab, alignof(struct ncclProxySlab), sizeof(struct ncclProxySlab)+size) != 0) {
+    WARN("Failed to allocate %ld bytes of proxy ops", sizeof(struct ncclProxySlab)+size);
+    return ncclSystemError;
+  }
+  memset(slab, 0, sizeof(struct ncclProxySlab)+size);
+  slab->nArgs = nArgs;
+  slab->next = state->slabs;
+  state->slabs = slab;
+  *elems = slab+1;
+  return ncclSuccess;
 }
 
 static ncclResult_t allocateArgs(struct ncclProxyProgressState* state, struct ncclProxyArgs** argsptr) {
   struct ncclProxyArgs* elem;
   if (state->pool == NULL) {
-    // Allocate a new pool of elements. Make sure we allocate the memory close
-    // to the network thread
-    struct ncclProxyPool* newPool;
-    NCCLCHECK(ncclCalloc(&newPool, 1));
-
-    struct ncclProxyArgs* newElems = newPool->elems;
+    // Allocate a new slab of elements, each with room for one sub. Make sure we
+    // allocate the memory close to the network thread
+    struct ncclProxyArgs* newElems;
+    NCCLCHECK(proxySlabAlloc(state, PROXYARGS_ALLOCATE_SIZE*(sizeof(struct ncclProxyArgs)+sizeof(struct ncclProxySubArgs)),
+          PROXYARGS_ALLOCATE_SIZE, (void**)&newElems));
+    struct ncclProxySubArgs* newSubs = (struct ncclProxySubArgs*)(newElems+PROXYARGS_ALLOCATE_SIZE);
     // Chain newly allocated elements
     for (int i=0; i<PROXYARGS_ALLOCATE_SIZE; i++) {
+      newElems[i].subs = newSubs+i;
+      newElems[i].subsClass = 0;
       if (i+1 < PROXYARGS_ALLOCATE_SIZE) newElems[i].next = newElems+i+1;
     }
     // Add them all to the pool list
     state->pool = newElems;
-    // Save the pool memory block for later resource release
-    newPool->next = state->pools;
-    state->pools = newPool;
   }
   elem = state->pool;
   state->pool = state->pool->next;
@@ -258,6 +358,44 @@ static ncclResult_t allocateArgs(struct ncclProxyProgressState* state, struct nc
   return ncclSuccess;
 }
 
+// Grow the subs of args to the next class. Only called before the op starts
+// progressing, so that no progress function holds a pointer to its subs.
+static ncclResult_t growSubs(struct ncclProxyProgressState* state, struct ncclProxyArgs* args) {
+  int subsClass = args->subsClass+1;
+  if (subsClass >= NCCL_PROXY_SUBS_CLASSES) return ncclInternalError;
+  struct ncclProxySubsFree* elem = state->freeSubs[subsClass];
+  if (elem == NULL) {
+    int nSubs = 1 << subsClass;
+    int nArrays = std::max(1, PROXYSUBS_ALLOCATE_SIZE / nSubs);
+    struct ncclProxySubArgs* newSubs;
+    NCCLCHECK(proxySlabAlloc(state, nArrays*nSubs*sizeof(struct ncclProxySubArgs), 0, (void**)&newSubs));
+    for (int i=0; i<nArrays; i++) {
+      struct ncclProxySubsFree* array = (struct ncclProxySubsFree*)(newSubs+i*nSubs);
+      array->next = elem;
+      elem = array;
+    }
+  }
+  state->freeSubs[subsClass] = elem->next;
+  struct ncclProxySubArgs* subs = (struct ncclProxySubArgs*)elem;
+  memcpy(subs, args->subs, sizeof(struct ncclProxySubArgs) << args->subsClass);
+  struct ncclProxySubsFree* oldSubs = (struct ncclProxySubsFree*)args->subs;
+  oldSubs->next = state->freeSubs[args->subsClass];
+  state->freeSubs[args->subsClass] = oldSubs;
+  args->subs = subs;
+  args->subsClass = subsClass;
+  return ncclSuccess;
+}
+
+void ncclProxyFreeOps(struct ncclProxyProgressState* state) {
+  while (state->slabs != NULL) {
+    struct ncclProxySlab* next = state->slabs->next;
+    free(state->slabs);
+    state->slabs = next;
+  }
+  state->pool = NULL;
+  for (int c = 0; c < NCCL_PROXY_SUBS_CLASSES; c++) state->freeSubs[c] = NULL;
+}
+
 //#define DEBUG_PROXY 1
 #ifdef DEBUG_PROXY
 #define DEBUG_PROXY_PRINT printf
@@ -265,26 +403,36 @@ static ncclResult_t allocateArgs(struct ncclProxyProgressState* state, struct nc
 #define DEBUG_PROXY_PRINT(...)
 #endif
 
-#define OP_INDEX(op) ((op) ? (op)-state->pools->elems : -1)
 #define OP_SEEN 0x100000
 
 ncclResult_t getOpIndex(struct ncclProxyArgs* op, struct ncclProxyProgressState* state, int* poolIndex, int* opIndex) {
-  struct ncclProxyPool* pool = state->pools;
+  struct ncclProxySlab* slab = state->slabs;
   int p = 0;
-  while (pool) {
-    uint64_t o = op-pool->elems;
-    if (o < PROXYARGS_ALLOCATE_SIZE) {
+  while (slab) {
+    if (slab->nArgs == 0) {
+      slab = slab->next;
+      continue;
+    }
+    uint64_t o = op-(struct ncclProxyArgs*)(slab+1);
+    if (o < (uint64_t)slab->nArgs) {
       *opIndex = o;
       *poolIndex = p;
       return ncclSuccess;
     }
-    pool = pool->next;
+    slab = slab->next;
     p++;
   }
   WARN("Could not find pool of op %p", op);
   return ncclInternalError;
 }
 
+static inline long proxyOpIndex(struct ncclProxyProgressState* state, struct ncclProxyArgs* op) {
+  int poolIndex, opIndex;
+  if (op == NULL || getOpIndex(op, state, &poolIndex, &opIndex) != ncclSuccess) return -1;
+  return (long)poolIndex*PROXYARGS_ALLOCATE_SIZE+opIndex;
+}
+#define OP_INDEX(op) proxyOpIndex(state, op)
+
 ncclResult_t printProxyOp(struct ncclProxyArgs* op, int poolIndex, int opIndex) {
   printf("[%d-%d|%ld| %s", poolIndex, opIndex, op->opCount, op->pattern == ncclPatternSend ? "Send" : op->pattern == ncclPatternRecv ? "Recv" : "Coll");
   for (int s=0; s<op->nsubs; s++) {
@@ -371,11 +519,12 @@ ncclResult_t dumpProxyState(struct ncclProxyProgressState* state) {
   }
 #endif
 
-  struct ncclProxyPool* pool = state->pools;
+  struct ncclProxySlab* slab = state->slabs;
   poolIndex = 0;
-  while (pool) {
-    struct ncclProxyArgs* elem = pool->elems;
-    for (int e=0; e<PROXYARGS_ALLOCATE_SIZE; e++, elem++) {
+  for (; slab; slab = slab->next) {
+    if (slab->nArgs == 0) continue;
+    struct ncclProxyArgs* elem = (struct ncclProxyArgs*)(slab+1);
+    for (int e=0; e<slab->nArgs; e++, elem++) {
       if ((elem->state & OP_SEEN) == 0) {
         printf("Elem %d-%d is not in any list:\n", poolIndex, e);
         NCCLCHECK(printProxyOp(elem, poolIndex, e));
@@ -384,18 +533,22 @@ ncclResult_t dumpProxyState(struct ncclProxyProgressState* state) {
         elem->state -= OP_SEEN;
       }
     }
-    pool = pool->next;
     poolIndex++;
   }
   return ncclSuccess;
 }
 
-static ncclResult_t ncclProxyOpToArgs(struct ncclProxyOp* op, struct ncclProxyArgs* args, int subIndex) {
-  struct ncclProxySubArgs* sub = args->subs+subIndex;
+static ncclResult_t ncclProxyOpToArgs(struct ncclProxyProgressState* state, struct ncclProxyOp* op, struct ncclProxyArgs* args, int subIndex) {
   if (subIndex >= NCCL_PROXY_MAX_SUBS) {
     WARN("Proxy append out of bounds");
     return ncclInternalError;
   }
+  if (subIndex && args->state != ncclProxyOpReady) {
+    WARN("Proxy append on running operation");
+    return ncclInternalError;
+  }
+  if (subIndex >= (1 << args->subsClass)) NCCLCHECK(growSubs(state, args));
+  struct ncclProxySubArgs* sub = args->subs+subIndex;
 
   //memset(sub, 0, sizeof(struct ncclProxySubArgs));
   sub->connection = op->connection;
@@ -416,10 +569,6 @@ static ncclResult_t ncclProxyOpToArgs(struct ncclProxyOp* op, struct ncclProxyAr
       WARN("Proxy append mismatch");
       return ncclInternalError;
     }
-    if (args->state != ncclProxyOpReady) {
-      WARN("Proxy append on running operation");
-      return ncclInternalError;
-    }
     return ncclSuccess;
   }
   //memset(&args->progress, 0, sizeof(struct ncclProxyArgs)-offsetof(struct ncclProxyArgs, progress));
@@ -445,12 +594,12 @@ static ncclResult_t ProxyAppend(struct ncclProxyProgressState* state, struct ncc
 
   if (args) {
     if (shared && args->opCount == op->opCount) {
-      NCCLCHECK(ncclProxyOpToArgs(op, args, args->nsubs));
+      NCCLCHECK(ncclProxyOpToArgs(state, op, args, args->nsubs));
       DEBUG_PROXY_PRINT("Insert (%d/%5ld/%5ld) as group with %5ld\n", shared, args->opCount, op->opCount, OP_INDEX(args));
     } else {
       struct ncclProxyArgs* prevArgs = args;
       NCCLCHECK(allocateArgs(state, &args));
-      NCCLCHECK(ncclProxyOpToArgs(op, args, 0));
+      NCCLCHECK(ncclProxyOpToArgs(state, op, args, 0));
       prevArgs->nextPeer = args;
       DEBUG_PROXY_PRINT("Insert  %5ld (%d/%5ld/%5ld) as nextPeer of %5ld\n", OP_INDEX(args), shared, prevArgs->opCount, args->opCount, OP_INDEX(prevArgs));
       *(args->proxyAppendPtr) = args;
@@ -458,7 +607,7 @@ static ncclResult_t ProxyAppend(struct ncclProxyProgressState* state, struct ncc
   } else {
     // Nothing running for that peer. Add to the list
     NCCLCHECK(allocateArgs(state, &args));
-    NCCLCHECK(ncclProxyOpToArgs(op, args, 0));
+    NCCLCHECK(ncclProxyOpToArgs(state, op, args, 0));
     if (state->active == NULL) {
       // Create the list
       DEBUG_PROXY_PRINT("Insert  %5ld (%d/%5ld) as first element\n", OP_INDEX(args), shared, args->opCount);
@@ -475,19 +624,135 @@ static ncclResult_t ProxyAppend(struct ncclProxyProgressState* state, struct ncc
   return ncclSuccess;
 }
 
-ncclResult_t ncclProxyPost(struct ncclProxyOpsPool* pool, int nextOps, int nextOpsEnd) {
-  pthread_mutex_lock(&pool->mutex);
-  if (pool->nextOps == -1) {
-    pool->nextOps = nextOps;
-    pthread_cond_signal(&pool->cond);
+static inline void proxyCpuPause() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Not FUTEX_PRIVATE_FLAG, the ops pool wakeup is shared between processes
+static inline long proxyFutex(volatile uint32_t* addr, int op, uint32_t val) {
+  return syscall(SYS_futex, addr, op, val, NULL, NULL, 0);
+}
+
+// Wake the progress thread waiting on wakeup, if any. Only makes a syscall
+// when the thread is actually sleeping.
+static void proxyWake(struct ncclProxyWakeup* wakeup) {
+  __atomic_add_fetch(&wakeup->seq, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&wakeup->sleeping, __ATOMIC_SEQ_CST)) {
+    __atomic_store_n(&wakeup->wakeTs, clockNano(), __ATOMIC_RELAXED);
+    proxyFutex(&wakeup->seq, FUTEX_WAKE, 1);
+  }
+}
+
+// Wait until ready() returns true, following NCCL_PROXY_IDLE_POLICY. ready()
+// is called without any lock held and must only read state set before the
+// matching proxyWake.
+template <typename F>
+static void proxyIdleWait(struct ncclProxyWakeup* wakeup, struct ncclProxyIdleStats* stats, F ready) {
+  if (ready()) return;
+
+  int64_t window = 0;
+  if (NCCL_PROXY_IDLE_POLICY == NCCL_PROXY_IDLE_POLICY::spin) {
+    window = INT64_MAX;
+  } else if (NCCL_PROXY_IDLE_POLICY == NCCL_PROXY_IDLE_POLICY::hybrid) {
+    window = stats->spinWindowNs.load(std::memory_order_relaxed);
+  }
+  if (window > 0) {
+    uint64_t start = clockNano(), now = start;
+    bool hit = false;
+    int iter = 0;
+    while (!(hit = ready())) {
+      proxyCpuPause();
+      // Avoid reading the clock on every iteration
+      if ((++iter & 0x3f) == 0 && (int64_t)((now = clockNano()) - start) >= window) break;
+    }
+    if (hit) now = clockNano();
+    stats->spins.fetch_add(1, std::memory_order_relaxed);
+    stats->spinNs.fetch_add(now - start, std::memory_order_relaxed);
+    if (NCCL_PROXY_IDLE_POLICY == NCCL_PROXY_IDLE_POLICY::hybrid) {
+      window = hit ? std::min<int64_t>(window*2, NCCL_PROXY_IDLE_SPIN_MAX_NS)
+                   : std::max<int64_t>(window/2, NCCL_PROXY_IDLE_SPIN_MIN_NS);
+      stats->spinWindowNs.store(window, std::memory_order_relaxed);
+    }
+    if (hit) {
+      stats->spinHits.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+
+  struct ncclProxyArgs profArgs; // Only used for profiling purposes
+  struct ncclProxySubArgs profSub;
+  profArgs.subs = &profSub;
+  ncclProfilingRecord(&profArgs, 0, 0, ncclProxyProfileSleep);
+  stats->sleeps.fetch_add(1, std::memory_order_relaxed);
+  __atomic_store_n(&wakeup->wakeTs, 0, __ATOMIC_RELAXED);
+  // Read seq before advertising we sleep and checking ready() again: a post
+  // after that check bumps seq, so the futex wait returns immediately.
+  uint32_t seq = __atomic_load_n(&wakeup->seq, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&wakeup->sleeping, 1, __ATOMIC_SEQ_CST);
+  while (!ready()) {
+    proxyFutex(&wakeup->seq, FUTEX_WAIT, seq);
+    uint32_t newSeq = __atomic_load_n(&wakeup->seq, __ATOMIC_SEQ_CST);
+    if (newSeq != seq) stats->wakeups.fetch_add(1, std::memory_order_relaxed);
+    seq = newSeq;
+  }
+  __atomic_store_n(&wakeup->sleeping, 0, __ATOMIC_SEQ_CST);
+  uint64_t wakeTs = __atomic_load_n(&wakeup->wakeTs, __ATOMIC_RELAXED);
+  if (wakeTs) {
+    uint64_t latency = clockNano() - wakeTs;
+    stats->wakeLatencyNs.fetch_add(latency, std::memory_order_relaxed);
+    if (latency > stats->maxWakeLatencyNs.load(std::memory_order_relaxed)) {
+      stats->maxWakeLatencyNs.store(latency, std::memory_order_relaxed);
+    }
+  }
+  ncclProfilingRecord(&profArgs, 0, 0, ncclProxyProfileWakeup);
+}
+
+// Backoff of a progress thread with active ops none of which progressed
+static inline void proxyBusyBackoff() {
+  if (NCCL_PROXY_IDLE_POLICY == NCCL_PROXY_IDLE_POLICY::spin) {
+    proxyCpuPause();
   } else {
-    pool->ops[pool->nextOpsEnd].next = nextOps;
+    sched_yield(); // No request progressed. Let others run.
   }
-  pool->nextOpsEnd = nextOpsEnd;
-  pthread_mutex_unlock(&pool->mutex);
+}
+
+ncclResult_t ncclProxyPost(struct ncclProxyOpsPool* pool, int nextOps, int nextOpsEnd) {
+  // Reverse the chain, we own it until it is pushed. Taking the stack and
+  // reversing it then gives back all chains in posting order.
+  int prev = -1;
+  for (int op = nextOps; prev != nextOpsEnd;) {
+    int next = pool->ops[op].next;
+    pool->ops[op].next = prev;
+    prev = op;
+    op = next;
+  }
+  // The progress thread only ever takes the whole stack, so pushes are not
+  // subject to ABA.
+  int head = __atomic_load_n(&pool->postedOps, __ATOMIC_RELAXED);
+  do {
+    pool->ops[nextOps].next = head;
+  } while (!__atomic_compare_exchange_n(&pool->postedOps, &head, nextOpsEnd, true, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+  if (head == -1) proxyWake(&pool->wakeup);
   return ncclSuccess;
 }
 
+int ncclProxyTakePostedOps(struct ncclProxyOpsPool* pool) {
+  if (__atomic_load_n(&pool->postedOps, __ATOMIC_RELAXED) == -1) return -1;
+  int op = __atomic_exchange_n(&pool->postedOps, -1, __ATOMIC_ACQUIRE);
+  int first = -1;
+  while (op != -1) {
+    int next = pool->ops[op].next;
+    pool->ops[op].next = first;
+    first = op;
+    op = next;
+  }
+  return first;
+}
+
 static ncclResult_t ncclLocalOpAppend(struct ncclComm* comm, struct ncclProxyConnector* proxyConn, struct ncclProxyOp* proxyOp) {
   int tpLocalRank = comm->topParentLocalRanks[comm->localRank];
   struct ncclProxyOps* proxyOps = comm->proxyState->proxyOps;
@@ -744,36 +1009,108 @@ static ncclResult_t progressOps(struct ncclProxyState* proxyState, struct ncclPr
   return ncclSuccess;
 }
 
+ncclResult_t ncclProxyAppendOp(struct ncclProxyProgressState* state, struct ncclProxyOp* op) {
+  return ProxyAppend(state, op);
+}
+
+ncclResult_t ncclProxyProgressOps(struct ncclProxyState* proxyState, struct ncclProxyProgressState* state, int* idle) {
+  return progressOps(proxyState, state, state->active, idle);
+}
+
+static void proxyOpRecordOpen(struct ncclProxyState* proxyState) {
+  struct ncclProxyProgressState* state = &proxyState->progressState;
+  if (NCCL_PROXY_OP_RECORD_FILE.empty() || state->opRecordFile) return;
+  std::string path = NCCL_PROXY_OP_RECORD_FILE + "." + std::to_string(getpid()) + "." + std::to_string(proxyState->cudaDev);
+  state->opRecordFile = fopen(path.c_str(), "w");
+  if (state->opRecordFile == NULL) {
+    WARN("Failed to open proxy op record file %s : %s", path.c_str(), strerror(errno));
+    return;
+  }
+  fprintf(state->opRecordFile, "# connection send transport shared channelId nsteps nbytes opCount pattern protocol sliceSteps chunkSteps chunkSize root\n");
+  INFO(NCCL_PROXY, "Recording proxy ops of device %d to %s", proxyState->cudaDev, path.c_str());
+}
+
+static void proxyOpRecord(struct ncclProxyProgressState* state, struct ncclProxyOp* op) {
+  struct ncclProxyConnection* connection = op->connection;
+  fprintf(state->opRecordFile, "%p %d %d %d %d %d %ld %lu %d %d %d %d %d %d\n",
+      connection, connection->send, connection->transport, connection->shared, op->channelId, op->nsteps, op->nbytes,
+      op->opCount, op->pattern, op->protocol, op->sliceSteps, op->chunkSteps, op->chunkSize, op->root);
+}
+
+// Shard progressing an op, see NCCL_PROXY_PROGRESS_THREADS
+static int proxyProgressShard(struct ncclProxyProgressState* state, struct ncclProxyOp* op) {
+  struct ncclProxyConnection* connection = op->connection;
+  if (state->nShards <= 1 || connection->transport != TRANSPORT_NET) return 0;
+  // Connections sharing buffers are appended to one list per local peer and
+  // channel whatever their NIC (see net.cc), they must stay on one shard.
+  if (connection->shared) return op->channelId % state->nShards;
+  return state->netDevShard[connection->netDev % NCCL_MAX_NETDEVS];
+}
+
+// Hand the ops staged for a shard over to its thread
+static ncclResult_t proxyShardPost(struct ncclProxyProgressShard* shard) {
+  if (shard->staged.empty()) return ncclSuccess;
+  pthread_mutex_lock(&shard->mutex);
+  bool wasEmpty = shard->queue.empty();
+  if (wasEmpty) {
+    shard->queue.swap(shard->staged);
+  } else {
+    shard->queue.insert(shard->queue.end(), shard->staged.begin(), shard->staged.end());
+  }
+  __atomic_store_n(&shard->nQueued, (int)shard->queue.size(), __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&shard->mutex);
+  shard->staged.clear();
+  if (wasEmpty) proxyWake(&shard->wakeup);
+  return ncclSuccess;
+}
+
+// Append the ops routed to a shard to its active ops. Like
+// ncclProxyGetPostedOps, block only when there is nothing to progress.
+// stopped is set once the shard is stopped and has nothing left to do.
+static ncclResult_t proxyShardGetOps(struct ncclProxyProgressShard* shard, std::vector<struct ncclProxyOp>& ops, int* added, bool* stopped) {
+  struct ncclProxyProgressState* state = shard->state;
+  if (state->active != NULL) {
+    if (pthread_mutex_trylock(&shard->mutex) != 0) return ncclSuccess;
+  } else {
+    proxyIdleWait(&shard->wakeup, shard->idleStats.get(), [&]() {
+      return __atomic_load_n(&shard->nQueued, __ATOMIC_SEQ_CST) > 0 || __atomic_load_n(&state->stop, __ATOMIC_SEQ_CST);
+    });
+    pthread_mutex_lock(&shard->mutex);
+  }
+  *stopped = state->stop && state->active == NULL && shard->queue.empty();
+  ops.swap(shard->queue);
+  shard->nQueued = 0;
+  pthread_mutex_unlock(&shard->mutex);
+
+  for (auto& op : ops) {
+    NCCLCHECK(ProxyAppend(state, &op));
+  }
+  *added = ops.size();
+  ops.clear();
+  return ncclSuccess;
+}
+
 static ncclResult_t ncclProxyGetPostedOps(struct ncclProxyState* proxyState, int* added) {
   struct ncclProxyProgressState* state = &proxyState->progressState;
   if (state->opsPool == NULL) return ncclInternalError;
   struct ncclProxyOpsPool* pool = state->opsPool;
 
   struct ncclProxyArgs profArgs; // Only used for profiling purposes
+  struct ncclProxySubArgs profSub;
+  profArgs.subs = &profSub;
   if (state->nextOps != -1) goto process_nextops;
 
-  // If we have ops to progress, no need to block waiting for something to arrive or even wait for the lock
-  // to be available. Exit, continue progress, and come back later.
-  if (state->active != NULL && (pool->nextOps == -1 || pthread_mutex_trylock(&pool->mutex) != 0)) return ncclSuccess;
-
+  // If we have ops to progress, no need to block waiting for something to arrive.
+  // Exit, continue progress, and come back later.
   if (state->active == NULL) {
-    pthread_mutex_lock(&pool->mutex);
-    while (pool->nextOps == -1 && !state->stop) {
-      struct ncclProxyArgs profArgs; // Only used for profiling purposes
-      ncclProfilingRecord(&profArgs, 0, 0, ncclProxyProfileSleep);
-      pthread_cond_wait(&pool->cond, &pool->mutex);
-      ncclProfilingRecord(&profArgs, 0, 0, ncclProxyProfileWakeup);
-    }
-    if (state->stop) { // We might have been woken up to stop.
-      pthread_mutex_unlock(&pool->mutex);
-      return ncclSuccess;
-    }
+    proxyIdleWait(&pool->wakeup, state->shards[0].idleStats.get(), [&]() {
+      return __atomic_load_n(&pool->postedOps, __ATOMIC_SEQ_CST) != -1 || __atomic_load_n(&state->stop, __ATOMIC_SEQ_CST);
+    });
+    if (state->stop) return ncclSuccess; // We might have been woken up to stop.
   }
 
-  state->nextOps = pool->nextOps;
-  pool->nextOps = pool->nextOpsEnd = -1;
-  pthread_mutex_unlock(&pool->mutex);
-  if (state->nextOps == -1) return ncclInternalError;
+  state->nextOps = ncclProxyTakePostedOps(pool);
+  if (state->nextOps == -1) return state->active == NULL ? ncclInternalError : ncclSuccess;
 
 process_nextops:
   ncclProfilingRecord(&profArgs, 0, 0, ncclProxyProfileAppend);
@@ -794,7 +1131,13 @@ process_nextops:
     lastPeer = peer;
     if (peerOp->connection == NULL) return ncclInternalError;
     if (peerOp->next != -1) __builtin_prefetch(pool->ops+peerOp->next);
-    NCCLCHECK(ProxyAppend(state, peerOp));
+    if (state->opRecordFile) proxyOpRecord(state, peerOp);
+    int shard = proxyProgressShard(state, peerOp);
+    if (shard == 0) {
+      NCCLCHECK(ProxyAppend(state, peerOp));
+    } else {
+      state->shards[shard].staged.push_back(*peerOp);
+    }
     (*added)++;
     int lastOpIndex = opIndex;
     opIndex = peerOp->next;
@@ -807,6 +1150,9 @@ process_nextops:
     freeOp[peer] = lastOpIndex;
     state->nextOps = opIndex;
   }
+  for (int s = 1; s < state->nShards; s++) {
+    NCCLCHECK(proxyShardPost(state->shards+s));
+  }
 
   for (int i = 0; i < proxyState->tpLocalnRanks; i++) {
     if (freeOp[i] == -1) continue;
@@ -837,6 +1183,10 @@ process_nextops:
 static ncclProxyProgressState* ncclLastProxyState;
 void ncclDumpProxyState(int signal) {
   dumpProxyState(ncclLastProxyState);
+  for (int s = 1; s < ncclLastProxyState->nShards; s++) {
+    printf("SHARD %d\n", s);
+    dumpProxyState(ncclLastProxyState->shards[s].state);
+  }
 }
 
 static int setProxyThreadContext(struct ncclProxyState* proxyState) {
@@ -871,6 +1221,94 @@ static int setProxyThreadContext(struct ncclProxyState* proxyState) {
   return 0;
 }
 
+static void proxyProgressSetAffinity(struct ncclProxyProgressShard* shard) {
+  if (CPU_COUNT(&shard->affinity) == 0) return;
+  char affinityStr[sizeof(cpu_set_t)*2];
+  if (ncclCpusetToStr(&shard->affinity, affinityStr) != ncclSuccess) affinityStr[0] = '\0';
+  if (sched_setaffinity(0, sizeof(cpu_set_t), &shard->affinity) != 0) {
+    WARN("[Proxy Progress] Failed to set affinity of shard %d of device %d to %s", shard->id, shard->proxyState->cudaDev, affinityStr);
+    return;
+  }
+  INFO(NCCL_INIT|NCCL_PROXY, "[Proxy Progress] Shard %d of device %d pinned to CPUs %s", shard->id, shard->proxyState->cudaDev, affinityStr);
+}
+
+static void* ncclProxyProgressShardMain(void* shard_) {
+  struct ncclProxyProgressShard* shard = (struct ncclProxyProgressShard*)shard_;
+  struct ncclProxyState* proxyState = shard->proxyState;
+  struct ncclProxyProgressState* state = shard->state;
+  // Shards are started by shard 0 once the thread context, if any, exists
+  if (setProxyThreadContext(proxyState) == 0 && cudaSetDevice(proxyState->cudaDev) != cudaSuccess) {
+    WARN("[Proxy Progress] Failed to set CUDA device %d", proxyState->cudaDev);
+  }
+  proxyProgressSetAffinity(shard);
+  char threadName[NCCL_THREAD_NAMELEN];
+  snprintf(threadName, NCCL_THREAD_NAMELEN, "NCCL Prg%2d-%d", proxyState->cudaDev, shard->id);
+  nvtxNameOsThreadA(syscall(SYS_gettid), threadName);
+
+  std::vector<struct ncclProxyOp> ops;
+  int proxyOpAppendCounter = 0;
+  while (*proxyState->abortFlag == 0) {
+    int idle = 1;
+    ncclResult_t ret = progressOps(proxyState, state, state->active, &idle);
+    if (ret != ncclSuccess) {
+      INFO(NCCL_ALL,"%s:%d -> %d [Proxy Thread shard %d]", __FILE__, __LINE__, ret, shard->id);
+      return NULL;
+    }
+    if (idle || (++proxyOpAppendCounter == NCCL_PROGRESS_APPENDOP_FREQ)) {
+      int added = 0;
+      bool stopped = false;
+      proxyOpAppendCounter = 0;
+      ret = proxyShardGetOps(shard, ops, &added, &stopped);
+      if (ret != ncclSuccess) {
+        INFO(NCCL_ALL,"%s:%d -> %d [Proxy Thread shard %d]", __FILE__, __LINE__, ret, shard->id);
+        return NULL;
+      }
+      if (stopped) break;
+      if (added == 0) {
+        proxyBusyBackoff();
+      }
+    }
+  }
+  return NULL;
+}
+
+// Stop the thread of a shard other than 0, if started, and free its state
+static void proxyProgressShardFree(struct ncclProxyProgressShard* shard) {
+  if (shard->state->thread) {
+    pthread_mutex_lock(&shard->mutex);
+    shard->state->stop = true;
+    pthread_mutex_unlock(&shard->mutex);
+    proxyWake(&shard->wakeup);
+    pthread_join(shard->state->thread, NULL);
+  }
+  ncclProxyFreeOps(shard->state);
+  free(shard->state);
+  shard->state = NULL;
+}
+
+// Start the threads of shards 1 and above. If one can't be started, stop the ones already started
+// and go back to one shard, before shard 0 routes any op to them.
+static ncclResult_t proxyProgressShardsStart(struct ncclProxyState* proxyState) {
+  struct ncclProxyProgressState* state = &proxyState->progressState;
+  ncclResult_t ret = ncclSuccess;
+  int s;
+  for (s = 1; s < state->nShards; s++) {
+    struct ncclProxyProgressShard* shard = state->shards+s;
+    PTHREADCHECKGOTO(pthread_create(&shard->state->thread, NULL, ncclProxyProgressShardMain, shard), "pthread_create", ret, fail);
+    ncclSetThreadName(shard->state->thread, "NCCL Prg%2d-%d", proxyState->cudaDev, s);
+  }
+  return ncclSuccess;
+fail:
+  // The thread id is undefined when pthread_create fails
+  state->shards[s].state->thread = 0;
+  for (s = 1; s < state->nShards; s++) {
+    proxyProgressShardFree(state->shards+s);
+    pthread_mutex_destroy(&state->shards[s].mutex);
+  }
+  state->nShards = 1;
+  return ret;
+}
+
 void* ncclProxyProgress(void *proxyState_) {
   struct ncclProxyState* proxyState = (struct ncclProxyState*)proxyState_;
   if (setProxyThreadContext(proxyState)) {
@@ -882,6 +1320,11 @@ void* ncclProxyProgress(void *proxyState_) {
 
   struct ncclProxyProgressState* state = &proxyState->progressState;
   state->nextOps = -1;
+  if (state->shards) proxyProgressSetAffinity(state->shards);
+  proxyOpRecordOpen(proxyState);
+  if (proxyProgressShardsStart(proxyState) != ncclSuccess) {
+    WARN("[Proxy Progress] Failed to start the progress threads of device %d, progressing all ops on one thread", proxyState->cudaDev);
+  }
   const int sig = NCCL_PROXY_DUMP_SIGNAL;
   if (sig != -1) signal(sig, ncclDumpProxyState);
   ncclLastProxyState = state;
@@ -897,6 +1340,8 @@ void* ncclProxyProgress(void *proxyState_) {
    * frequency of calling ncclProxyGetPostedOps() and reduce the perf impact. */
   int proxyOpAppendCounter = 0;
   struct ncclProxyArgs profArgs; // Only used for profiling purposes
+  struct ncclProxySubArgs profSub;
+  profArgs.subs = &profSub;
   while ((state->stop == false || (state->stop == true && state->active)) && *proxyState->abortFlag == 0) {
     int idle = 1;
     ncclResult_t ret = progressOps(proxyState, state, state->active, &idle);
@@ -917,7 +1362,7 @@ void* ncclProxyProgress(void *proxyState_) {
         INFO(NCCL_ALL,"%s:%d -> %d [Proxy Thread]", __FILE__, __LINE__, ret);
       }
       if (added == 0) {
-        sched_yield(); // No request progressed. Let others run.
+        proxyBusyBackoff();
       }
     }
     lastIdle = idle;
@@ -944,7 +1389,7 @@ ncclResult_t ncclProxyStart(struct ncclComm* comm) {
 static ncclResult_t ncclProxyProgressCreate(struct ncclProxyState* proxyState) {
   struct ncclProxyProgressState* state = &proxyState->progressState;
   if (!state->thread) {
-    pthread_create(&state->thread, NULL, ncclProxyProgress, proxyState);
+    PTHREADCHECK(pthread_create(&state->thread, NULL, ncclProxyProgress, proxyState), "pthread_create");
     ncclSetThreadName(state->thread, "NCCL Progress%2d", proxyState->tpLocalnRanks);
   }
   return ncclSuccess;
@@ -956,19 +1401,37 @@ ncclResult_t ncclProxyProgressDestroy(struct ncclProxyState* proxyState) {
 
   // Request the proxy to stop and then wake it
   if (state->opsPool) {
-    pthread_mutex_lock(&state->opsPool->mutex);
-    state->stop = true;
-    pthread_cond_signal(&state->opsPool->cond);
-    pthread_mutex_unlock(&state->opsPool->mutex);
+    __atomic_store_n(&state->stop, true, __ATOMIC_SEQ_CST);
+    proxyWake(&state->opsPool->wakeup);
     pthread_join(state->thread, NULL);
   }
+  if (state->opRecordFile) {
+    fclose(state->opRecordFile);
+    state->opRecordFile = NULL;
+  }
 
-  // Free off any memory allocated for the proxy arg pools
-  while (state->pools != NULL) {
-    struct ncclProxyPool *next = state->pools->next;
-    free(state->pools);
-    state->pools = next;
+  // Shard 0 no longer routes ops, stop the other shards once they are done
+  for (int s = 1; s < state->nShards; s++) {
+    proxyProgressShardFree(state->shards+s);
+  }
+  if (state->shards && proxyState->metricsCollectorId >= 0) {
+    NcclMetrics::getInstance().removeCollector(proxyState->metricsCollectorId);
+    proxyState->metricsCollectorId = -1;
   }
+  for (int s = 0; s < state->nShards; s++) {
+    struct ncclProxyIdleStats* stats = state->shards[s].idleStats.get();
+    uint64_t wakeups = stats->wakeups.load();
+    INFO(NCCL_PROXY, "Proxy of device %d progress thread %d idle: %lu spins (%lu hits, %lu us), %lu sleeps, %lu wakeups (avg %lu ns, max %lu ns latency)",
+        proxyState->cudaDev, s, stats->spins.load(), stats->spinHits.load(), stats->spinNs.load()/1000,
+        stats->sleeps.load(), wakeups, wakeups ? stats->wakeLatencyNs.load()/wakeups : 0, stats->maxWakeLatencyNs.load());
+    pthread_mutex_destroy(&state->shards[s].mutex);
+  }
+  delete[] state->shards;
+  state->shards = NULL;
+  state->nShards = 0;
+
+  // Free off any memory allocated for the proxy arg pools
+  ncclProxyFreeOps(state);
 
   // Dump profiling results only after destroying the last communicator
   nProxyComms--;
@@ -1052,7 +1515,9 @@ struct ncclProxyInitResp {
   char devShmPath[6]; // "XXXXXX" - May or may not be set
 };
 
-ncclResult_t ncclProxyConnect(struct ncclComm* comm, int transport, int send, int tpProxyRank, struct ncclProxyConnector* proxyConn) {
+// Open the socket to the proxy of tpProxyRank if needed, and prepare the init request of a new
+// connection to it
+static ncclResult_t proxyConnectPrepare(struct ncclComm* comm, int transport, int send, int tpProxyRank, struct ncclProxyConnector* proxyConn, struct ncclProxyInitReq* req) {
   struct ncclSocket* sock;
   int ready, proxyRank = -1;
   struct ncclProxyState* sharedProxyState = comm->proxyState;
@@ -1086,24 +1551,24 @@ ncclResult_t ncclProxyConnect(struct ncclComm* comm, int transport, int send, in
     NCCLCHECK(ncclSocketConnect(sock));
   }
 
-  struct ncclProxyInitReq req = {0};
-  req.transport = transport;
-  req.send = send;
-  req.tpLocalRank = comm->topParentLocalRanks[comm->localRank];
-  req.tpRank = comm->topParentRanks[comm->rank];
-  req.sameProcess = proxyConn->sameProcess;
+  req->transport = transport;
+  req->send = send;
+  req->tpLocalRank = comm->topParentLocalRanks[comm->localRank];
+  req->tpRank = comm->topParentRanks[comm->rank];
+  req->sameProcess = proxyConn->sameProcess;
+  return ncclSuccess;
+}
 
-  struct ncclProxyInitResp resp = {0};
-  // This usually sends proxyConn->connection to identify which connection this is.
-  // However, this is part of the response and therefore is ignored
-  NCCLCHECK(ncclProxyCallBlocking(comm, proxyConn, ncclProxyMsgInit, &req, sizeof(req), &resp, sizeof(resp)));
-  proxyConn->connection = resp.connection;
+// Record the connection of the init response, and map the progress ops of the proxy
+static ncclResult_t proxyConnectDone(struct ncclComm* comm, int transport, int send, struct ncclProxyConnector* proxyConn, struct ncclProxyInitResp* resp) {
+  struct ncclProxyState* sharedProxyState = comm->proxyState;
+  proxyConn->connection = resp->connection;
 
   // If we need proxy progress, map progress ops
   struct ncclTransportComm* tcomm = send ? &ncclTransports[transport]->send : &ncclTransports[transport]->recv;
   if (tcomm->proxyProgress) {
     char poolPath[] = "/dev/shm/nccl-XXXXXX";
-    strncpy(poolPath+sizeof("/dev/shm/nccl-")-1, resp.devShmPath, sizeof("XXXXXX")-1);
+    strncpy(poolPath+sizeof("/dev/shm/nccl-")-1, resp->devShmPath, sizeof("XXXXXX")-1);
     struct ncclProxyOps* proxyOps = sharedProxyState->proxyOps + proxyConn->tpLocalRank;
     if (proxyOps->pool == NULL) {
       NCCLCHECK(ncclShmOpen(poolPath, sizeof(struct ncclProxyOpsPool), (void**)(&proxyOps->pool), NULL, 0, &proxyOps->handle));
@@ -1114,6 +1579,18 @@ ncclResult_t ncclProxyConnect(struct ncclComm* comm, int transport, int send, in
   return ncclSuccess;
 }
 
+ncclResult_t ncclProxyConnect(struct ncclComm* comm, int transport, int send, int tpProxyRank, struct ncclProxyConnector* proxyConn) {
+  struct ncclProxyInitReq req = {0};
+  NCCLCHECK(proxyConnectPrepare(comm, transport, send, tpProxyRank, proxyConn, &req));
+
+  struct ncclProxyInitResp resp = {0};
+  // This usually sends proxyConn->connection to identify which connection this is.
+  // However, this is part of the response and therefore is ignored
+  NCCLCHECK(ncclProxyCallBlocking(comm, proxyConn, ncclProxyMsgInit, &req, sizeof(req), &resp, sizeof(resp)));
+  NCCLCHECK(proxyConnectDone(comm, transport, send, proxyConn, &resp));
+  return ncclSuccess;
+}
+
 // cuMem API support
 // The response is sent out-of-band using ncclIpcSocket for this specific command
 ncclResult_t ncclProxyClientConvertFdBlocking(struct ncclComm* comm, struct ncclProxyConnector* proxyConn, int fd, int* convertedFd) {
@@ -1146,24 +1623,35 @@ error:
 }
 
 const char* ncclProxyMsgTypeStr[] = { "Unknown", "Init", "SharedInit", "Setup", "Connect", "Start", "Close", "Abort", "Stop", "ConvertFd" };
+
+static void proxyPack(std::vector<char>& buff, const void* data, int size) {
+  buff.insert(buff.end(), (const char*)data, (const char*)data+size);
+}
+
+// Append a request in the order proxyServiceInitOp() receives it, so that requests are sent with
+// one ncclSocketSend() each, or many at once
+static void proxyCallPack(std::vector<char>& buff, int type, struct ncclProxyConnection* connection, void* reqBuff, int reqSize, int respSize, void* opId) {
+  proxyPack(buff, &type, sizeof(int));
+  proxyPack(buff, &connection, sizeof(void*));
+  proxyPack(buff, &reqSize, sizeof(int));
+  proxyPack(buff, &respSize, sizeof(int));
+  if (reqSize) proxyPack(buff, reqBuff, reqSize);
+  proxyPack(buff, &opId, sizeof(opId));
+}
+
 ncclResult_t ncclProxyCallAsync(struct ncclComm* comm, struct ncclProxyConnector* proxyConn, int type, void* reqBuff, int reqSize, int respSize, void* opId) {
   struct ncclSocket* sock;
   ncclResult_t ret = ncclSuccess;
   struct ncclProxyState* sharedProxyState = comm->proxyState;
+  std::vector<char> buff;
 
   if (sharedProxyState->peerSocks == NULL) return ncclInternalError;
 
   sock = sharedProxyState->peerSocks + proxyConn->tpLocalRank;
   if (sock == NULL) return ncclInternalError;
 
-  NCCLCHECKGOTO(ncclSocketSend(sock, &type, sizeof(int)), ret, error);
-  NCCLCHECKGOTO(ncclSocketSend(sock, &proxyConn->connection, sizeof(void*)), ret, error);
-  NCCLCHECKGOTO(ncclSocketSend(sock, &reqSize, sizeof(int)), ret, error);
-  NCCLCHECKGOTO(ncclSocketSend(sock, &respSize, sizeof(int)), ret, error);
-  if (reqSize) NCCLCHECKGOTO(ncclSocketSend(sock, reqBuff, reqSize), ret, error);
-
-  // Send opId to proxy
-  NCCLCHECKGOTO(ncclSocketSend(sock, &opId, sizeof(opId)), ret, error);
+  proxyCallPack(buff, type, proxyConn->connection, reqBuff, reqSize, respSize, opId);
+  NCCLCHECKGOTO(ncclSocketSend(sock, buff.data(), buff.size()), ret, error);
 
   // Add proxyOp to expected response queue
   NCCLCHECK(expectedProxyResponseEnqueue(sharedProxyState, opId, respSize));
@@ -1210,12 +1698,19 @@ ncclResult_t ncclPollProxyResponse(struct ncclComm* comm, struct ncclProxyConnec
     int respSize = 0;
     NCCLCHECK(ncclSocketRecv(sock, &respSize, sizeof(respSize)));
 
+    if (recvOpId != opId) {
+      // Unexpected response, receive it in the buffer of its expected response, never in the
+      // buffer of the caller
+      struct ncclExpectedProxyResponse* elem = expectedProxyResponseFind(sharedProxyState, recvOpId);
+      if (elem == NULL || elem->respSize != respSize) {
+        WARN("Proxy response for opId=%p respSize=%d doesn't match any expected response", recvOpId, respSize);
+        return ncclInternalError;
+      }
+      respBuff = elem->respBuff;
+    }
+
     // If there's a respSize to recv
     if (respSize > 0) {
-      if (recvOpId != opId) {
-        // Unexpected response, need to buffer the socket data
-        respBuff = malloc(respSize);
-      }
       assert(respBuff != NULL);
       NCCLCHECK(ncclSocketRecv(sock, respBuff, respSize));
     }
@@ -1227,7 +1722,7 @@ ncclResult_t ncclPollProxyResponse(struct ncclComm* comm, struct ncclProxyConnec
     } else {
       INFO(NCCL_PROXY, "Queuing opId=%p respBuff=%p respSize=%d", recvOpId, respBuff, respSize);
       // Store the result and mark response as completed
-      NCCLCHECK(expectedProxyResponseStore(sharedProxyState, recvOpId, respBuff, respSize));
+      NCCLCHECK(expectedProxyResponseStore(sharedProxyState, recvOpId, respSize));
       return ncclInProgress;
     }
   } else {
@@ -1255,6 +1750,154 @@ fail:
   goto exit;
 }
 
+static ncclResult_t proxyDeferredCallEnqueue(struct ncclProxyState* state, struct ncclProxyConnector* proxyConn, int type, void* reqBuff, int reqSize, void* respBuff, int respSize, struct ncclProxyDeferredCall** call) {
+  NCCLCHECK(ncclCalloc(call, 1));
+  (*call)->proxyConn = proxyConn;
+  (*call)->type = type;
+  (*call)->reqSize = reqSize;
+  (*call)->respSize = respSize;
+  (*call)->respBuff = respBuff;
+  if (reqSize) {
+    NCCLCHECK(ncclCalloc(&(*call)->reqBuff, reqSize));
+    memcpy((*call)->reqBuff, reqBuff, reqSize);
+  }
+  if (state->deferredCallsTail) {
+    state->deferredCallsTail->next = *call;
+  } else {
+    state->deferredCalls = *call;
+  }
+  state->deferredCallsTail = *call;
+  return ncclSuccess;
+}
+
+// Bytes of a call and its response on the sockets to the proxy. Requests and responses in flight are
+// kept under PROXY_RPC_MAX_INFLIGHT_BYTES so they fit in the socket buffers: the proxy blocks sending
+// responses while we block sending requests otherwise.
+#define PROXY_RPC_MAX_INFLIGHT_BYTES (64*1024)
+static size_t proxyDeferredCallBytes(struct ncclProxyDeferredCall* call) {
+  size_t reqBytes = 3*sizeof(int) + sizeof(void*) + call->reqSize + sizeof(void*);
+  size_t respBytes = sizeof(void*) + sizeof(int) + call->respSize;
+  return reqBytes + respBytes;
+}
+
+static void proxyDeferredCallFree(struct ncclProxyDeferredCall* call) {
+  if (call->type == ncclProxyMsgInit) free(call->respBuff);
+  free(call->reqBuff);
+  free(call);
+}
+
+ncclResult_t ncclProxyConnectDeferred(struct ncclComm* comm, int transport, int send, int tpProxyRank, struct ncclProxyConnector* proxyConn) {
+  if (NCCL_PROXY_RPC_BATCH_SIZE <= 1) return ncclProxyConnect(comm, transport, send, tpProxyRank, proxyConn);
+
+  struct ncclProxyInitReq req = {0};
+  NCCLCHECK(proxyConnectPrepare(comm, transport, send, tpProxyRank, proxyConn, &req));
+
+  struct ncclProxyInitResp* resp;
+  struct ncclProxyDeferredCall* call;
+  NCCLCHECK(ncclCalloc(&resp, 1));
+  NCCLCHECK(proxyDeferredCallEnqueue(comm->proxyState, proxyConn, ncclProxyMsgInit, &req, sizeof(req), resp, sizeof(*resp), &call));
+  call->transport = transport;
+  call->send = send;
+  return ncclSuccess;
+}
+
+ncclResult_t ncclProxyCallDeferred(struct ncclComm* comm, struct ncclProxyConnector* proxyConn, int type, void* reqBuff, int reqSize, void* respBuff, int respSize) {
+  if (NCCL_PROXY_RPC_BATCH_SIZE <= 1) return ncclProxyCallBlocking(comm, proxyConn, type, reqBuff, reqSize, respBuff, respSize);
+
+  struct ncclProxyDeferredCall* call;
+  NCCLCHECK(proxyDeferredCallEnqueue(comm->proxyState, proxyConn, type, reqBuff, reqSize, respBuff, respSize, &call));
+  return ncclSuccess;
+}
+
+ncclResult_t ncclProxyDeferredWait(struct ncclComm* comm) {
+  struct ncclProxyState* sharedProxyState = comm->proxyState;
+  ncclResult_t ret = ncclSuccess;
+  std::vector<std::vector<char>> batches(comm->sharedRes->tpNLocalRanks);
+  int nCalls = 0, nBatches = 0;
+  uint64_t start = clockNano();
+
+  while (sharedProxyState->deferredCalls) {
+    // Pack the calls whose connection is known, up to NCCL_PROXY_RPC_BATCH_SIZE and
+    // PROXY_RPC_MAX_INFLIGHT_BYTES in flight. Calls of a connector are queued in order, and are all
+    // waiting for the same init response.
+    for (struct ncclProxyDeferredCall* call = sharedProxyState->deferredCalls;
+         call && sharedProxyState->nDeferredSent < NCCL_PROXY_RPC_BATCH_SIZE; call = call->next) {
+      if (call->sent || (call->type != ncclProxyMsgInit && call->proxyConn->connection == NULL)) continue;
+      size_t bytes = proxyDeferredCallBytes(call);
+      if (sharedProxyState->nDeferredSent > 0 && sharedProxyState->nDeferredBytes + bytes > PROXY_RPC_MAX_INFLIGHT_BYTES) break;
+      proxyCallPack(batches[call->proxyConn->tpLocalRank], call->type, call->proxyConn->connection, call->reqBuff, call->reqSize, call->respSize, call);
+      NCCLCHECKGOTO(expectedProxyResponseEnqueue(sharedProxyState, call, call->respSize), ret, fail);
+      call->sent = 1;
+      sharedProxyState->nDeferredSent++;
+      sharedProxyState->nDeferredBytes += bytes;
+    }
+    for (int r = 0; r < (int)batches.size(); r++) {
+      if (batches[r].empty()) continue;
+      NCCLCHECKGOTO(ncclSocketSend(sharedProxyState->peerSocks + r, batches[r].data(), batches[r].size()), ret, fail);
+      batches[r].clear();
+      nBatches++;
+    }
+
+    // Collect the responses that arrived
+    struct ncclProxyDeferredCall* prev = NULL;
+    struct ncclProxyDeferredCall* call = sharedProxyState->deferredCalls;
+    while (call) {
+      struct ncclProxyDeferredCall* next = call->next;
+      ncclResult_t res = ncclInProgress;
+      if (call->sent) {
+        res = ncclPollProxyResponse(comm, call->proxyConn, call->respBuff, call);
+        if (res != ncclSuccess && res != ncclInProgress) {
+          ret = res;
+          goto fail;
+        }
+      }
+      if (res == ncclSuccess) {
+        if (call->type == ncclProxyMsgInit) {
+          NCCLCHECKGOTO(proxyConnectDone(comm, call->transport, call->send, call->proxyConn, (struct ncclProxyInitResp*)call->respBuff), ret, fail);
+        }
+        if (prev) {
+          prev->next = next;
+        } else {
+          sharedProxyState->deferredCalls = next;
+        }
+        if (sharedProxyState->deferredCallsTail == call) sharedProxyState->deferredCallsTail = prev;
+        sharedProxyState->nDeferredSent--;
+        sharedProxyState->nDeferredBytes -= proxyDeferredCallBytes(call);
+        proxyDeferredCallFree(call);
+        nCalls++;
+      } else {
+        prev = call;
+      }
+      call = next;
+    }
+  }
+  if (nCalls) {
+    TRACE(NCCL_INIT|NCCL_PROXY, "Completed %d deferred proxy calls in %d batches in %.1f us", nCalls, nBatches, (clockNano()-start)/1e3);
+  }
+  return ncclSuccess;
+fail:
+  // Responses of calls in flight can no longer be matched, the connection to the proxy is unusable
+  ncclProxyDeferredDiscard(comm);
+  return ret;
+}
+
+void ncclProxyDeferredDiscard(struct ncclComm* comm) {
+  struct ncclProxyState* sharedProxyState = comm->proxyState;
+  if (sharedProxyState == NULL) return;
+  while (sharedProxyState->deferredCalls) {
+    struct ncclProxyDeferredCall* call = sharedProxyState->deferredCalls;
+    sharedProxyState->deferredCalls = call->next;
+    if (call->sent) {
+      struct ncclExpectedProxyResponse* elem = expectedProxyResponseFind(sharedProxyState, call);
+      if (elem) expectedProxyResponseErase(sharedProxyState, elem);
+    }
+    proxyDeferredCallFree(call);
+  }
+  sharedProxyState->deferredCallsTail = NULL;
+  sharedProxyState->nDeferredSent = 0;
+  sharedProxyState->nDeferredBytes = 0;
+}
+
 static ncclResult_t proxyProgressInit(struct ncclProxyState* proxyState) {
   struct ncclProxyProgressState* state = &proxyState->progressState;
   if (state->opsPool == NULL) {
@@ -1265,7 +1908,7 @@ static ncclResult_t proxyProgressInit(struct ncclProxyState* proxyState) {
     shmPath[0] = '\0';
     NCCLCHECK(ncclShmOpen(shmPath, size, (void**)&pool, NULL, proxyState->tpLocalnRanks + 1, &state->handle));
     // Init pool
-    pool->nextOps = -1;
+    pool->postedOps = -1;
 
     for (int r = 0; r < proxyState->tpLocalnRanks; r++) {
       pool->freeOps[r] = r*MAX_OPS_PER_PEER;
@@ -1273,14 +1916,7 @@ static ncclResult_t proxyProgressInit(struct ncclProxyState* proxyState) {
       pool->ops[(r+1)*MAX_OPS_PER_PEER-1].next = -1;
     }
 
-    // Setup mutex/cond to work inter-process
-    pthread_mutexattr_t mutexAttr;
-    pthread_mutexattr_init(&mutexAttr);
-    pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
-    pthread_mutex_init(&pool->mutex, &mutexAttr);
-    pthread_condattr_t condAttr;
-    pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
-    pthread_cond_init(&pool->cond, &condAttr);
+    memset(&pool->wakeup, 0, sizeof(pool->wakeup));
     state->opsPool = pool;
 
     memcpy(state->opsPoolShmSuffix, shmPath+sizeof("/dev/shm/nccl-")-1, sizeof("XXXXXX")-1);
@@ -1348,6 +1984,29 @@ static ncclResult_t proxyConvertFd(struct ncclProxyLocalPeer* peer, void *opId,
   return ncclSuccess;
 }
 
+static ncclResult_t proxyQueueResponse(struct ncclProxyLocalPeer* peer, struct ncclProxyAsyncOp* op) {
+  int size = sizeof(op->opId) + sizeof(op->respSize) + op->respSize;
+  if (peer->respBuffSize + size > peer->respBuffMax) {
+    int max = std::max(std::max(2*peer->respBuffMax, peer->respBuffSize + size), 4096);
+    NCCLCHECK(ncclRealloc(&peer->respBuff, peer->respBuffMax, max));
+    peer->respBuffMax = max;
+  }
+  char* buff = peer->respBuff + peer->respBuffSize;
+  memcpy(buff, &op->opId, sizeof(op->opId));
+  memcpy(buff + sizeof(op->opId), &op->respSize, sizeof(op->respSize));
+  if (op->respSize) memcpy(buff + sizeof(op->opId) + sizeof(op->respSize), op->respBuff, op->respSize);
+  peer->respBuffSize += size;
+  return ncclSuccess;
+}
+
+static ncclResult_t proxyFlushResponses(struct ncclProxyLocalPeer* peer) {
+  if (peer->respBuffSize == 0) return ncclSuccess;
+  int size = peer->respBuffSize;
+  peer->respBuffSize = 0;
+  NCCLCHECK(ncclSocketSend(&peer->sock, peer->respBuff, size));
+  return ncclSuccess;
+}
+
 static ncclResult_t proxyProgressAsync(struct ncclProxyAsyncOp* op, struct ncclProxyState* proxyState, int* asyncOpCount, struct ncclProxyLocalPeer* peer, struct ncclProxyConnectionPool* connectionPool) {
   int done = 1;
   if (op->type == ncclProxyMsgSetup) {
@@ -1381,16 +2040,9 @@ static ncclResult_t proxyProgressAsync(struct ncclProxyAsyncOp* op, struct ncclP
      * to abort and close the connection, it can cause segfault if the requester is using
      * the respBuff. */
 
-    // Send the opId for referencing async operation
-    NCCLCHECK(ncclSocketSend(op->connection->sock, &op->opId, sizeof(op->opId)));
-
-    // Send the response size
-    NCCLCHECK(ncclSocketSend(op->connection->sock, &op->respSize, sizeof(op->respSize)));
-
-    if (op->respSize) {
-      // Send the response
-      NCCLCHECK(ncclSocketSend(op->connection->sock, op->respBuff, op->respSize));
-    }
+    // Queue the opId for referencing async operation, the response size and the response, sent
+    // with the other responses to the peer by proxyFlushResponses()
+    NCCLCHECK(proxyQueueResponse(peer, op));
 
     asyncProxyOpDequeue(peer, op);
     (*asyncOpCount)--;
@@ -1540,31 +2192,36 @@ void* ncclProxyService(void* _args) {
         }
       }
 
-      // Check for additional ops coming in
+      // Check for additional ops coming in, and initiate up to NCCL_PROXY_RPC_BATCH_SIZE of the
+      // ops batched by the peer in this iteration
       if (pollfds[s].revents & POLLIN) {
-        int closed;
-        res = ncclSocketTryRecv(sock, &type, sizeof(int), &closed, false /*blocking*/);
-        if (res != ncclSuccess && res != ncclInProgress) {
-          WARN("[Service thread] Could not receive type from localRank %d, res=%u, closed=%d", peer->tpLocalRank, res, closed);
-          closeConn = 1;
-        } else if (closed) {
-          INFO(NCCL_INIT|NCCL_NET|NCCL_PROXY, "[Service thread] Connection closed by localRank %d", peer->tpLocalRank);
-          closeConn = 1;
-        } else if (res == ncclSuccess) { // We received something from the sock
-          if (type == ncclProxyMsgStop) {
-            stop = 1;
-            closeConn = 1;
-          } else if (type == ncclProxyMsgClose) {
+        res = ncclSuccess;
+        for (int n = 0; n < std::max<int64_t>(NCCL_PROXY_RPC_BATCH_SIZE, 1) && !closeConn && res == ncclSuccess; n++) {
+          int closed;
+          res = ncclSocketTryRecv(sock, &type, sizeof(int), &closed, false /*blocking*/);
+          if (res != ncclSuccess && res != ncclInProgress) {
+            WARN("[Service thread] Could not receive type from localRank %d, res=%u, closed=%d", peer->tpLocalRank, res, closed);
             closeConn = 1;
-          } else if (proxyMatchOpType(type)) {
-            res = proxyServiceInitOp(type, peers+s, &connectionPool, proxyState, &asyncOpCount);
-          } else {
-            WARN("[Service thread] Unknown command %d from localRank %d", type, peer->tpLocalRank);
+          } else if (closed) {
+            INFO(NCCL_INIT|NCCL_NET|NCCL_PROXY, "[Service thread] Connection closed by localRank %d", peer->tpLocalRank);
             closeConn = 1;
-          }
+          } else if (res == ncclSuccess) { // We received something from the sock
+            if (type == ncclProxyMsgStop) {
+              stop = 1;
+              closeConn = 1;
+            } else if (type == ncclProxyMsgClose) {
+              closeConn = 1;
+            } else if (proxyMatchOpType(type)) {
+              res = proxyServiceInitOp(type, peers+s, &connectionPool, proxyState, &asyncOpCount);
+            } else {
+              WARN("[Service thread] Unknown command %d from localRank %d", type, peer->tpLocalRank);
+              closeConn = 1;
+            }
 
-          INFO(NCCL_PROXY, "Received and initiated operation=%s res=%d", ncclProxyMsgTypeStr[type], res);
+            INFO(NCCL_PROXY, "Received and initiated operation=%s res=%d", ncclProxyMsgTypeStr[type], res);
+          }
         }
+        if (res == ncclInProgress) res = ncclSuccess;
       } else if (pollfds[s].revents & POLLHUP) {
         closeConn = 1;
       }
@@ -1572,6 +2229,10 @@ void* ncclProxyService(void* _args) {
         WARN("[Proxy Service %d] Failed to execute operation %s from rank %d, retcode %d", proxyState->tpRank, ncclProxyMsgTypeStr[type], peer->tpRank, res);
         closeConn = 1;
       }
+      if (!closeConn && proxyFlushResponses(peer) != ncclSuccess) {
+        WARN("[Service thread] Could not send responses to localRank %d", peer->tpLocalRank);
+        closeConn = 1;
+      }
 
       if (closeConn) {
         ncclSocketClose(sock);
@@ -1580,6 +2241,9 @@ void* ncclProxyService(void* _args) {
           asyncProxyOpDequeue(peer, op);
           asyncOpCount--;
         }
+        free(peer->respBuff);
+        peer->respBuff = NULL;
+        peer->respBuffSize = peer->respBuffMax = 0;
         pollfds[s].fd = -1;
         npeers--;
       }
@@ -1610,6 +2274,85 @@ ncclResult_t ncclProxyInit(struct ncclComm* comm, struct ncclSocket* sock, union
   return ncclSuccess;
 }
 
+// Export the idle counters of the progress threads at each scrape
+static ncclResult_t proxyIdleMetricsInit(struct ncclProxyState* proxyState) {
+  struct ncclProxyProgressState* state = &proxyState->progressState;
+  proxyState->metricsCollectorId = -1;
+  if (!NcclMetrics::enabled()) return ncclSuccess;
+
+  std::vector<std::shared_ptr<struct ncclProxyIdleStats>> allStats;
+  for (int s = 0; s < state->nShards; s++) allStats.push_back(state->shards[s].idleStats);
+  std::string cudaDev = std::to_string(proxyState->cudaDev);
+  proxyState->metricsCollectorId = NcclMetrics::getInstance().addCollector(
+      [allStats, cudaDev](std::vector<NcclMetricSample>& samples) {
+        for (size_t s = 0; s < allStats.size(); s++) {
+          auto& stats = allStats[s];
+          NcclMetricLabels labels = {{"cudaDev", cudaDev}, {"thread", std::to_string(s)}};
+          auto counter = [&](const char* name, const std::atomic<uint64_t>& value) {
+            samples.push_back({name, labels, NcclMetricSample::Type::COUNTER, value.load(std::memory_order_relaxed)});
+          };
+          auto gauge = [&](const char* name, const std::atomic<uint64_t>& value) {
+            samples.push_back({name, labels, NcclMetricSample::Type::GAUGE, value.load(std::memory_order_relaxed)});
+          };
+          counter("nccl_proxy_idle_spins_total", stats->spins);
+          counter("nccl_proxy_idle_spin_hits_total", stats->spinHits);
+          counter("nccl_proxy_idle_spin_ns_total", stats->spinNs);
+          counter("nccl_proxy_idle_sleeps_total", stats->sleeps);
+          counter("nccl_proxy_idle_wakeups_total", stats->wakeups);
+          counter("nccl_proxy_idle_wake_latency_ns_total", stats->wakeLatencyNs);
+          gauge("nccl_proxy_idle_max_wake_latency_ns", stats->maxWakeLatencyNs);
+          gauge("nccl_proxy_idle_spin_window_ns", stats->spinWindowNs);
+        }
+      });
+  return ncclSuccess;
+}
+
+// Spread the NICs of the topology over NCCL_PROXY_PROGRESS_THREADS shards,
+// each pinned to the CPUs local to its NICs
+static ncclResult_t proxyProgressShardsInit(struct ncclProxyState* proxyState, struct ncclComm* comm) {
+  struct ncclProxyProgressState* state = &proxyState->progressState;
+  int nNets = 0;
+  if (comm->topo) NCCLCHECK(ncclTopoGetNetCount(comm->topo, &nNets));
+  int nShards = std::max<int64_t>(1, std::min<int64_t>(NCCL_PROXY_PROGRESS_THREADS, nNets));
+  if (nShards > 1 && proxyState->trace && proxyState->trace->singleProducer()) {
+    WARN("NCCL_PROXY_PROGRESS_THREADS=%ld is not supported with NCCL_PROXYTRACE=ring, using one progress thread", NCCL_PROXY_PROGRESS_THREADS);
+    nShards = 1;
+  }
+
+  state->nShards = nShards;
+  state->shards = new struct ncclProxyProgressShard[nShards];
+  for (int s = 0; s < nShards; s++) {
+    struct ncclProxyProgressShard* shard = state->shards+s;
+    shard->proxyState = proxyState;
+    shard->id = s;
+    CPU_ZERO(&shard->affinity);
+    if (s == 0) {
+      shard->state = state;
+    } else {
+      NCCLCHECK(ncclCalloc(&shard->state, 1));
+    }
+    pthread_mutex_init(&shard->mutex, NULL);
+    shard->nQueued = 0;
+    memset(&shard->wakeup, 0, sizeof(shard->wakeup));
+    shard->idleStats = std::make_shared<struct ncclProxyIdleStats>();
+    shard->idleStats->spinWindowNs = NCCL_PROXY_IDLE_SPIN_MAX_NS;
+  }
+  NCCLCHECK(proxyIdleMetricsInit(proxyState));
+  for (int d = 0; d < NCCL_MAX_NETDEVS; d++) state->netDevShard[d] = d % nShards;
+  if (nShards == 1) return ncclSuccess;
+
+  for (int n = 0; n < nNets; n++) {
+    int netDev;
+    cpu_set_t netAffinity;
+    NCCLCHECK(ncclTopoGetNetCpuAffinity(comm->topo, n, &netDev, &netAffinity));
+    struct ncclProxyProgressShard* shard = state->shards + n % nShards;
+    if (netDev >= 0 && netDev < NCCL_MAX_NETDEVS) state->netDevShard[netDev] = shard->id;
+    if (NCCL_PROXY_PROGRESS_NUMA_PIN) CPU_OR(&shard->affinity, &shard->affinity, &netAffinity);
+  }
+  INFO(NCCL_INIT|NCCL_PROXY, "Proxy of device %d uses %d progress threads for %d NICs", proxyState->cudaDev, nShards, nNets);
+  return ncclSuccess;
+}
+
 ncclResult_t ncclProxyCreate(struct ncclComm* comm) {
   /* proxyState is shared among parent comm and split comms. comm->proxyState->thread is
    * pthread_join()'d by commFree() in init.cc when the refCount reduces down to 0. */
@@ -1629,10 +2372,11 @@ ncclResult_t ncclProxyCreate(struct ncclComm* comm) {
     proxyState->ncclNet = comm->ncclNet;
     proxyState->ncclCollNet = comm->ncclCollNet;
     NCCLCHECK(proxyTraceInit(proxyState, comm));
+    NCCLCHECK(proxyProgressShardsInit(proxyState, comm));
 
     memcpy(proxyState->buffSizes, comm->buffSizes, sizeof(comm->buffSizes));
 
-    pthread_create(&comm->proxyState->thread, NULL, ncclProxyService, comm->proxyState);
+    PTHREADCHECK(pthread_create(&comm->proxyState->thread, NULL, ncclProxyService, comm->proxyState), "pthread_create");
     ncclSetThreadName(comm->proxyState->thread, "NCCL Service %2d", comm->cudaDev);
   }
   return ncclSuccess;
@@ -0,0 +1,215 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// Multi-process harness measuring bootstrap latency at scale on a single host.
+// Every simulated rank is a forked process that runs bootstrapInit against a
+// root owned by the parent, followed by repeated bootstrapAllGather and
+// bootstrapBarrier calls. No GPU is needed; only the bootstrap state of the
+// communicator is initialized.
+//
+// Usage: BootstrapBench [minRanks] [maxRanks] [allGatherSize] [iters]
+//
+// Note that bootstrapInit staggers the connections to the root by one msec per
+// rank above 128 ranks, which is included in the reported init latency.
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "bootstrap.h"
+#include "comm.h"
+#include "nccl_cvars.h"
+
+struct RankResult {
+  double initUs;
+  double allGatherUs;
+  double barrierUs;
+  int error;
+};
+
+static double elapsedUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static int runRank(
+    ncclBootstrapHandle* handle,
+    int rank,
+    int nranks,
+    int size,
+    int iters,
+    RankResult* result) {
+  auto comm = static_cast<ncclComm*>(calloc(1, sizeof(ncclComm)));
+  auto sharedRes =
+      static_cast<ncclSharedResources*>(calloc(1, sizeof(ncclSharedResources)));
+  auto abortFlag = static_cast<uint32_t*>(calloc(1, sizeof(uint32_t)));
+  std::vector<char> data(static_cast<size_t>(nranks) * size);
+  std::vector<int> ranks(nranks);
+
+  comm->rank = rank;
+  comm->nRanks = nranks;
+  comm->abortFlag = abortFlag;
+  comm->sharedRes = sharedRes;
+  for (int i = 0; i < nranks; i++) {
+    ranks[i] = i;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  if (bootstrapInit(handle, comm) != ncclSuccess) {
+    return 1;
+  }
+  result->initUs = elapsedUs(start);
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; i++) {
+    memset(data.data(), 0, data.size());
+    memset(data.data() + static_cast<size_t>(rank) * size, rank + i, size);
+    if (bootstrapAllGather(comm->bootstrap, data.data(), size) !=
+        ncclSuccess) {
+      return 1;
+    }
+    for (int r = 0; r < nranks; r++) {
+      const char expected = static_cast<char>(r + i);
+      for (int j = 0; j < size; j++) {
+        if (data[static_cast<size_t>(r) * size + j] != expected) {
+          fprintf(
+              stderr,
+              "rank %d: unexpected allgather data from rank %d at iter %d\n",
+              rank,
+              r,
+              i);
+          return 1;
+        }
+      }
+    }
+  }
+  result->allGatherUs = elapsedUs(start) / iters;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; i++) {
+    if (bootstrapBarrier(comm->bootstrap, ranks.data(), rank, nranks, i) !=
+        ncclSuccess) {
+      return 1;
+    }
+  }
+  result->barrierUs = elapsedUs(start) / iters;
+
+  // Make sure nobody closes its connections while others are still in the
+  // last barrier
+  if (bootstrapBarrier(comm->bootstrap, ranks.data(), rank, nranks, -1) !=
+      ncclSuccess) {
+    return 1;
+  }
+  if (bootstrapClose(comm->bootstrap) != ncclSuccess) {
+    return 1;
+  }
+  return 0;
+}
+
+static bool runOne(int nranks, int size, int iters, const char* algo) {
+  setenv("NCCL_BOOTSTRAP_ALLGATHER_ALGO", algo, 1);
+  ncclCvarInit();
+
+  ncclBootstrapHandle handle;
+  if (bootstrapGetUniqueId(&handle) != ncclSuccess) {
+    fprintf(stderr, "bootstrapGetUniqueId failed\n");
+    return false;
+  }
+
+  auto results = static_cast<RankResult*>(mmap(
+      nullptr,
+      sizeof(RankResult) * nranks,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_ANONYMOUS,
+      -1,
+      0));
+  if (results == MAP_FAILED) {
+    perror("mmap");
+    return false;
+  }
+  memset(results, 0, sizeof(RankResult) * nranks);
+
+  std::vector<pid_t> pids;
+  for (int r = 0; r < nranks; r++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      results[r].error = runRank(&handle, r, nranks, size, iters, &results[r]);
+      _exit(results[r].error);
+    } else if (pid < 0) {
+      perror("fork");
+      return false;
+    }
+    pids.push_back(pid);
+  }
+
+  bool ok = true;
+  for (auto pid : pids) {
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      ok = false;
+    }
+  }
+
+  // Report the slowest rank, which is what the collective init waits for
+  RankResult worst = {0, 0, 0, 0};
+  for (int r = 0; r < nranks; r++) {
+    worst.initUs = std::max(worst.initUs, results[r].initUs);
+    worst.allGatherUs = std::max(worst.allGatherUs, results[r].allGatherUs);
+    worst.barrierUs = std::max(worst.barrierUs, results[r].barrierUs);
+  }
+  printf(
+      "%8d %8s %10d %14.1f %16.1f %14.1f %s\n",
+      nranks,
+      algo,
+      size,
+      worst.initUs,
+      worst.allGatherUs,
+      worst.barrierUs,
+      ok ? "" : "FAILED");
+
+  munmap(results, sizeof(RankResult) * nranks);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  int minRanks = argc > 1 ? atoi(argv[1]) : 64;
+  int maxRanks = argc > 2 ? atoi(argv[2]) : 1024;
+  int size = argc > 3 ? atoi(argv[3]) : 64;
+  int iters = argc > 4 ? atoi(argv[4]) : 10;
+
+  // Each rank holds a few sockets per peer at power-of-two distance
+  struct rlimit filesLimit;
+  getrlimit(RLIMIT_NOFILE, &filesLimit);
+  filesLimit.rlim_cur = filesLimit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &filesLimit);
+
+  setenv("NCCL_DEBUG", "WARN", 0);
+  ncclCvarInit();
+  if (bootstrapNetInit() != ncclSuccess) {
+    fprintf(stderr, "bootstrapNetInit failed\n");
+    return EXIT_FAILURE;
+  }
+
+  printf(
+      "%8s %8s %10s %14s %16s %14s\n",
+      "nranks",
+      "algo",
+      "size(B)",
+      "init(us)",
+      "allgather(us)",
+      "barrier(us)");
+
+  bool ok = true;
+  for (int nranks = minRanks; nranks <= maxRanks; nranks *= 2) {
+    for (const char* algo : {"ring", "bruck"}) {
+      ok &= runOne(nranks, size, iters, algo);
+    }
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,222 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <gtest/gtest.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <vector>
+#include "bootstrap.h"
+#include "comm.h"
+#include "nccl_cvars.h"
+
+// Ranks of these tests are forked processes on the local host sharing a root
+// owned by the test process. Only the bootstrap state of the communicator is
+// initialized, so no GPU is needed.
+class BootstrapTest : public ::testing::Test {
+ public:
+  BootstrapTest() = default;
+
+  void SetUp() override {
+    setenv("NCCL_DEBUG", "WARN", 0);
+    ncclCvarInit();
+
+    // Pending connections each hold a file descriptor on the receiver
+    struct rlimit filesLimit;
+    getrlimit(RLIMIT_NOFILE, &filesLimit);
+    filesLimit.rlim_cur = filesLimit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &filesLimit);
+
+    ASSERT_EQ(bootstrapNetInit(), ncclSuccess);
+    ASSERT_EQ(bootstrapGetUniqueId(&this->handle), ncclSuccess);
+  }
+
+  ncclComm* createBootstrapComm(int rank, int nranks) {
+    auto comm = static_cast<ncclComm*>(calloc(1, sizeof(ncclComm)));
+    comm->rank = rank;
+    comm->nRanks = nranks;
+    comm->abortFlag = static_cast<uint32_t*>(calloc(1, sizeof(uint32_t)));
+    comm->sharedRes = static_cast<ncclSharedResources*>(
+        calloc(1, sizeof(ncclSharedResources)));
+    if (bootstrapInit(&this->handle, comm) != ncclSuccess) {
+      return nullptr;
+    }
+    return comm;
+  }
+
+  // Fork nranks-1 processes running fn as ranks 1..nranks-1; the caller is
+  // rank 0
+  std::vector<pid_t> forkRanks(int nranks, std::function<int(int)> fn) {
+    std::vector<pid_t> pids;
+    for (int r = 1; r < nranks; r++) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        _exit(fn(r));
+      }
+      pids.push_back(pid);
+    }
+    return pids;
+  }
+
+  void waitRanks(std::vector<pid_t>& pids) {
+    for (auto pid : pids) {
+      int status;
+      ASSERT_EQ(waitpid(pid, &status, 0), pid);
+      EXPECT_TRUE(WIFEXITED(status));
+      EXPECT_EQ(WEXITSTATUS(status), 0);
+    }
+  }
+
+ protected:
+  ncclBootstrapHandle handle;
+};
+
+struct UnexpectedMsg {
+  int rank;
+  int tag;
+  int seq;
+};
+
+TEST_F(BootstrapTest, UnexpectedMessagesStress) {
+  constexpr int numSenders = 8;
+  constexpr int numTags = 625;
+  constexpr int numSeqs = 2;
+  constexpr int nranks = numSenders + 1;
+
+  // Every sender sends numSeqs messages for each tag in increasing tag order
+  auto pids = this->forkRanks(nranks, [&](int rank) {
+    ncclComm* comm = this->createBootstrapComm(rank, nranks);
+    if (comm == nullptr) {
+      return 1;
+    }
+    for (int tag = 0; tag < numTags; tag++) {
+      for (int seq = 0; seq < numSeqs; seq++) {
+        UnexpectedMsg msg = {rank, tag, seq};
+        if (bootstrapSend(comm->bootstrap, 0, tag, &msg, sizeof(msg)) !=
+            ncclSuccess) {
+          return 1;
+        }
+      }
+    }
+    std::vector<int> ranks(nranks);
+    for (int i = 0; i < nranks; i++) {
+      ranks[i] = i;
+    }
+    if (bootstrapBarrier(comm->bootstrap, ranks.data(), rank, nranks, 0) !=
+            ncclSuccess ||
+        bootstrapClose(comm->bootstrap) != ncclSuccess) {
+      return 1;
+    }
+    return 0;
+  });
+
+  ncclComm* comm = this->createBootstrapComm(0, nranks);
+  ASSERT_NE(comm, nullptr);
+
+  // Receive in decreasing tag order, so that nearly all messages are
+  // unexpected when they arrive. Messages of the same peer and tag must be
+  // received in the order they were sent.
+  auto start = std::chrono::steady_clock::now();
+  for (int tag = numTags - 1; tag >= 0; tag--) {
+    for (int peer = 1; peer < nranks; peer++) {
+      for (int seq = 0; seq < numSeqs; seq++) {
+        UnexpectedMsg msg = {-1, -1, -1};
+        ASSERT_EQ(
+            bootstrapRecv(comm->bootstrap, peer, tag, &msg, sizeof(msg)),
+            ncclSuccess);
+        EXPECT_EQ(msg.rank, peer);
+        EXPECT_EQ(msg.tag, tag);
+        EXPECT_EQ(msg.seq, seq);
+      }
+    }
+  }
+  auto elapsed = std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  std::cout << "Received " << numSenders * numTags * numSeqs
+            << " out-of-order messages in " << elapsed << " ms" << std::endl;
+
+  std::vector<int> ranks(nranks);
+  for (int i = 0; i < nranks; i++) {
+    ranks[i] = i;
+  }
+  EXPECT_EQ(
+      bootstrapBarrier(comm->bootstrap, ranks.data(), 0, nranks, 0),
+      ncclSuccess);
+  // All unexpected messages have been consumed
+  EXPECT_EQ(bootstrapClose(comm->bootstrap), ncclSuccess);
+
+  this->waitRanks(pids);
+}
+
+TEST_F(BootstrapTest, PersistentSendRecv) {
+  constexpr int nranks = 4;
+  constexpr int numRounds = 3;
+  const std::vector<int> sizes = {0, 4, 4096, 256 * 1024};
+
+  auto fill = [](int src, int dst, int round, size_t i) {
+    return static_cast<char>(src * 31 + dst * 7 + round + i);
+  };
+
+  // Every pair of ranks exchanges messages of all sizes, one tag per size,
+  // over several rounds. The receiver consumes them in reverse tag order, so
+  // later messages are buffered while earlier ones are still in flight. Pairs
+  // are processed in the same order on all ranks and the lower rank sends
+  // first, so that large messages cannot block both sides.
+  auto exchange = [&](ncclComm* comm, int rank) {
+    for (int peer = 0; peer < nranks; peer++) {
+      if (peer == rank) {
+        continue;
+      }
+      for (int round = 0; round < numRounds; round++) {
+        for (int pass = 0; pass < 2; pass++) {
+          bool send = (pass == 0) == (rank < peer);
+          for (int t = 0; t < sizes.size(); t++) {
+            int tag = send ? t : sizes.size() - 1 - t;
+            std::vector<char> buf(sizes[tag]);
+            if (send) {
+              for (size_t i = 0; i < buf.size(); i++) {
+                buf[i] = fill(rank, peer, round, i);
+              }
+              if (bootstrapSend(
+                      comm->bootstrap, peer, tag, buf.data(), buf.size()) !=
+                  ncclSuccess) {
+                return 1;
+              }
+            } else {
+              if (bootstrapRecv(
+                      comm->bootstrap, peer, tag, buf.data(), buf.size()) !=
+                  ncclSuccess) {
+                return 1;
+              }
+              for (size_t i = 0; i < buf.size(); i++) {
+                if (buf[i] != fill(peer, rank, round, i)) {
+                  return 1;
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+    return 0;
+  };
+
+  auto pids = this->forkRanks(nranks, [&](int rank) {
+    ncclComm* comm = this->createBootstrapComm(rank, nranks);
+    if (comm == nullptr || exchange(comm, rank) != 0) {
+      return 1;
+    }
+    return bootstrapClose(comm->bootstrap) == ncclSuccess ? 0 : 1;
+  });
+
+  ncclComm* comm = this->createBootstrapComm(0, nranks);
+  ASSERT_NE(comm, nullptr);
+  EXPECT_EQ(exchange(comm, 0), 0);
+  EXPECT_EQ(bootstrapClose(comm->bootstrap), ncclSuccess);
+
+  this->waitRanks(pids);
+}
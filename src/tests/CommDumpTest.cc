@@ -6,6 +6,7 @@
 #include <iostream>
 #include <string>
 #include <unordered_map>
+#include "CommDumpBinary.h"
 #include "ProxyMock.h"
 #include "comm.h"
 #include "json/json.h"
@@ -202,6 +203,112 @@ TEST_F(CommDumpTest, DumpAfterColl) {
   }
 }
 
+TEST_F(CommDumpTest, DumpDelta) {
+  std::unordered_map<std::string, std::string> dump;
+  ncclCommDumpCursor cursor = {0, 0};
+  constexpr int numColls = 5;
+
+  auto runColls = [this](int n) {
+    for (int i = 0; i < n; i++) {
+      NCCLCHECK_TEST(ncclAllReduce(
+          this->dataBuf,
+          this->dataBuf,
+          this->dataCount,
+          ncclInt,
+          ncclSum,
+          this->comm,
+          this->stream));
+    }
+    CUDACHECK_TEST(cudaStreamSynchronize(this->stream));
+    // Same workaround as DumpAfterColl to wait for the tail proxy sends
+    sleep(3);
+  };
+
+  this->initData(this->globalRank);
+  runColls(numColls);
+  ASSERT_EQ(ncclCommDumpDelta(this->comm, &cursor, dump), ncclSuccess);
+  EXPECT_EQ(cursor.collTraceSeq, numColls);
+  if (comm->rank == 0) {
+    EXPECT_EQ(dump.count("rings"), 1);
+  }
+
+  // Second call only returns the new collectives, without metadata
+  dump.clear();
+  runColls(numColls);
+  ASSERT_EQ(ncclCommDumpDelta(this->comm, &cursor, dump), ncclSuccess);
+  EXPECT_EQ(cursor.collTraceSeq, 2 * numColls);
+  EXPECT_EQ(dump.count("rings"), 0);
+  ASSERT_EQ(dump.count("CT_pastColls"), 1);
+  Json::Value ctPastCollsObjs;
+  std::stringstream(dump["CT_pastColls"]) >> ctPastCollsObjs;
+  ASSERT_EQ(ctPastCollsObjs.size(), numColls);
+  for (int i = 0; i < numColls; i++) {
+    EXPECT_EQ(ctPastCollsObjs[i]["opCount"].asUInt64(), numColls + i);
+  }
+  if (comm->nNodes > 1) {
+    EXPECT_EQ(cursor.proxyTraceSeq, 2 * numColls);
+  }
+
+  // Nothing new since the previous call
+  dump.clear();
+  ASSERT_EQ(ncclCommDumpDelta(this->comm, &cursor, dump), ncclSuccess);
+  std::stringstream(dump["CT_pastColls"]) >> ctPastCollsObjs;
+  EXPECT_EQ(ctPastCollsObjs.size(), 0);
+
+  EXPECT_EQ(ncclCommDumpDelta(this->comm, nullptr, dump), ncclInvalidArgument);
+}
+
+TEST_F(CommDumpTest, DumpBinary) {
+  std::string buf;
+  ncclCommDumpCursor cursor = {0, 0};
+  constexpr int numColls = 10;
+
+  this->initData(this->globalRank);
+  for (int i = 0; i < numColls; i++) {
+    NCCLCHECK_TEST(ncclAllReduce(
+        this->dataBuf,
+        this->dataBuf,
+        this->dataCount,
+        ncclInt,
+        ncclSum,
+        this->comm,
+        this->stream));
+  }
+  CUDACHECK_TEST(cudaStreamSynchronize(this->stream));
+  sleep(3);
+
+  ASSERT_EQ(ncclCommDumpBinary(this->comm, &cursor, buf), ncclSuccess);
+  CommDumpBinaryReader reader;
+  ASSERT_TRUE(reader.parse(buf));
+  EXPECT_EQ(reader.header().commHash, comm->commHash);
+  EXPECT_EQ(reader.header().rank, comm->rank);
+  EXPECT_TRUE(reader.header().flags & COMM_DUMP_BINARY_COLLTRACE);
+  EXPECT_FALSE(reader.header().flags & COMM_DUMP_BINARY_CURRENT_COLL);
+  ASSERT_EQ(reader.ctPastColls.size(), numColls);
+  for (int i = 0; i < numColls; i++) {
+    EXPECT_EQ(reader.ctPastColls[i].opCount, i);
+    EXPECT_EQ(reader.ctPastColls[i].coll, ncclFuncAllReduce);
+    EXPECT_EQ(reader.ctPastColls[i].count, this->dataCount);
+  }
+  EXPECT_EQ(reader.ctPendingColls.size(), 0);
+  if (comm->nNodes > 1) {
+    ASSERT_EQ(reader.ptPastColls.size(), numColls);
+    EXPECT_EQ(reader.ptActiveOps.size(), 0);
+  }
+
+  // Delta of a binary dump only contains the header
+  ASSERT_EQ(ncclCommDumpBinary(this->comm, &cursor, buf), ncclSuccess);
+  ASSERT_TRUE(reader.parse(buf));
+  EXPECT_EQ(buf.size(), sizeof(CommDumpBinaryHeader));
+  EXPECT_EQ(reader.header().ctPastCollsSince, numColls);
+  EXPECT_EQ(reader.ctPastColls.size(), 0);
+
+  // Without cursor, everything is dumped again
+  ASSERT_EQ(ncclCommDumpBinary(this->comm, nullptr, buf), ncclSuccess);
+  ASSERT_TRUE(reader.parse(buf));
+  EXPECT_EQ(reader.ctPastColls.size(), numColls);
+}
+
 TEST_F(CommDumpTest, DumpDuringColl) {
   auto res = ncclSuccess;
   std::unordered_map<std::string, std::string> dump;
@@ -311,6 +311,84 @@ TEST_F(CvarTest, NCCL_ALLTOALL_ALGO_warn_unknown_val) {
   testWarn("NCCL_ALLTOALL_ALGO", "Unknown value");
 }
 
+TEST_F(CvarTest, NCCL_BOOTSTRAP_ALLGATHER_ALGO_single_choice_0) {
+  setenv("NCCL_BOOTSTRAP_ALLGATHER_ALGO", "adaptive", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_BOOTSTRAP_ALLGATHER_ALGO, NCCL_BOOTSTRAP_ALLGATHER_ALGO::adaptive);
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_ALLGATHER_ALGO_single_choice_1) {
+  setenv("NCCL_BOOTSTRAP_ALLGATHER_ALGO", "ring", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_BOOTSTRAP_ALLGATHER_ALGO, NCCL_BOOTSTRAP_ALLGATHER_ALGO::ring);
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_ALLGATHER_ALGO_single_choice_2) {
+  setenv("NCCL_BOOTSTRAP_ALLGATHER_ALGO", "bruck", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_BOOTSTRAP_ALLGATHER_ALGO, NCCL_BOOTSTRAP_ALLGATHER_ALGO::bruck);
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_ALLGATHER_ALGO_default_choice) {
+  testDefaultValue("NCCL_BOOTSTRAP_ALLGATHER_ALGO");
+  EXPECT_EQ(NCCL_BOOTSTRAP_ALLGATHER_ALGO, NCCL_BOOTSTRAP_ALLGATHER_ALGO::adaptive);
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_ALLGATHER_ALGO_warn_unknown_val) {
+  setenv("NCCL_BOOTSTRAP_ALLGATHER_ALGO", "dummy", 1);
+  testWarn("NCCL_BOOTSTRAP_ALLGATHER_ALGO", "Unknown value");
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_BRUCK_MAX_SIZE_value_0) {
+  testNumValue<int64_t>("NCCL_BOOTSTRAP_BRUCK_MAX_SIZE", 0);
+  EXPECT_EQ(NCCL_BOOTSTRAP_BRUCK_MAX_SIZE, 0);
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_BRUCK_MAX_SIZE_value_1) {
+  testNumValue<int64_t>("NCCL_BOOTSTRAP_BRUCK_MAX_SIZE", 9999);
+  EXPECT_EQ(NCCL_BOOTSTRAP_BRUCK_MAX_SIZE, 9999);
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_BRUCK_MAX_SIZE_value_2) {
+  testNumValue<int64_t>("NCCL_BOOTSTRAP_BRUCK_MAX_SIZE", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_BOOTSTRAP_BRUCK_MAX_SIZE, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_BRUCK_MAX_SIZE_value_3) {
+  testNumValue<int64_t>("NCCL_BOOTSTRAP_BRUCK_MAX_SIZE", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_BOOTSTRAP_BRUCK_MAX_SIZE, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_BRUCK_MAX_SIZE_default_value) {
+  testDefaultValue("NCCL_BOOTSTRAP_BRUCK_MAX_SIZE");
+  EXPECT_EQ(NCCL_BOOTSTRAP_BRUCK_MAX_SIZE, 1048576);
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_BRUCK_MIN_RANKS_value_0) {
+  testNumValue<int>("NCCL_BOOTSTRAP_BRUCK_MIN_RANKS", 0);
+  EXPECT_EQ(NCCL_BOOTSTRAP_BRUCK_MIN_RANKS, 0);
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_BRUCK_MIN_RANKS_value_1) {
+  testNumValue<int>("NCCL_BOOTSTRAP_BRUCK_MIN_RANKS", 9999);
+  EXPECT_EQ(NCCL_BOOTSTRAP_BRUCK_MIN_RANKS, 9999);
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_BRUCK_MIN_RANKS_value_2) {
+  testNumValue<int>("NCCL_BOOTSTRAP_BRUCK_MIN_RANKS", std::numeric_limits<int>::max());
+  EXPECT_EQ(NCCL_BOOTSTRAP_BRUCK_MIN_RANKS, std::numeric_limits<int>::max());
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_BRUCK_MIN_RANKS_value_3) {
+  testNumValue<int>("NCCL_BOOTSTRAP_BRUCK_MIN_RANKS", std::numeric_limits<int>::min());
+  EXPECT_EQ(NCCL_BOOTSTRAP_BRUCK_MIN_RANKS, std::numeric_limits<int>::min());
+}
+
+TEST_F(CvarTest, NCCL_BOOTSTRAP_BRUCK_MIN_RANKS_default_value) {
+  testDefaultValue("NCCL_BOOTSTRAP_BRUCK_MIN_RANKS");
+  EXPECT_EQ(NCCL_BOOTSTRAP_BRUCK_MIN_RANKS, 16);
+}
+
 TEST_F(CvarTest, NCCL_BUFFSIZE_value_0) {
   testNumValue<int64_t>("NCCL_BUFFSIZE", 0);
   EXPECT_EQ(NCCL_BUFFSIZE, 0);
@@ -476,6 +554,31 @@ TEST_F(CvarTest, NCCL_COLLTRACE_warn_dup_val) {
   testWarn("NCCL_COLLTRACE", "Duplicate token");
 }
 
+TEST_F(CvarTest, NCCL_COLLTRACE_BINARY_RECORDS_value_0) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_BINARY_RECORDS", 0);
+  EXPECT_EQ(NCCL_COLLTRACE_BINARY_RECORDS, 0);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_BINARY_RECORDS_value_1) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_BINARY_RECORDS", 9999);
+  EXPECT_EQ(NCCL_COLLTRACE_BINARY_RECORDS, 9999);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_BINARY_RECORDS_value_2) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_BINARY_RECORDS", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_COLLTRACE_BINARY_RECORDS, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_BINARY_RECORDS_value_3) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_BINARY_RECORDS", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_COLLTRACE_BINARY_RECORDS, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_BINARY_RECORDS_default_value) {
+  testDefaultValue("NCCL_COLLTRACE_BINARY_RECORDS");
+  EXPECT_EQ(NCCL_COLLTRACE_BINARY_RECORDS, 1048576);
+}
+
 TEST_F(CvarTest, NCCL_COLLTRACE_DIR_value_0) {
   setenv("NCCL_COLLTRACE_DIR", "val1", 1);
   ncclCvarInit();
@@ -488,6 +591,156 @@ TEST_F(CvarTest, NCCL_COLLTRACE_DIR_value_1) {
   EXPECT_EQ(NCCL_COLLTRACE_DIR, "val2_with_space");
 }
 
+TEST_F(CvarTest, NCCL_COLLTRACE_FILE_FORMAT_single_choice_0) {
+  setenv("NCCL_COLLTRACE_FILE_FORMAT", "json", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_COLLTRACE_FILE_FORMAT, NCCL_COLLTRACE_FILE_FORMAT::json);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_FILE_FORMAT_single_choice_1) {
+  setenv("NCCL_COLLTRACE_FILE_FORMAT", "binary", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_COLLTRACE_FILE_FORMAT, NCCL_COLLTRACE_FILE_FORMAT::binary);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_FILE_FORMAT_default_choice) {
+  testDefaultValue("NCCL_COLLTRACE_FILE_FORMAT");
+  EXPECT_EQ(NCCL_COLLTRACE_FILE_FORMAT, NCCL_COLLTRACE_FILE_FORMAT::json);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_FILE_FORMAT_warn_unknown_val) {
+  setenv("NCCL_COLLTRACE_FILE_FORMAT", "dummy", 1);
+  testWarn("NCCL_COLLTRACE_FILE_FORMAT", "Unknown value");
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_RECORD_MAX_value_0) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_RECORD_MAX", 0);
+  EXPECT_EQ(NCCL_COLLTRACE_RECORD_MAX, 0);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_RECORD_MAX_value_1) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_RECORD_MAX", 9999);
+  EXPECT_EQ(NCCL_COLLTRACE_RECORD_MAX, 9999);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_RECORD_MAX_value_2) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_RECORD_MAX", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_COLLTRACE_RECORD_MAX, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_RECORD_MAX_value_3) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_RECORD_MAX", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_COLLTRACE_RECORD_MAX, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_RECORD_MAX_default_value) {
+  testDefaultValue("NCCL_COLLTRACE_RECORD_MAX");
+  EXPECT_EQ(NCCL_COLLTRACE_RECORD_MAX, 20000);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_RECORD_MAX_BYTES_value_0) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_RECORD_MAX_BYTES", 0);
+  EXPECT_EQ(NCCL_COLLTRACE_RECORD_MAX_BYTES, 0);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_RECORD_MAX_BYTES_value_1) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_RECORD_MAX_BYTES", 9999);
+  EXPECT_EQ(NCCL_COLLTRACE_RECORD_MAX_BYTES, 9999);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_RECORD_MAX_BYTES_value_2) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_RECORD_MAX_BYTES", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_COLLTRACE_RECORD_MAX_BYTES, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_RECORD_MAX_BYTES_value_3) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_RECORD_MAX_BYTES", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_COLLTRACE_RECORD_MAX_BYTES, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_RECORD_MAX_BYTES_default_value) {
+  testDefaultValue("NCCL_COLLTRACE_RECORD_MAX_BYTES");
+  EXPECT_EQ(NCCL_COLLTRACE_RECORD_MAX_BYTES, 16777216);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLE_INTERVAL_value_0) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_SAMPLE_INTERVAL", 0);
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLE_INTERVAL, 0);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLE_INTERVAL_value_1) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_SAMPLE_INTERVAL", 9999);
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLE_INTERVAL, 9999);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLE_INTERVAL_value_2) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_SAMPLE_INTERVAL", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLE_INTERVAL, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLE_INTERVAL_value_3) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_SAMPLE_INTERVAL", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLE_INTERVAL, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLE_INTERVAL_default_value) {
+  testDefaultValue("NCCL_COLLTRACE_SAMPLE_INTERVAL");
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLE_INTERVAL, 100);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLE_RATE_value_0) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_SAMPLE_RATE", 0);
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLE_RATE, 0);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLE_RATE_value_1) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_SAMPLE_RATE", 9999);
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLE_RATE, 9999);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLE_RATE_value_2) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_SAMPLE_RATE", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLE_RATE, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLE_RATE_value_3) {
+  testNumValue<int64_t>("NCCL_COLLTRACE_SAMPLE_RATE", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLE_RATE, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLE_RATE_default_value) {
+  testDefaultValue("NCCL_COLLTRACE_SAMPLE_RATE");
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLE_RATE, 100);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLING_single_choice_0) {
+  setenv("NCCL_COLLTRACE_SAMPLING", "none", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLING, NCCL_COLLTRACE_SAMPLING::none);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLING_single_choice_1) {
+  setenv("NCCL_COLLTRACE_SAMPLING", "fixed", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLING, NCCL_COLLTRACE_SAMPLING::fixed);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLING_single_choice_2) {
+  setenv("NCCL_COLLTRACE_SAMPLING", "adaptive", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLING, NCCL_COLLTRACE_SAMPLING::adaptive);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLING_default_choice) {
+  testDefaultValue("NCCL_COLLTRACE_SAMPLING");
+  EXPECT_EQ(NCCL_COLLTRACE_SAMPLING, NCCL_COLLTRACE_SAMPLING::none);
+}
+
+TEST_F(CvarTest, NCCL_COLLTRACE_SAMPLING_warn_unknown_val) {
+  setenv("NCCL_COLLTRACE_SAMPLING", "dummy", 1);
+  testWarn("NCCL_COLLTRACE_SAMPLING", "Unknown value");
+}
+
 TEST_F(CvarTest, NCCL_COMM_BLOCKING_value_0) {
   testNumValue<int64_t>("NCCL_COMM_BLOCKING", 0);
   EXPECT_EQ(NCCL_COMM_BLOCKING, 0);
@@ -810,10 +1063,17 @@ TEST_F(CvarTest, NCCL_CTRAN_BACKENDS_single_choice_0) {
   checkListValues<enum NCCL_CTRAN_BACKENDS>(vals, NCCL_CTRAN_BACKENDS);
 }
 
+TEST_F(CvarTest, NCCL_CTRAN_BACKENDS_single_choice_1) {
+  setenv("NCCL_CTRAN_BACKENDS", "socket", 1);
+  ncclCvarInit();
+  std::vector<enum NCCL_CTRAN_BACKENDS> vals{NCCL_CTRAN_BACKENDS::socket};
+  checkListValues<enum NCCL_CTRAN_BACKENDS>(vals, NCCL_CTRAN_BACKENDS);
+}
+
 TEST_F(CvarTest, NCCL_CTRAN_BACKENDS_all_choices) {
-  setenv("NCCL_CTRAN_BACKENDS", "ib", 1);
+  setenv("NCCL_CTRAN_BACKENDS", "ib, socket", 1);
   ncclCvarInit();
-  std::vector<enum NCCL_CTRAN_BACKENDS> vals{NCCL_CTRAN_BACKENDS::ib};
+  std::vector<enum NCCL_CTRAN_BACKENDS> vals{NCCL_CTRAN_BACKENDS::ib,NCCL_CTRAN_BACKENDS::socket};
   checkListValues<enum NCCL_CTRAN_BACKENDS>(vals, NCCL_CTRAN_BACKENDS);
 }
 
@@ -833,6 +1093,109 @@ TEST_F(CvarTest, NCCL_CTRAN_BACKENDS_warn_dup_val) {
   testWarn("NCCL_CTRAN_BACKENDS", "Duplicate token");
 }
 
+TEST_F(CvarTest, NCCL_CTRAN_GPE_CMD_QUEUE_SIZE_value_0) {
+  testNumValue<int>("NCCL_CTRAN_GPE_CMD_QUEUE_SIZE", 0);
+  EXPECT_EQ(NCCL_CTRAN_GPE_CMD_QUEUE_SIZE, 0);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_CMD_QUEUE_SIZE_value_1) {
+  testNumValue<int>("NCCL_CTRAN_GPE_CMD_QUEUE_SIZE", 9999);
+  EXPECT_EQ(NCCL_CTRAN_GPE_CMD_QUEUE_SIZE, 9999);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_CMD_QUEUE_SIZE_value_2) {
+  testNumValue<int>("NCCL_CTRAN_GPE_CMD_QUEUE_SIZE", std::numeric_limits<int>::max());
+  EXPECT_EQ(NCCL_CTRAN_GPE_CMD_QUEUE_SIZE, std::numeric_limits<int>::max());
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_CMD_QUEUE_SIZE_value_3) {
+  testNumValue<int>("NCCL_CTRAN_GPE_CMD_QUEUE_SIZE", std::numeric_limits<int>::min());
+  EXPECT_EQ(NCCL_CTRAN_GPE_CMD_QUEUE_SIZE, std::numeric_limits<int>::min());
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_CMD_QUEUE_SIZE_default_value) {
+  testDefaultValue("NCCL_CTRAN_GPE_CMD_QUEUE_SIZE");
+  EXPECT_EQ(NCCL_CTRAN_GPE_CMD_QUEUE_SIZE, 1024);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_LATENCY_STATS_value_y0) {
+  setenv("NCCL_CTRAN_GPE_LATENCY_STATS", "y", 1);
+  ncclCvarInit();
+  EXPECT_TRUE(NCCL_CTRAN_GPE_LATENCY_STATS);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_LATENCY_STATS_value_y1) {
+  setenv("NCCL_CTRAN_GPE_LATENCY_STATS", "yes", 1);
+  ncclCvarInit();
+  EXPECT_TRUE(NCCL_CTRAN_GPE_LATENCY_STATS);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_LATENCY_STATS_value_y2) {
+  setenv("NCCL_CTRAN_GPE_LATENCY_STATS", "true", 1);
+  ncclCvarInit();
+  EXPECT_TRUE(NCCL_CTRAN_GPE_LATENCY_STATS);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_LATENCY_STATS_value_y3) {
+  setenv("NCCL_CTRAN_GPE_LATENCY_STATS", "1", 1);
+  ncclCvarInit();
+  EXPECT_TRUE(NCCL_CTRAN_GPE_LATENCY_STATS);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_LATENCY_STATS_value_n0) {
+  setenv("NCCL_CTRAN_GPE_LATENCY_STATS", "n", 1);
+  ncclCvarInit();
+  EXPECT_FALSE(NCCL_CTRAN_GPE_LATENCY_STATS);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_LATENCY_STATS_value_n1) {
+  setenv("NCCL_CTRAN_GPE_LATENCY_STATS", "no", 1);
+  ncclCvarInit();
+  EXPECT_FALSE(NCCL_CTRAN_GPE_LATENCY_STATS);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_LATENCY_STATS_value_n2) {
+  setenv("NCCL_CTRAN_GPE_LATENCY_STATS", "false", 1);
+  ncclCvarInit();
+  EXPECT_FALSE(NCCL_CTRAN_GPE_LATENCY_STATS);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_LATENCY_STATS_value_n3) {
+  setenv("NCCL_CTRAN_GPE_LATENCY_STATS", "0", 1);
+  ncclCvarInit();
+  EXPECT_FALSE(NCCL_CTRAN_GPE_LATENCY_STATS);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_LATENCY_STATS_warn_unknown_val) {
+  setenv("NCCL_CTRAN_GPE_LATENCY_STATS", "dummy", 1);
+  testWarn("NCCL_CTRAN_GPE_LATENCY_STATS", "Unknown value");
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_SPIN_USEC_value_0) {
+  testNumValue<int>("NCCL_CTRAN_GPE_SPIN_USEC", 0);
+  EXPECT_EQ(NCCL_CTRAN_GPE_SPIN_USEC, 0);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_SPIN_USEC_value_1) {
+  testNumValue<int>("NCCL_CTRAN_GPE_SPIN_USEC", 9999);
+  EXPECT_EQ(NCCL_CTRAN_GPE_SPIN_USEC, 9999);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_SPIN_USEC_value_2) {
+  testNumValue<int>("NCCL_CTRAN_GPE_SPIN_USEC", std::numeric_limits<int>::max());
+  EXPECT_EQ(NCCL_CTRAN_GPE_SPIN_USEC, std::numeric_limits<int>::max());
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_SPIN_USEC_value_3) {
+  testNumValue<int>("NCCL_CTRAN_GPE_SPIN_USEC", std::numeric_limits<int>::min());
+  EXPECT_EQ(NCCL_CTRAN_GPE_SPIN_USEC, std::numeric_limits<int>::min());
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_GPE_SPIN_USEC_default_value) {
+  testDefaultValue("NCCL_CTRAN_GPE_SPIN_USEC");
+  EXPECT_EQ(NCCL_CTRAN_GPE_SPIN_USEC, 50);
+}
+
 TEST_F(CvarTest, NCCL_CTRAN_IB_CTRL_TC_value_0) {
   testNumValue<uint64_t>("NCCL_CTRAN_IB_CTRL_TC", 0);
   EXPECT_EQ(NCCL_CTRAN_IB_CTRL_TC, 0);
@@ -1010,18 +1373,24 @@ TEST_F(CvarTest, NCCL_CTRAN_PROFILING_single_choice_0) {
 }
 
 TEST_F(CvarTest, NCCL_CTRAN_PROFILING_single_choice_1) {
+  setenv("NCCL_CTRAN_PROFILING", "stats", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_CTRAN_PROFILING, NCCL_CTRAN_PROFILING::stats);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_PROFILING_single_choice_2) {
   setenv("NCCL_CTRAN_PROFILING", "stdout", 1);
   ncclCvarInit();
   EXPECT_EQ(NCCL_CTRAN_PROFILING, NCCL_CTRAN_PROFILING::stdout);
 }
 
-TEST_F(CvarTest, NCCL_CTRAN_PROFILING_single_choice_2) {
+TEST_F(CvarTest, NCCL_CTRAN_PROFILING_single_choice_3) {
   setenv("NCCL_CTRAN_PROFILING", "info", 1);
   ncclCvarInit();
   EXPECT_EQ(NCCL_CTRAN_PROFILING, NCCL_CTRAN_PROFILING::info);
 }
 
-TEST_F(CvarTest, NCCL_CTRAN_PROFILING_single_choice_3) {
+TEST_F(CvarTest, NCCL_CTRAN_PROFILING_single_choice_4) {
   setenv("NCCL_CTRAN_PROFILING", "kineto", 1);
   ncclCvarInit();
   EXPECT_EQ(NCCL_CTRAN_PROFILING, NCCL_CTRAN_PROFILING::kineto);
@@ -1190,6 +1559,106 @@ TEST_F(CvarTest, NCCL_CTRAN_SHARED_DEVBUF_SIZE_default_value) {
   EXPECT_EQ(NCCL_CTRAN_SHARED_DEVBUF_SIZE, 8388608);
 }
 
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_CHUNK_SIZE_value_0) {
+  testNumValue<uint64_t>("NCCL_CTRAN_SOCKET_CHUNK_SIZE", 0);
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_CHUNK_SIZE, 0);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_CHUNK_SIZE_value_1) {
+  testNumValue<uint64_t>("NCCL_CTRAN_SOCKET_CHUNK_SIZE", 9999);
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_CHUNK_SIZE, 9999);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_CHUNK_SIZE_value_2) {
+  testNumValue<uint64_t>("NCCL_CTRAN_SOCKET_CHUNK_SIZE", std::numeric_limits<uint64_t>::max());
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_CHUNK_SIZE, std::numeric_limits<uint64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_CHUNK_SIZE_value_3) {
+  testNumValue<uint64_t>("NCCL_CTRAN_SOCKET_CHUNK_SIZE", std::numeric_limits<uint64_t>::min());
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_CHUNK_SIZE, std::numeric_limits<uint64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_CHUNK_SIZE_default_value) {
+  testDefaultValue("NCCL_CTRAN_SOCKET_CHUNK_SIZE");
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_CHUNK_SIZE, 1048576);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_NUM_STREAMS_value_0) {
+  testNumValue<int>("NCCL_CTRAN_SOCKET_NUM_STREAMS", 0);
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_NUM_STREAMS, 0);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_NUM_STREAMS_value_1) {
+  testNumValue<int>("NCCL_CTRAN_SOCKET_NUM_STREAMS", 9999);
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_NUM_STREAMS, 9999);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_NUM_STREAMS_value_2) {
+  testNumValue<int>("NCCL_CTRAN_SOCKET_NUM_STREAMS", std::numeric_limits<int>::max());
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_NUM_STREAMS, std::numeric_limits<int>::max());
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_NUM_STREAMS_value_3) {
+  testNumValue<int>("NCCL_CTRAN_SOCKET_NUM_STREAMS", std::numeric_limits<int>::min());
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_NUM_STREAMS, std::numeric_limits<int>::min());
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_NUM_STREAMS_default_value) {
+  testDefaultValue("NCCL_CTRAN_SOCKET_NUM_STREAMS");
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_NUM_STREAMS, 2);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD_value_0) {
+  testNumValue<uint64_t>("NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD", 0);
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD, 0);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD_value_1) {
+  testNumValue<uint64_t>("NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD", 9999);
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD, 9999);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD_value_2) {
+  testNumValue<uint64_t>("NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD", std::numeric_limits<uint64_t>::max());
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD, std::numeric_limits<uint64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD_value_3) {
+  testNumValue<uint64_t>("NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD", std::numeric_limits<uint64_t>::min());
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD, std::numeric_limits<uint64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD_default_value) {
+  testDefaultValue("NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD");
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_STREAM_SCALING_THRESHOLD, 1048576);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD_value_0) {
+  testNumValue<int64_t>("NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD", 0);
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD, 0);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD_value_1) {
+  testNumValue<int64_t>("NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD", 9999);
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD, 9999);
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD_value_2) {
+  testNumValue<int64_t>("NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD_value_3) {
+  testNumValue<int64_t>("NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD_default_value) {
+  testDefaultValue("NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD");
+  EXPECT_EQ(NCCL_CTRAN_SOCKET_ZCOPY_THRESHOLD, 65536);
+}
+
 TEST_F(CvarTest, NCCL_CTRAN_TOPO_FILE_value_0) {
   setenv("NCCL_CTRAN_TOPO_FILE", "val1", 1);
   ncclCvarInit();
@@ -2263,6 +2732,12 @@ TEST_F(CvarTest, NCCL_LOGGER_MODE_single_choice_1) {
   EXPECT_EQ(NCCL_LOGGER_MODE, NCCL_LOGGER_MODE::async);
 }
 
+TEST_F(CvarTest, NCCL_LOGGER_MODE_single_choice_2) {
+  setenv("NCCL_LOGGER_MODE", "ring", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_LOGGER_MODE, NCCL_LOGGER_MODE::ring);
+}
+
 TEST_F(CvarTest, NCCL_LOGGER_MODE_default_choice) {
   testDefaultValue("NCCL_LOGGER_MODE");
   EXPECT_EQ(NCCL_LOGGER_MODE, NCCL_LOGGER_MODE::sync);
@@ -2273,6 +2748,31 @@ TEST_F(CvarTest, NCCL_LOGGER_MODE_warn_unknown_val) {
   testWarn("NCCL_LOGGER_MODE", "Unknown value");
 }
 
+TEST_F(CvarTest, NCCL_LOGGER_RING_SIZE_value_0) {
+  testNumValue<int64_t>("NCCL_LOGGER_RING_SIZE", 0);
+  EXPECT_EQ(NCCL_LOGGER_RING_SIZE, 0);
+}
+
+TEST_F(CvarTest, NCCL_LOGGER_RING_SIZE_value_1) {
+  testNumValue<int64_t>("NCCL_LOGGER_RING_SIZE", 9999);
+  EXPECT_EQ(NCCL_LOGGER_RING_SIZE, 9999);
+}
+
+TEST_F(CvarTest, NCCL_LOGGER_RING_SIZE_value_2) {
+  testNumValue<int64_t>("NCCL_LOGGER_RING_SIZE", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_LOGGER_RING_SIZE, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_LOGGER_RING_SIZE_value_3) {
+  testNumValue<int64_t>("NCCL_LOGGER_RING_SIZE", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_LOGGER_RING_SIZE, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_LOGGER_RING_SIZE_default_value) {
+  testDefaultValue("NCCL_LOGGER_RING_SIZE");
+  EXPECT_EQ(NCCL_LOGGER_RING_SIZE, 262144);
+}
+
 TEST_F(CvarTest, NCCL_MAX_CTAS_value_0) {
   testNumValue<int64_t>("NCCL_MAX_CTAS", 0);
   EXPECT_EQ(NCCL_MAX_CTAS, 0);
@@ -2395,6 +2895,71 @@ TEST_F(CvarTest, NCCL_MEM_SYNC_DOMAIN_warn_unknown_val) {
   testWarn("NCCL_MEM_SYNC_DOMAIN", "Unknown value");
 }
 
+TEST_F(CvarTest, NCCL_METRICS_EXPORT_single_choice_0) {
+  setenv("NCCL_METRICS_EXPORT", "none", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_METRICS_EXPORT, NCCL_METRICS_EXPORT::none);
+}
+
+TEST_F(CvarTest, NCCL_METRICS_EXPORT_single_choice_1) {
+  setenv("NCCL_METRICS_EXPORT", "file", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_METRICS_EXPORT, NCCL_METRICS_EXPORT::file);
+}
+
+TEST_F(CvarTest, NCCL_METRICS_EXPORT_single_choice_2) {
+  setenv("NCCL_METRICS_EXPORT", "socket", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_METRICS_EXPORT, NCCL_METRICS_EXPORT::socket);
+}
+
+TEST_F(CvarTest, NCCL_METRICS_EXPORT_default_choice) {
+  testDefaultValue("NCCL_METRICS_EXPORT");
+  EXPECT_EQ(NCCL_METRICS_EXPORT, NCCL_METRICS_EXPORT::none);
+}
+
+TEST_F(CvarTest, NCCL_METRICS_EXPORT_warn_unknown_val) {
+  setenv("NCCL_METRICS_EXPORT", "dummy", 1);
+  testWarn("NCCL_METRICS_EXPORT", "Unknown value");
+}
+
+TEST_F(CvarTest, NCCL_METRICS_INTERVAL_MS_value_0) {
+  testNumValue<int64_t>("NCCL_METRICS_INTERVAL_MS", 0);
+  EXPECT_EQ(NCCL_METRICS_INTERVAL_MS, 0);
+}
+
+TEST_F(CvarTest, NCCL_METRICS_INTERVAL_MS_value_1) {
+  testNumValue<int64_t>("NCCL_METRICS_INTERVAL_MS", 9999);
+  EXPECT_EQ(NCCL_METRICS_INTERVAL_MS, 9999);
+}
+
+TEST_F(CvarTest, NCCL_METRICS_INTERVAL_MS_value_2) {
+  testNumValue<int64_t>("NCCL_METRICS_INTERVAL_MS", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_METRICS_INTERVAL_MS, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_METRICS_INTERVAL_MS_value_3) {
+  testNumValue<int64_t>("NCCL_METRICS_INTERVAL_MS", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_METRICS_INTERVAL_MS, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_METRICS_INTERVAL_MS_default_value) {
+  testDefaultValue("NCCL_METRICS_INTERVAL_MS");
+  EXPECT_EQ(NCCL_METRICS_INTERVAL_MS, 1000);
+}
+
+TEST_F(CvarTest, NCCL_METRICS_PATH_value_0) {
+  setenv("NCCL_METRICS_PATH", "val1", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_METRICS_PATH, "val1");
+}
+
+TEST_F(CvarTest, NCCL_METRICS_PATH_value_1) {
+  setenv("NCCL_METRICS_PATH", "  val2_with_space   ", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_METRICS_PATH, "val2_with_space");
+}
+
 TEST_F(CvarTest, NCCL_MIN_CTAS_value_0) {
   testNumValue<int64_t>("NCCL_MIN_CTAS", 0);
   EXPECT_EQ(NCCL_MIN_CTAS, 0);
@@ -3178,6 +3743,106 @@ TEST_F(CvarTest, NCCL_PROXYTRACE_warn_dup_val) {
   testWarn("NCCL_PROXYTRACE", "Duplicate token");
 }
 
+TEST_F(CvarTest, NCCL_PROXYTRACE_RECORD_MAX_value_0) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_RECORD_MAX", 0);
+  EXPECT_EQ(NCCL_PROXYTRACE_RECORD_MAX, 0);
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RECORD_MAX_value_1) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_RECORD_MAX", 9999);
+  EXPECT_EQ(NCCL_PROXYTRACE_RECORD_MAX, 9999);
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RECORD_MAX_value_2) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_RECORD_MAX", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_PROXYTRACE_RECORD_MAX, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RECORD_MAX_value_3) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_RECORD_MAX", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_PROXYTRACE_RECORD_MAX, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RECORD_MAX_default_value) {
+  testDefaultValue("NCCL_PROXYTRACE_RECORD_MAX");
+  EXPECT_EQ(NCCL_PROXYTRACE_RECORD_MAX, 20000);
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RECORD_MAX_BYTES_value_0) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_RECORD_MAX_BYTES", 0);
+  EXPECT_EQ(NCCL_PROXYTRACE_RECORD_MAX_BYTES, 0);
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RECORD_MAX_BYTES_value_1) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_RECORD_MAX_BYTES", 9999);
+  EXPECT_EQ(NCCL_PROXYTRACE_RECORD_MAX_BYTES, 9999);
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RECORD_MAX_BYTES_value_2) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_RECORD_MAX_BYTES", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_PROXYTRACE_RECORD_MAX_BYTES, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RECORD_MAX_BYTES_value_3) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_RECORD_MAX_BYTES", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_PROXYTRACE_RECORD_MAX_BYTES, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RECORD_MAX_BYTES_default_value) {
+  testDefaultValue("NCCL_PROXYTRACE_RECORD_MAX_BYTES");
+  EXPECT_EQ(NCCL_PROXYTRACE_RECORD_MAX_BYTES, 4194304);
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RING_SIZE_value_0) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_RING_SIZE", 0);
+  EXPECT_EQ(NCCL_PROXYTRACE_RING_SIZE, 0);
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RING_SIZE_value_1) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_RING_SIZE", 9999);
+  EXPECT_EQ(NCCL_PROXYTRACE_RING_SIZE, 9999);
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RING_SIZE_value_2) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_RING_SIZE", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_PROXYTRACE_RING_SIZE, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RING_SIZE_value_3) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_RING_SIZE", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_PROXYTRACE_RING_SIZE, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_RING_SIZE_default_value) {
+  testDefaultValue("NCCL_PROXYTRACE_RING_SIZE");
+  EXPECT_EQ(NCCL_PROXYTRACE_RING_SIZE, 65536);
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_TIMELINE_RECORD_MAX_value_0) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_TIMELINE_RECORD_MAX", 0);
+  EXPECT_EQ(NCCL_PROXYTRACE_TIMELINE_RECORD_MAX, 0);
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_TIMELINE_RECORD_MAX_value_1) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_TIMELINE_RECORD_MAX", 9999);
+  EXPECT_EQ(NCCL_PROXYTRACE_TIMELINE_RECORD_MAX, 9999);
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_TIMELINE_RECORD_MAX_value_2) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_TIMELINE_RECORD_MAX", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_PROXYTRACE_TIMELINE_RECORD_MAX, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_TIMELINE_RECORD_MAX_value_3) {
+  testNumValue<int64_t>("NCCL_PROXYTRACE_TIMELINE_RECORD_MAX", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_PROXYTRACE_TIMELINE_RECORD_MAX, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_PROXYTRACE_TIMELINE_RECORD_MAX_default_value) {
+  testDefaultValue("NCCL_PROXYTRACE_TIMELINE_RECORD_MAX");
+  EXPECT_EQ(NCCL_PROXYTRACE_TIMELINE_RECORD_MAX, 1048576);
+}
+
 TEST_F(CvarTest, NCCL_PROXY_APPEND_BATCH_SIZE_value_0) {
   testNumValue<int64_t>("NCCL_PROXY_APPEND_BATCH_SIZE", 0);
   EXPECT_EQ(NCCL_PROXY_APPEND_BATCH_SIZE, 0);
@@ -3228,6 +3893,96 @@ TEST_F(CvarTest, NCCL_PROXY_DUMP_SIGNAL_default_value) {
   EXPECT_EQ(NCCL_PROXY_DUMP_SIGNAL, -1);
 }
 
+TEST_F(CvarTest, NCCL_PROXY_IDLE_POLICY_single_choice_0) {
+  setenv("NCCL_PROXY_IDLE_POLICY", "sleep", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_PROXY_IDLE_POLICY, NCCL_PROXY_IDLE_POLICY::sleep);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_POLICY_single_choice_1) {
+  setenv("NCCL_PROXY_IDLE_POLICY", "spin", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_PROXY_IDLE_POLICY, NCCL_PROXY_IDLE_POLICY::spin);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_POLICY_single_choice_2) {
+  setenv("NCCL_PROXY_IDLE_POLICY", "hybrid", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_PROXY_IDLE_POLICY, NCCL_PROXY_IDLE_POLICY::hybrid);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_POLICY_default_choice) {
+  testDefaultValue("NCCL_PROXY_IDLE_POLICY");
+  EXPECT_EQ(NCCL_PROXY_IDLE_POLICY, NCCL_PROXY_IDLE_POLICY::hybrid);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_POLICY_warn_unknown_val) {
+  setenv("NCCL_PROXY_IDLE_POLICY", "dummy", 1);
+  testWarn("NCCL_PROXY_IDLE_POLICY", "Unknown value");
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_SPIN_MAX_NS_value_0) {
+  testNumValue<int64_t>("NCCL_PROXY_IDLE_SPIN_MAX_NS", 0);
+  EXPECT_EQ(NCCL_PROXY_IDLE_SPIN_MAX_NS, 0);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_SPIN_MAX_NS_value_1) {
+  testNumValue<int64_t>("NCCL_PROXY_IDLE_SPIN_MAX_NS", 9999);
+  EXPECT_EQ(NCCL_PROXY_IDLE_SPIN_MAX_NS, 9999);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_SPIN_MAX_NS_value_2) {
+  testNumValue<int64_t>("NCCL_PROXY_IDLE_SPIN_MAX_NS", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_PROXY_IDLE_SPIN_MAX_NS, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_SPIN_MAX_NS_value_3) {
+  testNumValue<int64_t>("NCCL_PROXY_IDLE_SPIN_MAX_NS", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_PROXY_IDLE_SPIN_MAX_NS, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_SPIN_MAX_NS_default_value) {
+  testDefaultValue("NCCL_PROXY_IDLE_SPIN_MAX_NS");
+  EXPECT_EQ(NCCL_PROXY_IDLE_SPIN_MAX_NS, 50000);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_SPIN_MIN_NS_value_0) {
+  testNumValue<int64_t>("NCCL_PROXY_IDLE_SPIN_MIN_NS", 0);
+  EXPECT_EQ(NCCL_PROXY_IDLE_SPIN_MIN_NS, 0);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_SPIN_MIN_NS_value_1) {
+  testNumValue<int64_t>("NCCL_PROXY_IDLE_SPIN_MIN_NS", 9999);
+  EXPECT_EQ(NCCL_PROXY_IDLE_SPIN_MIN_NS, 9999);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_SPIN_MIN_NS_value_2) {
+  testNumValue<int64_t>("NCCL_PROXY_IDLE_SPIN_MIN_NS", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_PROXY_IDLE_SPIN_MIN_NS, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_SPIN_MIN_NS_value_3) {
+  testNumValue<int64_t>("NCCL_PROXY_IDLE_SPIN_MIN_NS", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_PROXY_IDLE_SPIN_MIN_NS, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_PROXY_IDLE_SPIN_MIN_NS_default_value) {
+  testDefaultValue("NCCL_PROXY_IDLE_SPIN_MIN_NS");
+  EXPECT_EQ(NCCL_PROXY_IDLE_SPIN_MIN_NS, 1000);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_OP_RECORD_FILE_value_0) {
+  setenv("NCCL_PROXY_OP_RECORD_FILE", "val1", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_PROXY_OP_RECORD_FILE, "val1");
+}
+
+TEST_F(CvarTest, NCCL_PROXY_OP_RECORD_FILE_value_1) {
+  setenv("NCCL_PROXY_OP_RECORD_FILE", "  val2_with_space   ", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_PROXY_OP_RECORD_FILE, "val2_with_space");
+}
+
 TEST_F(CvarTest, NCCL_PROXY_PROFILE_value_0) {
   setenv("NCCL_PROXY_PROFILE", "val1", 1);
   ncclCvarInit();
@@ -3257,6 +4012,114 @@ TEST_F(CvarTest, NCCL_PROXY_PROFILE_DIR_default_value) {
   EXPECT_EQ(NCCL_PROXY_PROFILE_DIR, "/tmp");
 }
 
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_NUMA_PIN_value_y0) {
+  setenv("NCCL_PROXY_PROGRESS_NUMA_PIN", "y", 1);
+  ncclCvarInit();
+  EXPECT_TRUE(NCCL_PROXY_PROGRESS_NUMA_PIN);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_NUMA_PIN_value_y1) {
+  setenv("NCCL_PROXY_PROGRESS_NUMA_PIN", "yes", 1);
+  ncclCvarInit();
+  EXPECT_TRUE(NCCL_PROXY_PROGRESS_NUMA_PIN);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_NUMA_PIN_value_y2) {
+  setenv("NCCL_PROXY_PROGRESS_NUMA_PIN", "true", 1);
+  ncclCvarInit();
+  EXPECT_TRUE(NCCL_PROXY_PROGRESS_NUMA_PIN);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_NUMA_PIN_value_y3) {
+  setenv("NCCL_PROXY_PROGRESS_NUMA_PIN", "1", 1);
+  ncclCvarInit();
+  EXPECT_TRUE(NCCL_PROXY_PROGRESS_NUMA_PIN);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_NUMA_PIN_value_n0) {
+  setenv("NCCL_PROXY_PROGRESS_NUMA_PIN", "n", 1);
+  ncclCvarInit();
+  EXPECT_FALSE(NCCL_PROXY_PROGRESS_NUMA_PIN);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_NUMA_PIN_value_n1) {
+  setenv("NCCL_PROXY_PROGRESS_NUMA_PIN", "no", 1);
+  ncclCvarInit();
+  EXPECT_FALSE(NCCL_PROXY_PROGRESS_NUMA_PIN);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_NUMA_PIN_value_n2) {
+  setenv("NCCL_PROXY_PROGRESS_NUMA_PIN", "false", 1);
+  ncclCvarInit();
+  EXPECT_FALSE(NCCL_PROXY_PROGRESS_NUMA_PIN);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_NUMA_PIN_value_n3) {
+  setenv("NCCL_PROXY_PROGRESS_NUMA_PIN", "0", 1);
+  ncclCvarInit();
+  EXPECT_FALSE(NCCL_PROXY_PROGRESS_NUMA_PIN);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_NUMA_PIN_default_value) {
+  testDefaultValue("NCCL_PROXY_PROGRESS_NUMA_PIN");
+  EXPECT_TRUE(NCCL_PROXY_PROGRESS_NUMA_PIN);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_NUMA_PIN_warn_unknown_val) {
+  setenv("NCCL_PROXY_PROGRESS_NUMA_PIN", "dummy", 1);
+  testWarn("NCCL_PROXY_PROGRESS_NUMA_PIN", "Unknown value");
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_THREADS_value_0) {
+  testNumValue<int64_t>("NCCL_PROXY_PROGRESS_THREADS", 0);
+  EXPECT_EQ(NCCL_PROXY_PROGRESS_THREADS, 0);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_THREADS_value_1) {
+  testNumValue<int64_t>("NCCL_PROXY_PROGRESS_THREADS", 9999);
+  EXPECT_EQ(NCCL_PROXY_PROGRESS_THREADS, 9999);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_THREADS_value_2) {
+  testNumValue<int64_t>("NCCL_PROXY_PROGRESS_THREADS", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_PROXY_PROGRESS_THREADS, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_THREADS_value_3) {
+  testNumValue<int64_t>("NCCL_PROXY_PROGRESS_THREADS", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_PROXY_PROGRESS_THREADS, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_PROXY_PROGRESS_THREADS_default_value) {
+  testDefaultValue("NCCL_PROXY_PROGRESS_THREADS");
+  EXPECT_EQ(NCCL_PROXY_PROGRESS_THREADS, 1);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_RPC_BATCH_SIZE_value_0) {
+  testNumValue<int64_t>("NCCL_PROXY_RPC_BATCH_SIZE", 0);
+  EXPECT_EQ(NCCL_PROXY_RPC_BATCH_SIZE, 0);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_RPC_BATCH_SIZE_value_1) {
+  testNumValue<int64_t>("NCCL_PROXY_RPC_BATCH_SIZE", 9999);
+  EXPECT_EQ(NCCL_PROXY_RPC_BATCH_SIZE, 9999);
+}
+
+TEST_F(CvarTest, NCCL_PROXY_RPC_BATCH_SIZE_value_2) {
+  testNumValue<int64_t>("NCCL_PROXY_RPC_BATCH_SIZE", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_PROXY_RPC_BATCH_SIZE, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_PROXY_RPC_BATCH_SIZE_value_3) {
+  testNumValue<int64_t>("NCCL_PROXY_RPC_BATCH_SIZE", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_PROXY_RPC_BATCH_SIZE, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_PROXY_RPC_BATCH_SIZE_default_value) {
+  testDefaultValue("NCCL_PROXY_RPC_BATCH_SIZE");
+  EXPECT_EQ(NCCL_PROXY_RPC_BATCH_SIZE, 128);
+}
+
 TEST_F(CvarTest, NCCL_PXN_DISABLE_value_0) {
   testNumValue<int64_t>("NCCL_PXN_DISABLE", 0);
   EXPECT_EQ(NCCL_PXN_DISABLE, 0);
@@ -3478,6 +4341,31 @@ TEST_F(CvarTest, NCCL_SOCKET_NTHREADS_default_value) {
   EXPECT_EQ(NCCL_SOCKET_NTHREADS, -2);
 }
 
+TEST_F(CvarTest, NCCL_SOCKET_ZCOPY_THRESHOLD_value_0) {
+  testNumValue<int64_t>("NCCL_SOCKET_ZCOPY_THRESHOLD", 0);
+  EXPECT_EQ(NCCL_SOCKET_ZCOPY_THRESHOLD, 0);
+}
+
+TEST_F(CvarTest, NCCL_SOCKET_ZCOPY_THRESHOLD_value_1) {
+  testNumValue<int64_t>("NCCL_SOCKET_ZCOPY_THRESHOLD", 9999);
+  EXPECT_EQ(NCCL_SOCKET_ZCOPY_THRESHOLD, 9999);
+}
+
+TEST_F(CvarTest, NCCL_SOCKET_ZCOPY_THRESHOLD_value_2) {
+  testNumValue<int64_t>("NCCL_SOCKET_ZCOPY_THRESHOLD", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_SOCKET_ZCOPY_THRESHOLD, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_SOCKET_ZCOPY_THRESHOLD_value_3) {
+  testNumValue<int64_t>("NCCL_SOCKET_ZCOPY_THRESHOLD", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_SOCKET_ZCOPY_THRESHOLD, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_SOCKET_ZCOPY_THRESHOLD_default_value) {
+  testDefaultValue("NCCL_SOCKET_ZCOPY_THRESHOLD");
+  EXPECT_EQ(NCCL_SOCKET_ZCOPY_THRESHOLD, -1);
+}
+
 TEST_F(CvarTest, NCCL_THREAD_THRESHOLDS_value_0) {
   setenv("NCCL_THREAD_THRESHOLDS", "val1", 1);
   ncclCvarInit();
@@ -3539,6 +4427,68 @@ TEST_F(CvarTest, NCCL_TOPO_FILE_default_value) {
   EXPECT_EQ(NCCL_TOPO_FILE, "/var/run/nvidia-topologyd/virtualTopology.xml");
 }
 
+TEST_F(CvarTest, NCCL_TOPO_SEARCH_CACHE_value_0) {
+  testNumValue<int64_t>("NCCL_TOPO_SEARCH_CACHE", 0);
+  EXPECT_EQ(NCCL_TOPO_SEARCH_CACHE, 0);
+}
+
+TEST_F(CvarTest, NCCL_TOPO_SEARCH_CACHE_value_1) {
+  testNumValue<int64_t>("NCCL_TOPO_SEARCH_CACHE", 9999);
+  EXPECT_EQ(NCCL_TOPO_SEARCH_CACHE, 9999);
+}
+
+TEST_F(CvarTest, NCCL_TOPO_SEARCH_CACHE_value_2) {
+  testNumValue<int64_t>("NCCL_TOPO_SEARCH_CACHE", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_TOPO_SEARCH_CACHE, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_TOPO_SEARCH_CACHE_value_3) {
+  testNumValue<int64_t>("NCCL_TOPO_SEARCH_CACHE", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_TOPO_SEARCH_CACHE, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_TOPO_SEARCH_CACHE_default_value) {
+  testDefaultValue("NCCL_TOPO_SEARCH_CACHE");
+  EXPECT_EQ(NCCL_TOPO_SEARCH_CACHE, 1);
+}
+
+TEST_F(CvarTest, NCCL_TOPO_SEARCH_CACHE_DIR_value_0) {
+  setenv("NCCL_TOPO_SEARCH_CACHE_DIR", "val1", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_TOPO_SEARCH_CACHE_DIR, "val1");
+}
+
+TEST_F(CvarTest, NCCL_TOPO_SEARCH_CACHE_DIR_value_1) {
+  setenv("NCCL_TOPO_SEARCH_CACHE_DIR", "  val2_with_space   ", 1);
+  ncclCvarInit();
+  EXPECT_EQ(NCCL_TOPO_SEARCH_CACHE_DIR, "val2_with_space");
+}
+
+TEST_F(CvarTest, NCCL_TOPO_SEARCH_THREADS_value_0) {
+  testNumValue<int64_t>("NCCL_TOPO_SEARCH_THREADS", 0);
+  EXPECT_EQ(NCCL_TOPO_SEARCH_THREADS, 0);
+}
+
+TEST_F(CvarTest, NCCL_TOPO_SEARCH_THREADS_value_1) {
+  testNumValue<int64_t>("NCCL_TOPO_SEARCH_THREADS", 9999);
+  EXPECT_EQ(NCCL_TOPO_SEARCH_THREADS, 9999);
+}
+
+TEST_F(CvarTest, NCCL_TOPO_SEARCH_THREADS_value_2) {
+  testNumValue<int64_t>("NCCL_TOPO_SEARCH_THREADS", std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(NCCL_TOPO_SEARCH_THREADS, std::numeric_limits<int64_t>::max());
+}
+
+TEST_F(CvarTest, NCCL_TOPO_SEARCH_THREADS_value_3) {
+  testNumValue<int64_t>("NCCL_TOPO_SEARCH_THREADS", std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(NCCL_TOPO_SEARCH_THREADS, std::numeric_limits<int64_t>::min());
+}
+
+TEST_F(CvarTest, NCCL_TOPO_SEARCH_THREADS_default_value) {
+  testDefaultValue("NCCL_TOPO_SEARCH_THREADS");
+  EXPECT_EQ(NCCL_TOPO_SEARCH_THREADS, 1);
+}
+
 TEST_F(CvarTest, NCCL_TUNER_PLUGIN_value_0) {
   setenv("NCCL_TUNER_PLUGIN", "val1", 1);
   ncclCvarInit();
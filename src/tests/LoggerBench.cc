@@ -0,0 +1,146 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// CPU-only microbenchmark of the cost of NCCL INFO logging on the calling
+// threads. nThreads threads each log nMsgs INFO messages of the COLL
+// subsystem to a debug file with every NCCL_LOGGER_MODE:
+//  - sync: written by the calling thread to the unbuffered debug file
+//  - async: queued under a mutex, written by the logger thread
+//  - ring: copied to the buffer of the calling thread, written in batches by
+//    the logger thread
+// Each mode runs in a child process, since the logger is initialized once per
+// process. ns/msg is the time spent in INFO by the calling threads, total
+// includes writing all messages until the process exits.
+//
+// Usage: LoggerBench [nThreads] [nMsgs] [logFilePrefix]
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "debug.h"
+#include "logger.h"
+#include "nccl_cvars.h"
+
+struct Result {
+  double ns;
+  uint64_t dropped;
+};
+
+static Result runMode(int nThreads, int nMsgs) {
+  std::vector<double> ns(nThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nThreads; t++) {
+    threads.emplace_back([&, t]() {
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < nMsgs; i++) {
+        INFO(
+            NCCL_COLL,
+            "AllReduce: opCount %x sendbuff %p recvbuff %p count %d datatype %d op %d root %d comm %p [nranks=%d] stream %p",
+            i,
+            &ns,
+            &threads,
+            1 << (i % 20),
+            7,
+            0,
+            0,
+            &nMsgs,
+            8,
+            nullptr);
+      }
+      ns[t] = std::chrono::duration<double, std::nano>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  double total = 0;
+  for (auto t : ns) {
+    total += t;
+  }
+  return {total / (static_cast<double>(nThreads) * nMsgs),
+          NcclLogger::droppedMessages()};
+}
+
+static int countLines(const std::string& path) {
+  std::ifstream f(path);
+  int n = 0;
+  for (std::string line; std::getline(f, line);) {
+    n += line.find("NCCL INFO AllReduce") != std::string::npos;
+  }
+  return n;
+}
+
+int main(int argc, char** argv) {
+  int nThreads = argc > 1 ? atoi(argv[1]) : 4;
+  int nMsgs = argc > 2 ? atoi(argv[2]) : 100000;
+  std::string prefix = argc > 3
+      ? argv[3]
+      : "/tmp/nccl_logger_bench_" + std::to_string(getpid());
+
+  printf(
+      "%8s %8s %10s %10s %12s %10s %10s\n",
+      "mode",
+      "threads",
+      "msgs",
+      "ns/msg",
+      "total(ms)",
+      "written",
+      "dropped");
+  for (std::string mode : {"sync", "async", "ring"}) {
+    std::string path = prefix + "." + mode + ".log";
+    int fds[2];
+    if (pipe(fds) != 0) {
+      perror("pipe");
+      return EXIT_FAILURE;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t child = fork();
+    if (child == 0) {
+      setenv("NCCL_DEBUG", "INFO", 1);
+      setenv("NCCL_DEBUG_SUBSYS", "COLL", 1);
+      setenv("NCCL_DEBUG_FILE", path.c_str(), 1);
+      setenv("NCCL_LOGGER_MODE", mode.c_str(), 1);
+      ncclCvarInit();
+      Result res = runMode(nThreads, nMsgs);
+      if (write(fds[1], &res, sizeof(res)) != sizeof(res)) {
+        _exit(EXIT_FAILURE);
+      }
+      // Write the remaining messages at exit
+      exit(EXIT_SUCCESS);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    double totalMs = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    Result res{};
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS &&
+        read(fds[0], &res, sizeof(res)) == sizeof(res);
+    close(fds[0]);
+    close(fds[1]);
+    if (!ok) {
+      fprintf(stderr, "Benchmark failed in %s mode\n", mode.c_str());
+      return EXIT_FAILURE;
+    }
+
+    printf(
+        "%8s %8d %10d %10.1f %12.2f %10d %10lu\n",
+        mode.c_str(),
+        nThreads,
+        nMsgs,
+        res.ns,
+        totalMs,
+        countLines(path),
+        res.dropped);
+    unlink(path.c_str());
+  }
+  return EXIT_SUCCESS;
+}
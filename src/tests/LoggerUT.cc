@@ -0,0 +1,113 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "logger.h"
+#include "nccl_cvars.h"
+
+class LoggerUT : public ::testing::Test {
+ public:
+  LoggerUT() = default;
+
+  void SetUp() override {
+    ncclCvarInit();
+  }
+
+  // Concatenate the pending bytes of the ring
+  std::string pending(NcclLogRing& ring) {
+    struct iovec iov[2];
+    int nIov = 0;
+    size_t len = ring.pending(iov, &nIov);
+    std::string str;
+    for (int i = 0; i < nIov; i++) {
+      str.append(static_cast<char*>(iov[i].iov_base), iov[i].iov_len);
+    }
+    EXPECT_EQ(str.size(), len);
+    return str;
+  }
+};
+
+TEST_F(LoggerUT, RingWrapAround) {
+  NcclLogRing ring(100, 0);
+  // Rounded up to the minimum size
+  ASSERT_EQ(ring.size(), 4096);
+
+  // Messages cross the end of the ring after a few rounds
+  std::string msg(1000, 'a');
+  for (int i = 0; i < 20; i++) {
+    msg[0] = 'a' + i;
+    ASSERT_TRUE(ring.push(msg.c_str(), msg.size()));
+    EXPECT_EQ(ring.used(), msg.size());
+    EXPECT_EQ(pending(ring), msg);
+    ring.release(msg.size());
+    EXPECT_EQ(ring.used(), 0);
+  }
+  EXPECT_EQ(ring.dropped(), 0);
+}
+
+TEST_F(LoggerUT, RingDropsWhenFull) {
+  NcclLogRing ring(4096, 0);
+  std::string msg(1000, 'a');
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(ring.push(msg.c_str(), msg.size()));
+  }
+  EXPECT_FALSE(ring.push(msg.c_str(), msg.size()));
+  EXPECT_FALSE(ring.push(msg.c_str(), msg.size()));
+  EXPECT_EQ(ring.dropped(), 2);
+  EXPECT_EQ(ring.used(), 4000);
+
+  // Space is available again once written
+  ring.release(2000);
+  EXPECT_TRUE(ring.push(msg.c_str(), msg.size()));
+  EXPECT_EQ(ring.dropped(), 2);
+  EXPECT_EQ(pending(ring), std::string(3000, 'a'));
+}
+
+TEST_F(LoggerUT, RingModeLogsAllThreads) {
+  const int nThreads = 4;
+  const int nMsgs = 1000;
+  std::string path = "/tmp/nccl_logger_ut_" + std::to_string(getpid()) + ".log";
+  FILE* file = fopen(path.c_str(), "w");
+  ASSERT_NE(file, nullptr);
+  NCCL_LOGGER_MODE = NCCL_LOGGER_MODE::ring;
+  NcclLogger::init(file);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nThreads; t++) {
+    threads.emplace_back([t]() {
+      for (int i = 0; i < nMsgs; i++) {
+        std::string msg =
+            "thread " + std::to_string(t) + " msg " + std::to_string(i) + "\n";
+        NcclLogger::log(msg, nullptr);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Messages are written in the background, wait for all of them
+  std::set<std::string> lines;
+  auto start = std::chrono::steady_clock::now();
+  while (lines.size() < nThreads * nMsgs &&
+         std::chrono::steady_clock::now() - start < std::chrono::seconds(10)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    lines.clear();
+    std::ifstream f(path);
+    for (std::string line; std::getline(f, line);) {
+      if (line.rfind("thread ", 0) == 0) {
+        lines.insert(line);
+      }
+    }
+  }
+  EXPECT_EQ(lines.size(), nThreads * nMsgs);
+  EXPECT_EQ(NcclLogger::droppedMessages(), 0);
+  unlink(path.c_str());
+}
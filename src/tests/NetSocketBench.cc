@@ -0,0 +1,162 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// Loopback throughput benchmark of the internal NET/Socket transport. A sender
+// and a receiver thread drive the ncclNet_t API the same way the net proxy
+// does: up to NCCL_NET_MAX_REQUESTS requests are kept in flight and tested in
+// posting order. Received data is checked on the last round of every size.
+//
+// The transport is configured through the usual environment variables, e.g.
+//   NCCL_SOCKET_NTHREADS=4 NCCL_NSOCKS_PERTHREAD=2 \
+//   NCCL_SOCKET_ZCOPY_THRESHOLD=65536 NetSocketBench
+// Note that the loopback interface copies zero-copy sends in the kernel, so it
+// only exercises the completion tracking; use NCCL_SOCKET_IFNAME to bench over
+// a real NIC against a peer on the same host.
+//
+// Usage: NetSocketBench [minBytes] [maxBytes] [iters]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "nccl_cvars.h"
+#include "net.h"
+
+static bool runSide(
+    bool send,
+    void* comm,
+    std::vector<std::vector<char>>& bufs,
+    int size,
+    int iters) {
+  const int window = bufs.size();
+  std::vector<void*> requests(window, nullptr);
+  int posted = 0, completed = 0;
+
+  while (completed < iters) {
+    while (posted < iters && posted - completed < window) {
+      int slot = posted % window;
+      void* data = bufs[slot].data();
+      void* mhandle = nullptr;
+      int tag = 0;
+      ncclResult_t res = send
+          ? ncclNetSocket.isend(comm, data, size, tag, mhandle, &requests[slot])
+          : ncclNetSocket.irecv(
+                comm, 1, &data, &size, &tag, &mhandle, &requests[slot]);
+      if (res != ncclSuccess) {
+        return false;
+      }
+      posted++;
+    }
+    int done = 0, recvSize = 0;
+    int slot = completed % window;
+    if (ncclNetSocket.test(requests[slot], &done, &recvSize) != ncclSuccess) {
+      return false;
+    }
+    if (done) {
+      if (!send && recvSize != size) {
+        fprintf(stderr, "Received %d bytes instead of %d\n", recvSize, size);
+        return false;
+      }
+      completed++;
+    }
+  }
+  return true;
+}
+
+static char pattern(int slot, int size, size_t i) {
+  return static_cast<char>(slot * 13 + size + i);
+}
+
+int main(int argc, char** argv) {
+  int minBytes = argc > 1 ? atoi(argv[1]) : 4096;
+  int maxBytes = argc > 2 ? atoi(argv[2]) : 64 * 1024 * 1024;
+  int iters = argc > 3 ? atoi(argv[3]) : 200;
+
+  setenv("NCCL_DEBUG", "WARN", 0);
+  setenv("NCCL_SOCKET_IFNAME", "lo", 0);
+  ncclCvarInit();
+
+  int ndev;
+  if (ncclNetSocket.init(nullptr) != ncclSuccess ||
+      ncclNetSocket.devices(&ndev) != ncclSuccess || ndev < 1) {
+    fprintf(stderr, "No socket interface found\n");
+    return EXIT_FAILURE;
+  }
+
+  char handle[NCCL_NET_HANDLE_MAXSIZE];
+  void *listenComm = nullptr, *sendComm = nullptr, *recvComm = nullptr;
+  if (ncclNetSocket.listen(0, handle, &listenComm) != ncclSuccess) {
+    fprintf(stderr, "Listen failed\n");
+    return EXIT_FAILURE;
+  }
+  bool acceptOk = true;
+  std::thread acceptor([&]() {
+    while (recvComm == nullptr && acceptOk) {
+      acceptOk = ncclNetSocket.accept(listenComm, &recvComm) == ncclSuccess;
+    }
+  });
+  while (sendComm == nullptr) {
+    if (ncclNetSocket.connect(0, handle, &sendComm) != ncclSuccess) {
+      fprintf(stderr, "Connect failed\n");
+      return EXIT_FAILURE;
+    }
+  }
+  acceptor.join();
+  if (!acceptOk) {
+    fprintf(stderr, "Accept failed\n");
+    return EXIT_FAILURE;
+  }
+
+  printf(
+      "NCCL_SOCKET_NTHREADS %ld NCCL_NSOCKS_PERTHREAD %ld NCCL_SOCKET_ZCOPY_THRESHOLD %ld\n",
+      NCCL_SOCKET_NTHREADS,
+      NCCL_NSOCKS_PERTHREAD,
+      NCCL_SOCKET_ZCOPY_THRESHOLD);
+  printf("%12s %8s %12s %12s\n", "size(B)", "iters", "time(us)", "bw(GB/s)");
+
+  bool ok = true;
+  for (int size = minBytes; size <= maxBytes && ok; size *= 2) {
+    std::vector<std::vector<char>> sendBufs(NCCL_NET_MAX_REQUESTS);
+    std::vector<std::vector<char>> recvBufs(NCCL_NET_MAX_REQUESTS);
+    for (int slot = 0; slot < NCCL_NET_MAX_REQUESTS; slot++) {
+      sendBufs[slot].resize(size);
+      recvBufs[slot].assign(size, 0);
+      for (size_t i = 0; i < sendBufs[slot].size(); i++) {
+        sendBufs[slot][i] = pattern(slot, size, i);
+      }
+    }
+
+    bool recvOk = true;
+    auto start = std::chrono::steady_clock::now();
+    std::thread receiver([&]() {
+      recvOk = runSide(false, recvComm, recvBufs, size, iters);
+    });
+    bool sendOk = runSide(true, sendComm, sendBufs, size, iters);
+    receiver.join();
+    double us = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+    ok = sendOk && recvOk;
+    // Buffers hold the data of the last round of every slot
+    for (int slot = 0; slot < NCCL_NET_MAX_REQUESTS && ok; slot++) {
+      if (slot < iters && recvBufs[slot] != sendBufs[slot]) {
+        fprintf(stderr, "Data mismatch for size %d slot %d\n", size, slot);
+        ok = false;
+      }
+    }
+    printf(
+        "%12d %8d %12.1f %12.2f %s\n",
+        size,
+        iters,
+        us,
+        static_cast<double>(size) * iters / us / 1e3,
+        ok ? "" : "FAILED");
+  }
+
+  ncclNetSocket.closeSend(sendComm);
+  ncclNetSocket.closeRecv(recvComm);
+  ncclNetSocket.closeListen(listenComm);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
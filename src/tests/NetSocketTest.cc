@@ -0,0 +1,159 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "nccl_cvars.h"
+#include "net.h"
+
+// Sender and receiver of these tests are two threads of the test process,
+// connected over the loopback interface through the ncclNet_t API of the
+// internal socket transport. No GPU is needed.
+class NetSocketTest
+    : public ::testing::TestWithParam<std::tuple<int, int, int>> {
+ public:
+  NetSocketTest() = default;
+
+  void SetUp() override {
+    auto [nThreads, nSocksPerThread, zcopyThreshold] = GetParam();
+    setenv("NCCL_DEBUG", "WARN", 0);
+    setenv("NCCL_SOCKET_IFNAME", "lo", 1);
+    setenv("NCCL_SOCKET_NTHREADS", std::to_string(nThreads).c_str(), 1);
+    setenv(
+        "NCCL_NSOCKS_PERTHREAD", std::to_string(nSocksPerThread).c_str(), 1);
+    setenv(
+        "NCCL_SOCKET_ZCOPY_THRESHOLD",
+        std::to_string(zcopyThreshold).c_str(),
+        1);
+    ncclCvarInit();
+
+    int ndev;
+    ASSERT_EQ(ncclNetSocket.init(nullptr), ncclSuccess);
+    ASSERT_EQ(ncclNetSocket.devices(&ndev), ncclSuccess);
+    ASSERT_GE(ndev, 1);
+
+    char handle[NCCL_NET_HANDLE_MAXSIZE];
+    ASSERT_EQ(ncclNetSocket.listen(0, handle, &listenComm), ncclSuccess);
+    std::thread acceptor([&]() {
+      while (recvComm == nullptr) {
+        if (ncclNetSocket.accept(listenComm, &recvComm) != ncclSuccess) {
+          return;
+        }
+      }
+    });
+    while (sendComm == nullptr) {
+      if (ncclNetSocket.connect(0, handle, &sendComm) != ncclSuccess) {
+        break;
+      }
+    }
+    acceptor.join();
+    ASSERT_NE(sendComm, nullptr);
+    ASSERT_NE(recvComm, nullptr);
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(ncclNetSocket.closeSend(sendComm), ncclSuccess);
+    EXPECT_EQ(ncclNetSocket.closeRecv(recvComm), ncclSuccess);
+    EXPECT_EQ(ncclNetSocket.closeListen(listenComm), ncclSuccess);
+    unsetenv("NCCL_SOCKET_NTHREADS");
+    unsetenv("NCCL_NSOCKS_PERTHREAD");
+    unsetenv("NCCL_SOCKET_ZCOPY_THRESHOLD");
+  }
+
+ protected:
+  void* listenComm{nullptr};
+  void* sendComm{nullptr};
+  void* recvComm{nullptr};
+};
+
+static char fill(int msg, size_t i) {
+  return static_cast<char>(msg * 7 + i);
+}
+
+TEST_P(NetSocketTest, PipelinedSendRecv) {
+  // Sizes vary from one message to the next, and receive buffers are larger
+  // than the messages, so the receiver relies on the size headers to find the
+  // message boundaries on the control socket.
+  const std::vector<int> sizes = {
+      0, 1, 4, 4093, 65536, 65537, 1 << 20, 3, 0, (1 << 20) + 5, 128};
+  constexpr int numRounds = 4;
+  constexpr int window = NCCL_NET_MAX_REQUESTS;
+  const int numMsgs = sizes.size() * numRounds;
+
+  auto run = [&](bool send, std::vector<std::vector<char>>& bufs) {
+    std::vector<void*> requests(window, nullptr);
+    int posted = 0, completed = 0;
+    while (completed < numMsgs) {
+      while (posted < numMsgs && posted - completed < window) {
+        int slot = posted % window;
+        int size = sizes[posted % sizes.size()];
+        void* mhandle = nullptr;
+        int tag = 0;
+        ncclResult_t res;
+        if (send) {
+          bufs[slot].resize(size);
+          for (int i = 0; i < size; i++) {
+            bufs[slot][i] = fill(posted, i);
+          }
+          res = ncclNetSocket.isend(
+              sendComm, bufs[slot].data(), size, tag, mhandle, &requests[slot]);
+        } else {
+          int maxSize = size + 4096;
+          bufs[slot].assign(maxSize, 0);
+          void* data = bufs[slot].data();
+          res = ncclNetSocket.irecv(
+              recvComm, 1, &data, &maxSize, &tag, &mhandle, &requests[slot]);
+        }
+        if (res != ncclSuccess) {
+          return false;
+        }
+        posted++;
+      }
+
+      int done = 0, size = -1;
+      int slot = completed % window;
+      if (ncclNetSocket.test(requests[slot], &done, &size) != ncclSuccess) {
+        return false;
+      }
+      if (done) {
+        int expected = sizes[completed % sizes.size()];
+        if (!send) {
+          if (size != expected) {
+            return false;
+          }
+          for (int i = 0; i < size; i++) {
+            if (bufs[slot][i] != fill(completed, i)) {
+              return false;
+            }
+          }
+        }
+        completed++;
+      }
+    }
+    return true;
+  };
+
+  std::vector<std::vector<char>> sendBufs(window), recvBufs(window);
+  bool recvOk = false;
+  std::thread receiver([&]() { recvOk = run(false, recvBufs); });
+  EXPECT_TRUE(run(true, sendBufs));
+  receiver.join();
+  EXPECT_TRUE(recvOk);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    NetSocketTestInstance,
+    NetSocketTest,
+    ::testing::Values(
+        // nThreads, nSocksPerThread, zcopyThreshold
+        std::make_tuple(0, 1, -1),
+        std::make_tuple(0, 1, 0),
+        std::make_tuple(2, 2, -1),
+        std::make_tuple(2, 2, 65536)),
+    [&](const testing::TestParamInfo<NetSocketTest::ParamType>& info) {
+      return std::to_string(std::get<0>(info.param)) + "threads_" +
+          std::to_string(std::get<1>(info.param)) + "socks_" +
+          (std::get<2>(info.param) >= 0 ? "zcopy" : "copy");
+    });
@@ -0,0 +1,248 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// Stress test of the handoff of proxy ops from the main threads of the local
+// ranks to the progress thread (ncclProxyPost/ncclProxyTakePostedOps). Each
+// producer thread stands for a local rank: it takes free ops from its part of
+// the ops pool like ncclLocalOpAppend, posts them in chains of [chain] ops,
+// and records the latency of each post. One consumer thread takes the posted
+// ops like ncclProxyGetPostedOps, checks each producer's ops arrive exactly
+// once and in order, and returns them to the free lists of their producer.
+//
+// Runs the same workload with the previous handoff under a mutex as
+// reference. No GPU is needed.
+//
+// Usage: ProxyPostBench [producers] [opsPerProducer] [chain]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <sched.h>
+#include <thread>
+#include <vector>
+#include "proxy.h"
+
+/* Reference implementation of the previous handoff under the pool mutex */
+
+struct LegacyQueue {
+  std::mutex mutex;
+  int nextOps{-1};
+  int nextOpsEnd{-1};
+};
+
+static void legacyPost(
+    ncclProxyOpsPool* pool,
+    LegacyQueue& queue,
+    int nextOps,
+    int nextOpsEnd) {
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.nextOps == -1) {
+    queue.nextOps = nextOps;
+  } else {
+    pool->ops[queue.nextOpsEnd].next = nextOps;
+  }
+  queue.nextOpsEnd = nextOpsEnd;
+}
+
+static int legacyTake(LegacyQueue& queue) {
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  int ops = queue.nextOps;
+  queue.nextOps = queue.nextOpsEnd = -1;
+  return ops;
+}
+
+static void initPool(ncclProxyOpsPool* pool, int nRanks) {
+  pool->postedOps = -1;
+  for (int r = 0; r < nRanks; r++) {
+    pool->freeOps[r] = r * MAX_OPS_PER_PEER;
+    for (int i = 0; i < MAX_OPS_PER_PEER - 1; i++) {
+      pool->ops[r * MAX_OPS_PER_PEER + i].next = r * MAX_OPS_PER_PEER + i + 1;
+    }
+    pool->ops[(r + 1) * MAX_OPS_PER_PEER - 1].next = -1;
+  }
+}
+
+// Take a free op of rank like ncclLocalOpAppend
+static int allocOp(ncclProxyOpsPool* pool, int rank, int& localFree) {
+  if (localFree == -1) {
+    int freeOp;
+    while ((freeOp = pool->freeOps[rank]) == -1) {
+      sched_yield();
+    }
+    int freeOpNew;
+    while ((freeOpNew = __sync_val_compare_and_swap(
+                pool->freeOps + rank, freeOp, -1)) != freeOp) {
+      freeOp = freeOpNew;
+    }
+    localFree = freeOp;
+  }
+  int op = localFree;
+  localFree = pool->ops[op].next;
+  return op;
+}
+
+// Return the ops taken to the free lists of their rank like
+// ncclProxyGetPostedOps. Returns false if an op is lost or out of order.
+static bool consumeOps(
+    ncclProxyOpsPool* pool,
+    int opIndex,
+    std::vector<uint64_t>& expected,
+    uint64_t& nConsumed) {
+  int nRanks = expected.size();
+  std::vector<int> freeOp(nRanks, -1), freeOpEnd(nRanks, -1);
+  while (opIndex != -1) {
+    ncclProxyOp* op = pool->ops + opIndex;
+    int rank = opIndex / MAX_OPS_PER_PEER;
+    if (op->opCount != expected[rank]) {
+      fprintf(
+          stderr,
+          "Rank %d: got op %lu instead of %lu\n",
+          rank,
+          op->opCount,
+          expected[rank]);
+      return false;
+    }
+    expected[rank]++;
+    nConsumed++;
+    int next = op->next;
+    if (freeOp[rank] == -1) {
+      freeOpEnd[rank] = opIndex;
+    } else {
+      op->next = freeOp[rank];
+    }
+    freeOp[rank] = opIndex;
+    opIndex = next;
+  }
+  for (int r = 0; r < nRanks; r++) {
+    if (freeOp[r] == -1) {
+      continue;
+    }
+    int oldFree = pool->freeOps[r];
+    pool->ops[freeOpEnd[r]].next = oldFree;
+    if (oldFree == -1) {
+      pool->freeOps[r] = freeOp[r];
+    } else if (
+        __sync_val_compare_and_swap(pool->freeOps + r, oldFree, freeOp[r]) !=
+        oldFree) {
+      pool->ops[freeOpEnd[r]].next = -1;
+      pool->freeOps[r] = freeOp[r];
+    }
+  }
+  return true;
+}
+
+static bool
+run(const char* name, bool legacy, int nRanks, uint64_t nOps, int chain) {
+  std::unique_ptr<ncclProxyOpsPool> pool(new ncclProxyOpsPool());
+  initPool(pool.get(), nRanks);
+  LegacyQueue queue;
+
+  std::vector<std::vector<uint32_t>> latencies(nRanks);
+  std::atomic<bool> ok{true};
+  auto start = std::chrono::steady_clock::now();
+  std::thread consumer([&]() {
+    std::vector<uint64_t> expected(nRanks, 0);
+    uint64_t nConsumed = 0;
+    while (nConsumed < nOps * nRanks && ok) {
+      int ops = legacy ? legacyTake(queue)
+                       : ncclProxyTakePostedOps(pool.get());
+      if (ops == -1) {
+        sched_yield();
+      } else if (!consumeOps(pool.get(), ops, expected, nConsumed)) {
+        ok = false;
+      }
+    }
+  });
+
+  std::vector<std::thread> producers;
+  for (int r = 0; r < nRanks; r++) {
+    producers.emplace_back([&, r]() {
+      auto& lat = latencies[r];
+      lat.reserve(nOps / chain + 1);
+      int localFree = -1;
+      for (uint64_t i = 0; i < nOps && ok;) {
+        int first = -1, last = -1;
+        for (int c = 0; c < chain && i < nOps; c++, i++) {
+          int op = allocOp(pool.get(), r, localFree);
+          pool->ops[op].opCount = i;
+          pool->ops[op].next = -1;
+          if (first == -1) {
+            first = op;
+          } else {
+            pool->ops[last].next = op;
+          }
+          last = op;
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        if (legacy) {
+          legacyPost(pool.get(), queue, first, last);
+        } else {
+          ncclProxyPost(pool.get(), first, last);
+        }
+        lat.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - t0)
+                          .count());
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  consumer.join();
+  double us = std::chrono::duration<double, std::micro>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+
+  std::vector<uint32_t> all;
+  for (auto& lat : latencies) {
+    all.insert(all.end(), lat.begin(), lat.end());
+  }
+  std::sort(all.begin(), all.end());
+  auto pct = [&](double p) {
+    return all.empty() ? 0 : all[std::min(all.size() - 1, (size_t)(p * all.size()))];
+  };
+  double sum = 0;
+  for (auto l : all) {
+    sum += l;
+  }
+  printf(
+      "%-10s %10.2f %10.1f %8u %8u %8u %10u %s\n",
+      name,
+      nOps * nRanks / us,
+      all.empty() ? 0 : sum / all.size(),
+      pct(0.5),
+      pct(0.99),
+      pct(0.999),
+      all.empty() ? 0 : all.back(),
+      ok ? "" : "FAILED");
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  int nRanks = argc > 1 ? atoi(argv[1]) : 8;
+  uint64_t nOps = argc > 2 ? strtoull(argv[2], nullptr, 0) : 1000000;
+  int chain = argc > 3 ? atoi(argv[3]) : 4;
+  if (nRanks < 1 || nRanks > NCCL_MAX_LOCAL_RANKS || chain < 1 ||
+      chain > MAX_OPS_PER_PEER) {
+    fprintf(stderr, "Usage: %s [producers] [opsPerProducer] [chain]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  printf(
+      "%d producers, %lu ops each, %d ops per post\n", nRanks, nOps, chain);
+  printf(
+      "%-10s %10s %10s %8s %8s %8s %10s\n",
+      "handoff",
+      "Mops/s",
+      "avg(ns)",
+      "p50",
+      "p99",
+      "p99.9",
+      "max");
+  bool ok = run("mutex", true, nRanks, nOps, chain);
+  ok &= run("lock-free", false, nRanks, nOps, chain);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,215 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// Loopback scaling benchmark of sharded proxy progress (see
+// NCCL_PROXY_PROGRESS_THREADS). Several connection pairs of the internal
+// NET/Socket transport stand for the NICs of a host, and are progressed by
+// 1 to nConns threads, each owning the connections of one shard the way the
+// proxy routes them: a thread does one pass over the send and recv sides of
+// its connections, posting up to NCCL_NET_MAX_REQUESTS requests and testing
+// the oldest one of each, like progressOps does over its active ops. Only the
+// host side of the proxy is exercised, no GPU is needed.
+//
+// The transport is configured through the usual environment variables, e.g.
+//   NCCL_SOCKET_NTHREADS=2 NCCL_NSOCKS_PERTHREAD=1 ProxyProgressBench
+//
+// Usage: ProxyProgressBench [nConns] [bytes] [iters]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "nccl_cvars.h"
+#include "net.h"
+
+struct BenchSide {
+  void* comm{nullptr};
+  std::vector<std::vector<char>> bufs;
+  std::vector<void*> requests;
+  int posted{0};
+  int completed{0};
+};
+
+struct BenchConn {
+  BenchSide send;
+  BenchSide recv;
+};
+
+// One progress pass over a side of a connection. Return false on error.
+static bool progressSide(bool send, BenchSide& side, int size, int iters) {
+  const int window = side.bufs.size();
+  if (side.posted < iters && side.posted - side.completed < window) {
+    int slot = side.posted % window;
+    void* data = side.bufs[slot].data();
+    void* mhandle = nullptr;
+    int tag = 0;
+    ncclResult_t res = send
+        ? ncclNetSocket.isend(
+              side.comm, data, size, tag, mhandle, &side.requests[slot])
+        : ncclNetSocket.irecv(
+              side.comm, 1, &data, &size, &tag, &mhandle, &side.requests[slot]);
+    if (res != ncclSuccess) {
+      return false;
+    }
+    // A null request means the transport is busy, retry on the next pass
+    if (side.requests[slot] != nullptr) {
+      side.posted++;
+    }
+  }
+  if (side.completed < side.posted) {
+    int done = 0, recvSize = 0;
+    int slot = side.completed % window;
+    if (ncclNetSocket.test(side.requests[slot], &done, &recvSize) !=
+        ncclSuccess) {
+      return false;
+    }
+    if (done) {
+      if (!send && recvSize != size) {
+        fprintf(stderr, "Received %d bytes instead of %d\n", recvSize, size);
+        return false;
+      }
+      side.requests[slot] = nullptr;
+      side.completed++;
+    }
+  }
+  return true;
+}
+
+static bool connectPair(BenchConn& conn) {
+  char handle[NCCL_NET_HANDLE_MAXSIZE];
+  void* listenComm = nullptr;
+  if (ncclNetSocket.listen(0, handle, &listenComm) != ncclSuccess) {
+    fprintf(stderr, "Listen failed\n");
+    return false;
+  }
+  bool acceptOk = true;
+  std::thread acceptor([&]() {
+    while (conn.recv.comm == nullptr && acceptOk) {
+      acceptOk =
+          ncclNetSocket.accept(listenComm, &conn.recv.comm) == ncclSuccess;
+    }
+  });
+  bool connectOk = true;
+  while (conn.send.comm == nullptr && connectOk) {
+    connectOk =
+        ncclNetSocket.connect(0, handle, &conn.send.comm) == ncclSuccess;
+  }
+  acceptor.join();
+  ncclNetSocket.closeListen(listenComm);
+  if (!connectOk || !acceptOk) {
+    fprintf(stderr, "Connect failed\n");
+    return false;
+  }
+  return true;
+}
+
+static void resetSide(BenchSide& side, int size, bool fill) {
+  side.bufs.assign(NCCL_NET_MAX_REQUESTS, std::vector<char>(size, 0));
+  side.requests.assign(NCCL_NET_MAX_REQUESTS, nullptr);
+  side.posted = side.completed = 0;
+  for (int slot = 0; fill && slot < NCCL_NET_MAX_REQUESTS; slot++) {
+    for (int i = 0; i < size; i++) {
+      side.bufs[slot][i] = static_cast<char>(slot * 7 + i);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  int nConns = argc > 1 ? atoi(argv[1]) : 8;
+  int size = argc > 2 ? atoi(argv[2]) : 1024 * 1024;
+  int iters = argc > 3 ? atoi(argv[3]) : 500;
+
+  setenv("NCCL_DEBUG", "WARN", 0);
+  setenv("NCCL_SOCKET_IFNAME", "lo", 0);
+  ncclCvarInit();
+
+  int ndev;
+  if (ncclNetSocket.init(nullptr) != ncclSuccess ||
+      ncclNetSocket.devices(&ndev) != ncclSuccess || ndev < 1) {
+    fprintf(stderr, "No socket interface found\n");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<BenchConn> conns(nConns);
+  for (auto& conn : conns) {
+    if (!connectPair(conn)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  printf(
+      "%d connections, %d bytes x %d iters each, NCCL_SOCKET_NTHREADS %ld NCCL_NSOCKS_PERTHREAD %ld\n",
+      nConns,
+      size,
+      iters,
+      NCCL_SOCKET_NTHREADS,
+      NCCL_NSOCKS_PERTHREAD);
+  printf("%8s %12s %12s %10s\n", "threads", "time(us)", "bw(GB/s)", "speedup");
+
+  bool ok = true;
+  double baseUs = 0;
+  for (int nThreads = 1; nThreads <= nConns && ok; nThreads *= 2) {
+    for (auto& conn : conns) {
+      resetSide(conn.send, size, true);
+      resetSide(conn.recv, size, false);
+    }
+
+    std::vector<char> threadOk(nThreads, 1);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+      threads.emplace_back([&, t]() {
+        bool active = true;
+        while (active && threadOk[t]) {
+          active = false;
+          for (int c = t; c < nConns; c += nThreads) {
+            auto& conn = conns[c];
+            if (!progressSide(true, conn.send, size, iters) ||
+                !progressSide(false, conn.recv, size, iters)) {
+              threadOk[t] = 0;
+              break;
+            }
+            active |= conn.send.completed < iters || conn.recv.completed < iters;
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    double us = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+    for (int t = 0; t < nThreads; t++) {
+      ok &= threadOk[t] != 0;
+    }
+    for (int c = 0; c < nConns && ok; c++) {
+      // Buffers hold the data of the last round of every slot
+      for (int slot = 0; slot < NCCL_NET_MAX_REQUESTS && slot < iters; slot++) {
+        if (conns[c].recv.bufs[slot] != conns[c].send.bufs[slot]) {
+          fprintf(stderr, "Data mismatch on connection %d slot %d\n", c, slot);
+          ok = false;
+          break;
+        }
+      }
+    }
+    if (nThreads == 1) {
+      baseUs = us;
+    }
+    printf(
+        "%8d %12.1f %12.2f %10.2f %s\n",
+        nThreads,
+        us,
+        static_cast<double>(size) * iters * nConns / us / 1e3,
+        baseUs / us,
+        ok ? "" : "FAILED");
+  }
+
+  for (auto& conn : conns) {
+    ncclNetSocket.closeSend(conn.send.comm);
+    ncclNetSocket.closeRecv(conn.recv.comm);
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,327 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// CPU-only benchmark of the proxy progress loop. It replays a stream of proxy
+// ops through ncclProxyAppendOp/ncclProxyProgressOps, the functions the
+// progress threads use, with a transport whose progress function only models
+// the step counters of the net transport: each call posts, transmits and
+// completes at most one slice of each sub, without any network or GPU
+// operation. This measures the cost of the proxy itself per op and per
+// progress call: appending, walking the active ops, and releasing them.
+//
+// The stream is either recorded from a real job with
+// NCCL_PROXY_OP_RECORD_FILE, or synthetic: alternating rounds of a ring
+// collective (one op per channel on its own connection) and of p2p to all
+// peers (ops of all peers of a channel grouped as subs of one op on shared
+// connections).
+//
+// Usage: ProxyReplayBench [iters] [recordFile]
+//        ProxyReplayBench [iters] - [nOpCounts] [nChannels] [nPeers] [nSteps]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "nccl_cvars.h"
+#include "proxy.h"
+#include "transport.h"
+
+static uint64_t nProgressCalls = 0;
+
+static ncclResult_t replayProgress(
+    struct ncclProxyState* proxyState,
+    struct ncclProxyArgs* args) {
+  nProgressCalls++;
+  if (args->state == ncclProxyOpReady) {
+    for (int s = 0; s < args->nsubs; s++) {
+      struct ncclProxySubArgs* sub = args->subs + s;
+      sub->base = 0;
+      sub->posted = sub->transmitted = sub->done = 0;
+    }
+    args->done = 0;
+    args->state = ncclProxyOpProgress;
+  }
+  args->idle = 1;
+  if (args->state != ncclProxyOpProgress) {
+    return ncclSuccess;
+  }
+  const int sliceSteps = args->sliceSteps > 0 ? args->sliceSteps : 1;
+  for (int s = 0; s < args->nsubs; s++) {
+    struct ncclProxySubArgs* sub = args->subs + s;
+    if (sub->done == sub->nsteps) {
+      continue;
+    }
+    if (sub->posted < sub->nsteps && sub->posted < sub->done + NCCL_STEPS) {
+      sub->requests[(sub->posted / sliceSteps) % NCCL_STEPS] = sub;
+      sub->posted += sliceSteps;
+      args->idle = 0;
+      continue;
+    }
+    if (sub->transmitted < sub->posted) {
+      sub->transmitted += sliceSteps;
+      args->idle = 0;
+      continue;
+    }
+    if (sub->done < sub->transmitted) {
+      sub->requests[(sub->done / sliceSteps) % NCCL_STEPS] = nullptr;
+      sub->done += sliceSteps;
+      if (sub->done >= sub->nsteps) {
+        sub->done = sub->nsteps;
+        args->done++;
+      }
+      args->idle = 0;
+    }
+  }
+  if (args->done == args->nsubs) {
+    args->state = ncclProxyOpNone;
+  }
+  return ncclSuccess;
+}
+
+struct ReplayStream {
+  struct ncclTransportComm tcomm;
+  // Connections of the stream by recorded address
+  std::map<std::string, std::unique_ptr<struct ncclProxyConnection>> conns;
+  // Append lists of shared connections, one per direction and channel
+  struct ncclProxyArgs* sharedAppend[2][MAXCHANNELS];
+  std::vector<struct ncclProxyOp> ops;
+  uint64_t maxOpCount{0};
+
+  ReplayStream() {
+    memset(&tcomm, 0, sizeof(tcomm));
+    tcomm.proxyProgress = replayProgress;
+    memset(sharedAppend, 0, sizeof(sharedAppend));
+  }
+
+  struct ncclProxyConnection*
+  connection(const std::string& name, int send, int shared, int channelId) {
+    auto& conn = conns[name];
+    if (!conn) {
+      conn.reset(new ncclProxyConnection());
+      conn->send = send;
+      conn->shared = shared;
+      conn->tcomm = &tcomm;
+      conn->proxyAppendPtr = shared
+          ? &sharedAppend[send ? 1 : 0][channelId % MAXCHANNELS]
+          : &conn->proxyAppend;
+    }
+    return conn.get();
+  }
+
+  void addOp(
+      struct ncclProxyConnection* conn,
+      int channelId,
+      int nsteps,
+      ssize_t nbytes,
+      uint64_t opCount,
+      int pattern,
+      int protocol,
+      int sliceSteps,
+      int chunkSteps,
+      int chunkSize,
+      int root) {
+    struct ncclProxyOp op{};
+    op.connection = conn;
+    op.channelId = channelId;
+    op.nsteps = nsteps;
+    op.nbytes = nbytes;
+    op.opCount = opCount;
+    op.pattern = pattern;
+    op.protocol = protocol;
+    op.sliceSteps = sliceSteps;
+    op.chunkSteps = chunkSteps;
+    op.chunkSize = chunkSize;
+    op.root = root;
+    op.next = -1;
+    ops.push_back(op);
+    maxOpCount = std::max(maxOpCount, opCount);
+  }
+
+  bool load(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f == nullptr) {
+      fprintf(stderr, "Failed to open %s\n", path);
+      return false;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+      if (line[0] == '#') {
+        continue;
+      }
+      char name[64];
+      int send, transport, shared, channelId, nsteps, pattern, protocol;
+      int sliceSteps, chunkSteps, chunkSize, root;
+      long nbytes;
+      unsigned long opCount;
+      if (sscanf(
+              line,
+              "%63s %d %d %d %d %d %ld %lu %d %d %d %d %d %d",
+              name,
+              &send,
+              &transport,
+              &shared,
+              &channelId,
+              &nsteps,
+              &nbytes,
+              &opCount,
+              &pattern,
+              &protocol,
+              &sliceSteps,
+              &chunkSteps,
+              &chunkSize,
+              &root) != 14) {
+        fprintf(stderr, "Invalid line in %s: %s", path, line);
+        fclose(f);
+        return false;
+      }
+      addOp(
+          connection(name, send, shared, channelId),
+          channelId,
+          nsteps,
+          nbytes,
+          opCount,
+          pattern,
+          protocol,
+          sliceSteps,
+          chunkSteps,
+          chunkSize,
+          root);
+    }
+    fclose(f);
+    return !ops.empty();
+  }
+
+  void synthesize(int nOpCounts, int nChannels, int nPeers, int nSteps) {
+    const int sliceSteps = NCCL_STEPS / 4, chunkSteps = NCCL_STEPS / 2;
+    for (int opCount = 0; opCount < nOpCounts; opCount++) {
+      bool coll = opCount % 2 == 0;
+      for (int c = 0; c < nChannels; c++) {
+        for (int send = 0; send < 2; send++) {
+          if (coll) {
+            std::string name = "coll" + std::to_string(send) + "." + std::to_string(c);
+            addOp(
+                connection(name, send, 0, c),
+                c,
+                nSteps,
+                1 << 17,
+                opCount,
+                ncclPatternRingTwice,
+                NCCL_PROTO_SIMPLE,
+                sliceSteps,
+                chunkSteps,
+                1 << 19,
+                0);
+            continue;
+          }
+          for (int p = 0; p < nPeers; p++) {
+            std::string name = "p2p" + std::to_string(send) + "." +
+                std::to_string(c) + "." + std::to_string(p);
+            addOp(
+                connection(name, send, 1, c),
+                c,
+                nSteps,
+                1 << 17,
+                opCount,
+                send ? ncclPatternSend : ncclPatternRecv,
+                NCCL_PROTO_SIMPLE,
+                1,
+                1,
+                1 << 19,
+                p);
+          }
+        }
+      }
+    }
+  }
+};
+
+int main(int argc, char** argv) {
+  int iters = argc > 1 ? atoi(argv[1]) : 20;
+  const char* path = argc > 2 ? argv[2] : "-";
+  setenv("NCCL_DEBUG", "WARN", 0);
+  ncclCvarInit();
+
+  ReplayStream stream;
+  if (strcmp(path, "-") != 0) {
+    if (!stream.load(path)) {
+      return EXIT_FAILURE;
+    }
+  } else {
+    stream.synthesize(
+        argc > 3 ? atoi(argv[3]) : 256,
+        argc > 4 ? atoi(argv[4]) : 8,
+        argc > 5 ? atoi(argv[5]) : 7,
+        argc > 6 ? atoi(argv[6]) : 8);
+  }
+
+  auto proxyState =
+      std::unique_ptr<struct ncclProxyState>(new ncclProxyState());
+  struct ncclProxyProgressState* state = &proxyState->progressState;
+
+  // Ops are appended in batches of NCCL_PROXY_APPEND_BATCH_SIZE opCounts
+  // between progress calls, as the progress thread does every
+  // NCCL_PROGRESS_APPENDOP_FREQ calls
+  uint64_t nLoops = 0, nOps = 0;
+  ncclResult_t res = ncclSuccess;
+  auto start = std::chrono::steady_clock::now();
+  for (int it = 0; it < iters && res == ncclSuccess; it++) {
+    uint64_t opCountBase = it * (stream.maxOpCount + 1);
+    size_t next = 0;
+    do {
+      int count = 0;
+      for (; next < stream.ops.size() && res == ncclSuccess; next++) {
+        struct ncclProxyOp op = stream.ops[next];
+        if (next > 0 && op.opCount != stream.ops[next - 1].opCount &&
+            ++count == NCCL_PROXY_APPEND_BATCH_SIZE) {
+          break;
+        }
+        op.opCount += opCountBase;
+        res = ncclProxyAppendOp(state, &op);
+        nOps++;
+      }
+      int idle = 1;
+      for (int i = 0; i < NCCL_PROGRESS_APPENDOP_FREQ && res == ncclSuccess &&
+           (state->active || next < stream.ops.size());
+           i++) {
+        res = ncclProxyProgressOps(proxyState.get(), state, &idle);
+        nLoops++;
+      }
+    } while (res == ncclSuccess &&
+             (state->active != nullptr || next < stream.ops.size()));
+  }
+  double ns = std::chrono::duration<double, std::nano>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+  ncclProxyFreeOps(state);
+  if (res != ncclSuccess) {
+    fprintf(stderr, "Replay failed: %d\n", res);
+    return EXIT_FAILURE;
+  }
+
+  printf(
+      "%zu ops in stream on %zu connections, %d iters, ncclProxyArgs %zu bytes, ncclProxySubArgs %zu bytes\n",
+      stream.ops.size(),
+      stream.conns.size(),
+      iters,
+      sizeof(struct ncclProxyArgs),
+      sizeof(struct ncclProxySubArgs));
+  printf(
+      "%12s %12s %14s %12s %14s\n",
+      "time(ms)",
+      "ns/op",
+      "progressOps",
+      "ns/loop",
+      "ns/progress");
+  printf(
+      "%12.2f %12.1f %14lu %12.1f %14.1f\n",
+      ns / 1e6,
+      ns / nOps,
+      nLoops,
+      ns / nLoops,
+      ns / nProgressCalls);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// Loopback benchmark of the proxy calls of connection setup. A proxy service
+// thread runs on a loopback socket, and the main thread sets up nConns
+// connectors the way the net transport does: a ncclProxyMsgInit call to create
+// the proxy connection, then a ncclProxyMsgSetup call returning a net handle.
+// The net transport is replaced by one whose proxySetup only fills the handle,
+// so only the RPCs are measured, no GPU or NIC is needed.
+//
+// Connectors are set up with blocking calls one at a time, as reference, and
+// with the deferred calls pipelined NCCL_PROXY_RPC_BATCH_SIZE at a time, e.g.
+//   NCCL_PROXY_RPC_BATCH_SIZE=32 ProxyRpcBench 4096
+//
+// Usage: ProxyRpcBench [nConns] [iters]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <vector>
+#include "comm.h"
+#include "nccl_cvars.h"
+#include "proxy.h"
+#include "socket.h"
+#include "transport.h"
+
+static ncclResult_t benchProxySetup(
+    struct ncclProxyConnection* connection,
+    struct ncclProxyState* proxyState,
+    void* reqBuff,
+    int reqSize,
+    void* respBuff,
+    int respSize,
+    int* done) {
+  if (reqSize != sizeof(int) || respSize != NCCL_NET_HANDLE_MAXSIZE) {
+    return ncclInternalError;
+  }
+  memset(respBuff, 0, respSize);
+  memcpy(respBuff, reqBuff, sizeof(int));
+  *done = 1;
+  return ncclSuccess;
+}
+
+static struct ncclTransport benchTransport = {
+    "BENCH",
+    NULL,
+    {NULL, NULL, NULL, NULL, benchProxySetup, NULL, NULL, NULL},
+    {NULL, NULL, NULL, NULL, benchProxySetup, NULL, NULL, NULL}};
+
+struct BenchConnector {
+  struct ncclProxyConnector proxyConn;
+  char handle[NCCL_NET_HANDLE_MAXSIZE];
+};
+
+static ncclResult_t setupConnectors(
+    struct ncclComm* comm,
+    std::vector<BenchConnector>& conns,
+    bool pipelined) {
+  for (int i = 0; i < (int)conns.size(); i++) {
+    auto& conn = conns[i];
+    int send = i % 2;
+    memset(conn.handle, 0xff, sizeof(conn.handle));
+    if (pipelined) {
+      NCCLCHECK(ncclProxyConnectDeferred(
+          comm, TRANSPORT_NET, send, 0, &conn.proxyConn));
+      NCCLCHECK(ncclProxyCallDeferred(
+          comm,
+          &conn.proxyConn,
+          ncclProxyMsgSetup,
+          &i,
+          sizeof(int),
+          conn.handle,
+          sizeof(conn.handle)));
+    } else {
+      NCCLCHECK(ncclProxyConnect(comm, TRANSPORT_NET, send, 0, &conn.proxyConn));
+      NCCLCHECK(ncclProxyCallBlocking(
+          comm,
+          &conn.proxyConn,
+          ncclProxyMsgSetup,
+          &i,
+          sizeof(int),
+          conn.handle,
+          sizeof(conn.handle)));
+    }
+  }
+  if (pipelined) {
+    NCCLCHECK(ncclProxyDeferredWait(comm));
+  }
+  return ncclSuccess;
+}
+
+static bool checkConnectors(std::vector<BenchConnector>& conns) {
+  for (int i = 0; i < (int)conns.size(); i++) {
+    int id;
+    memcpy(&id, conns[i].handle, sizeof(int));
+    if (conns[i].proxyConn.connection == nullptr || id != i) {
+      fprintf(stderr, "Connector %d: wrong connection or handle %d\n", i, id);
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  int nConns = argc > 1 ? atoi(argv[1]) : 4096;
+  int iters = argc > 2 ? atoi(argv[2]) : 5;
+  if (nConns < 1 || iters < 1) {
+    fprintf(stderr, "Usage: %s [nConns] [iters]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  setenv("NCCL_DEBUG", "WARN", 0);
+  ncclCvarInit();
+  ncclTransports[TRANSPORT_NET] = &benchTransport;
+
+  // A communicator of one rank, with only what proxy calls use
+  static volatile uint32_t abortFlag = 0;
+  static int zero = 0;
+  const uint64_t magic = 0x5250434245ULL;
+  struct ncclComm* comm;
+  struct ncclSharedResources* sharedRes;
+  struct ncclPeerInfo* peerInfo;
+  NCCLCHECK(ncclCalloc(&comm, 1));
+  NCCLCHECK(ncclCalloc(&sharedRes, 1));
+  NCCLCHECK(ncclCalloc(&peerInfo, 1));
+  comm->sharedRes = sharedRes;
+  comm->peerInfo = peerInfo;
+  comm->abortFlag = &abortFlag;
+  comm->localRanks = 1;
+  comm->localRankToRank = comm->topParentRanks = comm->topParentLocalRanks = &zero;
+  sharedRes->tpNLocalRanks = 1;
+  sharedRes->tpRankToLocalRank = &zero;
+  sharedRes->magic = magic;
+
+  union ncclSocketAddress* peerAddresses;
+  struct ncclSocket* listenSock;
+  NCCLCHECK(ncclCalloc(&peerAddresses, 1));
+  NCCLCHECK(ncclCalloc(&listenSock, 1));
+  NCCLCHECK(ncclSocketGetAddrFromString(peerAddresses, "127.0.0.1:0"));
+  NCCLCHECK(ncclSocketInit(listenSock, peerAddresses, magic, ncclSocketTypeProxy, &abortFlag));
+  NCCLCHECK(ncclSocketListen(listenSock));
+  NCCLCHECK(ncclSocketGetAddr(listenSock, peerAddresses));
+  NCCLCHECK(ncclProxyInit(comm, listenSock, peerAddresses));
+  comm->proxyState->abortFlag = &abortFlag;
+  pthread_t service;
+  pthread_create(&service, NULL, ncclProxyService, comm->proxyState);
+
+  printf(
+      "%d connectors, NCCL_PROXY_RPC_BATCH_SIZE %ld\n",
+      nConns,
+      NCCL_PROXY_RPC_BATCH_SIZE);
+  printf("%-10s %12s %12s %10s\n", "calls", "time(ms)", "us/conn", "speedup");
+  bool ok = true;
+  double blockingUs = 0;
+  for (int pipelined = 0; pipelined < 2 && ok; pipelined++) {
+    double bestUs = 0;
+    for (int it = 0; it < iters && ok; it++) {
+      std::vector<BenchConnector> conns(nConns);
+      auto start = std::chrono::steady_clock::now();
+      ok = setupConnectors(comm, conns, pipelined) == ncclSuccess;
+      double us = std::chrono::duration<double, std::micro>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+      ok = ok && checkConnectors(conns);
+      if (it == 0 || us < bestUs) {
+        bestUs = us;
+      }
+    }
+    if (!pipelined) {
+      blockingUs = bestUs;
+    }
+    printf(
+        "%-10s %12.2f %12.2f %10.2f %s\n",
+        pipelined ? "pipelined" : "blocking",
+        bestUs / 1e3,
+        bestUs / nConns,
+        blockingUs / bestUs,
+        ok ? "" : "FAILED");
+  }
+
+  // Close the connection to the proxy and stop it, like ncclProxyStop
+  struct ncclProxyState* proxyState = comm->proxyState;
+  int type = ncclProxyMsgClose;
+  NCCLCHECK(ncclSocketSend(proxyState->peerSocks, &type, sizeof(int)));
+  NCCLCHECK(ncclSocketClose(proxyState->peerSocks));
+  struct ncclSocket sock;
+  type = ncclProxyMsgStop;
+  NCCLCHECK(ncclSocketInit(&sock, peerAddresses, magic, ncclSocketTypeProxy, &abortFlag));
+  NCCLCHECK(ncclSocketConnect(&sock));
+  NCCLCHECK(ncclSocketSend(&sock, &type, sizeof(int)));
+  NCCLCHECK(ncclSocketClose(&sock));
+  pthread_join(service, NULL);
+
+  proxyState->refCount = 0;
+  NCCLCHECK(ncclProxyDestroy(comm));
+  free(peerInfo);
+  free(sharedRes);
+  free(comm);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
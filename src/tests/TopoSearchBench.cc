@@ -0,0 +1,245 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// CPU-only harness comparing the sequential and parallel topology searches.
+// Every topology is loaded from an XML topology file, as with NCCL_TOPO_FILE,
+// and the ring and tree graphs are computed with NCCL_TOPO_SEARCH_THREADS=1
+// and with the given number of threads. The search cache is disabled. The
+// parallel search is run twice to check that it always returns the same graph.
+//
+// Without topology files, synthetic ones are generated:
+//  - nvswitch: 8 sm90 GPUs with NVLinks to 4 NVSwitches, 8 NICs
+//  - cubemesh: 8 sm70 GPUs in an NVLink hybrid cube-mesh, 4 NICs
+//  - pcie: 8 sm80 GPUs without NVLink behind PCI switches on 2 CPUs, 4 NICs
+//
+// Usage: TopoSearchBench [threads] [topo.xml ...]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "graph.h"
+#include "nccl_cvars.h"
+#include "topo.h"
+#include "xml.h"
+
+struct SynthTopo {
+  const char* name;
+  int sm;
+  int nvswitches;
+  // GPU pairs connected with NVLinks, as {gpu, gpu, count}
+  std::vector<std::vector<int>> nvlinks;
+};
+
+static void writeTopo(FILE* f, const SynthTopo& topo) {
+  auto gpuBus = [](int g) { return 0x10 + (g / 2) * 0x20 + 1 + g % 2; };
+  fprintf(f, "<system version=\"1\">\n");
+  for (int cpu = 0; cpu < 2; cpu++) {
+    fprintf(
+        f,
+        "  <cpu numaid=\"%d\" affinity=\"%s\" arch=\"x86_64\" vendor=\"GenuineIntel\" familyid=\"6\" modelid=\"85\">\n",
+        cpu,
+        cpu == 0 ? "0000ffff" : "ffff0000");
+    for (int sw = cpu * 2; sw < cpu * 2 + 2; sw++) {
+      int bus = 0x10 + sw * 0x20;
+      fprintf(
+          f,
+          "    <pci busid=\"0000:%02x:00.0\" class=\"0x060400\" vendor=\"0x1000\" device=\"0xc030\" subsystem_vendor=\"0x1000\" subsystem_device=\"0x100b\" link_speed=\"16.0 GT/s PCIe\" link_width=\"16\">\n",
+          bus);
+      for (int g = sw * 2; g < sw * 2 + 2; g++) {
+        fprintf(
+            f,
+            "      <pci busid=\"0000:%02x:00.0\" class=\"0x030200\" vendor=\"0x10de\" device=\"0x20b0\" subsystem_vendor=\"0x10de\" subsystem_device=\"0x134f\" link_speed=\"16.0 GT/s PCIe\" link_width=\"16\">\n",
+            gpuBus(g));
+        fprintf(
+            f,
+            "        <gpu dev=\"%d\" sm=\"%d\" rank=\"%d\" gdr=\"1\">\n",
+            g,
+            topo.sm,
+            g);
+        for (int s = 0; s < topo.nvswitches; s++) {
+          fprintf(
+              f,
+              "          <nvlink target=\"0000:%02x:00.0\" count=\"%d\" tclass=\"0x068000\"/>\n",
+              0xe0 + s,
+              18 / topo.nvswitches);
+        }
+        for (auto& link : topo.nvlinks) {
+          if (link[0] != g && link[1] != g) {
+            continue;
+          }
+          fprintf(
+              f,
+              "          <nvlink target=\"0000:%02x:00.0\" count=\"%d\" tclass=\"0x030200\"/>\n",
+              gpuBus(link[0] == g ? link[1] : link[0]),
+              link[2]);
+        }
+        fprintf(f, "        </gpu>\n      </pci>\n");
+      }
+      int nics = topo.nvswitches ? 2 : 1;
+      for (int n = 0; n < nics; n++) {
+        int dev = sw * nics + n;
+        fprintf(
+            f,
+            "      <pci busid=\"0000:%02x:00.%d\" class=\"0x020000\" vendor=\"0x15b3\" device=\"0x101b\" subsystem_vendor=\"0x15b3\" subsystem_device=\"0x0007\" link_speed=\"16.0 GT/s PCIe\" link_width=\"16\">\n",
+            bus + 3,
+            n);
+        fprintf(
+            f,
+            "        <nic>\n          <net name=\"mlx5_%d\" dev=\"%d\" speed=\"200000\" port=\"1\" latency=\"0.000000\" guid=\"0x%xa0b0c0d0e0f\" maxconn=\"131072\" gdr=\"1\"/>\n        </nic>\n      </pci>\n",
+            dev,
+            dev,
+            dev);
+      }
+      fprintf(f, "    </pci>\n");
+    }
+    fprintf(f, "  </cpu>\n");
+  }
+  fprintf(f, "</system>\n");
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static ncclResult_t
+compute(struct ncclTopoSystem* system, int pattern, struct ncclTopoGraph* graph) {
+  memset(graph, 0, sizeof(struct ncclTopoGraph));
+  graph->id = pattern == NCCL_TOPO_PATTERN_RING ? 0 : 1;
+  graph->pattern = pattern;
+  graph->minChannels = 1;
+  graph->maxChannels = MAXCHANNELS / 2;
+  return ncclTopoCompute(system, graph);
+}
+
+static bool sameGraph(
+    struct ncclTopoSystem* system,
+    struct ncclTopoGraph* a,
+    struct ncclTopoGraph* b) {
+  int ngpus = system->nodes[GPU].count;
+  return a->pattern == b->pattern && a->nChannels == b->nChannels &&
+      a->bwIntra == b->bwIntra && a->bwInter == b->bwInter &&
+      a->typeIntra == b->typeIntra && a->typeInter == b->typeInter &&
+      memcmp(a->intra, b->intra, a->nChannels * ngpus * sizeof(int)) == 0 &&
+      memcmp(a->inter, b->inter, a->nChannels * 2 * sizeof(int)) == 0;
+}
+
+static bool runTopo(const char* name, const char* path, int nThreads) {
+  auto xml = static_cast<struct ncclXml*>(calloc(1, sizeof(struct ncclXml)));
+  struct ncclTopoSystem* system = nullptr;
+  if (ncclTopoGetXmlFromFile(path, xml, 1) != ncclSuccess ||
+      ncclTopoGetSystemFromXml(xml, &system) != ncclSuccess ||
+      ncclTopoComputePaths(system, nullptr) != ncclSuccess ||
+      ncclTopoSearchInit(system) != ncclSuccess) {
+    fprintf(stderr, "Could not load topology %s\n", path);
+    free(xml);
+    return false;
+  }
+  free(xml);
+
+  bool ok = true;
+  for (int pattern :
+       {NCCL_TOPO_PATTERN_RING, NCCL_TOPO_PATTERN_BALANCED_TREE}) {
+    struct ncclTopoGraph graphs[3];
+    double us[3];
+    const int threads[3] = {1, nThreads, nThreads};
+    for (int i = 0; i < 3; i++) {
+      setenv("NCCL_TOPO_SEARCH_THREADS", std::to_string(threads[i]).c_str(), 1);
+      ncclCvarInit();
+      auto start = std::chrono::steady_clock::now();
+      if (compute(system, pattern, graphs + i) != ncclSuccess) {
+        fprintf(stderr, "Search failed on %s\n", name);
+        return false;
+      }
+      us[i] = elapsedUs(start);
+    }
+    bool deterministic = sameGraph(system, graphs + 1, graphs + 2);
+    ok &= deterministic;
+    for (int i = 0; i < 2; i++) {
+      printf(
+          "%10s %8s %8d %9d %9.1f %9.1f %9.1f %12.1f %s\n",
+          name,
+          pattern == NCCL_TOPO_PATTERN_RING ? "ring" : "tree",
+          threads[i],
+          graphs[i].nChannels,
+          graphs[i].bwIntra,
+          graphs[i].bwInter,
+          graphs[i].nChannels * graphs[i].bwIntra,
+          us[i] / 1e3,
+          i == 1 && !deterministic ? "NONDETERMINISTIC" : "");
+    }
+  }
+  free(system);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  int nThreads = argc > 1 ? atoi(argv[1]) : 4;
+
+  setenv("NCCL_DEBUG", "WARN", 0);
+  setenv("NCCL_TOPO_SEARCH_CACHE", "0", 1);
+  // Don't check P2P support with NVML for GPUs that don't exist
+  setenv("NCCL_IGNORE_DISABLED_P2P", "2", 0);
+  ncclCvarInit();
+
+  printf(
+      "%10s %8s %8s %9s %9s %9s %9s %12s\n",
+      "topo",
+      "pattern",
+      "threads",
+      "channels",
+      "bwIntra",
+      "bwInter",
+      "total",
+      "search(ms)");
+
+  bool ok = true;
+  if (argc > 2) {
+    for (int i = 2; i < argc; i++) {
+      ok &= runTopo(argv[i], argv[i], nThreads);
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  const SynthTopo topos[] = {
+      {"nvswitch", 90, 4, {}},
+      {"cubemesh",
+       70,
+       0,
+       {{0, 1, 1},
+        {0, 2, 1},
+        {0, 3, 2},
+        {0, 4, 2},
+        {1, 2, 2},
+        {1, 3, 1},
+        {1, 5, 2},
+        {2, 3, 1},
+        {2, 6, 1},
+        {3, 7, 1},
+        {4, 5, 1},
+        {4, 6, 1},
+        {4, 7, 2},
+        {5, 6, 2},
+        {5, 7, 1},
+        {6, 7, 1}}},
+      {"pcie", 80, 0, {}},
+  };
+  for (auto& topo : topos) {
+    std::string path = "/tmp/nccl_topo_search_bench_" + std::string(topo.name) +
+        "_" + std::to_string(getpid()) + ".xml";
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == nullptr) {
+      perror("fopen");
+      return EXIT_FAILURE;
+    }
+    writeTopo(f, topo);
+    fclose(f);
+    ok &= runTopo(topo.name, path.c_str(), nThreads);
+    unlink(path.c_str());
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
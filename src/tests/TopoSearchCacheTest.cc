@@ -0,0 +1,193 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#include <glob.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "graph.h"
+#include "nccl_cvars.h"
+#include "topo.h"
+#include "xml.h"
+
+// These tests run the topology search on a synthetic system loaded from an
+// XML topology file, so no GPU is needed.
+class TopoSearchCacheTest : public ::testing::Test {
+ public:
+  TopoSearchCacheTest() = default;
+
+  void SetUp() override {
+    setenv("NCCL_DEBUG", "WARN", 0);
+    // Don't check P2P support with NVML for GPUs that don't exist
+    setenv("NCCL_IGNORE_DISABLED_P2P", "2", 1);
+    char dir[] = "/tmp/nccl_topo_search_cache_XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    cacheDir = dir;
+    setenv("NCCL_TOPO_SEARCH_CACHE_DIR", cacheDir.c_str(), 1);
+    ncclCvarInit();
+
+    std::string topoFile = cacheDir + "/topo.xml";
+    FILE* f = fopen(topoFile.c_str(), "w");
+    ASSERT_NE(f, nullptr);
+    writeTopo(f);
+    fclose(f);
+
+    auto xml = static_cast<struct ncclXml*>(calloc(1, sizeof(struct ncclXml)));
+    ASSERT_EQ(ncclTopoGetXmlFromFile(topoFile.c_str(), xml, 1), ncclSuccess);
+    ASSERT_EQ(ncclTopoGetSystemFromXml(xml, &system), ncclSuccess);
+    free(xml);
+    unlink(topoFile.c_str());
+    ASSERT_EQ(ncclTopoComputePaths(system, nullptr), ncclSuccess);
+    ASSERT_EQ(ncclTopoSearchInit(system), ncclSuccess);
+  }
+
+  void TearDown() override {
+    ncclTopoFree(system);
+    std::string cmd = "rm -rf " + cacheDir;
+    EXPECT_EQ(::system(cmd.c_str()), 0);
+    unsetenv("NCCL_IGNORE_DISABLED_P2P");
+    unsetenv("NCCL_TOPO_SEARCH_CACHE");
+    unsetenv("NCCL_TOPO_SEARCH_CACHE_DIR");
+    unsetenv("NCCL_GRAPH_FILE");
+    ncclCvarInit();
+  }
+
+  // 4 GPUs and 2 NICs behind 2 PCI switches, with NVLinks to 2 NVSwitches
+  static void writeTopo(FILE* f) {
+    fprintf(f, "<system version=\"1\">\n");
+    fprintf(
+        f,
+        "  <cpu numaid=\"0\" affinity=\"ffffffff\" arch=\"x86_64\" vendor=\"GenuineIntel\" familyid=\"6\" modelid=\"143\">\n");
+    for (int sw = 0; sw < 2; sw++) {
+      int bus = 0x10 + sw * 0x40;
+      fprintf(
+          f,
+          "    <pci busid=\"0000:%02x:00.0\" class=\"0x060400\" vendor=\"0x1000\" device=\"0xc030\" subsystem_vendor=\"0x1000\" subsystem_device=\"0x100b\" link_speed=\"32.0 GT/s PCIe\" link_width=\"16\">\n",
+          bus);
+      for (int g = 0; g < 2; g++) {
+        int gpu = sw * 2 + g;
+        fprintf(
+            f,
+            "      <pci busid=\"0000:%02x:00.0\" class=\"0x030200\" vendor=\"0x10de\" device=\"0x2330\" subsystem_vendor=\"0x10de\" subsystem_device=\"0x16c1\" link_speed=\"32.0 GT/s PCIe\" link_width=\"16\">\n",
+            bus + 1 + g);
+        fprintf(
+            f,
+            "        <gpu dev=\"%d\" sm=\"90\" rank=\"%d\" gdr=\"1\">\n",
+            gpu,
+            gpu);
+        for (int l = 0; l < 2; l++) {
+          fprintf(
+              f,
+              "          <nvlink target=\"0000:%02x:00.0\" count=\"9\" tclass=\"0x068000\"/>\n",
+              0xe0 + l);
+        }
+        fprintf(f, "        </gpu>\n      </pci>\n");
+      }
+      fprintf(
+          f,
+          "      <pci busid=\"0000:%02x:00.0\" class=\"0x020000\" vendor=\"0x15b3\" device=\"0x1021\" subsystem_vendor=\"0x15b3\" subsystem_device=\"0x0023\" link_speed=\"32.0 GT/s PCIe\" link_width=\"16\">\n",
+          bus + 3);
+      fprintf(
+          f,
+          "        <nic>\n          <net name=\"mlx5_%d\" dev=\"%d\" speed=\"400000\" port=\"1\" latency=\"0.000000\" guid=\"0x%xa0b0c0d0e0f\" maxconn=\"131072\" gdr=\"1\"/>\n        </nic>\n",
+          sw,
+          sw,
+          sw);
+      fprintf(f, "      </pci>\n    </pci>\n");
+    }
+    fprintf(f, "  </cpu>\n</system>\n");
+  }
+
+  ncclResult_t compute(struct ncclTopoGraph* graph, int id, int pattern) {
+    memset(graph, 0, sizeof(struct ncclTopoGraph));
+    graph->id = id;
+    graph->pattern = pattern;
+    graph->minChannels = 1;
+    graph->maxChannels = MAXCHANNELS / 2;
+    return ncclTopoCompute(system, graph);
+  }
+
+  ncclResult_t computeUncached(struct ncclTopoGraph* graph, int id, int pattern) {
+    setenv("NCCL_TOPO_SEARCH_CACHE", "0", 1);
+    ncclCvarInit();
+    ncclResult_t res = compute(graph, id, pattern);
+    unsetenv("NCCL_TOPO_SEARCH_CACHE");
+    ncclCvarInit();
+    return res;
+  }
+
+  void expectSameGraph(struct ncclTopoGraph* a, struct ncclTopoGraph* b) {
+    int ngpus = system->nodes[GPU].count;
+    EXPECT_EQ(a->pattern, b->pattern);
+    EXPECT_EQ(a->crossNic, b->crossNic);
+    EXPECT_EQ(a->nChannels, b->nChannels);
+    EXPECT_EQ(a->bwIntra, b->bwIntra);
+    EXPECT_EQ(a->bwInter, b->bwInter);
+    EXPECT_EQ(a->typeIntra, b->typeIntra);
+    EXPECT_EQ(a->typeInter, b->typeInter);
+    EXPECT_EQ(a->sameChannels, b->sameChannels);
+    for (int i = 0; i < a->nChannels * ngpus; i++) {
+      EXPECT_EQ(a->intra[i], b->intra[i]) << "intra " << i;
+    }
+    for (int i = 0; i < a->nChannels * 2; i++) {
+      EXPECT_EQ(a->inter[i], b->inter[i]) << "inter " << i;
+    }
+  }
+
+ protected:
+  struct ncclTopoSystem* system{nullptr};
+  std::string cacheDir;
+};
+
+// The cache is shared by the whole process and freed with the last system
+// using it. Every test uses its own graph ids anyway, so that it starts from
+// an empty cache.
+
+TEST_F(TopoSearchCacheTest, CachedGraphsMatchSearch) {
+  const int patterns[] = {
+      NCCL_TOPO_PATTERN_RING,
+      NCCL_TOPO_PATTERN_BALANCED_TREE,
+      NCCL_TOPO_PATTERN_SPLIT_TREE};
+  for (int p = 0; p < 3; p++) {
+    int id = 100 + p;
+    struct ncclTopoGraph ref, first, cached;
+    ASSERT_EQ(computeUncached(&ref, id, patterns[p]), ncclSuccess);
+    ASSERT_EQ(compute(&first, id, patterns[p]), ncclSuccess);
+    ASSERT_EQ(compute(&cached, id, patterns[p]), ncclSuccess);
+    EXPECT_GT(ref.nChannels, 0);
+    expectSameGraph(&first, &ref);
+    expectSameGraph(&cached, &ref);
+  }
+}
+
+TEST_F(TopoSearchCacheTest, RanksRemapped) {
+  // Same system with other ranks, as seen by a communicator from
+  // ncclCommSplit
+  struct ncclTopoGraph graph, ref;
+  ASSERT_EQ(compute(&graph, 200, NCCL_TOPO_PATTERN_RING), ncclSuccess);
+  int ngpus = system->nodes[GPU].count;
+  for (int g = 0; g < ngpus; g++) {
+    system->nodes[GPU].nodes[g].gpu.rank = 10 + ngpus - 1 - g;
+  }
+  ASSERT_EQ(compute(&graph, 200, NCCL_TOPO_PATTERN_RING), ncclSuccess);
+  ASSERT_EQ(computeUncached(&ref, 200, NCCL_TOPO_PATTERN_RING), ncclSuccess);
+  expectSameGraph(&graph, &ref);
+}
+
+TEST_F(TopoSearchCacheTest, SavedGraphLoadsAsGraphFile) {
+  struct ncclTopoGraph graph, ref;
+  ASSERT_EQ(compute(&ref, 300, NCCL_TOPO_PATTERN_RING), ncclSuccess);
+
+  // One file is saved per graph, which can also be used as NCCL_GRAPH_FILE
+  glob_t files;
+  ASSERT_EQ(
+      glob((cacheDir + "/nccl_topo_graph_*.xml").c_str(), 0, nullptr, &files),
+      0);
+  ASSERT_EQ(files.gl_pathc, 1);
+  setenv("NCCL_GRAPH_FILE", files.gl_pathv[0], 1);
+  globfree(&files);
+  ncclCvarInit();
+  ASSERT_EQ(compute(&graph, 300, NCCL_TOPO_PATTERN_RING), ncclSuccess);
+  expectSameGraph(&graph, &ref);
+}
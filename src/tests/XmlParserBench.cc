@@ -0,0 +1,344 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+// Microbenchmark of the topology and graph XML parsers used for NCCL_TOPO_FILE
+// and NCCL_GRAPH_FILE. It generates synthetic files, parses them with
+// ncclTopoGetXmlFromFile/ncclTopoGetXmlGraphFromFile and with the previous
+// parser, which read the file one character at a time through stdio, checks
+// both produce the same nodes and reports the parse time of each.
+//
+// Inputs:
+//  - topo: an 8-GPU/16-NIC system with two CPUs, two levels of PCI switches
+//    and NVLinks to four NVSwitches
+//  - graph: the graphs of a 64-node job, 3 patterns of 30 channels each going
+//    through 8 GPUs and 2 NICs, close to the MAX_NODES limit of the parser
+//
+// Usage: XmlParserBench [iters] [dir]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include "xml.h"
+
+/* Reference implementation of the previous parser */
+
+static ncclResult_t legacyGetChar(FILE* file, char* c) {
+  if (fread(c, 1, 1, file) == 0) {
+    return ncclInternalError;
+  }
+  return ncclSuccess;
+}
+
+static ncclResult_t legacyGetValue(FILE* file, char* value, char* last) {
+  char c;
+  NCCLCHECK(legacyGetChar(file, &c));
+  if (c != '"' && c != '\'') {
+    return ncclInternalError;
+  }
+  int o = 0;
+  do {
+    NCCLCHECK(legacyGetChar(file, &c));
+    value[o++] = c;
+  } while (c != '"');
+  value[o - 1] = '\0';
+  NCCLCHECK(legacyGetChar(file, last));
+  return ncclSuccess;
+}
+
+static ncclResult_t
+legacyGetToken(FILE* file, char* name, char* value, char* last) {
+  char c;
+  int o = 0;
+  do {
+    NCCLCHECK(legacyGetChar(file, &c));
+    if (c == '=') {
+      name[o] = '\0';
+      if (value == nullptr) {
+        return ncclInternalError;
+      }
+      return legacyGetValue(file, value, last);
+    }
+    name[o] = c;
+    if (o == MAX_STR_LEN - 1) {
+      return ncclInternalError;
+    }
+    o++;
+  } while (c != ' ' && c != '>' && c != '/' && c != '\n' && c != '\r');
+  name[o - 1] = '\0';
+  *last = c;
+  return ncclSuccess;
+}
+
+static ncclResult_t legacyGetNode(FILE* file, struct ncclXmlNode* node) {
+  node->type = NODE_TYPE_NONE;
+  char c = ' ';
+  while (c == ' ' || c == '\n' || c == '\r') {
+    if (fread(&c, 1, 1, file) == 0) {
+      return ncclSuccess;
+    }
+  }
+  if (c != '<') {
+    return ncclInternalError;
+  }
+  NCCLCHECK(legacyGetToken(file, node->name, nullptr, &c));
+  if (node->name[0] == '\0' && c == '/') {
+    node->type = NODE_TYPE_CLOSE;
+    NCCLCHECK(legacyGetToken(file, node->name, nullptr, &c));
+    return c == '>' ? ncclSuccess : ncclInternalError;
+  }
+  node->type = NODE_TYPE_OPEN;
+  int a = 0;
+  while (c == ' ') {
+    NCCLCHECK(legacyGetToken(
+        file, node->attrs[a].key, node->attrs[a].value, &c));
+    if (a < MAX_ATTR_COUNT) {
+      a++;
+    }
+  }
+  node->nAttrs = a;
+  if (c == '/') {
+    node->type = NODE_TYPE_SINGLE;
+    char str[MAX_STR_LEN];
+    NCCLCHECK(legacyGetToken(file, str, nullptr, &c));
+  }
+  return c == '>' ? ncclSuccess : ncclInternalError;
+}
+
+// All elements of the synthetic files are known to the real parser, so
+// keeping every element gives the same nodes
+static ncclResult_t
+legacyLoadSub(FILE* file, struct ncclXml* xml, struct ncclXmlNode* head) {
+  if (head && head->type == NODE_TYPE_SINGLE) {
+    return ncclSuccess;
+  }
+  while (1) {
+    if (xml->maxIndex == MAX_NODES) {
+      return ncclInternalError;
+    }
+    struct ncclXmlNode* node = xml->nodes + xml->maxIndex;
+    memset(node, 0, sizeof(struct ncclXmlNode));
+    NCCLCHECK(legacyGetNode(file, node));
+    if (node->type == NODE_TYPE_NONE) {
+      return head ? ncclInternalError : ncclSuccess;
+    }
+    if (head && node->type == NODE_TYPE_CLOSE) {
+      return strcmp(node->name, head->name) == 0 ? ncclSuccess
+                                                 : ncclInternalError;
+    }
+    if (head) {
+      head->subs[head->nSubs++] = node;
+    }
+    node->parent = head;
+    xml->maxIndex++;
+    NCCLCHECK(legacyLoadSub(file, xml, node));
+  }
+}
+
+static ncclResult_t legacyLoad(const char* path, struct ncclXml* xml) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) {
+    return ncclSystemError;
+  }
+  xml->maxIndex = 0;
+  ncclResult_t res = legacyLoadSub(file, xml, nullptr);
+  fclose(file);
+  return res;
+}
+
+/* Synthetic inputs */
+
+static void writeTopo(FILE* f) {
+  fprintf(f, "<system version=\"1\">\n");
+  int gpu = 0, nic = 0;
+  for (int cpu = 0; cpu < 2; cpu++) {
+    fprintf(
+        f,
+        "  <cpu numaid=\"%d\" affinity=\"%s\" arch=\"x86_64\" vendor=\"GenuineIntel\" familyid=\"6\" modelid=\"143\">\n",
+        cpu,
+        cpu == 0 ? "00000000,00000000,0000ffff,ffffffff,ffffffff,ffffffff"
+                 : "ffffffff,ffffffff,ffff0000,00000000,00000000,00000000");
+    for (int sw = 0; sw < 2; sw++) {
+      int bus = 0x10 + cpu * 0x80 + sw * 0x40;
+      fprintf(
+          f,
+          "    <pci busid=\"0000:%02x:00.0\" class=\"0x060400\" vendor=\"0x1000\" device=\"0xc030\" subsystem_vendor=\"0x1000\" subsystem_device=\"0x100b\" link_speed=\"32.0 GT/s PCIe\" link_width=\"16\">\n",
+          bus);
+      for (int sub = 0; sub < 2; sub++) {
+        int subBus = bus + 1 + sub * 0x10;
+        fprintf(
+            f,
+            "      <pci busid=\"0000:%02x:00.0\" class=\"0x060400\" vendor=\"0x1000\" device=\"0xc030\" subsystem_vendor=\"0x1000\" subsystem_device=\"0x100b\" link_speed=\"32.0 GT/s PCIe\" link_width=\"16\">\n",
+            subBus);
+        fprintf(
+            f,
+            "        <pci busid=\"0000:%02x:00.0\" class=\"0x030200\" vendor=\"0x10de\" device=\"0x2330\" subsystem_vendor=\"0x10de\" subsystem_device=\"0x16c1\" link_speed=\"32.0 GT/s PCIe\" link_width=\"16\">\n",
+            subBus + 1);
+        fprintf(
+            f,
+            "          <gpu dev=\"%d\" sm=\"90\" rank=\"%d\" gdr=\"1\">\n",
+            gpu,
+            gpu);
+        for (int l = 0; l < 4; l++) {
+          fprintf(
+              f,
+              "            <nvlink target=\"0000:%02x:00.0\" count=\"%d\" tclass=\"0x068000\"/>\n",
+              0xe0 + l,
+              l < 2 ? 5 : 4);
+        }
+        fprintf(f, "          </gpu>\n        </pci>\n");
+        gpu++;
+        for (int n = 0; n < 2; n++) {
+          fprintf(
+              f,
+              "        <pci busid=\"0000:%02x:00.%d\" class=\"0x020000\" vendor=\"0x15b3\" device=\"0x1021\" subsystem_vendor=\"0x15b3\" subsystem_device=\"0x0023\" link_speed=\"32.0 GT/s PCIe\" link_width=\"16\">\n",
+              subBus + 2,
+              n);
+          fprintf(f, "          <nic>\n");
+          fprintf(
+              f,
+              "            <net name=\"mlx5_%d\" dev=\"%d\" speed=\"400000\" port=\"1\" latency=\"0.000000\" guid=\"0x%xa0b0c0d0e0f\" maxconn=\"131072\" gdr=\"1\" coll=\"1\"/>\n",
+              nic,
+              nic,
+              nic);
+          fprintf(f, "          </nic>\n        </pci>\n");
+          nic++;
+        }
+        fprintf(f, "      </pci>\n");
+      }
+      fprintf(f, "    </pci>\n");
+    }
+    fprintf(f, "  </cpu>\n");
+  }
+  fprintf(f, "</system>\n");
+}
+
+static void writeGraph(FILE* f) {
+  fprintf(f, "<graphs version=\"1\">\n");
+  for (int g = 0; g < 3; g++) {
+    fprintf(
+        f,
+        "  <graph id=\"%d\" pattern=\"%d\" crossnic=\"0\" nchannels=\"30\" speedintra=\"40\" speedinter=\"40\" latencyinter=\"0\" typeintra=\"NVL\" typeinter=\"PIX\" samechannels=\"0\">\n",
+        g,
+        g == 0 ? 4 : (g == 1 ? 1 : 3));
+    for (int c = 0; c < 30; c++) {
+      fprintf(f, "    <channel>\n");
+      fprintf(f, "      <net dev=\"%d\"/>\n", c % 16);
+      for (int i = 0; i < 8; i++) {
+        fprintf(f, "      <gpu dev=\"%d\"/>\n", (c + i) % 8);
+      }
+      fprintf(f, "      <net dev=\"%d\"/>\n", (c + 1) % 16);
+      fprintf(f, "    </channel>\n");
+    }
+    fprintf(f, "  </graph>\n");
+  }
+  fprintf(f, "</graphs>\n");
+}
+
+static bool sameXml(struct ncclXml* a, struct ncclXml* b) {
+  if (a->maxIndex != b->maxIndex) {
+    return false;
+  }
+  for (int i = 0; i < a->maxIndex; i++) {
+    struct ncclXmlNode* na = a->nodes + i;
+    struct ncclXmlNode* nb = b->nodes + i;
+    if (strcmp(na->name, nb->name) != 0 || na->nAttrs != nb->nAttrs ||
+        na->nSubs != nb->nSubs ||
+        (na->parent ? na->parent - a->nodes : -1) !=
+            (nb->parent ? nb->parent - b->nodes : -1)) {
+      return false;
+    }
+    for (int j = 0; j < na->nAttrs; j++) {
+      if (strcmp(na->attrs[j].key, nb->attrs[j].key) != 0 ||
+          strcmp(na->attrs[j].value, nb->attrs[j].value) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char** argv) {
+  int iters = argc > 1 ? atoi(argv[1]) : 100;
+  std::string dir = argc > 2 ? argv[2] : "/tmp";
+
+  struct Input {
+    const char* name;
+    void (*write)(FILE*);
+    bool graph;
+  };
+  const Input inputs[] = {
+      {"topo", writeTopo, false},
+      {"graph", writeGraph, true},
+  };
+
+  auto xml = static_cast<struct ncclXml*>(calloc(1, sizeof(struct ncclXml)));
+  auto ref = static_cast<struct ncclXml*>(calloc(1, sizeof(struct ncclXml)));
+
+  printf(
+      "%8s %10s %8s %14s %14s %8s\n",
+      "input",
+      "bytes",
+      "nodes",
+      "legacy(us)",
+      "stream(us)",
+      "speedup");
+  bool ok = true;
+  for (auto& input : inputs) {
+    std::string path =
+        dir + "/nccl_xml_bench_" + input.name + "_" + std::to_string(getpid()) + ".xml";
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == nullptr) {
+      perror("fopen");
+      return EXIT_FAILURE;
+    }
+    input.write(f);
+    long bytes = ftell(f);
+    fclose(f);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++) {
+      if (legacyLoad(path.c_str(), ref) != ncclSuccess) {
+        fprintf(stderr, "Legacy parser failed on %s\n", input.name);
+        return EXIT_FAILURE;
+      }
+    }
+    double legacyUs = elapsedUs(start) / iters;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++) {
+      ncclResult_t res = input.graph
+          ? ncclTopoGetXmlGraphFromFile(path.c_str(), xml)
+          : ncclTopoGetXmlFromFile(path.c_str(), xml, 1);
+      if (res != ncclSuccess) {
+        fprintf(stderr, "Parser failed on %s\n", input.name);
+        return EXIT_FAILURE;
+      }
+    }
+    double streamUs = elapsedUs(start) / iters;
+
+    bool same = sameXml(xml, ref);
+    ok &= same;
+    printf(
+        "%8s %10ld %8d %14.1f %14.1f %7.1fx %s\n",
+        input.name,
+        bytes,
+        xml->maxIndex,
+        legacyUs,
+        streamUs,
+        legacyUs / streamUs,
+        same ? "" : "MISMATCH");
+    unlink(path.c_str());
+  }
+
+  free(xml);
+  free(ref);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
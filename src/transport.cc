@@ -84,12 +84,12 @@ ncclResult_t ncclTransportP2pSetup(struct ncclComm* comm, struct ncclTopoGraph*
   struct ncclConnect** data = (ncclConnect**) malloc(sizeof(ncclConnect*) * comm->nRanks); // Store intermediate send/recvData structs for connect
   struct ncclConnect** recvData = (ncclConnect**) malloc(sizeof(ncclConnect*) * comm->nRanks); // Points to entries inside data for given recv connection within a channel
   struct ncclConnect** sendData = (ncclConnect**) malloc(sizeof(ncclConnect*) * comm->nRanks); // Points to entries inside data for given send connection within a channel
+  int* nChannels = (int*) malloc(sizeof(int) * 2*comm->nRanks); // Number of recv and send connections with each peer
   int done = 0;
 
   NCCLCHECKGOTO(ncclStrongStreamAcquireUncaptured(&comm->sharedRes->hostStream), ret, fail);
   // First time initialization
   for (int i=1; i<comm->nRanks; i++) {
-    int bootstrapTag = (i<<8) + (graph ? graph->id+1 : 0);
     int recvPeer = (comm->rank - i + comm->nRanks) % comm->nRanks;
     int sendPeer = (comm->rank + i) % comm->nRanks;
     uint64_t recvMask = comm->connectRecv[recvPeer];
@@ -121,24 +121,35 @@ ncclResult_t ncclTransportP2pSetup(struct ncclComm* comm, struct ncclTopoGraph*
       }
     }
     TIME_STOP(1);
+    nChannels[2*i] = recvChannels;
+    nChannels[2*i+1] = sendChannels;
 
-    TIME_START(2);
-    if (sendPeer == recvPeer) {
-      if (recvChannels+sendChannels) {
-        NCCLCHECKGOTO(bootstrapSend(comm->bootstrap, recvPeer, bootstrapTag, data[i], sizeof(struct ncclConnect)*(recvChannels+sendChannels)), ret, fail);
-        NCCLCHECKGOTO(bootstrapRecv(comm->bootstrap, recvPeer, bootstrapTag, data[i], sizeof(struct ncclConnect)*(recvChannels+sendChannels)), ret, fail);
-        sendData[i] = data[i];
-        recvData[i] = data[i]+sendChannels;
+    if (i-done >= NCCL_CONNECT_ROUND_SIZE || i == comm->nRanks-1) {
+      // The proxy calls of the setup of the whole round are pipelined, collect their responses
+      // before exchanging the connect information
+      TIME_START(2);
+      NCCLCHECKGOTO(ncclProxyDeferredWait(comm), ret, fail);
+      for (int j=done+1; j<=i; j++) {
+        int bootstrapTag = (j<<8) + (graph ? graph->id+1 : 0);
+        int recvPeer = (comm->rank - j + comm->nRanks) % comm->nRanks;
+        int sendPeer = (comm->rank + j) % comm->nRanks;
+        int recvChannels = nChannels[2*j], sendChannels = nChannels[2*j+1];
+        if (sendPeer == recvPeer) {
+          if (recvChannels+sendChannels) {
+            NCCLCHECKGOTO(bootstrapSend(comm->bootstrap, recvPeer, bootstrapTag, data[j], sizeof(struct ncclConnect)*(recvChannels+sendChannels)), ret, fail);
+            NCCLCHECKGOTO(bootstrapRecv(comm->bootstrap, recvPeer, bootstrapTag, data[j], sizeof(struct ncclConnect)*(recvChannels+sendChannels)), ret, fail);
+            sendData[j] = data[j];
+            recvData[j] = data[j]+sendChannels;
+          }
+        } else {
+          if (recvChannels) NCCLCHECKGOTO(bootstrapSend(comm->bootstrap, recvPeer, bootstrapTag, recvData[j], sizeof(struct ncclConnect)*recvChannels), ret, fail);
+          if (sendChannels) NCCLCHECKGOTO(bootstrapSend(comm->bootstrap, sendPeer, bootstrapTag, sendData[j], sizeof(struct ncclConnect)*sendChannels), ret, fail);
+          if (sendChannels) NCCLCHECKGOTO(bootstrapRecv(comm->bootstrap, sendPeer, bootstrapTag, sendData[j], sizeof(struct ncclConnect)*sendChannels), ret, fail);
+          if (recvChannels) NCCLCHECKGOTO(bootstrapRecv(comm->bootstrap, recvPeer, bootstrapTag, recvData[j], sizeof(struct ncclConnect)*recvChannels), ret, fail);
+        }
       }
-    } else {
-      if (recvChannels) NCCLCHECKGOTO(bootstrapSend(comm->bootstrap, recvPeer, bootstrapTag, recvData[i], sizeof(struct ncclConnect)*recvChannels), ret, fail);
-      if (sendChannels) NCCLCHECKGOTO(bootstrapSend(comm->bootstrap, sendPeer, bootstrapTag, sendData[i], sizeof(struct ncclConnect)*sendChannels), ret, fail);
-      if (sendChannels) NCCLCHECKGOTO(bootstrapRecv(comm->bootstrap, sendPeer, bootstrapTag, sendData[i], sizeof(struct ncclConnect)*sendChannels), ret, fail);
-      if (recvChannels) NCCLCHECKGOTO(bootstrapRecv(comm->bootstrap, recvPeer, bootstrapTag, recvData[i], sizeof(struct ncclConnect)*recvChannels), ret, fail);
-    }
-    TIME_STOP(2);
+      TIME_STOP(2);
 
-    if (i-done >= NCCL_CONNECT_ROUND_SIZE || i == comm->nRanks-1) {
       // Loop until all channels with all ranks have been connected
       bool allChannelsConnected;
       allChannelsConnected = false;
@@ -208,6 +219,7 @@ ncclResult_t ncclTransportP2pSetup(struct ncclComm* comm, struct ncclTopoGraph*
   free(data);
   free(sendData);
   free(recvData);
+  free(nChannels);
 
   if (highestTransportType != NULL) *highestTransportType = highestType;
   TIME_PRINT("P2P Setup/Connect");
@@ -216,6 +228,8 @@ exit:
   NCCLCHECK(ncclStrongStreamRelease(ncclCudaGraphNone(), &comm->sharedRes->hostStream));
   return ret;
 fail:
+  // Deferred proxy calls of the round refer to the connectors and the data being torn down
+  ncclProxyDeferredDiscard(comm);
   goto exit;
 }
 
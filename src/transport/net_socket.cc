@@ -15,6 +15,13 @@
 #include <poll.h>
 #include <limits.h>
 #include <fcntl.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define NET_SOCKET_ZCOPY_SUPPORTED 1
+#endif
 
 /*
 === BEGIN_NCCL_CVAR_INFO_BLOCK ===
@@ -41,6 +48,16 @@
      information:
      https://docs.nvidia.com/deeplearning/nccl/user-guide/docs/env.html#nccl-socket-nthreads
 
+ - name        : NCCL_SOCKET_ZCOPY_THRESHOLD
+   type        : int64_t
+   default     : -1
+   description : |-
+     Minimum size of a send for which the socket transport uses
+     sendmsg(MSG_ZEROCOPY), on both the helper thread sockets and the
+     control socket. Buffers are only released to NCCL once the kernel
+     reports the transmission complete. Set to -1 to disable zero-copy
+     sends.
+
 === END_NCCL_CVAR_INFO_BLOCK ===
 */
 
@@ -162,13 +179,25 @@ struct ncclNetSocketHandle {
   struct ncclNetSocketCommStage stage;
 };
 
+/* Zero-copy completion tracking of a socket. Every MSG_ZEROCOPY send gets
+ * the next id, and the kernel reports completed ids in order on the socket
+ * error queue. */
+struct ncclNetSocketZcopy {
+  int enabled;
+  uint32_t nextId;
+  uint32_t doneId; // all sends with an id lower than doneId have completed
+};
+
 struct ncclNetSocketTask {
   int op;
   void* data;
   int size;
   struct ncclSocket* sock;
+  struct ncclNetSocketZcopy* zcopy;
   int offset;
   int used;
+  int zcopyPending; // data handed to the kernel without copy is still in use
+  uint32_t zcopyLastId;
   ncclResult_t result;
 };
 
@@ -177,16 +206,27 @@ struct ncclNetSocketRequest {
   void* data;
   int size;
   struct ncclSocket* ctrlSock;
+  int hdr; // size header carried on the control socket
+  int hdrOffset;
   int offset;
   int used;
+  int zcopyPending;
+  uint32_t zcopyLastId;
   struct ncclNetSocketComm* comm;
   struct ncclNetSocketTask* tasks[MAX_SOCKETS];
   int nSubs;
 };
 
+/* Request states */
+#define REQ_FREE 0
+#define REQ_HDR 1      // size header in flight on the control socket
+#define REQ_DATA 2     // payload in flight on the control socket
+#define REQ_CTRL_DONE 3 // control socket done; waiting for tasks or zero-copy completions
+
 struct ncclNetSocketTaskQueue {
   int next;
   int len;
+  uint64_t nPosted; // total number of tasks posted
   struct ncclNetSocketTask* tasks;
 };
 
@@ -209,32 +249,167 @@ struct ncclNetSocketListenComm {
 struct ncclNetSocketComm {
   struct ncclSocket ctrlSock;
   struct ncclSocket socks[MAX_SOCKETS];
+  struct ncclNetSocketZcopy ctrlZcopy;
+  struct ncclNetSocketZcopy zcopy[MAX_SOCKETS];
   int dev;
   int cudaDev;
   int nSocks;
   int nThreads;
   int nextSock;
   struct ncclNetSocketRequest requests[MAX_REQUESTS];
+  // Requests in posting order whose size header, or payload when there are
+  // no helper threads, is still in flight on the control socket. They are
+  // streamed back to back, so that a single system call carries the headers
+  // and payloads of several requests.
+  struct ncclNetSocketRequest* ctrlQueue[MAX_REQUESTS];
+  int ctrlHead;
+  int ctrlCount;
   pthread_t helperThread[MAX_THREADS];
   struct ncclNetSocketThreadResources threadResources[MAX_THREADS];
 };
 
+static void ncclNetSocketZcopyEnable(struct ncclSocket* sock, struct ncclNetSocketZcopy* zcopy) {
+  zcopy->enabled = 0;
+#ifdef NET_SOCKET_ZCOPY_SUPPORTED
+  if (NCCL_SOCKET_ZCOPY_THRESHOLD >= 0) {
+    int one = 1;
+    if (setsockopt(sock->fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0) {
+      zcopy->enabled = 1;
+    } else {
+      INFO(NCCL_INIT|NCCL_NET, "NET/Socket : SO_ZEROCOPY not available (%s), falling back to copy sends", strerror(errno));
+    }
+  }
+#endif
+}
+
+static inline int ncclNetSocketZcopyUse(struct ncclNetSocketZcopy* zcopy, int64_t size) {
+  return zcopy->enabled && size >= NCCL_SOCKET_ZCOPY_THRESHOLD;
+}
+
+static inline int ncclNetSocketZcopyDone(struct ncclNetSocketZcopy* zcopy, uint32_t id) {
+  return (int32_t)(zcopy->doneId - id) > 0;
+}
+
+/* Drain zero-copy completion notifications from the socket error queue */
+static ncclResult_t ncclNetSocketZcopyPoll(struct ncclSocket* sock, struct ncclNetSocketZcopy* zcopy) {
+#ifdef NET_SOCKET_ZCOPY_SUPPORTED
+  while (1) {
+    char control[128];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(sock->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+      char line[SOCKET_NAME_MAXLEN+1];
+      WARN("NET/Socket : failed to read zero-copy completions from %s : %s", ncclSocketToString(&sock->addr, line), strerror(errno));
+      return ncclRemoteError;
+    }
+    for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+            (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) continue;
+      struct sock_extended_err* serr = (struct sock_extended_err*)CMSG_DATA(cm);
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+      // [ee_info, ee_data] is the range of completed sends; TCP reports them
+      // in order, so tracking the upper bound is enough
+      zcopy->doneId = serr->ee_data + 1;
+    }
+  }
+#endif
+  return ncclSuccess;
+}
+
+/* Non-blocking sendmsg/recvmsg of an iovec. Returns the number of bytes
+ * transferred, 0 if the socket is not ready, and sets *zcopyId when the data
+ * was sent without copy. */
+static ncclResult_t ncclNetSocketProgressIov(int op, struct ncclSocket* sock, struct ncclNetSocketZcopy* zcopy,
+    struct iovec* iov, int niov, int useZcopy, ssize_t* bytes, uint32_t* zcopyId) {
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = niov;
+  ssize_t ret;
+  *bytes = 0;
+  if (op == NCCL_SOCKET_SEND) {
+    int flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+#ifdef NET_SOCKET_ZCOPY_SUPPORTED
+    if (useZcopy) flags |= MSG_ZEROCOPY;
+#else
+    useZcopy = 0;
+#endif
+    ret = sendmsg(sock->fd, &msg, flags);
+  } else {
+    useZcopy = 0;
+    ret = recvmsg(sock->fd, &msg, MSG_DONTWAIT);
+  }
+  char line[SOCKET_NAME_MAXLEN+1];
+  if (ret < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return ncclSuccess;
+    // Too many zero-copy sends in flight; wait for completions
+    if (useZcopy && errno == ENOBUFS) return ncclNetSocketZcopyPoll(sock, zcopy);
+    WARN("NET/Socket : Call to %s %s failed : %s", op == NCCL_SOCKET_SEND ? "send to" : "recv from",
+        ncclSocketToString(&sock->addr, line), strerror(errno));
+    return ncclRemoteError;
+  }
+  if (op == NCCL_SOCKET_RECV && ret == 0) {
+    WARN("NET/Socket : Connection closed by remote peer %s", ncclSocketToString(&sock->addr, line, 0));
+    return ncclRemoteError;
+  }
+  if (useZcopy) *zcopyId = zcopy->nextId++;
+  *bytes = ret;
+  return ncclSuccess;
+}
+
+static ncclResult_t ncclNetSocketTaskProgress(struct ncclNetSocketTask* r) {
+  if (r->offset < r->size) {
+    if (r->op == NCCL_SOCKET_SEND && ncclNetSocketZcopyUse(r->zcopy, r->size)) {
+      struct iovec iov = { (char*)r->data + r->offset, (size_t)(r->size - r->offset) };
+      ssize_t bytes;
+      uint32_t id;
+      // Mark the task pending before its offset can reach the size, as the
+      // main thread considers it complete based on both
+      r->zcopyPending = 1;
+      NCCLCHECK(ncclNetSocketProgressIov(r->op, r->sock, r->zcopy, &iov, 1, 1, &bytes, &id));
+      if (bytes > 0) r->zcopyLastId = id;
+      r->offset += bytes;
+    } else {
+      NCCLCHECK(ncclSocketProgress(r->op, r->sock, r->data, r->size, &r->offset));
+    }
+  }
+  if (r->offset == r->size && r->zcopyPending) {
+    NCCLCHECK(ncclNetSocketZcopyPoll(r->sock, r->zcopy));
+    if (ncclNetSocketZcopyDone(r->zcopy, r->zcopyLastId)) r->zcopyPending = 0;
+  }
+  return ncclSuccess;
+}
+
+static inline int ncclNetSocketTaskBusy(struct ncclNetSocketTask* r) {
+  return r->used == 1 && (r->offset < r->size || r->zcopyPending);
+}
+
 void* persistentSocketThread(void *args_) {
   struct ncclNetSocketThreadResources* resource = (struct ncclNetSocketThreadResources*)args_;
   struct ncclNetSocketComm* comm = resource->comm;
   struct ncclNetSocketTaskQueue* myQueue = &resource->threadTaskQueue;
   int nSocksPerThread = comm->nSocks / comm->nThreads;
+  uint64_t nDone = 0; // tasks before the oldest one not done yet
   while (1) {
     int idle = 1;
-    int mark = myQueue->next; // mark newest task seen
-    for (int i=0; i<myQueue->len; i+=nSocksPerThread) {
+    uint64_t mark = myQueue->nPosted; // mark newest task seen
+    int head = nDone % myQueue->len;
+    int pending = mark - nDone;
+    // Tasks of several requests can be queued at once, and each socket must
+    // carry its tasks in posting order like the peer does. Walk the queue from
+    // the oldest task, progressing nSocksPerThread consecutive tasks, which use
+    // distinct sockets, at a time.
+    for (int i=0; i<pending; i+=nSocksPerThread) {
       int repeat;
       do {
         repeat = 0;
-        for (int j=0; j<nSocksPerThread; j++) {
-          struct ncclNetSocketTask* r = myQueue->tasks+i+j;
-          if (r != NULL && r->used == 1 && r->offset < r->size) {
-            r->result = ncclSocketProgress(r->op, r->sock, r->data, r->size, &r->offset);
+        for (int j=i; j<std::min(i+nSocksPerThread, pending); j++) {
+          struct ncclNetSocketTask* r = myQueue->tasks+(head+j)%myQueue->len;
+          if (ncclNetSocketTaskBusy(r)) {
+            r->result = ncclNetSocketTaskProgress(r);
             if (r->result != ncclSuccess) {
               WARN("NET/Socket : socket progress error");
               return NULL;
@@ -245,9 +420,10 @@ void* persistentSocketThread(void *args_) {
         }
       } while (repeat);
     }
+    while (nDone < mark && !ncclNetSocketTaskBusy(myQueue->tasks + nDone % myQueue->len)) nDone++;
     if (idle) {
       pthread_mutex_lock(&resource->threadLock);
-      while (mark == myQueue->next && resource->stop == 0) { // no new tasks, wait
+      while (mark == myQueue->nPosted && resource->stop == 0) { // no new tasks, wait
         pthread_cond_wait(&resource->threadCond, &resource->threadLock);
       }
       pthread_mutex_unlock(&resource->threadLock);
@@ -367,6 +543,8 @@ socket_send:
     NCCLCHECK(ncclSocketProgress(NCCL_SOCKET_SEND, sock, &i, sizeof(uint8_t), &done));
     if (done == 0) return ncclSuccess;
   }
+  for (int s=0; s<comm->nSocks; s++) ncclNetSocketZcopyEnable(comm->socks+s, comm->zcopy+s);
+  ncclNetSocketZcopyEnable(&comm->ctrlSock, &comm->ctrlZcopy);
   *sendComm = comm;
   return ncclSuccess;
 }
@@ -428,14 +606,20 @@ socket_recv:
 ncclResult_t ncclNetSocketGetRequest(struct ncclNetSocketComm* comm, int op, void* data, int size, struct ncclNetSocketRequest** req) {
   for (int i=0; i<MAX_REQUESTS; i++) {
     struct ncclNetSocketRequest* r = comm->requests+i;
-    if (r->used == 0) {
+    if (r->used == REQ_FREE) {
       r->op = op;
       r->data = data;
       r->size = size;
       r->ctrlSock = &comm->ctrlSock;
-      r->used = 1;
+      r->hdr = size;
+      r->hdrOffset = 0;
+      r->offset = 0;
+      r->zcopyPending = 0;
+      r->used = REQ_HDR;
       r->comm = comm;
       r->nSubs = 0;
+      comm->ctrlQueue[(comm->ctrlHead + comm->ctrlCount) % MAX_REQUESTS] = r;
+      comm->ctrlCount++;
       *req = r;
       return ncclSuccess;
     }
@@ -456,6 +640,7 @@ ncclResult_t ncclNetSocketGetTask(struct ncclNetSocketComm* comm, int op, void*
     queue->len = MAX_REQUESTS * DIVUP(comm->nSocks, comm->nThreads);
     NCCLCHECK(ncclCalloc(&queue->tasks, queue->len));
     queue->next = 0;
+    queue->nPosted = 0;
     res->comm = comm;
     pthread_mutex_init(&res->threadLock, NULL);
     pthread_cond_init(&res->threadCond, NULL);
@@ -468,13 +653,16 @@ ncclResult_t ncclNetSocketGetTask(struct ncclNetSocketComm* comm, int op, void*
     r->data = data;
     r->size = size;
     r->sock = comm->socks + comm->nextSock;
+    r->zcopy = comm->zcopy + comm->nextSock;
     r->offset = 0;
+    r->zcopyPending = 0;
     r->result = ncclSuccess;
     comm->nextSock = (comm->nextSock + 1) % comm->nSocks;
     r->used = 1;
     *req = r;
     pthread_mutex_lock(&res->threadLock);
     queue->next = (queue->next+1)%queue->len;
+    queue->nPosted++;
     pthread_cond_signal(&res->threadCond);
     pthread_mutex_unlock(&res->threadLock);
     return ncclSuccess;
@@ -483,6 +671,104 @@ ncclResult_t ncclNetSocketGetTask(struct ncclNetSocketComm* comm, int op, void*
   return ncclInternalError;
 }
 
+/* Called once the size header of a request has been sent or received */
+static ncclResult_t ncclNetSocketHdrDone(struct ncclNetSocketRequest* r) {
+  // Check size is less or equal to the size provided by the user
+  if (r->op == NCCL_SOCKET_RECV && r->hdr > r->size) {
+    char line[SOCKET_NAME_MAXLEN+1];
+    union ncclSocketAddress addr;
+    ncclSocketGetAddr(r->ctrlSock, &addr);
+    WARN("NET/Socket : peer %s message truncated : receiving %d bytes instead of %d. If you believe your socket network is in healthy state, \
+        there may be a mismatch in collective sizes or environment settings (e.g. NCCL_PROTO, NCCL_ALGO) between ranks",
+        ncclSocketToString(&addr, line), r->hdr, r->size);
+    return ncclInvalidUsage;
+  }
+  r->size = r->hdr;
+  r->used = REQ_DATA; // done exchanging size
+  // divide into subtasks
+  int chunkOffset = 0, i = 0;
+  if (r->comm->nSocks > 0) {
+    // each request can be divided up to nSocks tasks
+    int taskSize = std::max(MIN_CHUNKSIZE, DIVUP(r->size, r->comm->nSocks));
+    while (chunkOffset < r->size) {
+      int chunkSize = std::min(taskSize, r->size-chunkOffset);
+      NCCLCHECK(ncclNetSocketGetTask(r->comm, r->op, (char*)(r->data)+chunkOffset, chunkSize, r->tasks+i++));
+      chunkOffset += chunkSize;
+    }
+  }
+  r->nSubs = i;
+  return ncclSuccess;
+}
+
+#define MAX_CTRL_IOVS (2*MAX_REQUESTS)
+
+/* Progress the control socket of a communicator. Size headers, and payloads
+ * when there are no helper threads, of all posted requests are gathered into
+ * a single sendmsg/recvmsg. On the receive side the gather stops after the
+ * first incomplete header, since the size of the following payload is not
+ * known yet; the header of the next request is still read together with the
+ * end of the current payload. */
+static ncclResult_t ncclNetSocketProgressCtrl(struct ncclNetSocketComm* comm) {
+  while (comm->ctrlCount > 0) {
+    struct iovec iov[MAX_CTRL_IOVS];
+    int* offsets[MAX_CTRL_IOVS];
+    struct ncclNetSocketRequest* reqs[MAX_CTRL_IOVS];
+    int niov = 0;
+    size_t total = 0;
+    int op = comm->ctrlQueue[comm->ctrlHead]->op;
+
+    for (int q=0; q<comm->ctrlCount; q++) {
+      struct ncclNetSocketRequest* r = comm->ctrlQueue[(comm->ctrlHead+q) % MAX_REQUESTS];
+      if (r->hdrOffset < (int)sizeof(int)) {
+        iov[niov].iov_base = (char*)&r->hdr + r->hdrOffset;
+        iov[niov].iov_len = sizeof(int) - r->hdrOffset;
+        offsets[niov] = &r->hdrOffset;
+        reqs[niov++] = r;
+        if (op == NCCL_SOCKET_RECV) break;
+      }
+      if (comm->nSocks == 0 && r->offset < r->hdr) {
+        iov[niov].iov_base = (char*)r->data + r->offset;
+        iov[niov].iov_len = r->hdr - r->offset;
+        offsets[niov] = &r->offset;
+        reqs[niov++] = r;
+      }
+    }
+    for (int i=0; i<niov; i++) total += iov[i].iov_len;
+
+    ssize_t bytes = 0;
+    uint32_t zcopyId;
+    int useZcopy = op == NCCL_SOCKET_SEND && ncclNetSocketZcopyUse(&comm->ctrlZcopy, total);
+    if (niov > 0) NCCLCHECK(ncclNetSocketProgressIov(op, &comm->ctrlSock, &comm->ctrlZcopy, iov, niov, useZcopy, &bytes, &zcopyId));
+    if (bytes == 0) break;
+
+    ssize_t left = bytes;
+    for (int i=0; i<niov && left > 0; i++) {
+      int n = std::min(left, (ssize_t)iov[i].iov_len);
+      struct ncclNetSocketRequest* r = reqs[i];
+      *offsets[i] += n;
+      left -= n;
+      if (useZcopy) {
+        // Headers are sent without copy too, so the request must stay
+        // allocated until the kernel releases them
+        r->zcopyPending = 1;
+        r->zcopyLastId = zcopyId;
+      }
+      if (r->used == REQ_HDR && r->hdrOffset == sizeof(int)) NCCLCHECK(ncclNetSocketHdrDone(r));
+    }
+
+    // Retire requests that are done with the control socket
+    while (comm->ctrlCount > 0) {
+      struct ncclNetSocketRequest* r = comm->ctrlQueue[comm->ctrlHead];
+      if (r->used != REQ_DATA || (comm->nSocks == 0 && r->offset < r->size)) break;
+      r->used = REQ_CTRL_DONE;
+      comm->ctrlHead = (comm->ctrlHead + 1) % MAX_REQUESTS;
+      comm->ctrlCount--;
+    }
+    if ((size_t)bytes < total) break; // socket buffer is full or empty
+  }
+  return ncclSuccess;
+}
+
 ncclResult_t ncclNetSocketTest(void* request, int* done, int* size) {
   *done = 0;
   struct ncclNetSocketRequest *r = (struct ncclNetSocketRequest*)request;
@@ -490,69 +776,26 @@ ncclResult_t ncclNetSocketTest(void* request, int* done, int* size) {
     WARN("NET/Socket : test called with NULL request");
     return ncclInternalError;
   }
-  if (r->used == 1) { /* try to send/recv size */
-    int data = r->size;
-    int offset = 0;
-    NCCLCHECK(ncclSocketProgress(r->op, r->ctrlSock, &data, sizeof(int), &offset));
-
-    if (offset == 0) return ncclSuccess; /* Not ready -- retry later */
-
-    // Not sure we could ever receive less than 4 bytes, but just in case ...
-    if (offset < sizeof(int)) NCCLCHECK(ncclSocketWait(r->op, r->ctrlSock, &data, sizeof(int), &offset));
-
-    // Check size is less or equal to the size provided by the user
-    if (r->op == NCCL_SOCKET_RECV && data > r->size) {
-      char line[SOCKET_NAME_MAXLEN+1];
-      union ncclSocketAddress addr;
-      ncclSocketGetAddr(r->ctrlSock, &addr);
-      WARN("NET/Socket : peer %s message truncated : receiving %d bytes instead of %d. If you believe your socket network is in healthy state, \
-          there may be a mismatch in collective sizes or environment settings (e.g. NCCL_PROTO, NCCL_ALGO) between ranks",
-          ncclSocketToString(&addr, line), data, r->size);
-      return ncclInvalidUsage;
-    }
-    r->size = data;
-    r->offset = 0;
-    r->used = 2; // done exchanging size
-    // divide into subtasks
-    int chunkOffset = 0, i = 0;
-    if (r->comm->nSocks > 0) {
-      // each request can be divided up to nSocks tasks
-      int taskSize = std::max(MIN_CHUNKSIZE, DIVUP(r->size, r->comm->nSocks));
-      while (chunkOffset < r->size) {
-        int chunkSize = std::min(taskSize, r->size-chunkOffset);
-        NCCLCHECK(ncclNetSocketGetTask(r->comm, r->op, (char*)(r->data)+chunkOffset, chunkSize, r->tasks+i++));
-        chunkOffset += chunkSize;
-      }
-    }
-    r->nSubs = i;
+  if (r->used != REQ_CTRL_DONE) {
+    NCCLCHECK(ncclNetSocketProgressCtrl(r->comm));
+    if (r->used != REQ_CTRL_DONE) return ncclSuccess; /* Not ready -- retry later */
   }
-  if (r->used == 2) { // already exchanged size
-    if (r->nSubs > 0) {
-      int nCompleted = 0;
-      for (int i=0; i<r->nSubs; i++) {
-        struct ncclNetSocketTask* sub = r->tasks[i];
-        if (sub->result != ncclSuccess) return sub->result;
-        if (sub->offset == sub->size) nCompleted++;
-      }
-      if (nCompleted == r->nSubs) {
-        if (size) *size = r->size;
-        *done = 1;
-        r->used = 0;
-        for (int i=0; i<r->nSubs; i++) {
-          struct ncclNetSocketTask* sub = r->tasks[i];
-          sub->used = 0;
-        }
-      }
-    } else { // progress request using main thread
-      if (r->offset < r->size) {
-        NCCLCHECK(ncclSocketProgress(r->op, r->ctrlSock, r->data, r->size, &r->offset));
-      }
-      if (r->offset == r->size) {
-        if (size) *size = r->size;
-        *done = 1;
-        r->used = 0;
-      }
-    }
+  for (int i=0; i<r->nSubs; i++) {
+    struct ncclNetSocketTask* sub = r->tasks[i];
+    if (sub->result != ncclSuccess) return sub->result;
+    if (sub->offset < sub->size || sub->zcopyPending) return ncclSuccess;
+  }
+  if (r->zcopyPending) {
+    NCCLCHECK(ncclNetSocketZcopyPoll(r->ctrlSock, &r->comm->ctrlZcopy));
+    if (!ncclNetSocketZcopyDone(&r->comm->ctrlZcopy, r->zcopyLastId)) return ncclSuccess;
+    r->zcopyPending = 0;
+  }
+  if (size) *size = r->size;
+  *done = 1;
+  r->used = REQ_FREE;
+  for (int i=0; i<r->nSubs; i++) {
+    struct ncclNetSocketTask* sub = r->tasks[i];
+    sub->used = 0;
   }
   return ncclSuccess;
 }